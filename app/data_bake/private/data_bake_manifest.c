@@ -0,0 +1,332 @@
+#include "data_bake_manifest.h"
+
+#include <std_file.h>
+#include <std_hash.h>
+#include <std_log.h>
+#include <std_string.h>
+#include <std_byte.h>
+
+#include <bsf.h>
+
+// ------------------------------------------------------------------------------------------------
+// Dependencies
+
+void data_bake_dependency_list_init ( data_bake_dependency_list_t* list ) {
+    list->count = 0;
+    list->paths = std_virtual_stack_create ( std_path_size_m * data_bake_max_dependencies_m );
+}
+
+void data_bake_dependency_list_deinit ( data_bake_dependency_list_t* list ) {
+    std_virtual_stack_destroy ( &list->paths );
+    list->count = 0;
+}
+
+bool data_bake_dependency_list_add ( data_bake_dependency_list_t* list, const char* path, uint64_t content_hash, uint64_t size, uint64_t write_time ) {
+    for ( uint32_t i = 0; i < list->count; ++i ) {
+        if ( std_str_cmp ( list->array[i].path, path ) == 0 ) {
+            return true;
+        }
+    }
+
+    if ( list->count == data_bake_max_dependencies_m ) {
+        return false;
+    }
+
+    data_bake_dependency_t* dep = &list->array[list->count++];
+    dep->content_hash = content_hash;
+    dep->size = size;
+    dep->write_time = write_time;
+    dep->path = std_virtual_stack_string_copy ( &list->paths, path );
+    return true;
+}
+
+uint64_t data_bake_content_hash ( const void* base, uint64_t size ) {
+    // The block hash takes a 32 bit size, hash big files one block at a time and combine the results
+    const uint64_t block_size = 1ull << 30;
+    uint64_t block_hashes[64];
+    uint32_t block_count = 0;
+    const char* data = ( const char* ) base;
+
+    while ( size > 0 && block_count < 64 ) {
+        uint64_t block = size < block_size ? size : block_size;
+        block_hashes[block_count++] = std_hash_block_64_m ( data, ( uint32_t ) block );
+        data += block;
+        size -= block;
+    }
+
+    return std_hash_block_64_m ( block_hashes, sizeof ( uint64_t ) * block_count );
+}
+
+// ------------------------------------------------------------------------------------------------
+// Parsing
+
+static const char* data_bake_manifest_line_end ( const char* line ) {
+    while ( *line != '\0' && *line != '\n' ) {
+        ++line;
+    }
+
+    return line;
+}
+
+static const char* data_bake_manifest_next_line ( const char* line ) {
+    line = data_bake_manifest_line_end ( line );
+    return *line == '\n' ? line + 1 : line;
+}
+
+static const char* data_bake_manifest_skip_token ( const char* str ) {
+    while ( *str != '\0' && *str != '\n' && *str != ' ' ) {
+        ++str;
+    }
+
+    return *str == ' ' ? str + 1 : str;
+}
+
+// Copies the rest of the line, returns false if it doesn't fit
+static bool data_bake_manifest_read_path ( char* dest, size_t cap, const char* str ) {
+    size_t len = ( size_t ) ( data_bake_manifest_line_end ( str ) - str );
+
+    if ( len == 0 || len >= cap ) {
+        return false;
+    }
+
+    std_mem_copy ( dest, str, len );
+    dest[len] = '\0';
+    return true;
+}
+
+static void data_bake_manifest_version_line ( char* line, size_t cap, uint32_t options ) {
+    std_str_format ( line, cap, "data_bake " std_fmt_u32_m " " std_fmt_u32_m " " std_fmt_u32_m "\n", ( uint32_t ) bsf_version_m, ( uint32_t ) data_bake_version_m, options );
+}
+
+void data_bake_manifest_load ( data_bake_manifest_t* manifest, const char* path, uint32_t options ) {
+    std_mem_zero_m ( manifest );
+
+    std_path_info_t info;
+
+    if ( !std_path_info ( &info, path ) || !( info.flags & std_path_is_file_m ) ) {
+        return;
+    }
+
+    std_buffer_t buffer = std_file_read_to_virtual_heap ( path );
+
+    if ( buffer.base == NULL ) {
+        std_log_warn_m ( "Failed to read bake manifest " std_fmt_str_m ", all inputs will be baked", path );
+        return;
+    }
+
+    char version[64];
+    data_bake_manifest_version_line ( version, 64, options );
+    size_t version_len = std_str_len ( version );
+
+    if ( buffer.size < version_len || std_str_cmp_part ( ( const char* ) buffer.base, version, version_len ) != 0 ) {
+        std_log_info_m ( "Bake manifest " std_fmt_str_m " was written by a different version or with different options, all inputs will be baked", path );
+        std_virtual_heap_free ( buffer.base );
+        return;
+    }
+
+    // Null terminate the text, simplifies parsing
+    char* text = std_virtual_heap_alloc_array_m ( char, buffer.size + 1 );
+    std_mem_copy ( text, buffer.base, buffer.size );
+    text[buffer.size] = '\0';
+    std_virtual_heap_free ( buffer.base );
+
+    uint32_t count = 0;
+
+    for ( const char* line = text + version_len; *line != '\0'; line = data_bake_manifest_next_line ( line ) ) {
+        count += std_str_starts_with ( line, "input " ) ? 1 : 0;
+    }
+
+    manifest->text = text;
+    manifest->text_size = buffer.size;
+    manifest->entries_array = std_virtual_heap_alloc_array_m ( data_bake_manifest_entry_t, count > 0 ? count : 1 );
+    manifest->entries_count = 0;
+
+    data_bake_manifest_entry_t* entry = NULL;
+    char* input_path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+
+    for ( const char* line = text + version_len; *line != '\0'; line = data_bake_manifest_next_line ( line ) ) {
+        if ( !std_str_starts_with ( line, "input " ) ) {
+            continue;
+        }
+
+        if ( entry ) {
+            entry->size = ( size_t ) ( line - entry->begin );
+        }
+
+        if ( !data_bake_manifest_read_path ( input_path, std_path_size_m, line + 6 ) ) {
+            entry = NULL;
+            continue;
+        }
+
+        entry = &manifest->entries_array[manifest->entries_count++];
+        entry->input_hash = std_hash_string_64_m ( input_path );
+        entry->begin = line;
+        entry->is_used = false;
+    }
+
+    if ( entry ) {
+        entry->size = ( size_t ) ( text + buffer.size - entry->begin );
+    }
+
+    std_virtual_heap_free ( input_path );
+}
+
+void data_bake_manifest_unload ( data_bake_manifest_t* manifest ) {
+    if ( manifest->text ) {
+        std_virtual_heap_free ( manifest->text );
+        std_virtual_heap_free ( manifest->entries_array );
+    }
+
+    std_mem_zero_m ( manifest );
+}
+
+data_bake_manifest_entry_t* data_bake_manifest_find ( data_bake_manifest_t* manifest, const char* input_path ) {
+    uint64_t hash = std_hash_string_64_m ( input_path );
+
+    for ( uint32_t i = 0; i < manifest->entries_count; ++i ) {
+        if ( manifest->entries_array[i].input_hash == hash ) {
+            return &manifest->entries_array[i];
+        }
+    }
+
+    return NULL;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Up to date check
+
+static bool data_bake_manifest_check_dependency ( data_bake_dependency_list_t* deps, const char* line, char* path, size_t path_cap ) {
+    const char* str = line + 4;
+    uint64_t content_hash = std_str_to_u64 ( str );
+    str = data_bake_manifest_skip_token ( str );
+    uint64_t size = std_str_to_u64 ( str );
+    str = data_bake_manifest_skip_token ( str );
+    uint64_t write_time = std_str_to_u64 ( str );
+    str = data_bake_manifest_skip_token ( str );
+
+    if ( !data_bake_manifest_read_path ( path, path_cap, str ) ) {
+        return false;
+    }
+
+    std_file_h file = std_file_open ( path, std_file_read_m );
+
+    if ( file == std_file_null_handle_m ) {
+        return false;
+    }
+
+    std_file_info_t info;
+    bool result = std_file_info ( &info, file );
+
+    // Only hash files that were touched since the last bake
+    if ( result && ( info.size != size || info.last_write_time.count != write_time ) ) {
+        void* mapping = info.size > 0 ? std_file_map ( file, info.size, std_file_map_read_m ) : NULL;
+
+        if ( info.size > 0 && mapping == NULL ) {
+            result = false;
+        } else {
+            uint64_t current_hash = data_bake_content_hash ( mapping, info.size );
+            result = current_hash == content_hash;
+
+            if ( mapping ) {
+                std_file_unmap ( file, mapping );
+            }
+        }
+    }
+
+    std_file_close ( file );
+
+    if ( result ) {
+        result = data_bake_dependency_list_add ( deps, path, content_hash, info.size, info.last_write_time.count );
+    }
+
+    return result;
+}
+
+bool data_bake_manifest_entry_is_up_to_date ( data_bake_dependency_list_t* deps, const data_bake_manifest_entry_t* entry, const char* output_path ) {
+    char* path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    const char* end = entry->begin + entry->size;
+    bool has_output = false;
+    bool result = true;
+
+    for ( const char* line = entry->begin; line < end && *line != '\0' && result; line = data_bake_manifest_next_line ( line ) ) {
+        if ( std_str_starts_with ( line, "output " ) ) {
+            std_path_info_t info;
+            has_output = data_bake_manifest_read_path ( path, std_path_size_m, line + 7 )
+                && std_str_cmp ( path, output_path ) == 0
+                && std_path_info ( &info, path ) && ( info.flags & std_path_is_file_m );
+            result = has_output;
+        } else if ( std_str_starts_with ( line, "dep " ) ) {
+            result = data_bake_manifest_check_dependency ( deps, line, path, std_path_size_m );
+        }
+    }
+
+    std_virtual_heap_free ( path );
+    return result && has_output && deps->count > 0;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Writing
+
+void data_bake_manifest_append_header ( std_virtual_stack_t* text, uint32_t options ) {
+    char version[64];
+    data_bake_manifest_version_line ( version, 64, options );
+    std_virtual_stack_string_append ( text, version );
+}
+
+void data_bake_manifest_append_entry ( std_virtual_stack_t* text, const char* input_path, const char* output_path, const data_bake_dependency_list_t* deps ) {
+    std_virtual_stack_string_append ( text, "input " );
+    std_virtual_stack_string_append ( text, input_path );
+    std_virtual_stack_string_append ( text, "\noutput " );
+    std_virtual_stack_string_append ( text, output_path );
+    std_virtual_stack_string_append ( text, "\n" );
+
+    for ( uint32_t i = 0; i < deps->count; ++i ) {
+        const data_bake_dependency_t* dep = &deps->array[i];
+        char numbers[128];
+        std_str_format ( numbers, 128, "dep " std_fmt_u64_m " " std_fmt_u64_m " " std_fmt_u64_m " ", dep->content_hash, dep->size, dep->write_time );
+        std_virtual_stack_string_append ( text, numbers );
+        std_virtual_stack_string_append ( text, dep->path );
+        std_virtual_stack_string_append ( text, "\n" );
+    }
+}
+
+void data_bake_manifest_append_raw_entry ( std_virtual_stack_t* text, const data_bake_manifest_entry_t* entry ) {
+    // The raw entry text is not null terminated, drop the terminator left by the header and put it back after
+    std_virtual_stack_free ( text, 1 );
+    std_virtual_stack_write ( text, entry->begin, entry->size );
+    std_virtual_stack_write ( text, "", 1 );
+}
+
+bool data_bake_manifest_write ( const char* path, const std_virtual_stack_t* text ) {
+    uint64_t size = std_virtual_stack_used_size ( text );
+    // Leave out the terminator
+    return data_bake_write_file ( path, text->begin, size > 0 ? size - 1 : 0 );
+}
+
+bool data_bake_write_file ( const char* path, const void* base, uint64_t size ) {
+    std_buffer_t buffer = std_buffer_m ( .base = ( void* ) base, .size = size );
+    return data_bake_write_file_buffers ( path, &buffer, 1 );
+}
+
+bool data_bake_write_file_buffers ( const char* path, const std_buffer_t* buffers, size_t count ) {
+    char* temp_path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    std_str_format ( temp_path, std_path_size_m, std_fmt_str_m ".tmp", path );
+
+    std_file_h file = std_file_create ( temp_path, std_file_write_m, std_path_already_existing_overwrite_m );
+    bool result = file != std_file_null_handle_m;
+
+    if ( result ) {
+        result = std_file_write_gather ( file, buffers, count, 0 );
+        std_file_close ( file );
+
+        // Move over the old file only once the new one is complete
+        result = result && std_file_path_move ( temp_path, path, std_path_already_existing_overwrite_m );
+
+        if ( !result ) {
+            std_file_path_destroy ( temp_path );
+        }
+    }
+
+    std_virtual_heap_free ( temp_path );
+    return result;
+}
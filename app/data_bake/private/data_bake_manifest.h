@@ -0,0 +1,76 @@
+#pragma once
+
+#include <std_allocator.h>
+
+/*
+    Bake manifest
+
+    Text file stored in the output root. The first line holds the bsf and bake versions and the bake options, a manifest
+    written by a different version or with different options is discarded and everything gets baked again. Each baked
+    input then has an entry:
+        input <path>
+        output <path>
+        dep <content hash> <size> <last write time> <path>
+        ...
+    Deps are all the files the importer opened while baking the input, the input itself included. An input is up to date
+    when its output exists and every dep still has the same content hash. Size and write time are only used to avoid
+    hashing files that weren't touched since the last bake, they never decide on their own that a file changed.
+*/
+
+#define data_bake_version_m 2
+#define data_bake_max_dependencies_m 256
+#define data_bake_manifest_name_m "data_bake.manifest"
+
+typedef struct {
+    uint64_t content_hash;
+    uint64_t size;
+    uint64_t write_time;
+    const char* path;
+} data_bake_dependency_t;
+
+typedef struct {
+    data_bake_dependency_t array[data_bake_max_dependencies_m];
+    uint32_t count;
+    std_virtual_stack_t paths;
+} data_bake_dependency_list_t;
+
+typedef struct {
+    uint64_t input_hash;
+    const char* begin;  // entry text, from its input line up to the next entry
+    size_t size;
+    bool is_used;       // matched by an input in the current run
+} data_bake_manifest_entry_t;
+
+typedef struct {
+    char* text;
+    size_t text_size;
+    data_bake_manifest_entry_t* entries_array;
+    uint32_t entries_count;
+} data_bake_manifest_t;
+
+void data_bake_dependency_list_init ( data_bake_dependency_list_t* list );
+void data_bake_dependency_list_deinit ( data_bake_dependency_list_t* list );
+// Returns false if the list is full. Adding the same path twice is a no-op.
+bool data_bake_dependency_list_add ( data_bake_dependency_list_t* list, const char* path, uint64_t content_hash, uint64_t size, uint64_t write_time );
+
+uint64_t data_bake_content_hash ( const void* base, uint64_t size );
+
+// Missing or outdated manifests result in an empty manifest
+void data_bake_manifest_load ( data_bake_manifest_t* manifest, const char* path, uint32_t options );
+void data_bake_manifest_unload ( data_bake_manifest_t* manifest );
+data_bake_manifest_entry_t* data_bake_manifest_find ( data_bake_manifest_t* manifest, const char* input_path );
+
+// Checks the entry against the current state of its deps and fills the list with their current info.
+// Returns true if the entry output exists and none of the deps content changed.
+bool data_bake_manifest_entry_is_up_to_date ( data_bake_dependency_list_t* deps, const data_bake_manifest_entry_t* entry, const char* output_path );
+
+void data_bake_manifest_append_header ( std_virtual_stack_t* text, uint32_t options );
+void data_bake_manifest_append_entry ( std_virtual_stack_t* text, const char* input_path, const char* output_path, const data_bake_dependency_list_t* deps );
+void data_bake_manifest_append_raw_entry ( std_virtual_stack_t* text, const data_bake_manifest_entry_t* entry );
+// Writes through a temp file, a reader never sees a partially written manifest
+bool data_bake_manifest_write ( const char* path, const std_virtual_stack_t* text );
+
+// Writes to <path>.tmp and moves it over path once complete
+bool data_bake_write_file ( const char* path, const void* base, uint64_t size );
+// Same as above, buffers are written back to back with a single gather write
+bool data_bake_write_file_buffers ( const char* path, const std_buffer_t* buffers, size_t count );
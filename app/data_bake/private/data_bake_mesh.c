@@ -0,0 +1,1088 @@
+#include "data_bake_mesh.h"
+
+#include <std_byte.h>
+#include <std_string.h>
+#include <std_hash.h>
+
+#include <bsf.h>
+
+#include <math.h>
+
+// ------------------------------------------------------------------------------------------------
+// Analysis
+
+data_bake_vertex_cache_stats_t data_bake_analyze_vertex_cache ( const uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size ) {
+    data_bake_vertex_cache_stats_t stats = { 0 };
+    uint32_t triangle_count = index_count / 3;
+
+    if ( triangle_count == 0 || vertex_count == 0 ) {
+        return stats;
+    }
+
+    // Timestamp of the last time each vertex entered the FIFO, a vertex is still cached if less than cache_size
+    // misses happened since then
+    uint32_t* timestamps = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    std_mem_zero ( timestamps, sizeof ( uint32_t ) * vertex_count );
+    uint32_t timestamp = cache_size + 1;
+    uint32_t misses = 0;
+    uint32_t referenced = 0;
+
+    for ( uint32_t i = 0; i < triangle_count * 3; ++i ) {
+        uint32_t v = indices[i];
+        referenced += timestamps[v] == 0 ? 1 : 0;
+
+        if ( timestamp - timestamps[v] > cache_size ) {
+            timestamps[v] = timestamp++;
+            ++misses;
+        }
+    }
+
+    std_virtual_heap_free ( timestamps );
+
+    stats.acmr = ( float ) misses / triangle_count;
+    stats.atvr = ( float ) misses / referenced;
+    return stats;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Vertex cache
+
+static float data_bake_vertex_score ( int32_t cache_position, uint32_t remaining_triangles ) {
+    if ( remaining_triangles == 0 ) {
+        return -1.f;
+    }
+
+    float score = 0;
+
+    if ( cache_position >= 0 ) {
+        if ( cache_position < 3 ) {
+            // Vertices of the last triangle get a fixed score, so that the next triangle doesn't just reuse the same edge
+            score = 0.75f;
+        } else {
+            float scaler = 1.f / ( data_bake_vertex_cache_size_m - 3 );
+            score = powf ( 1.f - ( cache_position - 3 ) * scaler, 1.5f );
+        }
+    }
+
+    // Boost vertices with few triangles left, so that they get completed and leave the working set
+    score += 2.f / sqrtf ( ( float ) remaining_triangles );
+    return score;
+}
+
+void data_bake_optimize_vertex_cache ( uint32_t* dest, const uint32_t* indices, uint32_t index_count, uint32_t vertex_count ) {
+    uint32_t triangle_count = index_count / 3;
+
+    if ( triangle_count == 0 ) {
+        return;
+    }
+
+    // Per vertex list of the triangles that use it and still need to be emitted
+    uint32_t* remaining = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    uint32_t* offsets = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    uint32_t* adjacency = std_virtual_heap_alloc_array_m ( uint32_t, triangle_count * 3 );
+    int32_t* cache_positions = std_virtual_heap_alloc_array_m ( int32_t, vertex_count );
+    float* vertex_scores = std_virtual_heap_alloc_array_m ( float, vertex_count );
+    float* triangle_scores = std_virtual_heap_alloc_array_m ( float, triangle_count );
+    uint8_t* emitted = std_virtual_heap_alloc_array_m ( uint8_t, triangle_count );
+
+    std_mem_zero ( remaining, sizeof ( uint32_t ) * vertex_count );
+    std_mem_zero ( emitted, triangle_count );
+
+    for ( uint32_t i = 0; i < triangle_count * 3; ++i ) {
+        remaining[indices[i]] += 1;
+    }
+
+    uint32_t offset = 0;
+
+    for ( uint32_t v = 0; v < vertex_count; ++v ) {
+        offsets[v] = offset;
+        offset += remaining[v];
+        remaining[v] = 0;
+    }
+
+    for ( uint32_t t = 0; t < triangle_count; ++t ) {
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            uint32_t v = indices[t * 3 + k];
+            adjacency[offsets[v] + remaining[v]++] = t;
+        }
+    }
+
+    for ( uint32_t v = 0; v < vertex_count; ++v ) {
+        cache_positions[v] = -1;
+        vertex_scores[v] = data_bake_vertex_score ( -1, remaining[v] );
+    }
+
+    uint32_t best_triangle = 0;
+    float best_score = -1.f;
+
+    for ( uint32_t t = 0; t < triangle_count; ++t ) {
+        const uint32_t* tri = indices + t * 3;
+        triangle_scores[t] = vertex_scores[tri[0]] + vertex_scores[tri[1]] + vertex_scores[tri[2]];
+
+        if ( triangle_scores[t] > best_score ) {
+            best_score = triangle_scores[t];
+            best_triangle = t;
+        }
+    }
+
+    // The cache temporarily holds up to 3 extra entries, the ones that get pushed out by the newly emitted triangle
+    uint32_t cache[data_bake_vertex_cache_size_m + 3];
+    uint32_t new_cache[data_bake_vertex_cache_size_m + 3];
+    uint32_t cache_count = 0;
+    uint32_t dead_end_cursor = 0;
+
+    for ( uint32_t emit_it = 0; emit_it < triangle_count; ++emit_it ) {
+        // Dead end, no triangle touches the cache. Pick the next one that's still to be emitted in input order
+        if ( best_score < 0 ) {
+            while ( emitted[dead_end_cursor] ) {
+                ++dead_end_cursor;
+            }
+
+            best_triangle = dead_end_cursor;
+        }
+
+        const uint32_t* tri = indices + best_triangle * 3;
+        dest[emit_it * 3 + 0] = tri[0];
+        dest[emit_it * 3 + 1] = tri[1];
+        dest[emit_it * 3 + 2] = tri[2];
+        emitted[best_triangle] = 1;
+
+        // Move the triangle vertices to the front of the cache and drop the triangle from their lists
+        uint32_t new_cache_count = 0;
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            uint32_t v = tri[k];
+            uint32_t* list = adjacency + offsets[v];
+
+            for ( uint32_t i = 0; i < remaining[v]; ++i ) {
+                if ( list[i] == best_triangle ) {
+                    list[i] = list[--remaining[v]];
+                    break;
+                }
+            }
+
+            bool is_duplicate = false;
+
+            for ( uint32_t i = 0; i < new_cache_count; ++i ) {
+                is_duplicate |= new_cache[i] == v;
+            }
+
+            if ( !is_duplicate ) {
+                new_cache[new_cache_count++] = v;
+            }
+        }
+
+        uint32_t front_count = new_cache_count;
+
+        for ( uint32_t i = 0; i < cache_count; ++i ) {
+            uint32_t v = cache[i];
+            bool is_front = false;
+
+            for ( uint32_t j = 0; j < front_count; ++j ) {
+                is_front |= new_cache[j] == v;
+            }
+
+            if ( !is_front ) {
+                new_cache[new_cache_count++] = v;
+            }
+        }
+
+        // Update the scores of the vertices that were in the cache at any point during this step
+        for ( uint32_t i = 0; i < new_cache_count; ++i ) {
+            uint32_t v = new_cache[i];
+            cache_positions[v] = i < data_bake_vertex_cache_size_m ? ( int32_t ) i : -1;
+            vertex_scores[v] = data_bake_vertex_score ( cache_positions[v], remaining[v] );
+        }
+
+        // Find the best triangle among the ones touching the cache
+        best_score = -1.f;
+
+        for ( uint32_t i = 0; i < new_cache_count; ++i ) {
+            uint32_t v = new_cache[i];
+            const uint32_t* list = adjacency + offsets[v];
+
+            for ( uint32_t j = 0; j < remaining[v]; ++j ) {
+                uint32_t t = list[j];
+                const uint32_t* adjacent = indices + t * 3;
+                float score = vertex_scores[adjacent[0]] + vertex_scores[adjacent[1]] + vertex_scores[adjacent[2]];
+                triangle_scores[t] = score;
+
+                if ( score > best_score ) {
+                    best_score = score;
+                    best_triangle = t;
+                }
+            }
+        }
+
+        cache_count = new_cache_count < data_bake_vertex_cache_size_m ? new_cache_count : data_bake_vertex_cache_size_m;
+        std_mem_copy ( cache, new_cache, sizeof ( uint32_t ) * cache_count );
+    }
+
+    std_virtual_heap_free ( remaining );
+    std_virtual_heap_free ( offsets );
+    std_virtual_heap_free ( adjacency );
+    std_virtual_heap_free ( cache_positions );
+    std_virtual_heap_free ( vertex_scores );
+    std_virtual_heap_free ( triangle_scores );
+    std_virtual_heap_free ( emitted );
+}
+
+// ------------------------------------------------------------------------------------------------
+// Vertex fetch
+
+uint32_t data_bake_optimize_vertex_fetch_remap ( uint32_t* remap, const uint32_t* indices, uint32_t index_count, uint32_t vertex_count ) {
+    std_mem_set ( remap, sizeof ( uint32_t ) * vertex_count, ( char ) 0xff );
+    uint32_t next = 0;
+
+    for ( uint32_t i = 0; i < index_count; ++i ) {
+        uint32_t v = indices[i];
+
+        if ( remap[v] == UINT32_MAX ) {
+            remap[v] = next++;
+        }
+    }
+
+    uint32_t referenced = next;
+
+    for ( uint32_t v = 0; v < vertex_count; ++v ) {
+        if ( remap[v] == UINT32_MAX ) {
+            remap[v] = next++;
+        }
+    }
+
+    return referenced;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Meshlets
+
+static void data_bake_meshlet_bounds ( bsf_meshlet_t* meshlet, const uint32_t* vertices, const uint8_t* triangles, const float* pos ) {
+    // Bounding sphere centered on the bounding box
+    float min[3] = { INFINITY, INFINITY, INFINITY };
+    float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    for ( uint32_t i = 0; i < meshlet->vertex_count; ++i ) {
+        const float* p = pos + vertices[i] * 3;
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            min[k] = p[k] < min[k] ? p[k] : min[k];
+            max[k] = p[k] > max[k] ? p[k] : max[k];
+        }
+    }
+
+    float center[3] = { ( min[0] + max[0] ) * 0.5f, ( min[1] + max[1] ) * 0.5f, ( min[2] + max[2] ) * 0.5f };
+    float radius_sq = 0;
+
+    for ( uint32_t i = 0; i < meshlet->vertex_count; ++i ) {
+        const float* p = pos + vertices[i] * 3;
+        float d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+        float dist_sq = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+        radius_sq = dist_sq > radius_sq ? dist_sq : radius_sq;
+    }
+
+    meshlet->center[0] = center[0];
+    meshlet->center[1] = center[1];
+    meshlet->center[2] = center[2];
+    meshlet->radius = sqrtf ( radius_sq );
+
+    // Normal cone, from the average of the triangle normals
+    float normals[bsf_meshlet_max_triangles_m][3];
+    const float* corners[bsf_meshlet_max_triangles_m];
+    uint32_t normal_count = 0;
+    float axis[3] = { 0, 0, 0 };
+
+    for ( uint32_t i = 0; i < meshlet->triangle_count; ++i ) {
+        const float* p0 = pos + vertices[triangles[i * 3 + 0]] * 3;
+        const float* p1 = pos + vertices[triangles[i * 3 + 1]] * 3;
+        const float* p2 = pos + vertices[triangles[i * 3 + 2]] * 3;
+        float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+        float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        float len = sqrtf ( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+        // Degenerate triangles don't contribute
+        if ( len == 0 ) {
+            continue;
+        }
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            normals[normal_count][k] = n[k] / len;
+            axis[k] += n[k] / len;
+        }
+
+        corners[normal_count++] = p0;
+    }
+
+    float axis_len = sqrtf ( axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2] );
+    float min_dot = 1;
+
+    if ( axis_len > 0 ) {
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            axis[k] /= axis_len;
+        }
+
+        for ( uint32_t i = 0; i < normal_count; ++i ) {
+            float dot = normals[i][0] * axis[0] + normals[i][1] * axis[1] + normals[i][2] * axis[2];
+            min_dot = dot < min_dot ? dot : min_dot;
+        }
+    }
+
+    // Cones wider than ~85 degrees on each side don't cull anything in practice
+    if ( normal_count == 0 || axis_len == 0 || min_dot <= 0.1f ) {
+        meshlet->cone_apex[0] = meshlet->cone_apex[1] = meshlet->cone_apex[2] = 0;
+        meshlet->cone_axis[0] = meshlet->cone_axis[1] = meshlet->cone_axis[2] = 0;
+        meshlet->cone_cutoff = 1;
+        return;
+    }
+
+    // Move the apex back along the axis until every triangle plane is in front of it
+    float max_t = 0;
+
+    for ( uint32_t i = 0; i < normal_count; ++i ) {
+        const float* p0 = corners[i];
+        const float* n = normals[i];
+        float dc = ( center[0] - p0[0] ) * n[0] + ( center[1] - p0[1] ) * n[1] + ( center[2] - p0[2] ) * n[2];
+        float dn = axis[0] * n[0] + axis[1] * n[1] + axis[2] * n[2];
+        float t = dc / dn;
+        max_t = t > max_t ? t : max_t;
+    }
+
+    for ( uint32_t k = 0; k < 3; ++k ) {
+        meshlet->cone_apex[k] = center[k] - axis[k] * max_t;
+        meshlet->cone_axis[k] = axis[k];
+    }
+
+    // The normal cone has half angle acos ( min_dot ), the culling cone is the same cone widened by 90 degrees and
+    // flipped, its cosine is sin ( acos ( min_dot ) )
+    meshlet->cone_cutoff = sqrtf ( 1 - min_dot * min_dot );
+}
+
+static uint32_t data_bake_max_meshlets ( uint32_t triangle_count ) {
+    // Every meshlet but the last is closed with at least ( max_vertices - 2 ) / 3 triangles
+    uint32_t min_triangles = ( bsf_meshlet_max_vertices_m - 2 ) / 3;
+    return triangle_count / min_triangles + 1;
+}
+
+std_buffer_t data_bake_build_meshlets ( uint32_t mesh_id, const uint32_t* indices, uint32_t index_count, const float* pos, uint32_t vertex_count ) {
+    uint32_t triangle_count = index_count / 3;
+    uint32_t max_meshlets = data_bake_max_meshlets ( triangle_count );
+
+    bsf_meshlet_t* meshlets = std_virtual_heap_alloc_array_m ( bsf_meshlet_t, max_meshlets );
+    uint32_t* vertices = std_virtual_heap_alloc_array_m ( uint32_t, triangle_count * 3 + 1 );
+    uint8_t* triangles = std_virtual_heap_alloc_array_m ( uint8_t, triangle_count * 3 + 1 );
+    uint8_t* local = std_virtual_heap_alloc_array_m ( uint8_t, vertex_count > 0 ? vertex_count : 1 );
+    std_mem_set ( local, vertex_count, ( char ) 0xff );
+
+    uint32_t meshlet_count = 0;
+    uint32_t vertex_index_count = 0;
+    bsf_meshlet_t* meshlet = &meshlets[0];
+    std_mem_zero_m ( meshlet );
+
+    for ( uint32_t t = 0; t < triangle_count; ++t ) {
+        const uint32_t* tri = indices + t * 3;
+        uint32_t new_vertices = 0;
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            bool is_new = local[tri[k]] == 0xff;
+
+            for ( uint32_t j = 0; j < k; ++j ) {
+                is_new &= tri[j] != tri[k];
+            }
+
+            new_vertices += is_new ? 1 : 0;
+        }
+
+        bool is_full = meshlet->vertex_count + new_vertices > bsf_meshlet_max_vertices_m || meshlet->triangle_count + 1 > bsf_meshlet_max_triangles_m;
+
+        if ( is_full ) {
+            data_bake_meshlet_bounds ( meshlet, vertices + meshlet->vertex_offset, triangles + meshlet->triangle_offset * 3, pos );
+
+            for ( uint32_t i = 0; i < meshlet->vertex_count; ++i ) {
+                local[vertices[meshlet->vertex_offset + i]] = 0xff;
+            }
+
+            vertex_index_count += meshlet->vertex_count;
+            bsf_meshlet_t* next = &meshlets[++meshlet_count];
+            std_mem_zero_m ( next );
+            next->vertex_offset = vertex_index_count;
+            next->triangle_offset = meshlet->triangle_offset + meshlet->triangle_count;
+            meshlet = next;
+        }
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            uint32_t v = tri[k];
+
+            if ( local[v] == 0xff ) {
+                local[v] = ( uint8_t ) meshlet->vertex_count;
+                vertices[meshlet->vertex_offset + meshlet->vertex_count++] = v;
+            }
+
+            triangles[( meshlet->triangle_offset + meshlet->triangle_count ) * 3 + k] = local[v];
+        }
+
+        meshlet->triangle_count += 1;
+    }
+
+    if ( meshlet->triangle_count > 0 ) {
+        data_bake_meshlet_bounds ( meshlet, vertices + meshlet->vertex_offset, triangles + meshlet->triangle_offset * 3, pos );
+        vertex_index_count += meshlet->vertex_count;
+        ++meshlet_count;
+    }
+
+    // Pack everything in the final chunk layout
+    uint64_t size = bsf_meshlets_chunk_size ( meshlet_count, vertex_index_count, triangle_count );
+    char* chunk = std_virtual_heap_alloc_m ( size, bsf_chunk_align_m );
+    std_mem_zero ( chunk, size );
+
+    bsf_meshlets_header_t header = {
+        .mesh_id = mesh_id,
+        .meshlet_count = meshlet_count,
+        .vertex_index_count = vertex_index_count,
+        .triangle_count = triangle_count,
+    };
+    char* dest = chunk;
+    std_mem_copy_m ( dest, &header );
+    dest += sizeof ( header );
+    std_mem_copy_array_m ( dest, meshlets, meshlet_count );
+    dest += sizeof ( bsf_meshlet_t ) * meshlet_count;
+    std_mem_copy_array_m ( dest, vertices, vertex_index_count );
+    dest += sizeof ( uint32_t ) * vertex_index_count;
+    std_mem_copy ( dest, triangles, triangle_count * 3 );
+
+    std_virtual_heap_free ( meshlets );
+    std_virtual_heap_free ( vertices );
+    std_virtual_heap_free ( triangles );
+    std_virtual_heap_free ( local );
+
+    return std_buffer_m ( .base = chunk, .size = size );
+}
+
+// ------------------------------------------------------------------------------------------------
+// Quantization
+
+static uint16_t data_bake_f32_to_f16 ( float f ) {
+    uint32_t x;
+    std_mem_copy ( &x, &f, sizeof ( x ) );
+    uint32_t sign = ( x >> 16 ) & 0x8000;
+    uint32_t abs = x & 0x7fffffff;
+
+    // Inf and nan, keep nans quiet
+    if ( abs >= 0x7f800000 ) {
+        return ( uint16_t ) ( sign | 0x7c00 | ( abs > 0x7f800000 ? 0x200 : 0 ) );
+    }
+
+    // Rounds to 65520 or more, overflows to inf
+    if ( abs >= 0x477ff000 ) {
+        return ( uint16_t ) ( sign | 0x7c00 );
+    }
+
+    // Below the smallest half normal, 2^-14. Denormals are in units of 2^-24
+    if ( abs < 0x38800000 ) {
+        float a;
+        std_mem_copy ( &a, &abs, sizeof ( a ) );
+        return ( uint16_t ) ( sign | ( uint32_t ) nearbyintf ( a * 16777216.f ) );
+    }
+
+    // Round to nearest even on the 13 dropped mantissa bits, then rebias the exponent from 127 to 15. A mantissa
+    // carry correctly bumps the exponent.
+    uint32_t rounded = abs + 0xfff + ( ( abs >> 13 ) & 1 );
+    return ( uint16_t ) ( sign | ( ( rounded - ( 112u << 23 ) ) >> 13 ) );
+}
+
+static float data_bake_f16_to_f32 ( uint16_t h ) {
+    uint32_t sign = ( uint32_t ) ( h & 0x8000 ) << 16;
+    uint32_t exponent = ( h >> 10 ) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t x;
+
+    if ( exponent == 0 ) {
+        float f = ldexpf ( ( float ) mantissa, -24 );
+        return sign ? -f : f;
+    } else if ( exponent == 31 ) {
+        x = sign | 0x7f800000 | ( mantissa << 13 );
+    } else {
+        x = sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+    }
+
+    float f;
+    std_mem_copy ( &f, &x, sizeof ( f ) );
+    return f;
+}
+
+float data_bake_half_max_error ( float max_abs ) {
+    if ( !( max_abs < 65504.f ) ) {
+        return INFINITY;
+    }
+
+    if ( max_abs < 6.103515625e-05f ) {
+        // Denormal range, fixed 2^-24 step
+        return ldexpf ( 1, -25 );
+    }
+
+    // max_abs = m * 2^e with m in [0.5, 1), the step in [2^(e-1), 2^e) is 2^(e-11)
+    int exponent;
+    frexpf ( max_abs, &exponent );
+    return ldexpf ( 1, exponent - 12 );
+}
+
+static int16_t data_bake_f32_to_snorm16 ( float f ) {
+    f = f < -1.f ? -1.f : ( f > 1.f ? 1.f : f );
+    return ( int16_t ) nearbyintf ( f * 32767.f );
+}
+
+static float data_bake_snorm16_to_f32 ( int16_t s ) {
+    float f = s / 32767.f;
+    return f < -1.f ? -1.f : f;
+}
+
+static void data_bake_oct_decode ( float* dir, int16_t x, int16_t y ) {
+    float ex = data_bake_snorm16_to_f32 ( x );
+    float ey = data_bake_snorm16_to_f32 ( y );
+    float v[3] = { ex, ey, 1.f - fabsf ( ex ) - fabsf ( ey ) };
+    float t = v[2] < 0 ? -v[2] : 0;
+    v[0] += v[0] >= 0 ? -t : t;
+    v[1] += v[1] >= 0 ? -t : t;
+    float len = sqrtf ( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+    dir[0] = v[0] / len;
+    dir[1] = v[1] / len;
+    dir[2] = v[2] / len;
+}
+
+// Returns the cosine of the angle between the source and the decoded direction
+static float data_bake_oct_encode ( int16_t* dest, const float* dir ) {
+    float l1 = fabsf ( dir[0] ) + fabsf ( dir[1] ) + fabsf ( dir[2] );
+
+    if ( l1 == 0 ) {
+        dest[0] = 0;
+        dest[1] = 0;
+        return 1;
+    }
+
+    float x = dir[0] / l1;
+    float y = dir[1] / l1;
+
+    if ( dir[2] < 0 ) {
+        float fx = ( 1.f - fabsf ( y ) ) * ( x >= 0 ? 1.f : -1.f );
+        float fy = ( 1.f - fabsf ( x ) ) * ( y >= 0 ? 1.f : -1.f );
+        x = fx;
+        y = fy;
+    }
+
+    // Rounding each component independently isn't always the closest decoded direction, try the 4 candidates
+    // around the exact encoding and keep the best one
+    float len = sqrtf ( dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2] );
+    float best_cos = -2;
+    float fx = floorf ( x * 32767.f );
+    float fy = floorf ( y * 32767.f );
+
+    for ( uint32_t i = 0; i < 4; ++i ) {
+        float cx = fx + ( i & 1 );
+        float cy = fy + ( i >> 1 );
+        int16_t ex = ( int16_t ) ( cx < -32767.f ? -32767.f : ( cx > 32767.f ? 32767.f : cx ) );
+        int16_t ey = ( int16_t ) ( cy < -32767.f ? -32767.f : ( cy > 32767.f ? 32767.f : cy ) );
+
+        float decoded[3];
+        data_bake_oct_decode ( decoded, ex, ey );
+        float cos_angle = ( decoded[0] * dir[0] + decoded[1] * dir[1] + decoded[2] * dir[2] ) / len;
+
+        if ( cos_angle > best_cos ) {
+            best_cos = cos_angle;
+            dest[0] = ex;
+            dest[1] = ey;
+        }
+    }
+
+    return best_cos;
+}
+
+static float data_bake_angle_degrees ( float cos_angle ) {
+    cos_angle = cos_angle > 1.f ? 1.f : ( cos_angle < -1.f ? -1.f : cos_angle );
+    return acosf ( cos_angle ) * ( 180.f / 3.14159265f );
+}
+
+data_bake_quantization_error_t data_bake_pack_vertices ( void* dest, float pos_offset[3], float* pos_scale, const float* pos, const float* nor, const float* tan, const float* bitan, const float* uv, uint32_t vertex_count ) {
+    data_bake_quantization_error_t error = { 0 };
+    int16_t* packed_pos = ( int16_t* ) dest;
+    int16_t* packed_nor = packed_pos + ( uint64_t ) vertex_count * 4;
+    int16_t* packed_tan = packed_nor + ( uint64_t ) vertex_count * 2;
+    uint16_t* packed_uv = ( uint16_t* ) ( packed_tan + ( uint64_t ) vertex_count * 2 );
+
+    // Bounds
+    float min[3] = { INFINITY, INFINITY, INFINITY };
+    float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    for ( uint32_t i = 0; i < vertex_count; ++i ) {
+        for ( uint32_t j = 0; j < 3; ++j ) {
+            min[j] = fminf ( min[j], pos[i * 3 + j] );
+            max[j] = fmaxf ( max[j], pos[i * 3 + j] );
+        }
+    }
+
+    float scale = 0;
+    float diagonal = 0;
+
+    for ( uint32_t j = 0; j < 3; ++j ) {
+        pos_offset[j] = vertex_count > 0 ? ( min[j] + max[j] ) * 0.5f : 0;
+        float half_extent = vertex_count > 0 ? ( max[j] - min[j] ) * 0.5f : 0;
+        scale = fmaxf ( scale, half_extent );
+        diagonal += half_extent * half_extent * 4;
+    }
+
+    scale = scale > 0 ? scale : 1;
+    diagonal = diagonal > 0 ? sqrtf ( diagonal ) : 1;
+    *pos_scale = scale;
+
+    for ( uint32_t i = 0; i < vertex_count; ++i ) {
+        // pos
+        const float* p = pos + i * 3;
+        float distance = 0;
+
+        for ( uint32_t j = 0; j < 3; ++j ) {
+            packed_pos[i * 4 + j] = data_bake_f32_to_snorm16 ( ( p[j] - pos_offset[j] ) / scale );
+            float d = pos_offset[j] + data_bake_snorm16_to_f32 ( packed_pos[i * 4 + j] ) * scale - p[j];
+            distance += d * d;
+        }
+
+        error.pos = fmaxf ( error.pos, sqrtf ( distance ) / diagonal );
+
+        // nor, tan
+        float n[3] = { 0, 0, 0 };
+        float t[3] = { 0, 0, 0 };
+
+        if ( nor ) {
+            std_mem_copy ( n, nor + i * 3, sizeof ( n ) );
+            error.nor = fmaxf ( error.nor, data_bake_angle_degrees ( data_bake_oct_encode ( packed_nor + i * 2, n ) ) );
+        } else {
+            data_bake_oct_encode ( packed_nor + i * 2, n );
+        }
+
+        if ( tan ) {
+            std_mem_copy ( t, tan + i * 3, sizeof ( t ) );
+            error.tan = fmaxf ( error.tan, data_bake_angle_degrees ( data_bake_oct_encode ( packed_tan + i * 2, t ) ) );
+        } else {
+            data_bake_oct_encode ( packed_tan + i * 2, t );
+        }
+
+        // bitangent sign, relative to cross ( nor, tan )
+        float sign = 1;
+
+        if ( bitan ) {
+            const float* b = bitan + i * 3;
+            float c[3] = {
+                n[1] * t[2] - n[2] * t[1],
+                n[2] * t[0] - n[0] * t[2],
+                n[0] * t[1] - n[1] * t[0],
+            };
+            sign = c[0] * b[0] + c[1] * b[1] + c[2] * b[2] < 0 ? -1.f : 1.f;
+        }
+
+        packed_pos[i * 4 + 3] = data_bake_f32_to_snorm16 ( sign );
+
+        // uv
+        for ( uint32_t j = 0; j < 2; ++j ) {
+            float u = uv ? uv[i * 2 + j] : 0;
+            packed_uv[i * 2 + j] = data_bake_f32_to_f16 ( u );
+            error.uv = fmaxf ( error.uv, fabsf ( data_bake_f16_to_f32 ( packed_uv[i * 2 + j] ) - u ) );
+        }
+    }
+
+    return error;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Simplification
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangles the planes come from.
+// Upper triangle of the symmetric 4x4 plane matrix.
+typedef struct {
+    double a2, ab, ac, ad;
+    double b2, bc, bd;
+    double c2, cd;
+    double d2;
+    double weight;
+} data_bake_quadric_t;
+
+static void data_bake_quadric_add_triangle ( data_bake_quadric_t* q, const float* p0, const float* p1, const float* p2 ) {
+    double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    double n[3] = {
+        e1[1] * e2[2] - e1[2] * e2[1],
+        e1[2] * e2[0] - e1[0] * e2[2],
+        e1[0] * e2[1] - e1[1] * e2[0],
+    };
+    double len = sqrt ( n[0] * n[0] + n[1] * n[1] + n[2] * n[2] );
+
+    if ( len == 0 ) {
+        return;
+    }
+
+    double a = n[0] / len;
+    double b = n[1] / len;
+    double c = n[2] / len;
+    double d = - ( a * p0[0] + b * p0[1] + c * p0[2] );
+    double w = len * 0.5;
+
+    q->a2 += w * a * a; q->ab += w * a * b; q->ac += w * a * c; q->ad += w * a * d;
+    q->b2 += w * b * b; q->bc += w * b * c; q->bd += w * b * d;
+    q->c2 += w * c * c; q->cd += w * c * d;
+    q->d2 += w * d * d;
+    q->weight += w;
+}
+
+static void data_bake_quadric_add ( data_bake_quadric_t* q, const data_bake_quadric_t* other ) {
+    q->a2 += other->a2; q->ab += other->ab; q->ac += other->ac; q->ad += other->ad;
+    q->b2 += other->b2; q->bc += other->bc; q->bd += other->bd;
+    q->c2 += other->c2; q->cd += other->cd;
+    q->d2 += other->d2;
+    q->weight += other->weight;
+}
+
+// Area weighted mean squared distance from p to the quadric planes
+static double data_bake_quadric_error ( const data_bake_quadric_t* q, const float* p ) {
+    if ( q->weight == 0 ) {
+        return 0;
+    }
+
+    double x = p[0];
+    double y = p[1];
+    double z = p[2];
+    double e = q->a2 * x * x + 2 * q->ab * x * y + 2 * q->ac * x * z + 2 * q->ad * x
+        + q->b2 * y * y + 2 * q->bc * y * z + 2 * q->bd * y
+        + q->c2 * z * z + 2 * q->cd * z
+        + q->d2;
+    return fabs ( e ) / q->weight;
+}
+
+static void data_bake_triangle_normal ( double* n, const float* p0, const float* p1, const float* p2 ) {
+    double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// True if moving a onto b flips or collapses any of the triangles around a that don't also contain b
+static bool data_bake_collapse_flips ( const uint32_t* indices, const uint32_t* triangles, uint32_t triangle_count, const uint32_t* canonical, const float* pos, uint32_t a, uint32_t b ) {
+    for ( uint32_t i = 0; i < triangle_count; ++i ) {
+        const uint32_t* tri = indices + triangles[i] * 3;
+        uint32_t c0 = canonical[tri[0]];
+        uint32_t c1 = canonical[tri[1]];
+        uint32_t c2 = canonical[tri[2]];
+
+        if ( c0 == b || c1 == b || c2 == b ) {
+            continue;
+        }
+
+        const float* p[3] = { pos + c0 * 3, pos + c1 * 3, pos + c2 * 3 };
+        double before[3];
+        data_bake_triangle_normal ( before, p[0], p[1], p[2] );
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            p[k] = canonical[tri[k]] == a ? pos + b * 3 : p[k];
+        }
+
+        double after[3];
+        data_bake_triangle_normal ( after, p[0], p[1], p[2] );
+
+        double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+        double before_len = sqrt ( before[0] * before[0] + before[1] * before[1] + before[2] * before[2] );
+        double after_len = sqrt ( after[0] * after[0] + after[1] * after[1] + after[2] * after[2] );
+
+        if ( dot <= 0.25 * before_len * after_len ) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static uint64_t data_bake_edge_hash ( uint32_t a, uint32_t b ) {
+    return std_hash_64_m ( ( ( uint64_t ) a << 32 ) | b );
+}
+
+// Bucket of a non negative cost, monotonic in the cost
+static uint32_t data_bake_cost_bucket ( float cost ) {
+    uint32_t bits;
+    std_mem_copy ( &bits, &cost, sizeof ( bits ) );
+    return bits >> ( 32 - data_bake_simplify_cost_buckets_bits_m );
+}
+
+uint32_t data_bake_simplify ( uint32_t* dest, const uint32_t* indices, uint32_t index_count, const float* pos, uint32_t vertex_count, uint32_t target_index_count, float target_error, float* result_error ) {
+    std_mem_copy ( dest, indices, sizeof ( uint32_t ) * index_count );
+    *result_error = 0;
+
+    if ( index_count == 0 || vertex_count == 0 ) {
+        return index_count;
+    }
+
+    // Vertices that share a position are merged into their first occurrence, seams are only visible at this level
+    uint32_t* canonical = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    uint32_t* position_count = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    std_mem_zero ( position_count, sizeof ( uint32_t ) * vertex_count );
+
+    {
+        size_t capacity = std_pow2_round_up ( ( size_t ) vertex_count * 2 );
+        std_hash_map_t map = std_hash_map_create ( capacity );
+
+        for ( uint32_t v = 0; v < vertex_count; ++v ) {
+            uint64_t hash = std_hash_64_m ( std_hash_block_64_m ( pos + v * 3, sizeof ( float ) * 3 ) );
+            bool is_new = false;
+            uint64_t* payload = std_hash_map_lookup_insert ( &map, hash, &is_new );
+
+            if ( is_new ) {
+                *payload = v;
+            }
+
+            // A hash collision between different positions keeps the vertex on its own
+            uint32_t first = ( uint32_t ) *payload;
+            bool is_same = pos[first * 3 + 0] == pos[v * 3 + 0] && pos[first * 3 + 1] == pos[v * 3 + 1] && pos[first * 3 + 2] == pos[v * 3 + 2];
+            canonical[v] = is_same ? first : v;
+            position_count[canonical[v]] += 1;
+        }
+
+        std_hash_map_destroy ( &map );
+    }
+
+    // Vertices on seams and on open borders are locked, everything else can collapse onto a neighbour
+    bool* is_locked = std_virtual_heap_alloc_array_m ( bool, vertex_count );
+
+    for ( uint32_t v = 0; v < vertex_count; ++v ) {
+        is_locked[v] = position_count[canonical[v]] > 1;
+    }
+
+    {
+        size_t capacity = std_pow2_round_up ( ( size_t ) index_count * 2 );
+        uint64_t* hashes = std_virtual_heap_alloc_array_m ( uint64_t, capacity );
+        std_hash_set_t edges = std_hash_set ( hashes, capacity );
+
+        for ( uint32_t i = 0; i < index_count; ++i ) {
+            uint32_t a = canonical[dest[i]];
+            uint32_t b = canonical[dest[i - i % 3 + ( i + 1 ) % 3]];
+            std_hash_set_insert ( &edges, data_bake_edge_hash ( a, b ) );
+        }
+
+        for ( uint32_t i = 0; i < index_count; ++i ) {
+            uint32_t a = canonical[dest[i]];
+            uint32_t b = canonical[dest[i - i % 3 + ( i + 1 ) % 3]];
+
+            if ( a != b && !std_hash_set_lookup ( &edges, data_bake_edge_hash ( b, a ) ) ) {
+                is_locked[a] = true;
+                is_locked[b] = true;
+            }
+        }
+
+        std_virtual_heap_free ( hashes );
+    }
+
+    for ( uint32_t v = 0; v < vertex_count; ++v ) {
+        is_locked[v] = is_locked[canonical[v]];
+    }
+
+    data_bake_quadric_t* quadrics = std_virtual_heap_alloc_array_m ( data_bake_quadric_t, vertex_count );
+    std_mem_zero ( quadrics, sizeof ( data_bake_quadric_t ) * vertex_count );
+
+    for ( uint32_t i = 0; i < index_count; i += 3 ) {
+        const uint32_t c[3] = { canonical[dest[i + 0]], canonical[dest[i + 1]], canonical[dest[i + 2]] };
+        data_bake_quadric_t q;
+        std_mem_zero_m ( &q );
+        data_bake_quadric_add_triangle ( &q, pos + c[0] * 3, pos + c[1] * 3, pos + c[2] * 3 );
+
+        for ( uint32_t k = 0; k < 3; ++k ) {
+            data_bake_quadric_add ( &quadrics[c[k]], &q );
+        }
+    }
+
+    uint32_t* offsets = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count + 1 );
+    uint32_t* adjacency = std_virtual_heap_alloc_array_m ( uint32_t, index_count );
+    uint32_t* targets = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    float* costs = std_virtual_heap_alloc_array_m ( float, vertex_count );
+    uint32_t* order = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    uint32_t* bucket_offsets = std_virtual_heap_alloc_array_m ( uint32_t, ( 1u << data_bake_simplify_cost_buckets_bits_m ) + 1 );
+    uint32_t* collapses = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count );
+    bool* is_touched = std_virtual_heap_alloc_array_m ( bool, vertex_count );
+    double max_cost = ( double ) target_error * target_error;
+    double result_cost = 0;
+
+    while ( index_count > target_index_count ) {
+        // Triangles around each canonical vertex
+        std_mem_zero ( offsets, sizeof ( uint32_t ) * ( vertex_count + 1 ) );
+
+        for ( uint32_t i = 0; i < index_count; ++i ) {
+            offsets[canonical[dest[i]] + 1] += 1;
+        }
+
+        for ( uint32_t v = 0; v < vertex_count; ++v ) {
+            offsets[v + 1] += offsets[v];
+        }
+
+        for ( uint32_t i = 0; i < index_count; ++i ) {
+            uint32_t c = canonical[dest[i]];
+            adjacency[offsets[c]++] = i / 3;
+        }
+
+        for ( uint32_t v = vertex_count; v > 0; --v ) {
+            offsets[v] = offsets[v - 1];
+        }
+
+        offsets[0] = 0;
+
+        // Cheapest collapse of each unlocked vertex onto one of its neighbours, moving a to b costs Qa ( pb )
+        uint32_t candidate_count = 0;
+
+        for ( uint32_t v = 0; v < vertex_count; ++v ) {
+            targets[v] = UINT32_MAX;
+
+            if ( is_locked[v] || canonical[v] != v ) {
+                continue;
+            }
+
+            double best = INFINITY;
+
+            for ( uint32_t i = offsets[v]; i < offsets[v + 1]; ++i ) {
+                const uint32_t* tri = dest + adjacency[i] * 3;
+
+                for ( uint32_t k = 0; k < 3; ++k ) {
+                    uint32_t b = tri[k];
+
+                    if ( canonical[b] == v ) {
+                        continue;
+                    }
+
+                    double cost = data_bake_quadric_error ( &quadrics[v], pos + b * 3 );
+
+                    if ( cost < best ) {
+                        best = cost;
+                        targets[v] = b;
+                    }
+                }
+            }
+
+            if ( targets[v] != UINT32_MAX && best <= max_cost ) {
+                costs[v] = ( float ) best;
+                ++candidate_count;
+            } else {
+                targets[v] = UINT32_MAX;
+            }
+        }
+
+        if ( candidate_count == 0 ) {
+            break;
+        }
+
+        // Approximate ascending cost order, bucketed on the top bits of the float cost
+        uint32_t bucket_count = 1u << data_bake_simplify_cost_buckets_bits_m;
+        std_mem_zero ( bucket_offsets, sizeof ( uint32_t ) * ( bucket_count + 1 ) );
+
+        for ( uint32_t v = 0; v < vertex_count; ++v ) {
+            if ( targets[v] != UINT32_MAX ) {
+                bucket_offsets[data_bake_cost_bucket ( costs[v] ) + 1] += 1;
+            }
+        }
+
+        for ( uint32_t i = 0; i < bucket_count; ++i ) {
+            bucket_offsets[i + 1] += bucket_offsets[i];
+        }
+
+        for ( uint32_t v = 0; v < vertex_count; ++v ) {
+            if ( targets[v] != UINT32_MAX ) {
+                order[bucket_offsets[data_bake_cost_bucket ( costs[v] )]++] = v;
+            }
+        }
+
+        // Greedily collapse the cheapest half of the candidates. A vertex touched by a collapse doesn't take part in
+        // any other collapse in the same pass, so the flip test and the costs stay valid.
+        for ( uint32_t v = 0; v < vertex_count; ++v ) {
+            collapses[v] = v;
+            is_touched[v] = false;
+        }
+
+        uint32_t pass_limit = ( candidate_count + 1 ) / 2;
+        uint32_t removed_count = 0;
+        uint32_t collapse_count = 0;
+
+        for ( uint32_t i = 0; i < pass_limit && index_count - removed_count * 3 > target_index_count; ++i ) {
+            uint32_t a = order[i];
+            uint32_t b = targets[a];
+
+            if ( is_touched[a] || is_touched[canonical[b]] ) {
+                continue;
+            }
+
+            const uint32_t* triangles = adjacency + offsets[a];
+            uint32_t triangle_count = offsets[a + 1] - offsets[a];
+            bool is_touching = false;
+
+            for ( uint32_t j = 0; j < triangle_count; ++j ) {
+                const uint32_t* tri = dest + triangles[j] * 3;
+
+                for ( uint32_t k = 0; k < 3; ++k ) {
+                    is_touching |= is_touched[canonical[tri[k]]];
+                }
+            }
+
+            if ( is_touching || data_bake_collapse_flips ( dest, triangles, triangle_count, canonical, pos, a, canonical[b] ) ) {
+                continue;
+            }
+
+            for ( uint32_t j = 0; j < triangle_count; ++j ) {
+                const uint32_t* tri = dest + triangles[j] * 3;
+
+                for ( uint32_t k = 0; k < 3; ++k ) {
+                    uint32_t c = canonical[tri[k]];
+                    is_touched[c] = true;
+                    removed_count += c == canonical[b] ? 1 : 0;
+                }
+            }
+
+            collapses[a] = b;
+            data_bake_quadric_add ( &quadrics[canonical[b]], &quadrics[a] );
+            result_cost = costs[a] > result_cost ? costs[a] : result_cost;
+            ++collapse_count;
+        }
+
+        if ( collapse_count == 0 ) {
+            break;
+        }
+
+        // Apply the collapses and drop the triangles that became degenerate
+        uint32_t write = 0;
+
+        for ( uint32_t i = 0; i < index_count; i += 3 ) {
+            uint32_t tri[3];
+
+            for ( uint32_t k = 0; k < 3; ++k ) {
+                uint32_t v = dest[i + k];
+                tri[k] = canonical[v] == v ? collapses[v] : v;
+            }
+
+            uint32_t c0 = canonical[tri[0]];
+            uint32_t c1 = canonical[tri[1]];
+            uint32_t c2 = canonical[tri[2]];
+
+            if ( c0 != c1 && c1 != c2 && c0 != c2 ) {
+                dest[write++] = tri[0];
+                dest[write++] = tri[1];
+                dest[write++] = tri[2];
+            }
+        }
+
+        index_count = write;
+    }
+
+    *result_error = ( float ) sqrt ( result_cost );
+
+    std_virtual_heap_free ( canonical );
+    std_virtual_heap_free ( position_count );
+    std_virtual_heap_free ( is_locked );
+    std_virtual_heap_free ( quadrics );
+    std_virtual_heap_free ( offsets );
+    std_virtual_heap_free ( adjacency );
+    std_virtual_heap_free ( targets );
+    std_virtual_heap_free ( costs );
+    std_virtual_heap_free ( order );
+    std_virtual_heap_free ( bucket_offsets );
+    std_virtual_heap_free ( collapses );
+    std_virtual_heap_free ( is_touched );
+
+    return index_count;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <std_allocator.h>
+
+/*
+    Mesh processing
+
+    Triangles are first reordered for post transform cache reuse following Tom Forsyth's linear-speed vertex cache
+    optimisation, simulating an LRU cache of data_bake_vertex_cache_size_m entries. Vertices are then reordered in the
+    order the new index buffer first references them, so that vertex fetches walk the streams mostly linearly.
+    Unreferenced vertices are kept, moved to the end of the streams.
+
+    The packed vertex layout (see bsf.h) quantizes positions to 16 bit snorm relative to the mesh bounds, normals and
+    tangents to 16 bit octahedral snorm and uvs to half floats. Packing measures the error of every stream against
+    the source data. Positions use a uniform scale over the largest bounds extent, so their error only depends on the
+    mesh size, uv error grows with the uv magnitude and meshes with uvs too large for half precision are left in f32.
+
+    LODs are simplified with quadric error edge collapse (Garland-Heckbert), restricted to half edge collapses so that
+    every LOD indexes the same vertex streams. Vertices on open borders and on attribute seams (several vertices sharing
+    a position) are locked. Each pass picks the cheapest collapse of every free vertex, then applies them greedily in
+    ascending cost order, skipping collapses that touch a vertex already moved in the same pass or that would flip a
+    triangle. Simplification stops at the target index count or once the cheapest collapse goes over the target error.
+    The error is the square root of the area weighted mean squared distance to the planes of the source triangles
+    merged into a vertex, in model units.
+
+    Meshlets are built greedily over the optimised index order, closing a meshlet as soon as the next triangle doesn't
+    fit in bsf_meshlet_max_vertices_m vertices or bsf_meshlet_max_triangles_m triangles.
+*/
+
+#define data_bake_vertex_cache_size_m 32
+// FIFO cache size used when reporting ACMR/ATVR, matches a typical hardware post transform cache
+#define data_bake_vertex_cache_analysis_size_m 16
+
+typedef struct {
+    float acmr; // average cache miss ratio, transformed vertices per triangle. 0.5 is optimal for large regular grids, 3 is the worst case
+    float atvr; // average transformed vertex ratio, transformed vertices per referenced vertex. 1 is optimal
+} data_bake_vertex_cache_stats_t;
+
+// Max allowed errors of the packed layout, a mesh over any of these is reported when baked
+#define data_bake_max_pos_error_m 1e-4f             // relative to the bounds diagonal
+#define data_bake_max_direction_error_m 0.1f        // degrees
+#define data_bake_max_uv_error_m ( 1.f / 2048 )     // half a texel on a 1k texture
+
+typedef struct {
+    float pos;      // max distance from the source position, relative to the bounds diagonal
+    float nor;      // max angle from the source normal, degrees
+    float tan;      // max angle from the source tangent, degrees
+    float uv;       // max uv component difference
+} data_bake_quantization_error_t;
+
+data_bake_vertex_cache_stats_t data_bake_analyze_vertex_cache ( const uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size );
+
+// dest and indices can't overlap
+void data_bake_optimize_vertex_cache ( uint32_t* dest, const uint32_t* indices, uint32_t index_count, uint32_t vertex_count );
+// Fills remap with the new position of each vertex, returns the number of referenced vertices
+uint32_t data_bake_optimize_vertex_fetch_remap ( uint32_t* remap, const uint32_t* indices, uint32_t index_count, uint32_t vertex_count );
+
+// Largest rounding error of a half float conversion over [-max_abs, max_abs]
+float data_bake_half_max_error ( float max_abs );
+// Fills the bsf packed streams from the f32 ones. pos_offset and pos_scale receive the dequantization parameters.
+// The f32 streams follow the bsf f32 layout, any of nor, tan, bitan and uv can be null.
+data_bake_quantization_error_t data_bake_pack_vertices ( void* dest, float pos_offset[3], float* pos_scale, const float* pos, const float* nor, const float* tan, const float* bitan, const float* uv, uint32_t vertex_count );
+
+// Number of top float bits used to order collapses by cost
+#define data_bake_simplify_cost_buckets_bits_m 12
+
+// dest and indices can't overlap, dest needs room for index_count indices. Returns the simplified index count and
+// writes the largest error among the applied collapses to result_error.
+uint32_t data_bake_simplify ( uint32_t* dest, const uint32_t* indices, uint32_t index_count, const float* pos, uint32_t vertex_count, uint32_t target_index_count, float target_error, float* result_error );
+
+// Returns a heap allocated bsf meshlets chunk, the caller is responsible for freeing it
+std_buffer_t data_bake_build_meshlets ( uint32_t mesh_id, const uint32_t* indices, uint32_t index_count, const float* pos, uint32_t vertex_count );
@@ -0,0 +1,632 @@
+#include "data_bake_texture.h"
+
+#include <std_allocator.h>
+#include <std_byte.h>
+#include <std_string.h>
+
+#include <bsf.h>
+
+#include <math.h>
+// SSE2 is part of the x64 baseline, and x86/x64 are the only cpus std builds for
+#include <emmintrin.h>
+
+static void* data_bake_stbi_realloc ( void* p, size_t old_size, size_t new_size ) {
+    void* new = std_virtual_heap_alloc_m ( new_size, 16 );
+    std_mem_copy ( new, p, old_size < new_size ? old_size : new_size );
+    std_virtual_heap_free ( p );
+    return new;
+}
+
+#define STBI_MALLOC(sz) std_virtual_heap_alloc_m ( sz, 16 )
+#define STBI_FREE(p) std_virtual_heap_free ( p )
+#define STBI_REALLOC_SIZED(p,oldsz,newsz) data_bake_stbi_realloc ( p, oldsz, newsz )
+#define STBI_NO_STDIO
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// ------------------------------------------------------------------------------------------------
+// Images
+
+bool data_bake_image_info ( uint32_t* width, uint32_t* height, uint32_t* channels, const void* data, uint64_t size ) {
+    int x, y, n;
+
+    if ( size > INT32_MAX || !stbi_info_from_memory ( ( const stbi_uc* ) data, ( int ) size, &x, &y, &n ) ) {
+        return false;
+    }
+
+    *width = ( uint32_t ) x;
+    *height = ( uint32_t ) y;
+    *channels = ( uint32_t ) n;
+    return true;
+}
+
+bool data_bake_image_decode ( data_bake_image_t* image, const void* data, uint64_t size ) {
+    int x, y;
+    stbi_uc* rgba = size <= INT32_MAX ? stbi_load_from_memory ( ( const stbi_uc* ) data, ( int ) size, &x, &y, NULL, 4 ) : NULL;
+
+    if ( rgba == NULL ) {
+        std_mem_zero_m ( image );
+        return false;
+    }
+
+    image->rgba = rgba;
+    image->width = ( uint32_t ) x;
+    image->height = ( uint32_t ) y;
+    return true;
+}
+
+void data_bake_image_free ( data_bake_image_t* image ) {
+    if ( image->rgba ) {
+        std_virtual_heap_free ( image->rgba );
+    }
+
+    std_mem_zero_m ( image );
+}
+
+uint32_t data_bake_image_mip_count ( uint32_t width, uint32_t height ) {
+    return 32 - std_bit_scan_rev_32 ( std_max_u32 ( width, height ) );
+}
+
+void data_bake_image_downsample ( data_bake_image_t* dest, const data_bake_image_t* source, bool is_normal_map ) {
+    uint32_t width = std_max_u32 ( source->width / 2, 1 );
+    uint32_t height = std_max_u32 ( source->height / 2, 1 );
+    dest->rgba = std_virtual_heap_alloc_array_m ( uint8_t, ( uint64_t ) width * height * 4 );
+    dest->width = width;
+    dest->height = height;
+
+    for ( uint32_t y = 0; y < height; ++y ) {
+        uint32_t sy[2] = { std_min_u32 ( y * 2, source->height - 1 ), std_min_u32 ( y * 2 + 1, source->height - 1 ) };
+
+        for ( uint32_t x = 0; x < width; ++x ) {
+            uint32_t sx[2] = { std_min_u32 ( x * 2, source->width - 1 ), std_min_u32 ( x * 2 + 1, source->width - 1 ) };
+            uint8_t* texel = dest->rgba + ( ( uint64_t ) y * width + x ) * 4;
+            uint32_t sum[4] = { 0, 0, 0, 0 };
+            float normal[3] = { 0, 0, 0 };
+
+            for ( uint32_t i = 0; i < 4; ++i ) {
+                const uint8_t* s = source->rgba + ( ( uint64_t ) sy[i / 2] * source->width + sx[i % 2] ) * 4;
+
+                for ( uint32_t c = 0; c < 4; ++c ) {
+                    sum[c] += s[c];
+                }
+
+                for ( uint32_t c = 0; c < 3; ++c ) {
+                    normal[c] += s[c] * ( 2.f / 255 ) - 1;
+                }
+            }
+
+            for ( uint32_t c = 0; c < 4; ++c ) {
+                texel[c] = ( uint8_t ) ( ( sum[c] + 2 ) / 4 );
+            }
+
+            if ( is_normal_map ) {
+                float len = sqrtf ( normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2] );
+
+                // Opposite normals cancel out, keep the plain average in that case
+                if ( len > 1e-6f ) {
+                    for ( uint32_t c = 0; c < 3; ++c ) {
+                        texel[c] = ( uint8_t ) lrintf ( ( normal[c] / len * 0.5f + 0.5f ) * 255 );
+                    }
+                }
+            }
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Blocks
+
+// 4x4 texels, channel major
+typedef struct {
+    float c[4][16];
+} data_bake_block_t;
+
+static void data_bake_block_load ( data_bake_block_t* block, const data_bake_image_t* image, uint32_t block_x, uint32_t block_y ) {
+    for ( uint32_t y = 0; y < 4; ++y ) {
+        uint32_t sy = std_min_u32 ( block_y * 4 + y, image->height - 1 );
+
+        for ( uint32_t x = 0; x < 4; ++x ) {
+            uint32_t sx = std_min_u32 ( block_x * 4 + x, image->width - 1 );
+            const uint8_t* texel = image->rgba + ( ( uint64_t ) sy * image->width + sx ) * 4;
+
+            for ( uint32_t c = 0; c < 4; ++c ) {
+                block->c[c][y * 4 + x] = texel[c];
+            }
+        }
+    }
+}
+
+// Picks the closest palette entry for every texel, returns the summed squared error
+static float data_bake_block_fit ( uint8_t* indices, const data_bake_block_t* block, const float ( *palette )[4], uint32_t palette_count, uint32_t channel_count ) {
+    __m128 total = _mm_setzero_ps();
+
+    for ( uint32_t i = 0; i < 16; i += 4 ) {
+        __m128 texels[4];
+
+        for ( uint32_t c = 0; c < channel_count; ++c ) {
+            texels[c] = _mm_loadu_ps ( &block->c[c][i] );
+        }
+
+        __m128 best_error = _mm_set1_ps ( FLT_MAX );
+        __m128i best_index = _mm_setzero_si128();
+
+        for ( uint32_t p = 0; p < palette_count; ++p ) {
+            __m128 error = _mm_setzero_ps();
+
+            for ( uint32_t c = 0; c < channel_count; ++c ) {
+                __m128 d = _mm_sub_ps ( texels[c], _mm_set1_ps ( palette[p][c] ) );
+                error = _mm_add_ps ( error, _mm_mul_ps ( d, d ) );
+            }
+
+            // Ties keep the lower index
+            __m128i is_better = _mm_castps_si128 ( _mm_cmplt_ps ( error, best_error ) );
+            best_index = _mm_or_si128 ( _mm_and_si128 ( is_better, _mm_set1_epi32 ( ( int ) p ) ), _mm_andnot_si128 ( is_better, best_index ) );
+            best_error = _mm_min_ps ( error, best_error );
+        }
+
+        total = _mm_add_ps ( total, best_error );
+        int32_t lanes[4];
+        _mm_storeu_si128 ( ( __m128i* ) lanes, best_index );
+
+        for ( uint32_t j = 0; j < 4; ++j ) {
+            indices[i + j] = ( uint8_t ) lanes[j];
+        }
+    }
+
+    float sums[4];
+    _mm_storeu_ps ( sums, total );
+    return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+// Extremes of the block along its principal axis, found by power iteration on the covariance matrix
+static void data_bake_block_principal_endpoints ( float e0[4], float e1[4], const data_bake_block_t* block, uint32_t channel_count ) {
+    float mean[4] = { 0, 0, 0, 0 };
+    float min[4] = { 255, 255, 255, 255 };
+    float max[4] = { 0, 0, 0, 0 };
+
+    for ( uint32_t c = 0; c < channel_count; ++c ) {
+        for ( uint32_t i = 0; i < 16; ++i ) {
+            mean[c] += block->c[c][i];
+            min[c] = fminf ( min[c], block->c[c][i] );
+            max[c] = fmaxf ( max[c], block->c[c][i] );
+        }
+
+        mean[c] /= 16;
+    }
+
+    float cov[4][4] = { { 0 } };
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        for ( uint32_t a = 0; a < channel_count; ++a ) {
+            for ( uint32_t b = a; b < channel_count; ++b ) {
+                cov[a][b] += ( block->c[a][i] - mean[a] ) * ( block->c[b][i] - mean[b] );
+            }
+        }
+    }
+
+    for ( uint32_t a = 0; a < channel_count; ++a ) {
+        for ( uint32_t b = 0; b < a; ++b ) {
+            cov[a][b] = cov[b][a];
+        }
+    }
+
+    // Start from the bounding box diagonal, close to the principal axis for most blocks
+    float axis[4] = { 0, 0, 0, 0 };
+
+    for ( uint32_t c = 0; c < channel_count; ++c ) {
+        axis[c] = max[c] - min[c];
+    }
+
+    for ( uint32_t it = 0; it < 8; ++it ) {
+        float next[4] = { 0, 0, 0, 0 };
+        float len = 0;
+
+        for ( uint32_t a = 0; a < channel_count; ++a ) {
+            for ( uint32_t b = 0; b < channel_count; ++b ) {
+                next[a] += cov[a][b] * axis[b];
+            }
+
+            len = fmaxf ( len, fabsf ( next[a] ) );
+        }
+
+        if ( len == 0 ) {
+            break;
+        }
+
+        for ( uint32_t c = 0; c < channel_count; ++c ) {
+            axis[c] = next[c] / len;
+        }
+    }
+
+    float axis_len2 = 0;
+
+    for ( uint32_t c = 0; c < channel_count; ++c ) {
+        axis_len2 += axis[c] * axis[c];
+    }
+
+    float t_min = 0;
+    float t_max = 0;
+
+    if ( axis_len2 > 0 ) {
+        t_min = FLT_MAX;
+        t_max = -FLT_MAX;
+
+        for ( uint32_t i = 0; i < 16; ++i ) {
+            float t = 0;
+
+            for ( uint32_t c = 0; c < channel_count; ++c ) {
+                t += ( block->c[c][i] - mean[c] ) * axis[c];
+            }
+
+            t_min = fminf ( t_min, t );
+            t_max = fmaxf ( t_max, t );
+        }
+
+        t_min /= axis_len2;
+        t_max /= axis_len2;
+    }
+
+    for ( uint32_t c = 0; c < 4; ++c ) {
+        e0[c] = c < channel_count ? fminf ( fmaxf ( mean[c] + axis[c] * t_min, 0 ), 255 ) : 255;
+        e1[c] = c < channel_count ? fminf ( fmaxf ( mean[c] + axis[c] * t_max, 0 ), 255 ) : 255;
+    }
+}
+
+// Least squares endpoints for the interpolation weights of the chosen indices, weights go from 0 at e0 to 1 at e1.
+// Returns false if all texels use the same weight.
+static bool data_bake_block_refine ( float e0[4], float e1[4], const data_bake_block_t* block, const uint8_t* indices, const float* weights, uint32_t channel_count ) {
+    float a = 0;
+    float b = 0;
+    float c = 0;
+    float rhs0[4] = { 0, 0, 0, 0 };
+    float rhs1[4] = { 0, 0, 0, 0 };
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        float w = weights[indices[i]];
+        float iw = 1 - w;
+        a += iw * iw;
+        b += iw * w;
+        c += w * w;
+
+        for ( uint32_t ch = 0; ch < channel_count; ++ch ) {
+            rhs0[ch] += iw * block->c[ch][i];
+            rhs1[ch] += w * block->c[ch][i];
+        }
+    }
+
+    float det = a * c - b * b;
+
+    if ( fabsf ( det ) < 1e-6f ) {
+        return false;
+    }
+
+    for ( uint32_t ch = 0; ch < channel_count; ++ch ) {
+        e0[ch] = fminf ( fmaxf ( ( c * rhs0[ch] - b * rhs1[ch] ) / det, 0 ), 255 );
+        e1[ch] = fminf ( fmaxf ( ( a * rhs1[ch] - b * rhs0[ch] ) / det, 0 ), 255 );
+    }
+
+    return true;
+}
+
+// ------------------------------------------------------------------------------------------------
+// BC4
+
+static void data_bake_bc4_palette ( float palette[8][4], uint32_t e0, uint32_t e1 ) {
+    palette[0][0] = ( float ) e0;
+    palette[1][0] = ( float ) e1;
+
+    for ( uint32_t i = 2; i < 8; ++i ) {
+        palette[i][0] = ( ( 8 - i ) * e0 + ( i - 1 ) * e1 ) / 7.f;
+    }
+}
+
+// Always uses the 8 values mode, e0 > e1. Equal endpoints select the 6 values mode, where index 0 still decodes to e0.
+static float data_bake_bc4_try ( uint32_t* e0, uint32_t* e1, uint8_t* indices, const data_bake_block_t* block, float lo, float hi ) {
+    *e0 = ( uint32_t ) lrintf ( fmaxf ( lo, hi ) );
+    *e1 = ( uint32_t ) lrintf ( fminf ( lo, hi ) );
+    float palette[8][4];
+    data_bake_bc4_palette ( palette, *e0, *e1 );
+    return data_bake_block_fit ( indices, block, ( const float ( * )[4] ) palette, 8, 1 );
+}
+
+static void data_bake_encode_bc4 ( uint8_t* dest, const data_bake_block_t* block ) {
+    static const float weights[8] = { 0, 1, 1 / 7.f, 2 / 7.f, 3 / 7.f, 4 / 7.f, 5 / 7.f, 6 / 7.f };
+    float lo[4];
+    float hi[4];
+    data_bake_block_principal_endpoints ( lo, hi, block, 1 );
+
+    uint32_t e0, e1;
+    uint8_t indices[16];
+    float error = data_bake_bc4_try ( &e0, &e1, indices, block, lo[0], hi[0] );
+
+    for ( uint32_t it = 0; it < data_bake_texture_refine_iterations_m && error > 0; ++it ) {
+        // Index 0 is the max endpoint, refine solves for e0 = max and e1 = min
+        float refined_max[4];
+        float refined_min[4];
+
+        if ( !data_bake_block_refine ( refined_max, refined_min, block, indices, weights, 1 ) ) {
+            break;
+        }
+
+        uint32_t new_e0, new_e1;
+        uint8_t new_indices[16];
+        float new_error = data_bake_bc4_try ( &new_e0, &new_e1, new_indices, block, refined_min[0], refined_max[0] );
+
+        if ( new_error >= error ) {
+            break;
+        }
+
+        e0 = new_e0;
+        e1 = new_e1;
+        error = new_error;
+        std_mem_copy_array_m ( indices, new_indices, 16 );
+    }
+
+    uint64_t bits = 0;
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        bits |= ( uint64_t ) indices[i] << ( i * 3 );
+    }
+
+    dest[0] = ( uint8_t ) e0;
+    dest[1] = ( uint8_t ) e1;
+
+    for ( uint32_t i = 0; i < 6; ++i ) {
+        dest[2 + i] = ( uint8_t ) ( bits >> ( i * 8 ) );
+    }
+}
+
+// Encodes a single channel of the block
+static void data_bake_encode_bc4_channel ( uint8_t* dest, const data_bake_block_t* block, uint32_t channel ) {
+    data_bake_block_t channel_block;
+    std_mem_copy_array_m ( channel_block.c[0], block->c[channel], 16 );
+    data_bake_encode_bc4 ( dest, &channel_block );
+}
+
+// ------------------------------------------------------------------------------------------------
+// BC1
+
+static uint32_t data_bake_bc1_quantize ( const float color[4] ) {
+    uint32_t r = ( uint32_t ) lrintf ( color[0] * 31 / 255 );
+    uint32_t g = ( uint32_t ) lrintf ( color[1] * 63 / 255 );
+    uint32_t b = ( uint32_t ) lrintf ( color[2] * 31 / 255 );
+    return ( r << 11 ) | ( g << 5 ) | b;
+}
+
+static void data_bake_bc1_expand ( float color[4], uint32_t c ) {
+    uint32_t r = ( c >> 11 ) & 31;
+    uint32_t g = ( c >> 5 ) & 63;
+    uint32_t b = c & 31;
+    color[0] = ( float ) ( ( r << 3 ) | ( r >> 2 ) );
+    color[1] = ( float ) ( ( g << 2 ) | ( g >> 4 ) );
+    color[2] = ( float ) ( ( b << 3 ) | ( b >> 2 ) );
+    color[3] = 255;
+}
+
+// 4 colors mode needs c0 > c1, equal endpoints select the 3 colors mode, where index 0 still decodes to c0
+static float data_bake_bc1_try ( uint32_t* c0, uint32_t* c1, uint8_t* indices, const data_bake_block_t* block, const float e0[4], const float e1[4] ) {
+    uint32_t q0 = data_bake_bc1_quantize ( e0 );
+    uint32_t q1 = data_bake_bc1_quantize ( e1 );
+    *c0 = q0 > q1 ? q0 : q1;
+    *c1 = q0 > q1 ? q1 : q0;
+
+    float palette[4][4];
+    data_bake_bc1_expand ( palette[0], *c0 );
+    data_bake_bc1_expand ( palette[1], *c1 );
+
+    for ( uint32_t c = 0; c < 3; ++c ) {
+        palette[2][c] = ( 2 * palette[0][c] + palette[1][c] ) / 3;
+        palette[3][c] = ( palette[0][c] + 2 * palette[1][c] ) / 3;
+    }
+
+    return data_bake_block_fit ( indices, block, ( const float ( * )[4] ) palette, *c0 == *c1 ? 1 : 4, 3 );
+}
+
+static void data_bake_encode_bc1 ( uint8_t* dest, const data_bake_block_t* block ) {
+    static const float weights[4] = { 0, 1, 1 / 3.f, 2 / 3.f };
+    float e0[4];
+    float e1[4];
+    data_bake_block_principal_endpoints ( e0, e1, block, 3 );
+
+    uint32_t c0, c1;
+    uint8_t indices[16];
+    float error = data_bake_bc1_try ( &c0, &c1, indices, block, e0, e1 );
+
+    for ( uint32_t it = 0; it < data_bake_texture_refine_iterations_m && error > 0; ++it ) {
+        // Refine against the decoded endpoints order, c0 first
+        float refined0[4];
+        float refined1[4];
+
+        if ( c0 == c1 || !data_bake_block_refine ( refined0, refined1, block, indices, weights, 3 ) ) {
+            break;
+        }
+
+        uint32_t new_c0, new_c1;
+        uint8_t new_indices[16];
+        float new_error = data_bake_bc1_try ( &new_c0, &new_c1, new_indices, block, refined0, refined1 );
+
+        if ( new_error >= error ) {
+            break;
+        }
+
+        c0 = new_c0;
+        c1 = new_c1;
+        error = new_error;
+        std_mem_copy_array_m ( indices, new_indices, 16 );
+    }
+
+    uint32_t bits = 0;
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        bits |= ( uint32_t ) indices[i] << ( i * 2 );
+    }
+
+    dest[0] = ( uint8_t ) c0;
+    dest[1] = ( uint8_t ) ( c0 >> 8 );
+    dest[2] = ( uint8_t ) c1;
+    dest[3] = ( uint8_t ) ( c1 >> 8 );
+
+    for ( uint32_t i = 0; i < 4; ++i ) {
+        dest[4 + i] = ( uint8_t ) ( bits >> ( i * 8 ) );
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// BC7, mode 6
+
+static const uint32_t data_bake_bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// 7 bit channels plus a p-bit shared by the endpoint channels, picks the p-bit with the lowest error
+static uint32_t data_bake_bc7_quantize ( uint32_t q[4], const float e[4] ) {
+    float best_error = FLT_MAX;
+    uint32_t best_p = 0;
+
+    for ( uint32_t p = 0; p < 2; ++p ) {
+        uint32_t candidate[4];
+        float error = 0;
+
+        for ( uint32_t c = 0; c < 4; ++c ) {
+            long v = lrintf ( ( e[c] - p ) / 2 );
+            candidate[c] = ( uint32_t ) ( v < 0 ? 0 : v > 127 ? 127 : v );
+            float d = ( float ) ( ( candidate[c] << 1 ) | p ) - e[c];
+            error += d * d;
+        }
+
+        if ( error < best_error ) {
+            best_error = error;
+            best_p = p;
+            std_mem_copy_array_m ( q, candidate, 4 );
+        }
+    }
+
+    return best_p;
+}
+
+typedef struct {
+    uint32_t q[2][4];
+    uint32_t p[2];
+} data_bake_bc7_endpoints_t;
+
+static float data_bake_bc7_try ( data_bake_bc7_endpoints_t* endpoints, uint8_t* indices, const data_bake_block_t* block, const float e0[4], const float e1[4] ) {
+    endpoints->p[0] = data_bake_bc7_quantize ( endpoints->q[0], e0 );
+    endpoints->p[1] = data_bake_bc7_quantize ( endpoints->q[1], e1 );
+
+    float palette[16][4];
+
+    for ( uint32_t c = 0; c < 4; ++c ) {
+        uint32_t v0 = ( endpoints->q[0][c] << 1 ) | endpoints->p[0];
+        uint32_t v1 = ( endpoints->q[1][c] << 1 ) | endpoints->p[1];
+
+        for ( uint32_t i = 0; i < 16; ++i ) {
+            uint32_t w = data_bake_bc7_weights[i];
+            palette[i][c] = ( float ) ( ( ( 64 - w ) * v0 + w * v1 + 32 ) >> 6 );
+        }
+    }
+
+    return data_bake_block_fit ( indices, block, ( const float ( * )[4] ) palette, 16, 4 );
+}
+
+static void data_bake_bits_write ( uint64_t bits[2], uint32_t* offset, uint32_t value, uint32_t count ) {
+    for ( uint32_t i = 0; i < count; ++i, ++*offset ) {
+        bits[*offset / 64] |= ( uint64_t ) ( ( value >> i ) & 1 ) << ( *offset % 64 );
+    }
+}
+
+static void data_bake_encode_bc7 ( uint8_t* dest, const data_bake_block_t* block ) {
+    float weights[16];
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        weights[i] = data_bake_bc7_weights[i] / 64.f;
+    }
+
+    float e0[4];
+    float e1[4];
+    data_bake_block_principal_endpoints ( e0, e1, block, 4 );
+
+    data_bake_bc7_endpoints_t endpoints;
+    uint8_t indices[16];
+    float error = data_bake_bc7_try ( &endpoints, indices, block, e0, e1 );
+
+    for ( uint32_t it = 0; it < data_bake_texture_refine_iterations_m && error > 0; ++it ) {
+        if ( !data_bake_block_refine ( e0, e1, block, indices, weights, 4 ) ) {
+            break;
+        }
+
+        data_bake_bc7_endpoints_t new_endpoints;
+        uint8_t new_indices[16];
+        float new_error = data_bake_bc7_try ( &new_endpoints, new_indices, block, e0, e1 );
+
+        if ( new_error >= error ) {
+            break;
+        }
+
+        endpoints = new_endpoints;
+        error = new_error;
+        std_mem_copy_array_m ( indices, new_indices, 16 );
+    }
+
+    // The anchor index is stored without its top bit, swapping the endpoints mirrors the palette
+    if ( indices[0] & 8 ) {
+        data_bake_bc7_endpoints_t swapped = {
+            .q = {
+                { endpoints.q[1][0], endpoints.q[1][1], endpoints.q[1][2], endpoints.q[1][3] },
+                { endpoints.q[0][0], endpoints.q[0][1], endpoints.q[0][2], endpoints.q[0][3] },
+            },
+            .p = { endpoints.p[1], endpoints.p[0] },
+        };
+        endpoints = swapped;
+
+        for ( uint32_t i = 0; i < 16; ++i ) {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    uint64_t bits[2] = { 0, 0 };
+    uint32_t offset = 0;
+    data_bake_bits_write ( bits, &offset, 1 << 6, 7 );
+
+    for ( uint32_t c = 0; c < 4; ++c ) {
+        data_bake_bits_write ( bits, &offset, endpoints.q[0][c], 7 );
+        data_bake_bits_write ( bits, &offset, endpoints.q[1][c], 7 );
+    }
+
+    data_bake_bits_write ( bits, &offset, endpoints.p[0], 1 );
+    data_bake_bits_write ( bits, &offset, endpoints.p[1], 1 );
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        data_bake_bits_write ( bits, &offset, indices[i], i == 0 ? 3 : 4 );
+    }
+
+    for ( uint32_t i = 0; i < 16; ++i ) {
+        dest[i] = ( uint8_t ) ( bits[i / 8] >> ( ( i % 8 ) * 8 ) );
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+
+void data_bake_encode_block_row ( void* dest, const data_bake_image_t* image, uint32_t format, uint32_t block_row ) {
+    uint32_t block_count = ( image->width + 3 ) / 4;
+    uint32_t block_size = bsf_texture_block_size ( format );
+    uint8_t* block_dest = ( uint8_t* ) dest;
+    data_bake_block_t block;
+
+    for ( uint32_t i = 0; i < block_count; ++i, block_dest += block_size ) {
+        data_bake_block_load ( &block, image, i, block_row );
+
+        switch ( format ) {
+        case bsf_texture_format_bc1_m:
+            data_bake_encode_bc1 ( block_dest, &block );
+            break;
+        case bsf_texture_format_bc4_m:
+            data_bake_encode_bc4_channel ( block_dest, &block, 0 );
+            break;
+        case bsf_texture_format_bc5_m:
+            data_bake_encode_bc4_channel ( block_dest, &block, 0 );
+            data_bake_encode_bc4_channel ( block_dest + 8, &block, 1 );
+            break;
+        case bsf_texture_format_bc7_m:
+            data_bake_encode_bc7 ( block_dest, &block );
+            break;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <std_platform.h>
+
+/*
+    Texture processing
+
+    Images are decoded to rgba8, mips are generated on the cpu with a 2x2 box filter (texels past the edge of odd sized
+    mips are clamped) and every mip is block compressed. Normal maps are renormalized after filtering.
+
+    Blocks are encoded to bc1, bc4, bc5 or bc7 (mode 6 only: one subset, rgba 7.7.7.7 endpoints with a p-bit each and
+    4 bit indices). All of them start from the extremes of the block along its principal axis, pick the closest
+    palette entry for every texel, then refine the endpoints with a least squares fit to the chosen indices and keep
+    the refined endpoints if they lower the error. Palette fitting works on 4 texels at a time with SSE2.
+    Errors are summed squared differences in 0-255 units with all channels weighted the same.
+*/
+
+#define data_bake_texture_refine_iterations_m 2
+
+typedef struct {
+    uint8_t* rgba;
+    uint32_t width;
+    uint32_t height;
+} data_bake_image_t;
+
+// Reads size and channel count of an encoded image without decoding it
+bool data_bake_image_info ( uint32_t* width, uint32_t* height, uint32_t* channels, const void* data, uint64_t size );
+// Decodes to rgba8, missing channels are filled as stb_image does. Returns false if the format is not supported.
+bool data_bake_image_decode ( data_bake_image_t* image, const void* data, uint64_t size );
+void data_bake_image_free ( data_bake_image_t* image );
+
+// Full mip chain size, floor ( log2 ( max ( width, height ) ) ) + 1
+uint32_t data_bake_image_mip_count ( uint32_t width, uint32_t height );
+// Allocates dest, half the size of source rounded down and at least 1 texel
+void data_bake_image_downsample ( data_bake_image_t* dest, const data_bake_image_t* source, bool is_normal_map );
+
+// Encodes a row of 4x4 blocks to dest, format is a bsf_texture_format_e. bc1 and bc7 read rgb and rgba, bc4 reads r
+// and bc5 reads rg.
+void data_bake_encode_block_row ( void* dest, const data_bake_image_t* image, uint32_t format, uint32_t block_row );
@@ -1,156 +1,1424 @@
 #include <std_main.h>
 #include <std_log.h>
 #include <std_file.h>
+#include <std_string.h>
+#include <std_atomic.h>
+#include <std_byte.h>
+#include <std_time.h>
+#include <std_mutex.h>
+#include <std_sort.h>
+
+#include <math.h>
+
+#include <tk.h>
+#include <bsf.h>
 
 #include <assimp/cimport.h>
+#include <assimp/cfileio.h>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
-#define encode_u32_m( c1, c2, c3, c4 ) ( \
-    ( ( unsigned char ) ( c1 ) << 24 ) | \
-    ( ( unsigned char ) ( c2 ) << 16 ) | \
-    ( ( unsigned char ) ( c3 ) <<  8 ) | \
-    ( ( unsigned char ) ( c4 ) ) \
-)
+#include "data_bake_manifest.h"
+#include "data_bake_mesh.h"
+#include "data_bake_texture.h"
+
+/*
+    data_bake [--meshlets] [--packed] [--lods] [--textures] <input> [output]
+
+    Input can be a single scene file or a folder. Folders are walked recursively and every file with an extension the
+    importer supports is baked. The walk runs on tk too, with one task per folder, and inputs are sorted by path after.
+    Outputs mirror the input folder structure under output, or are placed next to their input (same name, .bsf
+    extension) when no output is given, which is where the viewer looks for them.
+
+    Inputs are baked in parallel on tk. Each input first runs one task per mesh to compute its final index buffers,
+    then one task per mesh and material chunk, writing straight into the final file layout, and finally encodes its
+    texture chunks. Inputs that are up to date according to the manifest (see data_bake_manifest.h) are skipped.
+    Every output, manifest included, is written through a temp file and moved in place once complete.
+
+    Meshes are always optimised for vertex cache and fetch locality (see data_bake_mesh.h), --meshlets also emits a
+    meshlets chunk for each mesh. --packed writes meshes with the bsf packed vertex layout, the quantization error of
+    each mesh is logged and meshes with uvs that don't fit in half precision are kept in f32. --lods generates a chain
+    of simplified LODs for each mesh (see data_bake_mesh.h). Level i targets half the triangles of level i - 1, with
+    a target error of data_bake_lod_base_error_m * 2^(i - 1) of the mesh bounds diagonal. The chain ends at
+    bsf_mesh_max_lods_m levels or at the first level that can't get below data_bake_lod_min_reduction_m of the
+    previous one.
+
+    --textures bakes the material textures into texture chunks, with full mip chains, block compressed (see
+    data_bake_texture.h). Metalness and roughness are expected to be packed in a single texture following glTF:
+    metalness goes to the color texture alpha and roughness to its own texture. Textures shared by several materials
+    are baked once. Sources are decoded and mipped on the job thread, then each mip is encoded with one task per row
+    of blocks. Textures go one at a time, so each input only keeps a single decoded mip in memory.
+*/
 
-#define bsf_magic_m encode_u32_m ( 'B', 'S', 'F', '1' )
-#define bsf_version_m 0x1
+// Keeps the number of chunk tasks in flight bounded regardless of scene size
+#define data_bake_max_chunk_tasks_m 128
 
-#define bsf_chunk_mesh_m        0x0001
-#define bsf_chunk_material_m    0x0002
-#define bsf_chunk_hierarchy_m   0x0004
+// Folder scans start with room for this many entries and retry with the exact count if it's not enough
+#define data_bake_walk_entries_cap_m 1024
+#define data_bake_walk_max_subfolder_tasks_m 64
+
+#define data_bake_lod_base_error_m 0.0025f
+#define data_bake_lod_min_reduction_m 0.9f
+
+typedef enum {
+    data_bake_result_failed_m,
+    data_bake_result_baked_m,
+    data_bake_result_up_to_date_m,
+} data_bake_result_e;
 
 typedef struct {
-    uint32_t id;
-    uint32_t type;
-    uint64_t offset;
-} bsf_table_entry_t;
+    const char* input_path;
+    const char* output_path;
+    const data_bake_manifest_entry_t* manifest_entry;
+    data_bake_dependency_list_t deps;
+    bool has_all_deps;
+    data_bake_result_e result;
+} data_bake_job_t;
 
-void std_main ( void ) {
-    std_log_info_m ( std_binding_assimp_models_m );
-    std_process_info_t process_info;
-    std_process_info ( &process_info, std_process_this() );
-    const char* input_path = process_info.args[0];
-    const char* output_path = process_info.args[1];
+typedef enum {
+    data_bake_option_meshlets_m         = 1 << 0,
+    data_bake_option_packed_vertices_m  = 1 << 1,
+    data_bake_option_lods_m             = 1 << 2,
+    data_bake_option_textures_m         = 1 << 3,
+} data_bake_option_bit_e;
+
+typedef struct {
+    data_bake_job_t* jobs_array;
+    uint32_t jobs_count;
+    uint32_t next_job;
+} data_bake_workers_context_t;
+
+// Output of the mesh prepare tasks, the index buffers decide the size of the mesh chunks
+typedef struct {
+    uint32_t* remap; // source vertex to baked vertex
+    uint32_t* indices; // all LODs, indexing the baked vertices
+    uint32_t lod_index_count;
+    uint32_t lod_count;
+    bsf_mesh_lod_t lods[bsf_mesh_max_lods_m];
+    float bounds_center[3];
+    float bounds_radius;
+    data_bake_vertex_cache_stats_t stats_before;
+} data_bake_mesh_data_t;
+
+typedef enum {
+    data_bake_texture_color_m,
+    data_bake_texture_normal_m,
+    data_bake_texture_roughness_m,
+    data_bake_texture_usage_count_m,
+} data_bake_texture_usage_e;
+
+// Texture names are the paths referenced by the materials, relative to the input folder
+typedef struct {
+    uint32_t usage; // data_bake_texture_usage_e
+    uint32_t format; // bsf_texture_format_e
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_count;
+    char name[bsf_texture_path_size_m];
+    char metalness_roughness_name[bsf_texture_path_size_m]; // color textures only, empty if metalness isn't packed
+} data_bake_texture_t;
+
+typedef struct {
+    const struct aiScene* scene;
+    const char* input_path;
+    char* base;
+    const bsf_table_entry_t* table;
+    const uint32_t* vertex_layouts; // bsf_vertex_layout_e, one per mesh
+    data_bake_mesh_data_t* meshes;
+    std_buffer_t* meshlet_chunks; // one per mesh, built by the mesh chunk tasks and appended at the end of the file
+    data_bake_texture_t* textures;
+    uint32_t texture_count;
+    const uint32_t* material_textures; // data_bake_texture_usage_count_m texture ids per material, bsf_null_id_m if not baked
+} data_bake_scene_context_t;
+
+typedef struct {
+    const data_bake_scene_context_t* scene;
+    uint32_t chunk_idx;
+} data_bake_chunk_task_t;
+
+typedef struct {
+    const data_bake_image_t* image;
+    char* dest;
+    uint32_t format;
+    uint32_t block_row;
+} data_bake_block_row_task_t;
+
+static tk_i* data_bake_tk;
+static uint32_t data_bake_options;
+
+// ------------------------------------------------------------------------------------------------
+// Importer file io
+// Files are mapped instead of being read through the importer's default io. The content hash of every file the
+// importer opens is recorded along the way, so the manifest can track .bin, .mtl and similar files for free.
+
+typedef struct {
+    struct aiFile ai_file;
+    std_file_h handle;
+    const char* data;
+    uint64_t size;
+    uint64_t cursor;
+} data_bake_file_t;
+
+typedef struct {
+    data_bake_dependency_list_t* deps;
+    bool has_all_deps;
+} data_bake_file_io_context_t;
+
+static size_t data_bake_file_read ( struct aiFile* ai_file, char* buffer, size_t size, size_t count ) {
+    data_bake_file_t* file = ( data_bake_file_t* ) ai_file;
+
+    if ( size == 0 ) {
+        return 0;
+    }
+
+    uint64_t available = ( file->size - file->cursor ) / size;
+    count = count < available ? count : available;
+    std_mem_copy ( buffer, file->data + file->cursor, size * count );
+    file->cursor += size * count;
+    return count;
+}
+
+static size_t data_bake_file_write ( struct aiFile* ai_file, const char* buffer, size_t size, size_t count ) {
+    std_unused_m ( ai_file );
+    std_unused_m ( buffer );
+    std_unused_m ( size );
+    std_unused_m ( count );
+    return 0;
+}
+
+static size_t data_bake_file_tell ( struct aiFile* ai_file ) {
+    return ( ( data_bake_file_t* ) ai_file )->cursor;
+}
+
+static size_t data_bake_file_size ( struct aiFile* ai_file ) {
+    return ( ( data_bake_file_t* ) ai_file )->size;
+}
+
+static enum aiReturn data_bake_file_seek ( struct aiFile* ai_file, size_t offset, enum aiOrigin origin ) {
+    data_bake_file_t* file = ( data_bake_file_t* ) ai_file;
+    // Offsets relative to the current position or to the end are negative encoded as size_t, the unsigned wrap around does the right thing
+    uint64_t cursor = offset;
+
+    if ( origin == aiOrigin_CUR ) {
+        cursor = file->cursor + offset;
+    } else if ( origin == aiOrigin_END ) {
+        cursor = file->size + offset;
+    }
+
+    if ( cursor > file->size ) {
+        return aiReturn_FAILURE;
+    }
+
+    file->cursor = cursor;
+    return aiReturn_SUCCESS;
+}
+
+static void data_bake_file_flush ( struct aiFile* ai_file ) {
+    std_unused_m ( ai_file );
+}
+
+static struct aiFile* data_bake_file_open ( struct aiFileIO* io, const char* path, const char* mode ) {
+    data_bake_file_io_context_t* context = ( data_bake_file_io_context_t* ) io->UserData;
+
+    if ( std_str_find ( mode, "w" ) != std_str_find_null_m ) {
+        return NULL;
+    }
+
+    std_file_h handle = std_file_open ( path, std_file_read_m );
+
+    if ( handle == std_file_null_handle_m ) {
+        return NULL;
+    }
+
+    std_file_info_t info;
+    const void* data = NULL;
+
+    if ( !std_file_info ( &info, handle ) || ( info.size > 0 && ( data = std_file_map ( handle, info.size, std_file_map_read_m ) ) == NULL ) ) {
+        std_file_close ( handle );
+        return NULL;
+    }
+
+    uint64_t content_hash = data_bake_content_hash ( data, info.size );
+
+    if ( !data_bake_dependency_list_add ( context->deps, path, content_hash, info.size, info.last_write_time.count ) ) {
+        context->has_all_deps = false;
+    }
+
+    data_bake_file_t* file = std_virtual_heap_alloc_struct_m ( data_bake_file_t );
+    file->ai_file = ( struct aiFile ) {
+        .ReadProc = data_bake_file_read,
+        .WriteProc = data_bake_file_write,
+        .TellProc = data_bake_file_tell,
+        .FileSizeProc = data_bake_file_size,
+        .SeekProc = data_bake_file_seek,
+        .FlushProc = data_bake_file_flush,
+        .UserData = NULL,
+    };
+    file->handle = handle;
+    file->data = ( const char* ) data;
+    file->size = info.size;
+    file->cursor = 0;
+    return &file->ai_file;
+}
+
+static void data_bake_file_close ( struct aiFileIO* io, struct aiFile* ai_file ) {
+    std_unused_m ( io );
+    data_bake_file_t* file = ( data_bake_file_t* ) ai_file;
+
+    if ( file->data ) {
+        std_file_unmap ( file->handle, ( void* ) file->data );
+    }
+
+    std_file_close ( file->handle );
+    std_virtual_heap_free ( file );
+}
+
+// ------------------------------------------------------------------------------------------------
+// Chunks
+
+static uint32_t data_bake_mesh_vertex_layout ( const struct aiMesh* mesh ) {
+    if ( !( data_bake_options & data_bake_option_packed_vertices_m ) ) {
+        return bsf_vertex_layout_f32_m;
+    }
+
+    const struct aiVector3D* uv = mesh->mTextureCoords[0];
+    float max_abs = 0;
+
+    for ( uint32_t i = 0; uv && i < mesh->mNumVertices; ++i ) {
+        max_abs = fmaxf ( max_abs, fmaxf ( fabsf ( uv[i].x ), fabsf ( uv[i].y ) ) );
+    }
+
+    if ( data_bake_half_max_error ( max_abs ) > data_bake_max_uv_error_m ) {
+        std_log_info_m ( "Mesh " std_fmt_str_m " has uvs up to " std_fmt_f32_dec_m(2) ", too large for half precision, keeping it in f32", mesh->mName.data, max_abs );
+        return bsf_vertex_layout_f32_m;
+    }
+
+    return bsf_vertex_layout_packed_m;
+}
+
+static void data_bake_prepare_mesh ( data_bake_mesh_data_t* data, const struct aiMesh* mesh ) {
+    uint32_t vertex_count = mesh->mNumVertices;
+    uint32_t index_count = mesh->mNumFaces * 3;
+    uint32_t* source_idx = std_virtual_heap_alloc_array_m ( uint32_t, index_count > 0 ? index_count : 1 );
+
+    // idx, in source order
+    // Triangulate can still leave point and line faces around, write those out as degenerate triangles
+    for ( uint32_t i = 0; i < mesh->mNumFaces; ++i ) {
+        const struct aiFace* face = &mesh->mFaces[i];
+        uint32_t last = face->mNumIndices > 0 ? face->mNumIndices - 1 : 0;
+
+        for ( uint32_t j = 0; j < 3; ++j ) {
+            source_idx[i * 3 + j] = face->mNumIndices > 0 ? face->mIndices[j < last ? j : last] : 0;
+        }
+    }
+
+    data->stats_before = data_bake_analyze_vertex_cache ( source_idx, index_count, vertex_count, data_bake_vertex_cache_analysis_size_m );
+
+    // Bounds
+    float* pos = std_virtual_heap_alloc_array_m ( float, ( uint64_t ) vertex_count * 3 + 1 );
+    float min[3] = { INFINITY, INFINITY, INFINITY };
+    float max[3] = { -INFINITY, -INFINITY, -INFINITY };
+
+    for ( uint32_t i = 0; i < vertex_count; ++i ) {
+        pos[i * 3 + 0] = mesh->mVertices[i].x;
+        pos[i * 3 + 1] = mesh->mVertices[i].y;
+        pos[i * 3 + 2] = mesh->mVertices[i].z;
+
+        for ( uint32_t j = 0; j < 3; ++j ) {
+            min[j] = fminf ( min[j], pos[i * 3 + j] );
+            max[j] = fmaxf ( max[j], pos[i * 3 + j] );
+        }
+    }
+
+    float radius = 0;
+
+    for ( uint32_t j = 0; j < 3; ++j ) {
+        data->bounds_center[j] = vertex_count > 0 ? ( min[j] + max[j] ) * 0.5f : 0;
+    }
+
+    for ( uint32_t i = 0; i < vertex_count; ++i ) {
+        float d[3] = { pos[i * 3 + 0] - data->bounds_center[0], pos[i * 3 + 1] - data->bounds_center[1], pos[i * 3 + 2] - data->bounds_center[2] };
+        radius = fmaxf ( radius, sqrtf ( d[0] * d[0] + d[1] * d[1] + d[2] * d[2] ) );
+    }
+
+    data->bounds_radius = radius;
+
+    // LOD 0, reordered for cache reuse
+    uint32_t* lod_indices[bsf_mesh_max_lods_m];
+    lod_indices[0] = std_virtual_heap_alloc_array_m ( uint32_t, index_count > 0 ? index_count : 1 );
+    data_bake_optimize_vertex_cache ( lod_indices[0], source_idx, index_count, vertex_count );
+    data->lods[0] = ( bsf_mesh_lod_t ) { .index_offset = 0, .index_count = index_count, .error = 0 };
+    data->lod_count = 1;
+    data->lod_index_count = index_count;
+
+    // LOD chain, each level is simplified from LOD 0 so that its error is measured against the full mesh
+    if ( data_bake_options & data_bake_option_lods_m ) {
+        float diagonal = vertex_count > 0 ? sqrtf ( ( max[0] - min[0] ) * ( max[0] - min[0] ) + ( max[1] - min[1] ) * ( max[1] - min[1] ) + ( max[2] - min[2] ) * ( max[2] - min[2] ) ) : 0;
+        float target_error = diagonal * data_bake_lod_base_error_m;
+
+        while ( data->lod_count < bsf_mesh_max_lods_m ) {
+            uint32_t lod = data->lod_count;
+            uint32_t prev_count = data->lods[lod - 1].index_count;
+            uint32_t target_count = ( ( index_count / 3 ) >> lod ) * 3;
+            uint32_t* simplified = std_virtual_heap_alloc_array_m ( uint32_t, index_count > 0 ? index_count : 1 );
+            float error = 0;
+            uint32_t count = data_bake_simplify ( simplified, lod_indices[0], index_count, pos, vertex_count, target_count, target_error, &error );
+
+            if ( count == 0 || ( float ) count > prev_count * data_bake_lod_min_reduction_m ) {
+                std_virtual_heap_free ( simplified );
+                break;
+            }
+
+            lod_indices[lod] = std_virtual_heap_alloc_array_m ( uint32_t, count );
+            data_bake_optimize_vertex_cache ( lod_indices[lod], simplified, count, vertex_count );
+            std_virtual_heap_free ( simplified );
+
+            // Errors are kept monotonic, a coarser LOD is never selected before a finer one
+            data->lods[lod] = ( bsf_mesh_lod_t ) {
+                .index_offset = data->lod_index_count,
+                .index_count = count,
+                .error = fmaxf ( error, data->lods[lod - 1].error ),
+            };
+            data->lod_index_count += count;
+            data->lod_count += 1;
+            target_error *= 2;
+        }
+    }
+
+    // Reorder vertices for fetch locality following LOD 0, coarser LODs use a subset of its vertices
+    data->remap = std_virtual_heap_alloc_array_m ( uint32_t, vertex_count > 0 ? vertex_count : 1 );
+    data->indices = std_virtual_heap_alloc_array_m ( uint32_t, data->lod_index_count > 0 ? data->lod_index_count : 1 );
+    data_bake_optimize_vertex_fetch_remap ( data->remap, lod_indices[0], index_count, vertex_count );
+
+    for ( uint32_t lod = 0; lod < data->lod_count; ++lod ) {
+        uint32_t* dest = data->indices + data->lods[lod].index_offset;
+
+        for ( uint32_t i = 0; i < data->lods[lod].index_count; ++i ) {
+            dest[i] = data->remap[lod_indices[lod][i]];
+        }
+
+        std_virtual_heap_free ( lod_indices[lod] );
+    }
+
+    std_virtual_heap_free ( source_idx );
+    std_virtual_heap_free ( pos );
+}
+
+static void data_bake_write_mesh ( char* dest, const struct aiScene* scene, uint32_t mesh_idx, uint32_t vertex_layout, const data_bake_mesh_data_t* data, std_buffer_t* meshlets ) {
+    const struct aiMesh* mesh = scene->mMeshes[mesh_idx];
+    uint32_t vertex_count = mesh->mNumVertices;
+    uint32_t index_count = data->lods[0].index_count;
+
+    // Zero initialized, the unused part of the name is part of the output and needs to be deterministic
+    bsf_mesh_header_t header = {
+        .mesh_id = mesh_idx,
+        .material_id = mesh->mMaterialIndex < scene->mNumMaterials ? mesh->mMaterialIndex : bsf_null_id_m,
+        .vertex_count = vertex_count,
+        .index_count = index_count,
+        .vertex_layout = vertex_layout,
+        .lod_count = data->lod_count,
+        .lod_index_count = data->lod_index_count,
+        .pos_scale = 1,
+        .bounds_center = { data->bounds_center[0], data->bounds_center[1], data->bounds_center[2] },
+        .bounds_radius = data->bounds_radius,
+    };
+    std_str_copy_static_m ( header.name, mesh->mName.data );
+    std_mem_copy_array_m ( header.lods, data->lods, data->lod_count );
+
+    char* vertex_data = dest + sizeof ( bsf_mesh_header_t );
+    uint32_t* idx_data = ( uint32_t* ) ( vertex_data + ( uint64_t ) vertex_count * bsf_vertex_size ( vertex_layout ) );
+    // f32 streams are written in place, or to a temp buffer that gets packed at the end
+    float* pos_data = vertex_layout == bsf_vertex_layout_f32_m ? ( float* ) vertex_data : std_virtual_heap_alloc_array_m ( float, ( uint64_t ) vertex_count * ( 3 + 3 + 3 + 3 + 2 ) + 1 );
+    const uint32_t* remap = data->remap;
+
+    // idx, already in baked vertex order
+    std_mem_copy ( idx_data, data->indices, sizeof ( uint32_t ) * data->lod_index_count );
+
+    // pos, nor, tan, bitan
+    float* f32_data = pos_data;
+    const struct aiVector3D* streams[4] = { mesh->mVertices, mesh->mNormals, mesh->mTangents, mesh->mBitangents };
+
+    for ( uint32_t stream_it = 0; stream_it < 4; ++stream_it ) {
+        const struct aiVector3D* stream = streams[stream_it];
+
+        for ( uint32_t i = 0; i < vertex_count; ++i ) {
+            uint32_t v = remap[i];
+            f32_data[v * 3 + 0] = stream ? stream[i].x : 0;
+            f32_data[v * 3 + 1] = stream ? stream[i].y : 0;
+            f32_data[v * 3 + 2] = stream ? stream[i].z : 0;
+        }
+
+        f32_data += vertex_count * 3;
+    }
+
+    // uv
+    const struct aiVector3D* uv = mesh->mTextureCoords[0];
+
+    for ( uint32_t i = 0; i < vertex_count; ++i ) {
+        uint32_t v = remap[i];
+        f32_data[v * 2 + 0] = uv ? uv[i].x : 0;
+        f32_data[v * 2 + 1] = uv ? uv[i].y : 0;
+    }
+
+    if ( vertex_layout == bsf_vertex_layout_packed_m ) {
+        const float* nor_data = pos_data + ( uint64_t ) vertex_count * 3;
+        const float* tan_data = nor_data + ( uint64_t ) vertex_count * 3;
+        const float* bitan_data = tan_data + ( uint64_t ) vertex_count * 3;
+        const float* uv_data = bitan_data + ( uint64_t ) vertex_count * 3;
+        data_bake_quantization_error_t error = data_bake_pack_vertices ( vertex_data, header.pos_offset, &header.pos_scale, pos_data,
+            mesh->mNormals ? nor_data : NULL, mesh->mTangents ? tan_data : NULL, mesh->mBitangents ? bitan_data : NULL, uv ? uv_data : NULL, vertex_count );
+
+        bool is_over = error.pos > data_bake_max_pos_error_m || error.nor > data_bake_max_direction_error_m || error.tan > data_bake_max_direction_error_m || error.uv > data_bake_max_uv_error_m;
+        if ( is_over ) {
+            std_log_warn_m ( "Mesh " std_fmt_str_m ": packed vertex error over the limits, pos " std_fmt_f32_m " nor " std_fmt_f32_m " tan " std_fmt_f32_m " uv " std_fmt_f32_m,
+                header.name, error.pos, error.nor, error.tan, error.uv );
+        } else {
+            std_log_info_m ( "Mesh " std_fmt_str_m ": packed vertex error pos " std_fmt_f32_m " nor " std_fmt_f32_m " tan " std_fmt_f32_m " uv " std_fmt_f32_m,
+                header.name, error.pos, error.nor, error.tan, error.uv );
+        }
+    }
+
+    std_mem_copy_m ( dest, &header );
+
+    data_bake_vertex_cache_stats_t stats_after = data_bake_analyze_vertex_cache ( idx_data, index_count, vertex_count, data_bake_vertex_cache_analysis_size_m );
+    std_log_info_m ( "Mesh " std_fmt_str_m ": ACMR " std_fmt_f32_dec_m(3) " -> " std_fmt_f32_dec_m(3) ", ATVR " std_fmt_f32_dec_m(3) " -> " std_fmt_f32_dec_m(3),
+        header.name, data->stats_before.acmr, stats_after.acmr, data->stats_before.atvr, stats_after.atvr );
+
+    for ( uint32_t i = 1; i < header.lod_count; ++i ) {
+        std_log_info_m ( "Mesh " std_fmt_str_m ": LOD " std_fmt_u32_m ", " std_fmt_u32_m " triangles, error " std_fmt_f32_m,
+            header.name, i, header.lods[i].index_count / 3, header.lods[i].error );
+    }
+
+    // Meshlets only cover LOD 0
+    if ( meshlets ) {
+        *meshlets = data_bake_build_meshlets ( mesh_idx, idx_data, index_count, pos_data, vertex_count );
+    }
+
+    if ( vertex_layout != bsf_vertex_layout_f32_m ) {
+        std_virtual_heap_free ( pos_data );
+    }
+}
+
+// Names of the color, normal and metalness roughness textures, empty if missing
+static void data_bake_material_texture_names ( struct aiString names[data_bake_texture_usage_count_m], const struct aiMaterial* material ) {
+    for ( uint32_t i = 0; i < data_bake_texture_usage_count_m; ++i ) {
+        names[i].length = 0;
+        names[i].data[0] = '\0';
+    }
+
+    // Embedded textures (*N paths) live inside the source asset and can't be referenced from the bsf
+    struct aiString texture_name;
+    if ( aiGetMaterialTexture ( material, aiTextureType_DIFFUSE, 0, &texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS && texture_name.data[0] != '*' ) {
+        names[data_bake_texture_color_m] = texture_name;
+    }
+
+    if ( aiGetMaterialTexture ( material, aiTextureType_NORMALS, 0, &texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS && texture_name.data[0] != '*' ) {
+        names[data_bake_texture_normal_m] = texture_name;
+    }
+
+    // Metalness and roughness are expected to be packed in the same texture, following glTF
+    struct aiString metalness_texture_name;
+    bool has_metalness = aiGetMaterialTexture ( material, AI_MATKEY_METALLIC_TEXTURE, &metalness_texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS;
+    if ( has_metalness && aiGetMaterialTexture ( material, AI_MATKEY_ROUGHNESS_TEXTURE, &texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS && texture_name.data[0] != '*' ) {
+        names[data_bake_texture_roughness_m] = texture_name;
+    }
+}
+
+static void data_bake_write_material ( char* dest, const struct aiScene* scene, uint32_t material_idx, const uint32_t* texture_ids ) {
+    const struct aiMaterial* material = scene->mMaterials[material_idx];
+    bsf_material_t bsf_material;
+    std_mem_zero_m ( &bsf_material );
+    bsf_material.material_id = material_idx;
+    bsf_material.color_texture_id = texture_ids ? texture_ids[data_bake_texture_color_m] : bsf_null_id_m;
+    bsf_material.normal_texture_id = texture_ids ? texture_ids[data_bake_texture_normal_m] : bsf_null_id_m;
+    bsf_material.roughness_texture_id = texture_ids ? texture_ids[data_bake_texture_roughness_m] : bsf_null_id_m;
+
+    struct aiColor4D diffuse;
+    if ( aiGetMaterialColor ( material, AI_MATKEY_BASE_COLOR, &diffuse ) == AI_SUCCESS ) {
+        bsf_material.flags |= bsf_material_has_base_color_m;
+        bsf_material.base_color[0] = diffuse.r;
+        bsf_material.base_color[1] = diffuse.g;
+        bsf_material.base_color[2] = diffuse.b;
+    }
+
+    if ( aiGetMaterialFloat ( material, AI_MATKEY_ROUGHNESS_FACTOR, &bsf_material.roughness ) == AI_SUCCESS ) {
+        bsf_material.flags |= bsf_material_has_roughness_m;
+    }
+
+    if ( aiGetMaterialFloat ( material, AI_MATKEY_METALLIC_FACTOR, &bsf_material.metalness ) == AI_SUCCESS ) {
+        bsf_material.flags |= bsf_material_has_metalness_m;
+    }
+
+    struct aiString texture_names[data_bake_texture_usage_count_m];
+    data_bake_material_texture_names ( texture_names, material );
+    std_str_copy_static_m ( bsf_material.color_texture, texture_names[data_bake_texture_color_m].data );
+    std_str_copy_static_m ( bsf_material.normal_texture, texture_names[data_bake_texture_normal_m].data );
+    std_str_copy_static_m ( bsf_material.metalness_roughness_texture, texture_names[data_bake_texture_roughness_m].data );
+
+    std_mem_copy_m ( dest, &bsf_material );
+}
+
+// ------------------------------------------------------------------------------------------------
+// Textures
+
+typedef struct {
+    std_file_h handle;
+    const void* data;
+    uint64_t size;
+} data_bake_mapping_t;
+
+static bool data_bake_map_file ( data_bake_mapping_t* mapping, const char* path, std_file_info_t* info ) {
+    mapping->handle = std_file_open ( path, std_file_read_m );
+    mapping->data = NULL;
+    mapping->size = 0;
+
+    if ( mapping->handle == std_file_null_handle_m ) {
+        return false;
+    }
+
+    if ( !std_file_info ( info, mapping->handle ) || info->size == 0 || ( mapping->data = std_file_map ( mapping->handle, info->size, std_file_map_read_m ) ) == NULL ) {
+        std_file_close ( mapping->handle );
+        mapping->handle = std_file_null_handle_m;
+        return false;
+    }
+
+    mapping->size = info->size;
+    return true;
+}
+
+static void data_bake_unmap_file ( data_bake_mapping_t* mapping ) {
+    if ( mapping->handle != std_file_null_handle_m ) {
+        std_file_unmap ( mapping->handle, ( void* ) mapping->data );
+        std_file_close ( mapping->handle );
+    }
+
+    mapping->handle = std_file_null_handle_m;
+}
+
+// Texture names are relative to the folder of the input
+static void data_bake_texture_path ( char* path, const char* input_path, const char* name ) {
+    std_path_normalize ( path, std_path_size_m, input_path );
+    std_path_pop ( path );
+    std_path_append ( path, std_path_size_m, name );
+}
+
+// Reads the image size and records the source as a dependency of the job
+static bool data_bake_texture_info ( uint32_t* width, uint32_t* height, uint32_t* channels, data_bake_job_t* job, const char* name ) {
+    char* path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    data_bake_texture_path ( path, job->input_path, name );
+
+    data_bake_mapping_t mapping;
+    std_file_info_t info;
+    bool result = data_bake_map_file ( &mapping, path, &info );
+
+    if ( result ) {
+        if ( !data_bake_dependency_list_add ( &job->deps, path, data_bake_content_hash ( mapping.data, mapping.size ), info.size, info.last_write_time.count ) ) {
+            job->has_all_deps = false;
+        }
+
+        result = data_bake_image_info ( width, height, channels, mapping.data, mapping.size );
+        data_bake_unmap_file ( &mapping );
+    }
 
-    std_path_info_t path_info;
-    bool result = std_path_info ( &path_info, input_path );
-    
     if ( !result ) {
-        std_log_error_m ( "Input path not found" );
-        return;
+        std_log_warn_m ( "Failed to read texture " std_fmt_str_m ", it won't be baked", path );
     }
 
-    if ( path_info.flags & std_path_is_directory_m ) {
-        std_log_error_m ( "Folder paths are not currently supported" );
+    std_virtual_heap_free ( path );
+    return result;
+}
+
+// Returns the id of the baked texture, bsf_null_id_m if the source can't be read
+static uint32_t data_bake_add_texture ( data_bake_scene_context_t* context, data_bake_job_t* job, uint32_t usage, const char* name, const char* metalness_roughness_name ) {
+    for ( uint32_t i = 0; i < context->texture_count; ++i ) {
+        const data_bake_texture_t* texture = &context->textures[i];
+
+        if ( texture->usage == usage && std_str_cmp ( texture->name, name ) == 0 && std_str_cmp ( texture->metalness_roughness_name, metalness_roughness_name ) == 0 ) {
+            return i;
+        }
+    }
+
+    uint32_t width, height, channels;
+
+    if ( !data_bake_texture_info ( &width, &height, &channels, job, name ) ) {
+        return bsf_null_id_m;
+    }
+
+    data_bake_texture_t* texture = &context->textures[context->texture_count];
+    std_mem_zero_m ( texture );
+    texture->usage = usage;
+    texture->width = width;
+    texture->height = height;
+    texture->mip_count = std_min_u32 ( data_bake_image_mip_count ( width, height ), bsf_texture_max_mips_m );
+    std_str_copy_static_m ( texture->name, name );
+
+    if ( usage == data_bake_texture_color_m && metalness_roughness_name[0] ) {
+        uint32_t mr_width, mr_height, mr_channels;
+
+        if ( !data_bake_texture_info ( &mr_width, &mr_height, &mr_channels, job, metalness_roughness_name ) ) {
+            // Already warned about
+        } else if ( mr_width != width || mr_height != height ) {
+            std_log_warn_m ( "Texture " std_fmt_str_m " doesn't match the size of " std_fmt_str_m ", metalness won't be packed in its alpha", metalness_roughness_name, name );
+        } else {
+            std_str_copy_static_m ( texture->metalness_roughness_name, metalness_roughness_name );
+        }
+    }
+
+    if ( usage == data_bake_texture_normal_m ) {
+        texture->format = bsf_texture_format_bc5_m;
+    } else if ( usage == data_bake_texture_roughness_m ) {
+        texture->format = bsf_texture_format_bc4_m;
+    } else {
+        // Alpha holds metalness, sources without alpha and without a metalness texture are opaque
+        bool has_alpha = texture->metalness_roughness_name[0] || channels == 2 || channels == 4;
+        texture->format = has_alpha ? bsf_texture_format_bc7_m : bsf_texture_format_bc1_m;
+    }
+
+    return context->texture_count++;
+}
+
+static void data_bake_block_row_task ( void* arg ) {
+    const data_bake_block_row_task_t* task = ( const data_bake_block_row_task_t* ) arg;
+    data_bake_encode_block_row ( task->dest, task->image, task->format, task->block_row );
+}
+
+static void data_bake_encode_mip ( char* dest, const data_bake_image_t* image, uint32_t format ) {
+    data_bake_block_row_task_t args[data_bake_max_chunk_tasks_m];
+    tk_task_t tasks[data_bake_max_chunk_tasks_m];
+    uint32_t row_count = ( image->height + 3 ) / 4;
+    uint64_t row_size = ( uint64_t ) ( ( image->width + 3 ) / 4 ) * bsf_texture_block_size ( format );
+
+    for ( uint32_t begin = 0; begin < row_count; begin += data_bake_max_chunk_tasks_m ) {
+        uint32_t count = row_count - begin < data_bake_max_chunk_tasks_m ? row_count - begin : data_bake_max_chunk_tasks_m;
+
+        for ( uint32_t i = 0; i < count; ++i ) {
+            args[i].image = image;
+            args[i].dest = dest + row_size * ( begin + i );
+            args[i].format = format;
+            args[i].block_row = begin + i;
+            tasks[i].routine = data_bake_block_row_task;
+            tasks[i].arg = &args[i];
+        }
+
+        tk_workload_h workload = data_bake_tk->schedule_work ( tasks, count );
+        data_bake_tk->wait_for_workload ( workload );
+    }
+}
+
+// Decodes the sources and moves the channels where the encoder expects them
+static bool data_bake_load_texture_image ( data_bake_image_t* image, const data_bake_scene_context_t* context, const data_bake_texture_t* texture ) {
+    // Zeroed so that every failure path below can free it
+    std_mem_zero_m ( image );
+    char* path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    data_bake_texture_path ( path, context->input_path, texture->name );
+
+    data_bake_mapping_t mapping;
+    std_file_info_t info;
+    bool result = data_bake_map_file ( &mapping, path, &info );
+
+    if ( result ) {
+        result = data_bake_image_decode ( image, mapping.data, mapping.size );
+        data_bake_unmap_file ( &mapping );
+    }
+
+    // Size is checked again, sources might have changed since they were first read
+    result = result && image->width == texture->width && image->height == texture->height;
+    uint64_t texel_count = ( uint64_t ) texture->width * texture->height;
+
+    if ( result && texture->usage == data_bake_texture_roughness_m ) {
+        for ( uint64_t i = 0; i < texel_count; ++i ) {
+            image->rgba[i * 4] = image->rgba[i * 4 + 1];
+        }
+    }
+
+    if ( result && texture->metalness_roughness_name[0] ) {
+        data_bake_texture_path ( path, context->input_path, texture->metalness_roughness_name );
+        data_bake_image_t metalness_roughness;
+        std_mem_zero_m ( &metalness_roughness );
+        result = data_bake_map_file ( &mapping, path, &info );
+
+        if ( result ) {
+            result = data_bake_image_decode ( &metalness_roughness, mapping.data, mapping.size );
+            data_bake_unmap_file ( &mapping );
+        }
+
+        result = result && metalness_roughness.width == texture->width && metalness_roughness.height == texture->height;
+
+        for ( uint64_t i = 0; result && i < texel_count; ++i ) {
+            image->rgba[i * 4 + 3] = metalness_roughness.rgba[i * 4 + 2];
+        }
+
+        data_bake_image_free ( &metalness_roughness );
+    }
+
+    if ( !result ) {
+        std_log_error_m ( "Failed to decode texture " std_fmt_str_m, path );
+        data_bake_image_free ( image );
+    }
+
+    std_virtual_heap_free ( path );
+    return result;
+}
+
+static void data_bake_write_texture ( char* dest, const data_bake_scene_context_t* context, uint32_t texture_idx ) {
+    const data_bake_texture_t* texture = &context->textures[texture_idx];
+
+    // Zero initialized, the unused part of the name is part of the output and needs to be deterministic
+    bsf_texture_header_t header = {
+        .texture_id = texture_idx,
+        .format = texture->format,
+        .width = texture->width,
+        .height = texture->height,
+        .mip_count = texture->mip_count,
+    };
+    std_str_copy_static_m ( header.name, texture->name );
+    std_mem_copy_m ( dest, &header );
+
+    char* mip_dest = dest + sizeof ( bsf_texture_header_t );
+    data_bake_image_t image;
+
+    if ( !data_bake_load_texture_image ( &image, context, texture ) ) {
+        std_mem_zero ( mip_dest, bsf_texture_chunk_size ( texture->format, texture->width, texture->height, texture->mip_count ) - sizeof ( bsf_texture_header_t ) );
         return;
     }
 
+    for ( uint32_t mip = 0; mip < texture->mip_count; ++mip ) {
+        data_bake_encode_mip ( mip_dest, &image, texture->format );
+        mip_dest += bsf_texture_mip_size ( texture->format, texture->width, texture->height, mip );
+
+        if ( mip + 1 < texture->mip_count ) {
+            data_bake_image_t next;
+            data_bake_image_downsample ( &next, &image, texture->usage == data_bake_texture_normal_m );
+            data_bake_image_free ( &image );
+            image = next;
+        }
+    }
+
+    data_bake_image_free ( &image );
+    std_log_info_m ( "Texture " std_fmt_str_m ": " std_fmt_u32_m "x" std_fmt_u32_m ", " std_fmt_u32_m " mips, " std_fmt_str_m,
+        texture->name, texture->width, texture->height, texture->mip_count, texture->format == bsf_texture_format_bc1_m ? "bc1" : texture->format == bsf_texture_format_bc4_m ? "bc4" : texture->format == bsf_texture_format_bc5_m ? "bc5" : "bc7" );
+}
+
+static void data_bake_prepare_mesh_task ( void* arg ) {
+    const data_bake_chunk_task_t* task = ( const data_bake_chunk_task_t* ) arg;
+    const data_bake_scene_context_t* context = task->scene;
+    data_bake_prepare_mesh ( &context->meshes[task->chunk_idx], context->scene->mMeshes[task->chunk_idx] );
+}
+
+static void data_bake_chunk_task ( void* arg ) {
+    const data_bake_chunk_task_t* task = ( const data_bake_chunk_task_t* ) arg;
+    const data_bake_scene_context_t* context = task->scene;
+    const bsf_table_entry_t* entry = &context->table[task->chunk_idx];
+    char* dest = context->base + entry->offset;
+
+    if ( entry->type == bsf_chunk_mesh_m ) {
+        std_buffer_t* meshlets = context->meshlet_chunks ? &context->meshlet_chunks[task->chunk_idx] : NULL;
+        data_bake_write_mesh ( dest, context->scene, task->chunk_idx, context->vertex_layouts[task->chunk_idx], &context->meshes[task->chunk_idx], meshlets );
+    } else {
+        uint32_t material_idx = task->chunk_idx - context->scene->mNumMeshes;
+        const uint32_t* texture_ids = context->material_textures ? &context->material_textures[material_idx * data_bake_texture_usage_count_m] : NULL;
+        data_bake_write_material ( dest, context->scene, material_idx, texture_ids );
+    }
+}
+
+static void data_bake_run_chunk_tasks ( const data_bake_scene_context_t* context, tk_task_routine_f* routine, uint32_t task_count ) {
+    data_bake_chunk_task_t args[data_bake_max_chunk_tasks_m];
+    tk_task_t tasks[data_bake_max_chunk_tasks_m];
+
+    for ( uint32_t begin = 0; begin < task_count; begin += data_bake_max_chunk_tasks_m ) {
+        uint32_t count = task_count - begin < data_bake_max_chunk_tasks_m ? task_count - begin : data_bake_max_chunk_tasks_m;
+
+        for ( uint32_t i = 0; i < count; ++i ) {
+            args[i].scene = context;
+            args[i].chunk_idx = begin + i;
+            tasks[i].routine = routine;
+            tasks[i].arg = &args[i];
+        }
+
+        tk_workload_h workload = data_bake_tk->schedule_work ( tasks, count );
+        data_bake_tk->wait_for_workload ( workload );
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Jobs
+
+static unsigned int data_bake_import_flags ( void ) {
+    // Same processing the viewer applies when importing the source asset directly
     unsigned int flags = 0;
+    flags |= aiProcess_ConvertToLeftHanded;
     flags |= aiProcess_JoinIdenticalVertices;
-    flags |= aiProcess_MakeLeftHanded;
     flags |= aiProcess_Triangulate;
     flags |= aiProcess_ValidateDataStructure;
-    flags |= aiProcess_GenSmoothNormals;
     flags |= aiProcess_FindInvalidData;
-    flags |= aiProcess_GenUVCoords;
-    flags |= aiProcess_GenBoundingBoxes;
+    flags |= aiProcess_PreTransformVertices;
+    flags |= aiProcess_CalcTangentSpace;
+    return flags;
+}
+
+static uint64_t data_bake_chunk_size ( const data_bake_scene_context_t* context, uint32_t chunk_idx ) {
+    uint32_t task_count = context->scene->mNumMeshes + context->scene->mNumMaterials;
+
+    if ( chunk_idx < context->scene->mNumMeshes ) {
+        const struct aiMesh* mesh = context->scene->mMeshes[chunk_idx];
+        return bsf_mesh_chunk_size ( context->vertex_layouts[chunk_idx], mesh->mNumVertices, context->meshes[chunk_idx].lod_index_count );
+    } else if ( chunk_idx < task_count ) {
+        return sizeof ( bsf_material_t );
+    } else {
+        const data_bake_texture_t* texture = &context->textures[chunk_idx - task_count];
+        return bsf_texture_chunk_size ( texture->format, texture->width, texture->height, texture->mip_count );
+    }
+}
 
-    std_log_info_m ( "Importing input scene " std_fmt_str_m, input_path );
-    const struct aiScene* scene = aiImportFile ( input_path, flags );
+static bool data_bake_scene ( data_bake_job_t* job ) {
+    data_bake_file_io_context_t io_context = {
+        .deps = &job->deps,
+        .has_all_deps = true,
+    };
+    struct aiFileIO io = {
+        .OpenProc = data_bake_file_open,
+        .CloseProc = data_bake_file_close,
+        .UserData = ( aiUserData ) &io_context,
+    };
+
+    const struct aiScene* scene = aiImportFileEx ( job->input_path, data_bake_import_flags(), &io );
 
     if ( scene == NULL ) {
-        std_log_error_m ( "Error importing file" );
+        std_log_error_m ( "Error importing " std_fmt_str_m, job->input_path );
+        return false;
+    }
+
+    job->has_all_deps = io_context.has_all_deps;
+
+    uint32_t mesh_count = scene->mNumMeshes;
+    uint32_t material_count = scene->mNumMaterials;
+    uint32_t task_count = scene->mNumMeshes + scene->mNumMaterials;
+    uint32_t* vertex_layouts = std_virtual_heap_alloc_array_m ( uint32_t, mesh_count > 0 ? mesh_count : 1 );
+    data_bake_mesh_data_t* meshes = std_virtual_heap_alloc_array_m ( data_bake_mesh_data_t, mesh_count > 0 ? mesh_count : 1 );
+
+    for ( uint32_t i = 0; i < mesh_count; ++i ) {
+        vertex_layouts[i] = data_bake_mesh_vertex_layout ( scene->mMeshes[i] );
+    }
+
+    data_bake_scene_context_t scene_context = {
+        .scene = scene,
+        .input_path = job->input_path,
+        .vertex_layouts = vertex_layouts,
+        .meshes = meshes,
+    };
+
+    // Texture sources get read on the job thread, they're deps of the job too
+    data_bake_texture_t* textures = NULL;
+    uint32_t* material_textures = NULL;
+
+    if ( data_bake_options & data_bake_option_textures_m ) {
+        textures = std_virtual_heap_alloc_array_m ( data_bake_texture_t, material_count * data_bake_texture_usage_count_m + 1 );
+        material_textures = std_virtual_heap_alloc_array_m ( uint32_t, material_count * data_bake_texture_usage_count_m + 1 );
+        scene_context.textures = textures;
+
+        for ( uint32_t i = 0; i < material_count; ++i ) {
+            struct aiString names[data_bake_texture_usage_count_m];
+            data_bake_material_texture_names ( names, scene->mMaterials[i] );
+            uint32_t* ids = &material_textures[i * data_bake_texture_usage_count_m];
+
+            for ( uint32_t usage = 0; usage < data_bake_texture_usage_count_m; ++usage ) {
+                const char* metalness_roughness_name = usage == data_bake_texture_color_m ? names[data_bake_texture_roughness_m].data : "";
+                ids[usage] = names[usage].data[0] ? data_bake_add_texture ( &scene_context, job, usage, names[usage].data, metalness_roughness_name ) : bsf_null_id_m;
+            }
+        }
+
+        scene_context.material_textures = material_textures;
+    }
+
+    if ( !job->has_all_deps ) {
+        std_log_warn_m ( "Too many dependencies for " std_fmt_str_m ", it will be baked on every run", job->input_path );
+    }
+
+    uint32_t texture_count = scene_context.texture_count;
+    uint32_t in_place_count = task_count + texture_count;
+    uint32_t chunk_count = in_place_count + ( ( data_bake_options & data_bake_option_meshlets_m ) ? mesh_count : 0 );
+
+    // Index buffers, LODs included, decide the mesh chunk sizes
+    data_bake_run_chunk_tasks ( &scene_context, data_bake_prepare_mesh_task, mesh_count );
+
+    // Lay out mesh, material and texture chunks up front so that chunk tasks can write their final output in place.
+    // Meshlet chunks are only sized once built, they get appended at the end by the output gather write.
+    uint64_t header_size = sizeof ( bsf_header_t ) + sizeof ( bsf_table_entry_t ) * chunk_count;
+    bsf_table_entry_t* table = std_virtual_heap_alloc_array_m ( bsf_table_entry_t, chunk_count > 0 ? chunk_count : 1 );
+    uint64_t offset = header_size;
+
+    for ( uint32_t i = 0; i < in_place_count; ++i ) {
+        offset = std_align_u64 ( offset, bsf_chunk_align_m );
+        table[i].id = i;
+        table[i].type = i < mesh_count ? bsf_chunk_mesh_m : i < task_count ? bsf_chunk_material_m : bsf_chunk_texture_m;
+        table[i].offset = offset;
+        offset += data_bake_chunk_size ( &scene_context, i );
+    }
+
+    for ( uint32_t i = in_place_count; i < chunk_count; ++i ) {
+        table[i].id = i;
+        table[i].type = bsf_chunk_meshlets_m;
+        table[i].offset = 0;
+    }
+
+    uint64_t in_place_size = offset;
+    char* base = std_virtual_heap_alloc_m ( in_place_size, bsf_chunk_align_m );
+
+    // Zero the alignment padding between chunks
+    uint64_t chunk_end = header_size;
+
+    for ( uint32_t i = 0; i < in_place_count; ++i ) {
+        std_mem_zero ( base + chunk_end, table[i].offset - chunk_end );
+        chunk_end = table[i].offset + data_bake_chunk_size ( &scene_context, i );
+    }
+
+    std_buffer_t* meshlet_chunks = NULL;
+
+    if ( data_bake_options & data_bake_option_meshlets_m ) {
+        meshlet_chunks = std_virtual_heap_alloc_array_m ( std_buffer_t, mesh_count > 0 ? mesh_count : 1 );
+    }
+
+    scene_context.base = base;
+    scene_context.table = table;
+    scene_context.meshlet_chunks = meshlet_chunks;
+    data_bake_run_chunk_tasks ( &scene_context, data_bake_chunk_task, task_count );
+
+    // One texture at a time, each one runs its own block row tasks
+    for ( uint32_t i = 0; i < texture_count; ++i ) {
+        data_bake_write_texture ( base + table[task_count + i].offset, &scene_context, i );
+    }
+
+    for ( uint32_t i = 0; i < mesh_count; ++i ) {
+        std_virtual_heap_free ( meshes[i].remap );
+        std_virtual_heap_free ( meshes[i].indices );
+    }
+
+    // Meshlet chunks go to the file as they are, interleaved with their alignment padding
+    static const uint8_t zero_padding[bsf_chunk_align_m];
+    uint32_t meshlet_chunk_count = chunk_count - in_place_count;
+    std_buffer_t* output_buffers = std_virtual_heap_alloc_array_m ( std_buffer_t, 1 + meshlet_chunk_count * 2 );
+    size_t output_buffer_count = 0;
+    output_buffers[output_buffer_count++] = std_buffer_m ( .base = base, .size = in_place_size );
+    uint64_t total_size = in_place_size;
+
+    for ( uint32_t i = 0; i < meshlet_chunk_count; ++i ) {
+        uint64_t chunk_offset = std_align_u64 ( total_size, bsf_chunk_align_m );
+        output_buffers[output_buffer_count++] = std_buffer_m ( .base = ( void* ) zero_padding, .size = chunk_offset - total_size );
+        output_buffers[output_buffer_count++] = meshlet_chunks[i];
+        table[in_place_count + i].offset = chunk_offset;
+        total_size = chunk_offset + meshlet_chunks[i].size;
+    }
+
+    bsf_header_t header = {
+        .magic = bsf_magic_m,
+        .version = bsf_version_m,
+        .chunk_count = chunk_count,
+        .reserved = 0,
+        .total_size = total_size,
+    };
+    std_mem_copy_m ( base, &header );
+    std_mem_copy_array_m ( base + sizeof ( bsf_header_t ), table, chunk_count );
+
+    aiReleaseImport ( scene );
+    std_virtual_heap_free ( table );
+    std_virtual_heap_free ( vertex_layouts );
+    std_virtual_heap_free ( meshes );
+
+    if ( textures ) {
+        std_virtual_heap_free ( textures );
+        std_virtual_heap_free ( material_textures );
+    }
+
+    char* output_folder = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    std_str_copy ( output_folder, std_path_size_m, job->output_path );
+    std_path_pop ( output_folder );
+
+    std_path_info_t folder_info;
+    if ( output_folder[0] != '\0' && !std_path_info ( &folder_info, output_folder ) ) {
+        std_directory_create ( output_folder );
+    }
+
+    std_virtual_heap_free ( output_folder );
+
+    bool result = data_bake_write_file_buffers ( job->output_path, output_buffers, output_buffer_count );
+
+    for ( uint32_t i = 0; i < meshlet_chunk_count; ++i ) {
+        std_virtual_heap_free ( meshlet_chunks[i].base );
+    }
+
+    if ( meshlet_chunks ) {
+        std_virtual_heap_free ( meshlet_chunks );
+    }
+
+    std_virtual_heap_free ( output_buffers );
+    std_virtual_heap_free ( base );
+
+    if ( !result ) {
+        std_log_error_m ( "Error writing " std_fmt_str_m, job->output_path );
+    }
+
+    return result;
+}
+
+static void data_bake_run_job ( data_bake_job_t* job ) {
+    if ( job->manifest_entry && data_bake_manifest_entry_is_up_to_date ( &job->deps, job->manifest_entry, job->output_path ) ) {
+        job->has_all_deps = true;
+        job->result = data_bake_result_up_to_date_m;
         return;
     }
 
-    uint64_t max_chunk_size = 16ull * 1024 * 1024 * 1024;
-    std_virtual_stack_t stack = std_virtual_stack_create ( max_chunk_size );
-
-    uint32_t chunk_count = scene->mNumMeshes + scene->mNumMaterials + 1;
-    bsf_table_entry_t* table = std_virtual_heap_alloc_array_m ( bsf_table_entry_t, chunk_count );
-    uint32_t global_id = 0;
-
-    // alloc header
-    uint32_t header_size = 20 + 12 * chunk_count;
-    std_virtual_stack_alloc ( &stack, header_size ); // header + table
-
-    for ( uint32_t mesh_it = 0; mesh_it < scene->mNumMeshes; ++mesh_it ) {
-        table[global_id].id = global_id;
-        table[global_id].type = bsf_chunk_mesh_m;
-        table[global_id].offset = std_virtual_stack_used_size ( &stack );
-        ++global_id;
-
-        const struct aiMesh* mesh = scene->mMeshes[mesh_it];
-        uint32_t mesh_id = mesh_it;
-        uint32_t vertex_count = mesh->mNumVertices;
-        uint32_t index_count = mesh->mNumFaces * 3;
-        //uint32_t chunk_size = 12 + vertex_count * ( 12 + 12 + 8 ) + index_count * 4; // 12 = id + vertex_count + index_count
-
-        // mesh id, vertex count, idx count
-        std_virtual_stack_write_m ( &stack, &mesh_id );
-        std_virtual_stack_write_m ( &stack, &vertex_count );
-        std_virtual_stack_write_m ( &stack, &index_count );
-
-        // pos, nor, uv
-        float* f32_data = std_virtual_heap_alloc_array_m ( float, vertex_count * 3 );
-        
-        for ( uint32_t i = 0; i < vertex_count; i += 3 ) {
-            f32_data[i + 0] = mesh->mVertices[i].x;
-            f32_data[i + 1] = mesh->mVertices[i].y;
-            f32_data[i + 2] = mesh->mVertices[i].z;
-        }
-        std_virtual_stack_write_array_m ( &stack, f32_data, vertex_count * 3 );
-        
-        for ( uint32_t i = 0; i < vertex_count; i += 3 ) {
-            f32_data[i + 0] = mesh->mNormals[i].x;
-            f32_data[i + 1] = mesh->mNormals[i].y;
-            f32_data[i + 2] = mesh->mNormals[i].z;
-        }
-        std_virtual_stack_write_array_m ( &stack, f32_data, vertex_count * 3 );
-
-        if ( mesh->mTextureCoords[0] ) {
-            for ( uint32_t i = 0; i < vertex_count; i += 2 ) {
-                f32_data[i + 0] = mesh->mTextureCoords[0][i].x;
-                f32_data[i + 1] = mesh->mTextureCoords[0][i].y;
+    job->deps.count = 0;
+    std_virtual_stack_clear ( &job->deps.paths );
+
+    std_log_info_m ( "Baking " std_fmt_str_m " to " std_fmt_str_m, job->input_path, job->output_path );
+    job->result = data_bake_scene ( job ) ? data_bake_result_baked_m : data_bake_result_failed_m;
+}
+
+static void data_bake_worker_routine ( void* arg ) {
+    data_bake_workers_context_t* context = ( data_bake_workers_context_t* ) arg;
+
+    for ( ;; ) {
+        uint32_t idx = std_atomic_fetch_add_u32 ( &context->next_job, 1 );
+
+        if ( idx >= context->jobs_count ) {
+            break;
+        }
+
+        data_bake_run_job ( &context->jobs_array[idx] );
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Inputs
+
+typedef struct {
+    size_t input_root_len;
+    const char* output_root;
+    std_virtual_stack_t* paths;
+    uint32_t count;
+    // Guards paths and count
+    std_mutex_t mutex;
+} data_bake_walk_context_t;
+
+// One task per folder, allocated by the parent folder task and freed once the folder is scanned
+typedef struct {
+    data_bake_walk_context_t* context;
+    char path[std_path_size_m];
+} data_bake_walk_task_t;
+
+// Replaces the extension, if any, with .bsf
+static void data_bake_output_extension ( char* path, size_t cap ) {
+    size_t len = std_str_len ( path );
+    size_t ext = std_str_find_reverse ( path, len, "." );
+    const char* name = std_path_name_ptr ( path );
+
+    if ( ext == std_str_find_null_m || path + ext < name ) {
+        ext = len;
+    }
+
+    std_str_copy ( path + ext, cap - ext, ".bsf" );
+}
+
+static bool data_bake_is_supported ( const char* name ) {
+    size_t len = std_str_len ( name );
+    size_t ext = std_str_find_reverse ( name, len, "." );
+
+    if ( ext == std_str_find_null_m || ext == 0 ) {
+        return false;
+    }
+
+    return aiIsExtensionSupported ( name + ext ) == AI_TRUE;
+}
+
+static void data_bake_add_input ( data_bake_walk_context_t* context, const char* input_path, const char* output_path ) {
+    std_virtual_stack_string_copy ( context->paths, input_path );
+    std_virtual_stack_string_copy ( context->paths, output_path );
+    ++context->count;
+}
+
+static void data_bake_walk_task ( void* arg ) {
+    data_bake_walk_task_t* task = ( data_bake_walk_task_t* ) arg;
+    data_bake_walk_context_t* context = task->context;
+
+    // Entries come with their type, so the walk never touches the files themselves
+    size_t entries_cap = data_bake_walk_entries_cap_m;
+    std_directory_entry_t* entries = std_virtual_heap_alloc_array_m ( std_directory_entry_t, entries_cap );
+    size_t entries_count = std_directory_scan ( entries, entries_cap, task->path );
+
+    if ( entries_count > entries_cap ) {
+        std_virtual_heap_free ( entries );
+        entries_cap = entries_count;
+        entries = std_virtual_heap_alloc_array_m ( std_directory_entry_t, entries_cap );
+        entries_count = std_min ( std_directory_scan ( entries, entries_cap, task->path ), entries_cap );
+    }
+
+    tk_task_t subfolder_tasks[data_bake_walk_max_subfolder_tasks_m];
+    uint32_t subfolder_tasks_count = 0;
+    char* output_path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    size_t folder_len = std_str_len ( task->path );
+
+    for ( size_t i = 0; i < entries_count; ++i ) {
+        const std_directory_entry_t* entry = &entries[i];
+
+        if ( entry->flags & std_path_is_directory_m ) {
+            data_bake_walk_task_t* subfolder = std_virtual_heap_alloc_struct_m ( data_bake_walk_task_t );
+            subfolder->context = context;
+            std_str_copy ( subfolder->path, std_path_size_m, task->path );
+            std_path_append ( subfolder->path, std_path_size_m, entry->name );
+            subfolder_tasks[subfolder_tasks_count].routine = data_bake_walk_task;
+            subfolder_tasks[subfolder_tasks_count].arg = subfolder;
+
+            if ( ++subfolder_tasks_count == data_bake_walk_max_subfolder_tasks_m ) {
+                data_bake_tk->schedule_work ( subfolder_tasks, subfolder_tasks_count );
+                subfolder_tasks_count = 0;
             }
-        } else {
-            for ( uint32_t i = 0; i < vertex_count; i += 2 ) {
-                f32_data[i + 0] = 0;
-                f32_data[i + 1] = 0;
+        } else if ( ( entry->flags & std_path_is_file_m ) && data_bake_is_supported ( entry->name ) ) {
+            std_path_append ( task->path, std_path_size_m, entry->name );
+
+            if ( context->output_root ) {
+                std_str_copy ( output_path, std_path_size_m, context->output_root );
+                std_path_append ( output_path, std_path_size_m, task->path + context->input_root_len );
+            } else {
+                std_str_copy ( output_path, std_path_size_m, task->path );
             }
+
+            data_bake_output_extension ( output_path, std_path_size_m );
+
+            std_mutex_lock ( &context->mutex );
+            data_bake_add_input ( context, task->path, output_path );
+            std_mutex_unlock ( &context->mutex );
+
+            task->path[folder_len] = '\0';
         }
-        std_virtual_stack_write_array_m ( &stack, f32_data, vertex_count * 2 );
-        
-        std_virtual_heap_free ( f32_data );
-    
-        // idx
-        uint32_t* u32_data = std_virtual_heap_alloc_array_m ( uint32_t, index_count );
-        
-        for ( uint32_t i = 0; i < mesh->mNumFaces; i += 3 ) {
-            struct aiFace face = mesh->mFaces[i];
-            u32_data[i + 0] = face.mIndices[0];
-            u32_data[i + 1] = face.mIndices[1];
-            u32_data[i + 2] = face.mIndices[2];
-        }
-        std_virtual_stack_write_array_m ( &stack, u32_data, index_count );
-        
-        std_virtual_heap_free ( u32_data );
-    }
-
-    // fill header
-    uint32_t magic = bsf_magic_m;
-    uint32_t version = bsf_version_m;
-    uint64_t total_size = std_virtual_stack_used_size ( &stack );
-    std_stack_t header_stack = std_stack ( stack.mapped.begin, header_size );
-    std_stack_write_m ( &header_stack, &magic );
-    std_stack_write_m ( &header_stack, &version );
-    std_stack_write_m ( &header_stack, &chunk_count );
-    std_stack_write_m ( &header_stack, &total_size );
-    std_stack_write_array_m ( &header_stack, table, chunk_count );
-
-    std_log_info_m ( "Writing out scene to " std_fmt_str_m, output_path );
-    std_file_h file = std_file_create ( output_path, std_file_write_m, std_path_already_existing_overwrite_m );
-    std_file_write ( file, stack.mapped.begin, total_size );
-    std_file_close ( file );
+    }
+
+    if ( subfolder_tasks_count > 0 ) {
+        data_bake_tk->schedule_work ( subfolder_tasks, subfolder_tasks_count );
+    }
+
+    std_virtual_heap_free ( output_path );
+    std_virtual_heap_free ( entries );
+    std_virtual_heap_free ( task );
+}
+
+// Walk order depends on scheduling, sorting keeps the jobs and the manifest stable from run to run
+static int data_bake_job_compare ( const void* a, const void* b, const void* arg ) {
+    std_unused_m ( arg );
+    const data_bake_job_t* job_a = ( const data_bake_job_t* ) a;
+    const data_bake_job_t* job_b = ( const data_bake_job_t* ) b;
+    return std_str_cmp ( job_a->input_path, job_b->input_path );
+}
+
+// ------------------------------------------------------------------------------------------------
+
+void std_main ( void ) {
+    std_log_info_m ( std_binding_assimp_models_m );
+    std_process_info_t process_info;
+    std_process_info ( &process_info, std_process_this() );
+
+    const char* input_path = NULL;
+    const char* output_path = NULL;
+    data_bake_options = 0;
+
+    for ( size_t i = 0; i < process_info.args_count; ++i ) {
+        const char* arg = process_info.args[i];
+
+        if ( std_str_cmp ( arg, "--meshlets" ) == 0 ) {
+            data_bake_options |= data_bake_option_meshlets_m;
+        } else if ( std_str_cmp ( arg, "--packed" ) == 0 ) {
+            data_bake_options |= data_bake_option_packed_vertices_m;
+        } else if ( std_str_cmp ( arg, "--lods" ) == 0 ) {
+            data_bake_options |= data_bake_option_lods_m;
+        } else if ( std_str_cmp ( arg, "--textures" ) == 0 ) {
+            data_bake_options |= data_bake_option_textures_m;
+        } else if ( input_path == NULL ) {
+            input_path = arg;
+        } else if ( output_path == NULL ) {
+            output_path = arg;
+        }
+    }
+
+    if ( input_path == NULL ) {
+        std_log_error_m ( "Usage: data_bake [--meshlets] [--packed] [--lods] [--textures] <input file or folder> [output file or folder]" );
+        return;
+    }
+
+    std_path_info_t path_info;
+    bool result = std_path_info ( &path_info, input_path );
+
+    if ( !result || ( path_info.flags & std_path_non_existent_m ) ) {
+        std_log_error_m ( "Input path not found" );
+        return;
+    }
+
+    std_tick_t start_tick = std_tick_now();
+
+    // Both the input walk and the bakes run on tk
+    data_bake_tk = std_module_load_m ( tk_module_name_m );
+
+    size_t core_count = std_platform_logical_cores_info ( NULL, 0 );
+    uint32_t thread_count = core_count > 1 ? ( uint32_t ) core_count - 1 : 1;
+    thread_count = thread_count < tk_max_threads_m ? thread_count : tk_max_threads_m;
+
+    tk_thread_pool_params_t pool = {
+        .thread_count = thread_count,
+        .core_lock = false,
+    };
+    data_bake_tk->init_thread_pool ( &pool );
+
+    // Collect the inputs, paths are stored as input/output string pairs
+    std_virtual_stack_t paths = std_virtual_stack_create ( 1024 * 1024 * 1024 );
+    char* manifest_path = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+
+    data_bake_walk_context_t walk_context = {
+        .input_root_len = 0,
+        .output_root = output_path,
+        .paths = &paths,
+        .count = 0,
+    };
+    std_mutex_init ( &walk_context.mutex );
+
+    if ( path_info.flags & std_path_is_directory_m ) {
+        data_bake_walk_task_t* root = std_virtual_heap_alloc_struct_m ( data_bake_walk_task_t );
+        root->context = &walk_context;
+        std_str_copy ( root->path, std_path_size_m, input_path );
+        walk_context.input_root_len = std_str_len ( root->path );
+
+        tk_task_t root_task = {
+            .routine = data_bake_walk_task,
+            .arg = root,
+        };
+        data_bake_tk->schedule_work ( &root_task, 1 );
+        data_bake_tk->acquire_this_thread ( tk_release_condition_all_workloads_done_m, NULL );
+
+        std_str_copy ( manifest_path, std_path_size_m, output_path ? output_path : input_path );
+    } else {
+        char* output_file = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+
+        if ( output_path ) {
+            std_str_copy ( output_file, std_path_size_m, output_path );
+        } else {
+            std_str_copy ( output_file, std_path_size_m, input_path );
+            data_bake_output_extension ( output_file, std_path_size_m );
+        }
+
+        data_bake_add_input ( &walk_context, input_path, output_file );
+
+        std_str_copy ( manifest_path, std_path_size_m, output_file );
+        std_path_pop ( manifest_path );
+        std_virtual_heap_free ( output_file );
+    }
+
+    std_mutex_deinit ( &walk_context.mutex );
+
+    if ( manifest_path[0] != '\0' && !std_path_info ( &path_info, manifest_path ) ) {
+        std_directory_create ( manifest_path );
+    }
+
+    std_path_append ( manifest_path, std_path_size_m, data_bake_manifest_name_m );
+
+    data_bake_manifest_t manifest;
+    data_bake_manifest_load ( &manifest, manifest_path, data_bake_options );
+
+    uint32_t jobs_count = walk_context.count;
+    data_bake_job_t* jobs_array = std_virtual_heap_alloc_array_m ( data_bake_job_t, jobs_count > 0 ? jobs_count : 1 );
+    const char* path = ( const char* ) paths.begin;
+
+    for ( uint32_t i = 0; i < jobs_count; ++i ) {
+        data_bake_job_t* job = &jobs_array[i];
+        job->input_path = path;
+        path += std_str_len ( path ) + 1;
+        job->output_path = path;
+        path += std_str_len ( path ) + 1;
+    }
+
+    data_bake_job_t sort_tmp;
+    std_sort_quick ( jobs_array, sizeof ( data_bake_job_t ), jobs_count, data_bake_job_compare, NULL, &sort_tmp );
+
+    for ( uint32_t i = 0; i < jobs_count; ++i ) {
+        data_bake_job_t* job = &jobs_array[i];
+        data_bake_manifest_entry_t* entry = data_bake_manifest_find ( &manifest, job->input_path );
+
+        if ( entry ) {
+            entry->is_used = true;
+        }
+
+        job->manifest_entry = entry;
+        job->has_all_deps = false;
+        job->result = data_bake_result_failed_m;
+        data_bake_dependency_list_init ( &job->deps );
+    }
+
+    std_log_info_m ( "Found " std_fmt_u32_m " input scenes", jobs_count );
+
+    // One worker task per thread, each pulls inputs until none are left. This keeps the number of tasks blocked
+    // waiting on their chunk tasks bounded by the thread count.
+    data_bake_workers_context_t workers_context = {
+        .jobs_array = jobs_array,
+        .jobs_count = jobs_count,
+        .next_job = 0,
+    };
+
+    uint32_t workers_count = thread_count + 1;
+    workers_count = workers_count < jobs_count ? workers_count : jobs_count;
+
+    if ( workers_count > 0 ) {
+        tk_task_t workers[tk_max_threads_m + 1];
+
+        for ( uint32_t i = 0; i < workers_count; ++i ) {
+            workers[i].routine = data_bake_worker_routine;
+            workers[i].arg = &workers_context;
+        }
+
+        data_bake_tk->schedule_work ( workers, workers_count );
+        data_bake_tk->acquire_this_thread ( tk_release_condition_all_workloads_done_m, NULL );
+    }
+
+    data_bake_tk->stop();
+    std_module_unload_m ( tk_module_name_m );
+
+    // Rewrite the manifest. Entries for inputs that were not part of this run are kept as they are.
+    std_virtual_stack_t manifest_text = std_virtual_stack_create ( 1024 * 1024 * 1024 );
+    data_bake_manifest_append_header ( &manifest_text, data_bake_options );
+    uint32_t baked_count = 0;
+    uint32_t up_to_date_count = 0;
+    uint32_t failed_count = 0;
+
+    for ( uint32_t i = 0; i < jobs_count; ++i ) {
+        data_bake_job_t* job = &jobs_array[i];
+
+        if ( job->result == data_bake_result_baked_m ) {
+            ++baked_count;
+        } else if ( job->result == data_bake_result_up_to_date_m ) {
+            ++up_to_date_count;
+        } else {
+            ++failed_count;
+        }
+
+        if ( job->result != data_bake_result_failed_m && job->has_all_deps ) {
+            data_bake_manifest_append_entry ( &manifest_text, job->input_path, job->output_path, &job->deps );
+        }
+
+        data_bake_dependency_list_deinit ( &job->deps );
+    }
+
+    for ( uint32_t i = 0; i < manifest.entries_count; ++i ) {
+        if ( !manifest.entries_array[i].is_used ) {
+            data_bake_manifest_append_raw_entry ( &manifest_text, &manifest.entries_array[i] );
+        }
+    }
+
+    if ( !data_bake_manifest_write ( manifest_path, &manifest_text ) ) {
+        std_log_warn_m ( "Failed to write bake manifest " std_fmt_str_m, manifest_path );
+    }
+
+    std_virtual_stack_destroy ( &manifest_text );
+    data_bake_manifest_unload ( &manifest );
+    std_virtual_heap_free ( jobs_array );
+    std_virtual_heap_free ( manifest_path );
+    std_virtual_stack_destroy ( &paths );
+
+    std_tick_t end_tick = std_tick_now();
+    float time_ms = std_tick_to_milli_f32 ( end_tick - start_tick );
+    std_log_info_m ( "Baked " std_fmt_u32_m ", up to date " std_fmt_u32_m ", failed " std_fmt_u32_m " in " std_fmt_f32_dec_m(3) "s", baked_count, up_to_date_count, failed_count, time_ms / 1000.f );
 }
@@ -9,6 +9,7 @@
 #include <sm_quat.h>
 
 #include <viewapp_state.h>
+#include <viewapp_scene.h>
 
 typedef struct {
     sm_mat_4x4f_t world;
@@ -82,9 +83,10 @@ static void geometry_pass ( const xf_node_execute_args_t* node_args, void* user_
             .r2[3] = mesh_component->prev_transform.position[2],
         };
 
+        sm_mat_4x4f_t dequantize = viewapp_mesh_dequantize_matrix ( &mesh_component->geo_gpu_data );
         geometry_vertex_uniforms_t vs = {
-            .world = sm_matrix_4x4f_mul ( trans, rot ),
-            .prev_world = sm_matrix_4x4f_mul ( prev_trans, prev_rot ),
+            .world = sm_matrix_4x4f_mul ( sm_matrix_4x4f_mul ( trans, rot ), dequantize ),
+            .prev_world = sm_matrix_4x4f_mul ( sm_matrix_4x4f_mul ( prev_trans, prev_rot ), dequantize ),
         };
 
         geometry_fragment_uniforms_t fs = {
@@ -110,6 +112,11 @@ static void geometry_pass ( const xf_node_execute_args_t* node_args, void* user_
             normal_texture = xg->get_default_texture ( node_args->device, xg_default_texture_r8g8b8a8_unorm_tbn_up_m );
         }
 
+        xg_texture_h roughness_texture = mesh_component->material.roughness_texture;
+        if ( roughness_texture == xg_null_handle_m ) {
+            roughness_texture = xg->get_default_texture ( node_args->device, xg_default_texture_r8g8b8a8_unorm_white_m );
+        }
+
         // Bind draw resources
         xg_resource_bindings_h draw_bindings = xg->cmd_create_workload_bindings ( resource_cmd_buffer, &xg_resource_bindings_params_m (
             .layout = xg->get_pipeline_resource_layout ( pipeline_state, xg_shader_binding_set_dispatch_m ),
@@ -125,7 +132,7 @@ static void geometry_pass ( const xf_node_execute_args_t* node_args, void* user_
                         .range = xg->write_workload_uniform ( workload, &fs, sizeof ( fs ) ),
                     )
                 },
-                .texture_count = 2,
+                .texture_count = 3,
                 .textures = {
                     xg_texture_resource_binding_m (
                         .shader_register = 2,
@@ -137,22 +144,32 @@ static void geometry_pass ( const xf_node_execute_args_t* node_args, void* user_
                         .layout = xg_texture_layout_shader_read_m,
                         .texture = normal_texture,
                     ),
+                    xg_texture_resource_binding_m (
+                        .shader_register = 4,
+                        .layout = xg_texture_layout_shader_read_m,
+                        .texture = roughness_texture,
+                    ),
                 },
                 .sampler_count = 1,
                 .samplers = {
                     xg_sampler_resource_binding_m (
-                        .shader_register = 4,
+                        .shader_register = 5,
                         .sampler = xg->get_default_sampler ( node_args->device, xg_default_sampler_linear_wrap_m ),
                     ),
                 }
             )
         ) );
 
+        uint32_t index_offset;
+        uint32_t primitive_count;
+        viewapp_mesh_draw_range ( &index_offset, &primitive_count, mesh_component );
+
         xg->cmd_draw ( cmd_buffer, key, &xg_cmd_draw_params_m (
             .pipeline = pipeline_state,
             .bindings[xg_shader_binding_set_dispatch_m] = draw_bindings,
             .index_buffer = mesh_component->geo_gpu_data.idx_buffer,
-            .primitive_count = mesh_component->geo_data.index_count / 3,
+            .index_offset = index_offset,
+            .primitive_count = primitive_count,
             .vertex_buffers_count = 5,
             .vertex_buffers = { 
                 mesh_component->geo_gpu_data.pos_buffer, 
@@ -267,7 +284,7 @@ static void object_id_pass ( const xf_node_execute_args_t* node_args, void* user
         };
 
         object_id_vertex_uniforms_t vs = {
-            .world = sm_matrix_4x4f_mul ( trans, rot ),
+            .world = sm_matrix_4x4f_mul ( sm_matrix_4x4f_mul ( trans, rot ), viewapp_mesh_dequantize_matrix ( &mesh_component->geo_gpu_data ) ),
         };
 
         object_id_fragment_uniforms_t fs = {
@@ -292,11 +309,16 @@ static void object_id_pass ( const xf_node_execute_args_t* node_args, void* user
             )
         ) );
 
+        uint32_t index_offset;
+        uint32_t primitive_count;
+        viewapp_mesh_draw_range ( &index_offset, &primitive_count, mesh_component );
+
         xg->cmd_draw ( cmd_buffer, key, &xg_cmd_draw_params_m (
             .pipeline = pipeline_state,
             .bindings[xg_shader_binding_set_dispatch_m] = draw_bindings,
             .index_buffer = mesh_component->geo_gpu_data.idx_buffer,
-            .primitive_count = mesh_component->geo_data.index_count / 3,
+            .index_offset = index_offset,
+            .primitive_count = primitive_count,
             .vertex_buffers_count = 1,
             .vertex_buffers = { mesh_component->geo_gpu_data.pos_buffer },
         ) );
@@ -17,6 +17,7 @@ typedef struct {
     float albedo[3];
     float emissive[3];
     uint32_t id;
+    uint32_t vertex_layout; // xg_geo_util_vertex_layout_e
 } instance_data_t;
 
 typedef struct {
@@ -77,6 +78,7 @@ static void raytrace_setup_pass ( const xf_node_execute_args_t* node_args, void*
         instance_data[i].emissive[2] = mesh_component->material.emissive[2];
 
         instance_data[i].id = mesh_component->object_id;
+        instance_data[i].vertex_layout = mesh_component->geo_gpu_data.vertex_layout;
     }
 
     xg_buffer_range_t instance_buffer_range = xg->write_workload_staging ( node_args->workload, instance_data, instance_data_size );
@@ -1,6 +1,7 @@
 #include <shadow_pass.h>
 
 #include <viewapp_state.h>
+#include <viewapp_scene.h>
 
 #include <sm_matrix.h>
 #include <sm_quat.h>
@@ -139,7 +140,7 @@ static void shadow_pass_routine ( const xf_node_execute_args_t* node_args, void*
                 };
 
                 draw_uniforms_t draw_uniforms = {
-                    .world = sm_matrix_4x4f_mul ( trans, rot ),
+                    .world = sm_matrix_4x4f_mul ( sm_matrix_4x4f_mul ( trans, rot ), viewapp_mesh_dequantize_matrix ( &mesh_component->geo_gpu_data ) ),
                 };
 
                 xg_resource_bindings_h draw_bindings = xg->cmd_create_workload_bindings ( resource_cmd_buffer, &xg_resource_bindings_params_m (
@@ -153,13 +154,18 @@ static void shadow_pass_routine ( const xf_node_execute_args_t* node_args, void*
                     )
                 ) );
 
+                uint32_t index_offset;
+                uint32_t primitive_count;
+                viewapp_mesh_draw_range ( &index_offset, &primitive_count, mesh_component );
+
                 xg->cmd_draw ( cmd_buffer, key, &xg_cmd_draw_params_m (
                     .pipeline = pipeline_state,
                     .bindings = { xg_null_handle_m, pass_bindings, xg_null_handle_m, draw_bindings },
                     .vertex_buffers_count = 2,
                     .vertex_buffers = { mesh_component->geo_gpu_data.pos_buffer, mesh_component->geo_gpu_data.nor_buffer },
                     .index_buffer = mesh_component->geo_gpu_data.idx_buffer,
-                    .primitive_count = mesh_component->geo_data.index_count / 3,
+                    .index_offset = index_offset,
+                    .primitive_count = primitive_count,
                 ) );
             }
         }
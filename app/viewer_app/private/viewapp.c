@@ -398,6 +398,25 @@ static void viewapp_update_lights ( void ) {
 static void viewapp_update_meshes ( void ) {
     viewapp_state_t* state = viewapp_state_get();
     se_i* se = state->modules.se;
+    rv_i* rv = state->modules.rv;
+
+    // LODs are selected once per frame against the main camera. Every pass draws the same LOD, so shadows and
+    // object ids always match the shaded geometry.
+    rv_view_info_t view_info;
+    bool has_view = false;
+
+    se_query_result_t camera_query_result;
+    se->query_entities ( &camera_query_result, &se_query_params_m ( .component_count = 1, .components = { viewapp_camera_component_id_m } ) );
+    se_stream_iterator_t camera_iterator = se_component_iterator_m ( &camera_query_result.components[0], 0 );
+
+    for ( uint32_t i = 0; i < camera_query_result.entity_count && !has_view; ++i ) {
+        viewapp_camera_component_t* camera_component = se_stream_iterator_next ( &camera_iterator );
+
+        if ( camera_component->enabled ) {
+            rv->get_view_info ( &view_info, camera_component->view );
+            has_view = true;
+        }
+    }
 
     se_query_result_t mesh_query_result;
     se->query_entities ( &mesh_query_result, &se_query_params_m ( 
@@ -407,11 +426,19 @@ static void viewapp_update_meshes ( void ) {
     se_stream_iterator_t mesh_iterator = se_component_iterator_m ( &mesh_query_result.components[0], 0 );
     se_stream_iterator_t transform_iterator = se_component_iterator_m ( &mesh_query_result.components[1], 0 );
 
+    state->render.mesh_triangle_count = 0;
+
     for ( uint32_t i = 0; i < mesh_query_result.entity_count; ++i ) {
         viewapp_mesh_component_t* mesh_component = se_stream_iterator_next ( &mesh_iterator );
         viewapp_transform_component_t* transform_component = se_stream_iterator_next ( &transform_iterator );
         mesh_component->prev_transform = *transform_component;
         // TODO update transform...
+        mesh_component->lod = has_view ? viewapp_mesh_select_lod ( mesh_component, transform_component, &view_info, ( float ) state->render.resolution_y, state->render.lod_pixel_error ) : 0;
+
+        uint32_t index_offset;
+        uint32_t primitive_count;
+        viewapp_mesh_draw_range ( &index_offset, &primitive_count, mesh_component );
+        state->render.mesh_triangle_count += primitive_count;
     }
 }
 
@@ -531,6 +558,7 @@ static std_app_state_e viewapp_update ( void ) {
 
     viewapp_update_camera ( input_state, &new_input_state, delta_ms * 1000 );
 
+    viewapp_update_texture_uploads ( workload );
     viewapp_update_meshes();
     viewapp_update_lights();
     viewapp_update_ui ( &new_window_info, input_state, &new_input_state, workload );
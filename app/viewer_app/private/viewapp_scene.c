@@ -7,6 +7,7 @@
 #include "viewapp_state.h"
 
 #include <sm.h>
+#include <bsf.h>
 #include <std_file.h>
 
 static void viewapp_build_mesh_raytrace_geo ( xg_workload_h workload, se_entity_h entity, viewapp_mesh_component_t* mesh ) {
@@ -21,11 +22,13 @@ static void viewapp_build_mesh_raytrace_geo ( xg_workload_h workload, se_entity_
     se_entity_properties_t entity_properties;
     se->get_entity_properties ( &entity_properties, entity );
 
+    // Packed positions are built quantized, the instance transform includes the dequantization
+    bool is_packed = mesh->geo_gpu_data.vertex_layout == xg_geo_util_vertex_layout_packed_m;
     xg_raytrace_geometry_data_t rt_data = xg_raytrace_geometry_data_m (
         .vertex_buffer = mesh->geo_gpu_data.pos_buffer,
-        .vertex_format = xg_format_r32g32b32_sfloat_m,
+        .vertex_format = is_packed ? xg_format_r16g16b16a16_snorm_m : xg_format_r32g32b32_sfloat_m,
         .vertex_count = mesh->geo_data.vertex_count,
-        .vertex_stride = 12,
+        .vertex_stride = is_packed ? 8 : 12,
         .index_buffer = mesh->geo_gpu_data.idx_buffer,
         .index_count = mesh->geo_data.index_count,
     );
@@ -109,7 +112,7 @@ void viewapp_build_raytrace_world ( xg_workload_h workload ) {
             .r2[3] = transform_component->position[2],
         };
 
-        sm_mat_4x4f_t world_matrix = sm_matrix_4x4f_mul ( trans, rot );
+        sm_mat_4x4f_t world_matrix = sm_matrix_4x4f_mul ( sm_matrix_4x4f_mul ( trans, rot ), viewapp_mesh_dequantize_matrix ( &mesh_component->geo_gpu_data ) );
         xg_matrix_3x4_t transform;
         std_mem_copy ( transform.f, world_matrix.e, sizeof ( float ) * 12 );
 
@@ -752,6 +755,11 @@ static viewapp_texture_t viewapp_import_texture ( const struct aiScene* scene, c
 
     uint64_t star_idx = std_str_find ( path, "*" );
     if ( star_idx != std_str_find_null_m ) {
+        // Baked scenes don't carry an aiScene to read embedded textures from
+        if ( !scene ) {
+            std_log_warn_m ( "Embedded texture " std_fmt_str_m " can't be loaded without its scene, skipping", path );
+            return ( viewapp_texture_t ) {0};
+        }
         channels = 4; // TODO
         uint32_t texture_idx = std_str_to_u32 ( path + star_idx );
         std_assert_m ( texture_idx < scene->mNumTextures );
@@ -795,90 +803,338 @@ static viewapp_texture_t viewapp_import_texture ( const struct aiScene* scene, c
     return texture;
 }
 
-static xg_texture_h viewapp_upload_texture_to_gpu ( xg_cmd_buffer_h cmd_buffer, uint64_t key, xg_resource_cmd_buffer_h resource_cmd_buffer, const viewapp_texture_t* texture, const char* name ) {
+// Expects mip 0 to be in copy dest layout, leaves all mips in shader read layout
+static viewapp_texture_upload_t* viewapp_upload_texture_to_gpu ( const viewapp_texture_t* texture, const char* name, viewapp_material_texture_e slot ) {
     viewapp_state_t* state = viewapp_state_get();
-    uint32_t mip_levels = texture->width > ( 1 << 7 ) ? 7 : 1;
+    // Full mip chain, floor ( log2 ( max_size ) ) + 1
+    uint32_t mip_levels = 32 - std_bit_scan_rev_32 ( std_max_u32 ( ( uint32_t ) texture->width, ( uint32_t ) texture->height ) );
     xg_i* xg = state->modules.xg;
+    // Mips get generated in a compute pass when the format can be written as storage, otherwise they're blitted
+    bool compute_mips = mip_levels > 1 && ( xg->get_format_texture_usage ( state->render.device, texture->format ) & xg_texture_usage_bit_storage_m );
     xg_texture_params_t params = xg_texture_params_m ( 
         .memory_type = xg_memory_type_gpu_only_m,
         .device = state->render.device,
         .width = texture->width,
         .height = texture->height,
         .format = texture->format,
-        .allowed_usage = xg_texture_usage_bit_sampled_m | xg_texture_usage_bit_copy_dest_m | xg_texture_usage_bit_copy_source_m,
+        .allowed_usage = xg_texture_usage_bit_sampled_m | xg_texture_usage_bit_copy_dest_m | xg_texture_usage_bit_copy_source_m | ( compute_mips ? xg_texture_usage_bit_storage_m : 0 ),
         .mip_levels = mip_levels,
+        .view_access = compute_mips ? xg_texture_view_access_separate_mips_m : xg_texture_view_access_default_only_m,
     );
     std_str_copy_static_m ( params.debug_name, name );
     //std_path_name ( params.debug_name, sizeof ( params.debug_name ), path );
 
-    xg_texture_h texture_handle = xg->cmd_create_texture ( resource_cmd_buffer, &params, &xg_texture_init_m (
-        .mode = xg_texture_init_mode_upload_m,
-        .upload_data = texture->data,
+    xg_texture_h texture_handle = xg->create_texture ( &params );
+
+    // Only mip 0 gets uploaded, the rest is generated on the graphics queue once the upload is complete
+    xg_upload_h upload = xg->upload_texture ( &xg_upload_texture_params_m (
+        .texture = texture_handle,
+        .mip_count = 1,
+        .data = texture->data,
         .final_layout = mip_levels > 1 ? xg_texture_layout_copy_dest_m : xg_texture_layout_shader_read_m,
     ) );
 
-    if ( mip_levels > 1 ) {
-        for ( uint32_t i = 1; i < mip_levels; ++i ) {
-            xg->cmd_barrier_set ( cmd_buffer, key, &xg_barrier_set_m (
-                .texture_memory_barriers_count = 1,
-                .texture_memory_barriers = &xg_texture_memory_barrier_m (
-                    .texture = texture_handle,
-                    .mip_base = i - 1,
-                    .mip_count = 1,
-                    .layout.old = xg_texture_layout_copy_dest_m,
-                    .layout.new = xg_texture_layout_copy_source_m,
-                    .memory.flushes = xg_memory_access_bit_transfer_write_m,
-                    .memory.invalidations = xg_memory_access_bit_transfer_read_m,
-                    .execution.blocker = xg_pipeline_stage_bit_transfer_m,
-                    .execution.blocked = xg_pipeline_stage_bit_transfer_m,
-                ),
-            ) );
+    // Rejected uploads are still tracked, their texture gets dropped on the next update and the material keeps the default
+    if ( upload == xg_null_handle_m ) {
+        std_log_warn_m ( "Texture " std_fmt_str_m " could not be uploaded", name );
+    }
+
+    std_assert_m ( state->scene.texture_uploads_count < viewapp_max_texture_uploads_m );
+    viewapp_texture_upload_t* texture_upload = &state->scene.texture_uploads[state->scene.texture_uploads_count++];
+    *texture_upload = ( viewapp_texture_upload_t ) {
+        .upload = upload,
+        .texture = texture_handle,
+        .data = texture->data,
+        .mip_levels = mip_levels,
+        .generate_mips = mip_levels > 1,
+        .entity = se_null_handle_m,
+        .slot = slot,
+    };
+    return texture_upload;
+}
+
+static xg_format_e viewapp_baked_texture_format ( uint32_t format ) {
+    switch ( format ) {
+    case bsf_texture_format_bc1_m:
+        return xg_format_bc1_rgb_unorm_block_m;
+    case bsf_texture_format_bc4_m:
+        return xg_format_bc4_unorm_block_m;
+    case bsf_texture_format_bc5_m:
+        return xg_format_bc5_unorm_block_m;
+    case bsf_texture_format_bc7_m:
+        return xg_format_bc7_unorm_block_m;
+    default:
+        return xg_format_undefined_m;
+    }
+}
+
+// Baked textures come with all their mips, the blocks are uploaded as they are. The data is copied out of the bsf
+// mapping since the upload can outlive it.
+static viewapp_texture_upload_t* viewapp_upload_baked_texture ( const bsf_texture_view_t* view, viewapp_material_texture_e slot ) {
+    viewapp_state_t* state = viewapp_state_get();
+    xg_i* xg = state->modules.xg;
+    const bsf_texture_header_t* header = view->header;
+
+    xg_texture_params_t params = xg_texture_params_m (
+        .memory_type = xg_memory_type_gpu_only_m,
+        .device = state->render.device,
+        .width = header->width,
+        .height = header->height,
+        .format = viewapp_baked_texture_format ( header->format ),
+        .allowed_usage = xg_texture_usage_bit_sampled_m | xg_texture_usage_bit_copy_dest_m,
+        .mip_levels = header->mip_count,
+        .view_access = xg_texture_view_access_default_only_m,
+    );
+    std_str_copy_static_m ( params.debug_name, header->name );
+
+    xg_texture_h texture_handle = xg->create_texture ( &params );
+
+    char* data = std_virtual_heap_alloc_array_m ( char, view->data_size );
+    std_mem_copy ( data, view->data, view->data_size );
+
+    xg_upload_h upload = xg->upload_texture ( &xg_upload_texture_params_m (
+        .texture = texture_handle,
+        .mip_count = header->mip_count,
+        .data = data,
+        .final_layout = xg_texture_layout_shader_read_m,
+    ) );
+
+    if ( upload == xg_null_handle_m ) {
+        std_log_warn_m ( "Texture " std_fmt_str_m " could not be uploaded", header->name );
+    }
 
-            xg->cmd_copy_texture ( cmd_buffer, key, &xg_texture_copy_params_m (
-                .source = xg_texture_copy_resource_m ( .texture = texture_handle, .mip_base = i - 1 ),
-                .destination = xg_texture_copy_resource_m ( .texture = texture_handle, .mip_base = i ),
-                .mip_count = 1,
-                .filter = xg_sampler_filter_linear_m,
+    std_assert_m ( state->scene.texture_uploads_count < viewapp_max_texture_uploads_m );
+    viewapp_texture_upload_t* texture_upload = &state->scene.texture_uploads[state->scene.texture_uploads_count++];
+    *texture_upload = ( viewapp_texture_upload_t ) {
+        .upload = upload,
+        .texture = texture_handle,
+        .data = data,
+        .mip_levels = header->mip_count,
+        .generate_mips = false,
+        .entity = se_null_handle_m,
+        .slot = slot,
+    };
+    return texture_upload;
+}
+
+void viewapp_update_texture_uploads ( xg_workload_h workload ) {
+    viewapp_state_t* state = viewapp_state_get();
+    xg_i* xg = state->modules.xg;
+    se_i* se = state->modules.se;
+    xs_i* xs = state->modules.xs;
+
+    xg->update_uploads ( state->render.device );
+
+    xg_cmd_buffer_h cmd_buffer = xg_null_handle_m;
+    xg_resource_cmd_buffer_h resource_cmd_buffer = xg_null_handle_m;
+    uint32_t i = 0;
+
+    while ( i < state->scene.texture_uploads_count ) {
+        viewapp_texture_upload_t* texture_upload = &state->scene.texture_uploads[i];
+        xg_upload_status_e status = xg->get_upload_status ( texture_upload->upload );
+
+        if ( status != xg_upload_status_queued_m && texture_upload->data ) {
+            std_virtual_heap_free ( texture_upload->data );
+            texture_upload->data = NULL;
+        }
+
+        if ( status == xg_upload_status_failed_m ) {
+            if ( resource_cmd_buffer == xg_null_handle_m ) {
+                resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+            }
+
+            xg->cmd_destroy_texture ( resource_cmd_buffer, texture_upload->texture, xg_resource_cmd_buffer_time_workload_start_m );
+            state->scene.texture_uploads[i] = state->scene.texture_uploads[--state->scene.texture_uploads_count];
+            continue;
+        }
+
+        if ( status != xg_upload_status_complete_m ) {
+            ++i;
+            continue;
+        }
+
+        if ( cmd_buffer == xg_null_handle_m ) {
+            cmd_buffer = xg->create_cmd_buffer ( workload );
+        }
+
+        if ( texture_upload->generate_mips ) {
+            xg->cmd_generate_texture_mips ( cmd_buffer, 0, &xg_cmd_generate_texture_mips_params_m (
+                .texture = texture_upload->texture,
+                .source_layout = xg_texture_layout_copy_dest_m,
+                .final_layout = xg_texture_layout_shader_read_m,
+                .pipeline = xs->get_pipeline_state ( xs->get_database_pipeline ( state->render.sdb, xs_hash_static_string_m ( "mip_gen" ) ) ),
             ) );
         }
 
-        xg->cmd_barrier_set ( cmd_buffer, key, &xg_barrier_set_m (
-            .texture_memory_barriers_count = 2,
-            .texture_memory_barriers = ( xg_texture_memory_barrier_t[2] ) { 
-                xg_texture_memory_barrier_m (
-                    .texture = texture_handle,
-                    .mip_base = 0,
-                    .mip_count = mip_levels - 1,
-                    .layout.old = xg_texture_layout_copy_source_m,
-                    .layout.new = xg_texture_layout_shader_read_m,
-                    .memory.flushes = xg_memory_access_bit_transfer_write_m,
-                    .memory.invalidations = xg_memory_access_bit_shader_read_m,
-                    .execution.blocker = xg_pipeline_stage_bit_transfer_m,
-                    .execution.blocked = xg_pipeline_stage_bit_fragment_shader_m,
-                ),
-                xg_texture_memory_barrier_m (
-                    .texture = texture_handle,
-                    .mip_base = mip_levels - 1,
-                    .mip_count = 1,
-                    .layout.old = xg_texture_layout_copy_dest_m,
-                    .layout.new = xg_texture_layout_shader_read_m,
-                    .memory.flushes = xg_memory_access_bit_transfer_write_m,
-                    .memory.invalidations = xg_memory_access_bit_shader_read_m,
-                    .execution.blocker = xg_pipeline_stage_bit_transfer_m,
-                    .execution.blocked = xg_pipeline_stage_bit_fragment_shader_m,
+        viewapp_mesh_component_t* mesh_component = se->get_entity_component ( texture_upload->entity, viewapp_mesh_component_id_m, 0 );
+        if ( texture_upload->slot == viewapp_material_texture_color_m ) {
+            mesh_component->material.color_texture = texture_upload->texture;
+        } else if ( texture_upload->slot == viewapp_material_texture_normal_m ) {
+            mesh_component->material.normal_texture = texture_upload->texture;
+        } else {
+            mesh_component->material.roughness_texture = texture_upload->texture;
+        }
+
+        state->scene.texture_uploads[i] = state->scene.texture_uploads[--state->scene.texture_uploads_count];
+    }
+}
+
+// Drops all in-progress texture uploads, destroying textures not yet bound to a material
+static void viewapp_cancel_texture_uploads ( xg_resource_cmd_buffer_h resource_cmd_buffer ) {
+    viewapp_state_t* state = viewapp_state_get();
+    xg_i* xg = state->modules.xg;
+
+    xg->wait_all_uploads ( state->render.device );
+
+    for ( uint32_t i = 0; i < state->scene.texture_uploads_count; ++i ) {
+        viewapp_texture_upload_t* texture_upload = &state->scene.texture_uploads[i];
+        if ( texture_upload->data ) {
+            std_virtual_heap_free ( texture_upload->data );
+        }
+        xg->cmd_destroy_texture ( resource_cmd_buffer, texture_upload->texture, xg_resource_cmd_buffer_time_workload_start_m );
+    }
+
+    state->scene.texture_uploads_count = 0;
+}
+
+static void viewapp_texture_path ( char* texture_path, const char* scene_path, const char* name ) {
+    std_path_normalize ( texture_path, 256, scene_path );
+    size_t len = std_path_pop ( texture_path );
+    std_path_append ( texture_path, 256 - len, name );
+}
+
+// Texture names are relative to the scene file, empty if missing. Metalness and roughness come packed in a single
+// texture and get moved to the alpha channel of the color and normal textures.
+static uint32_t viewapp_upload_material_textures ( viewapp_texture_upload_t** texture_uploads, const struct aiScene* scene, const char* scene_path, const char* color_name, const char* normal_name, const char* metalness_roughness_name ) {
+    uint32_t texture_uploads_count = 0;
+    char texture_path[256];
+
+    viewapp_texture_t color_texture = {};
+    if ( color_name[0] ) {
+        viewapp_texture_path ( texture_path, scene_path, color_name );
+        color_texture = viewapp_import_texture ( scene, texture_path );
+    }
+
+    viewapp_texture_t normal_texture = {};
+    if ( normal_name[0] ) {
+        viewapp_texture_path ( texture_path, scene_path, normal_name );
+        normal_texture = viewapp_import_texture ( scene, texture_path );
+    }
+
+    if ( metalness_roughness_name[0] ) {
+        viewapp_texture_path ( texture_path, scene_path, metalness_roughness_name );
+        viewapp_texture_t material_texture = viewapp_import_texture ( scene, texture_path );
+
+        for ( uint32_t i = 0; i < material_texture.width * material_texture.height; ++i ) {
+            // Following the glTF spec for metallicRoughnessTexture
+            char metalness = material_texture.data[i * 4 + 2];
+            char roughness = material_texture.data[i * 4 + 1];
+
+            if ( color_texture.data ) {
+                color_texture.data[i * 4 + 3] = metalness;
+            }
+            if ( normal_texture.data ) {
+                normal_texture.data[i * 4 + 3] = roughness;
+            }
+        }
+
+        std_virtual_heap_free ( material_texture.data );
+    }
+
+    // The texture data is owned by the upload from here on
+    if ( color_texture.data ) {
+        texture_uploads[texture_uploads_count++] = viewapp_upload_texture_to_gpu ( &color_texture, color_name, viewapp_material_texture_color_m );
+    }
+
+    if ( normal_texture.data ) {
+        texture_uploads[texture_uploads_count++] = viewapp_upload_texture_to_gpu ( &normal_texture, normal_name, viewapp_material_texture_normal_m );
+    }
+
+    return texture_uploads_count;
+}
+
+// Baked color textures already carry metalness in alpha, roughness comes in its own texture
+static uint32_t viewapp_upload_baked_material_textures ( viewapp_texture_upload_t** texture_uploads, const bsf_file_t* bsf, const bsf_material_t* material ) {
+    const uint32_t ids[3] = { material->color_texture_id, material->normal_texture_id, material->roughness_texture_id };
+    const viewapp_material_texture_e slots[3] = { viewapp_material_texture_color_m, viewapp_material_texture_normal_m, viewapp_material_texture_roughness_m };
+    uint32_t texture_uploads_count = 0;
+
+    for ( uint32_t i = 0; i < 3; ++i ) {
+        bsf_texture_view_t view;
+        if ( bsf_texture_find ( &view, bsf, ids[i] ) ) {
+            texture_uploads[texture_uploads_count++] = viewapp_upload_baked_texture ( &view, slots[i] );
+        }
+    }
+
+    return texture_uploads_count;
+}
+
+static se_entity_h viewapp_spawn_mesh_entity ( const char* name, const xg_geo_util_geometry_data_t* geo, const xg_geo_util_geometry_gpu_data_t* gpu_data, const viewapp_material_data_t* material, viewapp_texture_upload_t** texture_uploads, uint32_t texture_uploads_count ) {
+    viewapp_state_t* state = viewapp_state_get();
+    se_i* se = state->modules.se;
+    xs_i* xs = state->modules.xs;
+
+    bool is_packed = gpu_data->vertex_layout == xg_geo_util_vertex_layout_packed_m;
+    xs_database_pipeline_h geometry_pipeline_state = xs->get_database_pipeline ( state->render.sdb, is_packed ? xs_hash_static_string_m ( "geometry_packed" ) : xs_hash_static_string_m ( "geometry" ) );
+    xs_database_pipeline_h shadow_pipeline_state = xs->get_database_pipeline ( state->render.sdb, is_packed ? xs_hash_static_string_m ( "shadow_packed" ) : xs_hash_static_string_m ( "shadow" ) );
+    xs_database_pipeline_h object_id_pipeline_state = xs->get_database_pipeline ( state->render.sdb, is_packed ? xs_hash_static_string_m ( "object_id_packed" ) : xs_hash_static_string_m ( "object_id" ) );
+
+    viewapp_mesh_component_t mesh_component = viewapp_mesh_component_m (
+        .geo_data = *geo,
+        .geo_gpu_data = *gpu_data,
+        .object_id_pipeline = object_id_pipeline_state,
+        .geometry_pipeline = geometry_pipeline_state,
+        .shadow_pipeline = shadow_pipeline_state,
+        .object_id = state->render.next_object_id++,
+        .material = *material,
+    );
+
+    viewapp_transform_component_t transform_component = viewapp_transform_component_m (
+        .position = { 0, 0, 0 },
+    );
+
+    se_entity_params_t entity_params = se_entity_params_m (
+        .update = se_entity_update_m (
+            .component_count = 2,
+            .components = { 
+                se_component_update_m (
+                    .id = viewapp_mesh_component_id_m,
+                    .streams = { se_stream_update_m ( .data = &mesh_component ) }
                 ),
+                se_component_update_m (
+                    .id = viewapp_transform_component_id_m,
+                    .streams = { se_stream_update_m ( .data = &transform_component ) }
+                ) 
             }
-        ) );
+        )
+    );
+    std_str_copy_static_m ( entity_params.debug_name, name );
+    se_entity_h entity = se->create_entity ( &entity_params );
+
+    for ( uint32_t i = 0; i < texture_uploads_count; ++i ) {
+        texture_uploads[i]->entity = entity;
     }
 
-    return texture_handle;
+    return entity;
+}
+
+static viewapp_material_data_t viewapp_import_default_material ( void ) {
+    return viewapp_material_data_m (
+        .base_color = { 
+            powf ( 240 / 255.f, 2.2 ),
+            powf ( 240 / 255.f, 2.2 ),
+            powf ( 250 / 255.f, 2.2 )
+        },
+        .roughness = 1,
+        .metalness = 0,
+        .ssr = false,
+    );
 }
 
 static void viewapp_import_scene ( xg_workload_h workload, uint64_t key, const char* input_path ) {
     viewapp_state_t* state = viewapp_state_get();
     se_i* se = state->modules.se;
     xg_i* xg = state->modules.xg;
-    xs_i* xs = state->modules.xs;
 
     unsigned int flags = 0;
     flags |= aiProcess_ConvertToLeftHanded;
@@ -895,9 +1151,6 @@ static void viewapp_import_scene ( xg_workload_h workload, uint64_t key, const c
 
     std_tick_t start_tick = std_tick_now();
 
-    xg_cmd_buffer_h cmd_buffer = xg->create_cmd_buffer ( workload );
-    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
-
     std_log_info_m ( "Importing input scene " std_fmt_str_m, input_path );
     const struct aiScene* scene = aiImportFile ( input_path, flags );
 
@@ -905,10 +1158,6 @@ static void viewapp_import_scene ( xg_workload_h workload, uint64_t key, const c
         const char* error = aiGetErrorString();
         std_log_error_m ( "Error importing file: " std_fmt_str_m, error );
     } else {
-        xs_database_pipeline_h geometry_pipeline_state = xs->get_database_pipeline ( state->render.sdb, xs_hash_static_string_m ( "geometry" ) );
-        xs_database_pipeline_h shadow_pipeline_state = xs->get_database_pipeline ( state->render.sdb, xs_hash_static_string_m ( "shadow" ) );
-        xs_database_pipeline_h object_id_pipeline_state = xs->get_database_pipeline ( state->render.sdb, xs_hash_static_string_m ( "object_id" ) );
-
         for ( uint32_t mesh_it = 0; mesh_it < scene->mNumMeshes; ++mesh_it ) {
             const struct aiMesh* mesh = scene->mMeshes[mesh_it];
             xg_geo_util_geometry_data_t geo;
@@ -960,16 +1209,10 @@ static void viewapp_import_scene ( xg_workload_h workload, uint64_t key, const c
 
             xg_geo_util_geometry_gpu_data_t gpu_data = xg_geo_util_upload_geometry_to_gpu ( state->render.device, workload, &geo );
 
-            viewapp_material_data_t mesh_material = viewapp_material_data_m (
-                .base_color = { 
-                    powf ( 240 / 255.f, 2.2 ),
-                    powf ( 240 / 255.f, 2.2 ),
-                    powf ( 250 / 255.f, 2.2 )
-                },
-                .roughness = 1,
-                .metalness = 0,
-                .ssr = false,
-            );
+            viewapp_material_data_t mesh_material = viewapp_import_default_material();
+
+            viewapp_texture_upload_t* texture_uploads[2];
+            uint32_t texture_uploads_count = 0;
 
             uint32_t mat_idx = mesh->mMaterialIndex;
             if ( mat_idx < scene->mNumMaterials ) {
@@ -981,99 +1224,29 @@ static void viewapp_import_scene ( xg_workload_h workload, uint64_t key, const c
                     mesh_material.base_color[2] = diffuse.b;
                 }
 
-                viewapp_texture_t color_texture = {};
-                struct aiString color_texture_name;
-                if ( aiGetMaterialTexture ( material, aiTextureType_DIFFUSE, 0, &color_texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS ) {
-                    char texture_path[256];
-                    std_path_normalize ( texture_path, 256, input_path );
-                    size_t len = std_path_pop ( texture_path );
-                    std_path_append ( texture_path, 256 - len, color_texture_name.data );
-                    color_texture = viewapp_import_texture ( scene, texture_path );
-                }
+                struct aiString color_texture_name = {};
+                aiGetMaterialTexture ( material, aiTextureType_DIFFUSE, 0, &color_texture_name, NULL, NULL, NULL, NULL, NULL, NULL );
 
-                viewapp_texture_t normal_texture = {};
-                struct aiString normal_texture_name;
-                if ( aiGetMaterialTexture ( material, aiTextureType_NORMALS, 0, &normal_texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS ) {
-                    char texture_path[256];
-                    std_path_normalize ( texture_path, 256, input_path );
-                    size_t len = std_path_pop ( texture_path );
-                    std_path_append ( texture_path, 256 - len, normal_texture_name.data );
-                    normal_texture = viewapp_import_texture ( scene, texture_path );
-                }
+                struct aiString normal_texture_name = {};
+                aiGetMaterialTexture ( material, aiTextureType_NORMALS, 0, &normal_texture_name, NULL, NULL, NULL, NULL, NULL, NULL );
 
-                struct aiString metalness_texture_name;
-                struct aiString roughness_texture_name;
+                struct aiString metalness_texture_name = {};
+                struct aiString roughness_texture_name = {};
                 bool has_metalness = aiGetMaterialTexture ( material, AI_MATKEY_METALLIC_TEXTURE, &metalness_texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS;
                 bool has_roughness = aiGetMaterialTexture ( material, AI_MATKEY_ROUGHNESS_TEXTURE, &roughness_texture_name, NULL, NULL, NULL, NULL, NULL, NULL ) == AI_SUCCESS;
                 if ( has_roughness && has_metalness ) {
                     std_assert_m ( std_str_cmp ( metalness_texture_name.data, roughness_texture_name.data ) == 0 );
-                    char texture_path[256];
-                    std_path_normalize ( texture_path, 256, input_path );
-                    size_t len = std_path_pop ( texture_path );
-                    std_path_append ( texture_path, 256 - len, roughness_texture_name.data );
-                    viewapp_texture_t material_texture = viewapp_import_texture ( scene, texture_path );
-                    
-                    for ( uint32_t i = 0; i < material_texture.width * material_texture.height; ++i ) {
-                        // Following the glTF spec for metallicRoughnessTexture
-                        char metalness = material_texture.data[i * 4 + 2];
-                        char roughness = material_texture.data[i * 4 + 1];
-
-                        if ( color_texture.data ) {
-                            color_texture.data[i * 4 + 3] = metalness;
-                        }
-                        if ( normal_texture.data ) {
-                            normal_texture.data[i * 4 + 3] = roughness;
-                        }
-                    }
-
-                    std_virtual_heap_free ( material_texture.data );
-                }
-
-                if ( color_texture.data ) {
-                    mesh_material.color_texture = viewapp_upload_texture_to_gpu ( cmd_buffer, key, resource_cmd_buffer, &color_texture, color_texture_name.data );
-                    std_virtual_heap_free ( color_texture.data );
+                } else {
+                    roughness_texture_name.data[0] = '\0';
                 }
 
-                if ( normal_texture.data ) {
-                    mesh_material.normal_texture = viewapp_upload_texture_to_gpu ( cmd_buffer, key, resource_cmd_buffer, &normal_texture, normal_texture_name.data );
-                    std_virtual_heap_free ( normal_texture.data );
-                }
+                texture_uploads_count = viewapp_upload_material_textures ( texture_uploads, scene, input_path, color_texture_name.data, normal_texture_name.data, roughness_texture_name.data );
 
                 aiGetMaterialFloat ( material, AI_MATKEY_ROUGHNESS_FACTOR, &mesh_material.roughness );
                 aiGetMaterialFloat ( material, AI_MATKEY_METALLIC_FACTOR, &mesh_material.metalness );
             }
 
-            viewapp_mesh_component_t mesh_component = viewapp_mesh_component_m (
-                .geo_data = geo,
-                .geo_gpu_data = gpu_data,
-                .object_id_pipeline = object_id_pipeline_state,
-                .geometry_pipeline = geometry_pipeline_state,
-                .shadow_pipeline = shadow_pipeline_state,
-                .object_id = state->render.next_object_id++,
-                .material = mesh_material,
-            );
-
-            viewapp_transform_component_t transform_component = viewapp_transform_component_m (
-                .position = { 0, 0, 0 },
-            );
-
-            se_entity_params_t entity_params = se_entity_params_m (
-                .update = se_entity_update_m (
-                    .component_count = 2,
-                    .components = { 
-                        se_component_update_m (
-                            .id = viewapp_mesh_component_id_m,
-                            .streams = { se_stream_update_m ( .data = &mesh_component ) }
-                        ),
-                        se_component_update_m (
-                            .id = viewapp_transform_component_id_m,
-                            .streams = { se_stream_update_m ( .data = &transform_component ) }
-                        ) 
-                    }
-                )
-            );
-            std_str_copy_static_m ( entity_params.debug_name, mesh->mName.data );
-            se->create_entity ( &entity_params );
+            viewapp_spawn_mesh_entity ( mesh->mName.data, &geo, &gpu_data, &mesh_material, texture_uploads, texture_uploads_count );
         }
 
         for ( uint32_t light_it = 0; light_it < scene->mNumLights; ++light_it ) {
@@ -1108,6 +1281,194 @@ static void viewapp_import_scene ( xg_workload_h workload, uint64_t key, const c
     std_log_info_m ( "Scene imported in " std_fmt_f32_dec_m(3) "s", time_ms / 1000.f );
 }
 
+// Looks for a scene baked by data_bake next to the source asset, same name with a .bsf extension
+static bool viewapp_find_baked_scene ( char* bsf_path, size_t cap, const char* input_path ) {
+    size_t len = std_str_copy ( bsf_path, cap, input_path );
+    size_t ext = std_str_find_reverse ( bsf_path, len, "." );
+    const char* name = std_path_name_ptr ( bsf_path );
+
+    if ( ext == std_str_find_null_m || bsf_path + ext < name ) {
+        ext = len;
+    }
+
+    bsf_path[ext] = '\0';
+
+    if ( ext + 5 > cap ) {
+        return false;
+    }
+
+    std_str_copy ( bsf_path + ext, cap - ext, ".bsf" );
+
+    std_path_info_t info;
+    return std_path_info ( &info, bsf_path ) && ( info.flags & std_path_is_file_m );
+}
+
+// The bsf file is mapped, vertex and index data are copied from the mapping straight into the workload staging
+// memory and the mapping is closed once all meshes are uploaded. No intermediate copies and no assimp processing.
+// Baked textures are uploaded block compressed with all their mips, no decoding and no mip generation.
+static bool viewapp_load_baked_scene ( xg_workload_h workload, const char* input_path ) {
+    viewapp_state_t* state = viewapp_state_get();
+
+    std_tick_t start_tick = std_tick_now();
+
+    bsf_file_t bsf;
+    if ( !bsf_file_open ( &bsf, input_path ) ) {
+        return false;
+    }
+
+    std_log_info_m ( "Loading baked scene " std_fmt_str_m, input_path );
+
+    for ( uint32_t chunk_it = 0; chunk_it < bsf.header->chunk_count; ++chunk_it ) {
+        bsf_mesh_view_t mesh;
+        if ( !bsf_mesh_view ( &mesh, &bsf, chunk_it ) ) {
+            continue;
+        }
+
+        xg_geo_util_geometry_gpu_data_t gpu_data;
+
+        if ( mesh.header->vertex_layout == bsf_vertex_layout_packed_m ) {
+            xg_geo_util_packed_geometry_data_t packed_geo = {
+                .pos = ( int16_t* ) mesh.packed_pos,
+                .nor = ( int16_t* ) mesh.packed_nor,
+                .tan = ( int16_t* ) mesh.packed_tan,
+                .uv = ( uint16_t* ) mesh.packed_uv,
+                .idx = ( uint32_t* ) mesh.idx,
+                .vertex_count = mesh.header->vertex_count,
+                .index_count = mesh.header->lod_index_count,
+                .pos_offset = { mesh.header->pos_offset[0], mesh.header->pos_offset[1], mesh.header->pos_offset[2] },
+                .pos_scale = mesh.header->pos_scale,
+            };
+            gpu_data = xg_geo_util_upload_packed_geometry_to_gpu ( state->render.device, workload, &packed_geo );
+        } else {
+            xg_geo_util_geometry_data_t f32_geo = {
+                .pos = ( float* ) mesh.pos,
+                .nor = ( float* ) mesh.nor,
+                .tan = ( float* ) mesh.tan,
+                .bitan = ( float* ) mesh.bitan,
+                .uv = ( float* ) mesh.uv,
+                .idx = ( uint32_t* ) mesh.idx,
+                .vertex_count = mesh.header->vertex_count,
+                .index_count = mesh.header->lod_index_count,
+            };
+            gpu_data = xg_geo_util_upload_geometry_to_gpu ( state->render.device, workload, &f32_geo );
+        }
+
+        // Only the counts are kept on the cpu side, the streams point into the mapping. All LODs are uploaded, the
+        // index count only covers LOD 0, which is also what the raytrace geometry is built from.
+        xg_geo_util_geometry_data_t geo = ( xg_geo_util_geometry_data_t ) {
+            .vertex_count = mesh.header->vertex_count,
+            .index_count = mesh.header->index_count,
+        };
+
+        viewapp_material_data_t mesh_material = viewapp_import_default_material();
+        viewapp_texture_upload_t* texture_uploads[3];
+        uint32_t texture_uploads_count = 0;
+
+        const bsf_material_t* material = bsf_material_find ( &bsf, mesh.header->material_id );
+        if ( material ) {
+            if ( material->flags & bsf_material_has_base_color_m ) {
+                mesh_material.base_color[0] = material->base_color[0];
+                mesh_material.base_color[1] = material->base_color[1];
+                mesh_material.base_color[2] = material->base_color[2];
+            }
+
+            if ( material->flags & bsf_material_has_roughness_m ) {
+                mesh_material.roughness = material->roughness;
+            }
+
+            if ( material->flags & bsf_material_has_metalness_m ) {
+                mesh_material.metalness = material->metalness;
+            }
+
+            // Materials without baked textures fall back to decoding the sources next to the bsf
+            bool has_baked_textures = material->color_texture_id != bsf_null_id_m || material->normal_texture_id != bsf_null_id_m || material->roughness_texture_id != bsf_null_id_m;
+
+            if ( has_baked_textures ) {
+                texture_uploads_count = viewapp_upload_baked_material_textures ( texture_uploads, &bsf, material );
+            } else {
+                texture_uploads_count = viewapp_upload_material_textures ( texture_uploads, NULL, input_path, material->color_texture, material->normal_texture, material->metalness_roughness_texture );
+            }
+        }
+
+        se_entity_h entity = viewapp_spawn_mesh_entity ( mesh.header->name, &geo, &gpu_data, &mesh_material, texture_uploads, texture_uploads_count );
+        viewapp_mesh_component_t* mesh_component = state->modules.se->get_entity_component ( entity, viewapp_mesh_component_id_m, 0 );
+        uint32_t lod_count = mesh.header->lod_count < viewapp_mesh_max_lods_m ? mesh.header->lod_count : viewapp_mesh_max_lods_m;
+
+        for ( uint32_t i = 0; i < lod_count; ++i ) {
+            mesh_component->lods[i] = ( viewapp_mesh_lod_t ) {
+                .index_offset = mesh.header->lods[i].index_offset,
+                .index_count = mesh.header->lods[i].index_count,
+                .error = mesh.header->lods[i].error,
+            };
+        }
+
+        mesh_component->lod_count = lod_count;
+        mesh_component->bounds_center[0] = mesh.header->bounds_center[0];
+        mesh_component->bounds_center[1] = mesh.header->bounds_center[1];
+        mesh_component->bounds_center[2] = mesh.header->bounds_center[2];
+        mesh_component->bounds_radius = mesh.header->bounds_radius;
+    }
+
+    bsf_file_close ( &bsf );
+
+    std_tick_t end_tick = std_tick_now();
+    float time_ms = std_tick_to_milli_f32 ( end_tick - start_tick );
+    std_log_info_m ( "Baked scene loaded in " std_fmt_f32_dec_m(3) "s", time_ms / 1000.f );
+    return true;
+}
+
+sm_mat_4x4f_t viewapp_mesh_dequantize_matrix ( const xg_geo_util_geometry_gpu_data_t* gpu_data ) {
+    bool is_packed = gpu_data->vertex_layout == xg_geo_util_vertex_layout_packed_m;
+    float scale = is_packed ? gpu_data->pos_scale : 1;
+    sm_mat_4x4f_t dequantize = {
+        .r0[0] = scale,
+        .r1[1] = scale,
+        .r2[2] = scale,
+        .r3[3] = 1,
+        .r0[3] = is_packed ? gpu_data->pos_offset[0] : 0,
+        .r1[3] = is_packed ? gpu_data->pos_offset[1] : 0,
+        .r2[3] = is_packed ? gpu_data->pos_offset[2] : 0,
+    };
+    return dequantize;
+}
+
+uint32_t viewapp_mesh_select_lod ( const viewapp_mesh_component_t* mesh, const viewapp_transform_component_t* transform, const rv_view_info_t* view, float viewport_height, float max_pixel_error ) {
+    if ( mesh->lod_count < 2 || view->proj_params.type != rv_projection_perspective_m ) {
+        return 0;
+    }
+
+    // Distance from the view to the closest point of the world space bounding sphere
+    sm_vec_3f_t center = sm_quat_transform_f3 ( sm_quat ( transform->orientation ), sm_vec_3f_mul ( sm_vec_3f ( mesh->bounds_center ), transform->scale ) );
+    center = sm_vec_3f_add ( center, sm_vec_3f ( transform->position ) );
+    float distance = sm_vec_3f_len ( sm_vec_3f_sub ( center, sm_vec_3f ( view->transform.position ) ) ) - mesh->bounds_radius * transform->scale;
+
+    if ( distance <= 0 ) {
+        return 0;
+    }
+
+    // Pixels covered by one world unit at unit distance
+    float pixels_per_unit = viewport_height / ( 2 * tanf ( view->proj_params.perspective.fov_y * 0.5f ) );
+    float max_error = max_pixel_error * distance / ( pixels_per_unit * transform->scale );
+    uint32_t lod = 0;
+
+    while ( lod + 1 < mesh->lod_count && mesh->lods[lod + 1].error <= max_error ) {
+        ++lod;
+    }
+
+    return lod;
+}
+
+void viewapp_mesh_draw_range ( uint32_t* index_offset, uint32_t* primitive_count, const viewapp_mesh_component_t* mesh ) {
+    if ( mesh->lod_count == 0 ) {
+        *index_offset = 0;
+        *primitive_count = ( uint32_t ) ( mesh->geo_data.index_count / 3 );
+    } else {
+        const viewapp_mesh_lod_t* lod = &mesh->lods[mesh->lod < mesh->lod_count ? mesh->lod : 0];
+        *index_offset = lod->index_offset;
+        *primitive_count = lod->index_count / 3;
+    }
+}
+
 void update_raytrace_world ( void ) {
 #if xg_enable_raytracing_m
     viewapp_state_t* state = viewapp_state_get();
@@ -1132,8 +1493,8 @@ static void viewapp_destroy_entity_resources ( se_entity_h entity, xg_workload_h
         if ( material->normal_texture != xg_null_handle_m ) {
             xg->cmd_destroy_texture ( resource_cmd_buffer, material->normal_texture, time );
         }
-        if ( material->metalness_roughness_texture != xg_null_handle_m ) {
-            xg->cmd_destroy_texture ( resource_cmd_buffer, material->metalness_roughness_texture, time );
+        if ( material->roughness_texture != xg_null_handle_m ) {
+            xg->cmd_destroy_texture ( resource_cmd_buffer, material->roughness_texture, time );
         }
 
         if ( mesh_component->rt_geo != xg_null_handle_m ) {
@@ -1150,6 +1511,8 @@ void viewapp_load_scene ( viewapp_scene_e scene ) {
     xg_workload_h workload = xg->create_workload ( state->render.device );
     xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
 
+    viewapp_cancel_texture_uploads ( resource_cmd_buffer );
+
     se_i* se = state->modules.se;
     se_query_result_t mesh_query_result;
     se->query_entities ( &mesh_query_result, &se_query_params_m() );
@@ -1169,7 +1532,11 @@ void viewapp_load_scene ( viewapp_scene_e scene ) {
     } else if ( scene == 1 ) {
         viewapp_boot_scene_field ( workload );
     } else {
-        viewapp_import_scene ( workload, 0, state->scene.custom_scene_path );
+        char bsf_path[256];
+        bool baked = viewapp_find_baked_scene ( bsf_path, 256, state->scene.custom_scene_path );
+        if ( !baked || !viewapp_load_baked_scene ( workload, bsf_path ) ) {
+            viewapp_import_scene ( workload, 0, state->scene.custom_scene_path );
+        }
     }
 
     state->scene.active_scene = scene;
@@ -2,6 +2,11 @@
 
 #include <xg.h>
 #include <se.h>
+#include <sm_matrix.h>
+#include <xg_geo_util.h>
+#include <rv.h>
+
+#include "viewapp_state.h"
 
 typedef enum {
     viewapp_scene_cornell_box_m,
@@ -10,6 +15,7 @@ typedef enum {
 } viewapp_scene_e;
 
 void viewapp_load_scene ( viewapp_scene_e scene );
+void viewapp_update_texture_uploads ( xg_workload_h workload );
 
 se_entity_h spawn_plane ( xg_workload_h workload );
 se_entity_h spawn_sphere ( xg_workload_h workload );
@@ -18,4 +24,14 @@ se_entity_h spawn_light ( xg_workload_h workload );
 void viewapp_destroy_entity_resources ( se_entity_h entity, xg_workload_h workload, xg_resource_cmd_buffer_h resource_cmd_buffer, xg_resource_cmd_buffer_time_e time );
 
 void viewapp_build_raytrace_world ( xg_workload_h workload );
+
+// Maps the mesh vertex positions to model space, meant to be applied before the model transform. Identity unless the
+// mesh uses the packed vertex layout.
+sm_mat_4x4f_t viewapp_mesh_dequantize_matrix ( const xg_geo_util_geometry_gpu_data_t* gpu_data );
 void update_raytrace_world ( void );
+
+// Coarsest LOD whose error, projected by the view onto a viewport viewport_height pixels tall, stays under
+// max_pixel_error. Distance is measured to the mesh bounding sphere, LOD 0 is picked from inside it.
+uint32_t viewapp_mesh_select_lod ( const viewapp_mesh_component_t* mesh, const viewapp_transform_component_t* transform, const rv_view_info_t* view, float viewport_height, float max_pixel_error );
+// Index range of the LOD selected for the current frame, the whole index buffer if the mesh has no LODs
+void viewapp_mesh_draw_range ( uint32_t* index_offset, uint32_t* primitive_count, const viewapp_mesh_component_t* mesh );
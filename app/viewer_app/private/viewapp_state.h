@@ -38,15 +38,38 @@ typedef struct {
     float global_transform[16];
 } viewapp_scene_mesh_instance_t;
 #endif
+#define viewapp_max_texture_uploads_m 1024
+
+typedef enum {
+    viewapp_material_texture_color_m,
+    viewapp_material_texture_normal_m,
+    viewapp_material_texture_roughness_m,
+} viewapp_material_texture_e;
+
+// Texture streamed in through the xg upload service. The material keeps using the default texture until the upload
+// completes, at which point mips get generated if needed and the texture is bound to the material of the owning entity.
+typedef struct {
+    xg_upload_h upload;
+    xg_texture_h texture;
+    char* data; // freed as soon as the upload is out of the queued state
+    uint32_t mip_levels;
+    bool generate_mips; // only mip 0 was uploaded
+    se_entity_h entity;
+    viewapp_material_texture_e slot;
+} viewapp_texture_upload_t;
+
 typedef struct {
     uint32_t active_scene;
     char custom_scene_path[128];
     //uint32_t entity_count;
     //se_entity_h entities[128];
+    uint32_t texture_uploads_count;
+    viewapp_texture_upload_t texture_uploads[viewapp_max_texture_uploads_m];
 } viewapp_scene_state_t;
 
 #define viewapp_scene_state_m( ... ) ( viewapp_scene_state_t ) { \
     .active_scene = 0, \
+    .texture_uploads_count = 0, \
     .custom_scene_path[0] = '\0' \
     ##__VA_ARGS__ \
 }
@@ -89,6 +112,9 @@ typedef struct {
     xg_raytrace_world_h raytrace_world;
     xg_resource_bindings_layout_h workload_bindings_layout;
 
+    float lod_pixel_error; // max projected error of the selected mesh LODs
+    uint32_t mesh_triangle_count; // drawn by the geometry pass with the selected LODs
+
     bool graph_reload;
     bool allow_graph_aliasing;
     bool raytrace_world_update;
@@ -120,6 +146,7 @@ typedef struct {
     .allow_graph_aliasing = true, \
     .export_dest = xf_null_handle_m, \
     .target_fps = 120, \
+    .lod_pixel_error = 1, \
     ##__VA_ARGS__ \
 }
 
@@ -186,7 +213,7 @@ typedef struct {
     float emissive[3];
     xf_texture_h color_texture;
     xf_texture_h normal_texture;
-    xf_texture_h metalness_roughness_texture;
+    xf_texture_h roughness_texture;
 } viewapp_material_data_t;
 
 #define viewapp_material_data_m( ... ) ( viewapp_material_data_t ) { \
@@ -197,7 +224,7 @@ typedef struct {
     .metalness = 0, \
     .color_texture = xg_null_handle_m, \
     .normal_texture = xg_null_handle_m, \
-    .metalness_roughness_texture = xg_null_handle_m, \
+    .roughness_texture = xg_null_handle_m, \
     ##__VA_ARGS__ \
 }
 
@@ -214,6 +241,15 @@ typedef struct {
     ##__VA_ARGS__ \
 }
 
+// Range of the mesh index buffer. The error is in model units, see bsf.h
+typedef struct {
+    uint32_t index_offset;
+    uint32_t index_count;
+    float error;
+} viewapp_mesh_lod_t;
+
+#define viewapp_mesh_max_lods_m 8
+
 typedef struct {
     xg_geo_util_geometry_data_t geo_data;
     xg_geo_util_geometry_gpu_data_t geo_gpu_data;
@@ -224,6 +260,11 @@ typedef struct {
     uint32_t object_id;
     viewapp_material_data_t material;
     xg_raytrace_geometry_h rt_geo;
+    viewapp_mesh_lod_t lods[viewapp_mesh_max_lods_m];
+    uint32_t lod_count; // 0 if the mesh has no LODs, geo_data.index_count is drawn
+    uint32_t lod; // selected for the current frame
+    float bounds_center[3]; // model space
+    float bounds_radius;
 } viewapp_mesh_component_t;
 
 #define viewapp_mesh_component_m( ... ) ( viewapp_mesh_component_t ) { \
@@ -236,6 +277,8 @@ typedef struct {
     .object_id = 0, \
     .material = viewapp_material_data_m(), \
     .rt_geo = xg_null_handle_m, \
+    .lod_count = 0, \
+    .lod = 0, \
     ##__VA_ARGS__ \
 }
 
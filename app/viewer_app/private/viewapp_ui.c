@@ -233,6 +233,13 @@ void viewapp_update_ui ( wm_window_info_t* window_info, wm_input_state_t* old_in
         xi->add_label ( xi_workload, &fps_label );
         xi->add_label ( xi_workload, &fps_value );
         xi->newline();
+
+        xi_label_state_t triangles_label = xi_label_state_m ( .text = "mesh triangles" );
+        xi_label_state_t triangles_value = xi_label_state_m ( .style.horizontal_alignment = xi_horizontal_alignment_right_to_left_m );
+        std_u32_to_str ( triangles_value.text, xi_label_text_size, state->render.mesh_triangle_count, 0 );
+        xi->add_label ( xi_workload, &triangles_label );
+        xi->add_label ( xi_workload, &triangles_value );
+        xi->newline();
     }
     xi->end_section ( xi_workload );
 
@@ -34,6 +34,10 @@ layout ( binding = 0, set = xs_shader_binding_set_workload_m ) uniform frame_uni
 //                                     R A Y T R A C E
 // ======================================================================================= //
 
+// xg_geo_util_vertex_layout_e
+#define vertex_layout_f32_m 0
+#define vertex_layout_packed_m 1
+
 struct ray_payload_t {
     vec3 color;
     float distance;
@@ -83,6 +87,15 @@ mat3 tbn_from_normal ( vec3 n ) {
     return mat3 ( t, b, n );
 }
 
+// Inverse of the octahedral encoding used by data_bake for packed normals and tangents
+vec3 oct_decode ( vec2 e ) {
+    vec3 n = vec3 ( e.xy, 1.0 - abs ( e.x ) - abs ( e.y ) );
+    float t = max ( -n.z, 0.0 );
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize ( n );
+}
+
 bool proj_depth_cmp_ge ( float a, float b ) {
 #if reverse_depth_m
     return a <= b;
@@ -15,9 +15,9 @@ layout ( binding = 1, set = xs_shader_binding_set_dispatch_m ) uniform draw_unif
 
 layout ( binding = 2, set = xs_shader_binding_set_dispatch_m ) uniform texture2D color_texture;
 layout ( binding = 3, set = xs_shader_binding_set_dispatch_m ) uniform texture2D normal_texture;
-//layout ( binding = 4, set = xs_shader_binding_set_dispatch_m ) uniform texture2D material_texture;
+layout ( binding = 4, set = xs_shader_binding_set_dispatch_m ) uniform texture2D roughness_texture;
 
-layout ( binding = 4, set = xs_shader_binding_set_dispatch_m ) uniform sampler sampler_linear;
+layout ( binding = 5, set = xs_shader_binding_set_dispatch_m ) uniform sampler sampler_linear;
 
 layout ( location = 0 ) in vec3 in_pos;
 layout ( location = 1 ) in vec3 in_nor;
@@ -45,12 +45,17 @@ void main() {
     float backface_flip = gl_FrontFacing ? 1.f : -1.f;
     out_nor = vec4 ( vec3 ( in_nor * 0.5 * backface_flip + 0.5 ), draw_uniforms.roughness );
 #else
+    // Only xy are read, baked normal maps don't store z. Roughness is either in the normal alpha (1 for baked normal
+    // maps) or in the roughness texture (white when not baked)
     vec4 normal_sample = texture ( sampler2D ( normal_texture, sampler_linear ), in_uv );
-    vec3 normal = normal_sample.xyz * 2 - 1;
+    float roughness_sample = texture ( sampler2D ( roughness_texture, sampler_linear ), in_uv ).x;
+    vec3 normal;
+    normal.xy = normal_sample.xy * 2 - 1;
+    normal.z = sqrt ( max ( 1 - dot ( normal.xy, normal.xy ), 0 ) );
     mat3 tbn = mat3 ( in_t, in_b, in_n );
     normal = normalize ( tbn * normal );
     normal = normalize ( ( frame_uniforms.view_from_world * vec4 ( normal, 0 ) ).xyz );
-    out_nor = vec4 ( normal * 0.5 + 0.5, draw_uniforms.roughness * normal_sample.w );
+    out_nor = vec4 ( normal * 0.5 + 0.5, draw_uniforms.roughness * normal_sample.w * roughness_sample );
 #endif
 
     // material
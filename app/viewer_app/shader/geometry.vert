@@ -9,11 +9,19 @@ layout ( binding = 0, set = xs_shader_binding_set_dispatch_m ) uniform draw_unif
     mat4 prev_world_from_model;
 } draw_uniforms;
 
+#if packed_vertex_m
+// Position dequantization is folded into the model matrices
+layout ( location = 0 ) in vec4 in_pos; // w: bitangent sign
+layout ( location = 1 ) in vec2 in_nor;
+layout ( location = 2 ) in vec2 in_tan;
+layout ( location = 3 ) in vec2 in_uv;
+#else
 layout ( location = 0 ) in vec3 in_pos;
 layout ( location = 1 ) in vec3 in_nor;
 layout ( location = 2 ) in vec3 in_tan;
 layout ( location = 3 ) in vec3 in_bitan;
 layout ( location = 4 ) in vec2 in_uv;
+#endif
 
 layout ( location = 0 ) out vec3 out_pos;
 layout ( location = 1 ) out vec3 out_nor;
@@ -25,15 +33,25 @@ layout ( location = 6 ) out vec4 out_curr_clip_pos;
 layout ( location = 7 ) out vec4 out_prev_clip_pos;
 
 void main() {
+#if packed_vertex_m
+    vec4 pos = vec4 ( in_pos.xyz, 1.0 );
+    vec3 nor = oct_decode ( in_nor );
+    vec3 tan = oct_decode ( in_tan );
+    vec3 bitan = cross ( nor, tan ) * in_pos.w;
+#else
     vec4 pos = vec4 ( in_pos, 1.0 );
+    vec3 nor = in_nor;
+    vec3 tan = in_tan;
+    vec3 bitan = in_bitan;
+#endif
 
     gl_Position = frame_uniforms.jittered_proj_from_view * frame_uniforms.view_from_world * draw_uniforms.world_from_model * pos;
 
     out_pos = ( frame_uniforms.view_from_world * draw_uniforms.world_from_model * pos ).xyz;
-    out_nor = normalize ( mat3 ( frame_uniforms.view_from_world * draw_uniforms.world_from_model ) * in_nor );
-    out_t = normalize ( ( draw_uniforms.world_from_model * vec4 ( in_tan, 0 ) ).xyz );
-    out_b = normalize ( ( draw_uniforms.world_from_model * vec4 ( in_bitan, 0 ) ).xyz );
-    out_n = normalize ( ( draw_uniforms.world_from_model * vec4 ( in_nor, 0 ) ).xyz );
+    out_nor = normalize ( mat3 ( frame_uniforms.view_from_world * draw_uniforms.world_from_model ) * nor );
+    out_t = normalize ( ( draw_uniforms.world_from_model * vec4 ( tan, 0 ) ).xyz );
+    out_b = normalize ( ( draw_uniforms.world_from_model * vec4 ( bitan, 0 ) ).xyz );
+    out_n = normalize ( ( draw_uniforms.world_from_model * vec4 ( nor, 0 ) ).xyz );
     out_uv = in_uv;
     out_curr_clip_pos = ( frame_uniforms.proj_from_view * frame_uniforms.view_from_world * draw_uniforms.world_from_model * pos ).xyzw;
     out_prev_clip_pos = ( frame_uniforms.prev_proj_from_view * frame_uniforms.prev_view_from_world * draw_uniforms.prev_world_from_model * pos ).xyzw;
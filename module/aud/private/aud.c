@@ -2,6 +2,8 @@
 
 #include "aud_device.h"
 #include "aud_source.h"
+#include "aud_mixer.h"
+#include "aud_stream.h"
 
 static aud_i s_api;
 
@@ -14,10 +16,8 @@ static aud_i aud_api ( void ) {
     aud.get_devices = aud_device_get_list;
     aud.get_device_info = aud_device_get_info;
 
-    aud.get_device_ring = aud_device_get_ring;
-    aud.update_device_ring = aud_device_update_ring;
-
     aud.activate_device = aud_device_activate;
+    aud.deactivate_device = aud_device_deactivate;
 
     aud.create_source = aud_source_create;
     aud.feed_source = aud_source_feed;
@@ -28,8 +28,10 @@ static aud_i aud_api ( void ) {
     aud.get_source_info = aud_source_get_info;
     aud.set_source_volume = aud_source_set_volume_scale;
 
-    aud.play = aud_device_play;
-    aud.output_to_device = aud_source_output_to_device;
+    aud.create_stream_source = aud_stream_create;
+    aud.get_stream_info = aud_stream_get_info;
+
+    aud.mix_sources = aud_source_mix;
 
     return aud;
 }
@@ -39,6 +41,8 @@ void* aud_load ( void* std_runtime ) {
 
     aud_device_init();
     aud_source_init();
+    aud_stream_init();
+    aud_mixer_init();
 
     s_api = aud_api();
 
@@ -46,5 +50,8 @@ void* aud_load ( void* std_runtime ) {
 }
 
 void aud_unload ( void ) {
-    std_noop_m;
+    aud_device_shutdown();
+    aud_stream_deinit();
+    aud_source_deinit();
+    aud_mixer_deinit();
 }
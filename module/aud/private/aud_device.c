@@ -1,5 +1,7 @@
 #include "aud_device.h"
 
+#include "aud_source.h"
+
 #include <std_platform.h>
 #include <std_list.h>
 #include <std_mutex.h>
@@ -7,12 +9,16 @@
 #include <std_string.h>
 #include <std_time.h>
 #include <std_allocator.h>
+#include <std_thread.h>
+#include <std_log.h>
 
 #if defined(std_platform_win32_m)
     #include <Mmsystem.h>
     #include <Mmreg.h>
 #elif defined(std_platform_linux_m)
     #include <alsa/asoundlib.h>
+    #include <pthread.h>
+    #include <sched.h>
 #endif
 
 typedef struct {
@@ -37,12 +43,24 @@ typedef struct {
     uint64_t os_card_id;
 #endif
     uint64_t os_handle;
+#if defined(std_platform_win32_m)
+    uint64_t os_event;
+#endif
     uint64_t guid;
     aud_device_f flags;
     aud_device_params_t params;
 
+    // Mixed and written to the device a period at a time by the device thread
+    std_thread_h thread;
+    bool stop;
+    uint64_t period_frames;
+    uint64_t underrun_count;
+
     aud_device_submit_context_t* submit_contexts;
     std_ring_t submit_ring;
+#if defined(std_platform_linux_m)
+    void* period_buffer;
+#endif
 
     /*std_memory_h submit_blocks_handle;
     std_ring_t submit_blocks_ring;
@@ -58,6 +76,8 @@ typedef struct {
     size_t hardware_device_count;
 
     uint64_t guid;
+    // The one active device, UINT64_MAX if none
+    aud_device_h output_device;
 
 #if defined(std_platform_linux_m)
     char** os_device_names;
@@ -73,6 +93,7 @@ void aud_device_init ( void ) {
     aud_device_state.devices_freelist = std_static_freelist_m ( devices_array );
     std_mutex_init ( &aud_device_state.devices_mutex );
     aud_device_state.guid = 0;
+    aud_device_state.output_device = UINT64_MAX;
 
     // TODO allow for dynamic updating of devices instead of just caching them all at the start
 #if defined(std_platform_win32_m)
@@ -140,6 +161,10 @@ void aud_device_init ( void ) {
 }
 
 void aud_device_shutdown ( void ) {
+    if ( aud_device_state.output_device != UINT64_MAX ) {
+        aud_device_deactivate ( aud_device_state.output_device );
+    }
+
     std_mutex_deinit ( &aud_device_state.devices_mutex );
 }
 
@@ -173,10 +198,12 @@ bool aud_device_get_info ( aud_device_info_t* info, aud_device_h device_handle )
         info->channels = device->params.channels;
         info->sample_frequency = device->params.sample_frequency;
         info->bits_per_sample = device->params.bits_per_sample;
+        info->underrun_count = device->underrun_count;
     } else {
         info->channels = 0;
         info->sample_frequency = 0;
         info->bits_per_sample = 0;
+        info->underrun_count = 0;
     }
 
 #if defined(std_platform_win32_m)
@@ -205,6 +232,110 @@ bool aud_device_get_info ( aud_device_info_t* info, aud_device_h device_handle )
     return true;
 }
 
+static void aud_device_recycle_submission_contexts ( aud_device_t* device ) {
+#if defined(std_platform_win32_m)
+    while ( std_ring_count ( &device->submit_ring ) > 0 ) {
+        aud_device_submit_context_t* submit_context = &device->submit_contexts[std_ring_bot_idx ( &device->submit_ring )];
+
+        if ( ( submit_context->win32_header.dwFlags & WHDR_DONE ) == 0 ) {
+            break;
+        }
+
+        // context is done playing, can be disposed
+
+        MMRESULT result = waveOutUnprepareHeader ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
+        std_assert_m ( result == MMSYSERR_NOERROR );
+
+        submit_context->is_submitted = false;
+        std_ring_pop ( &device->submit_ring, 1 );
+    }
+#else
+    std_unused_m ( device );
+#endif
+}
+
+#if defined(std_platform_win32_m)
+static void aud_device_submit_period ( aud_device_t* device ) {
+    aud_device_submit_context_t* submit_context = &device->submit_contexts[std_ring_top_idx ( &device->submit_ring )];
+    std_ring_push ( &device->submit_ring, 1 );
+
+    aud_source_render ( submit_context->data, &device->params, device->period_frames );
+
+    std_mem_zero_m ( &submit_context->win32_header );
+    submit_context->win32_header.lpData = ( char* ) submit_context->data;
+    submit_context->win32_header.dwBufferLength = ( DWORD ) submit_context->size;
+    submit_context->is_submitted = true;
+
+    MMRESULT result = waveOutPrepareHeader ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
+    std_assert_m ( result == MMSYSERR_NOERROR );
+
+    result = waveOutWrite ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
+    std_assert_m ( result == MMSYSERR_NOERROR );
+}
+#endif
+
+static void aud_device_raise_thread_priority ( void ) {
+#if defined(std_platform_win32_m)
+    SetThreadPriority ( GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL );
+#elif defined(std_platform_linux_m)
+    // Needs rtprio rights, without them the thread keeps running with the default policy
+    struct sched_param param;
+    param.sched_priority = sched_get_priority_max ( SCHED_FIFO ) / 2;
+    pthread_setschedparam ( pthread_self(), SCHED_FIFO, &param );
+#endif
+}
+
+// Sleeps until the device has room for another period, then mixes straight into it. Nothing in here locks or
+// allocates, the sources are only reached through aud_source_render.
+static void aud_device_thread_routine ( void* arg ) {
+    aud_device_t* device = ( aud_device_t* ) arg;
+    aud_device_raise_thread_priority();
+
+#if defined(std_platform_win32_m)
+    bool has_submitted = false;
+
+    while ( !device->stop ) {
+        WaitForSingleObject ( ( HANDLE ) device->os_event, aud_device_wait_timeout_ms_m );
+        aud_device_recycle_submission_contexts ( device );
+
+        // Everything queued played out before the thread got to queue more
+        if ( std_ring_count ( &device->submit_ring ) == 0 && has_submitted ) {
+            std_atomic_increment_u64 ( &device->underrun_count );
+        }
+
+        while ( std_ring_count ( &device->submit_ring ) < aud_device_queued_periods_m ) {
+            aud_device_submit_period ( device );
+            has_submitted = true;
+        }
+    }
+
+#elif defined(std_platform_linux_m)
+    snd_pcm_t* pcm = ( snd_pcm_t* ) device->os_handle;
+
+    while ( !device->stop ) {
+        // Wakes up once a period worth of frames can be written, see the avail min in aud_device_activate
+        int wait_result = snd_pcm_wait ( pcm, aud_device_wait_timeout_ms_m );
+        snd_pcm_sframes_t avail = wait_result < 0 ? wait_result : snd_pcm_avail_update ( pcm );
+
+        while ( avail >= ( snd_pcm_sframes_t ) device->period_frames ) {
+            aud_source_render ( device->period_buffer, &device->params, device->period_frames );
+            snd_pcm_sframes_t written = snd_pcm_writei ( pcm, device->period_buffer, device->period_frames );
+            avail = written < 0 ? written : avail - written;
+        }
+
+        if ( avail < 0 ) {
+            // EPIPE is the device running out of frames
+            if ( avail == -EPIPE ) {
+                std_atomic_increment_u64 ( &device->underrun_count );
+            }
+
+            snd_pcm_recover ( pcm, ( int ) avail, 1 );
+        }
+    }
+
+#endif
+}
+
 bool aud_device_activate ( aud_device_h device_handle, const aud_device_params_t* params ) {
     // TODO avoid static, alloc new mem on activate?
     static aud_device_submit_context_t submit_contexts_array [aud_device_max_devices_m] [aud_device_max_submit_contexts_m];
@@ -215,8 +346,15 @@ bool aud_device_activate ( aud_device_h device_handle, const aud_device_params_t
         return false;
     }
 
+    // Sources are mixed for one device at a time
+    if ( aud_device_state.output_device != UINT64_MAX ) {
+        std_log_warn_m ( "Another audio device is already active" );
+        return false;
+    }
+
     bool result;
     uint64_t os_handle;
+    uint64_t period_frames = aud_device_period_ms_m * params->sample_frequency / 1000;
 
 #if defined(std_platform_win32_m)
     WORD channel_count = ( WORD ) params->channels;
@@ -251,23 +389,78 @@ bool aud_device_activate ( aud_device_h device_handle, const aud_device_params_t
         .SubFormat = KSDATAFORMAT_SUBTYPE_PCM,
     };
 
-    MMRESULT res = waveOutOpen ( &waveout_handle, ( UINT ) device->os_id, &format_ex.Format, ( DWORD_PTR ) NULL, 0, CALLBACK_NULL );
+    // Signaled every time a buffer is done playing, that's what wakes the device thread
+    HANDLE event = CreateEvent ( NULL, FALSE, FALSE, NULL );
+    MMRESULT res = waveOutOpen ( &waveout_handle, ( UINT ) device->os_id, &format_ex.Format, ( DWORD_PTR ) event, 0, CALLBACK_EVENT );
 
     result = res == MMSYSERR_NOERROR;
     os_handle = ( uint64_t ) waveout_handle;
+
+    if ( result ) {
+        device->os_event = ( uint64_t ) event;
+    } else {
+        CloseHandle ( event );
+    }
 #elif defined(std_platform_linux_m)
-    std_not_implemented_m();
+    snd_pcm_format_t pcm_format;
+
+    switch ( params->bits_per_sample ) {
+        case 8:
+            pcm_format = SND_PCM_FORMAT_U8;
+            break;
+        case 16:
+            pcm_format = SND_PCM_FORMAT_S16_LE;
+            break;
+        case 24:
+            pcm_format = SND_PCM_FORMAT_S24_3LE;
+            break;
+        case 32:
+            pcm_format = SND_PCM_FORMAT_S32_LE;
+            break;
+        default:
+            pcm_format = SND_PCM_FORMAT_UNKNOWN;
+            break;
+    }
+
+    // plughw converts whatever the hardware doesn't support natively
+    char pcm_name[32];
+    std_str_format ( pcm_name, 32, "plughw:" std_fmt_u64_m "," std_fmt_u64_m, device->os_card_id, device->os_id );
+    snd_pcm_t* pcm = NULL;
+    result = pcm_format != SND_PCM_FORMAT_UNKNOWN && snd_pcm_open ( &pcm, pcm_name, SND_PCM_STREAM_PLAYBACK, 0 ) >= 0;
+
+    if ( result ) {
+        unsigned int latency_us = aud_device_period_ms_m * aud_device_queued_periods_m * 1000;
+        result = snd_pcm_set_params ( pcm, pcm_format, SND_PCM_ACCESS_RW_INTERLEAVED, ( unsigned int ) params->channels, ( unsigned int ) params->sample_frequency, 1, latency_us ) >= 0;
+    }
 
+    if ( result ) {
+        // The device might not have gone for the requested period, wake up on the one it picked
+        snd_pcm_uframes_t buffer_size;
+        snd_pcm_uframes_t period_size;
+        snd_pcm_get_params ( pcm, &buffer_size, &period_size );
+        period_frames = period_size;
+
+        snd_pcm_sw_params_t* sw_params;
+        snd_pcm_sw_params_alloca ( &sw_params );
+        snd_pcm_sw_params_current ( pcm, sw_params );
+        snd_pcm_sw_params_set_avail_min ( pcm, sw_params, period_size );
+        result = snd_pcm_sw_params ( pcm, sw_params ) >= 0;
+    }
 
+    if ( !result && pcm ) {
+        snd_pcm_close ( pcm );
+    }
 
-    result = false;
-    os_handle = 0;
+    os_handle = ( uint64_t ) pcm;
 #endif
 
     if ( result ) {
         device->os_handle = os_handle;
         device->flags |= aud_device_active_m;
         device->params = *params;
+        device->period_frames = period_frames;
+        device->underrun_count = 0;
+        device->stop = false;
 
         /*
         size_t device_idx = ( size_t ) device_handle;
@@ -278,147 +471,64 @@ bool aud_device_activate ( aud_device_h device_handle, const aud_device_params_t
         device->submit_contexts = std_circular_pool ( pool_buffer, sizeof ( aud_device_submit_context_t ) );
         */
 
+        uint64_t period_size = period_frames * params->channels * params->bits_per_sample / 8;
+
+#if defined(std_platform_win32_m)
         size_t device_idx = ( size_t ) device_handle;
         device->submit_contexts = submit_contexts_array[device_idx];
 
-        uint64_t submit_block_size = aud_device_submit_block_max_ms_m * params->sample_frequency * params->bits_per_sample / 8;
-        std_assert_m ( submit_block_size % 1000 == 0 );
-        submit_block_size = submit_block_size / 1000;
-
         for ( uint64_t i = 0; i < aud_device_max_submit_contexts_m; ++i ) {
             aud_device_submit_context_t* context = &device->submit_contexts[i];
             std_mem_zero_m ( context );
-            context->data = std_virtual_heap_alloc_m ( submit_block_size, 16 );
-            context->size = submit_block_size;
+            context->device = device_handle;
+            context->data = std_virtual_heap_alloc_m ( period_size, 16 );
+            context->size = period_size;
         }
 
         device->submit_ring = std_ring ( aud_device_max_submit_contexts_m );
-    }
-
-    return result;
-}
-
-bool aud_device_deactivate ( aud_device_h device ) {
-    std_unused_m ( device );
-    std_not_implemented_m();
-    return false;
-}
-
-static void aud_device_recycle_submission_contexts ( aud_device_t* device, bool block_if_full ) {
-    uint64_t count = std_ring_count ( &device->submit_ring );
-    bool stall_begin = false;
-
-    while ( count > 0 ) {
-        aud_device_submit_context_t* submit_context = &device->submit_contexts[std_ring_bot_idx ( &device->submit_ring )];
-
-        if ( !submit_context->is_submitted ) {
-            break;
-        }
-
-#if defined(std_platform_win32_m)
-
-        if ( ( submit_context->win32_header.dwFlags & WHDR_DONE ) == 0 ) {
-            if ( count == aud_device_max_submit_contexts_m && block_if_full ) {
-                if ( !stall_begin ) {
-                    stall_begin = true;
-                    std_log_warn_m ( "aud submission buffer is full! the thread will busy wait for a slot" );
-                }
-
-                continue;
-            }
-
-            break;
-        }
-
-        // context is done playing, can be disposed
-
-        MMRESULT result = waveOutUnprepareHeader ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
-        std_assert_m ( result == MMSYSERR_NOERROR );
-
-        submit_context->is_submitted = false;
-        std_ring_pop ( &device->submit_ring, 1 );
-
-        count = std_ring_count ( &device->submit_ring );
 #elif defined(std_platform_linux_m)
-        std_not_implemented_m();
-        std_unused_m ( stall_begin );
+        std_unused_m ( submit_contexts_array );
+        device->period_buffer = std_virtual_heap_alloc_m ( period_size, 16 );
 #endif
-    }
-}
 
-void aud_device_play ( aud_device_h device_handle, void* data, size_t size ) {
-    aud_device_t* device = &aud_device_state.devices_array[device_handle];
-
-    if ( std_unlikely_m ( ( device->flags & aud_devuce_existing_m ) == 0 ) ) {
-        return;
+        aud_device_state.output_device = device_handle;
+        aud_source_begin_output ( params );
+        device->thread = std_thread ( aud_device_thread_routine, device, "aud_device", std_thread_core_mask_any_m );
     }
 
-    aud_device_recycle_submission_contexts ( device, true );
-
-    aud_device_submit_context_t* submit_context = &device->submit_contexts[std_ring_top_idx ( &device->submit_ring )];
-    std_ring_push ( &device->submit_ring, 1 );
-
-#if defined(std_platform_win32_m)
-    submit_context->device = device_handle;
-    submit_context->win32_header.lpData = ( char* ) data;
-    submit_context->win32_header.dwBufferLength = ( DWORD ) size;
-    submit_context->is_submitted = true;
-
-    MMRESULT result = waveOutPrepareHeader ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
-    std_assert_m ( result == MMSYSERR_NOERROR );
-
-    result = waveOutWrite ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
-    std_assert_m ( result == MMSYSERR_NOERROR );
-#elif defined(std_platform_linux_m)
-    std_not_implemented_m();
-    std_unused_m ( submit_context );
-#endif
-}
-
-char* aud_device_get_buffer ( aud_device_h device_handle ) {
-    aud_device_t* device = &aud_device_state.devices_array[device_handle];
-    std_assert_m ( ( device->flags & aud_devuce_existing_m ) );
-
-    aud_device_submit_context_t* submit_context = &device->submit_contexts[std_ring_top_idx ( &device->submit_ring )];
-
-    return submit_context->data;
+    return result;
 }
 
-void aud_device_push_buffer ( aud_device_h device_handle, uint64_t buffer_size ) {
+bool aud_device_deactivate ( aud_device_h device_handle ) {
     aud_device_t* device = &aud_device_state.devices_array[device_handle];
-    std_assert_m ( ( device->flags & aud_devuce_existing_m ) );
 
-    aud_device_recycle_submission_contexts ( device, true );
+    if ( std_unlikely_m ( ( device->flags & aud_device_active_m ) == 0 ) ) {
+        return false;
+    }
 
-    aud_device_submit_context_t* submit_context = &device->submit_contexts[std_ring_top_idx ( &device->submit_ring )];
-    std_assert_m ( buffer_size <= submit_context->size );
-    std_ring_push ( &device->submit_ring, 1 );
+    device->stop = true;
+    std_thread_join ( device->thread );
+    aud_source_end_output();
 
 #if defined(std_platform_win32_m)
-    submit_context->device = device_handle;
-    submit_context->win32_header.lpData = ( char* ) submit_context->data;
-    submit_context->win32_header.dwBufferLength = ( DWORD ) buffer_size;
-    submit_context->is_submitted = true;
-
-    MMRESULT result = waveOutPrepareHeader ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
-    std_assert_m ( result == MMSYSERR_NOERROR );
-
-    result = waveOutWrite ( ( HWAVEOUT ) device->os_handle, &submit_context->win32_header, sizeof ( WAVEHDR ) );
-    std_assert_m ( result == MMSYSERR_NOERROR );
+    // Marks whatever is still queued as done
+    waveOutReset ( ( HWAVEOUT ) device->os_handle );
+    aud_device_recycle_submission_contexts ( device );
+    waveOutClose ( ( HWAVEOUT ) device->os_handle );
+    CloseHandle ( ( HANDLE ) device->os_event );
+
+    for ( uint64_t i = 0; i < aud_device_max_submit_contexts_m; ++i ) {
+        std_virtual_heap_free ( device->submit_contexts[i].data );
+    }
 #elif defined(std_platform_linux_m)
-    std_not_implemented_m();
+    snd_pcm_t* pcm = ( snd_pcm_t* ) device->os_handle;
+    snd_pcm_drop ( pcm );
+    snd_pcm_close ( pcm );
+    std_virtual_heap_free ( device->period_buffer );
 #endif
-}
 
-const std_ring_t* aud_device_get_ring ( aud_device_h device_handle ) {
-    aud_device_t* device = &aud_device_state.devices_array[device_handle];
-    std_assert_m ( ( device->flags & aud_devuce_existing_m ) );
-    return &device->submit_ring;
-}
+    device->flags &= ~aud_device_active_m;
+    aud_device_state.output_device = UINT64_MAX;
 
-void aud_device_update_ring ( aud_device_h device_handle ) {
-    aud_device_t* device = &aud_device_state.devices_array[device_handle];
-    std_assert_m ( ( device->flags & aud_devuce_existing_m ) );
-
-    aud_device_recycle_submission_contexts ( device, false );
+    return true;
 }
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <aud.h>
 
 #include <std_queue.h>
@@ -7,17 +9,10 @@ size_t      aud_device_get_count ( void );
 size_t      aud_device_get_list ( aud_device_h* devices, size_t cap );
 bool        aud_device_get_info ( aud_device_info_t* info, aud_device_h device );
 
+// Starts a thread that mixes the playing sources into the device until it's deactivated. Only one device can be
+// active at a time.
 bool        aud_device_activate ( aud_device_h device, const aud_device_params_t* params );
 bool        aud_device_deactivate ( aud_device_h device );
 
-// TODO delete this?
-void        aud_device_play ( aud_device_h device, void* data, size_t size );
-
 void        aud_device_init ( void );
 void        aud_device_shutdown ( void );
-
-char*       aud_device_get_buffer ( aud_device_h device );
-void        aud_device_push_buffer ( aud_device_h device, uint64_t buffer_size );
-
-const std_ring_t*   aud_device_get_ring ( aud_device_h device );
-void                aud_device_update_ring ( aud_device_h device );
@@ -1,66 +1,419 @@
 #include "aud_mixer.h"
 
 #include <std_log.h>
+#include <std_byte.h>
+#include <std_mutex.h>
+#include <std_atomic.h>
 
-#include "aud_source.h"
-#include "aud_device.h"
+#include <math.h>
 
-void aud_mixer_mix_sources ( aud_source_t* sources, uint64_t count, aud_device_h device_handle, double milliseconds ) {
-    aud_device_t* device = aud_device_get ( device_handle );
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define aud_mixer_sse_m 1
+#else
+    #define aud_mixer_sse_m 0
+#endif
 
-    double device_sample_period = 1.0 / device->params.sample_frequency;
+/*
+    https://ccrma.stanford.edu/~jos/resample/
+    https://en.wikipedia.org/wiki/Window_function#Blackman_window
 
-    if ( device_sample_period * 1000 < milliseconds ) {
-        std_log_warn_m ( "Requested mixing time duration is smaller than the selected device sample period" );
-        return;
+    Sources are mixed in blocks. Each block of source data is first converted to float, then resampled by a polyphase
+    windowed sinc filter: the fractional position of every output sample picks two of the precomputed filter phases,
+    which get interpolated and applied to the taps around it. The result is scaled by the source volume and summed.
+    Play positions are kept in source frames with a 32 bit fraction, so they never drift.
+*/
+
+#define aud_mixer_filter_phase_bits_m 8
+std_static_assert_m ( ( 1 << aud_mixer_filter_phase_bits_m ) == aud_mixer_filter_phases_m );
+std_static_assert_m ( aud_mixer_filter_taps_m % 4 == 0 );
+
+#define aud_mixer_fraction_one_m ( 1ull << 32 )
+// Input frames a block can need, the taps cover half the filter length on each side of the resampled positions
+#define aud_mixer_block_input_frames_m ( aud_mixer_block_frames_m * aud_mixer_max_rate_ratio_m + aud_mixer_filter_taps_m + 1 )
+// Fraction of the lower Nyquist frequency that's let through, what's above is the filter transition band
+#define aud_mixer_filter_cutoff_m 0.9
+#define aud_mixer_pi_m 3.14159265358979323846
+
+typedef struct {
+    // Zero for the bank shared by all ratios that don't need to filter the source below its own Nyquist frequency
+    uint64_t step;
+    // One more phase than needed, so the last can be interpolated with the next
+    float taps[aud_mixer_filter_phases_m + 1][aud_mixer_filter_taps_m];
+} aud_mixer_filter_t;
+
+typedef struct {
+    aud_mixer_filter_t filters[aud_mixer_max_filters_m];
+    uint32_t filter_count;
+    // Taken when adding banks, never when reading them
+    std_mutex_t mutex;
+    uint32_t dither_state;
+} aud_mixer_state_t;
+
+static aud_mixer_state_t aud_mixer_state;
+
+// --
+
+static void aud_mixer_build_filter ( aud_mixer_filter_t* filter, uint64_t step ) {
+    // Downsampling has to cut what the output rate can't represent, upsampling only what the source can't
+    double ratio = step > aud_mixer_fraction_one_m ? ( double ) aud_mixer_fraction_one_m / step : 1;
+    double cutoff = ratio * aud_mixer_filter_cutoff_m;
+    double half_length = aud_mixer_filter_taps_m / 2.0;
+    filter->step = step > aud_mixer_fraction_one_m ? step : 0;
+
+    for ( uint32_t phase = 0; phase <= aud_mixer_filter_phases_m; ++phase ) {
+        double fraction = ( double ) phase / aud_mixer_filter_phases_m;
+        double sum = 0;
+
+        for ( uint32_t tap = 0; tap < aud_mixer_filter_taps_m; ++tap ) {
+            // Distance of the tap from the resampled position
+            double x = tap - ( half_length - 1 ) - fraction;
+            double sinc = x == 0 ? 1 : sin ( aud_mixer_pi_m * cutoff * x ) / ( aud_mixer_pi_m * cutoff * x );
+            double w = ( x + half_length ) / ( 2 * half_length );
+            double window = w <= 0 || w >= 1 ? 0 : 0.42 - 0.5 * cos ( 2 * aud_mixer_pi_m * w ) + 0.08 * cos ( 4 * aud_mixer_pi_m * w );
+            double value = cutoff * sinc * window;
+            filter->taps[phase][tap] = ( float ) value;
+            sum += value;
+        }
+
+        // Unity gain at DC on every phase, otherwise the phases would modulate the signal
+        for ( uint32_t tap = 0; tap < aud_mixer_filter_taps_m; ++tap ) {
+            filter->taps[phase][tap] = ( float ) ( filter->taps[phase][tap] / sum );
+        }
     }
+}
+
+static uint64_t aud_mixer_filter_key ( uint64_t step ) {
+    return step > aud_mixer_fraction_one_m ? step : 0;
+}
+
+static uint64_t aud_mixer_step ( uint64_t source_frequency, uint64_t output_frequency ) {
+    return ( source_frequency << 32 ) / output_frequency;
+}
+
+// Doesn't lock, so it can run on the device thread. Banks are only ever appended, and the count is bumped after the
+// bank is written.
+static const aud_mixer_filter_t* aud_mixer_get_filter ( uint64_t step ) {
+    uint64_t key = aud_mixer_filter_key ( step );
+    uint32_t filter_count = aud_mixer_state.filter_count;
+    std_assert_m ( filter_count > 0 );
+
+    // Either it was prepared, or the banks ran out and the one with the closest ratio is the best guess
+    const aud_mixer_filter_t* result = &aud_mixer_state.filters[0];
+
+    for ( uint32_t i = 0; i < filter_count; ++i ) {
+        const aud_mixer_filter_t* filter = &aud_mixer_state.filters[i];
+
+        if ( filter->step == key ) {
+            return filter;
+        }
+
+        uint64_t distance = filter->step > key ? filter->step - key : key - filter->step;
+        uint64_t best_distance = result->step > key ? result->step - key : key - result->step;
+        result = distance < best_distance ? filter : result;
+    }
+
+    return result;
+}
 
-    // amount of samples to feed to the device
-    uint64_t sample_count = ( uint64_t ) ( ms * device->params.sample_frequency / 1000.0 );
-    std_assert_m ( sample_count > 0 );
+// --
 
-    for ( uint64_t source_it = 0; source_it < aud_source_state.active_sources_count; ++source_it ) {
-        aud_source_t* source = sources[source_it];
+static void aud_mixer_convert_samples ( float* out, const char* base, uint64_t count, uint64_t stride ) {
+    uint64_t i = 0;
 
-        // resample the source data according to the device format
-        uint64_t source_sample_stride = source->params.bits_per_sample / 8;
+    switch ( stride ) {
+        case 1: {
+            const uint8_t* in = ( const uint8_t* ) base;
 
-        for ( uint64_t sample_it = 0; sample_it < sample_count; ++sample_it ) {
-            double t = sample_it * device_sample_period + source->played_time;
+            for ( ; i < count; ++i ) {
+                out[i] = ( ( int32_t ) in[i] - 128 ) * ( 1.f / 128 );
+            }
+        } break;
 
-            double source_sample = t * source->sample_frequency;
-            uint64_t source_sample_idx_a = ( uint64_t ) source_sample;
-            double decimal = source_sample - source_sample_idx_a;
-            uint64_t source_sample_idx_b = ( uint64_t ) ( source_sample + 1 );
+        case 2: {
+            const int16_t* in = ( const int16_t* ) base;
+#if aud_mixer_sse_m
+            __m128 scale = _mm_set1_ps ( 1.f / 32768 );
 
-            char* source_sample_a = source->buffer.base + source_sample_idx_a * source_sample_stride;
-            char* source_sample_b = source->buffer.base + source_sample_idx_b * source_sample_stride;
+            for ( ; i + 8 <= count; i += 8 ) {
+                __m128i v = _mm_loadu_si128 ( ( const __m128i* ) ( in + i ) );
+                // Sign extend by moving each value to the high half and shifting it back down
+                __m128i lo = _mm_srai_epi32 ( _mm_unpacklo_epi16 ( v, v ), 16 );
+                __m128i hi = _mm_srai_epi32 ( _mm_unpackhi_epi16 ( v, v ), 16 );
+                _mm_storeu_ps ( out + i, _mm_mul_ps ( _mm_cvtepi32_ps ( lo ), scale ) );
+                _mm_storeu_ps ( out + i + 4, _mm_mul_ps ( _mm_cvtepi32_ps ( hi ), scale ) );
+            }
+#endif
 
-            float sample_a, sample_b;
+            for ( ; i < count; ++i ) {
+                out[i] = in[i] * ( 1.f / 32768 );
+            }
+        } break;
 
-            switch ( source_sample_stride ) {
-                case 8:
-                    sample_a = ( ( int8_t ) ( *source_sample_a ) ) / ( ( float ) INT8_MAX );
-                    sample_a = ( ( int8_t ) ( *source_sample_b ) ) / ( ( float ) INT8_MAX );
-                    break;
+        case 3: {
+            const uint8_t* in = ( const uint8_t* ) base;
 
-                case 16:
-                    sample_a = ( ( int16_t ) ( *source_sample_a ) ) / ( ( float ) INT16_MAX );
-                    sample_a = ( ( int16_t ) ( *source_sample_b ) ) / ( ( float ) INT16_MAX );
-                    break;
+            for ( ; i < count; ++i ) {
+                int32_t value = ( int32_t ) ( ( uint32_t ) in[i * 3] << 8 | ( uint32_t ) in[i * 3 + 1] << 16 | ( uint32_t ) in[i * 3 + 2] << 24 ) >> 8;
+                out[i] = value * ( 1.f / 8388608 );
+            }
+        } break;
 
-                case 24:
-                    std_not_implemented_m();
-                    break;
+        case 4: {
+            const int32_t* in = ( const int32_t* ) base;
+#if aud_mixer_sse_m
+            __m128 scale = _mm_set1_ps ( 1.f / 2147483648.f );
 
-                case 32:
-                    sample_a = ( ( int32_t ) ( *source_sample_a ) ) / ( ( float ) INT32_MAX );
-                    sample_a = ( ( int32_t ) ( *source_sample_b ) ) / ( ( float ) INT32_MAX );
-                    break;
+            for ( ; i + 4 <= count; i += 4 ) {
+                __m128i v = _mm_loadu_si128 ( ( const __m128i* ) ( in + i ) );
+                _mm_storeu_ps ( out + i, _mm_mul_ps ( _mm_cvtepi32_ps ( v ), scale ) );
             }
+#endif
+
+            for ( ; i < count; ++i ) {
+                out[i] = in[i] * ( 1.f / 2147483648.f );
+            }
+        } break;
+
+        default:
+            std_not_implemented_m();
+    }
+}
+
+// Converts count source frames starting at first to float. Frames that aren't there, either before the start or past
+// what was fed so far, are silent. Streamed sources only keep the last ring_frames frames around, and wrap.
+static void aud_mixer_convert_source ( float* dest, const aud_source_t* source, int64_t first, uint64_t count ) {
+    uint64_t stride = source->params.bits_per_sample / 8;
+    int64_t available = ( int64_t ) ( source->size / stride );
+    int64_t oldest = source->ring_frames > 0 ? available - ( int64_t ) source->ring_frames : 0;
+    int64_t begin = std_max_i64 ( first, std_max_i64 ( oldest, 0 ) );
+    int64_t end = std_min_i64 ( first + ( int64_t ) count, available );
+
+    if ( begin >= end ) {
+        std_mem_set ( dest, count * sizeof ( float ), 0 );
+        return;
+    }
+
+    uint64_t lead = ( uint64_t ) ( begin - first );
+    uint64_t valid = ( uint64_t ) ( end - begin );
+    std_mem_set ( dest, lead * sizeof ( float ), 0 );
+    std_mem_set ( dest + lead + valid, ( count - lead - valid ) * sizeof ( float ), 0 );
 
-            float result = sample_a * ( 1 - decimal ) + sample_b * decimal;
-            std_unused_m ( result ); // TODO
+    const char* base = ( const char* ) source->stack.begin;
+
+    if ( source->ring_frames == 0 ) {
+        aud_mixer_convert_samples ( dest + lead, base + begin * stride, valid, stride );
+        return;
+    }
+
+    uint64_t ring_begin = ( uint64_t ) begin % source->ring_frames;
+    uint64_t head = std_min_u64 ( valid, source->ring_frames - ring_begin );
+    aud_mixer_convert_samples ( dest + lead, base + ring_begin * stride, head, stride );
+    aud_mixer_convert_samples ( dest + lead + head, base, valid - head, stride );
+}
+
+// Filters the input at count positions, starting at fraction and moving by step each time. Returns the input frames
+// the block moved past, the fraction is updated to where the next block starts.
+static uint64_t aud_mixer_resample ( float* dest, const float* input, uint64_t count, uint32_t* fraction, uint64_t step, const aud_mixer_filter_t* filter ) {
+    uint64_t position = *fraction;
+
+    for ( uint64_t i = 0; i < count; ++i ) {
+        const float* in = input + ( position >> 32 );
+        uint32_t frac = ( uint32_t ) position;
+        uint32_t phase = frac >> ( 32 - aud_mixer_filter_phase_bits_m );
+        float t = ( frac & ( ( 1u << ( 32 - aud_mixer_filter_phase_bits_m ) ) - 1 ) ) * ( 1.f / ( 1u << ( 32 - aud_mixer_filter_phase_bits_m ) ) );
+        const float* taps0 = filter->taps[phase];
+        const float* taps1 = filter->taps[phase + 1];
+#if aud_mixer_sse_m
+        __m128 vt = _mm_set1_ps ( t );
+        __m128 sum = _mm_setzero_ps();
+
+        for ( uint32_t k = 0; k < aud_mixer_filter_taps_m; k += 4 ) {
+            __m128 h0 = _mm_loadu_ps ( taps0 + k );
+            __m128 h1 = _mm_loadu_ps ( taps1 + k );
+            __m128 h = _mm_add_ps ( h0, _mm_mul_ps ( _mm_sub_ps ( h1, h0 ), vt ) );
+            sum = _mm_add_ps ( sum, _mm_mul_ps ( _mm_loadu_ps ( in + k ), h ) );
+        }
+
+        // Horizontal add
+        sum = _mm_add_ps ( sum, _mm_movehl_ps ( sum, sum ) );
+        sum = _mm_add_ss ( sum, _mm_shuffle_ps ( sum, sum, 1 ) );
+        dest[i] = _mm_cvtss_f32 ( sum );
+#else
+        float sum = 0;
+
+        for ( uint32_t k = 0; k < aud_mixer_filter_taps_m; ++k ) {
+            sum += in[k] * ( taps0[k] + ( taps1[k] - taps0[k] ) * t );
         }
+
+        dest[i] = sum;
+#endif
+        position += step;
+    }
+
+    *fraction = ( uint32_t ) position;
+    return position >> 32;
+}
+
+static void aud_mixer_accumulate ( float* mix, const float* samples, uint64_t count, float volume ) {
+    uint64_t i = 0;
+#if aud_mixer_sse_m
+    __m128 v = _mm_set1_ps ( volume );
+
+    for ( ; i + 4 <= count; i += 4 ) {
+        __m128 sum = _mm_add_ps ( _mm_loadu_ps ( mix + i ), _mm_mul_ps ( _mm_loadu_ps ( samples + i ), v ) );
+        _mm_storeu_ps ( mix + i, sum );
+    }
+#endif
+
+    for ( ; i < count; ++i ) {
+        mix[i] += samples[i] * volume;
+    }
+}
+
+static void aud_mixer_mix_source ( float* mix, uint64_t frame_count, aud_source_t* source, uint64_t output_frequency ) {
+    float input[aud_mixer_block_input_frames_m];
+    float resampled[aud_mixer_block_frames_m];
+
+    uint64_t step = aud_mixer_step ( source->params.sample_frequency, output_frequency );
+    std_assert_m ( step <= aud_mixer_max_rate_ratio_m * aud_mixer_fraction_one_m );
+
+    // Same rate, already on a source frame, samples go straight through
+    if ( step == aud_mixer_fraction_one_m && source->phase == 0 ) {
+        aud_mixer_convert_source ( input, source, ( int64_t ) source->position, frame_count );
+        aud_mixer_accumulate ( mix, input, frame_count, source->volume );
+        source->position += frame_count;
+        return;
+    }
+
+    const aud_mixer_filter_t* filter = aud_mixer_get_filter ( step );
+    uint64_t last_position = ( source->phase + step * ( frame_count - 1 ) ) >> 32;
+    uint64_t input_count = last_position + aud_mixer_filter_taps_m;
+    std_assert_m ( input_count <= aud_mixer_block_input_frames_m );
+
+    aud_mixer_convert_source ( input, source, ( int64_t ) source->position - ( aud_mixer_filter_taps_m / 2 - 1 ), input_count );
+    source->position += aud_mixer_resample ( resampled, input, frame_count, &source->phase, step, filter );
+    aud_mixer_accumulate ( mix, resampled, frame_count, source->volume );
+}
+
+// --
+
+// Uniform in [0, 1)
+static float aud_mixer_dither_random ( void ) {
+    uint32_t x = aud_mixer_state.dither_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    aud_mixer_state.dither_state = x;
+    return ( x >> 8 ) * ( 1.f / ( 1 << 24 ) );
+}
+
+static void aud_mixer_write_output ( char* dest, const float* mix, uint64_t frame_count, const aud_device_params_t* format ) {
+    uint64_t channels = format->channels;
+
+    for ( uint64_t i = 0; i < frame_count; ++i ) {
+        float value = std_min_f32 ( std_max_f32 ( mix[i], -1 ), 1 );
+
+        switch ( format->bits_per_sample ) {
+            case 8: {
+                // Triangular dither of one step, it turns the quantization error into noise that isn't correlated
+                // with the signal
+                float dither = aud_mixer_dither_random() - aud_mixer_dither_random();
+                int32_t sample = ( int32_t ) lrintf ( value * 127 + dither );
+                uint8_t out = ( uint8_t ) ( std_min_i32 ( std_max_i32 ( sample, -128 ), 127 ) + 128 );
+
+                for ( uint64_t c = 0; c < channels; ++c ) {
+                    dest[i * channels + c] = ( char ) out;
+                }
+            } break;
+
+            case 16: {
+                float dither = aud_mixer_dither_random() - aud_mixer_dither_random();
+                int32_t sample = ( int32_t ) lrintf ( value * 32767 + dither );
+                int16_t out = ( int16_t ) std_min_i32 ( std_max_i32 ( sample, -32768 ), 32767 );
+                int16_t* out_frame = ( int16_t* ) dest + i * channels;
+
+                for ( uint64_t c = 0; c < channels; ++c ) {
+                    out_frame[c] = out;
+                }
+            } break;
+
+            // Float has less precision than these, there's nothing left to dither
+            case 24: {
+                int32_t out = ( int32_t ) lrintf ( value * 8388607 );
+                char* out_frame = dest + i * channels * 3;
+
+                for ( uint64_t c = 0; c < channels; ++c ) {
+                    out_frame[c * 3] = ( char ) out;
+                    out_frame[c * 3 + 1] = ( char ) ( out >> 8 );
+                    out_frame[c * 3 + 2] = ( char ) ( out >> 16 );
+                }
+            } break;
+
+            case 32: {
+                int32_t out = ( int32_t ) lrint ( value * 2147483647.0 );
+                int32_t* out_frame = ( int32_t* ) dest + i * channels;
+
+                for ( uint64_t c = 0; c < channels; ++c ) {
+                    out_frame[c] = out;
+                }
+            } break;
+
+            default:
+                std_not_implemented_m();
+        }
+    }
+}
+
+// --
+
+void aud_mixer_init ( void ) {
+    aud_mixer_state.dither_state = 0x9e3779b9;
+    std_mutex_init ( &aud_mixer_state.mutex );
+
+    // Same rate and upsampling share this one, there's always at least a bank to fall back to
+    aud_mixer_build_filter ( &aud_mixer_state.filters[0], aud_mixer_fraction_one_m );
+    aud_mixer_state.filter_count = 1;
+}
+
+void aud_mixer_deinit ( void ) {
+    std_mutex_deinit ( &aud_mixer_state.mutex );
+}
+
+void aud_mixer_prepare_filter ( uint64_t source_frequency, uint64_t output_frequency ) {
+    uint64_t step = aud_mixer_step ( source_frequency, output_frequency );
+    uint64_t key = aud_mixer_filter_key ( step );
+
+    std_mutex_lock ( &aud_mixer_state.mutex );
+
+    bool found = false;
+
+    for ( uint32_t i = 0; i < aud_mixer_state.filter_count; ++i ) {
+        found |= aud_mixer_state.filters[i].step == key;
+    }
+
+    if ( !found && aud_mixer_state.filter_count < aud_mixer_max_filters_m ) {
+        aud_mixer_build_filter ( &aud_mixer_state.filters[aud_mixer_state.filter_count], step );
+        std_compiler_fence();
+        ++aud_mixer_state.filter_count;
+    }
+
+    std_mutex_unlock ( &aud_mixer_state.mutex );
+}
+
+void aud_mixer_mix_sources ( void* dest, const aud_device_params_t* format, uint64_t frame_count, aud_source_t** sources, uint64_t count ) {
+    float mix[aud_mixer_block_frames_m];
+    char* out = ( char* ) dest;
+    uint64_t frame_size = format->channels * format->bits_per_sample / 8;
+
+    for ( uint64_t block_start = 0; block_start < frame_count; block_start += aud_mixer_block_frames_m ) {
+        uint64_t block_count = std_min_u64 ( frame_count - block_start, aud_mixer_block_frames_m );
+        std_mem_set ( mix, block_count * sizeof ( float ), 0 );
+
+        for ( uint64_t i = 0; i < count; ++i ) {
+            aud_mixer_mix_source ( mix, block_count, sources[i], format->sample_frequency );
+        }
+
+        aud_mixer_write_output ( out + block_start * frame_size, mix, block_count, format );
     }
 }
@@ -1,5 +1,17 @@
+#pragma once
+
 #include <aud.h>
 
+#include "aud_source.h"
+
 void aud_mixer_init ( void );
+void aud_mixer_deinit ( void );
+
+// Builds the resampling filter for the rate pair if it isn't there yet. Mixing never builds filters, it takes the
+// closest one that's been prepared.
+void aud_mixer_prepare_filter ( uint64_t source_frequency, uint64_t output_frequency );
 
-void aud_mixer_mix_sources ( aud_source_t* sources, uint64_t count, aud_device_h device, double milliseconds );
+// Mixes frame_count frames of the sources into dest, in the output format, and advances the sources by the same time.
+// Sources are resampled to the output rate, scaled by their volume and summed, the sum is clamped and dithered down
+// to the output bit depth. Mono sources are copied to all output channels. Doesn't lock or allocate.
+void aud_mixer_mix_sources ( void* dest, const aud_device_params_t* format, uint64_t frame_count, aud_source_t** sources, uint64_t count );
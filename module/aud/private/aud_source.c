@@ -1,18 +1,55 @@
 #include "aud_source.h"
 
 #include "aud_device.h"
+#include "aud_mixer.h"
+#include "aud_stream.h"
 
 #include <std_list.h>
 #include <std_mutex.h>
 #include <std_allocator.h>
+#include <std_queue.h>
+#include <std_thread.h>
 
 std_warnings_ignore_m ( "-Wunused-variable" )
 
+/*
+    Callers never touch what the mixer reads. Every change to a source is pushed as a command on a SPSC queue, and
+    applied by whoever mixes right before it mixes. While a device is active that's the device thread, otherwise
+    there's nothing else running and commands are applied as soon as they're pushed.
+    Destroyed sources travel back on a second SPSC queue, so that their memory is freed on the caller side and never
+    by the device thread.
+*/
+
+typedef enum {
+    aud_source_command_play_m,
+    aud_source_command_pause_m,
+    aud_source_command_reset_m,
+    aud_source_command_set_volume_m,
+    aud_source_command_feed_m,
+    aud_source_command_destroy_m,
+} aud_source_command_e;
+
+typedef struct {
+    uint32_t type;
+    uint32_t source;
+    union {
+        float volume;
+        uint64_t size;
+    };
+} aud_source_command_t;
+
 typedef struct {
     aud_source_t* sources_array;
     aud_source_t* sources_freelist;
+    // Serializes the callers, which makes them a single producer on the command queue
     std_mutex_t sources_mutex;
 
+    std_queue_shared_t command_queue;
+    std_queue_shared_t retire_queue;
+    bool is_output_active;
+    aud_device_params_t output_format;
+
+    // Owned by the mixing side
     aud_source_t* active_sources[aud_source_max_playing_sources_m];
     uint64_t active_sources_count;
 } aud_source_state_t;
@@ -26,39 +63,193 @@ void aud_source_init ( void ) {
     aud_source_state.sources_freelist = std_static_freelist_m ( sources_array );
     std_mutex_init ( &aud_source_state.sources_mutex );
 
+    aud_source_state.command_queue = std_queue_shared_create ( aud_source_command_queue_size_m );
+    // Every source can be retired at most once before it's created again, so this never fills up
+    aud_source_state.retire_queue = std_queue_shared_create ( aud_source_max_sources_m * sizeof ( uint64_t ) );
+    aud_source_state.is_output_active = false;
+
     aud_source_state.active_sources_count = 0;
 }
 
-aud_source_h aud_source_create ( const aud_source_params_t* params ) {
+void aud_source_deinit ( void ) {
+    std_queue_shared_destroy ( &aud_source_state.command_queue );
+    std_queue_shared_destroy ( &aud_source_state.retire_queue );
+    std_mutex_deinit ( &aud_source_state.sources_mutex );
+}
+
+// --
+// Mixing side
+
+// Swaps the last active source in its place
+static void aud_source_remove_active ( aud_source_t* source ) {
+    if ( source->active_idx == UINT64_MAX ) {
+        return;
+    }
+
+    aud_source_t* last = aud_source_state.active_sources[--aud_source_state.active_sources_count];
+    aud_source_state.active_sources[source->active_idx] = last;
+    last->active_idx = source->active_idx;
+    source->active_idx = UINT64_MAX;
+}
+
+static void aud_source_apply_command ( const aud_source_command_t* command ) {
+    aud_source_t* source = &aud_source_state.sources_array[command->source];
+
+    switch ( command->type ) {
+        case aud_source_command_play_m:
+            // Past the playing sources cap the play is dropped, there's no one to report it to from here
+            if ( source->active_idx == UINT64_MAX && aud_source_state.active_sources_count < aud_source_max_playing_sources_m ) {
+                aud_source_state.active_sources[aud_source_state.active_sources_count] = source;
+                source->active_idx = aud_source_state.active_sources_count++;
+            }
+
+            break;
+
+        case aud_source_command_pause_m:
+            aud_source_remove_active ( source );
+            break;
+
+        case aud_source_command_reset_m:
+            source->position = 0;
+            source->phase = 0;
+            break;
+
+        case aud_source_command_set_volume_m:
+            source->volume = command->volume;
+            break;
+
+        case aud_source_command_feed_m:
+            source->size = command->size;
+            break;
+
+        case aud_source_command_destroy_m: {
+            aud_source_remove_active ( source );
+            uint64_t handle = command->source;
+            std_queue_spsc_push ( &aud_source_state.retire_queue, &handle, sizeof ( handle ) );
+        } break;
+    }
+}
+
+static void aud_source_apply_commands ( void ) {
+    std_queue_shared_t* queue = &aud_source_state.command_queue;
+
+    while ( std_queue_shared_used_size ( queue ) >= sizeof ( aud_source_command_t ) ) {
+        aud_source_command_t command;
+        std_queue_spsc_pop_move ( queue, &command, sizeof ( command ) );
+        aud_source_apply_command ( &command );
+    }
+}
+
+void aud_source_render ( void* dest, const aud_device_params_t* format, uint64_t frame_count ) {
+    aud_source_apply_commands();
+
+    // TODO set a source to inactive once it's played all its samples
+    aud_mixer_mix_sources ( dest, format, frame_count, aud_source_state.active_sources, aud_source_state.active_sources_count );
+}
+
+// --
+// Caller side, all with the sources mutex locked
+
+static void aud_source_push_command ( const aud_source_command_t* command ) {
+    if ( !aud_source_state.is_output_active ) {
+        aud_source_apply_command ( command );
+        return;
+    }
+
+    std_queue_shared_t* queue = &aud_source_state.command_queue;
+
+    // A full queue means the device thread is behind, all that can be done is wait for it
+    while ( std_queue_shared_size ( queue ) - std_queue_shared_used_size ( queue ) < sizeof ( *command ) ) {
+        std_thread_this_yield();
+    }
+
+    std_queue_spsc_push ( queue, command, sizeof ( *command ) );
+}
+
+static void aud_source_collect_retired ( void ) {
+    std_queue_shared_t* queue = &aud_source_state.retire_queue;
+
+    while ( std_queue_shared_used_size ( queue ) >= sizeof ( uint64_t ) ) {
+        uint64_t handle;
+        std_queue_spsc_pop_move ( queue, &handle, sizeof ( handle ) );
+
+        aud_source_t* source = &aud_source_state.sources_array[handle];
+        std_virtual_heap_free ( source->stack.begin );
+        //std_virtual_buffer_free ( &source->buffer );
+        std_list_push ( &aud_source_state.sources_freelist, source );
+    }
+}
+
+// --
+
+static aud_source_h aud_source_alloc ( const aud_source_params_t* params, uint64_t size, uint64_t ring_frames, uint64_t stream ) {
+    std_mutex_lock ( &aud_source_state.sources_mutex );
+
+    aud_source_collect_retired();
     aud_source_t* source = std_list_pop_m ( &aud_source_state.sources_freelist );
 
     source->params = *params;
-    uint64_t size = params->capacity_ms * params->sample_frequency * params->bits_per_sample / 8 / 1000;
     //source->buffer = std_virtual_buffer_reserve ( std_align ( size, std_virtual_page_size() ) );
     void* buffer = std_virtual_heap_alloc_m ( size, 8 );
     source->stack = std_stack ( buffer, size );
-    source->time_played = 0;
+    source->ring_frames = ring_frames;
+    source->stream = stream;
+    // The mixing side doesn't look at the source before the first command about it, which publishes these
+    source->size = 0;
+    source->position = 0;
+    source->phase = 0;
     source->volume = 1;
     source->active_idx = UINT64_MAX;
 
+    std_mutex_unlock ( &aud_source_state.sources_mutex );
+
     aud_source_h handle = ( aud_source_h ) ( source - aud_source_state.sources_array );
     return handle;
 }
 
+aud_source_h aud_source_create ( const aud_source_params_t* params ) {
+    uint64_t size = params->capacity_ms * params->sample_frequency * params->bits_per_sample / 8 / 1000;
+    return aud_source_alloc ( params, size, 0, UINT64_MAX );
+}
+
+aud_source_h aud_source_create_stream ( const aud_source_params_t* params, uint64_t ring_frames, uint64_t stream ) {
+    uint64_t size = ring_frames * params->bits_per_sample / 8;
+    return aud_source_alloc ( params, size, ring_frames, stream );
+}
+
 void aud_source_feed ( aud_source_h source_handle, const void* data, uint64_t size ) {
+    std_mutex_lock ( &aud_source_state.sources_mutex );
+
     aud_source_t* source = &aud_source_state.sources_array[source_handle];
+    std_assert_m ( source->stream == UINT64_MAX );
     //void* base = source->buffer.base + source->buffer.top;
     //std_virtual_buffer_push ( &source->buffer, size );
     //std_mem_copy ( base, data, size );
+    // Past the mixed size, the mixer doesn't read this until the command below
     std_stack_write ( &source->stack, data, size );
+
+    aud_source_command_t command;
+    command.type = aud_source_command_feed_m;
+    command.source = ( uint32_t ) source_handle;
+    command.size = ( uint64_t ) ( ( char* ) source->stack.top - ( char* ) source->stack.begin );
+    aud_source_push_command ( &command );
+
+    std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
 
 void aud_source_play ( aud_source_h source_handle ) {
     std_mutex_lock ( &aud_source_state.sources_mutex );
 
     aud_source_t* source = &aud_source_state.sources_array[source_handle];
-    aud_source_state.active_sources[aud_source_state.active_sources_count] = source;
-    source->active_idx = aud_source_state.active_sources_count++;
+
+    if ( aud_source_state.is_output_active ) {
+        aud_mixer_prepare_filter ( source->params.sample_frequency, aud_source_state.output_format.sample_frequency );
+    }
+
+    aud_source_command_t command;
+    command.type = aud_source_command_play_m;
+    command.source = ( uint32_t ) source_handle;
+    aud_source_push_command ( &command );
 
     std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
@@ -66,9 +257,10 @@ void aud_source_play ( aud_source_h source_handle ) {
 void aud_source_pause ( aud_source_h source_handle ) {
     std_mutex_lock ( &aud_source_state.sources_mutex );
 
-    aud_source_t* source = &aud_source_state.sources_array[source_handle];
-    aud_source_state.active_sources[source->active_idx] = aud_source_state.active_sources[aud_source_state.active_sources_count--];
-    source->active_idx = UINT64_MAX;
+    aud_source_command_t command;
+    command.type = aud_source_command_pause_m;
+    command.source = ( uint32_t ) source_handle;
+    aud_source_push_command ( &command );
 
     std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
@@ -76,28 +268,48 @@ void aud_source_pause ( aud_source_h source_handle ) {
 void aud_source_reset ( aud_source_h source_handle ) {
     std_mutex_lock ( &aud_source_state.sources_mutex );
 
-    aud_source_t* source = &aud_source_state.sources_array[source_handle];
-    source->time_played = 0;
+    aud_source_command_t command;
+    command.type = aud_source_command_reset_m;
+    command.source = ( uint32_t ) source_handle;
+    aud_source_push_command ( &command );
 
     std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
 
 void aud_source_destroy ( aud_source_h source_handle ) {
+    aud_source_t* source = &aud_source_state.sources_array[source_handle];
+
+    // The stream might still be decoding into it, it gets released once the stream is closed
+    if ( source->stream != UINT64_MAX ) {
+        aud_stream_destroy ( source->stream );
+        return;
+    }
+
+    aud_source_release ( source_handle );
+}
+
+void aud_source_release ( aud_source_h source_handle ) {
     std_mutex_lock ( &aud_source_state.sources_mutex );
 
-    aud_source_t* source = &aud_source_state.sources_array[source_handle];
-    aud_source_state.active_sources[source->active_idx] = aud_source_state.active_sources[aud_source_state.active_sources_count--];
-    std_virtual_heap_free ( source->stack.begin );
-    //std_virtual_buffer_free ( &source->buffer );
-    std_list_push ( &aud_source_state.sources_freelist, source );
+    aud_source_command_t command;
+    command.type = aud_source_command_destroy_m;
+    command.source = ( uint32_t ) source_handle;
+    aud_source_push_command ( &command );
+    aud_source_collect_retired();
 
     std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
 
 void aud_source_set_volume_scale ( aud_source_h source_handle, float scale ) {
-    aud_source_t* source = &aud_source_state.sources_array[source_handle];
+    std_mutex_lock ( &aud_source_state.sources_mutex );
 
-    source->volume = scale;
+    aud_source_command_t command;
+    command.type = aud_source_command_set_volume_m;
+    command.source = ( uint32_t ) source_handle;
+    command.volume = scale;
+    aud_source_push_command ( &command );
+
+    std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
 
 bool aud_source_get_info ( aud_source_info_t* info, aud_source_h source_handle ) {
@@ -105,102 +317,81 @@ bool aud_source_get_info ( aud_source_info_t* info, aud_source_h source_handle )
 
     info->sample_frequency = source->params.sample_frequency;
     info->bits_per_sample = source->params.bits_per_sample;
-    info->time_played = source->time_played;
+    // Written by the device thread while it mixes. An aligned 64 bit load doesn't tear, at worst the fraction is
+    // from the previous block.
+    info->time_played = ( source->position + source->phase / 4294967296.0 ) / source->params.sample_frequency;
 
     return true;
 }
 
-void aud_source_output_to_device ( aud_device_h device_handle, uint64_t ms ) {
-    // TODO avoid allocating on stack?
-    float buffer[aud_device_submit_block_max_ms_m * 44100 / 1000] = {0};
+void* aud_source_get_ring ( aud_source_h source_handle ) {
+    aud_source_t* source = &aud_source_state.sources_array[source_handle];
+    return source->stack.begin;
+}
 
-    double seconds = ms / 1000.0;
+void aud_source_publish ( aud_source_h source_handle, uint64_t size ) {
+    std_mutex_lock ( &aud_source_state.sources_mutex );
 
-    aud_device_info_t device_info;
-    aud_device_get_info ( &device_info, device_handle );
-    uint64_t sample_count = ( uint64_t ) ( seconds * device_info.sample_frequency );
-    double sample_period = 1.0 / device_info.sample_frequency;
+    aud_source_command_t command;
+    command.type = aud_source_command_feed_m;
+    command.source = ( uint32_t ) source_handle;
+    command.size = size;
+    aud_source_push_command ( &command );
 
-    std_mutex_lock ( &aud_source_state.sources_mutex );
+    std_mutex_unlock ( &aud_source_state.sources_mutex );
+}
 
-    // TODO set a source to inactive once it's played all its samples
-    for ( uint64_t source_it = 0; source_it < aud_source_state.active_sources_count; ++source_it ) {
-        aud_source_t* source = aud_source_state.active_sources[source_it];
-        uint64_t source_sample_stride = source->params.bits_per_sample / 8;
-
-        for ( uint64_t sample_it = 0; sample_it < sample_count; ++sample_it ) {
-            double t = sample_it * sample_period + source->time_played;
-
-            double source_sample = t * source->params.sample_frequency;
-            uint64_t source_sample_idx_a = ( uint64_t ) source_sample;
-            double decimal = source_sample - source_sample_idx_a;
-            uint64_t source_sample_idx_b = ( uint64_t ) ( source_sample + 1 );
-
-            char* source_sample_a = source->stack.begin + source_sample_idx_a * source_sample_stride;
-            char* source_sample_b = source->stack.begin + source_sample_idx_b * source_sample_stride;
-            double sample_a = 0;
-            double sample_b = 0;
-
-            // source range -> [0,1]
-            switch ( source_sample_stride ) {
-                case 1:
-                    sample_a = ( ( uint8_t ) ( *source_sample_a ) ) / ( ( float ) UINT8_MAX );
-                    sample_b = ( ( uint8_t ) ( *source_sample_b ) ) / ( ( float ) UINT8_MAX );
-                    break;
-
-                case 2:
-                    sample_a = ( ( int16_t ) ( *source_sample_a ) ) / ( ( float ) UINT16_MAX );
-                    sample_b = ( ( int16_t ) ( *source_sample_b ) ) / ( ( float ) UINT16_MAX );
-                    break;
-
-                case 3:
-                    std_not_implemented_m();
-                    break;
-
-                case 4:
-                    sample_a = ( ( int32_t ) ( *source_sample_a ) ) / ( ( float ) UINT32_MAX );
-                    sample_b = ( ( int32_t ) ( *source_sample_b ) ) / ( ( float ) UINT32_MAX );
-                    break;
-
-                default:
-                    std_not_implemented_m();
-            }
+// Same as the time played, it's written by the device thread and read as is
+uint64_t aud_source_get_position ( aud_source_h source_handle ) {
+    aud_source_t* source = &aud_source_state.sources_array[source_handle];
+    return source->position;
+}
 
-            float sample_value = ( float ) ( sample_a * ( 1 - decimal ) + sample_b * decimal );
-            // TODO zero the buffer at some point
-            buffer[sample_it] += sample_value * source->volume;
-        }
+uint64_t aud_source_get_stream ( aud_source_h source_handle ) {
+    aud_source_t* source = &aud_source_state.sources_array[source_handle];
+    return source->stream;
+}
 
-        source->time_played += seconds;
+void aud_source_mix ( void* dest, const aud_device_params_t* format, size_t frame_count, const aud_source_h* source_handles, size_t count ) {
+    aud_source_t* sources[aud_source_max_sources_m];
+    std_assert_m ( count <= aud_source_max_sources_m );
+
+    std_mutex_lock ( &aud_source_state.sources_mutex );
+    // With a device active the sources belong to its thread
+    std_assert_m ( !aud_source_state.is_output_active );
+
+    for ( size_t i = 0; i < count; ++i ) {
+        sources[i] = &aud_source_state.sources_array[source_handles[i]];
+        aud_mixer_prepare_filter ( sources[i]->params.sample_frequency, format->sample_frequency );
     }
 
+    aud_mixer_mix_sources ( dest, format, frame_count, sources, count );
     std_mutex_unlock ( &aud_source_state.sources_mutex );
+}
 
-    char* device_buffer = aud_device_get_buffer ( device_handle );
+void aud_source_begin_output ( const aud_device_params_t* format ) {
+    std_mutex_lock ( &aud_source_state.sources_mutex );
+    std_assert_m ( !aud_source_state.is_output_active );
 
-    for ( uint64_t i = 0; i < sample_count; ++i ) {
-        switch ( device_info.bits_per_sample ) {
-            case 8:
-                device_buffer[i] = ( uint8_t ) ( buffer[i] * ( float ) 0xff );
-                break;
+    // Filter banks get built here and not in the device thread
+    for ( uint64_t i = 0; i < aud_source_state.active_sources_count; ++i ) {
+        aud_mixer_prepare_filter ( aud_source_state.active_sources[i]->params.sample_frequency, format->sample_frequency );
+    }
 
-            case 16:
-                * ( ( uint16_t* ) ( device_buffer + i * 2 ) ) = ( uint16_t ) ( buffer[i] * ( float ) 0xffff );
-                break;
+    aud_source_state.output_format = *format;
+    aud_source_state.is_output_active = true;
 
-            case 24:
-                std_not_implemented_m();
+    std_mutex_unlock ( &aud_source_state.sources_mutex );
+}
 
-            case 32: {
-                float v = buffer[i];
-                * ( ( uint32_t* ) ( device_buffer + i * 4 ) ) = ( uint32_t ) ( v * ( float ) 0xffffffff );
-            }
-            break;
+void aud_source_end_output ( void ) {
+    std_mutex_lock ( &aud_source_state.sources_mutex );
+    std_assert_m ( aud_source_state.is_output_active );
 
-            default:
-                std_not_implemented_m();
-        }
-    }
+    // What the device thread didn't get to
+    aud_source_apply_commands();
+    aud_source_collect_retired();
+    aud_source_state.is_output_active = false;
 
-    aud_device_push_buffer ( device_handle, device_info.bits_per_sample / 8 * sample_count );
+    std_mutex_unlock ( &aud_source_state.sources_mutex );
 }
@@ -1,17 +1,31 @@
+#pragma once
+
 #include <aud.h>
 
 #include <std_allocator.h>
 
+// The fields up to size are owned by the caller threads, the rest by whoever mixes, which is the device thread while
+// a device is active. The two sides only talk through the command queue.
 typedef struct {
     aud_source_params_t params;
     std_stack_t stack;
     //std_virtual_buffer_t buffer;
+    // Streamed sources keep their data in a ring of this many frames, it's zero for the others
+    uint64_t ring_frames;
+    // UINT64_MAX if the source isn't streamed
+    uint64_t stream;
+    // Bytes fed so far that can be mixed, trails the stack top until the feed command gets through. Keeps counting
+    // past the ring size for streamed sources.
+    uint64_t size;
     uint64_t active_idx;
-    double time_played; // seconds
+    // Play position in source frames, plus a 32 bit fraction for when the source is resampled
+    uint64_t position;
+    uint32_t phase;
     float volume;
 } aud_source_t;
 
 void aud_source_init ( void );
+void aud_source_deinit ( void );
 
 aud_source_h aud_source_create ( const aud_source_params_t* params );
 void aud_source_feed ( aud_source_h source, const void* data, uint64_t size );
@@ -23,6 +37,23 @@ void aud_source_set_volume_scale ( aud_source_h source, float scale );
 
 bool aud_source_get_info ( aud_source_info_t* info, aud_source_h source );
 
-void aud_source_output_to_device ( aud_device_h device, uint64_t ms );
-
-
+// Used by aud_stream. Streamed sources are written to directly through their ring, each publish makes everything up
+// to size bytes visible to the mixer. Destroying a streamed source goes through aud_stream, which releases it once
+// it's done with it.
+aud_source_h aud_source_create_stream ( const aud_source_params_t* params, uint64_t ring_frames, uint64_t stream );
+void* aud_source_get_ring ( aud_source_h source );
+void aud_source_publish ( aud_source_h source, uint64_t size );
+uint64_t aud_source_get_position ( aud_source_h source );
+uint64_t aud_source_get_stream ( aud_source_h source );
+void aud_source_release ( aud_source_h source );
+
+void aud_source_mix ( void* dest, const aud_device_params_t* format, size_t frame_count, const aud_source_h* sources, size_t count );
+
+// Hands the sources over to a device thread, and back. Called from the activating thread, before the device thread
+// starts and after it's joined.
+void aud_source_begin_output ( const aud_device_params_t* format );
+void aud_source_end_output ( void );
+
+// Called from the device thread only. Applies the pending commands and mixes the playing sources into dest.
+// Doesn't lock or allocate.
+void aud_source_render ( void* dest, const aud_device_params_t* format, uint64_t frame_count );
@@ -0,0 +1,530 @@
+#include "aud_stream.h"
+
+#include "aud_source.h"
+
+#include <fs.h>
+
+#include <std_list.h>
+#include <std_mutex.h>
+#include <std_allocator.h>
+#include <std_thread.h>
+#include <std_time.h>
+#include <std_log.h>
+#include <std_byte.h>
+
+/*
+    https://wiki.multimedia.cx/index.php/IMA_ADPCM
+    http://soundfile.sapp.org/doc/WaveFormat/
+
+    A single worker thread serves all streams. Every few milliseconds it keeps two reads in flight per stream on an fs
+    io queue, and decodes the completed ones, in file order, into the ring of the stream source for as long as the ring
+    has room. The ring is only allowed to get as far ahead of the mixer as its size, minus the few frames behind the
+    play position that the resampler still reads.
+*/
+
+typedef enum {
+    aud_stream_codec_pcm_m,
+    aud_stream_codec_ima_adpcm_m,
+} aud_stream_codec_e;
+
+typedef enum {
+    aud_stream_slot_empty_m,
+    aud_stream_slot_reading_m,
+    aud_stream_slot_ready_m,
+} aud_stream_slot_state_e;
+
+typedef struct {
+    aud_stream_slot_state_e state;
+    char* data;
+    // Bytes requested, then bytes read
+    uint64_t size;
+} aud_stream_slot_t;
+
+typedef struct {
+    fs_file_h file;
+    aud_source_h source;
+    aud_stream_codec_e codec;
+    bool loop;
+    bool is_destroyed;
+
+    // Bytes per codec block, and source frames each decodes to. A PCM block is a single frame
+    uint64_t block_size;
+    uint64_t block_frames;
+    uint64_t frame_size;
+    // Bytes read at a time, a whole number of blocks
+    uint64_t read_size;
+
+    uint64_t data_begin;
+    uint64_t data_end;
+    uint64_t read_offset;
+
+    aud_stream_slot_t slots[aud_stream_read_slots_m];
+    uint32_t read_slot;
+    uint32_t decode_slot;
+    uint32_t pending_reads;
+    char* read_buffer;
+
+    uint64_t decoded_frames;
+    std_tick_t decode_ticks;
+    uint64_t starved_count;
+    bool is_starved;
+} aud_stream_t;
+
+typedef struct {
+    aud_stream_t* streams_array;
+    aud_stream_t* streams_freelist;
+    uint64_t streams_bitset[std_bitset_u64_count_m ( aud_stream_max_streams_m )];
+    std_mutex_t streams_mutex;
+
+    // Both created with the first stream
+    fs_io_queue_h io_queue;
+    std_thread_h thread;
+    bool stop;
+} aud_stream_state_t;
+
+static aud_stream_state_t aud_stream_state;
+
+void aud_stream_init ( void ) {
+    static aud_stream_t streams_array[aud_stream_max_streams_m];
+
+    aud_stream_state.streams_array = streams_array;
+    aud_stream_state.streams_freelist = std_static_freelist_m ( streams_array );
+    std_mem_zero_m ( &aud_stream_state.streams_bitset );
+    std_mutex_init ( &aud_stream_state.streams_mutex );
+
+    aud_stream_state.io_queue = fs_null_handle_m;
+    aud_stream_state.thread = std_thread_null_handle_m;
+    aud_stream_state.stop = false;
+}
+
+// --
+
+static const int16_t aud_stream_ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107,
+    118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894,
+    6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t aud_stream_ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+// Mono block: a 4 byte header with the first sample and the starting step index, then two samples per byte, low
+// nibble first. A block cut short by the end of the file decodes to fewer samples.
+static uint64_t aud_stream_decode_ima_block ( int16_t* dest, const uint8_t* block, uint64_t size ) {
+    if ( size < 4 ) {
+        return 0;
+    }
+
+    int32_t predictor = ( int16_t ) ( block[0] | block[1] << 8 );
+    int32_t index = std_min_i32 ( block[2], 88 );
+    dest[0] = ( int16_t ) predictor;
+    uint64_t count = 1;
+
+    for ( uint64_t i = 4; i < size; ++i ) {
+        for ( uint32_t shift = 0; shift < 8; shift += 4 ) {
+            uint32_t nibble = ( block[i] >> shift ) & 0xf;
+            int32_t step = aud_stream_ima_step_table[index];
+            int32_t diff = step >> 3;
+
+            if ( nibble & 4 ) {
+                diff += step;
+            }
+
+            if ( nibble & 2 ) {
+                diff += step >> 1;
+            }
+
+            if ( nibble & 1 ) {
+                diff += step >> 2;
+            }
+
+            predictor += nibble & 8 ? -diff : diff;
+            predictor = std_min_i32 ( std_max_i32 ( predictor, -32768 ), 32767 );
+            index = std_min_i32 ( std_max_i32 ( index + aud_stream_ima_index_table[nibble], 0 ), 88 );
+            dest[count++] = ( int16_t ) predictor;
+        }
+    }
+
+    return count;
+}
+
+static uint64_t aud_stream_block_frames ( const aud_stream_t* stream, uint64_t size ) {
+    if ( stream->codec == aud_stream_codec_pcm_m ) {
+        return size / stream->frame_size;
+    }
+
+    uint64_t full_blocks = size / stream->block_size;
+    uint64_t rest = size % stream->block_size;
+    return full_blocks * stream->block_frames + ( rest >= 4 ? 1 + ( rest - 4 ) * 2 : 0 );
+}
+
+static void aud_stream_write_ring ( aud_stream_t* stream, const void* data, uint64_t frame_count ) {
+    char* ring = aud_source_get_ring ( stream->source );
+    uint64_t ring_begin = stream->decoded_frames % aud_stream_ring_frames_m;
+    uint64_t head = std_min_u64 ( frame_count, aud_stream_ring_frames_m - ring_begin );
+    std_mem_copy ( ring + ring_begin * stream->frame_size, data, head * stream->frame_size );
+    std_mem_copy ( ring, ( const char* ) data + head * stream->frame_size, ( frame_count - head ) * stream->frame_size );
+    stream->decoded_frames += frame_count;
+}
+
+static void aud_stream_decode ( aud_stream_t* stream, const char* data, uint64_t size ) {
+    std_tick_t start = std_tick_now();
+
+    if ( stream->codec == aud_stream_codec_pcm_m ) {
+        aud_stream_write_ring ( stream, data, size / stream->frame_size );
+    } else {
+        int16_t frames[aud_stream_read_size_m * 2];
+
+        for ( uint64_t offset = 0; offset < size; offset += stream->block_size ) {
+            uint64_t block_size = std_min_u64 ( stream->block_size, size - offset );
+            uint64_t frame_count = aud_stream_decode_ima_block ( frames, ( const uint8_t* ) data + offset, block_size );
+            aud_stream_write_ring ( stream, frames, frame_count );
+        }
+    }
+
+    stream->decode_ticks += std_tick_now() - start;
+    aud_source_publish ( stream->source, stream->decoded_frames * stream->frame_size );
+}
+
+// --
+
+static uint16_t aud_stream_read_u16 ( const uint8_t* data ) {
+    return ( uint16_t ) ( data[0] | data[1] << 8 );
+}
+
+static uint32_t aud_stream_read_u32 ( const uint8_t* data ) {
+    return ( uint32_t ) data[0] | ( uint32_t ) data[1] << 8 | ( uint32_t ) data[2] << 16 | ( uint32_t ) data[3] << 24;
+}
+
+// Walks the RIFF chunks for the format and the data
+static bool aud_stream_open_wav ( aud_stream_t* stream, aud_source_params_t* source_params, const char* path ) {
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    uint8_t header[12];
+
+    if ( fs->read_file_at ( header, 12, stream->file, 0 ) != 12 || !std_mem_cmp ( header, "RIFF", 4 ) || !std_mem_cmp ( header + 8, "WAVE", 4 ) ) {
+        std_log_warn_m ( std_fmt_str_m " is not a WAV file", path );
+        return false;
+    }
+
+    bool has_format = false;
+    bool has_data = false;
+    uint64_t offset = 12;
+
+    while ( !has_data ) {
+        uint8_t chunk[8];
+
+        if ( fs->read_file_at ( chunk, 8, stream->file, offset ) != 8 ) {
+            break;
+        }
+
+        uint64_t chunk_size = aud_stream_read_u32 ( chunk + 4 );
+
+        if ( std_mem_cmp ( chunk, "fmt ", 4 ) ) {
+            uint8_t format[20] = {0};
+            uint64_t format_size = std_min_u64 ( chunk_size, sizeof ( format ) );
+
+            if ( format_size < 16 || fs->read_file_at ( format, format_size, stream->file, offset + 8 ) != format_size ) {
+                break;
+            }
+
+            uint16_t format_tag = aud_stream_read_u16 ( format );
+            uint16_t channels = aud_stream_read_u16 ( format + 2 );
+            uint32_t sample_frequency = aud_stream_read_u32 ( format + 4 );
+            uint16_t block_align = aud_stream_read_u16 ( format + 12 );
+            uint16_t bits_per_sample = aud_stream_read_u16 ( format + 14 );
+
+            if ( channels != 1 ) {
+                std_log_warn_m ( std_fmt_str_m " has " std_fmt_u32_m " channels, streamed sources are mono", path, ( uint32_t ) channels );
+                return false;
+            }
+
+            source_params->sample_frequency = sample_frequency;
+
+            if ( format_tag == 1 && ( bits_per_sample == 8 || bits_per_sample == 16 || bits_per_sample == 24 || bits_per_sample == 32 ) ) {
+                stream->codec = aud_stream_codec_pcm_m;
+                stream->frame_size = bits_per_sample / 8;
+                stream->block_size = stream->frame_size;
+                stream->block_frames = 1;
+                source_params->bits_per_sample = bits_per_sample;
+            } else if ( format_tag == 0x11 && bits_per_sample == 4 && block_align > 4 && block_align <= aud_stream_read_size_m ) {
+                stream->codec = aud_stream_codec_ima_adpcm_m;
+                stream->frame_size = 2;
+                stream->block_size = block_align;
+                stream->block_frames = 1 + ( block_align - 4 ) * 2;
+                source_params->bits_per_sample = 16;
+            } else {
+                std_log_warn_m ( std_fmt_str_m " has an unsupported format " std_fmt_u32_m ", " std_fmt_u32_m " bits", path, ( uint32_t ) format_tag, ( uint32_t ) bits_per_sample );
+                return false;
+            }
+
+            has_format = true;
+        } else if ( std_mem_cmp ( chunk, "data", 4 ) ) {
+            stream->data_begin = offset + 8;
+            stream->data_end = offset + 8 + chunk_size;
+            has_data = true;
+        }
+
+        // Chunks are padded to an even size
+        offset += 8 + chunk_size + ( chunk_size & 1 );
+    }
+
+    if ( !has_format || !has_data ) {
+        std_log_warn_m ( std_fmt_str_m " is missing its format or data", path );
+        return false;
+    }
+
+    stream->read_size = ( aud_stream_read_size_m / stream->block_size ) * stream->block_size;
+    return true;
+}
+
+// --
+
+static bool aud_stream_has_ring_room ( const aud_stream_t* stream, uint64_t frame_count ) {
+    // The resampler reads a few frames behind the play position, those can't be overwritten yet
+    uint64_t position = aud_source_get_position ( stream->source );
+    uint64_t oldest_needed = position > aud_mixer_filter_taps_m ? position - aud_mixer_filter_taps_m : 0;
+    return stream->decoded_frames + frame_count <= oldest_needed + aud_stream_ring_frames_m;
+}
+
+// Next read in file order, wrapping back to the start of the data when looping. Returns false once there's nothing
+// left to read.
+static bool aud_stream_next_read ( aud_stream_t* stream, uint64_t* offset, uint64_t* size ) {
+    if ( stream->read_offset == stream->data_end && stream->loop ) {
+        stream->read_offset = stream->data_begin;
+    }
+
+    if ( stream->read_offset == stream->data_end ) {
+        return false;
+    }
+
+    *offset = stream->read_offset;
+    *size = std_min_u64 ( stream->read_size, stream->data_end - stream->read_offset );
+    stream->read_offset += *size;
+    return true;
+}
+
+static void aud_stream_update ( aud_stream_t* stream, uint64_t stream_idx ) {
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    // Decode what's been read, in order, as far as the ring allows
+    for ( ;; ) {
+        aud_stream_slot_t* slot = &stream->slots[stream->decode_slot];
+
+        if ( slot->state != aud_stream_slot_ready_m || !aud_stream_has_ring_room ( stream, aud_stream_block_frames ( stream, slot->size ) ) ) {
+            break;
+        }
+
+        aud_stream_decode ( stream, slot->data, slot->size );
+        slot->state = aud_stream_slot_empty_m;
+        stream->decode_slot = ( stream->decode_slot + 1 ) % aud_stream_read_slots_m;
+    }
+
+    // Keep the reads going
+    for ( ;; ) {
+        aud_stream_slot_t* slot = &stream->slots[stream->read_slot];
+        uint64_t offset;
+        uint64_t size;
+
+        if ( slot->state != aud_stream_slot_empty_m || !aud_stream_next_read ( stream, &offset, &size ) ) {
+            break;
+        }
+
+        void* user_data = ( void* ) ( uintptr_t ) ( stream_idx * aud_stream_read_slots_m + stream->read_slot );
+        fs_io_request_h request = fs->submit_read ( aud_stream_state.io_queue, stream->file, offset, size, slot->data, user_data );
+
+        if ( request == fs_io_null_request_m ) {
+            stream->read_offset = offset;
+            break;
+        }
+
+        slot->state = aud_stream_slot_reading_m;
+        slot->size = size;
+        stream->read_slot = ( stream->read_slot + 1 ) % aud_stream_read_slots_m;
+        ++stream->pending_reads;
+    }
+
+    // Caught up with by the mixer while there's still more to decode
+    bool is_finished = stream->read_offset == stream->data_end && !stream->loop && stream->slots[stream->decode_slot].state == aud_stream_slot_empty_m;
+    bool is_starved = !is_finished && aud_source_get_position ( stream->source ) > stream->decoded_frames;
+    stream->starved_count += is_starved && !stream->is_starved ? 1 : 0;
+    stream->is_starved = is_starved;
+}
+
+static void aud_stream_close ( aud_stream_t* stream, uint64_t stream_idx ) {
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    fs->close_file ( stream->file );
+    std_virtual_heap_free ( stream->read_buffer );
+    aud_source_release ( stream->source );
+
+    std_bitset_clear ( aud_stream_state.streams_bitset, stream_idx );
+    std_list_push ( &aud_stream_state.streams_freelist, stream );
+}
+
+static void aud_stream_thread_routine ( void* arg ) {
+    std_unused_m ( arg );
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    while ( !aud_stream_state.stop ) {
+        fs_io_completion_t completions[aud_stream_max_streams_m * aud_stream_read_slots_m];
+
+        std_mutex_lock ( &aud_stream_state.streams_mutex );
+
+        size_t completion_count = fs->poll_io_queue ( aud_stream_state.io_queue, completions, std_static_array_capacity_m ( completions ) );
+
+        for ( size_t i = 0; i < completion_count; ++i ) {
+            uint64_t slot_idx = ( uint64_t ) ( uintptr_t ) completions[i].user_data;
+            aud_stream_t* stream = &aud_stream_state.streams_array[slot_idx / aud_stream_read_slots_m];
+            aud_stream_slot_t* slot = &stream->slots[slot_idx % aud_stream_read_slots_m];
+            // A failed read is dropped, the stream goes on with what comes after it
+            slot->size = completions[i].read_size == fs_read_error_m ? 0 : completions[i].read_size;
+            slot->state = aud_stream_slot_ready_m;
+            --stream->pending_reads;
+        }
+
+        uint64_t stream_idx = 0;
+
+        while ( std_bitset_scan ( &stream_idx, aud_stream_state.streams_bitset, stream_idx, std_static_array_capacity_m ( aud_stream_state.streams_bitset ) ) ) {
+            aud_stream_t* stream = &aud_stream_state.streams_array[stream_idx];
+
+            if ( !stream->is_destroyed ) {
+                aud_stream_update ( stream, stream_idx );
+            } else if ( stream->pending_reads == 0 ) {
+                aud_stream_close ( stream, stream_idx );
+            }
+
+            ++stream_idx;
+        }
+
+        std_mutex_unlock ( &aud_stream_state.streams_mutex );
+
+        std_thread_this_sleep ( aud_stream_update_ms_m );
+    }
+}
+
+// --
+
+aud_source_h aud_stream_create ( const aud_stream_params_t* params ) {
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    fs_file_h file = fs->open_file ( params->path, fs_file_read_m );
+
+    if ( file == fs_null_handle_m ) {
+        std_log_warn_m ( "Can't open " std_fmt_str_m, params->path );
+        return aud_null_handle_m;
+    }
+
+    std_mutex_lock ( &aud_stream_state.streams_mutex );
+
+    aud_stream_t* stream = std_list_pop_m ( &aud_stream_state.streams_freelist );
+
+    if ( stream == NULL ) {
+        std_mutex_unlock ( &aud_stream_state.streams_mutex );
+        std_log_warn_m ( "Out of streams" );
+        fs->close_file ( file );
+        return aud_null_handle_m;
+    }
+
+    std_mem_zero_m ( stream );
+    stream->file = file;
+    stream->loop = params->loop;
+
+    aud_source_params_t source_params;
+    source_params.capacity_ms = 0;
+
+    if ( !aud_stream_open_wav ( stream, &source_params, params->path ) ) {
+        std_list_push ( &aud_stream_state.streams_freelist, stream );
+        std_mutex_unlock ( &aud_stream_state.streams_mutex );
+        fs->close_file ( file );
+        return aud_null_handle_m;
+    }
+
+    uint64_t stream_idx = ( uint64_t ) ( stream - aud_stream_state.streams_array );
+    stream->source = aud_source_create_stream ( &source_params, aud_stream_ring_frames_m, stream_idx );
+    stream->read_offset = stream->data_begin;
+    stream->read_buffer = std_virtual_heap_alloc_m ( stream->read_size * aud_stream_read_slots_m, 16 );
+
+    for ( uint32_t i = 0; i < aud_stream_read_slots_m; ++i ) {
+        stream->slots[i].data = stream->read_buffer + i * stream->read_size;
+    }
+
+    // The first reads happen right away, so it can start playing without waiting on the worker
+    for ( uint32_t i = 0; i < aud_stream_read_slots_m; ++i ) {
+        uint64_t offset;
+        uint64_t size;
+
+        if ( !aud_stream_next_read ( stream, &offset, &size ) ) {
+            break;
+        }
+
+        uint64_t read_size = fs->read_file_at ( stream->read_buffer, size, file, offset );
+
+        if ( read_size != fs_read_error_m ) {
+            aud_stream_decode ( stream, stream->read_buffer, read_size );
+        }
+    }
+
+    if ( aud_stream_state.thread == std_thread_null_handle_m ) {
+        uint32_t capacity = aud_stream_max_streams_m * aud_stream_read_slots_m;
+        aud_stream_state.io_queue = fs->create_io_queue ( &fs_io_queue_params_m ( .capacity = capacity, .thread_count = 2 ) );
+        aud_stream_state.stop = false;
+        aud_stream_state.thread = std_thread ( aud_stream_thread_routine, NULL, "aud_stream", std_thread_core_mask_any_m );
+    }
+
+    std_bitset_set ( aud_stream_state.streams_bitset, stream_idx );
+
+    std_mutex_unlock ( &aud_stream_state.streams_mutex );
+
+    return stream->source;
+}
+
+void aud_stream_destroy ( uint64_t stream_idx ) {
+    std_mutex_lock ( &aud_stream_state.streams_mutex );
+    aud_stream_state.streams_array[stream_idx].is_destroyed = true;
+    std_mutex_unlock ( &aud_stream_state.streams_mutex );
+}
+
+bool aud_stream_get_info ( aud_stream_info_t* info, aud_source_h source ) {
+    uint64_t stream_idx = aud_source_get_stream ( source );
+
+    if ( stream_idx == UINT64_MAX ) {
+        return false;
+    }
+
+    std_mutex_lock ( &aud_stream_state.streams_mutex );
+
+    aud_stream_t* stream = &aud_stream_state.streams_array[stream_idx];
+    info->decoded_frames = stream->decoded_frames;
+    info->decode_ms = std_tick_to_milli_f64 ( stream->decode_ticks );
+    info->starved_count = stream->starved_count;
+    info->memory_size = aud_stream_ring_frames_m * stream->frame_size + stream->read_size * aud_stream_read_slots_m;
+
+    std_mutex_unlock ( &aud_stream_state.streams_mutex );
+
+    return true;
+}
+
+void aud_stream_deinit ( void ) {
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    if ( aud_stream_state.thread != std_thread_null_handle_m ) {
+        aud_stream_state.stop = true;
+        std_thread_join ( aud_stream_state.thread );
+        // Waits for the reads still in flight
+        fs->destroy_io_queue ( aud_stream_state.io_queue );
+    }
+
+    uint64_t stream_idx = 0;
+
+    while ( std_bitset_scan ( &stream_idx, aud_stream_state.streams_bitset, stream_idx, std_static_array_capacity_m ( aud_stream_state.streams_bitset ) ) ) {
+        aud_stream_close ( &aud_stream_state.streams_array[stream_idx], stream_idx );
+        ++stream_idx;
+    }
+
+    std_mutex_deinit ( &aud_stream_state.streams_mutex );
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <aud.h>
+
+void aud_stream_init ( void );
+void aud_stream_deinit ( void );
+
+aud_source_h aud_stream_create ( const aud_stream_params_t* params );
+// Takes the stream index, not the source. The source is released once the worker thread is done with it.
+void aud_stream_destroy ( uint64_t stream );
+bool aud_stream_get_info ( aud_stream_info_t* info, aud_source_h source );
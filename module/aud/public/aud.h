@@ -9,6 +9,7 @@ std_module_export_m void aud_unload ( void );
 
 typedef uint64_t aud_device_h;
 typedef uint64_t aud_source_h;
+#define aud_null_handle_m UINT64_MAX
 
 typedef struct {
     size_t channels;
@@ -16,6 +17,7 @@ typedef struct {
     size_t bits_per_sample;
 } aud_device_params_t;
 
+// Sources are mono. 8 bit samples are unsigned, 16, 24 and 32 bit samples are signed, 24 bit ones are packed in 3 bytes.
 typedef struct {
     uint64_t capacity_ms;
     uint64_t sample_frequency;
@@ -29,6 +31,8 @@ typedef struct {
     size_t channels;
     size_t sample_frequency;
     size_t bits_per_sample;
+    // Times the device ran out of mixed audio since activation
+    uint64_t underrun_count;
 
     char name[aud_device_name_size_m];
 } aud_device_info_t;
@@ -39,19 +43,36 @@ typedef struct {
     double time_played;
 } aud_source_info_t;
 
+// Streamed sources read and decode a file on a worker thread, staying a short way ahead of the mixer, so their
+// memory doesn't depend on the length of the file. Supported files are mono WAV, either PCM or IMA ADPCM.
+typedef struct {
+    const char* path;
+    // Restarts from the beginning once the end of the file is decoded
+    bool loop;
+} aud_stream_params_t;
+
+typedef struct {
+    uint64_t decoded_frames;
+    // Time the worker thread spent decoding this stream
+    double decode_ms;
+    // Times the mixer caught up with the decoder and played silence
+    uint64_t starved_count;
+    // Bytes allocated for the stream, decoded ring and read buffers
+    uint64_t memory_size;
+} aud_stream_info_t;
+
 typedef struct {
     size_t ( *get_devices_count ) ( void );
     size_t ( *get_devices ) ( aud_device_h* devices, size_t cap );
     bool ( *get_device_info ) ( aud_device_info_t* info, aud_device_h device );
 
-    const std_ring_t* ( *get_device_ring ) ( aud_device_h device );
-    void ( *update_device_ring ) ( aud_device_h device );
-
+    // An active device is fed by its own thread, which mixes whatever sources are playing. Only one device can be
+    // active at a time.
     bool ( *activate_device ) ( aud_device_h device, const aud_device_params_t* params );
     bool  ( *deactivate_device ) ( aud_device_h deivce );
 
-    void ( *play ) ( aud_device_h device, void* data, size_t size );
-
+    // Source calls are queued up for the device thread and take effect on the next period it mixes. They can be
+    // called from any thread.
     aud_source_h ( *create_source ) ( const aud_source_params_t* params );
     void ( *feed_source ) ( aud_source_h source, const void* data, uint64_t size );
     void ( *play_source ) ( aud_source_h source );
@@ -61,6 +82,12 @@ typedef struct {
     bool ( *get_source_info ) ( aud_source_info_t* info, aud_source_h source );
     void ( *set_source_volume ) ( aud_source_h source, float volume_scale );
 
-    // samples, mixes and submits audio data to the device for playback
-    void ( *output_to_device ) ( aud_device_h device, uint64_t milliseconds );
+    // Returns aud_null_handle_m if the file can't be opened or isn't supported. Everything above works on the returned
+    // source, except feed_source.
+    aud_source_h ( *create_stream_source ) ( const aud_stream_params_t* params );
+    bool ( *get_stream_info ) ( aud_stream_info_t* info, aud_source_h source );
+
+    // Mixes the sources into dest in the given format without going through a device, e.g. to render offline. The
+    // sources are advanced as if they played for that long, whether they're playing or not. Not while a device is active.
+    void ( *mix_sources ) ( void* dest, const aud_device_params_t* format, size_t frame_count, const aud_source_h* sources, size_t count );
 } aud_i;
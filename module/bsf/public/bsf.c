@@ -0,0 +1,248 @@
+#include "bsf.h"
+
+#include <std_log.h>
+#include <std_byte.h>
+
+bool bsf_file_open ( bsf_file_t* bsf, const char* path ) {
+    bsf->file = std_file_null_handle_m;
+    bsf->base = NULL;
+
+    std_file_h file = std_file_open ( path, std_file_read_m );
+
+    if ( file == std_file_null_handle_m ) {
+        return false;
+    }
+
+    std_file_info_t info;
+
+    if ( !std_file_info ( &info, file ) || info.size < sizeof ( bsf_header_t ) ) {
+        std_log_warn_m ( "BSF file " std_fmt_str_m " is too small", path );
+        std_file_close ( file );
+        return false;
+    }
+
+    const void* base = std_file_map ( file, info.size, std_file_map_read_m );
+
+    if ( base == NULL ) {
+        std_log_warn_m ( "Failed to map BSF file " std_fmt_str_m, path );
+        std_file_close ( file );
+        return false;
+    }
+
+    bsf->file = file;
+    bsf->base = base;
+    bsf->size = info.size;
+    bsf->header = ( const bsf_header_t* ) base;
+    bsf->table = ( const bsf_table_entry_t* ) ( bsf->header + 1 );
+
+    const bsf_header_t* header = bsf->header;
+    bool valid = header->magic == bsf_magic_m && header->version == bsf_version_m && header->total_size <= info.size;
+    valid = valid && sizeof ( bsf_header_t ) + sizeof ( bsf_table_entry_t ) * ( uint64_t ) header->chunk_count <= header->total_size;
+
+    for ( uint32_t i = 0; valid && i < header->chunk_count; ++i ) {
+        uint64_t offset = bsf->table[i].offset;
+        valid = offset < header->total_size && offset % bsf_chunk_align_m == 0;
+    }
+
+    if ( !valid ) {
+        std_log_warn_m ( "BSF file " std_fmt_str_m " is invalid or was baked with a different version", path );
+        bsf_file_close ( bsf );
+        return false;
+    }
+
+    return true;
+}
+
+void bsf_file_close ( bsf_file_t* bsf ) {
+    if ( bsf->base ) {
+        std_file_unmap ( bsf->file, ( void* ) bsf->base );
+    }
+
+    if ( bsf->file != std_file_null_handle_m ) {
+        std_file_close ( bsf->file );
+    }
+
+    bsf->file = std_file_null_handle_m;
+    bsf->base = NULL;
+}
+
+uint32_t bsf_vertex_size ( uint32_t vertex_layout ) {
+    switch ( vertex_layout ) {
+    case bsf_vertex_layout_f32_m:
+        return sizeof ( float ) * ( 3 + 3 + 3 + 3 + 2 );
+    case bsf_vertex_layout_packed_m:
+        return sizeof ( int16_t ) * ( 4 + 2 + 2 ) + sizeof ( uint16_t ) * 2;
+    default:
+        return 0;
+    }
+}
+
+uint64_t bsf_mesh_chunk_size ( uint32_t vertex_layout, uint32_t vertex_count, uint32_t lod_index_count ) {
+    return sizeof ( bsf_mesh_header_t ) + bsf_vertex_size ( vertex_layout ) * ( uint64_t ) vertex_count + sizeof ( uint32_t ) * ( uint64_t ) lod_index_count;
+}
+
+bool bsf_mesh_view ( bsf_mesh_view_t* view, const bsf_file_t* bsf, uint32_t chunk_idx ) {
+    const bsf_table_entry_t* entry = &bsf->table[chunk_idx];
+
+    if ( entry->type != bsf_chunk_mesh_m || entry->offset + sizeof ( bsf_mesh_header_t ) > bsf->header->total_size ) {
+        return false;
+    }
+
+    const bsf_mesh_header_t* header = ( const bsf_mesh_header_t* ) ( ( const char* ) bsf->base + entry->offset );
+
+    if ( bsf_vertex_size ( header->vertex_layout ) == 0 || header->lod_count == 0 || header->lod_count > bsf_mesh_max_lods_m ) {
+        return false;
+    }
+
+    if ( entry->offset + bsf_mesh_chunk_size ( header->vertex_layout, header->vertex_count, header->lod_index_count ) > bsf->header->total_size ) {
+        return false;
+    }
+
+    for ( uint32_t i = 0; i < header->lod_count; ++i ) {
+        if ( ( uint64_t ) header->lods[i].index_offset + header->lods[i].index_count > header->lod_index_count ) {
+            return false;
+        }
+    }
+
+    uint64_t vertex_count = header->vertex_count;
+    std_mem_zero_m ( view );
+    view->header = header;
+
+    if ( header->vertex_layout == bsf_vertex_layout_f32_m ) {
+        view->pos = ( const float* ) ( header + 1 );
+        view->nor = view->pos + vertex_count * 3;
+        view->tan = view->nor + vertex_count * 3;
+        view->bitan = view->tan + vertex_count * 3;
+        view->uv = view->bitan + vertex_count * 3;
+        view->idx = ( const uint32_t* ) ( view->uv + vertex_count * 2 );
+    } else {
+        view->packed_pos = ( const int16_t* ) ( header + 1 );
+        view->packed_nor = view->packed_pos + vertex_count * 4;
+        view->packed_tan = view->packed_nor + vertex_count * 2;
+        view->packed_uv = ( const uint16_t* ) ( view->packed_tan + vertex_count * 2 );
+        view->idx = ( const uint32_t* ) ( view->packed_uv + vertex_count * 2 );
+    }
+
+    return true;
+}
+
+const bsf_material_t* bsf_material_view ( const bsf_file_t* bsf, uint32_t chunk_idx ) {
+    const bsf_table_entry_t* entry = &bsf->table[chunk_idx];
+
+    if ( entry->type != bsf_chunk_material_m || entry->offset + sizeof ( bsf_material_t ) > bsf->header->total_size ) {
+        return NULL;
+    }
+
+    return ( const bsf_material_t* ) ( ( const char* ) bsf->base + entry->offset );
+}
+
+uint64_t bsf_meshlets_chunk_size ( uint32_t meshlet_count, uint32_t vertex_index_count, uint32_t triangle_count ) {
+    uint64_t size = sizeof ( bsf_meshlets_header_t ) + sizeof ( bsf_meshlet_t ) * ( uint64_t ) meshlet_count;
+    size += sizeof ( uint32_t ) * ( uint64_t ) vertex_index_count;
+    size += ( ( uint64_t ) triangle_count * 3 + 3 ) & ~3ull;
+    return size;
+}
+
+bool bsf_meshlets_view ( bsf_meshlets_view_t* view, const bsf_file_t* bsf, uint32_t chunk_idx ) {
+    const bsf_table_entry_t* entry = &bsf->table[chunk_idx];
+
+    if ( entry->type != bsf_chunk_meshlets_m || entry->offset + sizeof ( bsf_meshlets_header_t ) > bsf->header->total_size ) {
+        return false;
+    }
+
+    const bsf_meshlets_header_t* header = ( const bsf_meshlets_header_t* ) ( ( const char* ) bsf->base + entry->offset );
+
+    if ( entry->offset + bsf_meshlets_chunk_size ( header->meshlet_count, header->vertex_index_count, header->triangle_count ) > bsf->header->total_size ) {
+        return false;
+    }
+
+    view->header = header;
+    view->meshlets = ( const bsf_meshlet_t* ) ( header + 1 );
+    view->vertices = ( const uint32_t* ) ( view->meshlets + header->meshlet_count );
+    view->triangles = ( const uint8_t* ) ( view->vertices + header->vertex_index_count );
+    return true;
+}
+
+const bsf_material_t* bsf_material_find ( const bsf_file_t* bsf, uint32_t material_id ) {
+    if ( material_id == bsf_null_id_m ) {
+        return NULL;
+    }
+
+    for ( uint32_t i = 0; i < bsf->header->chunk_count; ++i ) {
+        const bsf_material_t* material = bsf_material_view ( bsf, i );
+
+        if ( material && material->material_id == material_id ) {
+            return material;
+        }
+    }
+
+    return NULL;
+}
+
+uint32_t bsf_texture_block_size ( uint32_t format ) {
+    switch ( format ) {
+    case bsf_texture_format_bc1_m:
+    case bsf_texture_format_bc4_m:
+        return 8;
+    case bsf_texture_format_bc5_m:
+    case bsf_texture_format_bc7_m:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+uint64_t bsf_texture_mip_size ( uint32_t format, uint32_t width, uint32_t height, uint32_t mip ) {
+    uint64_t mip_width = std_max_u32 ( width >> mip, 1 );
+    uint64_t mip_height = std_max_u32 ( height >> mip, 1 );
+    return ( ( mip_width + 3 ) / 4 ) * ( ( mip_height + 3 ) / 4 ) * bsf_texture_block_size ( format );
+}
+
+uint64_t bsf_texture_chunk_size ( uint32_t format, uint32_t width, uint32_t height, uint32_t mip_count ) {
+    uint64_t size = sizeof ( bsf_texture_header_t );
+
+    for ( uint32_t i = 0; i < mip_count; ++i ) {
+        size += bsf_texture_mip_size ( format, width, height, i );
+    }
+
+    return size;
+}
+
+bool bsf_texture_view ( bsf_texture_view_t* view, const bsf_file_t* bsf, uint32_t chunk_idx ) {
+    const bsf_table_entry_t* entry = &bsf->table[chunk_idx];
+
+    if ( entry->type != bsf_chunk_texture_m || entry->offset + sizeof ( bsf_texture_header_t ) > bsf->header->total_size ) {
+        return false;
+    }
+
+    const bsf_texture_header_t* header = ( const bsf_texture_header_t* ) ( ( const char* ) bsf->base + entry->offset );
+
+    if ( bsf_texture_block_size ( header->format ) == 0 || header->width == 0 || header->height == 0 || header->mip_count == 0 || header->mip_count > bsf_texture_max_mips_m ) {
+        return false;
+    }
+
+    uint64_t size = bsf_texture_chunk_size ( header->format, header->width, header->height, header->mip_count );
+
+    if ( entry->offset + size > bsf->header->total_size ) {
+        return false;
+    }
+
+    view->header = header;
+    view->data = header + 1;
+    view->data_size = size - sizeof ( bsf_texture_header_t );
+    return true;
+}
+
+bool bsf_texture_find ( bsf_texture_view_t* view, const bsf_file_t* bsf, uint32_t texture_id ) {
+    if ( texture_id == bsf_null_id_m ) {
+        return false;
+    }
+
+    for ( uint32_t i = 0; i < bsf->header->chunk_count; ++i ) {
+        if ( bsf_texture_view ( view, bsf, i ) && view->header->texture_id == texture_id ) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,252 @@
+#pragma once
+
+#include <std_platform.h>
+#include <std_file.h>
+
+/*
+    BSF - baked scene format
+
+    Written by data_bake, read at runtime by mapping the file and handing out views that point straight into the
+    mapping.
+    Layout:
+        bsf_header_t
+        bsf_table_entry_t[chunk_count]
+        chunks, each aligned to bsf_chunk_align_m
+
+    Mesh chunk, bsf_vertex_layout_f32_m:
+        bsf_mesh_header_t
+        pos     float[vertex_count * 3]
+        nor     float[vertex_count * 3]
+        tan     float[vertex_count * 3]
+        bitan   float[vertex_count * 3]
+        uv      float[vertex_count * 2]
+        idx     uint32_t[lod_index_count]
+
+    Mesh chunk, bsf_vertex_layout_packed_m:
+        bsf_mesh_header_t
+        pos     int16_t[vertex_count * 4]       snorm. xyz: position, pos_offset + xyz * pos_scale. w: bitangent sign
+        nor     int16_t[vertex_count * 2]       snorm, octahedral encoded
+        tan     int16_t[vertex_count * 2]       snorm, octahedral encoded. bitangent = cross ( nor, tan ) * pos.w
+        uv      uint16_t[vertex_count * 2]      half float
+        idx     uint32_t[lod_index_count]
+        The position scale is uniform across axes, so the dequantization can be folded into the model transform
+        without skewing normals.
+
+    Mesh LODs:
+        All LODs share the mesh vertex streams, each one is a range of the idx stream. LOD 0 is the full mesh and always
+        covers the first index_count indices. The LOD error estimates the distance between the LOD surface and the full
+        mesh, in model units, and never decreases along the chain. A LOD can be used when error * scale / distance,
+        projected to the screen, is below the tolerated pixel error.
+
+    Material chunk:
+        bsf_material_t
+        Texture paths are relative to the folder containing the source asset, empty if missing. Texture ids reference
+        texture chunks, bsf_null_id_m if the texture wasn't baked. A material without any baked texture expects the bsf
+        to sit next to the source asset so that its textures can be loaded from the paths.
+
+    Texture chunk (optional):
+        bsf_texture_header_t
+        data        blocks of all mips, mip 0 first, each mip tightly packed in rows of 4x4 blocks
+        Mip i is max ( width >> i, 1 ) by max ( height >> i, 1 ) texels, partial blocks at the edges are padded by
+        repeating the edge texels. Material textures are baked as:
+            color       bc7, or bc1 when opaque. rgb: base color, a: metalness
+            normal      bc5. rg: tangent space xy, z is reconstructed
+            roughness   bc4
+
+    Meshlets chunk (optional, one per mesh):
+        bsf_meshlets_header_t
+        meshlets    bsf_meshlet_t[meshlet_count]
+        vertices    uint32_t[vertex_index_count]    indices into the mesh vertex streams
+        triangles   uint8_t[triangle_count * 3]     indices into the meshlet vertices, padded to 4 bytes
+        A meshlet is backfacing and can be culled when
+        dot ( normalize ( cone_apex - camera_pos ), cone_axis ) >= cone_cutoff.
+        Meshlets with a cone_cutoff of 1 have no usable cone.
+
+    Vertices and triangles of baked meshes are ordered for post transform cache reuse and fetch locality.
+*/
+
+#define bsf_encode_u32_m( c1, c2, c3, c4 ) ( \
+    ( ( unsigned char ) ( c1 ) << 24 ) | \
+    ( ( unsigned char ) ( c2 ) << 16 ) | \
+    ( ( unsigned char ) ( c3 ) <<  8 ) | \
+    ( ( unsigned char ) ( c4 ) ) \
+)
+
+#define bsf_magic_m bsf_encode_u32_m ( 'B', 'S', 'F', '1' )
+#define bsf_version_m 0x5
+
+#define bsf_chunk_align_m 16
+#define bsf_name_size_m 64
+#define bsf_texture_path_size_m 256
+#define bsf_null_id_m UINT32_MAX
+#define bsf_meshlet_max_vertices_m 64
+#define bsf_meshlet_max_triangles_m 124
+#define bsf_mesh_max_lods_m 8
+#define bsf_texture_max_mips_m 16
+
+typedef enum {
+    bsf_chunk_mesh_m        = 0x0001,
+    bsf_chunk_material_m    = 0x0002,
+    bsf_chunk_hierarchy_m   = 0x0004,
+    bsf_chunk_meshlets_m    = 0x0008,
+    bsf_chunk_texture_m     = 0x0010,
+} bsf_chunk_type_e;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t chunk_count;
+    uint32_t reserved;
+    uint64_t total_size;
+} bsf_header_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t type; // bsf_chunk_type_e
+    uint64_t offset;
+} bsf_table_entry_t;
+
+typedef enum {
+    bsf_vertex_layout_f32_m     = 0,
+    bsf_vertex_layout_packed_m  = 1,
+} bsf_vertex_layout_e;
+
+typedef struct {
+    uint32_t index_offset;
+    uint32_t index_count;
+    float error;
+    uint32_t reserved;
+} bsf_mesh_lod_t;
+
+typedef struct {
+    uint32_t mesh_id;
+    uint32_t material_id; // bsf_null_id_m if none
+    uint32_t vertex_count;
+    uint32_t index_count; // LOD 0
+    uint32_t vertex_layout; // bsf_vertex_layout_e
+    uint32_t lod_count; // at least 1
+    uint32_t lod_index_count; // all LODs
+    uint32_t reserved;
+    float pos_offset[3];  // packed layout dequantization, 0 for f32
+    float pos_scale;      // packed layout dequantization, 1 for f32
+    float bounds_center[3];
+    float bounds_radius;
+    bsf_mesh_lod_t lods[bsf_mesh_max_lods_m];
+    char name[bsf_name_size_m];
+} bsf_mesh_header_t;
+
+typedef enum {
+    bsf_material_has_base_color_m   = 1 << 0,
+    bsf_material_has_roughness_m    = 1 << 1,
+    bsf_material_has_metalness_m    = 1 << 2,
+} bsf_material_flags_t;
+
+typedef struct {
+    uint32_t material_id;
+    uint32_t flags; // bsf_material_flags_t
+    float base_color[3];
+    float roughness;
+    float metalness;
+    uint32_t color_texture_id; // bsf_null_id_m if not baked
+    uint32_t normal_texture_id;
+    uint32_t roughness_texture_id;
+    char color_texture[bsf_texture_path_size_m];
+    char normal_texture[bsf_texture_path_size_m];
+    char metalness_roughness_texture[bsf_texture_path_size_m];
+} bsf_material_t;
+
+typedef enum {
+    bsf_texture_format_bc1_m = 0, // rgb, 8 bytes per block
+    bsf_texture_format_bc4_m = 1, // r, 8 bytes per block
+    bsf_texture_format_bc5_m = 2, // rg, 16 bytes per block
+    bsf_texture_format_bc7_m = 3, // rgba, 16 bytes per block
+} bsf_texture_format_e;
+
+typedef struct {
+    uint32_t texture_id;
+    uint32_t format; // bsf_texture_format_e
+    uint32_t width;
+    uint32_t height;
+    uint32_t mip_count;
+    uint32_t reserved[3];
+    char name[bsf_texture_path_size_m]; // source texture path, same as the material one
+} bsf_texture_header_t;
+
+typedef struct {
+    uint32_t mesh_id;
+    uint32_t meshlet_count;
+    uint32_t vertex_index_count;
+    uint32_t triangle_count;
+} bsf_meshlets_header_t;
+
+typedef struct {
+    uint32_t vertex_offset;
+    uint32_t triangle_offset;
+    uint32_t vertex_count;
+    uint32_t triangle_count;
+    float center[3];
+    float radius;
+    float cone_apex[3];
+    float cone_cutoff;
+    float cone_axis[3];
+    uint32_t reserved;
+} bsf_meshlet_t;
+
+// Reader
+typedef struct {
+    std_file_h file;
+    const void* base;
+    uint64_t size;
+    const bsf_header_t* header;
+    const bsf_table_entry_t* table;
+} bsf_file_t;
+
+// Only the streams of the mesh vertex layout are set, the others are left null
+typedef struct {
+    const bsf_mesh_header_t* header;
+    const float* pos;
+    const float* nor;
+    const float* tan;
+    const float* bitan;
+    const float* uv;
+    const int16_t* packed_pos;
+    const int16_t* packed_nor;
+    const int16_t* packed_tan;
+    const uint16_t* packed_uv;
+    const uint32_t* idx;
+} bsf_mesh_view_t;
+
+typedef struct {
+    const bsf_meshlets_header_t* header;
+    const bsf_meshlet_t* meshlets;
+    const uint32_t* vertices;
+    const uint8_t* triangles;
+} bsf_meshlets_view_t;
+
+typedef struct {
+    const bsf_texture_header_t* header;
+    const void* data; // all mips
+    uint64_t data_size;
+} bsf_texture_view_t;
+
+// Maps the file and validates header and chunk table. All views returned afterwards point into the mapping and stay
+// valid until the file is closed.
+bool bsf_file_open ( bsf_file_t* bsf, const char* path );
+void bsf_file_close ( bsf_file_t* bsf );
+
+// Size of all the vertex streams for a single vertex, 0 if the layout is unknown
+uint32_t bsf_vertex_size ( uint32_t vertex_layout );
+uint64_t bsf_mesh_chunk_size ( uint32_t vertex_layout, uint32_t vertex_count, uint32_t lod_index_count );
+bool bsf_mesh_view ( bsf_mesh_view_t* view, const bsf_file_t* bsf, uint32_t chunk_idx );
+const bsf_material_t* bsf_material_view ( const bsf_file_t* bsf, uint32_t chunk_idx );
+uint64_t bsf_meshlets_chunk_size ( uint32_t meshlet_count, uint32_t vertex_index_count, uint32_t triangle_count );
+bool bsf_meshlets_view ( bsf_meshlets_view_t* view, const bsf_file_t* bsf, uint32_t chunk_idx );
+// Linear search over the material chunks, returns NULL if not found
+const bsf_material_t* bsf_material_find ( const bsf_file_t* bsf, uint32_t material_id );
+// 0 if the format is unknown
+uint32_t bsf_texture_block_size ( uint32_t format );
+uint64_t bsf_texture_mip_size ( uint32_t format, uint32_t width, uint32_t height, uint32_t mip );
+uint64_t bsf_texture_chunk_size ( uint32_t format, uint32_t width, uint32_t height, uint32_t mip_count );
+bool bsf_texture_view ( bsf_texture_view_t* view, const bsf_file_t* bsf, uint32_t chunk_idx );
+// Linear search over the texture chunks, returns false if not found
+bool bsf_texture_find ( bsf_texture_view_t* view, const bsf_file_t* bsf, uint32_t texture_id );
@@ -2,7 +2,9 @@
 
 #include "fs_dir.h"
 #include "fs_file.h"
+#include "fs_io.h"
 #include "fs_path.h"
+#include "fs_virtual_file.h"
 #include "fs_volume.h"
 #include "fs_state.h"
 
@@ -33,6 +35,7 @@ static void fs_api_init ( fs_i* fs ) {
     fs->get_dir_files = fs_dir_get_files;
     fs->get_dir_subdirs = fs_dir_get_subdirs;
     fs->get_dir_info = fs_dir_get_info;
+    fs->scan_dir = fs_dir_scan;
     // file
     fs->create_file = fs_file_create;
     fs->create_file_path = fs_file_path_create;
@@ -48,11 +51,29 @@ static void fs_api_init ( fs_i* fs ) {
     fs->unmap_file = fs_file_unmap;
     fs->read_file = fs_file_read;
     fs->write_file = fs_file_write;
+    fs->read_file_at = fs_file_read_at;
+    fs->write_file_at = fs_file_write_at;
+    fs->read_file_scatter = fs_file_read_scatter;
+    fs->write_file_gather = fs_file_write_gather;
     fs->seek_file = fs_file_seek;
     fs->get_file_info = fs_file_get_info;
     fs->get_file_path_info = fs_file_path_get_info;
     fs->get_file_path = fs_file_get_path;
     fs->read_file_path_to_heap = fs_file_path_read_alloc;
+    // virtual file
+    fs->create_virtual_file = fs_virtual_file_create;
+    fs->get_virtual_file_writer = fs_virtual_file_get_writer;
+    fs->stream_virtual_file = fs_virtual_file_stream;
+    fs->flush_virtual_file = fs_virtual_file_flush;
+    fs->close_virtual_file = fs_virtual_file_close;
+    // io
+    fs->create_io_queue = fs_io_queue_create;
+    fs->destroy_io_queue = fs_io_queue_destroy;
+    fs->get_io_queue_backend = fs_io_queue_get_backend;
+    fs->submit_read = fs_io_submit_read;
+    fs->submit_reads = fs_io_submit_reads;
+    fs->poll_io_queue = fs_io_queue_poll;
+    fs->wait_io_queue = fs_io_queue_wait;
 }
 
 void* fs_load ( void* std_runtime ) {
@@ -60,6 +81,8 @@ void* fs_load ( void* std_runtime ) {
 
     fs_state_t* state = fs_state_alloc();
 
+    fs_io_load ( &state->io );
+    fs_virtual_file_load ( &state->virtual_file );
     fs_api_init ( &state->api );
 
     return &state->api;
@@ -70,9 +93,12 @@ void fs_reload ( void* std_runtime, void* api ) {
 
     std_auto_m state = ( fs_state_t* ) api;
 
+    fs_io_reload ( &state->io );
+    fs_virtual_file_reload ( &state->virtual_file );
     fs_api_init ( &state->api );
 }
 
 void fs_unload ( void ) {
-    std_noop_m;
+    fs_io_unload();
+    fs_virtual_file_unload();
 }
@@ -338,6 +338,120 @@ next:
 #endif
 }
 
+#if defined(std_platform_linux_m)
+// getdents64 record layout, glibc only exposes these through readdir
+typedef struct {
+    uint64_t ino;
+    int64_t off;
+    uint16_t reclen;
+    uint8_t type;
+    char name[];
+} fs_linux_dirent64_t;
+
+#define fs_dir_scan_buffer_size_m ( 32 * 1024 )
+
+static void fs_dir_scan_stat ( fs_dir_entry_t* entry, int dir_fd, const fs_linux_dirent64_t* item ) {
+    struct statx info;
+    int result = statx ( dir_fd, item->name, AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME, &info );
+
+    if ( result != 0 ) {
+        // Deleted since the listing or not accessible, keep what the listing knows
+        entry->flags = item->type == DT_DIR ? fs_path_is_dir_m : item->type == DT_REG ? fs_path_is_file_m : 0;
+        entry->size = 0;
+        entry->last_write_time.count = 0;
+        return;
+    }
+
+    entry->flags = S_ISDIR ( info.stx_mode ) ? fs_path_is_dir_m : S_ISREG ( info.stx_mode ) ? fs_path_is_file_m : 0;
+    entry->size = info.stx_size;
+    struct timespec last_write_time = { .tv_sec = info.stx_mtime.tv_sec, .tv_nsec = info.stx_mtime.tv_nsec };
+    fs_filetime_to_timestamp ( last_write_time, &entry->last_write_time );
+}
+#endif
+
+size_t fs_dir_scan ( fs_dir_entry_t* entries, size_t entries_cap, const char* path ) {
+    std_assert_m ( path != NULL );
+#if defined(std_platform_win32_m)
+    size_t len = fs_to_path_buffer ( path );
+    std_assert_m ( len > 0 && len + 2 < fs_path_size_m );
+    size_t end = len - 1;
+
+    if ( end > 0 && t_path_buffer[end - 1] != L'/' && t_path_buffer[end - 1] != L'\\' ) {
+        t_path_buffer[end++] = L'/';
+    }
+
+    t_path_buffer[end++] = L'*';
+    t_path_buffer[end] = L'\0';
+
+    // Basic info skips the short names, large fetch asks for bigger batches from the file system
+    WIN32_FIND_DATAW item;
+    HANDLE find_handle = FindFirstFileExW ( t_path_buffer, FindExInfoBasic, &item, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH );
+
+    if ( find_handle == INVALID_HANDLE_VALUE ) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    do {
+        if ( item.cFileName[0] == L'.' && ( item.cFileName[1] == L'\0' || ( item.cFileName[1] == L'.' && item.cFileName[2] == L'\0' ) ) ) {
+            continue;
+        }
+
+        if ( count < entries_cap ) {
+            fs_dir_entry_t* entry = &entries[count];
+            fs_path_to_str ( item.cFileName, entry->name, fs_dir_entry_name_size_m );
+            entry->flags = item.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ? fs_path_is_dir_m : fs_path_is_file_m;
+            entry->size = ( uint64_t ) item.nFileSizeHigh << 32 | item.nFileSizeLow;
+            uint64_t last_write_time = ( uint64_t ) item.ftLastWriteTime.dwHighDateTime << 32 | item.ftLastWriteTime.dwLowDateTime;
+            fs_filetime_to_timestamp ( last_write_time, &entry->last_write_time );
+        }
+
+        ++count;
+    } while ( FindNextFileW ( find_handle, &item ) );
+
+    FindClose ( find_handle );
+    return count;
+#elif defined(std_platform_linux_m)
+    int dir_fd = open ( path, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+    if ( dir_fd == -1 ) {
+        return 0;
+    }
+
+    uint64_t buffer[fs_dir_scan_buffer_size_m / sizeof ( uint64_t )];
+    size_t count = 0;
+
+    for ( ;; ) {
+        long read_size = syscall ( SYS_getdents64, dir_fd, buffer, sizeof ( buffer ) );
+
+        if ( read_size <= 0 ) {
+            break;
+        }
+
+        for ( long offset = 0; offset < read_size; ) {
+            const fs_linux_dirent64_t* item = ( const fs_linux_dirent64_t* ) ( ( char* ) buffer + offset );
+            offset += item->reclen;
+
+            if ( std_str_cmp ( item->name, "." ) == 0 || std_str_cmp ( item->name, ".." ) == 0 ) {
+                continue;
+            }
+
+            if ( count < entries_cap ) {
+                fs_dir_entry_t* entry = &entries[count];
+                std_str_copy ( entry->name, fs_dir_entry_name_size_m, item->name );
+                fs_dir_scan_stat ( entry, dir_fd, item );
+            }
+
+            ++count;
+        }
+    }
+
+    close ( dir_fd );
+    return count;
+#endif
+}
+
 bool fs_dir_get_info ( fs_dir_info_t* info, const char* path ) {
     std_assert_m ( path != NULL );
     std_assert_m ( info != NULL );
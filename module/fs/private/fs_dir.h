@@ -10,3 +10,4 @@ size_t  fs_dir_iterate ( const char* path, fs_iterator_callback_f callback, void
 size_t  fs_dir_get_files ( char** files, size_t files_cap, size_t file_cap, const char* path );
 size_t  fs_dir_get_subdirs ( char** subdirs, size_t subdirs_cap, size_t subdir_cap, const char* path );
 bool    fs_dir_get_info ( fs_dir_info_t* info, const char* path );
+size_t  fs_dir_scan ( fs_dir_entry_t* entries, size_t entries_cap, const char* path );
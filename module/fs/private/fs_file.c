@@ -9,6 +9,7 @@
 
 #if defined(std_platform_linux_m)
     #include <sys/sendfile.h>
+    #include <sys/uio.h>
 #endif
 
 // code is duplicated for API that takes both file and api as param because of path_buffer usage
@@ -48,6 +49,10 @@ fs_file_h fs_file_create ( const char* path, fs_file_access_t access, fs_already
         flags |= O_WRONLY;
     }
 
+    if ( already_existing == fs_already_existing_overwrite_m ) {
+        flags |= O_TRUNC;
+    }
+
     int fd = open ( path, flags | O_CREAT, 0700 );
 
     if ( fd == -1 ) {
@@ -439,6 +444,168 @@ bool fs_file_write ( fs_file_h file, const void* source, size_t size ) {
 #endif
 }
 
+// Moves the cursor size bytes forward over the buffers
+static void fs_file_buffers_advance ( size_t* buffer_idx, size_t* buffer_offset, const std_buffer_t* buffers, size_t count, uint64_t size ) {
+    size_t idx = *buffer_idx;
+    size_t offset = *buffer_offset;
+
+    while ( idx < count && size >= buffers[idx].size - offset ) {
+        size -= buffers[idx].size - offset;
+        offset = 0;
+        ++idx;
+    }
+
+    *buffer_idx = idx;
+    *buffer_offset = offset + size;
+}
+
+#if defined(std_platform_linux_m)
+// Buffers are passed to the kernel in batches of this many iovecs, always within IOV_MAX
+#define fs_file_iovec_batch_m 256
+
+// Fills up to fs_file_iovec_batch_m iovecs starting from the cursor
+static int fs_file_buffers_to_iovecs ( struct iovec* iovecs, const std_buffer_t* buffers, size_t count, size_t buffer_idx, size_t buffer_offset ) {
+    int iovec_count = 0;
+
+    for ( size_t i = buffer_idx; i < count && iovec_count < fs_file_iovec_batch_m; ++i ) {
+        size_t skip = i == buffer_idx ? buffer_offset : 0;
+        iovecs[iovec_count].iov_base = buffers[i].base + skip;
+        iovecs[iovec_count].iov_len = buffers[i].size - skip;
+        ++iovec_count;
+    }
+
+    return iovec_count;
+}
+#endif
+
+uint64_t fs_file_read_at ( void* dest, size_t size, fs_file_h file, uint64_t offset ) {
+    std_buffer_t buffer = std_buffer_m ( .base = dest, .size = size );
+    return fs_file_read_scatter ( &buffer, 1, file, offset );
+}
+
+bool fs_file_write_at ( fs_file_h file, const void* source, size_t size, uint64_t offset ) {
+    std_buffer_t buffer = std_buffer_m ( .base = ( void* ) source, .size = size );
+    return fs_file_write_gather ( file, &buffer, 1, offset );
+}
+
+uint64_t fs_file_read_scatter ( const std_buffer_t* buffers, size_t count, fs_file_h file, uint64_t offset ) {
+    uint64_t total_read_size = 0;
+    size_t buffer_idx = 0;
+    size_t buffer_offset = 0;
+
+#if defined(std_platform_win32_m)
+    while ( buffer_idx < count ) {
+        if ( buffers[buffer_idx].size == buffer_offset ) {
+            ++buffer_idx;
+            buffer_offset = 0;
+            continue;
+        }
+
+        uint64_t read_offset = offset + total_read_size;
+        OVERLAPPED overlapped;
+        std_mem_zero_m ( &overlapped );
+        overlapped.Offset = ( DWORD ) read_offset;
+        overlapped.OffsetHigh = ( DWORD ) ( read_offset >> 32 );
+        DWORD remaining_size = std_min ( UINT32_MAX, buffers[buffer_idx].size - buffer_offset );
+        DWORD read_size;
+        BOOL read_retcode = ReadFile ( ( HANDLE ) file, buffers[buffer_idx].base + buffer_offset, remaining_size, &read_size, &overlapped );
+
+        if ( read_retcode == FALSE ) {
+            DWORD error = GetLastError();
+
+            if ( error == ERROR_HANDLE_EOF ) {
+                break;
+            }
+
+            std_log_warn_m ( "File read failed with code " std_fmt_u32_m, error );
+            return fs_read_error_m;
+        }
+#elif defined(std_platform_linux_m)
+    struct iovec iovecs[fs_file_iovec_batch_m];
+
+    while ( buffer_idx < count ) {
+        int iovec_count = fs_file_buffers_to_iovecs ( iovecs, buffers, count, buffer_idx, buffer_offset );
+        ssize_t read_size = preadv ( ( int ) file, iovecs, iovec_count, ( off_t ) ( offset + total_read_size ) );
+
+        if ( read_size == -1 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            std_log_warn_m ( "File read failed with code " std_fmt_i32_m ": " std_fmt_str_m, errno, strerror ( errno ) );
+            return fs_read_error_m;
+        }
+#endif
+
+        size_t prev_buffer_idx = buffer_idx;
+        fs_file_buffers_advance ( &buffer_idx, &buffer_offset, buffers, count, ( uint64_t ) read_size );
+        total_read_size += ( uint64_t ) read_size;
+
+        // Nothing read with data left to read means EOF, empty buffers are skipped by advance
+        if ( read_size == 0 && buffer_idx == prev_buffer_idx ) {
+            break;
+        }
+    }
+
+    return total_read_size;
+}
+
+bool fs_file_write_gather ( fs_file_h file, const std_buffer_t* buffers, size_t count, uint64_t offset ) {
+    uint64_t total_write_size = 0;
+    size_t buffer_idx = 0;
+    size_t buffer_offset = 0;
+
+#if defined(std_platform_win32_m)
+    while ( buffer_idx < count ) {
+        if ( buffers[buffer_idx].size == buffer_offset ) {
+            ++buffer_idx;
+            buffer_offset = 0;
+            continue;
+        }
+
+        uint64_t write_offset = offset + total_write_size;
+        OVERLAPPED overlapped;
+        std_mem_zero_m ( &overlapped );
+        overlapped.Offset = ( DWORD ) write_offset;
+        overlapped.OffsetHigh = ( DWORD ) ( write_offset >> 32 );
+        DWORD remaining_size = std_min ( UINT32_MAX, buffers[buffer_idx].size - buffer_offset );
+        DWORD write_size;
+        BOOL write_retcode = WriteFile ( ( HANDLE ) file, buffers[buffer_idx].base + buffer_offset, remaining_size, &write_size, &overlapped );
+
+        if ( write_retcode == FALSE ) {
+            std_log_warn_m ( "File write failed with code " std_fmt_u32_m, GetLastError() );
+            return false;
+        }
+#elif defined(std_platform_linux_m)
+    struct iovec iovecs[fs_file_iovec_batch_m];
+
+    while ( buffer_idx < count ) {
+        int iovec_count = fs_file_buffers_to_iovecs ( iovecs, buffers, count, buffer_idx, buffer_offset );
+        ssize_t write_size = pwritev ( ( int ) file, iovecs, iovec_count, ( off_t ) ( offset + total_write_size ) );
+
+        if ( write_size == -1 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            std_log_warn_m ( "File write failed with code " std_fmt_i32_m ": " std_fmt_str_m, errno, strerror ( errno ) );
+            return false;
+        }
+#endif
+
+        size_t prev_buffer_idx = buffer_idx;
+        fs_file_buffers_advance ( &buffer_idx, &buffer_offset, buffers, count, ( uint64_t ) write_size );
+        total_write_size += ( uint64_t ) write_size;
+
+        if ( write_size == 0 && buffer_idx == prev_buffer_idx ) {
+            std_log_warn_m ( "File write made no progress" );
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool fs_file_seek ( fs_file_h file, fs_file_point_t base, int64_t offset ) {
 #if defined(std_platform_win32_m)
     DWORD method;
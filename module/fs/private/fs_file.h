@@ -2,11 +2,6 @@
 
 #include <fs.h>
 
-typedef struct {
-    fs_file_h file_handle;
-    std_virtual_stack_t stack;
-} fs_virtual_file_t;
-
 typedef struct {
 
 } fs_file_state_t;
@@ -32,6 +27,11 @@ bool        fs_file_unmap ( fs_file_h file, void* base );
 uint64_t    fs_file_read ( void* dest, size_t capacity, fs_file_h file );
 bool        fs_file_write ( fs_file_h file, const void* source, size_t size );
 
+uint64_t    fs_file_read_at ( void* dest, size_t size, fs_file_h file, uint64_t offset );
+bool        fs_file_write_at ( fs_file_h file, const void* source, size_t size, uint64_t offset );
+uint64_t    fs_file_read_scatter ( const std_buffer_t* buffers, size_t count, fs_file_h file, uint64_t offset );
+bool        fs_file_write_gather ( fs_file_h file, const std_buffer_t* buffers, size_t count, uint64_t offset );
+
 bool        fs_file_seek ( fs_file_h file, fs_file_point_t base, int64_t offset );
 
 bool        fs_file_get_info ( fs_file_info_t* info, fs_file_h file );
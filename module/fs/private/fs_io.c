@@ -0,0 +1,651 @@
+#include "fs_io.h"
+
+#include "fs_file.h"
+
+#include <std_allocator.h>
+#include <std_atomic.h>
+#include <std_list.h>
+#include <std_log.h>
+#include <std_string.h>
+
+#if defined(std_platform_linux_m)
+    #include <sys/syscall.h>
+#endif
+
+static fs_io_state_t* fs_io_state;
+
+void fs_io_load ( fs_io_state_t* state ) {
+    fs_io_state = state;
+
+    state->queues_array = std_virtual_heap_alloc_array_m ( fs_io_queue_t, fs_io_max_queues_m );
+    std_mem_zero_array_m ( state->queues_array, fs_io_max_queues_m );
+    state->queues_freelist = std_freelist_m ( state->queues_array, fs_io_max_queues_m );
+    std_mem_zero_m ( &state->queues_bitset );
+    std_mutex_init ( &state->mutex );
+}
+
+void fs_io_reload ( fs_io_state_t* state ) {
+    fs_io_state = state;
+}
+
+void fs_io_unload ( void ) {
+    uint64_t idx = 0;
+    while ( std_bitset_scan ( &idx, fs_io_state->queues_bitset, idx, std_bitset_u64_count_m ( fs_io_max_queues_m ) ) ) {
+        std_log_warn_m ( "IO queue " std_fmt_u64_m " was not destroyed before unloading", idx );
+        fs_io_queue_destroy ( idx );
+        ++idx;
+    }
+
+    std_virtual_heap_free ( fs_io_state->queues_array );
+    std_mutex_deinit ( &fs_io_state->mutex );
+}
+
+// ------------------------------------------------------------------------------------------------------
+// Shared
+// ------------------------------------------------------------------------------------------------------
+
+static fs_io_queue_t* fs_io_queue_get ( fs_io_queue_h handle ) {
+    std_assert_m ( handle < fs_io_max_queues_m && std_bitset_test ( fs_io_state->queues_bitset, handle ) );
+    return &fs_io_state->queues_array[handle];
+}
+
+static uint32_t fs_io_request_idx ( const fs_io_queue_t* queue, const fs_io_request_t* request ) {
+    return ( uint32_t ) ( request - queue->requests_array );
+}
+
+static fs_io_request_h fs_io_request_handle ( const fs_io_queue_t* queue, const fs_io_request_t* request ) {
+    return ( uint64_t ) request->gen << 32 | fs_io_request_idx ( queue, request );
+}
+
+static fs_io_completion_t fs_io_request_completion ( const fs_io_queue_t* queue, const fs_io_request_t* request ) {
+    fs_io_completion_t completion = {
+        .request = fs_io_request_handle ( queue, request ),
+        .user_data = request->user_data,
+        .read_size = request->read_size,
+    };
+    return completion;
+}
+
+// Returns the completed requests to the freelist, completions need to be filled already
+static void fs_io_queue_retire ( fs_io_queue_t* queue, const fs_io_completion_t* completions, size_t count ) {
+    if ( count == 0 ) {
+        return;
+    }
+
+    std_mutex_lock ( &queue->submit_mutex );
+
+    for ( size_t i = 0; i < count; ++i ) {
+        fs_io_request_t* request = &queue->requests_array[completions[i].request & 0xffffffff];
+        std_list_push ( &queue->requests_freelist, request );
+    }
+
+    std_mutex_unlock ( &queue->submit_mutex );
+
+    std_atomic_fetch_sub_u64 ( &queue->in_flight_count, count );
+}
+
+// ------------------------------------------------------------------------------------------------------
+// Thread pool backend
+// ------------------------------------------------------------------------------------------------------
+
+static void fs_io_worker_routine ( void* arg ) {
+    fs_io_queue_t* queue = ( fs_io_queue_t* ) arg;
+
+    std_mutex_lock ( &queue->submit_mutex );
+
+    for ( ;; ) {
+        while ( std_ring_count ( &queue->pending_ring ) == 0 && !queue->stop ) {
+            std_condition_variable_wait ( &queue->work_cv, &queue->submit_mutex );
+        }
+
+        if ( std_ring_count ( &queue->pending_ring ) == 0 ) {
+            break;
+        }
+
+        uint32_t request_idx = queue->pending_array[std_ring_bot_idx ( &queue->pending_ring )];
+        std_ring_pop ( &queue->pending_ring, 1 );
+        std_mutex_unlock ( &queue->submit_mutex );
+
+        fs_io_request_t* request = &queue->requests_array[request_idx];
+        request->read_size = fs_file_read_at ( request->dest, request->size, request->file, request->offset );
+
+        std_mutex_lock ( &queue->complete_mutex );
+        queue->completions_array[std_ring_top_idx ( &queue->completions_ring )] = fs_io_request_completion ( queue, request );
+        std_ring_push ( &queue->completions_ring, 1 );
+        // Waiters can ask for different counts, wake them all and let them check
+        std_condition_variable_wake_all ( &queue->done_cv );
+        std_mutex_unlock ( &queue->complete_mutex );
+
+        std_mutex_lock ( &queue->submit_mutex );
+    }
+
+    std_mutex_unlock ( &queue->submit_mutex );
+}
+
+static bool fs_io_thread_pool_init ( fs_io_queue_t* queue, uint32_t thread_count ) {
+    if ( thread_count > fs_io_max_queue_threads_m ) {
+        std_log_warn_m ( "Max IO queue thread count is lower than the requested thread count." );
+        thread_count = fs_io_max_queue_threads_m;
+    }
+
+    thread_count = std_max_u32 ( thread_count, 1 );
+
+    queue->pending_array = std_virtual_heap_alloc_array_m ( uint32_t, queue->capacity );
+    queue->pending_ring = std_ring ( queue->capacity );
+    queue->completions_array = std_virtual_heap_alloc_array_m ( fs_io_completion_t, queue->capacity );
+    queue->completions_ring = std_ring ( queue->capacity );
+    std_condition_variable_init ( &queue->work_cv );
+    std_condition_variable_init ( &queue->done_cv );
+    queue->stop = false;
+
+    for ( uint32_t i = 0; i < thread_count; ++i ) {
+        char name[std_thread_name_max_len_m];
+        std_str_format_m ( name, "fs_io_" std_fmt_u32_m, i );
+        queue->threads[i] = std_thread ( fs_io_worker_routine, queue, name, std_thread_core_mask_any_m );
+    }
+
+    queue->thread_count = thread_count;
+    return true;
+}
+
+static void fs_io_thread_pool_deinit ( fs_io_queue_t* queue ) {
+    std_mutex_lock ( &queue->submit_mutex );
+    queue->stop = true;
+    std_condition_variable_wake_all ( &queue->work_cv );
+    std_mutex_unlock ( &queue->submit_mutex );
+
+    for ( uint32_t i = 0; i < queue->thread_count; ++i ) {
+        std_thread_join ( queue->threads[i] );
+    }
+
+    std_condition_variable_deinit ( &queue->work_cv );
+    std_condition_variable_deinit ( &queue->done_cv );
+    std_virtual_heap_free ( queue->pending_array );
+    std_virtual_heap_free ( queue->completions_array );
+}
+
+// submit_mutex needs to be held
+static void fs_io_thread_pool_push ( fs_io_queue_t* queue, const fs_io_request_t* request ) {
+    queue->pending_array[std_ring_top_idx ( &queue->pending_ring )] = fs_io_request_idx ( queue, request );
+    std_ring_push ( &queue->pending_ring, 1 );
+}
+
+// complete_mutex needs to be held
+static size_t fs_io_thread_pool_pop ( fs_io_queue_t* queue, fs_io_completion_t* completions, size_t cap ) {
+    size_t count = std_min ( std_ring_count ( &queue->completions_ring ), cap );
+
+    for ( size_t i = 0; i < count; ++i ) {
+        completions[i] = queue->completions_array[std_ring_bot_idx ( &queue->completions_ring )];
+        std_ring_pop ( &queue->completions_ring, 1 );
+    }
+
+    return count;
+}
+
+// ------------------------------------------------------------------------------------------------------
+// io_uring backend
+// ------------------------------------------------------------------------------------------------------
+// The rings are accessed directly without liburing. The kernel only reads the sq tail and writes the cq tail,
+// so a compiler fence is enough on x86 to publish the sqes before the new tail and to read the cqes after it.
+
+#if defined(std_platform_linux_m)
+static bool fs_io_uring_init ( fs_io_queue_t* queue ) {
+    fs_io_uring_t* uring = &queue->uring;
+    struct io_uring_params params;
+    std_mem_zero_m ( &params );
+    int fd = ( int ) syscall ( __NR_io_uring_setup, queue->capacity, &params );
+
+    if ( fd < 0 ) {
+        std_log_info_m ( "io_uring is not available: " std_fmt_str_m, strerror ( errno ) );
+        return false;
+    }
+
+    size_t sq_map_size = params.sq_off.array + params.sq_entries * sizeof ( uint32_t );
+    size_t cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof ( struct io_uring_cqe );
+    bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+
+    if ( single_map ) {
+        sq_map_size = std_max ( sq_map_size, cq_map_size );
+        cq_map_size = sq_map_size;
+    }
+
+    void* sq_map = mmap ( NULL, sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+    void* cq_map = sq_map;
+
+    if ( sq_map != MAP_FAILED && !single_map ) {
+        cq_map = mmap ( NULL, cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING );
+    }
+
+    size_t sqes_size = params.sq_entries * sizeof ( struct io_uring_sqe );
+    void* sqes = mmap ( NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+
+    if ( sq_map == MAP_FAILED || cq_map == MAP_FAILED || sqes == MAP_FAILED ) {
+        std_log_warn_m ( "io_uring ring mapping failed: " std_fmt_str_m, strerror ( errno ) );
+
+        if ( sqes != MAP_FAILED ) {
+            munmap ( sqes, sqes_size );
+        }
+
+        if ( cq_map != MAP_FAILED && cq_map != sq_map ) {
+            munmap ( cq_map, cq_map_size );
+        }
+
+        if ( sq_map != MAP_FAILED ) {
+            munmap ( sq_map, sq_map_size );
+        }
+
+        close ( fd );
+        return false;
+    }
+
+    uring->fd = fd;
+    uring->sq_head = sq_map + params.sq_off.head;
+    uring->sq_tail = sq_map + params.sq_off.tail;
+    uring->sq_mask = sq_map + params.sq_off.ring_mask;
+    uring->sq_array = sq_map + params.sq_off.array;
+    uring->cq_head = cq_map + params.cq_off.head;
+    uring->cq_tail = cq_map + params.cq_off.tail;
+    uring->cq_mask = cq_map + params.cq_off.ring_mask;
+    uring->sqes = sqes;
+    uring->cqes = cq_map + params.cq_off.cqes;
+    uring->sq_map = sq_map;
+    uring->cq_map = cq_map;
+    uring->sq_map_size = sq_map_size;
+    uring->cq_map_size = cq_map_size;
+    uring->sqes_size = sqes_size;
+    return true;
+}
+
+static void fs_io_uring_deinit ( fs_io_queue_t* queue ) {
+    fs_io_uring_t* uring = &queue->uring;
+    munmap ( uring->sqes, uring->sqes_size );
+
+    if ( uring->cq_map != uring->sq_map ) {
+        munmap ( uring->cq_map, uring->cq_map_size );
+    }
+
+    munmap ( uring->sq_map, uring->sq_map_size );
+    close ( uring->fd );
+}
+
+// Fills an sqe for the remaining part of the request. submit_mutex needs to be held.
+// The sq can't overflow, it has capacity entries and there can't be more requests than that in flight.
+static void fs_io_uring_push ( fs_io_queue_t* queue, fs_io_request_t* request ) {
+    fs_io_uring_t* uring = &queue->uring;
+    uint32_t tail = *uring->sq_tail;
+    uint32_t sqe_idx = tail & *uring->sq_mask;
+    struct io_uring_sqe* sqe = &uring->sqes[sqe_idx];
+
+    // readv instead of read to support kernels older than 5.6
+    request->iovec.iov_base = request->dest + request->read_size;
+    request->iovec.iov_len = std_min_u64 ( request->size - request->read_size, fs_io_max_read_size_m );
+
+    std_mem_zero_m ( sqe );
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = ( int ) request->file;
+    sqe->off = request->offset + request->read_size;
+    sqe->addr = ( uint64_t ) &request->iovec;
+    sqe->len = 1;
+    sqe->user_data = fs_io_request_idx ( queue, request );
+    uring->sq_array[sqe_idx] = sqe_idx;
+
+    std_compiler_fence();
+    *uring->sq_tail = tail + 1;
+}
+
+// submit_mutex needs to be held
+static void fs_io_uring_submit ( fs_io_queue_t* queue ) {
+    fs_io_uring_t* uring = &queue->uring;
+
+    for ( ;; ) {
+        uint32_t count = *uring->sq_tail - *uring->sq_head;
+
+        if ( count == 0 ) {
+            break;
+        }
+
+        int result = ( int ) syscall ( __NR_io_uring_enter, uring->fd, count, 0, 0, NULL, 0 );
+
+        if ( result < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            // Unconsumed sqes stay in the ring, they go with the next submission or wait
+            std_log_warn_m ( "io_uring submission failed: " std_fmt_str_m, strerror ( errno ) );
+            break;
+        }
+    }
+}
+
+static void fs_io_uring_wait ( fs_io_queue_t* queue ) {
+    fs_io_uring_t* uring = &queue->uring;
+    // Sqes left behind by a failed submission are submitted here too, otherwise this could wait on requests the
+    // kernel never got. The kernel caps the count to what's in the ring, so racing a push is fine.
+    uint32_t submit_count = *uring->sq_tail - *uring->sq_head;
+    int result = ( int ) syscall ( __NR_io_uring_enter, uring->fd, submit_count, 1, IORING_ENTER_GETEVENTS, NULL, 0 );
+
+    if ( result < 0 && errno != EINTR ) {
+        std_log_warn_m ( "io_uring wait failed: " std_fmt_str_m, strerror ( errno ) );
+    }
+}
+
+// Moves completed requests to completions, short reads are resubmitted. complete_mutex needs to be held.
+static size_t fs_io_uring_reap ( fs_io_queue_t* queue, fs_io_completion_t* completions, size_t cap ) {
+    fs_io_uring_t* uring = &queue->uring;
+    uint32_t head = *uring->cq_head;
+    uint32_t tail = *uring->cq_tail;
+    std_compiler_fence();
+    size_t count = 0;
+    bool resubmit = false;
+
+    while ( head != tail && count < cap ) {
+        const struct io_uring_cqe* cqe = &uring->cqes[head & *uring->cq_mask];
+        fs_io_request_t* request = &queue->requests_array[cqe->user_data];
+        int32_t result = cqe->res;
+        bool retry = result == -EINTR || result == -EAGAIN;
+        ++head;
+
+        if ( result < 0 && !retry ) {
+            std_log_warn_m ( "File read failed with code " std_fmt_i32_m ": " std_fmt_str_m, -result, strerror ( -result ) );
+            request->read_size = fs_read_error_m;
+            completions[count++] = fs_io_request_completion ( queue, request );
+            continue;
+        }
+
+        if ( result > 0 ) {
+            request->read_size += ( uint64_t ) result;
+        }
+
+        // A 0 sized read means EOF
+        if ( ( retry || result > 0 ) && request->read_size < request->size ) {
+            std_mutex_lock ( &queue->submit_mutex );
+            fs_io_uring_push ( queue, request );
+            std_mutex_unlock ( &queue->submit_mutex );
+            resubmit = true;
+        } else {
+            completions[count++] = fs_io_request_completion ( queue, request );
+        }
+    }
+
+    std_compiler_fence();
+    *uring->cq_head = head;
+
+    if ( resubmit ) {
+        std_mutex_lock ( &queue->submit_mutex );
+        fs_io_uring_submit ( queue );
+        std_mutex_unlock ( &queue->submit_mutex );
+    }
+
+    return count;
+}
+#endif
+
+// ------------------------------------------------------------------------------------------------------
+// Queue
+// ------------------------------------------------------------------------------------------------------
+
+fs_io_queue_h fs_io_queue_create ( const fs_io_queue_params_t* params ) {
+    uint32_t capacity = std_pow2_round_up_u32 ( std_max_u32 ( params->capacity, 1 ) );
+
+    if ( capacity > fs_io_max_queue_capacity_m ) {
+        std_log_warn_m ( "Max IO queue capacity is lower than the requested capacity." );
+        capacity = fs_io_max_queue_capacity_m;
+    }
+
+    std_mutex_lock ( &fs_io_state->mutex );
+    fs_io_queue_t* queue = std_list_pop_m ( &fs_io_state->queues_freelist );
+    std_mutex_unlock ( &fs_io_state->mutex );
+
+    if ( queue == NULL ) {
+        std_log_error_m ( "Max IO queue count reached." );
+        return fs_null_handle_m;
+    }
+
+    queue->capacity = capacity;
+    queue->in_flight_count = 0;
+    queue->requests_array = std_virtual_heap_alloc_array_m ( fs_io_request_t, capacity );
+    std_mem_zero_array_m ( queue->requests_array, capacity );
+    queue->requests_freelist = std_freelist_m ( queue->requests_array, capacity );
+    std_mutex_init ( &queue->submit_mutex );
+    std_mutex_init ( &queue->complete_mutex );
+
+    fs_io_backend_e backend = fs_io_backend_thread_pool_m;
+    bool initialized = false;
+
+#if defined(std_platform_linux_m)
+    if ( params->backend != fs_io_backend_thread_pool_m ) {
+        initialized = fs_io_uring_init ( queue );
+        backend = fs_io_backend_uring_m;
+    }
+#endif
+
+    if ( !initialized && params->backend != fs_io_backend_uring_m ) {
+        initialized = fs_io_thread_pool_init ( queue, params->thread_count );
+        backend = fs_io_backend_thread_pool_m;
+    }
+
+    fs_io_queue_h handle = ( fs_io_queue_h ) ( queue - fs_io_state->queues_array );
+
+    if ( !initialized ) {
+        std_mutex_deinit ( &queue->submit_mutex );
+        std_mutex_deinit ( &queue->complete_mutex );
+        std_virtual_heap_free ( queue->requests_array );
+        std_mutex_lock ( &fs_io_state->mutex );
+        std_list_push ( &fs_io_state->queues_freelist, queue );
+        std_mutex_unlock ( &fs_io_state->mutex );
+        return fs_null_handle_m;
+    }
+
+    queue->backend = backend;
+
+    std_mutex_lock ( &fs_io_state->mutex );
+    std_bitset_set ( fs_io_state->queues_bitset, handle );
+    std_mutex_unlock ( &fs_io_state->mutex );
+
+    return handle;
+}
+
+void fs_io_queue_destroy ( fs_io_queue_h handle ) {
+    fs_io_queue_t* queue = fs_io_queue_get ( handle );
+
+    fs_io_completion_t completions[64];
+    while ( fs_io_queue_wait ( handle, completions, std_static_array_capacity_m ( completions ), 1 ) > 0 );
+
+    switch ( queue->backend ) {
+#if defined(std_platform_linux_m)
+    case fs_io_backend_uring_m:
+        fs_io_uring_deinit ( queue );
+        break;
+#endif
+    case fs_io_backend_thread_pool_m:
+        fs_io_thread_pool_deinit ( queue );
+        break;
+    default:
+        std_not_implemented_m();
+    }
+
+    std_mutex_deinit ( &queue->submit_mutex );
+    std_mutex_deinit ( &queue->complete_mutex );
+    std_virtual_heap_free ( queue->requests_array );
+    queue->capacity = 0;
+
+    std_mutex_lock ( &fs_io_state->mutex );
+    std_bitset_clear ( fs_io_state->queues_bitset, handle );
+    std_list_push ( &fs_io_state->queues_freelist, queue );
+    std_mutex_unlock ( &fs_io_state->mutex );
+}
+
+fs_io_backend_e fs_io_queue_get_backend ( fs_io_queue_h handle ) {
+    fs_io_queue_t* queue = fs_io_queue_get ( handle );
+    return queue->backend;
+}
+
+fs_io_request_h fs_io_submit_read ( fs_io_queue_h queue, fs_file_h file, uint64_t offset, uint64_t size, void* dest, void* user_data ) {
+    fs_io_read_t read = {
+        .file = file,
+        .offset = offset,
+        .size = size,
+        .dest = dest,
+        .user_data = user_data,
+    };
+    fs_io_request_h request;
+
+    if ( fs_io_submit_reads ( queue, &request, &read, 1 ) == 0 ) {
+        return fs_io_null_request_m;
+    }
+
+    return request;
+}
+
+size_t fs_io_submit_reads ( fs_io_queue_h handle, fs_io_request_h* requests, const fs_io_read_t* reads, size_t count ) {
+    fs_io_queue_t* queue = fs_io_queue_get ( handle );
+
+    std_mutex_lock ( &queue->submit_mutex );
+
+    size_t submit_count = 0;
+
+    while ( submit_count < count ) {
+        fs_io_request_t* request = std_list_pop_m ( &queue->requests_freelist );
+
+        if ( request == NULL ) {
+            break;
+        }
+
+        const fs_io_read_t* read = &reads[submit_count];
+        request->file = read->file;
+        request->offset = read->offset;
+        request->size = read->size;
+        request->read_size = 0;
+        request->dest = read->dest;
+        request->user_data = read->user_data;
+        ++request->gen;
+
+        if ( requests ) {
+            requests[submit_count] = fs_io_request_handle ( queue, request );
+        }
+
+        switch ( queue->backend ) {
+#if defined(std_platform_linux_m)
+        case fs_io_backend_uring_m:
+            fs_io_uring_push ( queue, request );
+            break;
+#endif
+        case fs_io_backend_thread_pool_m:
+            fs_io_thread_pool_push ( queue, request );
+            break;
+        default:
+            std_not_implemented_m();
+        }
+
+        ++submit_count;
+    }
+
+    std_atomic_fetch_add_u64 ( &queue->in_flight_count, submit_count );
+
+    if ( submit_count > 0 ) {
+#if defined(std_platform_linux_m)
+        if ( queue->backend == fs_io_backend_uring_m ) {
+            fs_io_uring_submit ( queue );
+        }
+#endif
+
+        if ( queue->backend == fs_io_backend_thread_pool_m ) {
+            if ( submit_count == 1 ) {
+                std_condition_variable_wake ( &queue->work_cv );
+            } else {
+                std_condition_variable_wake_all ( &queue->work_cv );
+            }
+        }
+    }
+
+    std_mutex_unlock ( &queue->submit_mutex );
+
+    return submit_count;
+}
+
+size_t fs_io_queue_poll ( fs_io_queue_h handle, fs_io_completion_t* completions, size_t cap ) {
+    fs_io_queue_t* queue = fs_io_queue_get ( handle );
+
+    // Someone else is already reaping or waiting, don't block on them
+    if ( !std_mutex_try_lock ( &queue->complete_mutex ) ) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    switch ( queue->backend ) {
+#if defined(std_platform_linux_m)
+    case fs_io_backend_uring_m:
+        // Retries sqes left behind by a failed submission, pollers might never submit or wait again
+        if ( *queue->uring.sq_tail != *queue->uring.sq_head ) {
+            std_mutex_lock ( &queue->submit_mutex );
+            fs_io_uring_submit ( queue );
+            std_mutex_unlock ( &queue->submit_mutex );
+        }
+
+        count = fs_io_uring_reap ( queue, completions, cap );
+        break;
+#endif
+    case fs_io_backend_thread_pool_m:
+        count = fs_io_thread_pool_pop ( queue, completions, cap );
+        break;
+    default:
+        std_not_implemented_m();
+    }
+
+    fs_io_queue_retire ( queue, completions, count );
+    std_mutex_unlock ( &queue->complete_mutex );
+    return count;
+}
+
+size_t fs_io_queue_wait ( fs_io_queue_h handle, fs_io_completion_t* completions, size_t cap, size_t min_count ) {
+    fs_io_queue_t* queue = fs_io_queue_get ( handle );
+    min_count = std_min ( min_count, cap );
+
+    // Held for the whole wait, in_flight_count can only grow while this is held so a waiter never blocks on requests
+    // that were already reaped by someone else
+    std_mutex_lock ( &queue->complete_mutex );
+
+    size_t count = 0;
+
+    for ( ;; ) {
+        size_t reap_count = 0;
+
+        switch ( queue->backend ) {
+#if defined(std_platform_linux_m)
+        case fs_io_backend_uring_m:
+            reap_count = fs_io_uring_reap ( queue, completions + count, cap - count );
+            break;
+#endif
+        case fs_io_backend_thread_pool_m:
+            reap_count = fs_io_thread_pool_pop ( queue, completions + count, cap - count );
+            break;
+        default:
+            std_not_implemented_m();
+        }
+
+        fs_io_queue_retire ( queue, completions + count, reap_count );
+        count += reap_count;
+
+        if ( count >= min_count || queue->in_flight_count == 0 ) {
+            break;
+        }
+
+        switch ( queue->backend ) {
+#if defined(std_platform_linux_m)
+        case fs_io_backend_uring_m:
+            fs_io_uring_wait ( queue );
+            break;
+#endif
+        case fs_io_backend_thread_pool_m:
+            std_condition_variable_wait ( &queue->done_cv, &queue->complete_mutex );
+            break;
+        default:
+            std_not_implemented_m();
+        }
+    }
+
+    std_mutex_unlock ( &queue->complete_mutex );
+    return count;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <fs.h>
+
+#include <std_byte.h>
+#include <std_mutex.h>
+#include <std_queue.h>
+#include <std_thread.h>
+
+#if defined(std_platform_linux_m)
+    #include <linux/io_uring.h>
+    #include <sys/uio.h>
+#endif
+
+// Single reads are split at this size, Linux never reads more than ~2GB in one go anyway
+#define fs_io_max_read_size_m ( 1ull << 30 )
+
+typedef struct {
+    // Freelist next pointer while the request is free
+    fs_file_h file;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t read_size;
+    void* dest;
+    void* user_data;
+    uint32_t gen;
+#if defined(std_platform_linux_m)
+    struct iovec iovec;
+#endif
+} fs_io_request_t;
+
+#if defined(std_platform_linux_m)
+typedef struct {
+    int fd;
+    uint32_t* sq_head;
+    uint32_t* sq_tail;
+    uint32_t* sq_mask;
+    uint32_t* sq_array;
+    uint32_t* cq_head;
+    uint32_t* cq_tail;
+    uint32_t* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_map;
+    void* cq_map;
+    size_t sq_map_size;
+    size_t cq_map_size;
+    size_t sqes_size;
+} fs_io_uring_t;
+#endif
+
+typedef struct {
+    // Freelist next pointer while the queue is free
+    fs_io_request_t* requests_array;
+    fs_io_request_t* requests_freelist;
+    fs_io_backend_e backend;
+    uint32_t capacity;
+    // Submitted requests whose completion hasn't been returned to the user yet
+    uint64_t in_flight_count;
+
+    // Guards the requests freelist and the submission side of the backend
+    std_mutex_t submit_mutex;
+    // Guards the completion side of the backend
+    std_mutex_t complete_mutex;
+
+    // thread pool
+    std_condition_variable_t work_cv;
+    std_condition_variable_t done_cv;
+    uint32_t* pending_array;
+    std_ring_t pending_ring;
+    fs_io_completion_t* completions_array;
+    std_ring_t completions_ring;
+    std_thread_h threads[fs_io_max_queue_threads_m];
+    uint32_t thread_count;
+    bool stop;
+
+#if defined(std_platform_linux_m)
+    fs_io_uring_t uring;
+#endif
+} fs_io_queue_t;
+
+typedef struct {
+    fs_io_queue_t* queues_array;
+    fs_io_queue_t* queues_freelist;
+    uint64_t queues_bitset[std_bitset_u64_count_m ( fs_io_max_queues_m )];
+    std_mutex_t mutex;
+} fs_io_state_t;
+
+void fs_io_load ( fs_io_state_t* state );
+void fs_io_reload ( fs_io_state_t* state );
+void fs_io_unload ( void );
+
+fs_io_queue_h   fs_io_queue_create ( const fs_io_queue_params_t* params );
+void            fs_io_queue_destroy ( fs_io_queue_h queue );
+fs_io_backend_e fs_io_queue_get_backend ( fs_io_queue_h queue );
+
+fs_io_request_h fs_io_submit_read ( fs_io_queue_h queue, fs_file_h file, uint64_t offset, uint64_t size, void* dest, void* user_data );
+size_t          fs_io_submit_reads ( fs_io_queue_h queue, fs_io_request_h* requests, const fs_io_read_t* reads, size_t count );
+
+size_t          fs_io_queue_poll ( fs_io_queue_h queue, fs_io_completion_t* completions, size_t cap );
+size_t          fs_io_queue_wait ( fs_io_queue_h queue, fs_io_completion_t* completions, size_t cap, size_t min_count );
@@ -4,8 +4,13 @@
 
 #include <std_allocator.h>
 
+#include "fs_io.h"
+#include "fs_virtual_file.h"
+
 typedef struct {
     fs_i api;
+    fs_io_state_t io;
+    fs_virtual_file_state_t virtual_file;
 } fs_state_t;
 
 std_module_declare_state_m ( fs )
@@ -0,0 +1,199 @@
+#include "fs_virtual_file.h"
+
+#include "fs_file.h"
+
+#include <std_list.h>
+#include <std_log.h>
+#include <std_string.h>
+
+static fs_virtual_file_state_t* fs_virtual_file_state;
+
+void fs_virtual_file_load ( fs_virtual_file_state_t* state ) {
+    fs_virtual_file_state = state;
+
+    state->files_array = std_virtual_heap_alloc_array_m ( fs_virtual_file_t, fs_virtual_file_max_count_m );
+    std_mem_zero_array_m ( state->files_array, fs_virtual_file_max_count_m );
+    state->files_freelist = std_freelist_m ( state->files_array, fs_virtual_file_max_count_m );
+    std_mem_zero_m ( &state->files_bitset );
+    std_mutex_init ( &state->mutex );
+}
+
+void fs_virtual_file_reload ( fs_virtual_file_state_t* state ) {
+    fs_virtual_file_state = state;
+}
+
+void fs_virtual_file_unload ( void ) {
+    uint64_t idx = 0;
+    while ( std_bitset_scan ( &idx, fs_virtual_file_state->files_bitset, idx, std_bitset_u64_count_m ( fs_virtual_file_max_count_m ) ) ) {
+        std_log_warn_m ( "Virtual file " std_fmt_u64_m " was not closed before unloading", idx );
+        fs_virtual_file_close ( idx );
+        ++idx;
+    }
+
+    std_virtual_heap_free ( fs_virtual_file_state->files_array );
+    std_mutex_deinit ( &fs_virtual_file_state->mutex );
+}
+
+static fs_virtual_file_t* fs_virtual_file_get ( fs_virtual_file_h handle ) {
+    std_assert_m ( handle < fs_virtual_file_max_count_m && std_bitset_test ( fs_virtual_file_state->files_bitset, handle ) );
+    return &fs_virtual_file_state->files_array[handle];
+}
+
+// Writes the committed pages in fs_virtual_file_write_size_m steps, unmapping each step once it's on disk
+static void fs_virtual_file_stream_routine ( void* arg ) {
+    fs_virtual_file_t* file = ( fs_virtual_file_t* ) arg;
+    char* base = ( char* ) file->stack.begin;
+
+    std_mutex_lock ( &file->mutex );
+
+    for ( ;; ) {
+        while ( file->streamed_size == file->committed_size && !file->stop ) {
+            std_condition_variable_wait ( &file->work_cv, &file->mutex );
+        }
+
+        if ( file->streamed_size == file->committed_size ) {
+            break;
+        }
+
+        size_t begin = file->streamed_size;
+        size_t end = std_min ( file->committed_size, begin + fs_virtual_file_write_size_m );
+        std_mutex_unlock ( &file->mutex );
+
+        bool result = fs_file_write_at ( file->file, base + begin, end - begin, begin );
+        std_virtual_unmap ( base + begin, base + end );
+
+        std_mutex_lock ( &file->mutex );
+        file->streamed_size = end;
+
+        if ( !result ) {
+            std_log_warn_m ( "Virtual file write failed at offset " std_fmt_size_m, begin );
+            file->write_failed = true;
+        }
+
+        std_condition_variable_wake_all ( &file->done_cv );
+    }
+
+    std_mutex_unlock ( &file->mutex );
+}
+
+fs_virtual_file_h fs_virtual_file_create ( const char* path, size_t virtual_size ) {
+    fs_file_h os_file = fs_file_create ( path, fs_file_write_m, fs_already_existing_overwrite_m );
+
+    if ( os_file == fs_null_handle_m ) {
+        std_log_error_m ( "Failed to create virtual file " std_fmt_str_m, path );
+        return fs_null_handle_m;
+    }
+
+    std_mutex_lock ( &fs_virtual_file_state->mutex );
+    fs_virtual_file_t* file = std_list_pop_m ( &fs_virtual_file_state->files_freelist );
+    std_mutex_unlock ( &fs_virtual_file_state->mutex );
+
+    if ( file == NULL ) {
+        std_log_error_m ( "Max virtual file count reached." );
+        fs_file_close ( os_file );
+        return fs_null_handle_m;
+    }
+
+    file->file = os_file;
+    file->stack = std_virtual_stack_create ( virtual_size );
+    file->committed_size = 0;
+    file->streamed_size = 0;
+    file->write_failed = false;
+    std_mutex_init ( &file->mutex );
+    std_condition_variable_init ( &file->work_cv );
+    std_condition_variable_init ( &file->done_cv );
+    file->is_streaming = false;
+    file->stop = false;
+
+    fs_virtual_file_h handle = ( fs_virtual_file_h ) ( file - fs_virtual_file_state->files_array );
+
+    std_mutex_lock ( &fs_virtual_file_state->mutex );
+    std_bitset_set ( fs_virtual_file_state->files_bitset, handle );
+    std_mutex_unlock ( &fs_virtual_file_state->mutex );
+
+    return handle;
+}
+
+std_virtual_stack_t* fs_virtual_file_get_writer ( fs_virtual_file_h handle ) {
+    fs_virtual_file_t* file = fs_virtual_file_get ( handle );
+    return &file->stack;
+}
+
+bool fs_virtual_file_stream ( fs_virtual_file_h handle, size_t size ) {
+    fs_virtual_file_t* file = fs_virtual_file_get ( handle );
+    std_assert_m ( size <= std_virtual_stack_used_size ( &file->stack ) );
+
+    // Only whole pages can be unmapped, the tail stays with the writer until the next call
+    size_t page_size = std_virtual_page_size();
+    size_t committed_size = size - size % page_size;
+
+    std_mutex_lock ( &file->mutex );
+
+    if ( !file->is_streaming ) {
+        char name[std_thread_name_max_len_m];
+        std_str_format_m ( name, "fs_virtual_file_" std_fmt_u64_m, handle );
+        file->thread = std_thread ( fs_virtual_file_stream_routine, file, name, std_thread_core_mask_any_m );
+        file->is_streaming = true;
+    }
+
+    if ( committed_size > file->committed_size ) {
+        file->committed_size = committed_size;
+        std_condition_variable_wake ( &file->work_cv );
+    }
+
+    while ( file->committed_size - file->streamed_size > fs_virtual_file_max_pending_size_m ) {
+        std_condition_variable_wait ( &file->done_cv, &file->mutex );
+    }
+
+    bool result = !file->write_failed;
+    std_mutex_unlock ( &file->mutex );
+    return result;
+}
+
+bool fs_virtual_file_flush ( fs_virtual_file_h handle ) {
+    fs_virtual_file_t* file = fs_virtual_file_get ( handle );
+
+    std_mutex_lock ( &file->mutex );
+
+    while ( file->streamed_size != file->committed_size ) {
+        std_condition_variable_wait ( &file->done_cv, &file->mutex );
+    }
+
+    size_t streamed_size = file->streamed_size;
+    bool result = !file->write_failed;
+    std_mutex_unlock ( &file->mutex );
+
+    char* base = ( char* ) file->stack.begin;
+    size_t size = std_virtual_stack_used_size ( &file->stack );
+    std_assert_m ( size >= streamed_size );
+
+    if ( size > streamed_size ) {
+        result &= fs_file_write_at ( file->file, base + streamed_size, size - streamed_size, streamed_size );
+    }
+
+    return result;
+}
+
+void fs_virtual_file_close ( fs_virtual_file_h handle ) {
+    fs_virtual_file_t* file = fs_virtual_file_get ( handle );
+
+    // The streaming thread writes everything that's already committed before stopping
+    if ( file->is_streaming ) {
+        std_mutex_lock ( &file->mutex );
+        file->stop = true;
+        std_condition_variable_wake ( &file->work_cv );
+        std_mutex_unlock ( &file->mutex );
+        std_thread_join ( file->thread );
+    }
+
+    std_condition_variable_deinit ( &file->work_cv );
+    std_condition_variable_deinit ( &file->done_cv );
+    std_mutex_deinit ( &file->mutex );
+    std_virtual_stack_destroy ( &file->stack );
+    fs_file_close ( file->file );
+
+    std_mutex_lock ( &fs_virtual_file_state->mutex );
+    std_bitset_clear ( fs_virtual_file_state->files_bitset, handle );
+    std_list_push ( &fs_virtual_file_state->files_freelist, file );
+    std_mutex_unlock ( &fs_virtual_file_state->mutex );
+}
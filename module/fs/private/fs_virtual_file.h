@@ -0,0 +1,43 @@
+#pragma once
+
+#include <fs.h>
+
+#include <std_allocator.h>
+#include <std_mutex.h>
+#include <std_thread.h>
+
+typedef struct {
+    // Freelist next pointer while the file is free
+    fs_file_h file;
+    std_virtual_stack_t stack;
+
+    // Writer offsets, streamed_size <= committed_size <= stack top. Everything below streamed_size is on disk and unmapped.
+    size_t committed_size;
+    size_t streamed_size;
+    bool write_failed;
+
+    // The streaming thread is only created on the first stream call
+    std_mutex_t mutex;
+    std_condition_variable_t work_cv;
+    std_condition_variable_t done_cv;
+    std_thread_h thread;
+    bool is_streaming;
+    bool stop;
+} fs_virtual_file_t;
+
+typedef struct {
+    fs_virtual_file_t* files_array;
+    fs_virtual_file_t* files_freelist;
+    uint64_t files_bitset[std_bitset_u64_count_m ( fs_virtual_file_max_count_m )];
+    std_mutex_t mutex;
+} fs_virtual_file_state_t;
+
+void fs_virtual_file_load ( fs_virtual_file_state_t* state );
+void fs_virtual_file_reload ( fs_virtual_file_state_t* state );
+void fs_virtual_file_unload ( void );
+
+fs_virtual_file_h    fs_virtual_file_create ( const char* path, size_t virtual_size );
+std_virtual_stack_t* fs_virtual_file_get_writer ( fs_virtual_file_h file );
+bool                 fs_virtual_file_stream ( fs_virtual_file_h file, size_t size );
+bool                 fs_virtual_file_flush ( fs_virtual_file_h file );
+void                 fs_virtual_file_close ( fs_virtual_file_h file );
@@ -113,6 +113,13 @@ typedef struct {
     fs_dir_flags_t flags;
 } fs_dir_info_t;
 
+typedef struct {
+    char name[fs_dir_entry_name_size_m];
+    fs_path_flags_t flags;
+    uint64_t size;
+    std_timestamp_t last_write_time;
+} fs_dir_entry_t;
+
 typedef enum {
     fs_already_existing_overwrite_m,
     fs_already_existing_fail_m,       // TODO
@@ -123,6 +130,56 @@ typedef void ( fs_iterator_callback_f ) ( const char* name, fs_path_flags_t flag
 
 #define fs_read_error_m UINT64_MAX
 
+/*
+    Async IO
+    An io queue takes positional read requests and delivers their completions back to the queue itself, where they
+    can be polled or waited on by any thread (e.g. tk tasks). Requests are positional, the file position is not used
+    and is left undefined, and can be submitted one at a time or in batches. Reads complete once the full size is read, EOF is reached or an error
+    occurs; short reads are resubmitted internally.
+    Backends:
+        - io_uring (Linux 5.1+). Batches go to the kernel with a single syscall, waits block in the kernel.
+        - Thread pool. Worker threads do blocking positional reads. Used on Win32 and where io_uring is not
+          available (old kernels, containers that block the syscall).
+    capacity is the max number of requests in flight, completions included until they are polled. Submitting to a
+    full queue fails, the caller is expected to retire some completions and try again.
+*/
+typedef uint64_t fs_io_queue_h;
+typedef uint64_t fs_io_request_h;
+#define fs_io_null_request_m UINT64_MAX
+
+typedef enum {
+    fs_io_backend_auto_m,
+    fs_io_backend_uring_m,
+    fs_io_backend_thread_pool_m,
+} fs_io_backend_e;
+
+typedef struct {
+    uint32_t capacity;      // rounded up to pow2
+    uint32_t thread_count;  // only used by the thread pool backend
+    fs_io_backend_e backend;
+} fs_io_queue_params_t;
+
+#define fs_io_queue_params_m( ... ) ( fs_io_queue_params_t ) { \
+    .capacity = 256, \
+    .thread_count = 4, \
+    .backend = fs_io_backend_auto_m, \
+    ##__VA_ARGS__ \
+}
+
+typedef struct {
+    fs_file_h file;
+    uint64_t offset;
+    uint64_t size;
+    void* dest;
+    void* user_data;
+} fs_io_read_t;
+
+typedef struct {
+    fs_io_request_h request;
+    void* user_data;
+    uint64_t read_size;     // fs_read_error_m on failure
+} fs_io_completion_t;
+
 typedef struct fs_i {
     // TODO remove these, leave the _get and _get_count api only
     fs_list_h   ( *get_first_volume ) ( fs_volume_h* volume );
@@ -151,6 +208,9 @@ typedef struct fs_i {
     size_t      ( *get_dir_files ) ( char** files, size_t files_cap, size_t file_cap, const char* path );
     size_t      ( *get_dir_subdirs ) ( char** subdirs, size_t subdirs_cap, size_t subdir_cap, const char* path );
     bool        ( *get_dir_info ) ( fs_dir_info_t* info, const char* path );
+    // Lists a whole directory with type, size and last write time of every entry without opening them. Symlinks are
+    // followed, . and .. are skipped. Returns the total entry count, only the first cap entries are written.
+    size_t      ( *scan_dir ) ( fs_dir_entry_t* entries, size_t cap, const char* path );
 
     fs_file_h   ( *create_file ) ( const char* path, fs_file_access_t access, fs_already_existing_e already_existing );
     bool        ( *create_file_path ) ( const char* path, fs_file_access_t access, fs_already_existing_e already_existing );
@@ -166,15 +226,44 @@ typedef struct fs_i {
     bool        ( *unmap_file ) ( fs_file_h file, void* mapping );
     uint64_t    ( *read_file ) ( void* dest, size_t read_size, fs_file_h file );
     bool        ( *write_file ) ( fs_file_h file, const void* source, size_t write_size );
+    // Positional, the file position is not used and is left undefined. Multiple threads can read and write through the
+    // same handle at the same time. Reads stop early only on EOF.
+    uint64_t    ( *read_file_at ) ( void* dest, size_t read_size, fs_file_h file, uint64_t offset );
+    bool        ( *write_file_at ) ( fs_file_h file, const void* source, size_t write_size, uint64_t offset );
+    // Positional scatter/gather, buffers are read or written back to back starting from offset
+    uint64_t    ( *read_file_scatter ) ( const std_buffer_t* buffers, size_t count, fs_file_h file, uint64_t offset );
+    bool        ( *write_file_gather ) ( fs_file_h file, const std_buffer_t* buffers, size_t count, uint64_t offset );
     bool        ( *seek_file ) ( fs_file_h file, fs_file_point_t base, int64_t offset );
     bool        ( *get_file_info ) ( fs_file_info_t* info, fs_file_h file );
     bool        ( *get_file_path_info ) ( fs_file_info_t* info, const char* path );
     size_t      ( *get_file_path ) ( char* path, size_t cap, fs_file_h file );
 
+    // Virtual files are written through a virtual stack that reserves virtual_size bytes up front. Anything that is
+    // already on the file gets overwritten.
     fs_virtual_file_h    ( *create_virtual_file ) ( const char* path, size_t virtual_size );
     std_virtual_stack_t* ( *get_virtual_file_writer ) ( fs_virtual_file_h file );
+    // Marks the first size bytes of the writer as final. Whole pages in that range are written to disk by a background
+    // thread and then unmapped, the writer must not touch them again nor free back into them. Blocks while more than
+    // fs_virtual_file_max_pending_size_m bytes are waiting to be written.
+    bool                 ( *stream_virtual_file ) ( fs_virtual_file_h file, size_t size );
+    // Waits for the background writes and synchronously writes what's left in the writer. The file ends at the writer top.
     bool                 ( *flush_virtual_file ) ( fs_virtual_file_h file );
+    // Does not flush
     void                 ( *close_virtual_file ) ( fs_virtual_file_h file );
 
     std_buffer_t        ( *read_file_path_to_heap ) ( const char* path );
+
+    // Returns fs_null_handle_m if the requested backend is not available
+    fs_io_queue_h       ( *create_io_queue ) ( const fs_io_queue_params_t* params );
+    // Waits for all requests in flight
+    void                ( *destroy_io_queue ) ( fs_io_queue_h queue );
+    fs_io_backend_e     ( *get_io_queue_backend ) ( fs_io_queue_h queue );
+    // Returns fs_io_null_request_m if the queue is full
+    fs_io_request_h     ( *submit_read ) ( fs_io_queue_h queue, fs_file_h file, uint64_t offset, uint64_t size, void* dest, void* user_data );
+    // Returns the number of submitted reads, always a prefix of the reads array. requests can be NULL.
+    size_t              ( *submit_reads ) ( fs_io_queue_h queue, fs_io_request_h* requests, const fs_io_read_t* reads, size_t count );
+    // Never blocks
+    size_t              ( *poll_io_queue ) ( fs_io_queue_h queue, fs_io_completion_t* completions, size_t cap );
+    // Blocks until at least min_count completions are returned or no request is left in flight
+    size_t              ( *wait_io_queue ) ( fs_io_queue_h queue, fs_io_completion_t* completions, size_t cap, size_t min_count );
 } fs_i;
@@ -5,6 +5,9 @@
 #include "net_platform.h"
 #include "net_socket.h"
 #include "net_address.h"
+#include "net_poller.h"
+#include "net_buffer.h"
+#include "net_transport.h"
 
 static net_i s_api;
 
@@ -22,12 +25,35 @@ static net_i net_api ( void ) {
     net.get_socket_available_read_size = net_socket_get_available_read_size;
     net.read_connected_socket = read_connected_socket;
     net.write_connected_socket = write_connected_socket;
+    net.write_connected_socket_gather = write_connected_socket_gather;
     net.read_socket = read_socket;
     net.write_socket = write_socket;
+    net.read_socket_batch = read_socket_batch;
+    net.write_socket_batch = write_socket_batch;
 
     net.ip_string_to_bytes = net_address_ip_string_to_bytes;
     net.ip_bytes_to_string = net_address_ip_bytes_to_string;
 
+    net.acquire_buffer = net_buffer_acquire;
+    net.release_buffer = net_buffer_release;
+    net.write_connected_socket_buffer = net_buffer_write_connected_socket;
+    net.flush_connected_socket = net_buffer_flush_connected_socket;
+
+    net.create_poller = net_poller_create;
+    net.destroy_poller = net_poller_destroy;
+    net.add_poller_socket = net_poller_add_socket;
+    net.modify_poller_socket = net_poller_modify_socket;
+    net.remove_poller_socket = net_poller_remove_socket;
+    net.wait_poller = net_poller_wait;
+
+    net.create_transport = net_transport_create;
+    net.destroy_transport = net_transport_destroy;
+    net.connect_transport = net_transport_connect;
+    net.disconnect_transport = net_transport_disconnect;
+    net.send_transport_message = net_transport_send_message;
+    net.update_transport = net_transport_update;
+    net.get_transport_connection_info = net_transport_get_connection_info;
+
     return net;
 }
 
@@ -36,6 +62,9 @@ void* net_load ( void* std_runtime ) {
 
     net_platform_init();
     net_socket_init();
+    net_poller_init();
+    net_buffer_init();
+    net_transport_init();
 
     s_api = net_api();
 
@@ -43,5 +72,8 @@ void* net_load ( void* std_runtime ) {
 }
 
 void net_unload ( void ) {
+    net_transport_deinit();
+    net_poller_deinit();
+    net_buffer_deinit();
     net_platform_shutdown();
 }
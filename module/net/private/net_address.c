@@ -6,7 +6,7 @@
 bool net_address_ip_string_to_bytes ( net_address_bytes_t* bytes_address, const char* string_address, net_address_family_e family ) {
     bytes_address->u64[0] = 0;
     bytes_address->u64[1] = 0;
-    INT result = InetPton ( net_address_family_to_winsock ( family ), string_address, bytes_address->bytes );
+    int result = InetPton ( net_address_family_to_winsock ( family ), string_address, bytes_address->bytes );
 
     if ( result != 1 ) {
         return false;
@@ -0,0 +1,440 @@
+#include "net_buffer.h"
+
+#include "net_platform.h"
+
+#include <std_log.h>
+#include <std_list.h>
+#include <std_byte.h>
+#include <std_mutex.h>
+#include <std_allocator.h>
+
+#define net_buffer_bitset_u64_count_m std_div_ceil_m ( net_buffer_max_count_m, 64 )
+#define net_buffer_queue_item_m( queue, idx ) ( &( queue )->items[( idx ) % net_socket_send_queue_size_m] )
+
+typedef struct {
+    char* base;
+} net_buffer_slot_t;
+
+// Send queue of a destroyed socket with zero copy sends still in flight. The socket is kept open on a duplicate handle
+// until the kernel reports them done, only then are their buffers returned to the pool.
+typedef struct {
+    SOCKET os_handle;
+    net_socket_send_queue_t* queue;
+} net_buffer_deferred_queue_t;
+
+typedef struct {
+    // Reserved up front, a buffer is mapped the first time it's acquired and stays mapped
+    char* memory;
+    net_buffer_slot_t* slots_array;
+    net_buffer_slot_t* slots_freelist;
+    uint64_t mapped_bitset[net_buffer_bitset_u64_count_m];
+    std_mutex_t mutex;
+    // Each deferred queue holds at least one buffer
+    net_buffer_deferred_queue_t deferred_queues[net_buffer_max_count_m];
+    uint32_t deferred_queue_count;
+    std_mutex_t deferred_mutex;
+} net_buffer_state_t;
+
+static net_buffer_state_t net_buffer_state;
+
+/*
+    https://www.kernel.org/doc/html/latest/networking/msg_zerocopy.html
+*/
+
+void net_buffer_init ( void ) {
+    static net_buffer_slot_t slots_array[net_buffer_max_count_m];
+    net_buffer_state.slots_array = slots_array;
+    net_buffer_state.slots_freelist = std_static_freelist_m ( slots_array );
+    net_buffer_state.memory = std_virtual_reserve ( net_buffer_max_count_m * net_buffer_size_m );
+    std_mem_zero_m ( &net_buffer_state.mapped_bitset );
+    std_mutex_init ( &net_buffer_state.mutex );
+    net_buffer_state.deferred_queue_count = 0;
+    std_mutex_init ( &net_buffer_state.deferred_mutex );
+}
+
+void net_buffer_deinit ( void ) {
+    // The kernel keeps its own reference to the pages of in flight sends, unmapping them is fine
+    for ( uint32_t i = 0; i < net_buffer_state.deferred_queue_count; ++i ) {
+        net_buffer_deferred_queue_t* deferred = &net_buffer_state.deferred_queues[i];
+        closesocket ( deferred->os_handle );
+        std_virtual_heap_free ( deferred->queue );
+    }
+
+    std_virtual_free ( net_buffer_state.memory, net_buffer_state.memory + net_buffer_max_count_m * net_buffer_size_m );
+    std_mutex_deinit ( &net_buffer_state.mutex );
+    std_mutex_deinit ( &net_buffer_state.deferred_mutex );
+}
+
+static void net_buffer_update_deferred_queues ( void );
+
+net_buffer_t net_buffer_acquire ( void ) {
+    net_buffer_t result;
+
+    if ( net_buffer_state.deferred_queue_count > 0 ) {
+        net_buffer_update_deferred_queues();
+    }
+
+    std_mutex_lock ( &net_buffer_state.mutex );
+    net_buffer_slot_t* slot = std_list_pop_m ( &net_buffer_state.slots_freelist );
+
+    if ( slot == NULL ) {
+        std_mutex_unlock ( &net_buffer_state.mutex );
+        result.handle = net_null_handle_m;
+        result.base = NULL;
+        result.size = 0;
+        return result;
+    }
+
+    uint64_t idx = ( uint64_t ) ( slot - net_buffer_state.slots_array );
+    char* base = net_buffer_state.memory + idx * net_buffer_size_m;
+
+    if ( !std_bitset_test ( net_buffer_state.mapped_bitset, idx ) ) {
+        bool map_result = std_virtual_map ( base, base + net_buffer_size_m );
+        std_assert_m ( map_result );
+        std_bitset_set ( net_buffer_state.mapped_bitset, idx );
+    }
+
+    std_mutex_unlock ( &net_buffer_state.mutex );
+
+    slot->base = base;
+    result.handle = idx;
+    result.base = base;
+    result.size = net_buffer_size_m;
+    return result;
+}
+
+void net_buffer_release ( net_buffer_h buffer ) {
+    std_assert_m ( buffer < net_buffer_max_count_m );
+    net_buffer_slot_t* slot = &net_buffer_state.slots_array[buffer];
+
+    std_mutex_lock ( &net_buffer_state.mutex );
+    std_list_push ( &net_buffer_state.slots_freelist, slot );
+    std_mutex_unlock ( &net_buffer_state.mutex );
+}
+
+static char* net_buffer_base ( net_buffer_h buffer ) {
+    return net_buffer_state.memory + buffer * net_buffer_size_m;
+}
+
+// --
+
+static net_socket_send_queue_t* net_buffer_create_send_queue ( net_socket_t* sock ) {
+    net_socket_send_queue_t* queue = std_virtual_heap_alloc_struct_m ( net_socket_send_queue_t );
+    std_mem_zero_m ( queue );
+
+#if defined(std_platform_linux_m)
+    // Fails on kernels older than 4.14, everything then goes out copied
+    int value = 1;
+    queue->zerocopy_enabled = setsockopt ( sock->os_handle, SOL_SOCKET, SO_ZEROCOPY, &value, sizeof ( value ) ) == 0;
+#endif
+
+    sock->send_queue = queue;
+    return queue;
+}
+
+#if defined(std_platform_linux_m)
+// Zero copy completions come back on the socket error queue
+static void net_buffer_read_completions ( SOCKET os_handle, net_socket_send_queue_t* queue ) {
+    for ( ;; ) {
+        union {
+            char buffer[CMSG_SPACE ( sizeof ( struct sock_extended_err ) )];
+            struct cmsghdr align;
+        } control;
+
+        struct msghdr header;
+        std_mem_zero_m ( &header );
+        header.msg_control = control.buffer;
+        header.msg_controllen = sizeof ( control.buffer );
+
+        if ( recvmsg ( os_handle, &header, MSG_ERRQUEUE | MSG_DONTWAIT ) == -1 ) {
+            break;
+        }
+
+        for ( struct cmsghdr* cmsg = CMSG_FIRSTHDR ( &header ); cmsg != NULL; cmsg = CMSG_NXTHDR ( &header, cmsg ) ) {
+            bool is_ip4_error = cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR;
+            bool is_ip6_error = cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR;
+
+            if ( !is_ip4_error && !is_ip6_error ) {
+                continue;
+            }
+
+            struct sock_extended_err error;
+            std_mem_copy ( &error, CMSG_DATA ( cmsg ), sizeof ( error ) );
+
+            // ee_info to ee_data is the inclusive range of completed send ids. TCP completes them in order.
+            if ( error.ee_origin == SO_EE_ORIGIN_ZEROCOPY && error.ee_errno == 0 ) {
+                queue->zerocopy_done_id = error.ee_data + 1;
+            }
+        }
+    }
+}
+#endif
+
+// Everything between head and send is fully sent, it only has to wait on zero copy completions
+static void net_buffer_release_sent ( net_socket_send_queue_t* queue ) {
+    while ( queue->head != queue->send ) {
+        net_socket_send_t* item = net_buffer_queue_item_m ( queue, queue->head );
+
+        if ( item->zerocopy && ( int32_t ) ( queue->zerocopy_done_id - item->zerocopy_id ) <= 0 ) {
+            break;
+        }
+
+        net_buffer_release ( item->buffer );
+        queue->head += 1;
+    }
+}
+
+void net_buffer_free_send_queue ( net_socket_t* sock ) {
+    net_socket_send_queue_t* queue = sock->send_queue;
+    sock->send_queue = NULL;
+
+    // Buffers the kernel never saw can go right away. The first unsent one might have been partially sent, that one is
+    // kept with the sent ones.
+    uint32_t end = queue->send;
+
+    if ( end != queue->tail && net_buffer_queue_item_m ( queue, end )->sent_size > 0 ) {
+        end += 1;
+    }
+
+    for ( uint32_t i = end; i != queue->tail; ++i ) {
+        net_buffer_release ( net_buffer_queue_item_m ( queue, i )->buffer );
+    }
+
+    queue->send = end;
+    queue->tail = end;
+
+#if defined(std_platform_linux_m)
+    if ( queue->head != queue->send ) {
+        net_buffer_read_completions ( sock->os_handle, queue );
+    }
+#endif
+
+    net_buffer_release_sent ( queue );
+
+    if ( queue->head == queue->send ) {
+        std_virtual_heap_free ( queue );
+        return;
+    }
+
+#if defined(std_platform_linux_m)
+    // Zero copy sends are still reading from some of the buffers and closing the socket won't stop the kernel from
+    // sending them. Their completions can only be read while the socket is open, so a duplicate handle keeps it open.
+    // Shutting down the write side still sends the peer a FIN once the queued data is out, same as closing would.
+    SOCKET os_handle = dup ( sock->os_handle );
+
+    if ( os_handle == INVALID_SOCKET ) {
+        // Can't tell when the kernel will be done with them, the buffers are leaked rather than reused too early
+        std_log_warn_m ( "Leaking " std_fmt_u32_m " socket buffers with zero copy sends in flight", queue->send - queue->head );
+        std_virtual_heap_free ( queue );
+        return;
+    }
+
+    shutdown ( os_handle, SHUT_WR );
+
+    std_mutex_lock ( &net_buffer_state.deferred_mutex );
+    std_assert_m ( net_buffer_state.deferred_queue_count < net_buffer_max_count_m );
+    net_buffer_deferred_queue_t* deferred = &net_buffer_state.deferred_queues[net_buffer_state.deferred_queue_count++];
+    deferred->os_handle = os_handle;
+    deferred->queue = queue;
+    std_mutex_unlock ( &net_buffer_state.deferred_mutex );
+#endif
+}
+
+// Releases the buffers of destroyed sockets whose zero copy sends have completed since the last update
+static void net_buffer_update_deferred_queues ( void ) {
+#if defined(std_platform_linux_m)
+    std_mutex_lock ( &net_buffer_state.deferred_mutex );
+    uint32_t i = 0;
+
+    while ( i < net_buffer_state.deferred_queue_count ) {
+        net_buffer_deferred_queue_t* deferred = &net_buffer_state.deferred_queues[i];
+        net_buffer_read_completions ( deferred->os_handle, deferred->queue );
+        net_buffer_release_sent ( deferred->queue );
+
+        if ( deferred->queue->head != deferred->queue->send ) {
+            ++i;
+            continue;
+        }
+
+        closesocket ( deferred->os_handle );
+        std_virtual_heap_free ( deferred->queue );
+        *deferred = net_buffer_state.deferred_queues[--net_buffer_state.deferred_queue_count];
+    }
+
+    std_mutex_unlock ( &net_buffer_state.deferred_mutex );
+#endif
+}
+
+// Sends as much of the queue as the socket takes, blocking sockets send all of it
+static void net_buffer_send ( net_socket_t* sock ) {
+    net_socket_send_queue_t* queue = sock->send_queue;
+
+    while ( queue->send != queue->tail ) {
+        size_t total_size = 0;
+        uint32_t buffer_count = 0;
+
+#if defined(std_platform_win32_m)
+        WSABUF wsa_buffers[net_socket_iovec_batch_size_m];
+
+        for ( uint32_t i = queue->send; i != queue->tail && buffer_count < net_socket_iovec_batch_size_m; ++i ) {
+            net_socket_send_t* item = net_buffer_queue_item_m ( queue, i );
+            wsa_buffers[buffer_count].buf = net_buffer_base ( item->buffer ) + item->sent_size;
+            wsa_buffers[buffer_count].len = item->size - item->sent_size;
+            total_size += item->size - item->sent_size;
+            ++buffer_count;
+        }
+
+        bool zerocopy = false;
+        DWORD wsa_write_size;
+        int error = WSASend ( sock->os_handle, wsa_buffers, buffer_count, &wsa_write_size, 0, NULL, NULL );
+
+        if ( error == SOCKET_ERROR ) {
+            return;
+        }
+
+        size_t write_size = wsa_write_size;
+#elif defined(std_platform_linux_m)
+        struct iovec iovs[net_socket_iovec_batch_size_m];
+
+        for ( uint32_t i = queue->send; i != queue->tail && buffer_count < net_socket_iovec_batch_size_m; ++i ) {
+            net_socket_send_t* item = net_buffer_queue_item_m ( queue, i );
+            iovs[buffer_count].iov_base = net_buffer_base ( item->buffer ) + item->sent_size;
+            iovs[buffer_count].iov_len = item->size - item->sent_size;
+            total_size += item->size - item->sent_size;
+            ++buffer_count;
+        }
+
+        struct msghdr header;
+        std_mem_zero_m ( &header );
+        header.msg_iov = iovs;
+        header.msg_iovlen = buffer_count;
+
+        bool zerocopy = queue->zerocopy_enabled && total_size >= net_socket_zerocopy_min_size_m;
+        ssize_t result = sendmsg ( sock->os_handle, &header, MSG_NOSIGNAL | ( zerocopy ? MSG_ZEROCOPY : 0 ) );
+
+        if ( result == -1 && zerocopy && errno == ENOBUFS ) {
+            // Over the socket budget of pinned memory, this one goes out copied
+            zerocopy = false;
+            result = sendmsg ( sock->os_handle, &header, MSG_NOSIGNAL );
+        }
+
+        // Would block or a connection error, the latter shows up on the next reads
+        if ( result == -1 ) {
+            return;
+        }
+
+        size_t write_size = ( size_t ) result;
+#endif
+
+        uint32_t zerocopy_id = zerocopy ? queue->zerocopy_next_id++ : 0;
+        size_t remaining_size = write_size;
+
+        while ( remaining_size > 0 ) {
+            net_socket_send_t* item = net_buffer_queue_item_m ( queue, queue->send );
+            size_t size = std_min_u64 ( remaining_size, item->size - item->sent_size );
+            item->sent_size += ( uint32_t ) size;
+            remaining_size -= size;
+
+            if ( zerocopy ) {
+                item->zerocopy = true;
+                item->zerocopy_id = zerocopy_id;
+            }
+
+            if ( item->sent_size == item->size ) {
+                queue->send += 1;
+            }
+        }
+
+        if ( write_size < total_size && !sock->params.is_blocking ) {
+            return;
+        }
+    }
+}
+
+bool net_buffer_write_connected_socket ( net_socket_h socket_handle, net_buffer_h buffer, size_t size ) {
+    net_socket_t* sock = net_socket_get ( socket_handle );
+    std_assert_m ( sock->state == net_socket_state_connected_m );
+    std_assert_m ( size <= net_buffer_size_m );
+
+    if ( size == 0 ) {
+        net_buffer_release ( buffer );
+        return true;
+    }
+
+    net_socket_send_queue_t* queue = sock->send_queue;
+
+    if ( queue == NULL ) {
+        queue = net_buffer_create_send_queue ( sock );
+    }
+
+#if defined(std_platform_linux_m)
+    if ( queue->head != queue->send ) {
+        net_buffer_read_completions ( sock->os_handle, queue );
+    }
+#endif
+
+    net_buffer_release_sent ( queue );
+
+    if ( queue->tail - queue->head == net_socket_send_queue_size_m ) {
+        if ( !sock->params.is_blocking ) {
+            return false;
+        }
+
+#if defined(std_platform_linux_m)
+        // Blocking sockets have everything sent already, wait for the kernel to be done with the oldest buffer.
+        // Completions wake poll as an error.
+        while ( queue->tail - queue->head == net_socket_send_queue_size_m ) {
+            struct pollfd poll_fd;
+            poll_fd.fd = sock->os_handle;
+            poll_fd.events = 0;
+            poll_fd.revents = 0;
+            poll ( &poll_fd, 1, -1 );
+
+            net_buffer_read_completions ( sock->os_handle, queue );
+            net_buffer_release_sent ( queue );
+
+            if ( poll_fd.revents & ( POLLHUP | POLLNVAL ) && queue->tail - queue->head == net_socket_send_queue_size_m ) {
+                return false;
+            }
+        }
+#endif
+    }
+
+    net_socket_send_t* item = net_buffer_queue_item_m ( queue, queue->tail );
+    item->buffer = buffer;
+    item->size = ( uint32_t ) size;
+    item->sent_size = 0;
+    item->zerocopy = false;
+    queue->tail += 1;
+
+    net_buffer_send ( sock );
+    net_buffer_release_sent ( queue );
+    return true;
+}
+
+size_t net_buffer_flush_connected_socket ( net_socket_h socket_handle ) {
+    net_socket_t* sock = net_socket_get ( socket_handle );
+    net_socket_send_queue_t* queue = sock->send_queue;
+
+    if ( queue == NULL ) {
+        return 0;
+    }
+
+#if defined(std_platform_linux_m)
+    if ( queue->head != queue->send ) {
+        net_buffer_read_completions ( sock->os_handle, queue );
+    }
+#endif
+
+    net_buffer_send ( sock );
+    net_buffer_release_sent ( queue );
+
+    size_t queued_size = 0;
+
+    for ( uint32_t i = queue->send; i != queue->tail; ++i ) {
+        net_socket_send_t* item = net_buffer_queue_item_m ( queue, i );
+        queued_size += item->size - item->sent_size;
+    }
+
+    return queued_size;
+}
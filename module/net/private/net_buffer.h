@@ -0,0 +1,18 @@
+#pragma once
+
+#include <net.h>
+
+#include "net_socket.h"
+
+void net_buffer_init ( void );
+void net_buffer_deinit ( void );
+
+net_buffer_t net_buffer_acquire ( void );
+void net_buffer_release ( net_buffer_h buffer );
+
+bool net_buffer_write_connected_socket ( net_socket_h socket, net_buffer_h buffer, size_t size );
+size_t net_buffer_flush_connected_socket ( net_socket_h socket );
+
+// Releases whatever is still queued on the socket. Buffers zero copy sends are still reading from are released later,
+// once the kernel is done with them.
+void net_buffer_free_send_queue ( net_socket_t* socket );
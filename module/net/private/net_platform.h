@@ -2,8 +2,59 @@
 
 #include <net.h>
 
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#if defined(std_platform_win32_m)
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#elif defined(std_platform_linux_m)
+    #include <sys/socket.h>
+    #include <sys/ioctl.h>
+    #include <sys/epoll.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <netinet/udp.h>
+    #include <linux/errqueue.h>
+    #include <poll.h>
+    #include <arpa/inet.h>
+
+    // BSD sockets are close enough to WinSock that the rest of the module keeps using the WinSock names
+    typedef int SOCKET;
+    typedef struct sockaddr SOCKADDR;
+    typedef struct sockaddr_storage SOCKADDR_STORAGE;
+    typedef sa_family_t ADDRESS_FAMILY;
+
+    #define INVALID_SOCKET ( -1 )
+    #define SOCKET_ERROR ( -1 )
+
+    #define closesocket close
+    #define InetPton inet_pton
+    #define InetNtop inet_ntop
+
+    // Older libc headers miss some of the newer socket options
+    #if !defined(UDP_SEGMENT)
+        #define UDP_SEGMENT 103
+    #endif
+    #if !defined(UDP_GRO)
+        #define UDP_GRO 104
+    #endif
+    #if !defined(SO_ZEROCOPY)
+        #define SO_ZEROCOPY 60
+    #endif
+    #if !defined(MSG_ZEROCOPY)
+        #define MSG_ZEROCOPY 0x4000000
+    #endif
+#endif
+
+#if defined(std_platform_win32_m)
+    // WinSock never raises signals on writes to closed connections
+    #define MSG_NOSIGNAL 0
+#endif
 
 void net_platform_init ( void );
 void net_platform_shutdown ( void );
+
+// True if the last socket call failed only because it would have blocked
+bool net_platform_would_block ( void );
+// True if the last connect on a non blocking socket failed only because the connection is still being established
+bool net_platform_connect_in_progress ( void );
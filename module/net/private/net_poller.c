@@ -0,0 +1,330 @@
+#include "net_poller.h"
+
+#include "net_socket.h"
+
+#include <std_log.h>
+#include <std_list.h>
+#include <std_byte.h>
+#include <std_allocator.h>
+#include <std_atomic.h>
+
+#define net_poller_bitset_u64_count_m std_div_ceil_m ( net_poller_max_pollers_m, 64 )
+
+typedef struct {
+    net_poller_t* pollers_array;
+    net_poller_t* pollers_freelist;
+    uint64_t pollers_bitset[net_poller_bitset_u64_count_m];
+    std_mutex_t pollers_mutex;
+} net_poller_state_t;
+
+static net_poller_state_t net_poller_state;
+
+/*
+    https://man7.org/linux/man-pages/man7/epoll.7.html
+    https://docs.microsoft.com/en-us/windows/win32/api/winsock2/nf-winsock2-wsapoll
+*/
+
+#if defined(std_platform_linux_m)
+static uint32_t net_poller_events_to_epoll ( net_poll_events_b events ) {
+    uint32_t result = EPOLLET;
+
+    if ( events & net_poll_read_m ) {
+        result |= EPOLLIN | EPOLLRDHUP;
+    }
+
+    if ( events & net_poll_write_m ) {
+        result |= EPOLLOUT;
+    }
+
+    return result;
+}
+
+static net_poll_events_b net_poller_events_from_epoll ( uint32_t events ) {
+    net_poll_events_b result = 0;
+    result |= events & EPOLLIN ? net_poll_read_m : 0;
+    result |= events & EPOLLOUT ? net_poll_write_m : 0;
+    result |= events & EPOLLERR ? net_poll_error_m : 0;
+    result |= events & ( EPOLLHUP | EPOLLRDHUP ) ? net_poll_hangup_m : 0;
+    return result;
+}
+#elif defined(std_platform_win32_m)
+static SHORT net_poller_events_to_wsapoll ( net_poll_events_b events ) {
+    SHORT result = 0;
+
+    if ( events & net_poll_read_m ) {
+        result |= POLLRDNORM;
+    }
+
+    if ( events & net_poll_write_m ) {
+        result |= POLLWRNORM;
+    }
+
+    return result;
+}
+
+static net_poll_events_b net_poller_events_from_wsapoll ( SHORT events ) {
+    net_poll_events_b result = 0;
+    result |= events & POLLRDNORM ? net_poll_read_m : 0;
+    result |= events & POLLWRNORM ? net_poll_write_m : 0;
+    result |= events & ( POLLERR | POLLNVAL ) ? net_poll_error_m : 0;
+    result |= events & POLLHUP ? net_poll_hangup_m : 0;
+    return result;
+}
+#endif
+
+// --
+
+void net_poller_init ( void ) {
+    static net_poller_t pollers_array[net_poller_max_pollers_m];
+    net_poller_state.pollers_array = pollers_array;
+    net_poller_state.pollers_freelist = std_static_freelist_m ( pollers_array );
+    std_mem_zero_m ( &net_poller_state.pollers_bitset );
+    std_mutex_init ( &net_poller_state.pollers_mutex );
+}
+
+void net_poller_deinit ( void ) {
+    uint64_t idx = 0;
+
+    while ( std_bitset_scan ( &idx, net_poller_state.pollers_bitset, idx, net_poller_bitset_u64_count_m ) ) {
+        net_poller_destroy ( idx );
+        ++idx;
+    }
+
+    std_mutex_deinit ( &net_poller_state.pollers_mutex );
+}
+
+net_poller_h net_poller_create ( void ) {
+#if defined(std_platform_linux_m)
+    int epoll_fd = epoll_create1 ( EPOLL_CLOEXEC );
+
+    if ( epoll_fd == -1 ) {
+        std_log_os_error_m();
+        return net_null_handle_m;
+    }
+
+#endif
+
+    std_mutex_lock ( &net_poller_state.pollers_mutex );
+    net_poller_t* poller = std_list_pop_m ( &net_poller_state.pollers_freelist );
+
+    if ( poller == NULL ) {
+        std_mutex_unlock ( &net_poller_state.pollers_mutex );
+        std_log_error_m ( "Max poller count reached." );
+#if defined(std_platform_linux_m)
+        close ( epoll_fd );
+#endif
+        return net_null_handle_m;
+    }
+
+    uint64_t poller_idx = ( uint64_t ) ( poller - net_poller_state.pollers_array );
+    std_bitset_set ( net_poller_state.pollers_bitset, poller_idx );
+    std_mutex_unlock ( &net_poller_state.pollers_mutex );
+
+#if defined(std_platform_linux_m)
+    poller->epoll_fd = epoll_fd;
+    poller->count = 0;
+#elif defined(std_platform_win32_m)
+    // Sized for the worst case up front, it's only reserved address space until sockets get added
+    poller->fds = std_virtual_heap_alloc_array_m ( WSAPOLLFD, net_socket_max_sockets_m );
+    poller->sockets = std_virtual_heap_alloc_array_m ( net_socket_h, net_socket_max_sockets_m );
+    poller->count = 0;
+    std_mutex_init ( &poller->mutex );
+#endif
+
+    return ( net_poller_h ) poller_idx;
+}
+
+void net_poller_destroy ( net_poller_h poller_handle ) {
+    net_poller_t* poller = &net_poller_state.pollers_array[poller_handle];
+
+    // Sockets only hold the handle of their poller, clear it on the ones that are still in this one
+    for ( uint64_t i = 0; i < net_socket_max_sockets_m && poller->count > 0; ++i ) {
+        net_socket_t* sock = net_socket_get ( i );
+
+        if ( sock->poller == poller_handle ) {
+            sock->poller = net_null_handle_m;
+            --poller->count;
+        }
+    }
+
+#if defined(std_platform_linux_m)
+    close ( poller->epoll_fd );
+#elif defined(std_platform_win32_m)
+    std_virtual_heap_free ( poller->fds );
+    std_virtual_heap_free ( poller->sockets );
+    std_mutex_deinit ( &poller->mutex );
+#endif
+
+    std_mutex_lock ( &net_poller_state.pollers_mutex );
+    std_bitset_clear ( net_poller_state.pollers_bitset, poller_handle );
+    std_list_push ( &net_poller_state.pollers_freelist, poller );
+    std_mutex_unlock ( &net_poller_state.pollers_mutex );
+}
+
+bool net_poller_add_socket ( net_poller_h poller_handle, net_socket_h socket_handle, net_poll_events_b events, void* user_data ) {
+    net_poller_t* poller = &net_poller_state.pollers_array[poller_handle];
+    net_socket_t* sock = net_socket_get ( socket_handle );
+    std_assert_m ( sock->poller == net_null_handle_m );
+
+    // Set before adding, the socket can be reported as ready as soon as it's in
+    sock->poll_user_data = user_data;
+
+#if defined(std_platform_linux_m)
+    struct epoll_event event;
+    event.events = net_poller_events_to_epoll ( events );
+    event.data.u64 = socket_handle;
+
+    if ( epoll_ctl ( poller->epoll_fd, EPOLL_CTL_ADD, sock->os_handle, &event ) != 0 ) {
+        std_log_os_error_m();
+        return false;
+    }
+
+    std_atomic_increment_u32 ( &poller->count );
+#elif defined(std_platform_win32_m)
+    std_mutex_lock ( &poller->mutex );
+    uint32_t idx = poller->count++;
+    poller->fds[idx].fd = sock->os_handle;
+    poller->fds[idx].events = net_poller_events_to_wsapoll ( events );
+    poller->fds[idx].revents = 0;
+    poller->sockets[idx] = socket_handle;
+    sock->poll_idx = idx;
+    std_mutex_unlock ( &poller->mutex );
+#endif
+
+    sock->poller = poller_handle;
+    return true;
+}
+
+bool net_poller_modify_socket ( net_poller_h poller_handle, net_socket_h socket_handle, net_poll_events_b events, void* user_data ) {
+    net_poller_t* poller = &net_poller_state.pollers_array[poller_handle];
+    net_socket_t* sock = net_socket_get ( socket_handle );
+    std_assert_m ( sock->poller == poller_handle );
+
+    sock->poll_user_data = user_data;
+
+#if defined(std_platform_linux_m)
+    struct epoll_event event;
+    event.events = net_poller_events_to_epoll ( events );
+    event.data.u64 = socket_handle;
+
+    if ( epoll_ctl ( poller->epoll_fd, EPOLL_CTL_MOD, sock->os_handle, &event ) != 0 ) {
+        std_log_os_error_m();
+        return false;
+    }
+
+#elif defined(std_platform_win32_m)
+    std_mutex_lock ( &poller->mutex );
+    poller->fds[sock->poll_idx].events = net_poller_events_to_wsapoll ( events );
+    std_mutex_unlock ( &poller->mutex );
+#endif
+
+    return true;
+}
+
+bool net_poller_remove_socket ( net_poller_h poller_handle, net_socket_h socket_handle ) {
+    net_poller_t* poller = &net_poller_state.pollers_array[poller_handle];
+    net_socket_t* sock = net_socket_get ( socket_handle );
+
+    if ( sock->poller != poller_handle ) {
+        return false;
+    }
+
+#if defined(std_platform_linux_m)
+    // Kernels before 2.6.9 require a non null event even on delete
+    struct epoll_event event;
+    std_mem_zero_m ( &event );
+
+    if ( epoll_ctl ( poller->epoll_fd, EPOLL_CTL_DEL, sock->os_handle, &event ) != 0 ) {
+        std_log_os_error_m();
+        return false;
+    }
+
+    std_atomic_decrement_u32 ( &poller->count );
+
+#elif defined(std_platform_win32_m)
+    std_mutex_lock ( &poller->mutex );
+    uint32_t idx = sock->poll_idx;
+    uint32_t last = --poller->count;
+
+    if ( idx != last ) {
+        poller->fds[idx] = poller->fds[last];
+        poller->sockets[idx] = poller->sockets[last];
+        net_socket_get ( poller->sockets[idx] )->poll_idx = idx;
+    }
+
+    std_mutex_unlock ( &poller->mutex );
+#endif
+
+    sock->poller = net_null_handle_m;
+    return true;
+}
+
+size_t net_poller_wait ( net_poll_event_t* events, size_t cap, net_poller_h poller_handle, uint64_t timeout_ms ) {
+    net_poller_t* poller = &net_poller_state.pollers_array[poller_handle];
+    int timeout = timeout_ms == net_poller_wait_infinite_m ? -1 : ( int ) std_min_u64 ( timeout_ms, INT32_MAX );
+
+#if defined(std_platform_linux_m)
+    struct epoll_event epoll_events[net_poller_wait_batch_size_m];
+    int max_count = ( int ) std_min_u64 ( cap, net_poller_wait_batch_size_m );
+    int count = epoll_wait ( poller->epoll_fd, epoll_events, max_count, timeout );
+
+    if ( count < 0 ) {
+        // Interrupted by a signal, report it as a timeout
+        return 0;
+    }
+
+    for ( int i = 0; i < count; ++i ) {
+        net_socket_h socket_handle = epoll_events[i].data.u64;
+        net_socket_t* sock = net_socket_get ( socket_handle );
+        net_poll_events_b socket_events = net_poller_events_from_epoll ( epoll_events[i].events );
+
+        // Zero copy completions are queued as socket errors, all they mean is that queued buffers can be released
+        if ( ( socket_events & net_poll_error_m ) && sock->send_queue != NULL && sock->send_queue->zerocopy_enabled ) {
+            int error = 0;
+            socklen_t error_size = sizeof ( error );
+            getsockopt ( sock->os_handle, SOL_SOCKET, SO_ERROR, &error, &error_size );
+
+            if ( error == 0 ) {
+                socket_events = ( socket_events & ~net_poll_error_m ) | net_poll_write_m;
+            }
+        }
+
+        events[i].socket = socket_handle;
+        events[i].events = socket_events;
+        events[i].user_data = sock->poll_user_data;
+    }
+
+    return ( size_t ) count;
+#elif defined(std_platform_win32_m)
+    // WSAPoll writes back into the array it's given, poll a private copy so that other threads can keep adding and
+    // removing sockets while this one waits
+    std_mutex_lock ( &poller->mutex );
+    uint32_t fds_count = poller->count;
+    WSAPOLLFD* fds = std_virtual_heap_alloc_array_m ( WSAPOLLFD, fds_count + 1 );
+    net_socket_h* sockets = std_virtual_heap_alloc_array_m ( net_socket_h, fds_count + 1 );
+    std_mem_copy_array_m ( fds, poller->fds, fds_count );
+    std_mem_copy_array_m ( sockets, poller->sockets, fds_count );
+    std_mutex_unlock ( &poller->mutex );
+
+    size_t count = 0;
+    int ready_count = fds_count > 0 ? WSAPoll ( fds, fds_count, timeout ) : 0;
+
+    for ( uint32_t i = 0; i < fds_count && ready_count > 0 && count < cap; ++i ) {
+        if ( fds[i].revents == 0 ) {
+            continue;
+        }
+
+        net_socket_h socket_handle = sockets[i];
+        events[count].socket = socket_handle;
+        events[count].events = net_poller_events_from_wsapoll ( fds[i].revents );
+        events[count].user_data = net_socket_get ( socket_handle )->poll_user_data;
+        ++count;
+        --ready_count;
+    }
+
+    std_virtual_heap_free ( fds );
+    std_virtual_heap_free ( sockets );
+
+    return count;
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <net.h>
+
+#include <std_mutex.h>
+
+#include "net_platform.h"
+
+typedef struct {
+#if defined(std_platform_linux_m)
+    int epoll_fd;
+    uint32_t count;
+#elif defined(std_platform_win32_m)
+    // WSAPoll takes a flat array, sockets are swap removed from it using their poll_idx
+    WSAPOLLFD* fds;
+    net_socket_h* sockets;
+    uint32_t count;
+    std_mutex_t mutex;
+#endif
+} net_poller_t;
+
+void net_poller_init ( void );
+void net_poller_deinit ( void );
+
+net_poller_h net_poller_create ( void );
+void net_poller_destroy ( net_poller_h poller );
+
+bool net_poller_add_socket ( net_poller_h poller, net_socket_h socket, net_poll_events_b events, void* user_data );
+bool net_poller_modify_socket ( net_poller_h poller, net_socket_h socket, net_poll_events_b events, void* user_data );
+bool net_poller_remove_socket ( net_poller_h poller, net_socket_h socket );
+
+size_t net_poller_wait ( net_poll_event_t* events, size_t cap, net_poller_h poller, uint64_t timeout_ms );
@@ -2,26 +2,13 @@
 
 #include "net_platform.h"
 #include "net_address.h"
+#include "net_poller.h"
+#include "net_buffer.h"
 
 #include <std_log.h>
 #include <std_list.h>
 #include <std_mutex.h>
-
-typedef enum {
-    net_socket_state_invalid_m,
-    net_socket_state_unbound_m,
-    net_socket_state_bound_m,
-    net_socket_state_listening_m,
-    net_socket_state_connected_m,
-} net_socket_state_e;
-
-typedef struct {
-    net_socket_params_t params;
-    net_socket_address_t address;
-    //char address_string[net_address_string_size_m];
-    SOCKET os_handle;
-    net_socket_state_e state;
-} net_socket_t;
+#include <std_allocator.h>
 
 typedef struct {
     net_socket_t* sockets_array;
@@ -45,7 +32,7 @@ static void net_socket_address_ip4_to_winsock ( struct sockaddr_in* sockaddr, co
 static void net_socket_address_ip6_to_winsock ( struct sockaddr_in6* sockaddr, const net_socket_address_t* address ) {
     sockaddr->sin6_family = AF_INET6;
     sockaddr->sin6_port = htons ( address->port );
-    std_mem_copy ( sockaddr->sin6_addr.u.Byte, address->ip.bytes, 16 );
+    std_mem_copy ( &sockaddr->sin6_addr, address->ip.bytes, 16 );
     sockaddr->sin6_flowinfo = 0;
     sockaddr->sin6_scope_id = 0; // TODO https://stackoverflow.com/questions/58600024/what-is-sin6-scope-id-for-the-ipv6-loopback-address
 }
@@ -57,11 +44,40 @@ static void net_socket_address_ip4_from_winsock ( net_socket_address_t* address,
 }
 
 static void net_socket_address_ip6_from_winsock ( net_socket_address_t* address, const struct sockaddr_in6* sockaddr ) {
-    std_mem_copy ( address->ip.bytes, sockaddr->sin6_addr.u.Byte, 16 );
+    std_mem_copy ( address->ip.bytes, &sockaddr->sin6_addr, 16 );
     address->port = ntohs ( sockaddr->sin6_port );
     std_assert_m ( sockaddr->sin6_family == AF_INET6 );
 }
 
+static socklen_t net_socket_address_to_winsock ( SOCKADDR_STORAGE* sockaddr, const net_socket_address_t* address, net_address_family_e family ) {
+    switch ( family ) {
+        case net_address_family_ip4_m:
+            net_socket_address_ip4_to_winsock ( ( struct sockaddr_in* ) sockaddr, address );
+            return sizeof ( struct sockaddr_in );
+
+        case net_address_family_ip6_m:
+            net_socket_address_ip6_to_winsock ( ( struct sockaddr_in6* ) sockaddr, address );
+            return sizeof ( struct sockaddr_in6 );
+
+        default:
+            return 0;
+    }
+}
+
+static void net_socket_address_from_winsock ( net_socket_address_t* address, const SOCKADDR_STORAGE* sockaddr ) {
+    std_mem_zero_m ( address );
+
+    switch ( net_address_family_from_winsock ( sockaddr->ss_family ) ) {
+        case net_address_family_ip4_m:
+            net_socket_address_ip4_from_winsock ( address, ( const struct sockaddr_in* ) sockaddr );
+            break;
+
+        case net_address_family_ip6_m:
+            net_socket_address_ip6_from_winsock ( address, ( const struct sockaddr_in6* ) sockaddr );
+            break;
+    }
+}
+
 // --
 
 void net_socket_init ( void ) {
@@ -71,6 +87,39 @@ void net_socket_init ( void ) {
     std_mutex_init ( &net_socket_state.sockets_mutex );
 }
 
+net_socket_t* net_socket_get ( net_socket_h socket_handle ) {
+    std_assert_m ( socket_handle < net_socket_max_sockets_m );
+    return &net_socket_state.sockets_array[socket_handle];
+}
+
+static bool net_socket_set_blocking ( SOCKET os_handle, bool is_blocking ) {
+#if defined(std_platform_win32_m)
+    u_long mode = is_blocking ? 0 : 1;
+    return ioctlsocket ( os_handle, ( long ) FIONBIO, &mode ) == 0;
+#elif defined(std_platform_linux_m)
+    int flags = fcntl ( os_handle, F_GETFL, 0 );
+    flags = is_blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK;
+    return flags != -1 && fcntl ( os_handle, F_SETFL, flags ) == 0;
+#endif
+}
+
+// Connections are many small writes, don't wait to coalesce them
+static void net_socket_set_no_delay ( SOCKET os_handle ) {
+    int value = 1;
+    setsockopt ( os_handle, IPPROTO_TCP, TCP_NODELAY, ( const char* ) &value, sizeof ( value ) );
+}
+
+// Lets a listener bind again to a port that still has connections in TIME_WAIT. WinSock allows that by default, and
+// SO_REUSEADDR there means something else, letting another socket steal the port.
+static void net_socket_set_reuse_address ( SOCKET os_handle ) {
+#if defined(std_platform_linux_m)
+    int value = 1;
+    setsockopt ( os_handle, SOL_SOCKET, SO_REUSEADDR, &value, sizeof ( value ) );
+#else
+    std_unused_m ( os_handle );
+#endif
+}
+
 net_socket_h net_socket_create ( const net_socket_params_t* params ) {
     int af = -1;
     int type = -1;
@@ -101,22 +150,43 @@ net_socket_h net_socket_create ( const net_socket_params_t* params ) {
     std_assert_m ( af != -1 && type != -1 && protocol != -1 );
 
     SOCKET win32_socket = socket ( af, type, protocol );
-    std_assert_m ( win32_socket != INVALID_SOCKET );
+
+    if ( win32_socket == INVALID_SOCKET ) {
+        std_log_os_error_m();
+        return net_null_handle_m;
+    }
 
     std_mutex_lock ( &net_socket_state.sockets_mutex );
     net_socket_t* sock = std_list_pop_m ( &net_socket_state.sockets_freelist );
     std_mutex_unlock ( &net_socket_state.sockets_mutex );
 
+    if ( sock == NULL ) {
+        std_log_error_m ( "Max socket count reached." );
+        closesocket ( win32_socket );
+        return net_null_handle_m;
+    }
+
     sock->params = *params;
     sock->os_handle = win32_socket;
     sock->state = net_socket_state_unbound_m;
+    sock->poller = net_null_handle_m;
+    sock->send_queue = NULL;
+#if defined(std_platform_linux_m)
+    sock->gso = true;
+    sock->gro = NULL;
+    sock->gro_tested = false;
+#endif
     std_mem_zero_m ( &sock->address );
     //std_mem_zero_m ( &sock->address_string );
 
     if ( !params->is_blocking ) {
-        u_long mode = 1;
-        int error = ioctlsocket ( win32_socket, ( long ) FIONBIO, &mode );
-        std_assert_m ( !error );
+        bool result = net_socket_set_blocking ( win32_socket, false );
+        std_assert_m ( result );
+    }
+
+    if ( params->protocol == net_ip_protocol_tcp_m ) {
+        net_socket_set_no_delay ( win32_socket );
+        net_socket_set_reuse_address ( win32_socket );
     }
 
     return ( net_socket_h ) ( sock - net_socket_state.sockets_array );
@@ -131,6 +201,22 @@ bool net_socket_destroy ( net_socket_h socket_handle ) {
         return false;
     }
 
+    if ( sock->poller != net_null_handle_m ) {
+        net_poller_remove_socket ( sock->poller, socket_handle );
+    }
+
+    if ( sock->send_queue != NULL ) {
+        net_buffer_free_send_queue ( sock );
+    }
+
+#if defined(std_platform_linux_m)
+    if ( sock->gro != NULL ) {
+        std_virtual_heap_free ( sock->gro->buffer );
+        std_virtual_heap_free ( sock->gro );
+        sock->gro = NULL;
+    }
+#endif
+
     int error = closesocket ( sock->os_handle );
 
     if ( error == 0 ) {
@@ -202,7 +288,7 @@ bool net_socket_connect ( net_socket_h socket_handle, const net_socket_address_t
         break;
     }
 
-    if ( error ) {
+    if ( error && ( sock->params.is_blocking || !net_platform_connect_in_progress() ) ) {
         return false;
     }
 
@@ -236,11 +322,16 @@ net_socket_h net_socket_accept_pending_connection ( net_socket_address_t* addres
 
     std_mem_zero_m ( address );
     SOCKADDR_STORAGE sockaddr;
-    int sockaddr_size = sizeof ( sockaddr );
+    socklen_t sockaddr_size = sizeof ( sockaddr );
+#if defined(std_platform_win32_m)
     SOCKET connection_socket = accept ( sock->os_handle, ( SOCKADDR* ) &sockaddr, &sockaddr_size );
+#elif defined(std_platform_linux_m)
+    // Linux doesn't carry O_NONBLOCK over to accepted sockets, WinSock does
+    SOCKET connection_socket = accept4 ( sock->os_handle, ( SOCKADDR* ) &sockaddr, &sockaddr_size, sock->params.is_blocking ? 0 : SOCK_NONBLOCK );
+#endif
 
     if ( connection_socket == INVALID_SOCKET ) {
-        return false;
+        return net_null_handle_m;
     }
 
     net_address_family_e family = net_address_family_from_winsock ( sockaddr.ss_family );
@@ -261,6 +352,7 @@ net_socket_h net_socket_accept_pending_connection ( net_socket_address_t* addres
         break;
 
         default:
+            closesocket ( connection_socket );
             return net_null_handle_m;
     }
 
@@ -268,12 +360,26 @@ net_socket_h net_socket_accept_pending_connection ( net_socket_address_t* addres
     net_socket_t* connection_sock = std_list_pop_m ( &net_socket_state.sockets_freelist );
     std_mutex_unlock ( &net_socket_state.sockets_mutex );
 
+    if ( connection_sock == NULL ) {
+        std_log_error_m ( "Max socket count reached." );
+        closesocket ( connection_socket );
+        return net_null_handle_m;
+    }
+
     connection_sock->params.family = sock->params.family;
     connection_sock->params.protocol = sock->params.protocol;
-    connection_sock->params.is_blocking = true;
+    connection_sock->params.is_blocking = sock->params.is_blocking;
     connection_sock->address = connection_address;
     connection_sock->os_handle = connection_socket;
     connection_sock->state = net_socket_state_connected_m;
+    connection_sock->poller = net_null_handle_m;
+    connection_sock->send_queue = NULL;
+#if defined(std_platform_linux_m)
+    connection_sock->gso = false;
+    connection_sock->gro = NULL;
+    connection_sock->gro_tested = true;
+#endif
+    net_socket_set_no_delay ( connection_socket );
 
     *address = connection_address;
 
@@ -289,8 +395,13 @@ size_t net_socket_get_available_read_size ( net_socket_h socket_handle ) {
 
     std_assert_m ( sock->state >= net_socket_state_bound_m );
 
+#if defined(std_platform_win32_m)
     u_long size;
     int error = ioctlsocket ( sock->os_handle, ( long ) FIONREAD, &size );
+#elif defined(std_platform_linux_m)
+    int size;
+    int error = ioctl ( sock->os_handle, FIONREAD, &size );
+#endif
     std_assert_m ( !error );
 
     return size;
@@ -305,6 +416,10 @@ size_t read_connected_socket ( void* dest, size_t cap,  net_socket_h socket_hand
     int read_size = recv ( sock->os_handle, dest, ( int ) cap, 0 );
 
     if ( read_size == SOCKET_ERROR ) {
+        if ( net_platform_would_block() ) {
+            return net_would_block_m;
+        }
+
         // TODO
         return 0;
     }
@@ -318,9 +433,13 @@ size_t write_connected_socket ( net_socket_h socket_handle, const void* data, si
 
     std_assert_m ( sock->state == net_socket_state_connected_m );
 
-    int write_size = send ( sock->os_handle, data, ( int ) size, 0 );
+    int write_size = send ( sock->os_handle, data, ( int ) size, MSG_NOSIGNAL );
 
     if ( write_size == SOCKET_ERROR ) {
+        if ( net_platform_would_block() ) {
+            return net_would_block_m;
+        }
+
         // TODO
         return 0;
     }
@@ -328,22 +447,87 @@ size_t write_connected_socket ( net_socket_h socket_handle, const void* data, si
     return ( size_t ) write_size;
 }
 
+size_t write_connected_socket_gather ( net_socket_h socket_handle, const std_buffer_t* buffers, size_t count ) {
+    net_socket_t* sock = &net_socket_state.sockets_array[ ( uint64_t ) socket_handle];
+    std_assert_m ( sock != NULL );
+
+    std_assert_m ( sock->state == net_socket_state_connected_m );
+
+    count = std_min_u64 ( count, net_socket_iovec_batch_size_m );
+
+#if defined(std_platform_win32_m)
+    WSABUF wsa_buffers[net_socket_iovec_batch_size_m];
+
+    for ( size_t i = 0; i < count; ++i ) {
+        wsa_buffers[i].buf = buffers[i].base;
+        wsa_buffers[i].len = ( ULONG ) buffers[i].size;
+    }
+
+    DWORD write_size;
+    int error = WSASend ( sock->os_handle, wsa_buffers, ( DWORD ) count, &write_size, 0, NULL, NULL );
+
+    if ( error == SOCKET_ERROR ) {
+#elif defined(std_platform_linux_m)
+    struct iovec iovs[net_socket_iovec_batch_size_m];
+
+    for ( size_t i = 0; i < count; ++i ) {
+        iovs[i].iov_base = buffers[i].base;
+        iovs[i].iov_len = buffers[i].size;
+    }
+
+    struct msghdr header;
+    std_mem_zero_m ( &header );
+    header.msg_iov = iovs;
+    header.msg_iovlen = count;
+    ssize_t write_size = sendmsg ( sock->os_handle, &header, MSG_NOSIGNAL );
+
+    if ( write_size == SOCKET_ERROR ) {
+#endif
+        if ( net_platform_would_block() ) {
+            return net_would_block_m;
+        }
+
+        return 0;
+    }
+
+    return ( size_t ) write_size;
+}
+
 size_t read_socket ( net_socket_address_t* address, void* dest, size_t cap, net_socket_h socket_handle ) {
     net_socket_t* sock = &net_socket_state.sockets_array[ ( uint64_t ) socket_handle];
     std_assert_m ( sock != NULL );
 
     std_assert_m ( sock->state >= net_socket_state_bound_m );
 
+#if defined(std_platform_linux_m)
+    if ( sock->gro != NULL ) {
+        // Coalesced datagrams from a previous batched read might still be pending
+        net_datagram_t datagram;
+        datagram.data = dest;
+        datagram.size = cap;
+        size_t result = read_socket_batch ( &datagram, 1, socket_handle );
+
+        if ( result != 1 ) {
+            return result;
+        }
+
+        *address = datagram.address;
+        return datagram.result_size;
+    }
+#endif
+
     std_mem_zero_m ( address );
     int read_size;
     SOCKADDR_STORAGE sockaddr;
-    int sockaddr_size = sizeof ( sockaddr );
+    socklen_t sockaddr_size = sizeof ( sockaddr );
     read_size = recvfrom ( sock->os_handle, dest, ( int ) cap, 0, ( SOCKADDR* ) &sockaddr, &sockaddr_size );
 
     if ( read_size == SOCKET_ERROR ) {
-        int error = WSAGetLastError();
-        std_unused_m ( error );
-        return false;
+        if ( net_platform_would_block() ) {
+            return net_would_block_m;
+        }
+
+        return 0;
     }
 
     net_address_family_e family = net_address_family_from_winsock ( sockaddr.ss_family );
@@ -377,22 +561,359 @@ size_t write_socket ( net_socket_h socket_handle, const net_socket_address_t* ad
         case net_address_family_ip4_m: {
             struct sockaddr_in sockaddr;
             net_socket_address_ip4_to_winsock ( &sockaddr, address );
-            write_size = sendto ( sock->os_handle, data, ( int ) size, 0, ( SOCKADDR* ) &sockaddr, sizeof ( sockaddr ) );
+            write_size = sendto ( sock->os_handle, data, ( int ) size, MSG_NOSIGNAL, ( SOCKADDR* ) &sockaddr, sizeof ( sockaddr ) );
         }
         break;
 
         case net_address_family_ip6_m: {
             struct sockaddr_in6 sockaddr;
             net_socket_address_ip6_to_winsock ( &sockaddr, address );
-            write_size = sendto ( sock->os_handle, data, ( int ) size, 0, ( SOCKADDR* ) &sockaddr, sizeof ( sockaddr ) );
+            write_size = sendto ( sock->os_handle, data, ( int ) size, MSG_NOSIGNAL, ( SOCKADDR* ) &sockaddr, sizeof ( sockaddr ) );
         }
         break;
     }
 
     if ( write_size == SOCKET_ERROR ) {
+        if ( net_platform_would_block() ) {
+            return net_would_block_m;
+        }
+
         // TODO
         return 0;
     }
 
     return ( size_t ) write_size;
 }
+
+// --
+
+#if defined(std_platform_linux_m)
+static bool net_socket_address_is_equal ( const net_socket_address_t* a, const net_socket_address_t* b, net_address_family_e family ) {
+    if ( a->port != b->port ) {
+        return false;
+    }
+
+    if ( family == net_address_family_ip4_m ) {
+        return a->ip.u32[0] == b->ip.u32[0];
+    } else {
+        return a->ip.u64[0] == b->ip.u64[0] && a->ip.u64[1] == b->ip.u64[1];
+    }
+}
+
+// Counts how many datagrams, starting from the first, can go out as one segmented send: same destination and same size,
+// except for the last one that can be smaller.
+static size_t net_socket_gso_run_count ( const net_datagram_t* datagrams, size_t count, net_address_family_e family ) {
+    size_t segment_size = datagrams[0].size;
+    size_t total_size = segment_size;
+    size_t run_count = 1;
+
+    if ( segment_size == 0 ) {
+        return 1;
+    }
+
+    while ( run_count < count && run_count < net_socket_gso_max_segments_m ) {
+        const net_datagram_t* datagram = &datagrams[run_count];
+
+        if ( datagram->size == 0 || datagram->size > segment_size || total_size + datagram->size > net_udp_max_payload_size_m ) {
+            break;
+        }
+
+        if ( !net_socket_address_is_equal ( &datagram->address, &datagrams[0].address, family ) ) {
+            break;
+        }
+
+        total_size += datagram->size;
+        ++run_count;
+
+        if ( datagram->size < segment_size ) {
+            break;
+        }
+    }
+
+    return run_count;
+}
+
+static void net_socket_gro_enable ( net_socket_t* sock ) {
+    sock->gro_tested = true;
+
+    int value = 1;
+
+    if ( setsockopt ( sock->os_handle, SOL_UDP, UDP_GRO, &value, sizeof ( value ) ) != 0 ) {
+        return;
+    }
+
+    net_socket_gro_t* gro = std_virtual_heap_alloc_struct_m ( net_socket_gro_t );
+    std_mem_zero_m ( gro );
+    gro->buffer = std_virtual_heap_alloc_m ( net_socket_gro_batch_size_m * net_socket_gro_buffer_size_m, 16 );
+    sock->gro = gro;
+}
+
+// Refills the GRO buffers, returns how many were received
+static size_t net_socket_gro_receive ( net_socket_t* sock, int flags ) {
+    net_socket_gro_t* gro = sock->gro;
+
+    struct mmsghdr msgs[net_socket_gro_batch_size_m];
+    struct iovec iovs[net_socket_gro_batch_size_m];
+    SOCKADDR_STORAGE sockaddrs[net_socket_gro_batch_size_m];
+    union {
+        char buffer[CMSG_SPACE ( sizeof ( int ) )];
+        struct cmsghdr align;
+    } controls[net_socket_gro_batch_size_m];
+
+    for ( size_t i = 0; i < net_socket_gro_batch_size_m; ++i ) {
+        iovs[i].iov_base = gro->buffer + i * net_socket_gro_buffer_size_m;
+        iovs[i].iov_len = net_socket_gro_buffer_size_m;
+        struct msghdr* header = &msgs[i].msg_hdr;
+        std_mem_zero_m ( header );
+        header->msg_name = &sockaddrs[i];
+        header->msg_namelen = sizeof ( sockaddrs[i] );
+        header->msg_iov = &iovs[i];
+        header->msg_iovlen = 1;
+        header->msg_control = controls[i].buffer;
+        header->msg_controllen = sizeof ( controls[i].buffer );
+    }
+
+    int result = recvmmsg ( sock->os_handle, msgs, net_socket_gro_batch_size_m, flags, NULL );
+
+    if ( result <= 0 ) {
+        return result < 0 && net_platform_would_block() ? net_would_block_m : 0;
+    }
+
+    for ( int i = 0; i < result; ++i ) {
+        net_socket_gro_msg_t* msg = &gro->msgs[i];
+        msg->size = msgs[i].msg_len;
+        msg->segment_size = msgs[i].msg_len;
+        net_socket_address_from_winsock ( &msg->address, &sockaddrs[i] );
+
+        // Only present when the kernel actually coalesced something
+        for ( struct cmsghdr* cmsg = CMSG_FIRSTHDR ( &msgs[i].msg_hdr ); cmsg != NULL; cmsg = CMSG_NXTHDR ( &msgs[i].msg_hdr, cmsg ) ) {
+            if ( cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO ) {
+                int segment_size;
+                std_mem_copy ( &segment_size, CMSG_DATA ( cmsg ), sizeof ( segment_size ) );
+                msg->segment_size = ( uint32_t ) segment_size;
+            }
+        }
+    }
+
+    gro->msg_count = ( uint32_t ) result;
+    gro->msg_idx = 0;
+    gro->msg_offset = 0;
+    return ( size_t ) result;
+}
+
+static size_t net_socket_gro_read_batch ( net_socket_t* sock, net_datagram_t* datagrams, size_t count ) {
+    net_socket_gro_t* gro = sock->gro;
+    size_t read_count = 0;
+
+    while ( read_count < count ) {
+        if ( gro->msg_idx == gro->msg_count ) {
+            // Only the first receive is allowed to block
+            size_t result = net_socket_gro_receive ( sock, read_count == 0 ? MSG_WAITFORONE : MSG_DONTWAIT );
+
+            if ( result == 0 || result == net_would_block_m ) {
+                return read_count > 0 ? read_count : result;
+            }
+        }
+
+        net_socket_gro_msg_t* msg = &gro->msgs[gro->msg_idx];
+        const char* buffer = gro->buffer + gro->msg_idx * net_socket_gro_buffer_size_m;
+        uint32_t segment_size = std_min_u32 ( msg->segment_size, msg->size - gro->msg_offset );
+
+        net_datagram_t* datagram = &datagrams[read_count++];
+        size_t copy_size = std_min_u64 ( segment_size, datagram->size );
+        std_mem_copy ( datagram->data, buffer + gro->msg_offset, copy_size );
+        datagram->result_size = copy_size;
+        datagram->address = msg->address;
+
+        gro->msg_offset += segment_size;
+
+        if ( gro->msg_offset >= msg->size ) {
+            gro->msg_idx += 1;
+            gro->msg_offset = 0;
+        }
+    }
+
+    return read_count;
+}
+#endif
+
+size_t read_socket_batch ( net_datagram_t* datagrams, size_t count, net_socket_h socket_handle ) {
+    net_socket_t* sock = &net_socket_state.sockets_array[ ( uint64_t ) socket_handle];
+    std_assert_m ( sock != NULL );
+
+    std_assert_m ( sock->state >= net_socket_state_bound_m );
+    std_assert_m ( sock->params.protocol == net_ip_protocol_udp_m );
+
+#if defined(std_platform_linux_m)
+    if ( !sock->gro_tested ) {
+        net_socket_gro_enable ( sock );
+    }
+
+    if ( sock->gro != NULL ) {
+        return net_socket_gro_read_batch ( sock, datagrams, count );
+    }
+
+    count = std_min_u64 ( count, net_socket_batch_size_m );
+    struct mmsghdr msgs[net_socket_batch_size_m];
+    struct iovec iovs[net_socket_batch_size_m];
+    SOCKADDR_STORAGE sockaddrs[net_socket_batch_size_m];
+
+    for ( size_t i = 0; i < count; ++i ) {
+        iovs[i].iov_base = datagrams[i].data;
+        iovs[i].iov_len = datagrams[i].size;
+        struct msghdr* header = &msgs[i].msg_hdr;
+        std_mem_zero_m ( header );
+        header->msg_name = &sockaddrs[i];
+        header->msg_namelen = sizeof ( sockaddrs[i] );
+        header->msg_iov = &iovs[i];
+        header->msg_iovlen = 1;
+    }
+
+    // Blocks until the first datagram arrives, then takes whatever else is already there
+    int result = recvmmsg ( sock->os_handle, msgs, ( unsigned int ) count, MSG_WAITFORONE, NULL );
+
+    if ( result < 0 ) {
+        return net_platform_would_block() ? net_would_block_m : 0;
+    }
+
+    for ( int i = 0; i < result; ++i ) {
+        datagrams[i].result_size = msgs[i].msg_len;
+        net_socket_address_from_winsock ( &datagrams[i].address, &sockaddrs[i] );
+    }
+
+    return ( size_t ) result;
+#else
+    size_t read_count = 0;
+
+    while ( read_count < count ) {
+        // Only the first read is allowed to block
+        if ( read_count > 0 && net_socket_get_available_read_size ( socket_handle ) == 0 ) {
+            break;
+        }
+
+        net_datagram_t* datagram = &datagrams[read_count];
+        size_t read_size = read_socket ( &datagram->address, datagram->data, datagram->size, socket_handle );
+
+        if ( read_size == net_would_block_m ) {
+            return read_count > 0 ? read_count : net_would_block_m;
+        }
+
+        datagram->result_size = read_size;
+        ++read_count;
+    }
+
+    return read_count;
+#endif
+}
+
+size_t write_socket_batch ( net_socket_h socket_handle, net_datagram_t* datagrams, size_t count ) {
+    net_socket_t* sock = &net_socket_state.sockets_array[ ( uint64_t ) socket_handle];
+    std_assert_m ( sock != NULL );
+
+    std_assert_m ( sock->state >= net_socket_state_bound_m );
+    std_assert_m ( sock->params.protocol == net_ip_protocol_udp_m );
+
+#if defined(std_platform_linux_m)
+    struct mmsghdr msgs[net_socket_batch_size_m];
+    struct iovec iovs[net_socket_batch_size_m];
+    SOCKADDR_STORAGE sockaddrs[net_socket_batch_size_m];
+    size_t msg_datagram_counts[net_socket_batch_size_m];
+    union {
+        char buffer[CMSG_SPACE ( sizeof ( uint16_t ) )];
+        struct cmsghdr align;
+    } controls[net_socket_batch_size_m];
+
+    size_t sent_count = 0;
+
+    while ( sent_count < count ) {
+        // Each datagram takes one iovec, runs of them going to the same place share a single segmented message
+        size_t msg_count = 0;
+        size_t iov_count = 0;
+
+        while ( sent_count + iov_count < count && iov_count < net_socket_batch_size_m ) {
+            const net_datagram_t* first = &datagrams[sent_count + iov_count];
+            size_t run_count = 1;
+
+            if ( sock->gso ) {
+                run_count = net_socket_gso_run_count ( first, count - sent_count - iov_count, sock->params.family );
+                run_count = std_min_u64 ( run_count, net_socket_batch_size_m - iov_count );
+            }
+
+            for ( size_t i = 0; i < run_count; ++i ) {
+                iovs[iov_count + i].iov_base = first[i].data;
+                iovs[iov_count + i].iov_len = first[i].size;
+            }
+
+            struct msghdr* header = &msgs[msg_count].msg_hdr;
+            std_mem_zero_m ( header );
+            header->msg_name = &sockaddrs[msg_count];
+            header->msg_namelen = net_socket_address_to_winsock ( &sockaddrs[msg_count], &first->address, sock->params.family );
+            header->msg_iov = &iovs[iov_count];
+            header->msg_iovlen = run_count;
+
+            if ( run_count > 1 ) {
+                header->msg_control = controls[msg_count].buffer;
+                header->msg_controllen = sizeof ( controls[msg_count].buffer );
+                struct cmsghdr* cmsg = CMSG_FIRSTHDR ( header );
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN ( sizeof ( uint16_t ) );
+                uint16_t segment_size = ( uint16_t ) first->size;
+                std_mem_copy ( CMSG_DATA ( cmsg ), &segment_size, sizeof ( segment_size ) );
+            }
+
+            msg_datagram_counts[msg_count++] = run_count;
+            iov_count += run_count;
+        }
+
+        int result = sendmmsg ( sock->os_handle, msgs, ( unsigned int ) msg_count, MSG_NOSIGNAL );
+
+        if ( result < 0 ) {
+            if ( sock->gso && iov_count > msg_count && ( errno == EIO || errno == EINVAL || errno == ENOPROTOOPT ) ) {
+                // No segmentation offload on this kernel or route, go back to one message per datagram
+                sock->gso = false;
+                continue;
+            }
+
+            if ( sent_count == 0 && net_platform_would_block() ) {
+                return net_would_block_m;
+            }
+
+            break;
+        }
+
+        for ( int i = 0; i < result; ++i ) {
+            for ( size_t j = 0; j < msg_datagram_counts[i]; ++j ) {
+                net_datagram_t* datagram = &datagrams[sent_count++];
+                datagram->result_size = datagram->size;
+            }
+        }
+
+        if ( ( size_t ) result < msg_count ) {
+            break;
+        }
+    }
+
+    return sent_count;
+#else
+    size_t sent_count = 0;
+
+    while ( sent_count < count ) {
+        net_datagram_t* datagram = &datagrams[sent_count];
+        size_t write_size = write_socket ( socket_handle, &datagram->address, datagram->data, datagram->size );
+
+        if ( write_size == net_would_block_m ) {
+            return sent_count > 0 ? sent_count : net_would_block_m;
+        }
+
+        if ( write_size != datagram->size ) {
+            break;
+        }
+
+        datagram->result_size = write_size;
+        ++sent_count;
+    }
+
+    return sent_count;
+#endif
+}
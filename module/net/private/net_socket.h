@@ -2,10 +2,82 @@
 
 #include <net.h>
 
+#include "net_platform.h"
+
 // https://www.tenouk.com/Winsock/Winsock2story.html
 
+typedef enum {
+    net_socket_state_invalid_m,
+    net_socket_state_unbound_m,
+    net_socket_state_bound_m,
+    net_socket_state_listening_m,
+    net_socket_state_connected_m,
+} net_socket_state_e;
+
+#if defined(std_platform_linux_m)
+// UDP GRO hands back many datagrams coalesced into one buffer, they're split from here into the caller's buffers
+typedef struct {
+    net_socket_address_t address;
+    uint32_t size;
+    uint32_t segment_size;
+} net_socket_gro_msg_t;
+
+typedef struct {
+    char* buffer;
+    net_socket_gro_msg_t msgs[net_socket_gro_batch_size_m];
+    uint32_t msg_count;
+    uint32_t msg_idx;
+    uint32_t msg_offset;
+} net_socket_gro_t;
+#endif
+
+// Buffers handed over with write_connected_socket_buffer, in a ring: released from head, sent from send, added at tail
+typedef struct {
+    net_buffer_h buffer;
+    uint32_t size;
+    uint32_t sent_size;
+    // Id of the last zero copy send that read from the buffer, it can't be released before the kernel is done with it
+    uint32_t zerocopy_id;
+    bool zerocopy;
+} net_socket_send_t;
+
+typedef struct {
+    net_socket_send_t items[net_socket_send_queue_size_m];
+    uint32_t head;
+    uint32_t send;
+    uint32_t tail;
+    bool zerocopy_enabled;
+    // The kernel numbers zero copy sends in order and reports them done in ranges
+    uint32_t zerocopy_next_id;
+    uint32_t zerocopy_done_id;
+} net_socket_send_queue_t;
+
+typedef struct {
+    net_socket_params_t params;
+    net_socket_address_t address;
+    //char address_string[net_address_string_size_m];
+    SOCKET os_handle;
+    net_socket_state_e state;
+    // Set while the socket is in a poller
+    net_poller_h poller;
+    void* poll_user_data;
+    uint32_t poll_idx;
+    // Allocated on the first buffer write
+    net_socket_send_queue_t* send_queue;
+#if defined(std_platform_linux_m)
+    // Cleared the first time the kernel refuses a segmented send
+    bool gso;
+    // Allocated on the first batched read, if the kernel supports UDP GRO. Batched reads on the same socket are then
+    // expected to come from one thread at a time.
+    net_socket_gro_t* gro;
+    bool gro_tested;
+#endif
+} net_socket_t;
+
 void net_socket_init ( void );
 
+net_socket_t* net_socket_get ( net_socket_h socket );
+
 net_socket_h net_socket_create ( const net_socket_params_t* params );
 bool net_socket_destroy ( net_socket_h socket );
 
@@ -17,5 +89,8 @@ net_socket_h net_socket_accept_pending_connection ( net_socket_address_t* addres
 size_t net_socket_get_available_read_size ( net_socket_h socket );
 size_t read_connected_socket ( void* dest, size_t cap,  net_socket_h socket );
 size_t write_connected_socket ( net_socket_h socket, const void* data, size_t size );
+size_t write_connected_socket_gather ( net_socket_h socket, const std_buffer_t* buffers, size_t count );
 size_t read_socket ( net_socket_address_t* address, void* dest, size_t cap,  net_socket_h socket );
 size_t write_socket ( net_socket_h socket, const net_socket_address_t* address, const void* data, size_t size );
+size_t read_socket_batch ( net_datagram_t* datagrams, size_t count, net_socket_h socket );
+size_t write_socket_batch ( net_socket_h socket, net_datagram_t* datagrams, size_t count );
@@ -0,0 +1,1380 @@
+#include "net_transport.h"
+
+#include "net_socket.h"
+
+#include <std_log.h>
+#include <std_list.h>
+#include <std_byte.h>
+#include <std_mutex.h>
+#include <std_sort.h>
+#include <std_time.h>
+#include <std_allocator.h>
+
+/*
+    https://gafferongames.com/post/reliable_ordered_messages/
+    https://gafferongames.com/post/packet_fragmentation_and_reassembly/
+    https://gafferongames.com/post/client_server_connection/
+
+    Packets
+        connect request     type u8, protocol id u32, client salt u64, channel count u8
+        connect accept      type u8, client salt u64, server salt u64
+        data                type u8, session u64, seq u16, ack u16, ack bits u32, fragments...
+        disconnect          type u8, session u64
+    Fragments inside data packets
+        channel u8, flags u8, id u16, size u16, [fragment idx u8, fragment count u8], data
+    Multi byte values are little endian. The session is client salt ^ server salt. Both salts travel in cleartext, so
+    the session only keeps off-path senders from spoofing packets, anyone who sees the handshake can forge them.
+    Reliable fragments are numbered one by one, a message split in N fragments takes N consecutive ids. Unreliable
+    fragments carry the id of their message.
+*/
+
+#define net_transport_protocol_id_m 0x314f454e
+#define net_transport_fragment_header_size_m 6
+#define net_transport_fragment_split_header_size_m 2
+#define net_transport_fragment_flag_split_m ( 1 << 0 )
+// Sent packets remembered per connection, waiting for their ack
+#define net_transport_sent_packets_size_m 256
+// A packet that's still not acked when one sent this many packets, and a fraction of a round trip, after it is, is
+// considered lost without waiting for the resend timeout. The time keeps reordering from triggering resends.
+#define net_transport_fast_resend_packets_m 3
+#define net_transport_fast_resend_rtt_m 0.25
+// Reliable fragments tracked per packet, a packet with more of them is split
+#define net_transport_packet_max_fragments_m 32
+#define net_transport_disconnect_packet_count_m 3
+// Smoothing of the round trip time and minimum wait before resending a reliable fragment
+#define net_transport_rtt_smoothing_m 0.1
+#define net_transport_initial_rtt_ms_m 100.0
+#define net_transport_min_resend_ms_m 20.0
+// Sending can burst up to this much worth of rate after being idle
+#define net_transport_burst_ms_m 20.0
+#define net_transport_rate_backoff_m 0.75
+// Space kept free in the event queue for connection events
+#define net_transport_event_reserve_m ( net_transport_max_connections_m * 2 )
+
+#define net_transport_bitset_u64_count_m std_div_ceil_m ( net_transport_max_transports_m, 64 )
+
+typedef enum {
+    net_transport_packet_connect_request_m = 1,
+    net_transport_packet_connect_accept_m,
+    net_transport_packet_data_m,
+    net_transport_packet_disconnect_m,
+} net_transport_packet_type_e;
+
+typedef enum {
+    net_transport_connection_free_m,
+    // Client side, waiting for the accept
+    net_transport_connection_connecting_m,
+    // Server side, accept sent, waiting for the first data packet from the client
+    net_transport_connection_accepting_m,
+    net_transport_connection_connected_m,
+} net_transport_connection_state_e;
+
+// A whole message or a piece of one, both on the send and on the receive side
+typedef struct {
+    char* data;
+    uint16_t size;
+    uint16_t id;
+    uint8_t fragment_idx;
+    uint8_t fragment_count;
+    bool used;
+    bool acked;
+    // Negative until first sent
+    double send_time;
+} net_transport_fragment_t;
+
+typedef struct {
+    char* buffer;
+    uint64_t received_bitset;
+    uint32_t received_count;
+    uint32_t fragment_count;
+    size_t size;
+    uint16_t id;
+    bool active;
+} net_transport_reassembly_t;
+
+typedef struct {
+    net_transport_channel_type_e type;
+    // Reliable: window of sent fragments, from head up to tail, waiting to be acked
+    // Unreliable: queue of fragments waiting for the next update to go out
+    net_transport_fragment_t* send_fragments;
+    uint16_t send_head;
+    uint16_t send_tail;
+    uint16_t send_message_id;
+    // Reliable: window of received fragments waiting for the ones before them
+    net_transport_fragment_t* receive_fragments;
+    uint16_t receive_next_id;
+    // Unreliable: id of the last delivered message
+    uint16_t receive_last_id;
+    bool receive_any;
+    net_transport_reassembly_t reassembly;
+} net_transport_channel_t;
+
+typedef struct {
+    uint16_t id;
+    uint8_t channel;
+} net_transport_fragment_ref_t;
+
+typedef struct {
+    double send_time;
+    uint32_t size;
+    uint16_t seq;
+    bool used;
+    bool acked;
+    bool lost;
+    uint32_t fragment_count;
+    net_transport_fragment_ref_t fragments[net_transport_packet_max_fragments_m];
+} net_transport_sent_packet_t;
+
+typedef struct {
+    net_transport_connection_state_e state;
+    net_socket_address_t address;
+    uint64_t client_salt;
+    uint64_t server_salt;
+    uint64_t session;
+    double handshake_time;
+    double receive_time;
+    double send_time;
+    // Packets
+    uint16_t send_seq;
+    uint16_t receive_seq;
+    uint32_t receive_ack_bits;
+    bool receive_any;
+    bool ack_pending;
+    net_transport_sent_packet_t* sent_packets;
+    // Pacing
+    double rtt_ms;
+    bool rtt_sampled;
+    double send_rate;
+    double send_tokens;
+    double token_time;
+    double loss_time;
+    // Until the first loss the rate doubles every round trip, then it grows linearly
+    bool slow_start;
+    // Stats
+    uint64_t sent_packet_count;
+    uint64_t received_packet_count;
+    uint64_t resent_fragment_count;
+    net_transport_channel_t channels[net_transport_max_channels_m];
+} net_transport_connection_t;
+
+typedef struct {
+    net_socket_address_t address;
+    double deliver_time;
+    uint32_t size;
+    char data[net_transport_packet_size_m];
+} net_transport_simulator_packet_t;
+
+typedef struct {
+    net_transport_params_t params;
+    net_socket_h socket;
+    net_transport_connection_t connections[net_transport_max_connections_m];
+    std_xorshift64_state_t rng;
+    double now;
+    // The events returned by the last update stay at the front of the queue until the next one frees their data
+    net_transport_event_t* events;
+    uint32_t event_count;
+    uint32_t returned_event_count;
+    // Packets are batched and sent all together at the end of the update
+    net_datagram_t send_datagrams[net_socket_batch_size_m];
+    char* send_buffer;
+    uint32_t send_count;
+    net_datagram_t receive_datagrams[net_socket_batch_size_m];
+    char* receive_buffer;
+    bool simulator_enabled;
+    net_transport_simulator_packet_t* simulator_packets;
+    uint32_t simulator_packet_count;
+} net_transport_t;
+
+typedef struct {
+    net_transport_t* transports_array;
+    net_transport_t* transports_freelist;
+    uint64_t transports_bitset[net_transport_bitset_u64_count_m];
+    std_mutex_t transports_mutex;
+} net_transport_state_t;
+
+static net_transport_state_t net_transport_state;
+
+// --
+
+typedef struct {
+    char* base;
+    size_t size;
+} net_transport_writer_t;
+
+typedef struct {
+    const char* base;
+    size_t size;
+    size_t offset;
+    bool error;
+} net_transport_reader_t;
+
+static void net_transport_write_u8 ( net_transport_writer_t* writer, uint8_t value ) {
+    writer->base[writer->size++] = ( char ) value;
+}
+
+static void net_transport_write_u16 ( net_transport_writer_t* writer, uint16_t value ) {
+    net_transport_write_u8 ( writer, ( uint8_t ) value );
+    net_transport_write_u8 ( writer, ( uint8_t ) ( value >> 8 ) );
+}
+
+static void net_transport_write_u32 ( net_transport_writer_t* writer, uint32_t value ) {
+    net_transport_write_u16 ( writer, ( uint16_t ) value );
+    net_transport_write_u16 ( writer, ( uint16_t ) ( value >> 16 ) );
+}
+
+static void net_transport_write_u64 ( net_transport_writer_t* writer, uint64_t value ) {
+    net_transport_write_u32 ( writer, ( uint32_t ) value );
+    net_transport_write_u32 ( writer, ( uint32_t ) ( value >> 32 ) );
+}
+
+static void net_transport_write_bytes ( net_transport_writer_t* writer, const void* data, size_t size ) {
+    std_mem_copy ( writer->base + writer->size, data, size );
+    writer->size += size;
+}
+
+static uint8_t net_transport_read_u8 ( net_transport_reader_t* reader ) {
+    if ( reader->offset + 1 > reader->size ) {
+        reader->error = true;
+        return 0;
+    }
+
+    return ( uint8_t ) reader->base[reader->offset++];
+}
+
+static uint16_t net_transport_read_u16 ( net_transport_reader_t* reader ) {
+    uint16_t lo = net_transport_read_u8 ( reader );
+    uint16_t hi = net_transport_read_u8 ( reader );
+    return ( uint16_t ) ( lo | ( hi << 8 ) );
+}
+
+static uint32_t net_transport_read_u32 ( net_transport_reader_t* reader ) {
+    uint32_t lo = net_transport_read_u16 ( reader );
+    uint32_t hi = net_transport_read_u16 ( reader );
+    return lo | ( hi << 16 );
+}
+
+static uint64_t net_transport_read_u64 ( net_transport_reader_t* reader ) {
+    uint64_t lo = net_transport_read_u32 ( reader );
+    uint64_t hi = net_transport_read_u32 ( reader );
+    return lo | ( hi << 32 );
+}
+
+static const char* net_transport_read_bytes ( net_transport_reader_t* reader, size_t size ) {
+    if ( reader->offset + size > reader->size ) {
+        reader->error = true;
+        return NULL;
+    }
+
+    const char* result = reader->base + reader->offset;
+    reader->offset += size;
+    return result;
+}
+
+// --
+
+// Takes wrap around into account, a is more recent than b if it's less than half the range ahead of it
+static bool net_transport_sequence_greater ( uint16_t a, uint16_t b ) {
+    return ( a > b && a - b <= 32768 ) || ( a < b && b - a > 32768 );
+}
+
+static double net_transport_now ( void ) {
+    return std_tick_to_milli_f64 ( std_tick_now() );
+}
+
+static double net_transport_random_f64 ( net_transport_t* transport ) {
+    return ( std_xorshift64 ( &transport->rng ) >> 11 ) * ( 1.0 / 9007199254740992.0 );
+}
+
+static uint64_t net_transport_random_salt ( net_transport_t* transport ) {
+    uint64_t salt;
+
+    do {
+        salt = std_xorshift64 ( &transport->rng );
+    } while ( salt == 0 );
+
+    return salt;
+}
+
+static char* net_transport_copy ( const void* data, size_t size ) {
+    char* copy = std_virtual_heap_alloc_m ( std_max_u64 ( size, 1 ), 16 );
+    std_mem_copy ( copy, data, size );
+    return copy;
+}
+
+static bool net_transport_address_equal ( const net_socket_address_t* a, const net_socket_address_t* b ) {
+    return a->port == b->port && std_mem_cmp ( a->ip.bytes, b->ip.bytes, sizeof ( a->ip.bytes ) );
+}
+
+// --
+
+static void net_transport_flush_datagrams ( net_transport_t* transport ) {
+    if ( transport->send_count == 0 ) {
+        return;
+    }
+
+    // Whatever the socket doesn't take is lost, same as if the network dropped it
+    write_socket_batch ( transport->socket, transport->send_datagrams, transport->send_count );
+    transport->send_count = 0;
+}
+
+static void net_transport_queue_datagram ( net_transport_t* transport, const net_socket_address_t* address, const void* data, size_t size ) {
+    if ( transport->send_count == net_socket_batch_size_m ) {
+        net_transport_flush_datagrams ( transport );
+    }
+
+    net_datagram_t* datagram = &transport->send_datagrams[transport->send_count];
+    datagram->address = *address;
+    datagram->data = transport->send_buffer + transport->send_count * net_transport_packet_size_m;
+    datagram->size = size;
+    std_mem_copy ( datagram->data, data, size );
+    ++transport->send_count;
+}
+
+static void net_transport_send_datagram ( net_transport_t* transport, const net_socket_address_t* address, const void* data, size_t size ) {
+    if ( !transport->simulator_enabled ) {
+        net_transport_queue_datagram ( transport, address, data, size );
+        return;
+    }
+
+    if ( net_transport_random_f64 ( transport ) < transport->params.simulator_loss ) {
+        return;
+    }
+
+    if ( transport->simulator_packet_count == net_transport_simulator_max_packets_m ) {
+        return;
+    }
+
+    net_transport_simulator_packet_t* packet = &transport->simulator_packets[transport->simulator_packet_count++];
+    packet->address = *address;
+    packet->deliver_time = transport->now + transport->params.simulator_latency_ms + net_transport_random_f64 ( transport ) * transport->params.simulator_jitter_ms;
+    packet->size = ( uint32_t ) size;
+    std_mem_copy ( packet->data, data, size );
+}
+
+static void net_transport_simulator_update ( net_transport_t* transport ) {
+    uint32_t i = 0;
+
+    while ( i < transport->simulator_packet_count ) {
+        net_transport_simulator_packet_t* packet = &transport->simulator_packets[i];
+
+        if ( packet->deliver_time > transport->now ) {
+            ++i;
+            continue;
+        }
+
+        net_transport_queue_datagram ( transport, &packet->address, packet->data, packet->size );
+        *packet = transport->simulator_packets[--transport->simulator_packet_count];
+    }
+}
+
+// --
+
+static bool net_transport_push_event ( net_transport_t* transport, net_transport_event_type_e type, uint64_t connection, uint32_t channel, char* data, size_t size ) {
+    if ( transport->event_count == net_transport_event_queue_size_m ) {
+        if ( data != NULL ) {
+            std_virtual_heap_free ( data );
+        }
+
+        return false;
+    }
+
+    net_transport_event_t* event = &transport->events[transport->event_count++];
+    event->type = type;
+    event->connection = connection;
+    event->channel = channel;
+    event->data = data;
+    event->size = size;
+    return true;
+}
+
+static bool net_transport_event_queue_has_room ( net_transport_t* transport ) {
+    return transport->event_count + net_transport_event_reserve_m < net_transport_event_queue_size_m;
+}
+
+static void net_transport_release_returned_events ( net_transport_t* transport ) {
+    uint32_t returned_count = transport->returned_event_count;
+
+    for ( uint32_t i = 0; i < returned_count; ++i ) {
+        if ( transport->events[i].data != NULL ) {
+            std_virtual_heap_free ( ( void* ) transport->events[i].data );
+        }
+    }
+
+    transport->event_count -= returned_count;
+    std_mem_move ( transport->events, transport->events + returned_count, transport->event_count * sizeof ( net_transport_event_t ) );
+    transport->returned_event_count = 0;
+}
+
+// --
+
+static uint64_t net_transport_connection_idx ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    return ( uint64_t ) ( connection - transport->connections );
+}
+
+static net_transport_connection_t* net_transport_alloc_connection ( net_transport_t* transport, const net_socket_address_t* address ) {
+    net_transport_connection_t* connection = NULL;
+
+    for ( uint32_t i = 0; i < net_transport_max_connections_m; ++i ) {
+        if ( transport->connections[i].state == net_transport_connection_free_m ) {
+            connection = &transport->connections[i];
+            break;
+        }
+    }
+
+    if ( connection == NULL ) {
+        return NULL;
+    }
+
+    std_mem_zero_m ( connection );
+    connection->address = *address;
+    connection->handshake_time = -net_transport_handshake_resend_ms_m;
+    connection->receive_time = transport->now;
+    connection->rtt_ms = net_transport_initial_rtt_ms_m;
+    connection->send_rate = net_transport_initial_send_rate_m;
+    connection->send_tokens = net_transport_packet_size_m;
+    connection->token_time = transport->now;
+    connection->slow_start = true;
+    connection->sent_packets = std_virtual_heap_alloc_array_m ( net_transport_sent_packet_t, net_transport_sent_packets_size_m );
+    std_mem_zero_array_m ( connection->sent_packets, net_transport_sent_packets_size_m );
+
+    for ( uint32_t i = 0; i < transport->params.channel_count; ++i ) {
+        net_transport_channel_t* channel = &connection->channels[i];
+        channel->type = transport->params.channels[i];
+
+        if ( channel->type == net_transport_channel_reliable_ordered_m ) {
+            channel->send_fragments = std_virtual_heap_alloc_array_m ( net_transport_fragment_t, net_transport_window_size_m );
+            channel->receive_fragments = std_virtual_heap_alloc_array_m ( net_transport_fragment_t, net_transport_window_size_m );
+            std_mem_zero_array_m ( channel->send_fragments, net_transport_window_size_m );
+            std_mem_zero_array_m ( channel->receive_fragments, net_transport_window_size_m );
+        } else {
+            channel->send_fragments = std_virtual_heap_alloc_array_m ( net_transport_fragment_t, net_transport_unreliable_queue_size_m );
+            std_mem_zero_array_m ( channel->send_fragments, net_transport_unreliable_queue_size_m );
+        }
+    }
+
+    return connection;
+}
+
+static void net_transport_free_connection ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    for ( uint32_t i = 0; i < transport->params.channel_count; ++i ) {
+        net_transport_channel_t* channel = &connection->channels[i];
+
+        if ( channel->type == net_transport_channel_reliable_ordered_m ) {
+            for ( uint32_t j = 0; j < net_transport_window_size_m; ++j ) {
+                if ( channel->send_fragments[j].used && !channel->send_fragments[j].acked ) {
+                    std_virtual_heap_free ( channel->send_fragments[j].data );
+                }
+
+                if ( channel->receive_fragments[j].used ) {
+                    std_virtual_heap_free ( channel->receive_fragments[j].data );
+                }
+            }
+
+            std_virtual_heap_free ( channel->receive_fragments );
+        } else {
+            for ( uint16_t id = channel->send_head; id != channel->send_tail; ++id ) {
+                std_virtual_heap_free ( channel->send_fragments[id % net_transport_unreliable_queue_size_m].data );
+            }
+        }
+
+        if ( channel->reassembly.buffer != NULL ) {
+            std_virtual_heap_free ( channel->reassembly.buffer );
+        }
+
+        std_virtual_heap_free ( channel->send_fragments );
+    }
+
+    std_virtual_heap_free ( connection->sent_packets );
+    connection->state = net_transport_connection_free_m;
+}
+
+static void net_transport_drop_connection ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    // Connections that never got established are only reported to the side that asked for them
+    if ( connection->state != net_transport_connection_accepting_m ) {
+        net_transport_push_event ( transport, net_transport_event_disconnected_m, net_transport_connection_idx ( transport, connection ), 0, NULL, 0 );
+    }
+
+    net_transport_free_connection ( transport, connection );
+}
+
+static net_transport_connection_t* net_transport_find_connection ( net_transport_t* transport, const net_socket_address_t* address ) {
+    for ( uint32_t i = 0; i < net_transport_max_connections_m; ++i ) {
+        net_transport_connection_t* connection = &transport->connections[i];
+
+        if ( connection->state != net_transport_connection_free_m && net_transport_address_equal ( &connection->address, address ) ) {
+            return connection;
+        }
+    }
+
+    return NULL;
+}
+
+static void net_transport_set_connected ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    connection->state = net_transport_connection_connected_m;
+    connection->token_time = transport->now;
+    net_transport_push_event ( transport, net_transport_event_connected_m, net_transport_connection_idx ( transport, connection ), 0, NULL, 0 );
+}
+
+// --
+
+static void net_transport_send_connect_request ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    char buffer[net_transport_packet_size_m];
+    net_transport_writer_t writer = { buffer, 0 };
+    net_transport_write_u8 ( &writer, net_transport_packet_connect_request_m );
+    net_transport_write_u32 ( &writer, net_transport_protocol_id_m );
+    net_transport_write_u64 ( &writer, connection->client_salt );
+    net_transport_write_u8 ( &writer, ( uint8_t ) transport->params.channel_count );
+    net_transport_send_datagram ( transport, &connection->address, buffer, writer.size );
+    connection->handshake_time = transport->now;
+}
+
+static void net_transport_send_connect_accept ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    char buffer[net_transport_packet_size_m];
+    net_transport_writer_t writer = { buffer, 0 };
+    net_transport_write_u8 ( &writer, net_transport_packet_connect_accept_m );
+    net_transport_write_u64 ( &writer, connection->client_salt );
+    net_transport_write_u64 ( &writer, connection->server_salt );
+    net_transport_send_datagram ( transport, &connection->address, buffer, writer.size );
+}
+
+static void net_transport_send_disconnect ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    char buffer[net_transport_packet_size_m];
+    net_transport_writer_t writer = { buffer, 0 };
+    net_transport_write_u8 ( &writer, net_transport_packet_disconnect_m );
+    net_transport_write_u64 ( &writer, connection->session );
+
+    // There's no ack for this, sending a few makes it likely at least one gets there, otherwise the other side times out
+    for ( uint32_t i = 0; i < net_transport_disconnect_packet_count_m; ++i ) {
+        net_transport_send_datagram ( transport, &connection->address, buffer, writer.size );
+    }
+}
+
+// --
+
+static void net_transport_begin_packet ( net_transport_writer_t* writer, net_transport_connection_t* connection ) {
+    writer->size = 0;
+    net_transport_write_u8 ( writer, net_transport_packet_data_m );
+    net_transport_write_u64 ( writer, connection->session );
+    net_transport_write_u16 ( writer, connection->send_seq );
+    net_transport_write_u16 ( writer, connection->receive_seq );
+    net_transport_write_u32 ( writer, connection->receive_ack_bits );
+}
+
+static void net_transport_end_packet ( net_transport_t* transport, net_transport_connection_t* connection, net_transport_writer_t* writer, net_transport_sent_packet_t* record ) {
+    record->send_time = transport->now;
+    record->size = ( uint32_t ) writer->size;
+    record->seq = connection->send_seq;
+    record->used = true;
+    record->acked = false;
+    record->lost = false;
+    connection->sent_packets[connection->send_seq % net_transport_sent_packets_size_m] = *record;
+
+    net_transport_send_datagram ( transport, &connection->address, writer->base, writer->size );
+
+    ++connection->send_seq;
+    ++connection->sent_packet_count;
+    connection->send_tokens -= ( double ) writer->size;
+    connection->send_time = transport->now;
+    connection->ack_pending = false;
+    record->fragment_count = 0;
+}
+
+static bool net_transport_packet_fits ( net_transport_writer_t* writer, net_transport_sent_packet_t* record, const net_transport_fragment_t* fragment ) {
+    size_t size = net_transport_fragment_header_size_m + fragment->size;
+    size += fragment->fragment_count > 1 ? net_transport_fragment_split_header_size_m : 0;
+    return writer->size + size <= net_transport_packet_size_m && record->fragment_count < net_transport_packet_max_fragments_m;
+}
+
+static void net_transport_write_fragment ( net_transport_writer_t* writer, uint32_t channel, const net_transport_fragment_t* fragment ) {
+    bool split = fragment->fragment_count > 1;
+    net_transport_write_u8 ( writer, ( uint8_t ) channel );
+    net_transport_write_u8 ( writer, split ? net_transport_fragment_flag_split_m : 0 );
+    net_transport_write_u16 ( writer, fragment->id );
+    net_transport_write_u16 ( writer, fragment->size );
+
+    if ( split ) {
+        net_transport_write_u8 ( writer, fragment->fragment_idx );
+        net_transport_write_u8 ( writer, fragment->fragment_count );
+    }
+
+    net_transport_write_bytes ( writer, fragment->data, fragment->size );
+}
+
+static void net_transport_on_loss ( net_transport_connection_t* connection, double now ) {
+    // Back off at most once per round trip, the fragments lost in the same window are all from the same congestion
+    if ( now - connection->loss_time > connection->rtt_ms ) {
+        connection->send_rate = std_max_f64 ( connection->send_rate * net_transport_rate_backoff_m, net_transport_min_send_rate_m );
+        connection->loss_time = now;
+        connection->slow_start = false;
+    }
+}
+
+static void net_transport_send_packets ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    double now = transport->now;
+
+    // Token bucket, refilled at the current send rate
+    double burst = std_max_f64 ( connection->send_rate * net_transport_burst_ms_m / 1000.0, net_transport_packet_size_m * 4 );
+    connection->send_tokens = std_min_f64 ( connection->send_tokens + connection->send_rate * ( now - connection->token_time ) / 1000.0, burst );
+    connection->token_time = now;
+
+    double resend_ms = std_max_f64 ( connection->rtt_ms * 1.5, net_transport_min_resend_ms_m );
+
+    char buffer[net_transport_packet_size_m];
+    net_transport_writer_t writer = { buffer, 0 };
+    net_transport_sent_packet_t record;
+    record.fragment_count = 0;
+    bool packet_open = false;
+    bool packet_sent = false;
+
+    for ( uint32_t channel_idx = 0; channel_idx < transport->params.channel_count; ++channel_idx ) {
+        net_transport_channel_t* channel = &connection->channels[channel_idx];
+
+        if ( channel->type == net_transport_channel_reliable_ordered_m ) {
+            for ( uint16_t id = channel->send_head; id != channel->send_tail; ++id ) {
+                net_transport_fragment_t* fragment = &channel->send_fragments[id % net_transport_window_size_m];
+
+                if ( fragment->acked || ( fragment->send_time >= 0 && now - fragment->send_time < resend_ms ) ) {
+                    continue;
+                }
+
+                if ( packet_open && !net_transport_packet_fits ( &writer, &record, fragment ) ) {
+                    net_transport_end_packet ( transport, connection, &writer, &record );
+                    packet_open = false;
+                    packet_sent = true;
+                }
+
+                if ( connection->send_tokens <= 0 ) {
+                    break;
+                }
+
+                if ( !packet_open ) {
+                    net_transport_begin_packet ( &writer, connection );
+                    packet_open = true;
+                }
+
+                net_transport_write_fragment ( &writer, channel_idx, fragment );
+                record.fragments[record.fragment_count].id = id;
+                record.fragments[record.fragment_count].channel = ( uint8_t ) channel_idx;
+                ++record.fragment_count;
+
+                if ( fragment->send_time >= 0 ) {
+                    ++connection->resent_fragment_count;
+                    net_transport_on_loss ( connection, now );
+                }
+
+                fragment->send_time = now;
+            }
+        } else {
+            while ( channel->send_head != channel->send_tail ) {
+                net_transport_fragment_t* fragment = &channel->send_fragments[channel->send_head % net_transport_unreliable_queue_size_m];
+
+                if ( packet_open && !net_transport_packet_fits ( &writer, &record, fragment ) ) {
+                    net_transport_end_packet ( transport, connection, &writer, &record );
+                    packet_open = false;
+                    packet_sent = true;
+                }
+
+                // Unreliable data that can't go out now is dropped, by the next update it would be stale anyway
+                if ( connection->send_tokens > 0 ) {
+                    if ( !packet_open ) {
+                        net_transport_begin_packet ( &writer, connection );
+                        packet_open = true;
+                    }
+
+                    net_transport_write_fragment ( &writer, channel_idx, fragment );
+                }
+
+                std_virtual_heap_free ( fragment->data );
+                ++channel->send_head;
+            }
+        }
+    }
+
+    if ( packet_open ) {
+        net_transport_end_packet ( transport, connection, &writer, &record );
+        packet_sent = true;
+    }
+
+    // Acks and keepalives go out regardless of pacing, they're small and holding them back would only stall the other side
+    if ( !packet_sent && ( connection->ack_pending || now - connection->send_time >= net_transport_keepalive_ms_m ) ) {
+        net_transport_begin_packet ( &writer, connection );
+        net_transport_end_packet ( transport, connection, &writer, &record );
+    }
+}
+
+// --
+
+static void net_transport_deliver_reliable ( net_transport_t* transport, net_transport_connection_t* connection, uint32_t channel_idx ) {
+    net_transport_channel_t* channel = &connection->channels[channel_idx];
+
+    for ( ;; ) {
+        net_transport_fragment_t* first = &channel->receive_fragments[channel->receive_next_id % net_transport_window_size_m];
+
+        if ( !first->used ) {
+            break;
+        }
+
+        uint32_t fragment_count = first->fragment_count;
+        size_t size = 0;
+        bool complete = true;
+
+        for ( uint32_t i = 0; i < fragment_count; ++i ) {
+            net_transport_fragment_t* fragment = &channel->receive_fragments[( uint16_t ) ( channel->receive_next_id + i ) % net_transport_window_size_m];
+
+            if ( !fragment->used ) {
+                complete = false;
+                break;
+            }
+
+            size += fragment->size;
+        }
+
+        if ( !complete || !net_transport_event_queue_has_room ( transport ) ) {
+            break;
+        }
+
+        char* data;
+
+        if ( fragment_count == 1 ) {
+            data = first->data;
+        } else {
+            data = std_virtual_heap_alloc_m ( size, 16 );
+            size_t offset = 0;
+
+            for ( uint32_t i = 0; i < fragment_count; ++i ) {
+                net_transport_fragment_t* fragment = &channel->receive_fragments[( uint16_t ) ( channel->receive_next_id + i ) % net_transport_window_size_m];
+                std_mem_copy ( data + offset, fragment->data, fragment->size );
+                offset += fragment->size;
+                std_virtual_heap_free ( fragment->data );
+            }
+        }
+
+        for ( uint32_t i = 0; i < fragment_count; ++i ) {
+            channel->receive_fragments[( uint16_t ) ( channel->receive_next_id + i ) % net_transport_window_size_m].used = false;
+        }
+
+        channel->receive_next_id += ( uint16_t ) fragment_count;
+        net_transport_push_event ( transport, net_transport_event_message_m, net_transport_connection_idx ( transport, connection ), channel_idx, data, size );
+    }
+}
+
+static void net_transport_receive_reliable ( net_transport_channel_t* channel, uint16_t id, uint8_t fragment_idx, uint8_t fragment_count, const char* data, uint16_t size ) {
+    // Older than what was delivered already, or too far ahead for the window
+    if ( ( uint16_t ) ( id - channel->receive_next_id ) >= net_transport_window_size_m ) {
+        return;
+    }
+
+    net_transport_fragment_t* fragment = &channel->receive_fragments[id % net_transport_window_size_m];
+
+    if ( fragment->used ) {
+        return;
+    }
+
+    fragment->data = net_transport_copy ( data, size );
+    fragment->size = size;
+    fragment->id = id;
+    fragment->fragment_idx = fragment_idx;
+    fragment->fragment_count = fragment_count;
+    fragment->used = true;
+}
+
+static void net_transport_receive_unreliable ( net_transport_t* transport, net_transport_connection_t* connection, uint32_t channel_idx, uint16_t id, uint8_t fragment_idx, uint8_t fragment_count, const char* data, uint16_t size ) {
+    net_transport_channel_t* channel = &connection->channels[channel_idx];
+    uint64_t connection_idx = net_transport_connection_idx ( transport, connection );
+
+    if ( channel->receive_any && !net_transport_sequence_greater ( id, channel->receive_last_id ) ) {
+        return;
+    }
+
+    if ( fragment_count == 1 ) {
+        channel->receive_last_id = id;
+        channel->receive_any = true;
+        net_transport_push_event ( transport, net_transport_event_message_m, connection_idx, channel_idx, net_transport_copy ( data, size ), size );
+        return;
+    }
+
+    // Only one message is reassembled at a time, a fragment of a newer one replaces it
+    net_transport_reassembly_t* reassembly = &channel->reassembly;
+
+    if ( !reassembly->active || reassembly->id != id ) {
+        if ( reassembly->active && net_transport_sequence_greater ( reassembly->id, id ) ) {
+            return;
+        }
+
+        if ( reassembly->buffer == NULL ) {
+            reassembly->buffer = std_virtual_heap_alloc_m ( net_transport_max_message_size_m, 16 );
+        }
+
+        reassembly->id = id;
+        reassembly->active = true;
+        reassembly->fragment_count = fragment_count;
+        reassembly->received_bitset = 0;
+        reassembly->received_count = 0;
+        reassembly->size = 0;
+    }
+
+    if ( fragment_count != reassembly->fragment_count || ( reassembly->received_bitset & ( 1ull << fragment_idx ) ) ) {
+        return;
+    }
+
+    std_mem_copy ( reassembly->buffer + fragment_idx * net_transport_fragment_size_m, data, size );
+    reassembly->received_bitset |= 1ull << fragment_idx;
+    ++reassembly->received_count;
+
+    if ( fragment_idx == fragment_count - 1 ) {
+        reassembly->size = ( size_t ) ( fragment_count - 1 ) * net_transport_fragment_size_m + size;
+    }
+
+    if ( reassembly->received_count == fragment_count ) {
+        channel->receive_last_id = id;
+        channel->receive_any = true;
+        reassembly->active = false;
+        net_transport_push_event ( transport, net_transport_event_message_m, connection_idx, channel_idx, reassembly->buffer, reassembly->size );
+        reassembly->buffer = NULL;
+    }
+}
+
+static void net_transport_receive_seq ( net_transport_connection_t* connection, uint16_t seq ) {
+    if ( !connection->receive_any ) {
+        connection->receive_seq = seq;
+        connection->receive_ack_bits = 0;
+        connection->receive_any = true;
+        return;
+    }
+
+    if ( net_transport_sequence_greater ( seq, connection->receive_seq ) ) {
+        uint16_t shift = ( uint16_t ) ( seq - connection->receive_seq );
+        // Bit n acks receive_seq - 1 - n, the old latest takes the bit at shift - 1
+        connection->receive_ack_bits = shift >= 32 ? 0 : connection->receive_ack_bits << shift;
+
+        if ( shift <= 32 ) {
+            connection->receive_ack_bits |= 1u << ( shift - 1 );
+        }
+
+        connection->receive_seq = seq;
+    } else {
+        uint16_t distance = ( uint16_t ) ( connection->receive_seq - seq );
+
+        if ( distance >= 1 && distance <= 32 ) {
+            connection->receive_ack_bits |= 1u << ( distance - 1 );
+        }
+    }
+}
+
+static void net_transport_receive_acks ( net_transport_t* transport, net_transport_connection_t* connection, uint16_t ack, uint32_t ack_bits ) {
+    for ( uint32_t i = 0; i <= 32; ++i ) {
+        if ( i > 0 && !( ack_bits & ( 1u << ( i - 1 ) ) ) ) {
+            continue;
+        }
+
+        uint16_t seq = ( uint16_t ) ( ack - i );
+        net_transport_sent_packet_t* record = &connection->sent_packets[seq % net_transport_sent_packets_size_m];
+
+        if ( !record->used || record->seq != seq || record->acked ) {
+            continue;
+        }
+
+        record->acked = true;
+
+        // Acks of older packets in the bitfield can come a long time after they were received, only the latest is timed
+        if ( i == 0 ) {
+            double sample = transport->now - record->send_time;
+            connection->rtt_ms = connection->rtt_sampled ? connection->rtt_ms + ( sample - connection->rtt_ms ) * net_transport_rtt_smoothing_m : sample;
+            connection->rtt_sampled = true;
+        }
+
+        // In slow start each acked byte adds a byte per round trip, so a round trip worth of acks doubles the rate.
+        // After that it's about one packet per second more for every packet that made it.
+        double increase = connection->slow_start ? record->size * 1000.0 / std_max_f64 ( connection->rtt_ms, 1 ) : net_transport_packet_size_m;
+        connection->send_rate = std_min_f64 ( connection->send_rate + increase, net_transport_max_send_rate_m );
+
+        for ( uint32_t j = 0; j < record->fragment_count; ++j ) {
+            net_transport_fragment_ref_t* ref = &record->fragments[j];
+            net_transport_channel_t* channel = &connection->channels[ref->channel];
+            net_transport_fragment_t* fragment = &channel->send_fragments[ref->id % net_transport_window_size_m];
+
+            if ( fragment->used && fragment->id == ref->id && !fragment->acked ) {
+                fragment->acked = true;
+                std_virtual_heap_free ( fragment->data );
+                fragment->data = NULL;
+            }
+        }
+    }
+
+    net_transport_sent_packet_t* latest = &connection->sent_packets[ack % net_transport_sent_packets_size_m];
+
+    if ( latest->used && latest->seq == ack ) {
+        for ( uint32_t i = net_transport_fast_resend_packets_m; i <= 32; ++i ) {
+            uint16_t seq = ( uint16_t ) ( ack - i );
+            net_transport_sent_packet_t* record = &connection->sent_packets[seq % net_transport_sent_packets_size_m];
+
+            if ( ( ack_bits & ( 1u << ( i - 1 ) ) ) || !record->used || record->seq != seq || record->acked || record->lost ) {
+                continue;
+            }
+
+            if ( latest->send_time - record->send_time < connection->rtt_ms * net_transport_fast_resend_rtt_m ) {
+                continue;
+            }
+
+            record->lost = true;
+
+            // Only the fragments that weren't sent again since, a zero send time makes them due right away
+            for ( uint32_t j = 0; j < record->fragment_count; ++j ) {
+                net_transport_fragment_ref_t* ref = &record->fragments[j];
+                net_transport_channel_t* channel = &connection->channels[ref->channel];
+                net_transport_fragment_t* fragment = &channel->send_fragments[ref->id % net_transport_window_size_m];
+
+                if ( fragment->used && fragment->id == ref->id && !fragment->acked && fragment->send_time == record->send_time ) {
+                    fragment->send_time = 0;
+                }
+            }
+        }
+    }
+
+    for ( uint32_t i = 0; i < transport->params.channel_count; ++i ) {
+        net_transport_channel_t* channel = &connection->channels[i];
+
+        if ( channel->type != net_transport_channel_reliable_ordered_m ) {
+            continue;
+        }
+
+        while ( channel->send_head != channel->send_tail ) {
+            net_transport_fragment_t* fragment = &channel->send_fragments[channel->send_head % net_transport_window_size_m];
+
+            if ( !fragment->acked ) {
+                break;
+            }
+
+            fragment->used = false;
+            ++channel->send_head;
+        }
+    }
+}
+
+static void net_transport_receive_data ( net_transport_t* transport, net_transport_connection_t* connection, net_transport_reader_t* reader ) {
+    uint16_t seq = net_transport_read_u16 ( reader );
+    uint16_t ack = net_transport_read_u16 ( reader );
+    uint32_t ack_bits = net_transport_read_u32 ( reader );
+
+    if ( reader->error ) {
+        return;
+    }
+
+    if ( connection->state == net_transport_connection_accepting_m ) {
+        net_transport_set_connected ( transport, connection );
+    }
+
+    connection->receive_time = transport->now;
+    ++connection->received_packet_count;
+    net_transport_receive_seq ( connection, seq );
+    net_transport_receive_acks ( transport, connection, ack, ack_bits );
+
+    bool channel_received[net_transport_max_channels_m] = { 0 };
+
+    while ( reader->offset < reader->size ) {
+        uint8_t channel_idx = net_transport_read_u8 ( reader );
+        uint8_t flags = net_transport_read_u8 ( reader );
+        uint16_t id = net_transport_read_u16 ( reader );
+        uint16_t size = net_transport_read_u16 ( reader );
+        uint8_t fragment_idx = 0;
+        uint8_t fragment_count = 1;
+
+        if ( flags & net_transport_fragment_flag_split_m ) {
+            fragment_idx = net_transport_read_u8 ( reader );
+            fragment_count = net_transport_read_u8 ( reader );
+        }
+
+        const char* data = net_transport_read_bytes ( reader, size );
+
+        if ( reader->error || channel_idx >= transport->params.channel_count || size > net_transport_fragment_size_m ) {
+            break;
+        }
+
+        if ( fragment_count == 0 || fragment_count > net_transport_max_fragments_m || fragment_idx >= fragment_count ) {
+            break;
+        }
+
+        // Every fragment but the last is full, their offset in the message follows from their index
+        if ( fragment_idx < fragment_count - 1 && size != net_transport_fragment_size_m ) {
+            break;
+        }
+
+        connection->ack_pending = true;
+
+        if ( connection->channels[channel_idx].type == net_transport_channel_reliable_ordered_m ) {
+            net_transport_receive_reliable ( &connection->channels[channel_idx], id, fragment_idx, fragment_count, data, size );
+            channel_received[channel_idx] = true;
+        } else {
+            net_transport_receive_unreliable ( transport, connection, channel_idx, id, fragment_idx, fragment_count, data, size );
+        }
+    }
+
+    for ( uint32_t i = 0; i < transport->params.channel_count; ++i ) {
+        if ( channel_received[i] ) {
+            net_transport_deliver_reliable ( transport, connection, i );
+        }
+    }
+}
+
+static void net_transport_receive_packet ( net_transport_t* transport, const net_socket_address_t* address, const char* data, size_t size ) {
+    net_transport_reader_t reader = { data, size, 0, false };
+    uint8_t type = net_transport_read_u8 ( &reader );
+    net_transport_connection_t* connection = net_transport_find_connection ( transport, address );
+
+    switch ( type ) {
+        case net_transport_packet_connect_request_m: {
+            uint32_t protocol_id = net_transport_read_u32 ( &reader );
+            uint64_t client_salt = net_transport_read_u64 ( &reader );
+            uint8_t channel_count = net_transport_read_u8 ( &reader );
+
+            if ( reader.error || !transport->params.listen || protocol_id != net_transport_protocol_id_m || channel_count != transport->params.channel_count ) {
+                break;
+            }
+
+            if ( connection == NULL ) {
+                connection = net_transport_alloc_connection ( transport, address );
+
+                if ( connection == NULL ) {
+                    break;
+                }
+
+                connection->state = net_transport_connection_accepting_m;
+                connection->client_salt = client_salt;
+                connection->server_salt = net_transport_random_salt ( transport );
+                connection->session = client_salt ^ connection->server_salt;
+            }
+
+            // The accept might have been lost, the client keeps asking until it gets one
+            if ( connection->state == net_transport_connection_accepting_m && connection->client_salt == client_salt ) {
+                net_transport_send_connect_accept ( transport, connection );
+            }
+        } break;
+
+        case net_transport_packet_connect_accept_m: {
+            uint64_t client_salt = net_transport_read_u64 ( &reader );
+            uint64_t server_salt = net_transport_read_u64 ( &reader );
+
+            if ( reader.error || connection == NULL || connection->state != net_transport_connection_connecting_m || connection->client_salt != client_salt ) {
+                break;
+            }
+
+            connection->server_salt = server_salt;
+            connection->session = client_salt ^ server_salt;
+            connection->receive_time = transport->now;
+            net_transport_set_connected ( transport, connection );
+            // The server waits for a data packet before considering the connection established, send one right away
+            connection->ack_pending = true;
+        } break;
+
+        case net_transport_packet_data_m: {
+            uint64_t session = net_transport_read_u64 ( &reader );
+
+            if ( reader.error || connection == NULL || connection->session != session ) {
+                break;
+            }
+
+            if ( connection->state == net_transport_connection_accepting_m || connection->state == net_transport_connection_connected_m ) {
+                net_transport_receive_data ( transport, connection, &reader );
+            }
+        } break;
+
+        case net_transport_packet_disconnect_m: {
+            uint64_t session = net_transport_read_u64 ( &reader );
+
+            if ( reader.error || connection == NULL || connection->session != session || connection->state == net_transport_connection_connecting_m ) {
+                break;
+            }
+
+            net_transport_drop_connection ( transport, connection );
+        } break;
+
+        default:
+            break;
+    }
+}
+
+static void net_transport_receive ( net_transport_t* transport ) {
+    // Stop reading once the event queue is getting full, what's left waits in the socket buffer for the next update
+    while ( net_transport_event_queue_has_room ( transport ) ) {
+        for ( uint32_t i = 0; i < net_socket_batch_size_m; ++i ) {
+            transport->receive_datagrams[i].data = transport->receive_buffer + i * net_transport_packet_size_m;
+            transport->receive_datagrams[i].size = net_transport_packet_size_m;
+        }
+
+        size_t count = read_socket_batch ( transport->receive_datagrams, net_socket_batch_size_m, transport->socket );
+
+        if ( count == net_would_block_m || count == 0 ) {
+            break;
+        }
+
+        for ( size_t i = 0; i < count; ++i ) {
+            net_datagram_t* datagram = &transport->receive_datagrams[i];
+            net_transport_receive_packet ( transport, &datagram->address, datagram->data, datagram->result_size );
+        }
+
+        if ( count < net_socket_batch_size_m ) {
+            break;
+        }
+    }
+}
+
+static void net_transport_update_connection ( net_transport_t* transport, net_transport_connection_t* connection ) {
+    double now = transport->now;
+
+    if ( now - connection->receive_time > net_transport_timeout_ms_m ) {
+        net_transport_drop_connection ( transport, connection );
+        return;
+    }
+
+    switch ( connection->state ) {
+        case net_transport_connection_connecting_m:
+            if ( now - connection->handshake_time >= net_transport_handshake_resend_ms_m ) {
+                net_transport_send_connect_request ( transport, connection );
+            }
+
+            break;
+
+        case net_transport_connection_connected_m:
+            // Messages held back by a full event queue
+            for ( uint32_t i = 0; i < transport->params.channel_count; ++i ) {
+                if ( connection->channels[i].type == net_transport_channel_reliable_ordered_m ) {
+                    net_transport_deliver_reliable ( transport, connection, i );
+                }
+            }
+
+            net_transport_send_packets ( transport, connection );
+            break;
+
+        default:
+            break;
+    }
+}
+
+// --
+
+void net_transport_init ( void ) {
+    static net_transport_t transports_array[net_transport_max_transports_m];
+    net_transport_state.transports_array = transports_array;
+    net_transport_state.transports_freelist = std_static_freelist_m ( transports_array );
+    std_mem_zero_m ( &net_transport_state.transports_bitset );
+    std_mutex_init ( &net_transport_state.transports_mutex );
+}
+
+void net_transport_deinit ( void ) {
+    uint64_t idx = 0;
+
+    while ( std_bitset_scan ( &idx, net_transport_state.transports_bitset, idx, net_transport_bitset_u64_count_m ) ) {
+        net_transport_destroy ( idx );
+        ++idx;
+    }
+
+    std_mutex_deinit ( &net_transport_state.transports_mutex );
+}
+
+net_transport_h net_transport_create ( const net_transport_params_t* params ) {
+    std_assert_m ( params->channel_count <= net_transport_max_channels_m );
+
+    net_socket_params_t socket_params;
+    socket_params.family = params->family;
+    socket_params.protocol = net_ip_protocol_udp_m;
+    socket_params.is_blocking = false;
+    net_socket_h socket = net_socket_create ( &socket_params );
+
+    if ( socket == net_null_handle_m ) {
+        return net_null_handle_m;
+    }
+
+    if ( !net_socket_bind_address ( socket, &params->address ) ) {
+        std_log_error_m ( "Failed to bind transport socket" );
+        net_socket_destroy ( socket );
+        return net_null_handle_m;
+    }
+
+    std_mutex_lock ( &net_transport_state.transports_mutex );
+    net_transport_t* transport = std_list_pop_m ( &net_transport_state.transports_freelist );
+
+    if ( transport == NULL ) {
+        std_mutex_unlock ( &net_transport_state.transports_mutex );
+        std_log_error_m ( "Transport pool is exhausted" );
+        net_socket_destroy ( socket );
+        return net_null_handle_m;
+    }
+
+    uint64_t idx = ( uint64_t ) ( transport - net_transport_state.transports_array );
+    std_bitset_set ( net_transport_state.transports_bitset, idx );
+    std_mutex_unlock ( &net_transport_state.transports_mutex );
+
+    std_mem_zero_m ( transport );
+    transport->params = *params;
+    transport->socket = socket;
+    transport->rng.a = std_tick_now() ^ ( ( idx + 1 ) * 0x9e3779b97f4a7c15 );
+    transport->now = net_transport_now();
+    transport->events = std_virtual_heap_alloc_array_m ( net_transport_event_t, net_transport_event_queue_size_m );
+    transport->send_buffer = std_virtual_heap_alloc_array_m ( char, net_socket_batch_size_m * net_transport_packet_size_m );
+    transport->receive_buffer = std_virtual_heap_alloc_array_m ( char, net_socket_batch_size_m * net_transport_packet_size_m );
+    transport->simulator_enabled = params->simulator_loss > 0 || params->simulator_latency_ms > 0 || params->simulator_jitter_ms > 0;
+
+    if ( transport->simulator_enabled ) {
+        transport->simulator_packets = std_virtual_heap_alloc_array_m ( net_transport_simulator_packet_t, net_transport_simulator_max_packets_m );
+    }
+
+    return idx;
+}
+
+void net_transport_destroy ( net_transport_h transport_handle ) {
+    std_assert_m ( transport_handle < net_transport_max_transports_m );
+    net_transport_t* transport = &net_transport_state.transports_array[transport_handle];
+
+    for ( uint32_t i = 0; i < net_transport_max_connections_m; ++i ) {
+        if ( transport->connections[i].state != net_transport_connection_free_m ) {
+            net_transport_free_connection ( transport, &transport->connections[i] );
+        }
+    }
+
+    for ( uint32_t i = 0; i < transport->event_count; ++i ) {
+        if ( transport->events[i].data != NULL ) {
+            std_virtual_heap_free ( ( void* ) transport->events[i].data );
+        }
+    }
+
+    if ( transport->simulator_packets != NULL ) {
+        std_virtual_heap_free ( transport->simulator_packets );
+    }
+
+    std_virtual_heap_free ( transport->events );
+    std_virtual_heap_free ( transport->send_buffer );
+    std_virtual_heap_free ( transport->receive_buffer );
+    net_socket_destroy ( transport->socket );
+
+    std_mutex_lock ( &net_transport_state.transports_mutex );
+    std_bitset_clear ( net_transport_state.transports_bitset, transport_handle );
+    std_list_push ( &net_transport_state.transports_freelist, transport );
+    std_mutex_unlock ( &net_transport_state.transports_mutex );
+}
+
+net_transport_connection_h net_transport_connect ( net_transport_h transport_handle, const net_socket_address_t* address ) {
+    std_assert_m ( transport_handle < net_transport_max_transports_m );
+    net_transport_t* transport = &net_transport_state.transports_array[transport_handle];
+    transport->now = net_transport_now();
+
+    if ( net_transport_find_connection ( transport, address ) != NULL ) {
+        std_log_error_m ( "Transport already has a connection with the same address" );
+        return net_null_handle_m;
+    }
+
+    net_transport_connection_t* connection = net_transport_alloc_connection ( transport, address );
+
+    if ( connection == NULL ) {
+        return net_null_handle_m;
+    }
+
+    connection->state = net_transport_connection_connecting_m;
+    connection->client_salt = net_transport_random_salt ( transport );
+    return net_transport_connection_idx ( transport, connection );
+}
+
+void net_transport_disconnect ( net_transport_h transport_handle, net_transport_connection_h connection_handle ) {
+    std_assert_m ( transport_handle < net_transport_max_transports_m );
+    std_assert_m ( connection_handle < net_transport_max_connections_m );
+    net_transport_t* transport = &net_transport_state.transports_array[transport_handle];
+    net_transport_connection_t* connection = &transport->connections[connection_handle];
+    std_assert_m ( connection->state != net_transport_connection_free_m );
+
+    if ( connection->state == net_transport_connection_connected_m ) {
+        net_transport_send_disconnect ( transport, connection );
+        net_transport_flush_datagrams ( transport );
+    }
+
+    net_transport_free_connection ( transport, connection );
+}
+
+bool net_transport_send_message ( net_transport_h transport_handle, net_transport_connection_h connection_handle, uint32_t channel_idx, const void* data, size_t size ) {
+    std_assert_m ( transport_handle < net_transport_max_transports_m );
+    std_assert_m ( connection_handle < net_transport_max_connections_m );
+    net_transport_t* transport = &net_transport_state.transports_array[transport_handle];
+    net_transport_connection_t* connection = &transport->connections[connection_handle];
+    std_assert_m ( channel_idx < transport->params.channel_count );
+    std_assert_m ( size <= net_transport_max_message_size_m );
+
+    if ( connection->state != net_transport_connection_connected_m ) {
+        return false;
+    }
+
+    net_transport_channel_t* channel = &connection->channels[channel_idx];
+    uint32_t fragment_count = size == 0 ? 1 : ( uint32_t ) std_div_ceil_m ( size, net_transport_fragment_size_m );
+    uint32_t queued_count = ( uint16_t ) ( channel->send_tail - channel->send_head );
+    bool reliable = channel->type == net_transport_channel_reliable_ordered_m;
+    uint32_t capacity = reliable ? net_transport_window_size_m : net_transport_unreliable_queue_size_m;
+
+    if ( queued_count + fragment_count > capacity ) {
+        return false;
+    }
+
+    uint16_t message_id = channel->send_message_id++;
+
+    const char* source = ( const char* ) data;
+
+    for ( uint32_t i = 0; i < fragment_count; ++i ) {
+        uint16_t id = channel->send_tail;
+        net_transport_fragment_t* fragment = &channel->send_fragments[id % capacity];
+        size_t offset = ( size_t ) i * net_transport_fragment_size_m;
+        size_t fragment_size = std_min_u64 ( size - offset, net_transport_fragment_size_m );
+
+        fragment->data = net_transport_copy ( source + offset, fragment_size );
+        fragment->size = ( uint16_t ) fragment_size;
+        fragment->id = reliable ? id : message_id;
+        fragment->fragment_idx = ( uint8_t ) i;
+        fragment->fragment_count = ( uint8_t ) fragment_count;
+        fragment->used = true;
+        fragment->acked = false;
+        fragment->send_time = -1;
+        ++channel->send_tail;
+    }
+
+    return true;
+}
+
+size_t net_transport_update ( net_transport_event_t* events, size_t cap, net_transport_h transport_handle ) {
+    std_assert_m ( transport_handle < net_transport_max_transports_m );
+    net_transport_t* transport = &net_transport_state.transports_array[transport_handle];
+    transport->now = net_transport_now();
+
+    net_transport_release_returned_events ( transport );
+
+    if ( transport->simulator_enabled ) {
+        net_transport_simulator_update ( transport );
+    }
+
+    net_transport_receive ( transport );
+
+    for ( uint32_t i = 0; i < net_transport_max_connections_m; ++i ) {
+        if ( transport->connections[i].state != net_transport_connection_free_m ) {
+            net_transport_update_connection ( transport, &transport->connections[i] );
+        }
+    }
+
+    net_transport_flush_datagrams ( transport );
+
+    size_t count = std_min_u64 ( cap, transport->event_count );
+    std_mem_copy ( events, transport->events, count * sizeof ( net_transport_event_t ) );
+    transport->returned_event_count = ( uint32_t ) count;
+    return count;
+}
+
+bool net_transport_get_connection_info ( net_transport_connection_info_t* info, net_transport_h transport_handle, net_transport_connection_h connection_handle ) {
+    std_assert_m ( transport_handle < net_transport_max_transports_m );
+    std_assert_m ( connection_handle < net_transport_max_connections_m );
+    net_transport_t* transport = &net_transport_state.transports_array[transport_handle];
+    net_transport_connection_t* connection = &transport->connections[connection_handle];
+
+    if ( connection->state == net_transport_connection_free_m ) {
+        return false;
+    }
+
+    info->rtt_ms = ( float ) connection->rtt_ms;
+    info->send_rate = ( float ) connection->send_rate;
+    info->sent_packets = connection->sent_packet_count;
+    info->received_packets = connection->received_packet_count;
+    info->resent_fragments = connection->resent_fragment_count;
+    return true;
+}
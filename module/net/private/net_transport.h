@@ -0,0 +1,17 @@
+#pragma once
+
+#include <net.h>
+
+void net_transport_init ( void );
+void net_transport_deinit ( void );
+
+net_transport_h net_transport_create ( const net_transport_params_t* params );
+void net_transport_destroy ( net_transport_h transport );
+
+net_transport_connection_h net_transport_connect ( net_transport_h transport, const net_socket_address_t* address );
+void net_transport_disconnect ( net_transport_h transport, net_transport_connection_h connection );
+
+bool net_transport_send_message ( net_transport_h transport, net_transport_connection_h connection, uint32_t channel, const void* data, size_t size );
+size_t net_transport_update ( net_transport_event_t* events, size_t cap, net_transport_h transport );
+
+bool net_transport_get_connection_info ( net_transport_connection_info_t* info, net_transport_h transport, net_transport_connection_h connection );
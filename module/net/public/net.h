@@ -3,6 +3,7 @@
 #include <std_module.h>
 #include <std_byte.h>
 #include <std_platform.h>
+#include <std_allocator.h>
 
 #define net_module_name_m net
 std_module_export_m void* net_load ( void* );
@@ -60,21 +61,177 @@ typedef struct {
     bool is_blocking;
 } net_socket_params_t;
 
+// Returned by reads and writes on non blocking sockets when the call would block
+#define net_would_block_m SIZE_MAX
+
+// Datagram batches
+// One entry per datagram, on writes address is the destination and data holds size bytes. On reads data has room for
+// size bytes and address is filled with the source. result_size is set to how much went through on both, datagrams
+// bigger than the read buffer are truncated.
+typedef struct {
+    net_socket_address_t address;
+    void* data;
+    size_t size;
+    size_t result_size;
+} net_datagram_t;
+
+// Buffers
+// Fixed size buffers from a pool owned by net. They're mapped once and then reused, so zero copy sends out of them
+// don't keep faulting in new pages. Fill one in place and hand it to a socket with write_connected_socket_buffer.
+typedef uint64_t net_buffer_h;
+
+typedef struct {
+    net_buffer_h handle;
+    void* base;
+    size_t size;
+} net_buffer_t;
+
+// Poller
+// Waits on readiness of many sockets at once, backed by epoll on Linux and by WSAPoll on Win32.
+// On Linux notifications are edge triggered: an event is only reported when the socket state changes, so after a read
+// or write event the socket has to be read or written until it returns net_would_block_m before waiting on it again.
+// Win32 is level triggered, draining the sockets works the same way on both.
+// A socket can only be added to one poller at a time. Errors and hangups are always reported, even if not asked for.
+// Waiting can happen on multiple threads at the same time, e.g. from tk tasks, with each ready event returned to only
+// one of the waiters on Linux.
+typedef uint64_t net_poller_h;
+
+typedef enum {
+    net_poll_read_m     = 1 << 0,
+    net_poll_write_m    = 1 << 1,
+    net_poll_error_m    = 1 << 2,
+    // The peer closed its side of the connection, what it sent before closing can still be read
+    net_poll_hangup_m   = 1 << 3,
+} net_poll_events_b;
+
+typedef struct {
+    net_socket_h socket;
+    net_poll_events_b events;
+    void* user_data;
+} net_poll_event_t;
+
+#define net_poller_wait_infinite_m UINT64_MAX
+
+// Transport
+// Connections with reliable and unreliable message channels on top of a single UDP socket, meant for state sync where
+// a lost packet shouldn't stall everything sent after it like on TCP. Every packet acks the last 33 packets received
+// from the other side, only the reliable messages that were in packets that didn't get acked in time are resent.
+// Messages bigger than a packet are split in fragments and reassembled on the other side. Sending is paced by a rate
+// that grows while packets get acked and backs off on loss.
+// A transport isn't thread safe, all calls on it should come from one thread at a time.
+typedef uint64_t net_transport_h;
+typedef uint64_t net_transport_connection_h;
+
+typedef enum {
+    // Delivered once, in the order they were sent
+    net_transport_channel_reliable_ordered_m,
+    // Can be lost, messages older than the last delivered one are dropped
+    net_transport_channel_unreliable_sequenced_m,
+} net_transport_channel_type_e;
+
+typedef struct {
+    // Port 0 lets the OS pick one, e.g. for transports that only connect out
+    net_socket_address_t address;
+    net_address_family_e family;
+    net_transport_channel_type_e channels[net_transport_max_channels_m];
+    uint32_t channel_count;
+    // Accept connections from others
+    bool listen;
+    // Simulated network conditions, applied to every packet the transport sends. Loss is from 0 to 1.
+    float simulator_loss;
+    float simulator_latency_ms;
+    float simulator_jitter_ms;
+} net_transport_params_t;
+
+typedef enum {
+    net_transport_event_connected_m,
+    // Either side disconnected or the connection timed out, the handle isn't valid anymore
+    net_transport_event_disconnected_m,
+    net_transport_event_message_m,
+} net_transport_event_type_e;
+
+typedef struct {
+    net_transport_event_type_e type;
+    net_transport_connection_h connection;
+    uint32_t channel;
+    // Message data, valid until the next update
+    const void* data;
+    size_t size;
+} net_transport_event_t;
+
+typedef struct {
+    float rtt_ms;
+    // Bytes per second the connection is currently allowed to send
+    float send_rate;
+    uint64_t sent_packets;
+    uint64_t received_packets;
+    uint64_t resent_fragments;
+} net_transport_connection_info_t;
+
 // API
 typedef struct {
     net_socket_h    ( *create_socket )                      ( const net_socket_params_t* params );
     bool            ( *destroy_socket )                     ( net_socket_h socket );
     bool            ( *bind_socket )                        ( net_socket_h socket, const net_socket_address_t* address );
+    // On non blocking sockets the connection can still be in progress when this returns, the socket becomes writable
+    // once it's established
     bool            ( *connect_socket )                     ( net_socket_h socket, const net_socket_address_t* address );
     bool            ( *listen_for_connections )             ( net_socket_h socket );
+    // Returns net_null_handle_m if there's no pending connection. Accepted sockets inherit is_blocking from the listener.
     net_socket_h    ( *accept_pending_connection )          ( net_socket_address_t* address, net_socket_h socket );
 
     size_t          ( *get_socket_available_read_size )     ( net_socket_h socket );
     size_t          ( *read_connected_socket )              ( void* dest, size_t cap,  net_socket_h socket );
     size_t          ( *write_connected_socket )             ( net_socket_h socket, const void* data, size_t size );
+    // Writes the buffers back to back in one call, returns how much was written like write_connected_socket
+    size_t          ( *write_connected_socket_gather )      ( net_socket_h socket, const std_buffer_t* buffers, size_t count );
     size_t          ( *read_socket )                        ( net_socket_address_t* address, void* dest, size_t cap,  net_socket_h socket );
     size_t          ( *write_socket )                       ( net_socket_h socket, const net_socket_address_t* address, const void* data, size_t size );
+    // Batched versions of read_socket and write_socket, they return how many datagrams went through. Blocking reads
+    // wait for the first datagram only. On Linux these map to recvmmsg and sendmmsg, runs of same sized datagrams to the
+    // same address are sent as one with UDP segmentation offload and reads coalesce with UDP GRO.
+    size_t          ( *read_socket_batch )                  ( net_datagram_t* datagrams, size_t count, net_socket_h socket );
+    size_t          ( *write_socket_batch )                 ( net_socket_h socket, net_datagram_t* datagrams, size_t count );
 
     bool            ( *ip_string_to_bytes )                 ( net_address_bytes_t* dest, const char* address, net_address_family_e family );
     bool            ( *ip_bytes_to_string )                 ( char* dest, const net_address_bytes_t* address, net_address_family_e family );
+
+    // Returns a buffer with a null handle if the pool is empty
+    net_buffer_t    ( *acquire_buffer )                     ( void );
+    void            ( *release_buffer )                     ( net_buffer_h buffer );
+    // Queues the first size bytes of the buffer on the socket and sends as much of the queue as it takes. The socket
+    // owns the buffer from then on and releases it once it's sent. On Linux large sends use MSG_ZEROCOPY, in that case
+    // the buffer is released when the kernel reports it's done reading from it. Blocking sockets return once the
+    // whole queue is sent. Returns false, leaving the buffer to the caller, if the queue of a non blocking socket is
+    // full or the connection failed. Don't mix with the other writes while data is queued.
+    bool            ( *write_connected_socket_buffer )      ( net_socket_h socket, net_buffer_h buffer, size_t size );
+    // Sends what the socket takes of the queued buffers and releases the ones that are done, returns the size that's
+    // still waiting to be sent. Call it when a non blocking socket becomes writable.
+    size_t          ( *flush_connected_socket )             ( net_socket_h socket );
+
+    net_poller_h    ( *create_poller )                      ( void );
+    // Sockets still in the poller are removed
+    void            ( *destroy_poller )                     ( net_poller_h poller );
+    bool            ( *add_poller_socket )                  ( net_poller_h poller, net_socket_h socket, net_poll_events_b events, void* user_data );
+    bool            ( *modify_poller_socket )               ( net_poller_h poller, net_socket_h socket, net_poll_events_b events, void* user_data );
+    bool            ( *remove_poller_socket )               ( net_poller_h poller, net_socket_h socket );
+    // Returns as soon as at least one event is ready or when the timeout expires, in which case it returns 0
+    size_t          ( *wait_poller )                        ( net_poll_event_t* events, size_t cap, net_poller_h poller, uint64_t timeout_ms );
+
+    // Returns net_null_handle_m if the socket can't be created or bound
+    net_transport_h ( *create_transport )                   ( const net_transport_params_t* params );
+    // Connections are dropped without notifying the other side
+    void            ( *destroy_transport )                  ( net_transport_h transport );
+    // The connection starts once the transport is updated, the connected or disconnected event tells how it went.
+    // Both sides need to use the same channel setup.
+    net_transport_connection_h ( *connect_transport )       ( net_transport_h transport, const net_socket_address_t* address );
+    void            ( *disconnect_transport )               ( net_transport_h transport, net_transport_connection_h connection );
+    // The message is copied and goes out on the next update. Returns false if the connection isn't established or, on
+    // reliable channels, if the send window has no room left for it and the message should be retried later.
+    // Max size is net_transport_max_message_size_m.
+    bool            ( *send_transport_message )             ( net_transport_h transport, net_transport_connection_h connection, uint32_t channel, const void* data, size_t size );
+    // Sends and receives everything that's ready without blocking and returns up to cap events, call this often.
+    // Events that don't fit are returned by the next calls.
+    size_t          ( *update_transport )                   ( net_transport_event_t* events, size_t cap, net_transport_h transport );
+    bool            ( *get_transport_connection_info )      ( net_transport_connection_info_t* info, net_transport_h transport, net_transport_connection_h connection );
 } net_i;
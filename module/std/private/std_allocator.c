@@ -75,7 +75,9 @@ bool std_virtual_unmap ( void* from, void* to ) {
 #ifdef std_platform_win32_m
     result = VirtualFree ( from, size, MEM_DECOMMIT ) == TRUE;
 #elif defined(std_platform_linux_m)
-    result = mprotect ( from, size, PROT_NONE ) == 0;
+    // mprotect alone keeps the pages resident, drop them first so that unmap matches the win32 decommit
+    result = madvise ( from, size, MADV_DONTNEED ) == 0;
+    result &= mprotect ( from, size, PROT_NONE ) == 0;
 #endif
 
     // TODO see above
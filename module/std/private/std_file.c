@@ -33,6 +33,7 @@ void std_filetime_to_timestamp ( uint64_t filetime, std_timestamp_t* timestamp )
 #include <dirent.h>
 #include <ftw.h>
 #include <limits.h>
+#include <sys/uio.h>
 
 void std_filetime_to_timestamp ( struct timespec ts, std_timestamp_t* timestamp );
 
@@ -178,16 +179,14 @@ static size_t std_path_append_n ( char* path, size_t cap, const char* append, si
     std_assert_m ( path != NULL );
     std_assert_m ( append != NULL );
     size_t path_len = std_str_len ( path );
-    size_t extra = 0;
 
     if ( path_len > 0 && path[path_len - 1] != '/' && append[0] != '/' && path_len + 1 < cap ) {
         path[path_len++] = '/';
         path[path_len] = '\0';
-        extra = 1;
     }
 
     size_t append_len = n;
-    size_t new_path_len = path_len + append_len + extra;
+    size_t new_path_len = path_len + append_len;
     std_assert_m ( new_path_len < cap );
     std_mem_copy ( path + path_len, append, append_len );
     path[new_path_len] = '\0';
@@ -806,6 +805,120 @@ next:
 #endif
 }
 
+#if defined(std_platform_linux_m)
+// getdents64 record layout, glibc only exposes these through readdir
+typedef struct {
+    uint64_t ino;
+    int64_t off;
+    uint16_t reclen;
+    uint8_t type;
+    char name[];
+} std_linux_dirent64_t;
+
+#define std_directory_scan_buffer_size_m ( 32 * 1024 )
+
+static void std_directory_scan_stat ( std_directory_entry_t* entry, int dir_fd, const std_linux_dirent64_t* item ) {
+    struct statx info;
+    int result = statx ( dir_fd, item->name, AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME, &info );
+
+    if ( result != 0 ) {
+        // Deleted since the listing or not accessible, keep what the listing knows
+        entry->flags = item->type == DT_DIR ? std_path_is_directory_m : item->type == DT_REG ? std_path_is_file_m : 0;
+        entry->size = 0;
+        entry->last_write_time.count = 0;
+        return;
+    }
+
+    entry->flags = S_ISDIR ( info.stx_mode ) ? std_path_is_directory_m : S_ISREG ( info.stx_mode ) ? std_path_is_file_m : 0;
+    entry->size = info.stx_size;
+    struct timespec last_write_time = { .tv_sec = info.stx_mtime.tv_sec, .tv_nsec = info.stx_mtime.tv_nsec };
+    std_filetime_to_timestamp ( last_write_time, &entry->last_write_time );
+}
+#endif
+
+size_t std_directory_scan ( std_directory_entry_t* entries, size_t entries_cap, const char* path ) {
+    std_assert_m ( path != NULL );
+#if defined(std_platform_win32_m)
+    size_t len = std_to_path_buffer ( path );
+    std_assert_m ( len > 0 && len + 2 < std_path_size_m );
+    size_t end = len - 1;
+
+    if ( end > 0 && t_path_buffer[end - 1] != L'/' && t_path_buffer[end - 1] != L'\\' ) {
+        t_path_buffer[end++] = L'/';
+    }
+
+    t_path_buffer[end++] = L'*';
+    t_path_buffer[end] = L'\0';
+
+    // Basic info skips the short names, large fetch asks for bigger batches from the file system
+    WIN32_FIND_DATAW item;
+    HANDLE find_handle = FindFirstFileExW ( t_path_buffer, FindExInfoBasic, &item, FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH );
+
+    if ( find_handle == INVALID_HANDLE_VALUE ) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    do {
+        if ( item.cFileName[0] == L'.' && ( item.cFileName[1] == L'\0' || ( item.cFileName[1] == L'.' && item.cFileName[2] == L'\0' ) ) ) {
+            continue;
+        }
+
+        if ( count < entries_cap ) {
+            std_directory_entry_t* entry = &entries[count];
+            std_path_to_str ( item.cFileName, entry->name, std_directory_entry_name_size_m );
+            entry->flags = item.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ? std_path_is_directory_m : std_path_is_file_m;
+            entry->size = ( uint64_t ) item.nFileSizeHigh << 32 | item.nFileSizeLow;
+            uint64_t last_write_time = ( uint64_t ) item.ftLastWriteTime.dwHighDateTime << 32 | item.ftLastWriteTime.dwLowDateTime;
+            std_filetime_to_timestamp ( last_write_time, &entry->last_write_time );
+        }
+
+        ++count;
+    } while ( FindNextFileW ( find_handle, &item ) );
+
+    FindClose ( find_handle );
+    return count;
+#elif defined(std_platform_linux_m)
+    int dir_fd = open ( path, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+    if ( dir_fd == -1 ) {
+        return 0;
+    }
+
+    uint64_t buffer[std_directory_scan_buffer_size_m / sizeof ( uint64_t )];
+    size_t count = 0;
+
+    for ( ;; ) {
+        long read_size = syscall ( SYS_getdents64, dir_fd, buffer, sizeof ( buffer ) );
+
+        if ( read_size <= 0 ) {
+            break;
+        }
+
+        for ( long offset = 0; offset < read_size; ) {
+            const std_linux_dirent64_t* item = ( const std_linux_dirent64_t* ) ( ( char* ) buffer + offset );
+            offset += item->reclen;
+
+            if ( std_str_cmp ( item->name, "." ) == 0 || std_str_cmp ( item->name, ".." ) == 0 ) {
+                continue;
+            }
+
+            if ( count < entries_cap ) {
+                std_directory_entry_t* entry = &entries[count];
+                std_str_copy ( entry->name, std_directory_entry_name_size_m, item->name );
+                std_directory_scan_stat ( entry, dir_fd, item );
+            }
+
+            ++count;
+        }
+    }
+
+    close ( dir_fd );
+    return count;
+#endif
+}
+
 bool std_directory_info ( std_directory_info_t* info, const char* path ) {
     std_assert_m ( path != NULL );
     std_assert_m ( info != NULL );
@@ -1192,14 +1305,9 @@ void* std_file_map ( std_file_h file, size_t size, std_file_map_permits_t permit
         prot |= PROT_EXEC;
     }
 
-    int flags = 0;
-
-    if ( permits & std_file_map_copy_on_write_m ) {
-        flags |= MAP_PRIVATE;
-    }
+    // One of MAP_SHARED and MAP_PRIVATE is required
+    int flags = ( permits & std_file_map_copy_on_write_m ) ? MAP_PRIVATE : MAP_SHARED;
 
-    std_file_info_t file_info;
-    std_file_info ( &file_info, file );
     void* map = mmap ( NULL, size, prot, flags, ( int ) file, 0 );
 
     if ( map == MAP_FAILED ) {
@@ -1300,6 +1408,168 @@ bool std_file_write ( std_file_h file, const void* source, size_t size ) {
 #endif
 }
 
+// Moves the cursor size bytes forward over the buffers
+static void std_file_buffers_advance ( size_t* buffer_idx, size_t* buffer_offset, const std_buffer_t* buffers, size_t count, uint64_t size ) {
+    size_t idx = *buffer_idx;
+    size_t offset = *buffer_offset;
+
+    while ( idx < count && size >= buffers[idx].size - offset ) {
+        size -= buffers[idx].size - offset;
+        offset = 0;
+        ++idx;
+    }
+
+    *buffer_idx = idx;
+    *buffer_offset = offset + size;
+}
+
+#if defined(std_platform_linux_m)
+// Buffers are passed to the kernel in batches of this many iovecs, always within IOV_MAX
+#define std_file_iovec_batch_m 256
+
+// Fills up to std_file_iovec_batch_m iovecs starting from the cursor
+static int std_file_buffers_to_iovecs ( struct iovec* iovecs, const std_buffer_t* buffers, size_t count, size_t buffer_idx, size_t buffer_offset ) {
+    int iovec_count = 0;
+
+    for ( size_t i = buffer_idx; i < count && iovec_count < std_file_iovec_batch_m; ++i ) {
+        size_t skip = i == buffer_idx ? buffer_offset : 0;
+        iovecs[iovec_count].iov_base = buffers[i].base + skip;
+        iovecs[iovec_count].iov_len = buffers[i].size - skip;
+        ++iovec_count;
+    }
+
+    return iovec_count;
+}
+#endif
+
+uint64_t std_file_read_at ( void* dest, size_t size, std_file_h file, uint64_t offset ) {
+    std_buffer_t buffer = std_buffer_m ( .base = dest, .size = size );
+    return std_file_read_scatter ( &buffer, 1, file, offset );
+}
+
+bool std_file_write_at ( std_file_h file, const void* source, size_t size, uint64_t offset ) {
+    std_buffer_t buffer = std_buffer_m ( .base = ( void* ) source, .size = size );
+    return std_file_write_gather ( file, &buffer, 1, offset );
+}
+
+uint64_t std_file_read_scatter ( const std_buffer_t* buffers, size_t count, std_file_h file, uint64_t offset ) {
+    uint64_t total_read_size = 0;
+    size_t buffer_idx = 0;
+    size_t buffer_offset = 0;
+
+#if defined(std_platform_win32_m)
+    while ( buffer_idx < count ) {
+        if ( buffers[buffer_idx].size == buffer_offset ) {
+            ++buffer_idx;
+            buffer_offset = 0;
+            continue;
+        }
+
+        uint64_t read_offset = offset + total_read_size;
+        OVERLAPPED overlapped;
+        std_mem_zero_m ( &overlapped );
+        overlapped.Offset = ( DWORD ) read_offset;
+        overlapped.OffsetHigh = ( DWORD ) ( read_offset >> 32 );
+        DWORD remaining_size = std_min ( UINT32_MAX, buffers[buffer_idx].size - buffer_offset );
+        DWORD read_size;
+        BOOL read_retcode = ReadFile ( ( HANDLE ) file, buffers[buffer_idx].base + buffer_offset, remaining_size, &read_size, &overlapped );
+
+        if ( read_retcode == FALSE ) {
+            DWORD error = GetLastError();
+
+            if ( error == ERROR_HANDLE_EOF ) {
+                break;
+            }
+
+            std_log_warn_m ( "File read failed with code " std_fmt_u32_m, error );
+            return std_file_read_error_m;
+        }
+#elif defined(std_platform_linux_m)
+    struct iovec iovecs[std_file_iovec_batch_m];
+
+    while ( buffer_idx < count ) {
+        int iovec_count = std_file_buffers_to_iovecs ( iovecs, buffers, count, buffer_idx, buffer_offset );
+        ssize_t read_size = preadv ( ( int ) file, iovecs, iovec_count, ( off_t ) ( offset + total_read_size ) );
+
+        if ( read_size == -1 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            std_log_warn_m ( "File read failed with code " std_fmt_i32_m ": " std_fmt_str_m, errno, strerror ( errno ) );
+            return std_file_read_error_m;
+        }
+#endif
+
+        size_t prev_buffer_idx = buffer_idx;
+        std_file_buffers_advance ( &buffer_idx, &buffer_offset, buffers, count, ( uint64_t ) read_size );
+        total_read_size += ( uint64_t ) read_size;
+
+        // Nothing read with data left to read means EOF, empty buffers are skipped by advance
+        if ( read_size == 0 && buffer_idx == prev_buffer_idx ) {
+            break;
+        }
+    }
+
+    return total_read_size;
+}
+
+bool std_file_write_gather ( std_file_h file, const std_buffer_t* buffers, size_t count, uint64_t offset ) {
+    uint64_t total_write_size = 0;
+    size_t buffer_idx = 0;
+    size_t buffer_offset = 0;
+
+#if defined(std_platform_win32_m)
+    while ( buffer_idx < count ) {
+        if ( buffers[buffer_idx].size == buffer_offset ) {
+            ++buffer_idx;
+            buffer_offset = 0;
+            continue;
+        }
+
+        uint64_t write_offset = offset + total_write_size;
+        OVERLAPPED overlapped;
+        std_mem_zero_m ( &overlapped );
+        overlapped.Offset = ( DWORD ) write_offset;
+        overlapped.OffsetHigh = ( DWORD ) ( write_offset >> 32 );
+        DWORD remaining_size = std_min ( UINT32_MAX, buffers[buffer_idx].size - buffer_offset );
+        DWORD write_size;
+        BOOL write_retcode = WriteFile ( ( HANDLE ) file, buffers[buffer_idx].base + buffer_offset, remaining_size, &write_size, &overlapped );
+
+        if ( write_retcode == FALSE ) {
+            std_log_warn_m ( "File write failed with code " std_fmt_u32_m, GetLastError() );
+            return false;
+        }
+#elif defined(std_platform_linux_m)
+    struct iovec iovecs[std_file_iovec_batch_m];
+
+    while ( buffer_idx < count ) {
+        int iovec_count = std_file_buffers_to_iovecs ( iovecs, buffers, count, buffer_idx, buffer_offset );
+        ssize_t write_size = pwritev ( ( int ) file, iovecs, iovec_count, ( off_t ) ( offset + total_write_size ) );
+
+        if ( write_size == -1 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+
+            std_log_warn_m ( "File write failed with code " std_fmt_i32_m ": " std_fmt_str_m, errno, strerror ( errno ) );
+            return false;
+        }
+#endif
+
+        size_t prev_buffer_idx = buffer_idx;
+        std_file_buffers_advance ( &buffer_idx, &buffer_offset, buffers, count, ( uint64_t ) write_size );
+        total_write_size += ( uint64_t ) write_size;
+
+        if ( write_size == 0 && buffer_idx == prev_buffer_idx ) {
+            std_log_warn_m ( "File write made no progress" );
+            return false;
+        }
+    }
+
+    return true;
+}
+
 bool std_file_seek ( std_file_h file, std_file_point_t base, int64_t offset ) {
 #if defined(std_platform_win32_m)
     DWORD method;
@@ -25,6 +25,14 @@ void std_mutex_lock ( std_mutex_t* mutex ) {
 #endif
 }
 
+bool std_mutex_try_lock ( std_mutex_t* mutex ) {
+#if defined(std_platform_win32_m)
+    return TryEnterCriticalSection ( &mutex->os ) == TRUE;
+#elif defined(std_platform_linux_m)
+    return pthread_mutex_trylock ( &mutex->os ) == 0;
+#endif
+}
+
 void std_mutex_unlock ( std_mutex_t* mutex ) {
 #if defined(std_platform_win32_m)
     LeaveCriticalSection ( &mutex->os );
@@ -149,3 +157,44 @@ cas:
 void std_spinlock_unlock ( std_spinlock_t* spinlock ) {
     spinlock->state = 0;
 }
+
+void std_condition_variable_init ( std_condition_variable_t* cv ) {
+#if defined(std_platform_win32_m)
+    InitializeConditionVariable ( &cv->os );
+#elif defined(std_platform_linux_m)
+    pthread_cond_init ( &cv->os, NULL );
+#endif
+}
+
+void std_condition_variable_wait ( std_condition_variable_t* cv, std_mutex_t* mutex ) {
+#if defined(std_platform_win32_m)
+    SleepConditionVariableCS ( &cv->os, &mutex->os, INFINITE );
+#elif defined(std_platform_linux_m)
+    pthread_cond_wait ( &cv->os, &mutex->os );
+#endif
+}
+
+void std_condition_variable_wake ( std_condition_variable_t* cv ) {
+#if defined(std_platform_win32_m)
+    WakeConditionVariable ( &cv->os );
+#elif defined(std_platform_linux_m)
+    pthread_cond_signal ( &cv->os );
+#endif
+}
+
+void std_condition_variable_wake_all ( std_condition_variable_t* cv ) {
+#if defined(std_platform_win32_m)
+    WakeAllConditionVariable ( &cv->os );
+#elif defined(std_platform_linux_m)
+    pthread_cond_broadcast ( &cv->os );
+#endif
+}
+
+void std_condition_variable_deinit ( std_condition_variable_t* cv ) {
+#if defined(std_platform_win32_m)
+    // Win32 condition variables don't need a destructor
+    std_unused_m ( cv );
+#elif defined(std_platform_linux_m)
+    pthread_cond_destroy ( &cv->os );
+#endif
+}
@@ -65,50 +65,67 @@ void std_sort_insertion_copy ( void* _dest, const void* _base, size_t stride, si
     }
 }
 
-// https://rosettacode.org/wiki/Sorting_algorithms/Quicksort
+static void std_sort_swap ( char* base, size_t stride, size_t a, size_t b, void* tmp ) {
+    std_mem_copy ( tmp, base + a * stride, stride );
+    std_mem_copy ( base + a * stride, base + b * stride, stride );
+    std_mem_copy ( base + b * stride, tmp, stride );
+}
+
+// Three way partition around the middle element. Keys equal to the pivot are gathered in the middle and left out of
+// both sides, so runs of equal keys take linear time. The smaller side is recursed into and the larger one is looped
+// on, which keeps the stack depth under log2 ( count ).
 static void std_sort_quick_rec ( void* _base, size_t stride, size_t a, size_t b, std_sort_comp_f* compare, const void* compare_arg, void* tmp ) {
     char* base = ( char* ) ( _base );
 
-    if ( a == b ) {
-        return;
-    }
+    while ( a < b ) {
+        // partition, [a, lt) < pivot, [lt, i) == pivot, ( gt, b] > pivot
+        // The pivot is parked at a, swaps can move it but [lt] always holds a key equal to it
+        std_sort_swap ( base, stride, a + ( b - a ) / 2, a, tmp );
+        size_t lt = a;
+        size_t i = a + 1;
+        size_t gt = b;
+
+        while ( i <= gt ) {
+            int result = compare ( base + i * stride, base + lt * stride, compare_arg );
+
+            if ( result < 0 ) {
+                std_sort_swap ( base, stride, i, lt, tmp );
+                ++lt;
+                ++i;
+            } else if ( result > 0 ) {
+                std_sort_swap ( base, stride, i, gt, tmp );
+                --gt;
+            } else {
+                ++i;
+            }
+        }
 
-    // partition
-    size_t i = a;
-    size_t j = b;
-    void* pivot = base + i * stride;
+        // rec call
+        if ( lt - a < b - gt ) {
+            if ( lt > a ) {
+                std_sort_quick_rec ( base, stride, a, lt - 1, compare, compare_arg, tmp );
+            }
 
-    while ( i < j ) {
-        while ( compare ( base + j * stride, pivot, compare_arg ) > 0 ) {
-            --j;
-        }
+            a = gt + 1;
+        } else {
+            if ( gt < b ) {
+                std_sort_quick_rec ( base, stride, gt + 1, b, compare, compare_arg, tmp );
+            }
 
-        while ( compare ( base + i * stride, pivot, compare_arg ) < 0 ) {
-            ++i;
-        }
+            if ( lt == a ) {
+                break;
+            }
 
-        if ( i < j ) {
-            // Swap i and j
-            std_mem_copy ( tmp, base + i * stride, stride );
-            std_mem_copy ( base + i * stride, base + j * stride, stride );
-            std_mem_copy ( base + j * stride, tmp, stride );
-            --j;
-            ++i;
+            b = lt - 1;
         }
     }
-
-    // Swap a and j
-    std_mem_copy ( tmp, base + a * stride, stride );
-    std_mem_copy ( base + a * stride, base + j * stride, stride );
-    std_mem_copy ( base + j * stride, tmp, stride );
-
-    // rec call
-    std_sort_quick_rec ( base, stride, a, j, compare, compare_arg, tmp );
-    std_sort_quick_rec ( base, stride, j + 1, b, compare, compare_arg, tmp );
 }
 
-// TODO test this
 void std_sort_quick ( void* base, size_t stride, size_t count, std_sort_comp_f* compare, const void* compare_arg, void* tmp ) {
+    if ( count < 2 ) {
+        return;
+    }
+
     std_sort_quick_rec ( base, stride, 0, count - 1, compare, compare_arg, tmp );
 }
 
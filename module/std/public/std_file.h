@@ -69,6 +69,13 @@ typedef struct {
     std_directory_flags_t flags;
 } std_directory_info_t;
 
+typedef struct {
+    char name[std_directory_entry_name_size_m];
+    std_path_flags_t flags;
+    uint64_t size;
+    std_timestamp_t last_write_time;
+} std_directory_entry_t;
+
 typedef enum {
     std_path_already_existing_overwrite_m,
     std_path_already_existing_fail_m,       // TODO
@@ -101,6 +108,11 @@ bool        std_directory_move ( const char* path, const char* dest, std_path_al
 size_t      std_directory_iterate ( const char* path, std_directory_iterator_callback_f cb, void* arg );
 size_t      std_directory_files ( char** files, size_t files_cap, size_t file_cap, const char* path );
 size_t      std_directory_subdirs ( char** subdirs, size_t subdirs_cap, size_t subdir_cap, const char* path );
+// Lists a whole directory together with type, size and last write time of every entry, without opening them.
+// On Linux names come from getdents64 in large batches and the rest from statx relative to the directory, on Win32
+// everything comes from the find data. Symlinks are followed, . and .. are skipped.
+// Returns the total entry count, only the first entries_cap entries are written. Returns 0 if the directory can't be opened.
+size_t      std_directory_scan ( std_directory_entry_t* entries, size_t entries_cap, const char* path );
 bool        std_directory_info ( std_directory_info_t* info, const char* path );
 
 // TODO automatically create path if missing
@@ -118,6 +130,14 @@ bool        std_file_unmap ( std_file_h file, void* mapping );
 uint64_t    std_file_read ( void* dest, size_t read_size, std_file_h file );
 uint64_t    std_file_path_read ( void* dest, uint64_t cap, const char* path );
 bool        std_file_write ( std_file_h file, const void* source, size_t write_size );
+// Positional, the file position is not used and is left undefined. Multiple threads can read and write through the
+// same handle at the same time. Reads stop early only on EOF.
+uint64_t    std_file_read_at ( void* dest, size_t read_size, std_file_h file, uint64_t offset );
+bool        std_file_write_at ( std_file_h file, const void* source, size_t write_size, uint64_t offset );
+// Positional scatter/gather, buffers are read or written back to back starting from offset, in as few syscalls as the
+// platform allows (preadv/pwritev on Linux)
+uint64_t    std_file_read_scatter ( const std_buffer_t* buffers, size_t count, std_file_h file, uint64_t offset );
+bool        std_file_write_gather ( std_file_h file, const std_buffer_t* buffers, size_t count, uint64_t offset );
 bool        std_file_seek ( std_file_h file, std_file_point_t base, int64_t offset );
 bool        std_file_info ( std_file_info_t* info, std_file_h file );
 bool        std_file_path_info ( std_file_info_t* info, const char* path );
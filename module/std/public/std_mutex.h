@@ -12,7 +12,6 @@
     TODO
     - Think about fiber support, can it be hidden away by just flipping a define or does it need explicit duplicate primitives that support fibers? should std have std_fiber, similar to std_thread? (possibly also enabled only when some define is flipped on)
     - add more primitives:
-        - cond var
         - spinlock
 */
 
@@ -42,9 +41,21 @@ typedef struct {
     uint32_t state; // 0 for free, 1 for busy
 } std_spinlock_t;
 
+// Condition variable
+// Waits atomically unlock the given mutex and lock it back before returning. Wakes can be spurious, so waits should
+// always be done in a loop that checks the actual condition.
+typedef struct {
+#if defined(std_platform_win32_m)
+    CONDITION_VARIABLE os;
+#elif defined(std_platform_linux_m)
+    pthread_cond_t os;
+#endif
+} std_condition_variable_t;
+
 // Mutex
 void std_mutex_init    ( std_mutex_t* mutex );
 void std_mutex_lock    ( std_mutex_t* mutex );
+bool std_mutex_try_lock ( std_mutex_t* mutex );
 void std_mutex_unlock  ( std_mutex_t* mutex );
 void std_mutex_deinit  ( std_mutex_t* mutex );
 
@@ -60,3 +71,10 @@ void std_rwmutex_deinit         ( std_rwmutex_t* mutex );
 void std_spilock_init ( std_spinlock_t* spinlock );
 void std_spinlock_lock ( std_spinlock_t* spinlock );
 void std_spinlock_unlock ( std_spinlock_t* spinlock );
+
+// Condition variable
+void std_condition_variable_init        ( std_condition_variable_t* cv );
+void std_condition_variable_wait        ( std_condition_variable_t* cv, std_mutex_t* mutex );
+void std_condition_variable_wake        ( std_condition_variable_t* cv );
+void std_condition_variable_wake_all    ( std_condition_variable_t* cv );
+void std_condition_variable_deinit      ( std_condition_variable_t* cv );
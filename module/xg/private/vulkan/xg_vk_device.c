@@ -18,6 +18,7 @@
     #include "vulkan/xg_vk_workload.h"
     #include "vulkan/xg_vk_pipeline.h"
     #include "vulkan/xg_vk_texture.h"
+    #include "vulkan/xg_vk_upload.h"
 #endif
 
 /*
@@ -931,6 +932,7 @@ bool xg_vk_device_activate ( xg_device_h device_handle ) {
     VkPhysicalDeviceFeatures enabled_features = {
         .geometryShader = VK_TRUE,
         .shaderInt64 = VK_TRUE,
+        .textureCompressionBC = device->supported_features.textureCompressionBC,
     };
 
     // Enable sync2 API
@@ -941,11 +943,19 @@ bool xg_vk_device_activate ( xg_device_h device_handle ) {
         .synchronization2 = VK_TRUE,
     };
 
+    // Enable timeline semaphores, used by the upload service
+    // https://registry.khronos.org/vulkan/specs/1.3-extensions/man/html/VkPhysicalDeviceTimelineSemaphoreFeatures.html
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore_feature = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+        .pNext = &sync2_feature,
+        .timelineSemaphore = VK_TRUE,
+    };
+
     // Enable imageless framebuffers
     // https://www.khronos.org/registry/vulkan/specs/1.2-extensions/man/html/VK_KHR_imageless_framebuffer.html
     VkPhysicalDeviceImagelessFramebufferFeatures imageless_framebuffer_feature = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGELESS_FRAMEBUFFER_FEATURES,
-        .pNext = &sync2_feature,
+        .pNext = &timeline_semaphore_feature,
         .imagelessFramebuffer = VK_TRUE,
     };
 
@@ -1001,6 +1011,7 @@ bool xg_vk_device_activate ( xg_device_h device_handle ) {
 
     xg_vk_allocator_activate_device ( device_handle );
     xg_vk_workload_activate_device ( device_handle );
+    xg_vk_upload_activate_device ( device_handle );
 
     xg_workload_h workload = xg_workload_create ( device_handle );
 
@@ -1013,6 +1024,7 @@ bool xg_vk_device_activate ( xg_device_h device_handle ) {
 }
 
 bool xg_vk_device_deactivate ( xg_device_h device_handle ) {
+    xg_vk_upload_deactivate_device ( device_handle );
     xg_vk_workload_deactivate_device ( device_handle );
     xg_vk_pipeline_deactivate_device ( device_handle );
     xg_vk_allocator_deactivate_device ( device_handle );
@@ -1110,6 +1122,41 @@ bool xg_vk_device_get_info ( xg_device_info_t* info, xg_device_h device_handle )
     return true;
 }
 
+xg_texture_usage_bit_e xg_vk_device_get_format_texture_usage ( xg_device_h device_handle, xg_format_e format ) {
+    xg_vk_device_t* device = &xg_vk_device_state->devices_array[device_handle];
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties ( device->vk_physical_handle, xg_format_to_vk ( format ), &props );
+    VkFormatFeatureFlags features = props.optimalTilingFeatures;
+
+    xg_texture_usage_bit_e usage = xg_texture_usage_bit_none_m;
+
+    if ( features & VK_FORMAT_FEATURE_TRANSFER_SRC_BIT ) {
+        usage |= xg_texture_usage_bit_copy_source_m;
+    }
+
+    if ( features & VK_FORMAT_FEATURE_TRANSFER_DST_BIT ) {
+        usage |= xg_texture_usage_bit_copy_dest_m;
+    }
+
+    if ( features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT ) {
+        usage |= xg_texture_usage_bit_sampled_m;
+    }
+
+    if ( features & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT ) {
+        usage |= xg_texture_usage_bit_storage_m;
+    }
+
+    if ( features & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT ) {
+        usage |= xg_texture_usage_bit_render_target_m;
+    }
+
+    if ( features & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT ) {
+        usage |= xg_texture_usage_bit_depth_stencil_m;
+    }
+
+    return usage;
+}
+
 // TODO query this at init and cache this?
 size_t xg_vk_device_get_displays_count ( xg_device_h handle ) {
     std_mutex_lock ( &xg_vk_device_state->devices_mutex );
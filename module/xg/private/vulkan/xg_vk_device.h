@@ -10,6 +10,7 @@
 size_t      xg_vk_device_get_count ( void );
 size_t      xg_vk_device_get_list ( xg_device_h* devices, size_t cap );
 bool        xg_vk_device_get_info ( xg_device_info_t* info, xg_device_h device );
+xg_texture_usage_bit_e xg_vk_device_get_format_texture_usage ( xg_device_h device, xg_format_e format );
 
 bool        xg_vk_device_activate ( xg_device_h device );
 bool        xg_vk_device_deactivate ( xg_device_h device );
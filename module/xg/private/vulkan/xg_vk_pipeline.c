@@ -148,6 +148,8 @@ void xg_vk_pipeline_load ( xg_vk_pipeline_state_t* state ) {
     state->resource_bindings_layouts_map = std_hash_map_create ( xg_vk_max_resource_bindings_layouts_m * 2 );
     state->resource_bindings_layouts_bitset = std_virtual_heap_alloc_array_m ( uint64_t, xg_vk_resource_bindings_layouts_bitset_u64_count_m );
     std_mem_zero ( state->resource_bindings_layouts_bitset, 8 * xg_vk_resource_bindings_layouts_bitset_u64_count_m );
+
+    std_mutex_init ( &state->mutex );
 }
 
 void xg_vk_pipeline_reload ( xg_vk_pipeline_state_t* state ) {
@@ -187,6 +189,8 @@ void xg_vk_pipeline_unload ( void ) {
     std_virtual_heap_free ( xg_vk_pipeline_state->resource_bindings_layouts_array );
     std_hash_map_destroy ( &xg_vk_pipeline_state->resource_bindings_layouts_map );
     std_virtual_heap_free ( xg_vk_pipeline_state->resource_bindings_layouts_bitset );
+
+    std_mutex_deinit ( &xg_vk_pipeline_state->mutex );
 }
 
 static VkFramebuffer xg_vk_framebuffer_create_vk ( xg_device_h device_handle, VkRenderPass vk_renderpass, const xg_render_textures_layout_t* render_textures_layout, const xg_render_textures_usage_t* render_textures_usage, uint32_t width, uint32_t height, const char* debug_name ) {
@@ -412,13 +416,16 @@ xg_resource_bindings_layout_h xg_vk_pipeline_resource_bindings_layout_create ( c
     uint64_t hash = std_hash_block_64_m ( hash_allocator.begin, hash_allocator.top - hash_allocator.begin );
 
     xg_resource_bindings_layout_h handle;
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     xg_resource_bindings_layout_h* lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->resource_bindings_layouts_map, hash );
 
     if ( lookup ) {
         handle = *lookup;
         xg_vk_resource_bindings_layout_t* layout = &xg_vk_pipeline_state->resource_bindings_layouts_array[handle];
         layout->ref_count += 1;
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     } else {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
         const xg_vk_device_t* device = xg_vk_device_get ( params->device );
 
         VkDescriptorSetLayoutBinding vk_bindings_array[xg_pipeline_resource_max_bindings_per_set_m];
@@ -448,6 +455,18 @@ xg_resource_bindings_layout_h xg_vk_pipeline_resource_bindings_layout_create ( c
             xg_vk_device_ext_api ( params->device )->set_debug_name ( device->vk_handle, &debug_name_info );
         }
 
+        std_mutex_lock ( &xg_vk_pipeline_state->mutex );
+        lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->resource_bindings_layouts_map, hash );
+
+        if ( lookup ) {
+            // Another thread created the same layout in the meantime, keep that one
+            handle = *lookup;
+            xg_vk_pipeline_state->resource_bindings_layouts_array[handle].ref_count += 1;
+            std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+            vkDestroyDescriptorSetLayout ( device->vk_handle, vk_handle, xg_vk_cpu_allocator() );
+            return handle;
+        }
+
         xg_vk_resource_bindings_layout_t* layout = std_list_pop_m ( &xg_vk_pipeline_state->resource_bindings_layouts_freelist );
         std_assert_m ( layout );
         handle = layout - xg_vk_pipeline_state->resource_bindings_layouts_array;
@@ -464,12 +483,14 @@ xg_resource_bindings_layout_h xg_vk_pipeline_resource_bindings_layout_create ( c
         }
 
         std_hash_map_insert ( &xg_vk_pipeline_state->resource_bindings_layouts_map, hash, handle );
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     }
 
     return handle;
 }
 
 void xg_vk_pipeline_resource_bindings_layout_destroy ( xg_resource_bindings_layout_h layout_handle ) {
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     xg_vk_resource_bindings_layout_t* layout = &xg_vk_pipeline_state->resource_bindings_layouts_array[layout_handle];
     if ( --layout->ref_count == 0 ) {
         const xg_vk_device_t* device = xg_vk_device_get ( layout->params.device );
@@ -478,6 +499,7 @@ void xg_vk_pipeline_resource_bindings_layout_destroy ( xg_resource_bindings_layo
         std_list_push ( &xg_vk_pipeline_state->resource_bindings_layouts_freelist, layout );
         std_bitset_clear ( xg_vk_pipeline_state->resource_bindings_layouts_bitset, layout_handle );
     }
+    std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
 }
 
 xg_vk_resource_bindings_layout_t* xg_vk_pipeline_resource_bindings_layout_get ( xg_resource_bindings_layout_h handle ) {
@@ -590,6 +612,7 @@ xg_raytrace_pipeline_state_h xg_vk_raytrace_pipeline_create ( xg_device_h device
 
     // Pipeline
     uint64_t pipeline_hash = std_hash_block_64_m ( hash_allocator.begin, hash_allocator.top - hash_allocator.begin );
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     uint64_t* pipeline_lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->raytrace_pipelines_map, pipeline_hash );
     xg_raytrace_pipeline_state_h xg_vk_pipeline_handle;
 
@@ -597,7 +620,10 @@ xg_raytrace_pipeline_state_h xg_vk_raytrace_pipeline_create ( xg_device_h device
         xg_vk_pipeline_handle = *pipeline_lookup;
         xg_vk_raytrace_pipeline_t* xg_vk_pipeline = &xg_vk_pipeline_state->raytrace_pipelines_array[xg_vk_pipeline_handle];
         xg_vk_pipeline->common.reference_count += 1;
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     } else {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+
         // Shaders
         VkShaderModule vk_shader_handles[xg_raytrace_shader_state_max_shaders_m] = { [0 ... xg_raytrace_shader_state_max_shaders_m-1] = VK_NULL_HANDLE };
         VkPipelineShaderStageCreateInfo shader_info[xg_raytrace_shader_state_max_shaders_m];
@@ -816,6 +842,26 @@ xg_raytrace_pipeline_state_h xg_vk_raytrace_pipeline_create ( xg_device_h device
 #endif
 
         // Allocate
+        std_mutex_lock ( &xg_vk_pipeline_state->mutex );
+        pipeline_lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->raytrace_pipelines_map, pipeline_hash );
+
+        if ( pipeline_lookup ) {
+            // Another thread created the same pipeline in the meantime, keep that one
+            xg_vk_pipeline_handle = *pipeline_lookup;
+            xg_vk_pipeline_state->raytrace_pipelines_array[xg_vk_pipeline_handle].common.reference_count += 1;
+            std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+
+            for ( uint32_t i = 0; i < xg_raytrace_shader_state_max_shaders_m; ++i ) {
+                if ( vk_shader_handles[i] != VK_NULL_HANDLE ) {
+                    vkDestroyShaderModule ( device->vk_handle, vk_shader_handles[i], xg_vk_cpu_allocator() );
+                }
+            }
+            vkDestroyPipeline ( device->vk_handle, pipeline, xg_vk_cpu_allocator() );
+            vkDestroyPipelineLayout ( device->vk_handle, vk_pipeline_layout, xg_vk_cpu_allocator() );
+            std_virtual_heap_free ( groups_buffer );
+            return xg_vk_pipeline_handle_tag_as_raytrace_m ( xg_vk_pipeline_handle );
+        }
+
         xg_vk_raytrace_pipeline_t* xg_vk_pipeline = std_list_pop_m ( &xg_vk_pipeline_state->raytrace_pipelines_freelist );
         xg_vk_pipeline_handle = ( xg_raytrace_pipeline_state_h ) ( xg_vk_pipeline - xg_vk_pipeline_state->raytrace_pipelines_array );
 
@@ -854,6 +900,7 @@ xg_raytrace_pipeline_state_h xg_vk_raytrace_pipeline_create ( xg_device_h device
         xg_vk_pipeline->common.type = xg_pipeline_raytrace_m;
 
         std_verify_m ( std_hash_map_insert ( &xg_vk_pipeline_state->raytrace_pipelines_map, pipeline_hash, xg_vk_pipeline_handle ) );
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     }
 
     xg_vk_pipeline_handle = xg_vk_pipeline_handle_tag_as_raytrace_m ( xg_vk_pipeline_handle );
@@ -868,9 +915,11 @@ xg_raytrace_pipeline_state_h xg_vk_raytrace_pipeline_create ( xg_device_h device
 
 void xg_vk_raytrace_pipeline_destroy ( xg_raytrace_pipeline_state_h pipeline_handle ) {
 #if xg_enable_raytracing_m
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     xg_vk_raytrace_pipeline_t* pipeline = xg_vk_raytrace_pipeline_edit ( pipeline_handle );
 
     if ( --pipeline->common.reference_count > 0 ) {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
         return;
     }
 
@@ -895,6 +944,7 @@ void xg_vk_raytrace_pipeline_destroy ( xg_raytrace_pipeline_state_h pipeline_han
 
     std_list_push ( &xg_vk_pipeline_state->raytrace_pipelines_freelist, pipeline );
     std_verify_m ( std_hash_map_remove_hash ( &xg_vk_pipeline_state->raytrace_pipelines_map, pipeline->common.hash ) );
+    std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
 #else
     std_unused_m ( pipeline_handle );
 #endif
@@ -916,6 +966,7 @@ xg_compute_pipeline_state_h xg_vk_compute_pipeline_create ( xg_device_h device_h
 
     // Pipeline
     uint64_t pipeline_hash = std_hash_block_64_m ( hash_allocator.begin, hash_allocator.top - hash_allocator.begin );
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     uint64_t* pipeline_lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->compute_pipelines_map, pipeline_hash );
     xg_compute_pipeline_state_h xg_vk_pipeline_handle;
 
@@ -923,7 +974,10 @@ xg_compute_pipeline_state_h xg_vk_compute_pipeline_create ( xg_device_h device_h
         xg_vk_pipeline_handle = *pipeline_lookup;
         xg_vk_compute_pipeline_t* xg_vk_pipeline = &xg_vk_pipeline_state->compute_pipelines_array[xg_vk_pipeline_handle];
         xg_vk_pipeline->common.reference_count += 1;
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     } else {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+
         // Compute shader
         VkShaderModule shader;
         VkPipelineShaderStageCreateInfo shader_info;
@@ -991,6 +1045,21 @@ xg_compute_pipeline_state_h xg_vk_compute_pipeline_create ( xg_device_h device_h
             }
         }
 
+        std_mutex_lock ( &xg_vk_pipeline_state->mutex );
+        pipeline_lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->compute_pipelines_map, pipeline_hash );
+
+        if ( pipeline_lookup ) {
+            // Another thread created the same pipeline in the meantime, keep that one
+            xg_vk_pipeline_handle = *pipeline_lookup;
+            xg_vk_pipeline_state->compute_pipelines_array[xg_vk_pipeline_handle].common.reference_count += 1;
+            std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+
+            vkDestroyShaderModule ( device->vk_handle, shader, xg_vk_cpu_allocator() );
+            vkDestroyPipeline ( device->vk_handle, pipeline, xg_vk_cpu_allocator() );
+            vkDestroyPipelineLayout ( device->vk_handle, vk_pipeline_layout, xg_vk_cpu_allocator() );
+            return xg_vk_pipeline_handle_tag_as_compute_m ( xg_vk_pipeline_handle );
+        }
+
         xg_vk_compute_pipeline_t* xg_vk_pipeline = std_list_pop_m ( &xg_vk_pipeline_state->compute_pipelines_freelist );
         xg_vk_pipeline_handle = ( xg_compute_pipeline_state_h ) ( xg_vk_pipeline - xg_vk_pipeline_state->compute_pipelines_array );
 
@@ -1021,6 +1090,7 @@ xg_compute_pipeline_state_h xg_vk_compute_pipeline_create ( xg_device_h device_h
         xg_vk_pipeline->common.type = xg_pipeline_compute_m;
 
         std_verify_m ( std_hash_map_insert ( &xg_vk_pipeline_state->compute_pipelines_map, pipeline_hash, xg_vk_pipeline_handle ) );
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     }
 
     xg_vk_pipeline_handle = xg_vk_pipeline_handle_tag_as_compute_m ( xg_vk_pipeline_handle );
@@ -1459,11 +1529,14 @@ xg_graphics_pipeline_state_h xg_vk_graphics_pipeline_create ( xg_device_h device
     // TODO try to batch vkCreateGraphicsPipelines calls
     uint64_t pipeline_hash = std_hash_block_64_m ( hash_allocator.begin, hash_allocator.top - hash_allocator.begin );
 
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     uint64_t* pipeline_lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->graphics_pipelines_map, pipeline_hash );
 
     xg_graphics_pipeline_state_h xg_vk_pipeline_handle;
 
     if ( pipeline_lookup == NULL ) {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+
         // Shaders
         VkShaderModule vk_shader_handles[xg_shading_stage_count_m] = { [0 ... xg_shading_stage_count_m-1] = VK_NULL_HANDLE };
         VkPipelineShaderStageCreateInfo shader_info[xg_shading_stage_count_m];
@@ -1582,6 +1655,26 @@ xg_graphics_pipeline_state_h xg_vk_graphics_pipeline_create ( xg_device_h device
             }
         }
 
+        std_mutex_lock ( &xg_vk_pipeline_state->mutex );
+        pipeline_lookup = std_hash_map_lookup ( &xg_vk_pipeline_state->graphics_pipelines_map, pipeline_hash );
+
+        if ( pipeline_lookup ) {
+            // Another thread created the same pipeline in the meantime, keep that one
+            xg_vk_pipeline_handle = *pipeline_lookup;
+            xg_vk_pipeline_state->graphics_pipelines_array[xg_vk_pipeline_handle].common.reference_count += 1;
+            std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
+
+            for ( uint32_t i = 0; i < xg_shading_stage_count_m; ++i ) {
+                if ( vk_shader_handles[i] != VK_NULL_HANDLE ) {
+                    vkDestroyShaderModule ( device->vk_handle, vk_shader_handles[i], xg_vk_cpu_allocator() );
+                }
+            }
+            vkDestroyPipeline ( device->vk_handle, pipeline, xg_vk_cpu_allocator() );
+            vkDestroyPipelineLayout ( device->vk_handle, vk_pipeline_layout, xg_vk_cpu_allocator() );
+            vkDestroyRenderPass ( device->vk_handle, vk_renderpass, xg_vk_cpu_allocator() );
+            return xg_vk_pipeline_handle_tag_as_graphics_m ( xg_vk_pipeline_handle );
+        }
+
         xg_vk_graphics_pipeline_t* xg_vk_pipeline = std_list_pop_m ( &xg_vk_pipeline_state->graphics_pipelines_freelist );
         xg_vk_pipeline_handle = ( xg_graphics_pipeline_state_h ) ( xg_vk_pipeline - xg_vk_pipeline_state->graphics_pipelines_array );
 
@@ -1616,10 +1709,12 @@ xg_graphics_pipeline_state_h xg_vk_graphics_pipeline_create ( xg_device_h device
         xg_vk_pipeline->common.type = xg_pipeline_graphics_m;
 
         std_hash_map_insert ( &xg_vk_pipeline_state->graphics_pipelines_map, pipeline_hash, xg_vk_pipeline_handle );
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     } else {
         xg_vk_pipeline_handle = *pipeline_lookup;
         xg_vk_graphics_pipeline_t* xg_vk_pipeline = &xg_vk_pipeline_state->graphics_pipelines_array[xg_vk_pipeline_handle];
         xg_vk_pipeline->common.reference_count += 1;
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
     }
 
     xg_vk_pipeline_handle = xg_vk_pipeline_handle_tag_as_graphics_m ( xg_vk_pipeline_handle );
@@ -1627,9 +1722,11 @@ xg_graphics_pipeline_state_h xg_vk_graphics_pipeline_create ( xg_device_h device
 }
 
 void xg_vk_graphics_pipeline_destroy ( xg_graphics_pipeline_state_h pipeline_handle ) {
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     xg_vk_graphics_pipeline_t* pipeline = xg_vk_graphics_pipeline_edit ( pipeline_handle );
 
     if ( --pipeline->common.reference_count > 0 ) {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
         return;
     }
 
@@ -1654,6 +1751,7 @@ void xg_vk_graphics_pipeline_destroy ( xg_graphics_pipeline_state_h pipeline_han
 
     std_list_push ( &xg_vk_pipeline_state->graphics_pipelines_freelist, pipeline );
     std_verify_m ( std_hash_map_remove_hash ( &xg_vk_pipeline_state->graphics_pipelines_map, pipeline->common.hash ) );
+    std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
 }
 
 xg_renderpass_h xg_vk_renderpass_create ( const xg_renderpass_params_t* params ) {
@@ -1681,9 +1779,11 @@ void xg_vk_renderpass_destroy ( xg_renderpass_h renderpass_handle ) {
 }
 
 void xg_vk_compute_pipeline_destroy ( xg_compute_pipeline_state_h pipeline_handle ) {
+    std_mutex_lock ( &xg_vk_pipeline_state->mutex );
     xg_vk_compute_pipeline_t* pipeline = xg_vk_compute_pipeline_edit ( pipeline_handle );
 
     if ( --pipeline->common.reference_count > 0 ) {
+        std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
         return;
     }
 
@@ -1703,6 +1803,7 @@ void xg_vk_compute_pipeline_destroy ( xg_compute_pipeline_state_h pipeline_handl
 
     std_list_push ( &xg_vk_pipeline_state->compute_pipelines_freelist, pipeline );
     std_verify_m ( std_hash_map_remove_hash ( &xg_vk_pipeline_state->compute_pipelines_map, pipeline->common.hash ) );
+    std_mutex_unlock ( &xg_vk_pipeline_state->mutex );
 }
 
 void xg_vk_pipeline_activate_device ( xg_device_h device_handle ) {
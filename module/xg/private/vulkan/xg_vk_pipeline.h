@@ -121,6 +121,10 @@ typedef struct {
 
     // Device contexts
     xg_vk_pipeline_device_context_t device_contexts[xg_max_active_devices_m];
+
+    // Guards the pipeline and resource layout maps, freelists and reference counts.
+    // Vulkan objects are created outside of the lock, so pipelines can be created in parallel from multiple threads.
+    std_mutex_t mutex;
 } xg_vk_pipeline_state_t;
 
 void xg_vk_pipeline_load ( xg_vk_pipeline_state_t* state );
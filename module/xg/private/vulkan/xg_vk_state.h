@@ -14,6 +14,7 @@
 #include "xg_vk_workload.h"
 #include "xg_vk_raytrace.h"
 #include "xg_vk_query.h"
+#include "xg_vk_upload.h"
 
 typedef struct {
     xg_vk_instance_state_t instance;
@@ -28,4 +29,5 @@ typedef struct {
     xg_vk_swapchain_state_t swapchain;
     xg_vk_workload_state_t workload;
     xg_vk_raytrace_state_t raytrace;
+    xg_vk_upload_state_t upload;
 } xg_vk_state_t;
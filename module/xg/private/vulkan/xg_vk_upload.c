@@ -0,0 +1,794 @@
+#include "xg_vk_upload.h"
+
+#include "xg_vk_device.h"
+#include "xg_vk_instance.h"
+#include "xg_vk_buffer.h"
+#include "xg_vk_texture.h"
+#include "xg_vk_enum.h"
+
+#include <xg_enum.h>
+
+#include <std_list.h>
+#include <std_log.h>
+
+static xg_vk_upload_state_t* xg_vk_upload_state;
+
+void xg_vk_upload_load ( xg_vk_upload_state_t* state ) {
+    xg_vk_upload_state = state;
+
+    state->requests_array = std_virtual_heap_alloc_array_m ( xg_vk_upload_request_t, xg_vk_max_upload_requests_m );
+    state->requests_freelist = std_freelist_m ( state->requests_array, xg_vk_max_upload_requests_m );
+    std_mutex_init ( &state->requests_mutex );
+
+    for ( uint32_t i = 0; i < xg_vk_max_upload_requests_m; ++i ) {
+        state->requests_array[i].gen = 0;
+    }
+
+    for ( uint32_t i = 0; i < xg_max_active_devices_m; ++i ) {
+        state->device_contexts[i].is_active = false;
+        state->device_contexts[i].device_handle = xg_null_handle_m;
+    }
+}
+
+void xg_vk_upload_reload ( xg_vk_upload_state_t* state ) {
+    xg_vk_upload_state = state;
+}
+
+void xg_vk_upload_unload ( void ) {
+    for ( uint32_t i = 0; i < xg_max_active_devices_m; ++i ) {
+        xg_vk_upload_device_context_t* context = &xg_vk_upload_state->device_contexts[i];
+        if ( context->is_active ) {
+            xg_vk_upload_deactivate_device ( context->device_handle );
+        }
+    }
+
+    std_virtual_heap_free ( xg_vk_upload_state->requests_array );
+    std_mutex_deinit ( &xg_vk_upload_state->requests_mutex );
+}
+
+static xg_vk_upload_device_context_t* xg_vk_upload_device_context_get ( xg_device_h device_handle ) {
+    uint64_t device_idx = xg_vk_device_get_idx ( device_handle );
+    xg_vk_upload_device_context_t* context = &xg_vk_upload_state->device_contexts[device_idx];
+    std_assert_m ( context->is_active );
+    return context;
+}
+
+static VkSemaphore xg_vk_upload_create_timeline ( const xg_vk_device_t* device ) {
+    VkSemaphoreTypeCreateInfo type_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .pNext = NULL,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0,
+    };
+
+    VkSemaphoreCreateInfo semaphore_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        .pNext = &type_info,
+        .flags = 0,
+    };
+
+    VkSemaphore semaphore;
+    VkResult result = vkCreateSemaphore ( device->vk_handle, &semaphore_info, xg_vk_cpu_allocator(), &semaphore );
+    xg_vk_assert_m ( result );
+    return semaphore;
+}
+
+static VkCommandPool xg_vk_upload_create_cmd_pool ( const xg_vk_device_t* device, xg_cmd_queue_e queue ) {
+    VkCommandPoolCreateInfo pool_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        .queueFamilyIndex = device->queues[queue].vk_family_idx,
+    };
+
+    VkCommandPool pool;
+    VkResult result = vkCreateCommandPool ( device->vk_handle, &pool_info, NULL, &pool );
+    xg_vk_assert_m ( result );
+    return pool;
+}
+
+void xg_vk_upload_activate_device ( xg_device_h device_handle ) {
+    uint64_t device_idx = xg_vk_device_get_idx ( device_handle );
+    std_assert_m ( device_idx < xg_max_active_devices_m );
+
+    xg_vk_upload_device_context_t* context = &xg_vk_upload_state->device_contexts[device_idx];
+    std_assert_m ( !context->is_active );
+    context->is_active = true;
+    context->device_handle = device_handle;
+
+    const xg_vk_device_t* device = xg_vk_device_get ( device_handle );
+    context->requires_ownership_transfer = device->queues[xg_cmd_queue_copy_m].vk_family_idx != device->queues[xg_cmd_queue_graphics_m].vk_family_idx;
+
+    context->copy_cmd_pool = xg_vk_upload_create_cmd_pool ( device, xg_cmd_queue_copy_m );
+    context->acquire_cmd_pool = xg_vk_upload_create_cmd_pool ( device, xg_cmd_queue_graphics_m );
+
+    VkCommandBuffer copy_cmd_buffers[xg_vk_upload_max_batches_m];
+    VkCommandBuffer acquire_cmd_buffers[xg_vk_upload_max_batches_m];
+
+    VkCommandBufferAllocateInfo buffer_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .pNext = NULL,
+        .commandPool = context->copy_cmd_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = xg_vk_upload_max_batches_m,
+    };
+    VkResult result = vkAllocateCommandBuffers ( device->vk_handle, &buffer_info, copy_cmd_buffers );
+    xg_vk_assert_m ( result );
+
+    buffer_info.commandPool = context->acquire_cmd_pool;
+    result = vkAllocateCommandBuffers ( device->vk_handle, &buffer_info, acquire_cmd_buffers );
+    xg_vk_assert_m ( result );
+
+    for ( uint32_t i = 0; i < xg_vk_upload_max_batches_m; ++i ) {
+        xg_vk_upload_batch_t* batch = &context->batches_array[i];
+        batch->timeline_value = 0;
+        batch->staging_end = 0;
+        batch->size = 0;
+        batch->requests_count = 0;
+        batch->copy_cmd_buffer = copy_cmd_buffers[i];
+        batch->acquire_cmd_buffer = acquire_cmd_buffers[i];
+        batch->is_submitted = false;
+    }
+
+    context->batches_put = 0;
+    context->batches_pop = 0;
+
+    context->timeline = xg_vk_upload_create_timeline ( device );
+    context->timeline_value = 0;
+    context->acquire_timeline = xg_vk_upload_create_timeline ( device );
+    context->acquire_value = 0;
+
+    xg_buffer_params_t staging_params = xg_buffer_params_m (
+        .memory_type = xg_memory_type_upload_m,
+        .device = device_handle,
+        .size = xg_vk_upload_staging_buffer_size_m,
+        .allowed_usage = xg_buffer_usage_bit_copy_source_m,
+        .debug_name = "upload_staging_buffer",
+    );
+    context->staging_buffer = xg_buffer_create ( &staging_params );
+    xg_buffer_info_t staging_info;
+    xg_buffer_get_info ( &staging_info, context->staging_buffer );
+    context->staging_base = staging_info.allocation.mapped_address;
+    context->staging_size = xg_vk_upload_staging_buffer_size_m;
+    context->staging_head = 0;
+    context->staging_tail = 0;
+
+    context->queue_head = NULL;
+    context->queue_tail = NULL;
+    std_mutex_init ( &context->queue_mutex );
+
+    context->budget = xg_vk_upload_default_budget_m;
+    context->queued_bytes = 0;
+    context->transferring_bytes = 0;
+    context->uploaded_bytes = 0;
+    context->queued_count = 0;
+    context->transferring_count = 0;
+}
+
+void xg_vk_upload_deactivate_device ( xg_device_h device_handle ) {
+    uint64_t device_idx = xg_vk_device_get_idx ( device_handle );
+    xg_vk_upload_device_context_t* context = &xg_vk_upload_state->device_contexts[device_idx];
+
+    // Can get called twice on unload, once by the upload module itself and once on device deactivation
+    if ( !context->is_active ) {
+        return;
+    }
+
+    const xg_vk_device_t* device = xg_vk_device_get ( device_handle );
+
+    xg_vk_upload_wait_all ( device_handle );
+
+    vkDestroySemaphore ( device->vk_handle, context->timeline, xg_vk_cpu_allocator() );
+    vkDestroySemaphore ( device->vk_handle, context->acquire_timeline, xg_vk_cpu_allocator() );
+    vkDestroyCommandPool ( device->vk_handle, context->copy_cmd_pool, NULL );
+    vkDestroyCommandPool ( device->vk_handle, context->acquire_cmd_pool, NULL );
+    xg_buffer_destroy ( context->staging_buffer );
+    std_mutex_deinit ( &context->queue_mutex );
+
+    context->is_active = false;
+    context->device_handle = xg_null_handle_m;
+}
+
+// ---
+
+static uint32_t xg_vk_upload_texture_mip_count ( const xg_vk_texture_t* texture, const xg_upload_texture_params_t* params ) {
+    if ( params->mip_count == xg_texture_all_mips_m ) {
+        return texture->params.mip_levels - params->mip_base;
+    }
+    return params->mip_count;
+}
+
+static uint32_t xg_vk_upload_texture_array_count ( const xg_vk_texture_t* texture, const xg_upload_texture_params_t* params ) {
+    if ( params->array_count == xg_texture_whole_array_m ) {
+        return texture->params.array_layers - params->array_base;
+    }
+    return params->array_count;
+}
+
+static uint64_t xg_vk_upload_texture_mip_size ( const xg_vk_texture_t* texture, uint32_t mip ) {
+    uint64_t width = std_max_u64 ( texture->params.width >> mip, 1 );
+    uint64_t height = std_max_u64 ( texture->params.height >> mip, 1 );
+    uint64_t depth = std_max_u64 ( texture->params.depth >> mip, 1 );
+    uint64_t block_size = xg_format_block_size ( texture->params.format );
+
+    // Block compressed mips are stored as whole 4x4 blocks, partial blocks at the edges included
+    if ( block_size > 0 ) {
+        return ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * depth * block_size;
+    }
+
+    return width * height * depth * xg_format_size ( texture->params.format );
+}
+
+static VkImageAspectFlags xg_vk_upload_texture_aspect ( const xg_vk_texture_t* texture ) {
+    VkImageAspectFlags aspect = xg_texture_flags_to_vk_aspect ( texture->flags );
+    if ( aspect == VK_IMAGE_ASPECT_NONE ) {
+        aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+    return aspect;
+}
+
+static xg_upload_h xg_vk_upload_push ( xg_device_h device_handle, xg_vk_upload_request_type_e type, const void* params, uint64_t size ) {
+    xg_vk_upload_device_context_t* context = xg_vk_upload_device_context_get ( device_handle );
+
+    if ( size > context->staging_size ) {
+        std_log_error_m ( "Upload of size " std_fmt_u64_m " exceeds upload staging buffer size " std_fmt_u64_m, size, context->staging_size );
+        return xg_null_handle_m;
+    }
+
+    std_mutex_lock ( &xg_vk_upload_state->requests_mutex );
+    xg_vk_upload_request_t* request = std_list_pop_m ( &xg_vk_upload_state->requests_freelist );
+    std_mutex_unlock ( &xg_vk_upload_state->requests_mutex );
+    std_assert_m ( request );
+
+    request->next = NULL;
+    request->type = type;
+    request->status = xg_upload_status_queued_m;
+    request->size = size;
+
+    if ( type == xg_vk_upload_request_buffer_m ) {
+        request->buffer = * ( const xg_upload_buffer_params_t* ) params;
+    } else {
+        request->texture = * ( const xg_upload_texture_params_t* ) params;
+    }
+
+    std_mutex_lock ( &context->queue_mutex );
+    if ( context->queue_tail ) {
+        context->queue_tail->next = request;
+    } else {
+        context->queue_head = request;
+    }
+    context->queue_tail = request;
+    context->queued_bytes += size;
+    context->queued_count += 1;
+    std_mutex_unlock ( &context->queue_mutex );
+
+    uint64_t idx = ( uint64_t ) ( request - xg_vk_upload_state->requests_array );
+    return ( ( uint64_t ) request->gen << 32 ) | idx;
+}
+
+xg_upload_h xg_vk_upload_buffer ( const xg_upload_buffer_params_t* params ) {
+    const xg_vk_buffer_t* buffer = xg_vk_buffer_get ( params->buffer );
+    std_assert_m ( buffer );
+    std_assert_m ( params->data && params->size > 0 );
+    std_assert_m ( params->offset + params->size <= buffer->params.size );
+    return xg_vk_upload_push ( buffer->params.device, xg_vk_upload_request_buffer_m, params, params->size );
+}
+
+xg_upload_h xg_vk_upload_texture ( const xg_upload_texture_params_t* params ) {
+    const xg_vk_texture_t* texture = xg_vk_texture_get ( params->texture );
+    std_assert_m ( texture );
+    std_assert_m ( params->data );
+
+    uint32_t mip_count = xg_vk_upload_texture_mip_count ( texture, params );
+    uint32_t array_count = xg_vk_upload_texture_array_count ( texture, params );
+    std_assert_m ( params->mip_base + mip_count <= texture->params.mip_levels );
+    std_assert_m ( params->array_base + array_count <= texture->params.array_layers );
+    std_assert_m ( mip_count <= xg_vk_upload_max_mips_per_request_m );
+
+    uint64_t size = 0;
+    for ( uint32_t i = 0; i < mip_count; ++i ) {
+        size += xg_vk_upload_texture_mip_size ( texture, params->mip_base + i ) * array_count;
+    }
+
+    return xg_vk_upload_push ( texture->params.device, xg_vk_upload_request_texture_m, params, size );
+}
+
+xg_upload_status_e xg_vk_upload_get_status ( xg_upload_h upload ) {
+    if ( upload == xg_null_handle_m ) {
+        return xg_upload_status_failed_m;
+    }
+
+    uint64_t idx = upload & 0xffffffff;
+    uint32_t gen = ( uint32_t ) ( upload >> 32 );
+    std_assert_m ( idx < xg_vk_max_upload_requests_m );
+    xg_vk_upload_request_t* request = &xg_vk_upload_state->requests_array[idx];
+
+    // Requests get recycled as soon as they complete, bumping their gen
+    if ( request->gen != gen ) {
+        return xg_upload_status_complete_m;
+    }
+
+    return request->status;
+}
+
+// ---
+
+// Returns the offset in the staging buffer, or UINT64_MAX if there isn't enough contiguous free space
+static uint64_t xg_vk_upload_staging_alloc ( xg_vk_upload_device_context_t* context, uint64_t size ) {
+    uint64_t head = std_align_u64 ( context->staging_head, xg_vk_upload_staging_alignment_m );
+    uint64_t offset = head % context->staging_size;
+
+    // Don't split allocations across the ring end, skip to the beginning instead
+    if ( offset + size > context->staging_size ) {
+        head += context->staging_size - offset;
+        offset = 0;
+    }
+
+    if ( head + size - context->staging_tail > context->staging_size ) {
+        return UINT64_MAX;
+    }
+
+    context->staging_head = head + size;
+    return offset;
+}
+
+static VkImageLayout xg_vk_upload_texture_final_layout ( const xg_upload_texture_params_t* params ) {
+    if ( params->final_layout == xg_texture_layout_undefined_m ) {
+        return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    }
+    return xg_image_layout_to_vk ( params->final_layout );
+}
+
+static void xg_vk_upload_record_copies ( xg_vk_upload_device_context_t* context, xg_vk_upload_batch_t* batch, const uint64_t* staging_offsets ) {
+    const xg_vk_device_t* device = xg_vk_device_get ( context->device_handle );
+    const xg_vk_buffer_t* staging = xg_vk_buffer_get ( context->staging_buffer );
+    VkCommandBuffer vk_cmd_buffer = batch->copy_cmd_buffer;
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    VkResult result = vkBeginCommandBuffer ( vk_cmd_buffer, &begin_info );
+    xg_vk_assert_m ( result );
+
+    uint32_t src_family = VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dst_family = VK_QUEUE_FAMILY_IGNORED;
+    VkPipelineStageFlags2KHR release_stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR;
+    VkAccessFlags2KHR release_access = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR;
+
+    // Release half of the ownership transfer, the acquire half is recorded on the graphics queue
+    if ( context->requires_ownership_transfer ) {
+        src_family = device->queues[xg_cmd_queue_copy_m].vk_family_idx;
+        dst_family = device->queues[xg_cmd_queue_graphics_m].vk_family_idx;
+        release_stage = VK_PIPELINE_STAGE_2_NONE_KHR;
+        release_access = VK_ACCESS_2_NONE_KHR;
+    }
+
+    VkImageMemoryBarrier2KHR texture_barriers[xg_vk_upload_max_requests_per_batch_m];
+    VkBufferMemoryBarrier2KHR buffer_barriers[xg_vk_upload_max_requests_per_batch_m];
+    uint32_t texture_barriers_count = 0;
+    uint32_t buffer_barriers_count = 0;
+
+    // Transition all textures to copy dest
+    for ( uint32_t i = 0; i < batch->requests_count; ++i ) {
+        const xg_vk_upload_request_t* request = batch->requests_array[i];
+
+        if ( request->type == xg_vk_upload_request_texture_m ) {
+            const xg_vk_texture_t* texture = xg_vk_texture_get ( request->texture.texture );
+            texture_barriers[texture_barriers_count++] = ( VkImageMemoryBarrier2KHR ) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+                .pNext = NULL,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE_KHR,
+                .srcAccessMask = VK_ACCESS_2_NONE_KHR,
+                .dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                .dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR,
+                .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+                .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                .image = texture->vk_handle,
+                .subresourceRange = {
+                    .aspectMask = xg_vk_upload_texture_aspect ( texture ),
+                    .baseMipLevel = request->texture.mip_base,
+                    .levelCount = xg_vk_upload_texture_mip_count ( texture, &request->texture ),
+                    .baseArrayLayer = request->texture.array_base,
+                    .layerCount = xg_vk_upload_texture_array_count ( texture, &request->texture ),
+                },
+            };
+        }
+    }
+
+    if ( texture_barriers_count > 0 ) {
+        VkDependencyInfoKHR dependency_info = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+            .pNext = NULL,
+            .imageMemoryBarrierCount = texture_barriers_count,
+            .pImageMemoryBarriers = texture_barriers,
+        };
+        xg_vk_device_ext_api ( context->device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &dependency_info );
+    }
+
+    texture_barriers_count = 0;
+
+    // Copies
+    for ( uint32_t i = 0; i < batch->requests_count; ++i ) {
+        const xg_vk_upload_request_t* request = batch->requests_array[i];
+
+        if ( request->type == xg_vk_upload_request_buffer_m ) {
+            const xg_vk_buffer_t* buffer = xg_vk_buffer_get ( request->buffer.buffer );
+
+            VkBufferCopy region = {
+                .srcOffset = staging_offsets[i],
+                .dstOffset = request->buffer.offset,
+                .size = request->size,
+            };
+            vkCmdCopyBuffer ( vk_cmd_buffer, staging->vk_handle, buffer->vk_handle, 1, &region );
+
+            buffer_barriers[buffer_barriers_count++] = ( VkBufferMemoryBarrier2KHR ) {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
+                .pNext = NULL,
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR,
+                .dstStageMask = release_stage,
+                .dstAccessMask = release_access,
+                .srcQueueFamilyIndex = src_family,
+                .dstQueueFamilyIndex = dst_family,
+                .buffer = buffer->vk_handle,
+                .offset = request->buffer.offset,
+                .size = request->size,
+            };
+        } else {
+            const xg_vk_texture_t* texture = xg_vk_texture_get ( request->texture.texture );
+            VkImageAspectFlags aspect = xg_vk_upload_texture_aspect ( texture );
+            uint32_t mip_count = xg_vk_upload_texture_mip_count ( texture, &request->texture );
+            uint32_t array_count = xg_vk_upload_texture_array_count ( texture, &request->texture );
+
+            // Source data is tightly packed, mip major
+            VkBufferImageCopy regions[xg_vk_upload_max_mips_per_request_m];
+            uint64_t offset = staging_offsets[i];
+
+            for ( uint32_t j = 0; j < mip_count; ++j ) {
+                uint32_t mip = request->texture.mip_base + j;
+                regions[j] = ( VkBufferImageCopy ) {
+                    .bufferOffset = offset,
+                    .bufferRowLength = 0,
+                    .bufferImageHeight = 0,
+                    .imageSubresource = {
+                        .aspectMask = aspect,
+                        .mipLevel = mip,
+                        .baseArrayLayer = request->texture.array_base,
+                        .layerCount = array_count,
+                    },
+                    .imageOffset = { 0, 0, 0 },
+                    .imageExtent = {
+                        .width = std_max_u32 ( texture->params.width >> mip, 1 ),
+                        .height = std_max_u32 ( texture->params.height >> mip, 1 ),
+                        .depth = std_max_u32 ( texture->params.depth >> mip, 1 ),
+                    },
+                };
+                offset += xg_vk_upload_texture_mip_size ( texture, mip ) * array_count;
+            }
+
+            vkCmdCopyBufferToImage ( vk_cmd_buffer, staging->vk_handle, texture->vk_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mip_count, regions );
+
+            texture_barriers[texture_barriers_count++] = ( VkImageMemoryBarrier2KHR ) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+                .pNext = NULL,
+                .srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT_KHR,
+                .srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT_KHR,
+                .dstStageMask = release_stage,
+                .dstAccessMask = release_access,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout = xg_vk_upload_texture_final_layout ( &request->texture ),
+                .srcQueueFamilyIndex = src_family,
+                .dstQueueFamilyIndex = dst_family,
+                .image = texture->vk_handle,
+                .subresourceRange = {
+                    .aspectMask = aspect,
+                    .baseMipLevel = request->texture.mip_base,
+                    .levelCount = mip_count,
+                    .baseArrayLayer = request->texture.array_base,
+                    .layerCount = array_count,
+                },
+            };
+        }
+    }
+
+    VkDependencyInfoKHR dependency_info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+        .pNext = NULL,
+        .bufferMemoryBarrierCount = buffer_barriers_count,
+        .pBufferMemoryBarriers = buffer_barriers,
+        .imageMemoryBarrierCount = texture_barriers_count,
+        .pImageMemoryBarriers = texture_barriers,
+    };
+    xg_vk_device_ext_api ( context->device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &dependency_info );
+
+    result = vkEndCommandBuffer ( vk_cmd_buffer );
+    xg_vk_assert_m ( result );
+}
+
+// Acquire half of the ownership transfer. Barriers must match the release ones exactly, except for the stage/access masks.
+static void xg_vk_upload_record_acquire ( xg_vk_upload_device_context_t* context, xg_vk_upload_batch_t* batch ) {
+    const xg_vk_device_t* device = xg_vk_device_get ( context->device_handle );
+    VkCommandBuffer vk_cmd_buffer = batch->acquire_cmd_buffer;
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .pNext = NULL,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        .pInheritanceInfo = NULL,
+    };
+    VkResult result = vkBeginCommandBuffer ( vk_cmd_buffer, &begin_info );
+    xg_vk_assert_m ( result );
+
+    uint32_t src_family = device->queues[xg_cmd_queue_copy_m].vk_family_idx;
+    uint32_t dst_family = device->queues[xg_cmd_queue_graphics_m].vk_family_idx;
+
+    VkImageMemoryBarrier2KHR texture_barriers[xg_vk_upload_max_requests_per_batch_m];
+    VkBufferMemoryBarrier2KHR buffer_barriers[xg_vk_upload_max_requests_per_batch_m];
+    uint32_t texture_barriers_count = 0;
+    uint32_t buffer_barriers_count = 0;
+
+    for ( uint32_t i = 0; i < batch->requests_count; ++i ) {
+        const xg_vk_upload_request_t* request = batch->requests_array[i];
+
+        if ( request->type == xg_vk_upload_request_buffer_m ) {
+            const xg_vk_buffer_t* buffer = xg_vk_buffer_get ( request->buffer.buffer );
+            buffer_barriers[buffer_barriers_count++] = ( VkBufferMemoryBarrier2KHR ) {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
+                .pNext = NULL,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE_KHR,
+                .srcAccessMask = VK_ACCESS_2_NONE_KHR,
+                .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR,
+                .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR,
+                .srcQueueFamilyIndex = src_family,
+                .dstQueueFamilyIndex = dst_family,
+                .buffer = buffer->vk_handle,
+                .offset = request->buffer.offset,
+                .size = request->size,
+            };
+        } else {
+            const xg_vk_texture_t* texture = xg_vk_texture_get ( request->texture.texture );
+            texture_barriers[texture_barriers_count++] = ( VkImageMemoryBarrier2KHR ) {
+                .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+                .pNext = NULL,
+                .srcStageMask = VK_PIPELINE_STAGE_2_NONE_KHR,
+                .srcAccessMask = VK_ACCESS_2_NONE_KHR,
+                .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT_KHR,
+                .dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT_KHR | VK_ACCESS_2_MEMORY_WRITE_BIT_KHR,
+                .oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .newLayout = xg_vk_upload_texture_final_layout ( &request->texture ),
+                .srcQueueFamilyIndex = src_family,
+                .dstQueueFamilyIndex = dst_family,
+                .image = texture->vk_handle,
+                .subresourceRange = {
+                    .aspectMask = xg_vk_upload_texture_aspect ( texture ),
+                    .baseMipLevel = request->texture.mip_base,
+                    .levelCount = xg_vk_upload_texture_mip_count ( texture, &request->texture ),
+                    .baseArrayLayer = request->texture.array_base,
+                    .layerCount = xg_vk_upload_texture_array_count ( texture, &request->texture ),
+                },
+            };
+        }
+    }
+
+    VkDependencyInfoKHR dependency_info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+        .pNext = NULL,
+        .bufferMemoryBarrierCount = buffer_barriers_count,
+        .pBufferMemoryBarriers = buffer_barriers,
+        .imageMemoryBarrierCount = texture_barriers_count,
+        .pImageMemoryBarriers = texture_barriers,
+    };
+    xg_vk_device_ext_api ( context->device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &dependency_info );
+
+    result = vkEndCommandBuffer ( vk_cmd_buffer );
+    xg_vk_assert_m ( result );
+}
+
+static void xg_vk_upload_submit ( VkQueue queue, VkCommandBuffer cmd_buffer, VkSemaphore wait_semaphore, uint64_t wait_value, VkSemaphore signal_semaphore, uint64_t signal_value ) {
+    VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    uint32_t wait_count = wait_semaphore != VK_NULL_HANDLE ? 1 : 0;
+
+    VkTimelineSemaphoreSubmitInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+        .pNext = NULL,
+        .waitSemaphoreValueCount = wait_count,
+        .pWaitSemaphoreValues = &wait_value,
+        .signalSemaphoreValueCount = 1,
+        .pSignalSemaphoreValues = &signal_value,
+    };
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = &timeline_info,
+        .waitSemaphoreCount = wait_count,
+        .pWaitSemaphores = &wait_semaphore,
+        .pWaitDstStageMask = &wait_stage,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd_buffer,
+        .signalSemaphoreCount = 1,
+        .pSignalSemaphores = &signal_semaphore,
+    };
+
+    VkResult result = vkQueueSubmit ( queue, 1, &submit_info, VK_NULL_HANDLE );
+    xg_vk_assert_m ( result );
+}
+
+static void xg_vk_upload_retire_batches ( xg_vk_upload_device_context_t* context ) {
+    const xg_vk_device_t* device = xg_vk_device_get ( context->device_handle );
+
+    uint64_t completed_value;
+    VkResult result = vkGetSemaphoreCounterValue ( device->vk_handle, context->timeline, &completed_value );
+    xg_vk_assert_m ( result );
+
+    while ( context->batches_pop < context->batches_put ) {
+        xg_vk_upload_batch_t* batch = &context->batches_array[context->batches_pop % xg_vk_upload_max_batches_m];
+
+        if ( batch->timeline_value > completed_value ) {
+            break;
+        }
+
+        // Only acquire once the copy is done, to avoid stalling the graphics queue on the copy queue
+        if ( context->requires_ownership_transfer ) {
+            xg_vk_upload_record_acquire ( context, batch );
+            xg_vk_upload_submit ( device->queues[xg_cmd_queue_graphics_m].vk_handle, batch->acquire_cmd_buffer, context->timeline, batch->timeline_value, context->acquire_timeline, batch->timeline_value );
+            context->acquire_value = batch->timeline_value;
+        }
+
+        context->staging_tail = batch->staging_end;
+        context->transferring_bytes -= batch->size;
+        context->transferring_count -= batch->requests_count;
+        context->uploaded_bytes += batch->size;
+
+        std_mutex_lock ( &xg_vk_upload_state->requests_mutex );
+        for ( uint32_t i = 0; i < batch->requests_count; ++i ) {
+            xg_vk_upload_request_t* request = batch->requests_array[i];
+            request->status = xg_upload_status_complete_m;
+            request->gen += 1;
+            std_list_push ( &xg_vk_upload_state->requests_freelist, request );
+        }
+        std_mutex_unlock ( &xg_vk_upload_state->requests_mutex );
+
+        batch->requests_count = 0;
+        ++context->batches_pop;
+    }
+}
+
+static bool xg_vk_upload_batch_is_reusable ( xg_vk_upload_device_context_t* context, const xg_vk_upload_batch_t* batch ) {
+    if ( !batch->is_submitted || !context->requires_ownership_transfer ) {
+        return true;
+    }
+
+    const xg_vk_device_t* device = xg_vk_device_get ( context->device_handle );
+    uint64_t acquired_value;
+    VkResult result = vkGetSemaphoreCounterValue ( device->vk_handle, context->acquire_timeline, &acquired_value );
+    xg_vk_assert_m ( result );
+    return acquired_value >= batch->timeline_value;
+}
+
+static void xg_vk_upload_flush_queue ( xg_vk_upload_device_context_t* context ) {
+    if ( context->batches_put - context->batches_pop >= xg_vk_upload_max_batches_m ) {
+        return;
+    }
+
+    xg_vk_upload_batch_t* batch = &context->batches_array[context->batches_put % xg_vk_upload_max_batches_m];
+
+    if ( !xg_vk_upload_batch_is_reusable ( context, batch ) ) {
+        return;
+    }
+
+    uint64_t staging_offsets[xg_vk_upload_max_requests_per_batch_m];
+    batch->requests_count = 0;
+    batch->size = 0;
+
+    std_mutex_lock ( &context->queue_mutex );
+
+    while ( context->queue_head && batch->requests_count < xg_vk_upload_max_requests_per_batch_m ) {
+        xg_vk_upload_request_t* request = context->queue_head;
+
+        // Always let at least one request through, to guarantee progress on requests larger than the budget
+        if ( batch->requests_count > 0 && batch->size + request->size > context->budget ) {
+            break;
+        }
+
+        uint64_t offset = xg_vk_upload_staging_alloc ( context, request->size );
+
+        if ( offset == UINT64_MAX ) {
+            break;
+        }
+
+        const void* data = request->type == xg_vk_upload_request_buffer_m ? request->buffer.data : request->texture.data;
+        std_mem_copy ( context->staging_base + offset, data, request->size );
+
+        context->queue_head = request->next;
+        if ( context->queue_head == NULL ) {
+            context->queue_tail = NULL;
+        }
+        context->queued_bytes -= request->size;
+        context->queued_count -= 1;
+
+        request->next = NULL;
+        request->status = xg_upload_status_transferring_m;
+        staging_offsets[batch->requests_count] = offset;
+        batch->requests_array[batch->requests_count++] = request;
+        batch->size += request->size;
+    }
+
+    std_mutex_unlock ( &context->queue_mutex );
+
+    if ( batch->requests_count == 0 ) {
+        return;
+    }
+
+    const xg_vk_device_t* device = xg_vk_device_get ( context->device_handle );
+
+    xg_vk_upload_record_copies ( context, batch, staging_offsets );
+
+    batch->timeline_value = ++context->timeline_value;
+    batch->staging_end = context->staging_head;
+    batch->is_submitted = true;
+    xg_vk_upload_submit ( device->queues[xg_cmd_queue_copy_m].vk_handle, batch->copy_cmd_buffer, VK_NULL_HANDLE, 0, context->timeline, batch->timeline_value );
+
+    context->transferring_bytes += batch->size;
+    context->transferring_count += batch->requests_count;
+    ++context->batches_put;
+}
+
+void xg_vk_upload_update ( xg_device_h device_handle ) {
+    xg_vk_upload_device_context_t* context = xg_vk_upload_device_context_get ( device_handle );
+    xg_vk_upload_retire_batches ( context );
+    xg_vk_upload_flush_queue ( context );
+}
+
+static void xg_vk_upload_wait_timeline ( const xg_vk_device_t* device, VkSemaphore semaphore, uint64_t value ) {
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .semaphoreCount = 1,
+        .pSemaphores = &semaphore,
+        .pValues = &value,
+    };
+    VkResult result = vkWaitSemaphores ( device->vk_handle, &wait_info, UINT64_MAX );
+    xg_vk_assert_m ( result );
+}
+
+void xg_vk_upload_wait_all ( xg_device_h device_handle ) {
+    xg_vk_upload_device_context_t* context = xg_vk_upload_device_context_get ( device_handle );
+    const xg_vk_device_t* device = xg_vk_device_get ( device_handle );
+
+    for ( ;; ) {
+        xg_vk_upload_update ( device_handle );
+
+        if ( context->batches_pop == context->batches_put && context->queue_head == NULL ) {
+            break;
+        }
+
+        xg_vk_upload_wait_timeline ( device, context->timeline, context->timeline_value );
+        xg_vk_upload_wait_timeline ( device, context->acquire_timeline, context->acquire_value );
+    }
+
+    xg_vk_upload_wait_timeline ( device, context->acquire_timeline, context->acquire_value );
+}
+
+void xg_vk_upload_set_budget ( xg_device_h device_handle, uint64_t bytes_per_update ) {
+    xg_vk_upload_device_context_t* context = xg_vk_upload_device_context_get ( device_handle );
+    context->budget = bytes_per_update;
+}
+
+void xg_vk_upload_get_info ( xg_upload_info_t* info, xg_device_h device_handle ) {
+    xg_vk_upload_device_context_t* context = xg_vk_upload_device_context_get ( device_handle );
+    info->budget = context->budget;
+    info->staging_size = context->staging_size;
+    info->staging_used_size = context->staging_head - context->staging_tail;
+    info->queued_bytes = context->queued_bytes;
+    info->queued_count = context->queued_count;
+    info->transferring_bytes = context->transferring_bytes;
+    info->transferring_count = context->transferring_count;
+    info->uploaded_bytes = context->uploaded_bytes;
+    info->dedicated_copy_queue = context->requires_ownership_transfer;
+}
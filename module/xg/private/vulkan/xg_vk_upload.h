@@ -0,0 +1,109 @@
+#pragma once
+
+#include <xg.h>
+
+#include "xg_vk.h"
+
+#include <std_mutex.h>
+
+/*
+    Async upload service
+
+    Requests are queued by the user and picked up by xg_vk_upload_update. Each update packs as many queued requests
+    as the bandwidth budget and the staging ring allow into a batch, copies their data into the staging ring and
+    records the copies on the copy queue. The batch signals a timeline semaphore with a monotonically increasing value.
+    Once the copy queue is done with a batch (polled on the CPU) a small graphics queue submission waits on the same
+    timeline value and acquires ownership of the uploaded resources, transitioning textures to their final layout.
+    Any workload submitted after a request is reported as complete is ordered after that acquire.
+
+    When the copy and graphics queues share the same family no ownership transfer is needed and the final layout
+    transition is recorded directly in the copy cmd buffer.
+
+    Updates and queue submissions happen on the thread that calls update, same as workload submission.
+*/
+
+typedef enum {
+    xg_vk_upload_request_buffer_m,
+    xg_vk_upload_request_texture_m,
+} xg_vk_upload_request_type_e;
+
+typedef struct xg_vk_upload_request_t {
+    struct xg_vk_upload_request_t* next; // freelist / queue
+    xg_vk_upload_request_type_e type;
+    xg_upload_status_e status;
+    uint32_t gen;
+    uint32_t batch;
+    uint64_t size;
+    union {
+        xg_upload_buffer_params_t buffer;
+        xg_upload_texture_params_t texture;
+    };
+} xg_vk_upload_request_t;
+
+typedef struct {
+    uint64_t timeline_value;
+    uint64_t staging_end;
+    uint64_t size;
+    uint32_t requests_count;
+    xg_vk_upload_request_t* requests_array[xg_vk_upload_max_requests_per_batch_m];
+    VkCommandBuffer copy_cmd_buffer;
+    VkCommandBuffer acquire_cmd_buffer;
+    bool is_submitted;
+} xg_vk_upload_batch_t;
+
+typedef struct {
+    bool is_active;
+    xg_device_h device_handle;
+    bool requires_ownership_transfer;
+
+    VkCommandPool copy_cmd_pool;
+    VkCommandPool acquire_cmd_pool;
+    VkSemaphore timeline;           // signaled by the copy queue, one value per batch
+    uint64_t timeline_value;
+    VkSemaphore acquire_timeline;   // signaled by the graphics queue acquire submits, same value as the batch
+    uint64_t acquire_value;
+
+    xg_buffer_h staging_buffer;
+    char* staging_base;
+    uint64_t staging_size;
+    uint64_t staging_head;
+    uint64_t staging_tail;
+
+    // Batches are used in fifo order, since timeline values complete in order
+    xg_vk_upload_batch_t batches_array[xg_vk_upload_max_batches_m];
+    uint64_t batches_put;
+    uint64_t batches_pop;
+
+    xg_vk_upload_request_t* queue_head;
+    xg_vk_upload_request_t* queue_tail;
+    std_mutex_t queue_mutex;
+
+    uint64_t budget;
+    uint64_t queued_bytes;
+    uint64_t transferring_bytes;
+    uint64_t uploaded_bytes;
+    uint32_t queued_count;
+    uint32_t transferring_count;
+} xg_vk_upload_device_context_t;
+
+typedef struct {
+    xg_vk_upload_request_t* requests_array;
+    xg_vk_upload_request_t* requests_freelist;
+    std_mutex_t requests_mutex;
+    xg_vk_upload_device_context_t device_contexts[xg_max_active_devices_m];
+} xg_vk_upload_state_t;
+
+void xg_vk_upload_load ( xg_vk_upload_state_t* state );
+void xg_vk_upload_reload ( xg_vk_upload_state_t* state );
+void xg_vk_upload_unload ( void );
+
+void xg_vk_upload_activate_device ( xg_device_h device );
+void xg_vk_upload_deactivate_device ( xg_device_h device );
+
+xg_upload_h xg_vk_upload_buffer ( const xg_upload_buffer_params_t* params );
+xg_upload_h xg_vk_upload_texture ( const xg_upload_texture_params_t* params );
+xg_upload_status_e xg_vk_upload_get_status ( xg_upload_h upload );
+void xg_vk_upload_update ( xg_device_h device );
+void xg_vk_upload_wait_all ( xg_device_h device );
+void xg_vk_upload_set_budget ( xg_device_h device, uint64_t bytes_per_update );
+void xg_vk_upload_get_info ( xg_upload_info_t* info, xg_device_h device );
@@ -897,6 +897,12 @@ static xg_vk_workload_cmd_chunk_result_t xg_vk_workload_chunk_cmd_headers ( xg_v
             std_assert_m ( queue_chunk.queue == xg_cmd_queue_graphics_m || queue_chunk.queue == xg_cmd_queue_compute_m );
             if ( cmd_chunk.begin == -1 ) cmd_chunk.begin = cmd_it;
             break;
+        case xg_cmd_texture_generate_mips_m:
+            // blits require a graphics queue
+            std_assert_m ( !in_renderpass );
+            std_assert_m ( queue_chunk.queue == xg_cmd_queue_graphics_m );
+            if ( cmd_chunk.begin == -1 ) cmd_chunk.begin = cmd_it;
+            break;
         case xg_cmd_copy_buffer_m:
         case xg_cmd_copy_texture_m:
         case xg_cmd_copy_buffer_to_texture_m:
@@ -1023,6 +1029,12 @@ static void xg_vk_workload_debug_print_cmd_headers ( const xg_cmd_header_t* cmd_
             std_log_info_m ( "copy_texture_to_buffer" );
         }
         break;
+        case xg_cmd_texture_generate_mips_m: {
+            std_auto_m args = ( xg_cmd_generate_texture_mips_params_t* ) header->args;
+            const xg_vk_texture_t* texture = xg_vk_texture_get ( args->texture );
+            std_log_info_m ( "texture_generate_mips " std_fmt_str_m " " std_fmt_u64_m " MIP:" std_fmt_u32_m "->" std_fmt_u32_m, texture->params.debug_name, texture->vk_handle, args->mip_base, args->mip_count );
+        }
+        break;
         case xg_cmd_begin_debug_region_m: {
             std_auto_m args = ( xg_cmd_begin_debug_region_t* ) header->args;
             std_log_info_m ( "debug_region_begin " std_fmt_str_m, args->name );
@@ -1085,6 +1097,178 @@ typedef struct {
     xg_graphics_pipeline_dynamic_state_bit_e dynamic_flags;
 } xg_vk_workload_translate_cache_t;
 
+static VkImageMemoryBarrier2KHR xg_vk_workload_mip_barrier ( const xg_vk_texture_t* texture, VkImageAspectFlags aspect, uint32_t mip_base, uint32_t mip_count, uint32_t array_base, uint32_t array_count, xg_texture_layout_e old_layout, xg_texture_layout_e new_layout, xg_pipeline_stage_bit_e blocker, xg_memory_access_bit_e flushes, xg_pipeline_stage_bit_e blocked, xg_memory_access_bit_e invalidations ) {
+    VkImageMemoryBarrier2KHR vk_barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
+        .pNext = NULL,
+        .srcAccessMask = xg_memory_access_to_vk ( flushes ),
+        .srcStageMask = xg_pipeline_stage_to_vk ( blocker ),
+        .dstAccessMask = xg_memory_access_to_vk ( invalidations ),
+        .dstStageMask = xg_pipeline_stage_to_vk ( blocked ),
+        .oldLayout = xg_image_layout_to_vk ( old_layout ),
+        .newLayout = xg_image_layout_to_vk ( new_layout ),
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = texture->vk_handle,
+        .subresourceRange.aspectMask = aspect,
+        .subresourceRange.baseMipLevel = mip_base,
+        .subresourceRange.levelCount = mip_count,
+        .subresourceRange.baseArrayLayer = array_base,
+        .subresourceRange.layerCount = array_count,
+    };
+    return vk_barrier;
+}
+
+typedef struct {
+    float src_resolution_rcp_f32[2];
+    uint32_t mip_count;
+    uint32_t pad0;
+} xg_vk_workload_mip_gen_uniforms_t;
+
+// All of the mips are kept in general layout for the whole duration of the cmd, that way the last mip written
+// by a dispatch can be sampled by the next one with only a memory dependency in between.
+// The descriptor sets are allocated here from the workload pool, since the cmd is expanded only at translation time.
+static void xg_vk_workload_generate_mips_compute ( VkCommandBuffer vk_cmd_buffer, xg_device_h device_handle, xg_workload_h workload_handle, const xg_vk_texture_t* texture, VkImageAspectFlags aspect, const xg_cmd_generate_texture_mips_params_t* args, uint32_t mip_count ) {
+    const xg_vk_workload_t* workload = xg_vk_workload_get ( workload_handle );
+    const xg_vk_device_t* device = xg_vk_device_get ( device_handle );
+    const xg_vk_compute_pipeline_t* pipeline = xg_vk_compute_pipeline_get ( args->pipeline );
+    xg_resource_bindings_layout_h layout_handle = xg_vk_pipeline_resource_binding_set_layout_get ( args->pipeline, xg_shader_binding_set_dispatch_m );
+    const xg_vk_resource_bindings_layout_t* layout = xg_vk_pipeline_resource_bindings_layout_get ( layout_handle );
+    const xg_vk_sampler_t* sampler = xg_vk_sampler_get ( xg_sampler_get_default ( device_handle, xg_default_sampler_linear_clamp_m ) );
+
+    uint32_t mip_base = args->mip_base;
+    uint32_t mip_end = mip_base + mip_count;
+
+    VkImageMemoryBarrier2KHR vk_barriers[2];
+    vk_barriers[0] = xg_vk_workload_mip_barrier ( texture, aspect, mip_base, 1, 0, 1,
+        args->source_layout, xg_texture_layout_shader_write_m,
+        xg_pipeline_stage_bit_all_commands_m, xg_memory_access_bit_memory_write_m, xg_pipeline_stage_bit_compute_shader_m, xg_memory_access_bit_shader_read_m );
+    vk_barriers[1] = xg_vk_workload_mip_barrier ( texture, aspect, mip_base + 1, mip_count, 0, 1,
+        xg_texture_layout_undefined_m, xg_texture_layout_shader_write_m,
+        xg_pipeline_stage_bit_top_of_pipe_m, xg_memory_access_bit_none_m, xg_pipeline_stage_bit_compute_shader_m, xg_memory_access_bit_shader_write_m );
+
+    VkDependencyInfoKHR vk_dependency_info = {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+        .pNext = NULL,
+        .dependencyFlags = 0,
+        .memoryBarrierCount = 0,
+        .bufferMemoryBarrierCount = 0,
+        .imageMemoryBarrierCount = 2,
+        .pImageMemoryBarriers = vk_barriers,
+    };
+    xg_vk_device_ext_api ( device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &vk_dependency_info );
+
+    vkCmdBindPipeline ( vk_cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->common.vk_handle );
+
+    uint32_t src_mip = mip_base;
+
+    while ( src_mip < mip_end ) {
+        uint32_t dispatch_mip_count = std_min_u32 ( mip_end - src_mip, xg_mip_gen_max_mips_per_dispatch_m );
+        uint32_t src_width = std_max_u32 ( ( uint32_t ) texture->params.width >> src_mip, 1 );
+        uint32_t src_height = std_max_u32 ( ( uint32_t ) texture->params.height >> src_mip, 1 );
+
+        xg_vk_workload_mip_gen_uniforms_t uniforms = {
+            .src_resolution_rcp_f32 = { 1.f / src_width, 1.f / src_height },
+            .mip_count = dispatch_mip_count,
+        };
+        xg_buffer_range_t uniform_range = xg_workload_write_uniform ( workload_handle, &uniforms, sizeof ( uniforms ) );
+
+        VkDescriptorSet vk_set;
+        VkDescriptorSetAllocateInfo vk_set_alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = NULL,
+            .descriptorPool = workload->desc_allocator->vk_desc_pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &layout->vk_handle,
+        };
+        VkResult set_alloc_result = vkAllocateDescriptorSets ( device->vk_handle, &vk_set_alloc_info, &vk_set );
+        xg_vk_assert_m ( set_alloc_result );
+
+        VkDescriptorBufferInfo buffer_info = {
+            .buffer = xg_vk_buffer_get ( uniform_range.handle )->vk_handle,
+            .offset = uniform_range.offset,
+            .range = uniform_range.size,
+        };
+
+        // Slot 0 is the sampled source mip. Slots past the dispatch mip count alias its last mip, the shader never writes to them
+        VkDescriptorImageInfo image_infos[1 + xg_mip_gen_max_mips_per_dispatch_m];
+        for ( uint32_t i = 0; i < 1 + xg_mip_gen_max_mips_per_dispatch_m; ++i ) {
+            uint32_t mip = i == 0 ? src_mip : src_mip + std_min_u32 ( i, dispatch_mip_count );
+            const xg_vk_texture_view_t* view = xg_vk_texture_get_view ( args->texture, xg_texture_view_m ( .mip_base = mip, .mip_count = 1 ) );
+            std_assert_m ( view->vk_handle != VK_NULL_HANDLE );
+            image_infos[i] = ( VkDescriptorImageInfo ) {
+                .sampler = VK_NULL_HANDLE,
+                .imageView = view->vk_handle,
+                .imageLayout = xg_image_layout_to_vk ( xg_texture_layout_shader_write_m ),
+            };
+        }
+
+        VkDescriptorImageInfo sampler_info = {
+            .sampler = sampler->vk_handle,
+            .imageView = VK_NULL_HANDLE,
+        };
+
+        VkWriteDescriptorSet writes[3 + xg_mip_gen_max_mips_per_dispatch_m];
+        uint32_t writes_count = 0;
+
+        writes[writes_count++] = ( VkWriteDescriptorSet ) {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = vk_set,
+            .dstBinding = layout->shader_register_to_descriptor_idx[0],
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .pBufferInfo = &buffer_info,
+        };
+        writes[writes_count++] = ( VkWriteDescriptorSet ) {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = vk_set,
+            .dstBinding = layout->shader_register_to_descriptor_idx[1],
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            .pImageInfo = &image_infos[0],
+        };
+        writes[writes_count++] = ( VkWriteDescriptorSet ) {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = vk_set,
+            .dstBinding = layout->shader_register_to_descriptor_idx[2],
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER,
+            .pImageInfo = &sampler_info,
+        };
+
+        for ( uint32_t i = 0; i < xg_mip_gen_max_mips_per_dispatch_m; ++i ) {
+            writes[writes_count++] = ( VkWriteDescriptorSet ) {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = vk_set,
+                .dstBinding = layout->shader_register_to_descriptor_idx[3 + i],
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = &image_infos[1 + i],
+            };
+        }
+
+        vkUpdateDescriptorSets ( device->vk_handle, writes_count, writes, 0, NULL );
+        vkCmdBindDescriptorSets ( vk_cmd_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->common.vk_layout_handle, xg_shader_binding_set_dispatch_m, 1, &vk_set, 0, NULL );
+        vkCmdDispatch ( vk_cmd_buffer, std_div_ceil_u32 ( src_width, xg_mip_gen_tile_size_m ), std_div_ceil_u32 ( src_height, xg_mip_gen_tile_size_m ), 1 );
+
+        src_mip += dispatch_mip_count;
+
+        if ( src_mip < mip_end ) {
+            vk_barriers[0] = xg_vk_workload_mip_barrier ( texture, aspect, src_mip, 1, 0, 1,
+                xg_texture_layout_shader_write_m, xg_texture_layout_shader_write_m,
+                xg_pipeline_stage_bit_compute_shader_m, xg_memory_access_bit_shader_write_m, xg_pipeline_stage_bit_compute_shader_m, xg_memory_access_bit_shader_read_m );
+            vk_dependency_info.imageMemoryBarrierCount = 1;
+            xg_vk_device_ext_api ( device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &vk_dependency_info );
+        }
+    }
+
+    vk_barriers[0] = xg_vk_workload_mip_barrier ( texture, aspect, mip_base, mip_count + 1, 0, 1,
+        xg_texture_layout_shader_write_m, args->final_layout,
+        xg_pipeline_stage_bit_compute_shader_m, xg_memory_access_bit_shader_write_m, xg_pipeline_stage_bit_all_commands_m, xg_memory_access_bit_memory_read_m );
+    vk_dependency_info.imageMemoryBarrierCount = 1;
+    xg_vk_device_ext_api ( device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &vk_dependency_info );
+}
+
 xg_vk_workload_translate_cmd_chunks_result_t xg_vk_workload_translate_cmd_chunks ( xg_vk_workload_translate_context_t* context, xg_device_h device_handle, xg_workload_h workload_handle, const xg_cmd_header_t* cmd_headers_array, const xg_vk_workload_cmd_chunk_t* cmd_chunks_array, uint32_t cmd_chunks_count ) {
     const xg_vk_workload_t* workload = xg_vk_workload_get ( workload_handle );
     const xg_vk_device_t* device = xg_vk_device_get ( device_handle );
@@ -1574,6 +1758,14 @@ xg_vk_workload_translate_cmd_chunks_result_t xg_vk_workload_translate_cmd_chunks
                     .imageExtent.depth = dest->params.depth,
                 };
 
+                if ( args->width != 0 && args->height != 0 ) {
+                    copy.imageOffset.x = ( int32_t ) args->x;
+                    copy.imageOffset.y = ( int32_t ) args->y;
+                    copy.imageExtent.width = args->width;
+                    copy.imageExtent.height = args->height;
+                    copy.imageExtent.depth = 1;
+                }
+
                 vkCmdCopyBufferToImage ( vk_cmd_buffer, source->vk_handle, dest->vk_handle, dest_layout, 1, &copy );
             }
             break;
@@ -1611,6 +1803,113 @@ xg_vk_workload_translate_cmd_chunks_result_t xg_vk_workload_translate_cmd_chunks
                 vkCmdCopyImageToBuffer ( vk_cmd_buffer, source->vk_handle, source_layout, dest->vk_handle, 1, &copy );
             }
             break;
+            case xg_cmd_texture_generate_mips_m: {
+                std_auto_m args = ( xg_cmd_generate_texture_mips_params_t* ) header->args;
+                std_assert_m ( !in_renderpass );
+
+                const xg_vk_texture_t* texture = xg_vk_texture_get ( args->texture );
+
+                VkImageAspectFlags aspect = xg_texture_flags_to_vk_aspect ( texture->flags );
+
+                if ( aspect == VK_IMAGE_ASPECT_NONE ) {
+                    aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+                }
+
+                uint32_t mip_base = args->mip_base;
+                uint32_t mip_count = args->mip_count;
+                uint32_t array_base = args->array_base;
+                uint32_t array_count = args->array_count;
+
+                if ( mip_count == xg_texture_all_mips_m ) {
+                    std_assert_m ( texture->params.mip_levels > mip_base );
+                    mip_count = ( uint32_t ) texture->params.mip_levels - mip_base - 1;
+                }
+
+                if ( array_count == xg_texture_whole_array_m ) {
+                    array_count = texture->params.array_layers - array_base;
+                }
+
+                if ( mip_count == 0 ) {
+                    break;
+                }
+
+                bool use_compute = args->pipeline != xg_null_handle_m;
+                use_compute &= ( texture->params.allowed_usage & xg_texture_usage_bit_storage_m ) != 0;
+                use_compute &= texture->params.view_access == xg_texture_view_access_separate_mips_m;
+                use_compute &= texture->params.dimension == xg_texture_dimension_2d_m && texture->params.array_layers == 1;
+
+                if ( use_compute ) {
+                    xg_vk_workload_generate_mips_compute ( vk_cmd_buffer, device_handle, workload_handle, texture, aspect, args, mip_count );
+                    break;
+                }
+
+                VkFilter filter = xg_sampler_filter_to_vk ( args->filter );
+
+                // source mip -> copy source, generated mips -> copy dest
+                VkImageMemoryBarrier2KHR vk_barriers[2];
+                vk_barriers[0] = xg_vk_workload_mip_barrier ( texture, aspect, mip_base, 1, array_base, array_count,
+                    args->source_layout, xg_texture_layout_copy_source_m,
+                    xg_pipeline_stage_bit_all_commands_m, xg_memory_access_bit_memory_write_m, xg_pipeline_stage_bit_transfer_m, xg_memory_access_bit_transfer_read_m );
+                vk_barriers[1] = xg_vk_workload_mip_barrier ( texture, aspect, mip_base + 1, mip_count, array_base, array_count,
+                    xg_texture_layout_undefined_m, xg_texture_layout_copy_dest_m,
+                    xg_pipeline_stage_bit_top_of_pipe_m, xg_memory_access_bit_none_m, xg_pipeline_stage_bit_transfer_m, xg_memory_access_bit_transfer_write_m );
+
+                VkDependencyInfoKHR vk_dependency_info = {
+                    .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
+                    .pNext = NULL,
+                    .dependencyFlags = 0,
+                    .memoryBarrierCount = 0,
+                    .bufferMemoryBarrierCount = 0,
+                    .imageMemoryBarrierCount = 2,
+                    .pImageMemoryBarriers = vk_barriers,
+                };
+                xg_vk_device_ext_api ( device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &vk_dependency_info );
+
+                // Each mip is blitted from the previous one, for all array layers at once, and then turned into a copy source for the next one.
+                // Once done all mips are copy sources and can be transitioned to the final layout together.
+                for ( uint32_t i = 1; i <= mip_count; ++i ) {
+                    uint32_t src_mip = mip_base + i - 1;
+                    uint32_t dst_mip = mip_base + i;
+
+                    VkImageBlit blit = {
+                        .srcOffsets[0].x = 0,
+                        .srcOffsets[0].y = 0,
+                        .srcOffsets[0].z = 0,
+                        .srcOffsets[1].x = ( int32_t ) std_max_u32 ( ( uint32_t ) texture->params.width >> src_mip, 1 ),
+                        .srcOffsets[1].y = ( int32_t ) std_max_u32 ( ( uint32_t ) texture->params.height >> src_mip, 1 ),
+                        .srcOffsets[1].z = ( int32_t ) std_max_u32 ( ( uint32_t ) texture->params.depth >> src_mip, 1 ),
+                        .dstOffsets[0].x = 0,
+                        .dstOffsets[0].y = 0,
+                        .dstOffsets[0].z = 0,
+                        .dstOffsets[1].x = ( int32_t ) std_max_u32 ( ( uint32_t ) texture->params.width >> dst_mip, 1 ),
+                        .dstOffsets[1].y = ( int32_t ) std_max_u32 ( ( uint32_t ) texture->params.height >> dst_mip, 1 ),
+                        .dstOffsets[1].z = ( int32_t ) std_max_u32 ( ( uint32_t ) texture->params.depth >> dst_mip, 1 ),
+                        .srcSubresource.aspectMask = aspect,
+                        .srcSubresource.mipLevel = src_mip,
+                        .srcSubresource.baseArrayLayer = array_base,
+                        .srcSubresource.layerCount = array_count,
+                        .dstSubresource.aspectMask = aspect,
+                        .dstSubresource.mipLevel = dst_mip,
+                        .dstSubresource.baseArrayLayer = array_base,
+                        .dstSubresource.layerCount = array_count,
+                    };
+
+                    vkCmdBlitImage ( vk_cmd_buffer, texture->vk_handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->vk_handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, filter );
+
+                    vk_barriers[0] = xg_vk_workload_mip_barrier ( texture, aspect, dst_mip, 1, array_base, array_count,
+                        xg_texture_layout_copy_dest_m, xg_texture_layout_copy_source_m,
+                        xg_pipeline_stage_bit_transfer_m, xg_memory_access_bit_transfer_write_m, xg_pipeline_stage_bit_transfer_m, xg_memory_access_bit_transfer_read_m );
+                    vk_dependency_info.imageMemoryBarrierCount = 1;
+                    xg_vk_device_ext_api ( device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &vk_dependency_info );
+                }
+
+                vk_barriers[0] = xg_vk_workload_mip_barrier ( texture, aspect, mip_base, mip_count + 1, array_base, array_count,
+                    xg_texture_layout_copy_source_m, args->final_layout,
+                    xg_pipeline_stage_bit_transfer_m, xg_memory_access_bit_transfer_write_m, xg_pipeline_stage_bit_all_commands_m, xg_memory_access_bit_memory_read_m );
+                vk_dependency_info.imageMemoryBarrierCount = 1;
+                xg_vk_device_ext_api ( device_handle )->cmd_sync2_pipeline_barrier ( vk_cmd_buffer, &vk_dependency_info );
+            }
+            break;
             case xg_cmd_texture_clear_m: {
                 std_auto_m args = ( xg_cmd_texture_clear_t* ) header->args;
                 std_assert_m ( !in_renderpass );
@@ -2229,12 +2528,21 @@ static void xg_vk_workload_create_resources ( xg_workload_h workload_handle ) {
                                 .source_offset = args->staging.offset,
                                 .destination = texture_handle,
                             ) );
+                            if ( args->generate_mips ) {
+                                // Also takes care of transitioning the whole texture to the init layout
+                                xg_texture_layout_e final_layout = args->init_layout != xg_texture_layout_undefined_m ? args->init_layout : xg_texture_layout_copy_dest_m;
+                                xg_cmd_buffer_generate_texture_mips ( cmd_buffer, 0, &xg_cmd_generate_texture_mips_params_m (
+                                    .texture = texture_handle,
+                                    .source_layout = xg_texture_layout_copy_dest_m,
+                                    .final_layout = final_layout,
+                                ) );
+                            }
                             break;
                         default:
                             break;
                         }
 
-                        if ( args->init_layout != xg_texture_layout_undefined_m && args->init_layout != xg_texture_layout_copy_dest_m ) {
+                        if ( !args->generate_mips && args->init_layout != xg_texture_layout_undefined_m && args->init_layout != xg_texture_layout_copy_dest_m ) {
                             xg_cmd_buffer_barrier_set ( cmd_buffer, 0, &xg_barrier_set_m (
                                 .texture_memory_barriers_count = 1,
                                 .texture_memory_barriers = &xg_texture_memory_barrier_m (
@@ -17,6 +17,7 @@
     #include "vulkan/xg_vk_sampler.h"
     #include "vulkan/xg_vk_workload.h"
     #include "vulkan/xg_vk_query.h"
+    #include "vulkan/xg_vk_upload.h"
 #endif
     #include "vulkan/xg_vk_raytrace.h"
 
@@ -25,6 +26,7 @@ static void xg_api_init ( xg_i* xg ) {
     xg->get_devices_count = xg_vk_device_get_count;
     xg->get_devices = xg_vk_device_get_list;
     xg->get_device_info = xg_vk_device_get_info;
+    xg->get_format_texture_usage = xg_vk_device_get_format_texture_usage;
     xg->activate_device = xg_vk_device_activate;
     xg->deactivate_device = xg_vk_device_deactivate;
     xg->timestamp_to_ns = xg_vk_device_timestamp_period;
@@ -62,6 +64,14 @@ static void xg_api_init ( xg_i* xg ) {
     xg->set_workload_global_bindings = xg_workload_set_global_resource_group;
     xg->debug_capture_workload = xg_vk_workload_enable_debug_capture;
     xg->wait_for_workload = xg_workload_wait_for_workload;
+    // Upload
+    xg->upload_buffer = xg_vk_upload_buffer;
+    xg->upload_texture = xg_vk_upload_texture;
+    xg->get_upload_status = xg_vk_upload_get_status;
+    xg->update_uploads = xg_vk_upload_update;
+    xg->wait_all_uploads = xg_vk_upload_wait_all;
+    xg->set_upload_budget = xg_vk_upload_set_budget;
+    xg->get_upload_info = xg_vk_upload_get_info;
     // Raytrace
     xg->create_raytrace_geometry = xg_vk_raytrace_geometry_create;
     xg->create_raytrace_world = xg_vk_raytrace_world_create;
@@ -78,6 +88,7 @@ static void xg_api_init ( xg_i* xg ) {
     xg->cmd_copy_texture = xg_cmd_buffer_copy_texture;
     xg->cmd_copy_buffer = xg_cmd_buffer_copy_buffer;
     xg->cmd_copy_buffer_to_texture = xg_cmd_buffer_copy_buffer_to_texture;
+    xg->cmd_generate_texture_mips = xg_cmd_buffer_generate_texture_mips;
     xg->cmd_set_dynamic_viewport = xg_cmd_dynamic_viewport;
     xg->cmd_set_dynamic_scissor = xg_cmd_dynamic_scissor;
     //#if defined(std_platform_win32_m)
@@ -136,6 +147,7 @@ void* xg_load ( void* std_runtime ) {
     xg_vk_raytrace_load ( &state->vk.raytrace );
     xg_vk_pipeline_load ( &state->vk.pipeline );
     xg_vk_workload_load ( &state->vk.workload );
+    xg_vk_upload_load ( &state->vk.upload );
 
     xg_cmd_buffer_load ( &state->cmd_buffer );
     xg_resource_cmd_buffer_load ( &state->resource_cmd_buffer );
@@ -162,6 +174,7 @@ void xg_reload ( void* std_runtime, void* api ) {
     xg_vk_raytrace_reload ( &state->vk.raytrace );
     xg_vk_pipeline_reload ( &state->vk.pipeline );
     xg_vk_workload_reload ( &state->vk.workload );
+    xg_vk_upload_reload ( &state->vk.upload );
 
     xg_cmd_buffer_reload ( &state->cmd_buffer );
     xg_resource_cmd_buffer_reload ( &state->resource_cmd_buffer );
@@ -176,6 +189,7 @@ void xg_unload ( void ) {
 
     xg_debug_capture_unload();
 
+    xg_vk_upload_unload();
     xg_vk_workload_unload();
 
     xg_resource_cmd_buffer_unload();
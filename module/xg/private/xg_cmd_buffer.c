@@ -464,6 +464,13 @@ void xg_cmd_buffer_copy_texture_to_buffer ( xg_cmd_buffer_h cmd_buffer_handle, u
     *cmd_args = *params;
 }
 
+void xg_cmd_buffer_generate_texture_mips ( xg_cmd_buffer_h cmd_buffer_handle, uint64_t key, const xg_cmd_generate_texture_mips_params_t* params ) {
+    xg_cmd_buffer_t* cmd_buffer = xg_cmd_buffer_get ( cmd_buffer_handle );
+    std_auto_m cmd_args = xg_cmd_buffer_record_cmd_m ( cmd_buffer, xg_cmd_texture_generate_mips_m, key, xg_cmd_generate_texture_mips_params_t );
+
+    *cmd_args = *params;
+}
+
 void xg_cmd_buffer_barrier_set ( xg_cmd_buffer_h cmd_buffer_handle, uint64_t key, const xg_barrier_set_t* barrier_set ) {
     xg_cmd_buffer_t* cmd_buffer = xg_cmd_buffer_get ( cmd_buffer_handle );
     std_auto_m cmd_args = xg_cmd_buffer_record_cmd_m ( cmd_buffer, xg_cmd_barrier_set_m, key, xg_cmd_barrier_set_t );
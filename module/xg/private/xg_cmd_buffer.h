@@ -59,6 +59,7 @@ typedef enum {
     xg_cmd_copy_texture_m,
     xg_cmd_copy_buffer_to_texture_m,
     xg_cmd_copy_texture_to_buffer_m,
+    xg_cmd_texture_generate_mips_m,
 
     xg_cmd_texture_clear_m,
     xg_cmd_texture_depth_stencil_clear_m,
@@ -191,6 +192,7 @@ void xg_cmd_buffer_copy_buffer ( xg_cmd_buffer_h buffer, uint64_t key, const xg_
 void xg_cmd_buffer_copy_texture ( xg_cmd_buffer_h buffer, uint64_t key, const xg_texture_copy_params_t* params );
 void xg_cmd_buffer_copy_buffer_to_texture ( xg_cmd_buffer_h buffer, uint64_t key, const xg_buffer_to_texture_copy_params_t* params );
 void xg_cmd_buffer_copy_texture_to_buffer ( xg_cmd_buffer_h buffer, uint64_t key, const xg_texture_to_buffer_copy_params_t* params );
+void xg_cmd_buffer_generate_texture_mips ( xg_cmd_buffer_h buffer, uint64_t key, const xg_cmd_generate_texture_mips_params_t* params );
 
 // ======================================================================================= //
 //                                         M I S C
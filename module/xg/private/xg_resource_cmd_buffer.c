@@ -138,6 +138,7 @@ xg_texture_h xg_resource_cmd_buffer_texture_create ( xg_resource_cmd_buffer_h cm
             cmd_args->depth_stencil_clear = init->depth_stencil_clear;
         }
         cmd_args->init_layout = init->final_layout;
+        cmd_args->generate_mips = init->mode == xg_texture_init_mode_upload_m && init->generate_mips && params->mip_levels > 1;
     } else {
         cmd_args->init = false;
     }
@@ -52,6 +52,7 @@ typedef struct {
         xg_buffer_range_t staging;
     };
     xg_texture_layout_e init_layout;
+    bool generate_mips;
 } xg_resource_cmd_texture_create_t;
 
 typedef struct {
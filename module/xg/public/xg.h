@@ -22,6 +22,7 @@ typedef uint64_t xg_swapchain_h;
 typedef uint64_t xg_renderpass_h;
 typedef uint64_t xg_query_pool_h;
 typedef uint64_t xg_workload_h;
+typedef uint64_t xg_upload_h;
 
 typedef uint64_t xg_resource_h;
 typedef uint64_t xg_buffer_h;
@@ -1886,12 +1887,14 @@ typedef struct {
         void* upload_data;
     };
     xg_texture_layout_e final_layout;
+    bool generate_mips; // upload mode only. Only mip 0 is uploaded, the rest of the mip chain is generated from it on the GPU
 } xg_texture_init_t;
 
 #define xg_texture_init_m( ... ) ( xg_texture_init_t ) { \
     .mode = xg_texture_init_mode_uninitialized_m, \
     .upload_data = NULL, \
     .final_layout = xg_texture_layout_undefined_m, \
+    .generate_mips = false, \
     ##__VA_ARGS__ \
 }
 
@@ -2132,6 +2135,11 @@ typedef struct {
     uint32_t mip_base;
     uint32_t array_base;
     uint32_t array_count;
+    // Region of the destination to write, the source data is tightly packed. A zero width or height copies the whole texture.
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
     //xg_texture_aspect_e aspect;
     //xg_texture_layout_e layout;
 } xg_buffer_to_texture_copy_params_t;
@@ -2143,6 +2151,10 @@ typedef struct {
     .mip_base = 0, \
     .array_base = 0, \
     .array_count = 1, \
+    .x = 0, \
+    .y = 0, \
+    .width = 0, \
+    .height = 0, \
     ##__VA_ARGS__ \
 }
 
@@ -2165,6 +2177,50 @@ typedef struct {
     ##__VA_ARGS__ \
 }
 
+/*
+    Mip generation
+        Fills mip_base + 1 ... mip_base + mip_count from the contents of mip_base, for all the selected array layers.
+        mip_base is expected to be in source_layout, the generated mips are discarded before being written, and after the cmd
+        all of the processed mips are left in final_layout.
+        By default mips are generated with a chain of blits, one per mip level.
+        If a compute pipeline is provided and the texture allows storage usage with separate mip views, mips are generated
+        by a single pass downsampler that produces up to xg_mip_gen_max_mips_per_dispatch_m mips per dispatch. Array textures
+        always take the blit path.
+        The pipeline dispatch set is expected to be laid out as follows:
+            register 0 : uniform buffer { vec2 src_resolution_rcp; uint mip_count; }
+            register 1 : sampled source mip
+            register 2 : linear clamp sampler
+            register 3 + i : storage destination for the i-th generated mip of the dispatch
+        with a 16x16 workgroup covering a 64x64 tile of the source mip.
+*/
+#define xg_mip_gen_max_mips_per_dispatch_m 6
+#define xg_mip_gen_tile_size_m 64
+
+typedef struct {
+    xg_texture_h texture;
+    uint32_t mip_base;
+    uint32_t mip_count;
+    uint32_t array_base;
+    uint32_t array_count;
+    xg_texture_layout_e source_layout;
+    xg_texture_layout_e final_layout;
+    xg_sampler_filter_e filter;
+    xg_compute_pipeline_state_h pipeline;
+} xg_cmd_generate_texture_mips_params_t;
+
+#define xg_cmd_generate_texture_mips_params_m( ... ) ( xg_cmd_generate_texture_mips_params_t ) { \
+    .texture = xg_null_handle_m, \
+    .mip_base = 0, \
+    .mip_count = xg_texture_all_mips_m, \
+    .array_base = 0, \
+    .array_count = xg_texture_whole_array_m, \
+    .source_layout = xg_texture_layout_copy_dest_m, \
+    .final_layout = xg_texture_layout_shader_read_m, \
+    .filter = xg_sampler_filter_linear_m, \
+    .pipeline = xg_null_handle_m, \
+    ##__VA_ARGS__ \
+}
+
 // TODO move out of xg
 typedef enum {
     xg_default_texture_r8g8b8a8_unorm_black_m,
@@ -2450,12 +2506,72 @@ typedef struct {
     bool resize;
 } xg_swapchain_acquire_result_t;
 
+// Upload
+typedef enum {
+    xg_upload_status_queued_m,          // Waiting for staging space or bandwidth budget. Source data must be kept alive.
+    xg_upload_status_transferring_m,    // Copied into staging and submitted on the copy queue. Source data can be freed.
+    xg_upload_status_complete_m,        // Owned by the graphics queue. Safe to use in any workload submitted from now on.
+    xg_upload_status_failed_m,          // The request was rejected and the returned handle is null, e.g. the upload doesn't fit in the staging buffer.
+} xg_upload_status_e;
+
+typedef struct {
+    xg_buffer_h buffer;
+    uint64_t offset;
+    uint64_t size;
+    const void* data;
+} xg_upload_buffer_params_t;
+
+#define xg_upload_buffer_params_m( ... ) ( xg_upload_buffer_params_t ) { \
+    .buffer = xg_null_handle_m, \
+    .offset = 0, \
+    .size = 0, \
+    .data = NULL, \
+    ##__VA_ARGS__ \
+}
+
+// Data is expected to be tightly packed, one mip after the other, with all array layers of a mip stored contiguously.
+// If final layout is left undefined the texture is left in copy dest layout.
+typedef struct {
+    xg_texture_h texture;
+    uint32_t mip_base;
+    uint32_t mip_count;
+    uint32_t array_base;
+    uint32_t array_count;
+    const void* data;
+    xg_texture_layout_e final_layout;
+} xg_upload_texture_params_t;
+
+#define xg_upload_texture_params_m( ... ) ( xg_upload_texture_params_t ) { \
+    .texture = xg_null_handle_m, \
+    .mip_base = 0, \
+    .mip_count = xg_texture_all_mips_m, \
+    .array_base = 0, \
+    .array_count = xg_texture_whole_array_m, \
+    .data = NULL, \
+    .final_layout = xg_texture_layout_shader_read_m, \
+    ##__VA_ARGS__ \
+}
+
+typedef struct {
+    uint64_t budget;                // max bytes moved into staging on each update
+    uint64_t staging_size;
+    uint64_t staging_used_size;
+    uint64_t queued_bytes;
+    uint64_t transferring_bytes;
+    uint64_t uploaded_bytes;        // total since device activation
+    uint32_t queued_count;
+    uint32_t transferring_count;
+    bool dedicated_copy_queue;      // copy queue is on a separate family and ownership transfers are required
+} xg_upload_info_t;
+
 // XG API
 typedef struct {
     // Device
     size_t                  ( *get_devices_count )                  ( void );
     size_t                  ( *get_devices )                        ( xg_device_h* devices, size_t cap );
     bool                    ( *get_device_info )                    ( xg_device_info_t* info, xg_device_h device );
+    // Usages the device supports for optimally tiled textures of the given format
+    xg_texture_usage_bit_e  ( *get_format_texture_usage )           ( xg_device_h device, xg_format_e format );
 
     bool                    ( *activate_device )                    ( xg_device_h device );
     bool                    ( *deactivate_device )                  ( xg_device_h deivce );
@@ -2522,7 +2638,7 @@ typedef struct {
 
     void                    ( *cmd_destroy_renderpass )             ( xg_resource_cmd_buffer_h cmd_buffer, xg_renderpass_h renderpass, xg_resource_cmd_buffer_time_e destroy_time );
 
-    //void                    ( *cmd_generate_texture_mips )          ( xg_cmd_buffer_h cmd_buffer, xg_texture_h texture, uint32_t mip_base, uint32_t mip_count, uint64_t key );
+    void                    ( *cmd_generate_texture_mips )          ( xg_cmd_buffer_h cmd_buffer, uint64_t key, const xg_cmd_generate_texture_mips_params_t* params );
 
     xg_resource_bindings_layout_h ( *create_resource_layout )       ( const xg_resource_bindings_layout_params_t* params );
     void                    ( *destroy_resource_layout )            ( xg_resource_bindings_layout_h layout );
@@ -2609,4 +2725,15 @@ typedef struct {
 
     void                    ( *wait_all_workload_complete )         ( void );
     void                    ( *wait_for_workload )                  ( xg_workload_h workload );
+
+    // Upload
+    // Requests are executed asynchronously on the copy queue. The app is expected to call update_uploads once per frame,
+    // from the same thread that submits workloads, and to poll the returned handles before using the destination resources.
+    xg_upload_h             ( *upload_buffer )                      ( const xg_upload_buffer_params_t* params );
+    xg_upload_h             ( *upload_texture )                     ( const xg_upload_texture_params_t* params );
+    xg_upload_status_e      ( *get_upload_status )                  ( xg_upload_h upload );
+    void                    ( *update_uploads )                     ( xg_device_h device );
+    void                    ( *wait_all_uploads )                   ( xg_device_h device );
+    void                    ( *set_upload_budget )                  ( xg_device_h device, uint64_t bytes_per_update );
+    void                    ( *get_upload_info )                    ( xg_upload_info_t* info, xg_device_h device );
 } xg_i;
@@ -412,6 +412,33 @@ size_t xg_format_size ( xg_format_e format ) {
     }
 }
 
+size_t xg_format_block_size ( xg_format_e format ) {
+    switch ( format ) {
+        case xg_format_bc1_rgb_unorm_block_m:
+        case xg_format_bc1_rgb_srgb_block_m:
+        case xg_format_bc1_rgba_unorm_block_m:
+        case xg_format_bc1_rgba_srgb_block_m:
+        case xg_format_bc4_unorm_block_m:
+        case xg_format_bc4_snorm_block_m:
+            return 8;
+
+        case xg_format_bc2_unorm_block_m:
+        case xg_format_bc2_srgb_block_m:
+        case xg_format_bc3_unorm_block_m:
+        case xg_format_bc3_srgb_block_m:
+        case xg_format_bc5_unorm_block_m:
+        case xg_format_bc5_snorm_block_m:
+        case xg_format_bc6h_ufloat_block_m:
+        case xg_format_bc6h_sfloat_block_m:
+        case xg_format_bc7_unorm_block_m:
+        case xg_format_bc7_srgb_block_m:
+            return 16;
+
+        default:
+            return 0;
+    }
+}
+
 const char* xg_format_str ( xg_format_e format ) {
     switch ( format ) {
         case xg_format_undefined_m:
@@ -3,6 +3,8 @@
 #include <xg.h>
 
 size_t xg_format_size ( xg_format_e format );
+// Size of a 4x4 texel block for BC formats, 0 for every other format
+size_t xg_format_block_size ( xg_format_e format );
 
 const char* xg_format_str ( xg_format_e format );
 const char* xg_color_space_str ( xg_color_space_e space );
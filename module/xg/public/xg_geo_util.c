@@ -212,91 +212,64 @@ xg_geo_util_geometry_data_t xg_geo_util_generate_plane ( float side ) {
     return result;
 }
 
-xg_geo_util_geometry_gpu_data_t xg_geo_util_upload_geometry_to_gpu ( xg_device_h device, xg_workload_h workload, const xg_geo_util_geometry_data_t* geo ) {
+static xg_buffer_h xg_geo_util_upload_buffer ( xg_resource_cmd_buffer_h resource_cmd_buffer, xg_device_h device, const void* data, uint64_t size, xg_buffer_usage_bit_e usage, const char* debug_name ) {
     xg_i* xg = std_module_get_m ( xg_module_name_m );
 
-    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+    if ( data == NULL ) {
+        return xg_null_handle_m;
+    }
 
-    xg_buffer_h pos_buffer = xg->cmd_create_buffer ( resource_cmd_buffer, &xg_buffer_params_m (
+    xg_buffer_params_t params = xg_buffer_params_m (
         .device = device,
-        .size = sizeof ( float ) * geo->vertex_count * 3,
-        .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_vertex_buffer_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m,
-        .debug_name = "vbuffer_pos"
-    ), &xg_buffer_init_m (
+        .size = size,
+        .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m | usage,
+    );
+    std_str_copy_static_m ( params.debug_name, debug_name );
+
+    return xg->cmd_create_buffer ( resource_cmd_buffer, &params, &xg_buffer_init_m (
         .mode = xg_buffer_init_mode_upload_m,
-        .upload_data = geo->pos,
+        .upload_data = ( void* ) data,
     ) );
+}
 
-    xg_buffer_h nor_buffer = xg_null_handle_m;
-    if ( geo->nor ) {
-        nor_buffer = xg->cmd_create_buffer ( resource_cmd_buffer, &xg_buffer_params_m (
-            .device = device,
-            .size = sizeof ( float ) * geo->vertex_count * 3,
-            .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_vertex_buffer_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m,
-            .debug_name = "vbuffer_nor"
-        ), &xg_buffer_init_m (
-            .mode = xg_buffer_init_mode_upload_m,
-            .upload_data = geo->nor,
-        ) );
-    }
+xg_geo_util_geometry_gpu_data_t xg_geo_util_upload_geometry_to_gpu ( xg_device_h device, xg_workload_h workload, const xg_geo_util_geometry_data_t* geo ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
 
-    xg_buffer_h tan_buffer = xg_null_handle_m;
-    if ( geo->tan ) {
-        tan_buffer = xg->cmd_create_buffer ( resource_cmd_buffer, &xg_buffer_params_m (
-            .device = device,
-            .size = sizeof ( float ) * geo->vertex_count * 3,
-            .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_vertex_buffer_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m,
-            .debug_name = "vbuffer_tan"
-        ), &xg_buffer_init_m (
-            .mode = xg_buffer_init_mode_upload_m,
-            .upload_data = geo->tan,
-        ) );
-    }
+    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+    uint64_t vertex_count = geo->vertex_count;
 
-    xg_buffer_h bitan_buffer = xg_null_handle_m;
-    if ( geo->bitan ) {
-        bitan_buffer = xg->cmd_create_buffer ( resource_cmd_buffer, &xg_buffer_params_m (
-            .device = device,
-            .size = sizeof ( float ) * geo->vertex_count * 3,
-            .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_vertex_buffer_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m,
-            .debug_name = "vbuffer_bitan"
-        ), &xg_buffer_init_m (
-            .mode = xg_buffer_init_mode_upload_m,
-            .upload_data = geo->bitan,
-        ) );
-    }
+    xg_geo_util_geometry_gpu_data_t result = {
+        .device = device,
+        .vertex_layout = xg_geo_util_vertex_layout_f32_m,
+        .pos_offset = { 0, 0, 0 },
+        .pos_scale = 1,
+        .pos_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->pos, sizeof ( float ) * vertex_count * 3, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_pos" ),
+        .nor_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->nor, sizeof ( float ) * vertex_count * 3, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_nor" ),
+        .tan_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->tan, sizeof ( float ) * vertex_count * 3, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_tan" ),
+        .bitan_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->bitan, sizeof ( float ) * vertex_count * 3, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_bitan" ),
+        .uv_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->uv, sizeof ( float ) * vertex_count * 2, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_uv" ),
+        .idx_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->idx, sizeof ( uint32_t ) * geo->index_count, xg_buffer_usage_bit_index_buffer_m, "ibuffer" ),
+    };
+    return result;
+}
 
-    xg_buffer_h uv_buffer = xg_null_handle_m;
-    if ( geo->uv ) {
-        uv_buffer = xg->cmd_create_buffer ( resource_cmd_buffer, &xg_buffer_params_m (
-            .device = device,
-            .size = sizeof ( float ) * geo->vertex_count * 2,
-            .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_vertex_buffer_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m,
-            .debug_name = "vbuffer_uv"
-        ), &xg_buffer_init_m (
-            .mode = xg_buffer_init_mode_upload_m,
-            .upload_data = geo->uv,
-        ) );
-    }
+xg_geo_util_geometry_gpu_data_t xg_geo_util_upload_packed_geometry_to_gpu ( xg_device_h device, xg_workload_h workload, const xg_geo_util_packed_geometry_data_t* geo ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
 
-    xg_buffer_h idx_buffer = xg->cmd_create_buffer ( resource_cmd_buffer, &xg_buffer_params_m (
-        .device = device,
-        .size = sizeof ( uint32_t ) * geo->index_count,
-        .allowed_usage = xg_buffer_usage_bit_copy_dest_m | xg_buffer_usage_bit_index_buffer_m | xg_buffer_usage_bit_shader_device_address_m | xg_buffer_usage_bit_raytrace_geometry_buffer_m,
-        .debug_name = "ibuffer"
-    ), &xg_buffer_init_m (
-        .mode = xg_buffer_init_mode_upload_m,
-        .upload_data = geo->idx,
-    ) );
+    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+    uint64_t vertex_count = geo->vertex_count;
 
     xg_geo_util_geometry_gpu_data_t result = {
         .device = device,
-        .pos_buffer = pos_buffer,
-        .nor_buffer = nor_buffer,
-        .tan_buffer = tan_buffer,
-        .bitan_buffer = bitan_buffer,
-        .uv_buffer = uv_buffer,
-        .idx_buffer = idx_buffer,
+        .vertex_layout = xg_geo_util_vertex_layout_packed_m,
+        .pos_offset = { geo->pos_offset[0], geo->pos_offset[1], geo->pos_offset[2] },
+        .pos_scale = geo->pos_scale,
+        .pos_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->pos, sizeof ( int16_t ) * vertex_count * 4, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_packed_pos" ),
+        .nor_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->nor, sizeof ( int16_t ) * vertex_count * 2, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_packed_nor" ),
+        .tan_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->tan, sizeof ( int16_t ) * vertex_count * 2, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_packed_tan" ),
+        .bitan_buffer = xg_null_handle_m,
+        .uv_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->uv, sizeof ( uint16_t ) * vertex_count * 2, xg_buffer_usage_bit_vertex_buffer_m, "vbuffer_packed_uv" ),
+        .idx_buffer = xg_geo_util_upload_buffer ( resource_cmd_buffer, device, geo->idx, sizeof ( uint32_t ) * geo->index_count, xg_buffer_usage_bit_index_buffer_m, "ibuffer" ),
     };
     return result;
 }
@@ -304,18 +277,23 @@ xg_geo_util_geometry_gpu_data_t xg_geo_util_upload_geometry_to_gpu ( xg_device_h
 void xg_geo_util_free_gpu_data ( xg_geo_util_geometry_gpu_data_t* gpu_data, xg_workload_h workload, xg_resource_cmd_buffer_time_e time ) {
     xg_i* xg = std_module_get_m ( xg_module_name_m );
     xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
-    xg->cmd_destroy_buffer ( resource_cmd_buffer, gpu_data->pos_buffer, time );
-    xg->cmd_destroy_buffer ( resource_cmd_buffer, gpu_data->nor_buffer, time );
-    xg->cmd_destroy_buffer ( resource_cmd_buffer, gpu_data->tan_buffer, time );
-    xg->cmd_destroy_buffer ( resource_cmd_buffer, gpu_data->bitan_buffer, time );
-    xg->cmd_destroy_buffer ( resource_cmd_buffer, gpu_data->idx_buffer, time );
+    // Not all layouts have all streams
+    xg_buffer_h buffers[] = { gpu_data->pos_buffer, gpu_data->nor_buffer, gpu_data->tan_buffer, gpu_data->bitan_buffer, gpu_data->uv_buffer, gpu_data->idx_buffer };
+
+    for ( uint32_t i = 0; i < std_static_array_capacity_m ( buffers ); ++i ) {
+        if ( buffers[i] != xg_null_handle_m ) {
+            xg->cmd_destroy_buffer ( resource_cmd_buffer, buffers[i], time );
+        }
+    }
 }
 
 void xg_geo_util_free_data ( xg_geo_util_geometry_data_t* data ) {
-    std_virtual_heap_free ( data->pos );
-    std_virtual_heap_free ( data->nor );
-    std_virtual_heap_free ( data->tan );
-    std_virtual_heap_free ( data->bitan );
-    std_virtual_heap_free ( data->uv );
-    std_virtual_heap_free ( data->idx );
+    // Streams can be left null when the cpu side only keeps the counts
+    void* streams[] = { data->pos, data->nor, data->tan, data->bitan, data->uv, data->idx };
+
+    for ( uint32_t i = 0; i < std_static_array_capacity_m ( streams ); ++i ) {
+        if ( streams[i] ) {
+            std_virtual_heap_free ( streams[i] );
+        }
+    }
 }
@@ -13,8 +13,35 @@ typedef struct {
     uint64_t index_count;
 } xg_geo_util_geometry_data_t;
 
+typedef enum {
+    xg_geo_util_vertex_layout_f32_m,
+    xg_geo_util_vertex_layout_packed_m,
+} xg_geo_util_vertex_layout_e;
+
+// Packed vertex streams, 20 bytes per vertex against the 56 of the f32 ones. Matches the bsf packed layout.
+//  pos     int16_t[4]      snorm. xyz: position, pos_offset + xyz * pos_scale. w: bitangent sign
+//  nor     int16_t[2]      snorm, octahedral encoded
+//  tan     int16_t[2]      snorm, octahedral encoded. bitangent = cross ( nor, tan ) * pos.w
+//  uv      uint16_t[2]     half float
+typedef struct {
+    int16_t* pos;
+    int16_t* nor;
+    int16_t* tan;
+    uint16_t* uv;
+    uint32_t* idx;
+    uint64_t vertex_count;
+    uint64_t index_count;
+    float pos_offset[3];
+    float pos_scale;
+} xg_geo_util_packed_geometry_data_t;
+
+// For packed geometry the position dequantization is expected to be applied as part of the model transform.
+// nor_buffer and tan_buffer hold the packed streams and bitan_buffer is null.
 typedef struct {
     xg_device_h device;
+    xg_geo_util_vertex_layout_e vertex_layout;
+    float pos_offset[3];
+    float pos_scale;
     xg_buffer_h pos_buffer;
     xg_buffer_h nor_buffer;
     xg_buffer_h tan_buffer;
@@ -27,5 +54,6 @@ xg_geo_util_geometry_data_t xg_geo_util_generate_sphere ( float rad, uint32_t me
 xg_geo_util_geometry_data_t xg_geo_util_generate_plane ( float side );
 
 xg_geo_util_geometry_gpu_data_t xg_geo_util_upload_geometry_to_gpu ( xg_device_h device, xg_workload_h workload, const xg_geo_util_geometry_data_t* geo );
+xg_geo_util_geometry_gpu_data_t xg_geo_util_upload_packed_geometry_to_gpu ( xg_device_h device, xg_workload_h workload, const xg_geo_util_packed_geometry_data_t* geo );
 void xg_geo_util_free_gpu_data ( xg_geo_util_geometry_gpu_data_t* gpu_data, xg_workload_h workload, xg_resource_cmd_buffer_time_e time );
 void xg_geo_util_free_data ( xg_geo_util_geometry_data_t* data );
@@ -18,22 +18,25 @@ static void xi_load_shaders ( xg_device_h device ) {
     xs->add_database_folder ( sdb, path );
     xs->set_output_folder ( sdb, "output/shader/" );
     xi_workload_load_shaders ( xs, sdb );
-    xi_font_load_shaders ( xs, sdb );
     xs->build_database ( sdb );
     xi_state_set_sdb ( sdb );
 }
 
 static void xi_api_init ( xi_i* xi ) {
     xi->create_font = xi_font_create_ttf;
+    xi->get_font_atlas_stats = xi_font_get_atlas_stats;
 
     xi->load_shaders = xi_load_shaders;
 
     xi->create_workload = xi_workload_create;
     xi->flush_workload = xi_workload_flush;
+    xi->get_flush_stats = xi_workload_get_flush_stats;
     xi->set_workload_view_info = xi_workload_set_view_info;
 
     xi->begin_update = xi_update_begin;
     xi->end_update = xi_update_end;
+    xi->get_ui_stats = xi_ui_get_stats;
+    xi->set_ui_cache_enabled = xi_ui_set_cache_enabled;
     
     xi->begin_window = xi_ui_window_begin;
     xi->end_window = xi_ui_window_end;
@@ -5,6 +5,8 @@
 #include <std_list.h>
 #include <std_log.h>
 
+#include <math.h>
+
 #define STB_TRUETYPE_IMPLEMENTATION
 #define STB_RECT_PACK_IMPLEMENTATION
 #define STBTT_STATIC
@@ -20,7 +22,6 @@ std_warnings_restore_state_m()
 
 static xi_font_state_t* xi_font_state;
 
-// TODO
 // https://steamcdn-a.akamaihd.net/apps/valve/2007/SIGGRAPH2007_AlphaTestedMagnification.pdf
 
 void xi_font_load ( xi_font_state_t* state ) {
@@ -29,14 +30,19 @@ void xi_font_load ( xi_font_state_t* state ) {
     xi_font_state->fonts_array = std_virtual_heap_alloc_array_m ( xi_font_t, xi_font_max_fonts_m );
     xi_font_state->fonts_freelist = std_freelist_m ( xi_font_state->fonts_array, xi_font_max_fonts_m );
     xi_font_state->fonts_bitset = std_virtual_heap_alloc_array_m ( uint64_t, std_bitset_u64_count_m ( xi_font_max_fonts_m ) );
-    xi_font_state->uniform_data = NULL;
-    xi_font_state->renderpass = xg_null_handle_m;
-}
+    std_mem_zero_array_m ( xi_font_state->fonts_bitset, std_bitset_u64_count_m ( xi_font_max_fonts_m ) );
+
+    xi_font_state->device = xg_null_handle_m;
+    xi_font_state->page_count = 0;
 
-void xi_font_load_shaders ( xs_i* xs, xs_database_h sdb ) {
-    xs_database_pipeline_h font_atlas_pipeline = xs->get_database_pipeline ( sdb, xs_hash_static_string_m ( "xi_font_atlas" ) );
-    std_assert_m ( font_atlas_pipeline != xs_null_handle_m );
-    xi_font_state->font_atlas_pipeline = font_atlas_pipeline;
+    xi_font_state->glyphs_array = std_virtual_heap_alloc_array_m ( xi_font_glyph_t, xi_font_max_glyphs_m );
+    xi_font_state->glyphs_freelist = std_freelist_m ( xi_font_state->glyphs_array, xi_font_max_glyphs_m );
+    xi_font_state->glyphs_bitset = std_virtual_heap_alloc_array_m ( uint64_t, std_bitset_u64_count_m ( xi_font_max_glyphs_m ) );
+    std_mem_zero_array_m ( xi_font_state->glyphs_bitset, std_bitset_u64_count_m ( xi_font_max_glyphs_m ) );
+    xi_font_state->glyphs_map = std_hash_map_create ( xi_font_max_glyphs_m * 2 );
+
+    xi_font_state->epoch = 1;
+    xi_font_state->generation = 0;
 }
 
 void xi_font_reload ( xi_font_state_t* state ) {
@@ -52,381 +58,482 @@ void xi_font_unload ( void ) {
         ++idx;
     }
 
+    if ( xi_font_state->page_count > 0 ) {
+        xg_i* xg = std_module_get_m ( xg_module_name_m );
+        xg_workload_h workload = xg->create_workload ( xi_font_state->device );
+        xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+
+        for ( uint32_t i = 0; i < xi_font_state->page_count; ++i ) {
+            xi_font_atlas_page_t* page = &xi_font_state->pages[i];
+            xg->cmd_destroy_texture ( resource_cmd_buffer, page->texture, xg_resource_cmd_buffer_time_workload_start_m );
+            std_virtual_heap_free ( page->pixels );
+        }
+
+        xg->submit_workload ( workload );
+    }
+
     std_virtual_heap_free ( xi_font_state->fonts_array );
     std_virtual_heap_free ( xi_font_state->fonts_bitset );
+    std_virtual_heap_free ( xi_font_state->glyphs_array );
+    std_virtual_heap_free ( xi_font_state->glyphs_bitset );
+    std_hash_map_destroy ( &xi_font_state->glyphs_map );
 }
 
-xi_font_h xi_font_create_ttf ( std_buffer_t ttf_data, const xi_font_params_t* params ) {
-    xg_i* xg = std_module_get_m ( xg_module_name_m );
+static void xi_font_atlas_page_dirty ( xi_font_atlas_page_t* page, uint32_t x, uint32_t y, uint32_t width, uint32_t height ) {
+    if ( page->dirty_x0 >= page->dirty_x1 ) {
+        page->dirty_x0 = x;
+        page->dirty_y0 = y;
+        page->dirty_x1 = x + width;
+        page->dirty_y1 = y + height;
+    } else {
+        page->dirty_x0 = std_min_u32 ( page->dirty_x0, x );
+        page->dirty_y0 = std_min_u32 ( page->dirty_y0, y );
+        page->dirty_x1 = std_max_u32 ( page->dirty_x1, x + width );
+        page->dirty_y1 = std_max_u32 ( page->dirty_y1, y + height );
+    }
+}
 
-    // TODO lock
-    xi_font_t* font = std_list_pop_m ( &xi_font_state->fonts_freelist );
+static void xi_font_atlas_page_reset ( xi_font_atlas_page_t* page ) {
+    stbrp_init_target ( &page->packer, xi_font_texture_atlas_width_m, xi_font_texture_atlas_height_m, page->nodes, xi_font_texture_atlas_width_m );
+    std_mem_zero ( page->pixels, xi_font_texture_atlas_width_m * xi_font_texture_atlas_height_m );
+    // The padding around glyphs gets sampled too, so the stale content has to be cleared on the gpu copy as well
+    xi_font_atlas_page_dirty ( page, 0, 0, xi_font_texture_atlas_width_m, xi_font_texture_atlas_height_m );
+    page->last_use = xi_font_state->epoch;
+}
 
-    font->params = *params;
+static xi_font_atlas_page_t* xi_font_atlas_page_add ( void ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
 
-    // Info
-    //stbtt_fontinfo* font_info = &font->font_info;
-    //stbtt_InitFont ( font_info, ttf_data.base, 0 );
-    //float scale = stbtt_ScaleForPixelHeight ( font_info, ( float ) font->params.pixel_height );
-    //int32_t ascent;
-    //int32_t descent
-    //int32_t lineGap;
-    //stbtt_GetFontVMetrics ( font_info, &ascent, &descent, &lineGap );
-    //float scale = font->params.pixel_height / ( ascent - descent );
+    xi_font_atlas_page_t* page = &xi_font_state->pages[xi_font_state->page_count++];
+
+    xg_texture_params_t texture_params = xg_texture_params_m (
+        .memory_type = xg_memory_type_gpu_only_m,
+        .device = xi_font_state->device,
+        .width = xi_font_texture_atlas_width_m,
+        .height = xi_font_texture_atlas_height_m,
+        .format = xg_format_r8_unorm_m,
+        .allowed_usage = xg_texture_usage_bit_copy_dest_m | xg_texture_usage_bit_sampled_m,
+    );
+    std_str_copy_static_m ( texture_params.debug_name, "font_atlas" );
+    page->texture = xg->create_texture ( &texture_params );
+    page->uploaded = false;
+    page->pixels = std_virtual_heap_alloc_array_m ( uint8_t, xi_font_texture_atlas_width_m * xi_font_texture_atlas_height_m );
+    page->dirty_x0 = 0;
+    page->dirty_x1 = 0;
+    xi_font_atlas_page_reset ( page );
+
+    return page;
+}
 
-    // Info
-    stbtt_InitFont ( &font->font_info, ttf_data.base, 0 );
-    int ascent, descent, lineGap;
-    stbtt_GetFontVMetrics ( &font->font_info, &ascent, &descent, &lineGap );
-    font->ascent = ascent;
-    font->descent = descent;
-    font->scale = stbtt_ScaleForPixelHeight ( &font->font_info, params->pixel_height );
+static void xi_font_atlas_page_evict ( uint32_t page_idx ) {
+    uint64_t idx = 0;
+    while ( std_bitset_scan ( &idx, xi_font_state->glyphs_bitset, idx, std_bitset_u64_count_m ( xi_font_max_glyphs_m ) ) ) {
+        xi_font_glyph_t* glyph = &xi_font_state->glyphs_array[idx];
 
-    // Atlas
-    size_t atlas_size = xi_font_texture_atlas_width_m * xi_font_texture_atlas_height_m;
-    void* atlas_alloc = std_virtual_heap_alloc_m ( atlas_size, 16 );
-#if 0
-    std_alloc_t char_info_alloc = std_virtual_heap_alloc ( sizeof ( stbtt_bakedchar ) * params->char_count, 16 );
-
-    int bake_result = stbtt_BakeFontBitmap ( ttf_data.base, 0, params->pixel_height, atlas_alloc.buffer.base, ( int ) params->atlas_width, ( int ) params->atlas_height, ( int ) params->first_char_code, ( int ) params->char_count, ( stbtt_bakedchar* ) char_info_alloc.buffer.base );
-
-    std_assert_m ( bake_result > 0 );
-#else
-    stbtt_pack_context pack_context;
-    font->char_info = std_virtual_heap_alloc_array_m ( stbtt_packedchar, params->char_count );
-
-    stbtt_PackBegin ( &pack_context, ( unsigned char* ) atlas_alloc, xi_font_texture_atlas_width_m, xi_font_texture_atlas_height_m, 0, 4, NULL );
-    stbtt_PackSetOversampling ( &pack_context, 2, 2 );
-    stbtt_PackFontRange ( &pack_context, ( unsigned char* ) ttf_data.base, 0, ( float ) params->pixel_height, ( int ) params->first_char_code, ( int ) params->char_count, font->char_info );
-    stbtt_PackEnd ( &pack_context );
-#endif
-
-    xg_texture_h raster_texture;
-    {
-        xg_texture_params_t texture_params = xg_texture_params_m (
-            .memory_type = xg_memory_type_gpu_only_m,
-            .device = params->xg_device,
-            .width = xi_font_texture_atlas_width_m,
-            .height = xi_font_texture_atlas_height_m,
-            .format = xg_format_r8_uint_m,
-            .allowed_usage = xg_texture_usage_bit_copy_dest_m | xg_texture_usage_bit_sampled_m,
-        );
-        std_str_copy_static_m ( texture_params.debug_name, "font_atlas_temp" );
-        raster_texture = xg->create_texture ( &texture_params );
-    }
+        if ( glyph->page == page_idx ) {
+            std_hash_map_remove_hash ( &xi_font_state->glyphs_map, glyph->key );
+            std_bitset_clear ( xi_font_state->glyphs_bitset, idx );
+            std_list_push ( &xi_font_state->glyphs_freelist, glyph );
+        }
 
-    xg_buffer_h staging_buffer;
-    {
-        xg_buffer_params_t buffer_params = xg_buffer_params_m (
-            .memory_type = xg_memory_type_upload_m,
-            .device = params->xg_device,
-            .size = xi_font_texture_atlas_width_m * xi_font_texture_atlas_height_m,
-            .allowed_usage = xg_buffer_usage_bit_copy_source_m,
-            .debug_name = "font_atlas_staging",
-        );
-        staging_buffer = xg->create_buffer ( &buffer_params );
+        ++idx;
     }
 
-    xg_workload_h workload = xg->create_workload ( params->xg_device );
-    xg_cmd_buffer_h cmd_buffer = xg->create_cmd_buffer ( workload );
-    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
-    uint64_t key = 0;
+    xi_font_atlas_page_reset ( &xi_font_state->pages[page_idx] );
+    ++xi_font_state->generation;
+}
 
-    xg_buffer_info_t staging_buffer_info;
-    xg->get_buffer_info ( &staging_buffer_info, staging_buffer );
+// Returns UINT32_MAX if every page is in use since the last flush
+static uint32_t xi_font_atlas_page_lru ( void ) {
+    uint32_t lru = UINT32_MAX;
 
-    std_mem_copy ( staging_buffer_info.allocation.mapped_address, atlas_alloc, atlas_size );
+    for ( uint32_t i = 0; i < xi_font_state->page_count; ++i ) {
+        xi_font_atlas_page_t* page = &xi_font_state->pages[i];
 
-    std_virtual_heap_free ( atlas_alloc );
+        if ( page->last_use == xi_font_state->epoch ) {
+            continue;
+        }
 
-    //xg->cmd_start_debug_capture ( cmd_buffer, xg_debug_capture_stop_time_workload_submit_m, key );
+        if ( lru == UINT32_MAX || page->last_use < xi_font_state->pages[lru].last_use ) {
+            lru = i;
+        }
+    }
 
-    // copy from staging to source atlas
-    {
-        xg_texture_memory_barrier_t barrier = xg_texture_memory_barrier_m (
-            .texture = raster_texture,
-            .layout.old = xg_texture_layout_undefined_m,
-            .layout.new = xg_texture_layout_copy_dest_m,
-            .memory.flushes = xg_memory_access_bit_none_m,
-            .memory.invalidations = xg_memory_access_bit_transfer_write_m,
-            .execution.blocker = xg_pipeline_stage_bit_transfer_m,
-            .execution.blocked = xg_pipeline_stage_bit_transfer_m,
-        );
+    return lru;
+}
 
-        xg_barrier_set_t barrier_set = xg_barrier_set_m (
-            .texture_memory_barriers_count = 1,
-            .texture_memory_barriers = &barrier,
-        );
-        xg->cmd_barrier_set ( cmd_buffer, key, &barrier_set );
+static bool xi_font_atlas_alloc ( uint32_t* out_page, uint32_t* out_x, uint32_t* out_y, uint32_t width, uint32_t height ) {
+    if ( width > xi_font_texture_atlas_width_m || height > xi_font_texture_atlas_height_m ) {
+        return false;
     }
 
-    {
-        xg_buffer_to_texture_copy_params_t copy_params = xg_buffer_to_texture_copy_params_m (
-            .source = staging_buffer,
-            .destination = raster_texture,
-        );
-        xg->cmd_copy_buffer_to_texture ( cmd_buffer, key, &copy_params );
-    }
+    stbrp_rect rect = { .w = ( stbrp_coord ) width, .h = ( stbrp_coord ) height };
+    uint32_t page_idx;
 
-    xg->cmd_destroy_buffer ( resource_cmd_buffer, staging_buffer, xg_resource_cmd_buffer_time_workload_complete_m );
+    for ( page_idx = 0; page_idx < xi_font_state->page_count; ++page_idx ) {
+        stbrp_pack_rects ( &xi_font_state->pages[page_idx].packer, &rect, 1 );
 
-    xg_texture_h atlas_texture;
-    {
-        xg_texture_params_t texture_params = xg_texture_params_m (
-            .memory_type = xg_memory_type_gpu_only_m,
-            .device = params->xg_device,
-            .width = xi_font_texture_atlas_width_m,
-            .height = xi_font_texture_atlas_height_m,
-            .format = xg_format_r8g8b8a8_unorm_m,
-            .allowed_usage = xg_texture_usage_bit_render_target_m | xg_texture_usage_bit_sampled_m,
-        );
-        std_str_copy_static_m ( texture_params.debug_name, "font_atlas" );
-        atlas_texture = xg->create_texture ( &texture_params );
+        if ( rect.was_packed ) {
+            break;
+        }
     }
 
-    // atlas copy_dest -> shader_resource
-    // final undefined -> render target
-    {
-        xg_texture_memory_barrier_t barriers[2];
-        barriers[0] = xg_texture_memory_barrier_m (
-            .texture = raster_texture,
-            .layout.old = xg_texture_layout_copy_dest_m,
-            .layout.new = xg_texture_layout_shader_read_m,
-            .memory.flushes = xg_memory_access_bit_transfer_write_m,
-            .memory.invalidations = xg_memory_access_bit_shader_read_m,
-            .execution.blocker = xg_pipeline_stage_bit_transfer_m,
-            .execution.blocked = xg_pipeline_stage_bit_fragment_shader_m,
-        );
-        barriers[1] = xg_texture_memory_barrier_m (
-            .texture = atlas_texture,
-            .layout.old = xg_texture_layout_undefined_m,
-            .layout.new = xg_texture_layout_render_target_m,
-            .memory.flushes = xg_memory_access_bit_none_m,
-            .memory.invalidations = xg_memory_access_bit_color_write_m,
-            .execution.blocker = xg_pipeline_stage_bit_top_of_pipe_m,
-            .execution.blocked = xg_pipeline_stage_bit_color_output_m,
-        );
+    if ( !rect.was_packed ) {
+        if ( xi_font_state->page_count < xi_font_max_atlas_pages_m ) {
+            page_idx = xi_font_state->page_count;
+            xi_font_atlas_page_add();
+        } else {
+            page_idx = xi_font_atlas_page_lru();
+
+            if ( page_idx == UINT32_MAX ) {
+                return false;
+            }
 
-        xg_barrier_set_t barrier_set = xg_barrier_set_m();
-        barrier_set.texture_memory_barriers_count = 2;
-        barrier_set.texture_memory_barriers = barriers;
+            xi_font_atlas_page_evict ( page_idx );
+        }
 
-        xg->cmd_barrier_set ( cmd_buffer, key, &barrier_set );
+        stbrp_pack_rects ( &xi_font_state->pages[page_idx].packer, &rect, 1 );
+        std_assert_m ( rect.was_packed );
     }
 
-    xg_buffer_h uniform_buffer;
-    {
-        xg_i* xg = std_module_get_m ( xg_module_name_m );
+    *out_page = page_idx;
+    *out_x = rect.x;
+    *out_y = rect.y;
+    return true;
+}
 
-        uniform_buffer = xg->create_buffer ( &xg_buffer_params_m (
-            .memory_type = xg_memory_type_gpu_mapped_m,
-            .device = params->xg_device,
-            .size = sizeof ( xi_font_atlas_uniform_data_t ),
-            .allowed_usage = xg_buffer_usage_bit_uniform_m,
-            .debug_name = "xi_font_uniforms",
-        ) );
+static xi_font_glyph_t* xi_font_glyph_rasterise ( xi_font_t* font, uint32_t codepoint, uint64_t key ) {
+    int glyph_index = stbtt_FindGlyphIndex ( &font->font_info, ( int ) codepoint );
+
+    int advance, left_bearing;
+    stbtt_GetGlyphHMetrics ( &font->font_info, glyph_index, &advance, &left_bearing );
+
+    int width, height, x_offset, y_offset;
+    uint8_t* sdf = NULL;
+
+    if ( font->sdf ) {
+        float pixel_dist_scale = 128.f / xi_font_sdf_padding_m;
+        sdf = stbtt_GetGlyphSDF ( &font->font_info, font->raster_scale, glyph_index, xi_font_sdf_padding_m, 128, pixel_dist_scale, &width, &height, &x_offset, &y_offset );
+
+        if ( !sdf ) {
+            width = 0;
+            height = 0;
+            x_offset = 0;
+            y_offset = 0;
+        }
+    } else {
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBox ( &font->font_info, glyph_index, font->raster_scale, font->raster_scale, &x0, &y0, &x1, &y1 );
+        width = x1 - x0;
+        height = y1 - y0;
+        x_offset = x0;
+        y_offset = y0;
+    }
 
-        xg->cmd_destroy_buffer ( resource_cmd_buffer, uniform_buffer, xg_resource_cmd_buffer_time_workload_complete_m );
+    if ( !xi_font_state->glyphs_freelist ) {
+        uint32_t lru = xi_font_atlas_page_lru();
 
-        xg_buffer_info_t uniform_buffer_info;
-        xg->get_buffer_info ( &uniform_buffer_info, uniform_buffer );
-        xi_font_state->uniform_data = ( xi_font_atlas_uniform_data_t* ) uniform_buffer_info.allocation.mapped_address;
+        if ( lru != UINT32_MAX ) {
+            xi_font_atlas_page_evict ( lru );
+        }
     }
 
-    if ( xi_font_state->renderpass == xg_null_handle_m ) {
-        xi_font_state->renderpass = xg->create_renderpass ( &xg_renderpass_params_m (
-            .device = params->xg_device,
-            .resolution_x = xi_font_texture_atlas_width_m,
-            .resolution_y = xi_font_texture_atlas_height_m,
-            .debug_name = "xi_font_renderpass",
-            .render_textures_layout = xg_render_textures_layout_m (
-                .render_targets_count = 1,
-                .render_targets = { xg_render_target_layout_m ( .format = xg_format_r8g8b8a8_unorm_m ) }
-            ),
-            .render_textures_usage = xg_render_textures_usage_m (
-                .render_targets = { xg_texture_usage_bit_render_target_m | xg_texture_usage_bit_sampled_m },
-            ),
-        ) );
+    xi_font_glyph_t* glyph = NULL;
+
+    // One pixel of padding keeps the linear filter from picking up neighbouring glyphs
+    uint32_t page_idx = UINT32_MAX;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    bool visible = width > 0 && height > 0;
+
+    if ( xi_font_state->glyphs_freelist && ( !visible || xi_font_atlas_alloc ( &page_idx, &x, &y, width + 1, height + 1 ) ) ) {
+        glyph = std_list_pop_m ( &xi_font_state->glyphs_freelist );
+        glyph->key = key;
+        glyph->page = page_idx;
+        glyph->x = x;
+        glyph->y = y;
+        glyph->width = width;
+        glyph->height = height;
+        glyph->offset[0] = x_offset;
+        glyph->offset[1] = y_offset;
+        glyph->advance = advance * font->raster_scale;
+
+        if ( visible ) {
+            xi_font_atlas_page_t* page = &xi_font_state->pages[page_idx];
+            uint8_t* dest = page->pixels + y * xi_font_texture_atlas_width_m + x;
+
+            if ( sdf ) {
+                for ( int row = 0; row < height; ++row ) {
+                    std_mem_copy ( dest + row * xi_font_texture_atlas_width_m, sdf + row * width, width );
+                }
+            } else {
+                stbtt_MakeGlyphBitmap ( &font->font_info, dest, width, height, xi_font_texture_atlas_width_m, font->raster_scale, font->raster_scale, glyph_index );
+            }
+
+            xi_font_atlas_page_dirty ( page, x, y, width, height );
+        }
+
+        uint64_t glyph_idx = ( uint64_t ) ( glyph - xi_font_state->glyphs_array );
+        std_bitset_set ( xi_font_state->glyphs_bitset, glyph_idx );
+        std_hash_map_insert ( &xi_font_state->glyphs_map, key, glyph_idx );
+    } else {
+        std_log_warn_m ( "Font atlas is full, dropping glyph " std_fmt_u32_m, codepoint );
     }
 
-    xg->cmd_begin_renderpass ( cmd_buffer, key, &xg_cmd_renderpass_params_m (
-        .renderpass = xi_font_state->renderpass,
-        .render_targets_count = 1,
-        .render_targets = { xg_render_target_binding_m ( .texture = atlas_texture ) }
-    ) );
+    if ( sdf ) {
+        stbtt_FreeSDF ( sdf, NULL );
+    }
 
-    xs_i* xs = std_module_get_m ( xs_module_name_m );
-
-#if 0
-    xg->cmd_set_render_textures (
-        cmd_buffer,
-        &xg_render_textures_binding_m (
-            .render_targets_count = 1,
-            .render_targets[0] = { atlas_texture, xg_texture_view_m() },
-        ),
-        key );
-
-    xg->cmd_set_graphics_pipeline_state ( cmd_buffer, xs->get_pipeline_state ( xi_font_state->font_atlas_pipeline ), key );
-
-    xg->cmd_set_pipeline_resources (
-        cmd_buffer,
-        &xg_pipeline_resource_bindings_m (
-            .set = xg_shader_binding_set_dispatch_m,
-            .buffer_count = 1,
-            .buffers = {
-                xg_buffer_resource_binding_m (
-                    .shader_register = 0,
-                    .type = xg_buffer_binding_type_uniform_m,
-                    .range = { .handle = uniform_buffer, .offset = 0, .size = sizeof ( xi_font_atlas_uniform_data_t ) }
-                ),
-            },
-            .texture_count = 1,
-            .textures = {
-                xg_texture_resource_binding_m (
-                    .shader_register = 1,
-                    .layout = xg_texture_layout_shader_read_m,
-                    .texture = raster_texture,
-                    .view = xg_texture_view_m()
-                ),
-            },
-            .sampler_count = 1,
-            .samplers = {
-                xg_sampler_resource_binding_m (
-                    .shader_register = 2,
-                    .sampler = xg->get_default_sampler ( params->xg_device, xg_default_sampler_point_clamp_m )
-                )
-            }
-        ), 
-        key );
-#endif
-    xg_graphics_pipeline_state_h pipeline_state = xs->get_pipeline_state ( xi_font_state->font_atlas_pipeline );
-
-    xg_resource_bindings_layout_h layout = xg->get_pipeline_resource_layout ( pipeline_state, xg_shader_binding_set_dispatch_m );
-
-    xg_resource_bindings_h group = xg->cmd_create_workload_bindings ( resource_cmd_buffer, &xg_resource_bindings_params_m (
-        .layout = layout,
-        .bindings = xg_pipeline_resource_bindings_m (
-            .buffer_count = 1,
-            .buffers = {
-                xg_buffer_resource_binding_m (
-                    .shader_register = 0,
-                    .range = { .handle = uniform_buffer, .offset = 0, .size = sizeof ( xi_font_atlas_uniform_data_t ) }
-                ),
-            },
-            .texture_count = 1,
-            .textures = {
-                xg_texture_resource_binding_m (
-                    .shader_register = 1,
-                    .layout = xg_texture_layout_shader_read_m,
-                    .texture = raster_texture,
-                    .view = xg_texture_view_m()
-                ),
-            },
-            .sampler_count = 1,
-            .samplers = {
-                xg_sampler_resource_binding_m (
-                    .shader_register = 2,
-                    .sampler = xg->get_default_sampler ( params->xg_device, xg_default_sampler_point_clamp_m )
-                )
-            }
-        )
-    ) );
+    return glyph;
+}
 
-    xi_font_state->uniform_data->color[0] = 1;
-    xi_font_state->uniform_data->color[1] = 1;
-    xi_font_state->uniform_data->color[2] = 1;
-    xi_font_state->uniform_data->outline = params->outline;
-    xi_font_state->uniform_data->resolution_f32[0] = xi_font_texture_atlas_width_m;
-    xi_font_state->uniform_data->resolution_f32[1] = xi_font_texture_atlas_height_m;
-
-    xg->cmd_draw ( cmd_buffer, key, &xg_cmd_draw_params_m (
-        .primitive_count = 1,
-        .pipeline = pipeline_state,
-        .bindings[xg_shader_binding_set_dispatch_m] = group,
-    ) );
+static xi_font_glyph_t* xi_font_glyph_get ( xi_font_t* font, uint32_t codepoint ) {
+    uint64_t key = std_hash_murmur_64 ( font->glyph_key ^ codepoint );
+    uint64_t* lookup = std_hash_map_lookup ( &xi_font_state->glyphs_map, key );
+
+    if ( lookup ) {
+        return &xi_font_state->glyphs_array[*lookup];
+    }
 
-    xg->cmd_end_renderpass ( cmd_buffer, key );
+    return xi_font_glyph_rasterise ( font, codepoint, key );
+}
 
-    {
-        xg_texture_memory_barrier_t barrier = xg_texture_memory_barrier_m (
-            .texture = atlas_texture,
-            .layout.old = xg_texture_layout_render_target_m,
-            .layout.new = xg_texture_layout_shader_read_m,
-            .memory.flushes = xg_memory_access_bit_color_write_m,
-            .memory.invalidations = xg_memory_access_bit_shader_read_m,
-            .execution.blocker = xg_pipeline_stage_bit_color_output_m,
-            .execution.blocked = xg_pipeline_stage_bit_fragment_shader_m,
-        );
+// Not locked, the glyph map and atlas pages are also written by xi_font_char_box_get while building the ui, so the
+// whole font state belongs to the main thread
+xi_font_h xi_font_create_ttf ( std_buffer_t ttf_data, const xi_font_params_t* params ) {
+    xi_font_t* font = std_list_pop_m ( &xi_font_state->fonts_freelist );
 
-        xg_barrier_set_t barrier_set = xg_barrier_set_m();
-        barrier_set.texture_memory_barriers_count = 1;
-        barrier_set.texture_memory_barriers = &barrier;
+    font->params = *params;
 
-        xg->cmd_barrier_set ( cmd_buffer, key, &barrier_set );
+    if ( xi_font_state->device == xg_null_handle_m ) {
+        xi_font_state->device = params->xg_device;
     }
 
-    xg->cmd_destroy_texture ( resource_cmd_buffer, raster_texture, xg_resource_cmd_buffer_time_workload_complete_m );
+    std_assert_m ( params->xg_device == xi_font_state->device );
 
-    xg->submit_workload ( workload );
+    font->ttf_data = std_virtual_heap_alloc_m ( ttf_data.size, 16 );
+    std_mem_copy ( font->ttf_data, ttf_data.base, ttf_data.size );
 
-    font->atlas_texture = atlas_texture;
+    // Info
+    stbtt_InitFont ( &font->font_info, font->ttf_data, 0 );
+    int ascent, descent, lineGap;
+    stbtt_GetFontVMetrics ( &font->font_info, &ascent, &descent, &lineGap );
+    font->ascent = ascent;
+    font->descent = descent;
+    font->scale = stbtt_ScaleForPixelHeight ( &font->font_info, params->pixel_height );
+
+    // Glyphs
     font->outline = params->outline;
+    font->sdf = params->render_mode == xi_font_render_mode_sdf_m || params->outline;
+
+    uint64_t glyph_key = std_hash_fnv1a_block_64 ( ttf_data.base, ttf_data.size );
+
+    if ( font->sdf ) {
+        font->raster_scale = stbtt_ScaleForPixelHeight ( &font->font_info, xi_font_sdf_pixel_height_m );
+        font->draw_scale = ( float ) params->pixel_height / xi_font_sdf_pixel_height_m;
+        glyph_key = std_hash_murmur_64 ( glyph_key ^ xi_font_render_mode_sdf_m );
+    } else {
+        font->raster_scale = font->scale;
+        font->draw_scale = 1;
+        glyph_key = std_hash_murmur_64 ( glyph_key ^ ( params->pixel_height << 8 ) );
+    }
+
+    font->glyph_key = glyph_key;
+
+    for ( uint32_t i = 0; i < params->char_count; ++i ) {
+        xi_font_glyph_get ( font, params->first_char_code + i );
+    }
 
     xi_font_h font_handle = ( xi_font_h ) ( font - xi_font_state->fonts_array );
     std_bitset_set ( xi_font_state->fonts_bitset, font_handle );
+    ++xi_font_state->generation;
     return font_handle;
 }
 
 void xi_font_destroy ( xi_font_h font_handle ) {
     xi_font_t* font = &xi_font_state->fonts_array[font_handle];
-    std_virtual_heap_free ( font->char_info );
+    std_virtual_heap_free ( font->ttf_data );
     std_bitset_clear ( xi_font_state->fonts_bitset, font_handle );
+    std_list_push ( &xi_font_state->fonts_freelist, font );
+    ++xi_font_state->generation;
+}
+
+void xi_font_get_atlas_stats ( xi_font_atlas_stats_t* stats ) {
+    uint64_t page_size = xi_font_texture_atlas_width_m * xi_font_texture_atlas_height_m;
+    stats->page_count = xi_font_state->page_count;
+    stats->glyph_count = ( uint32_t ) xi_font_state->glyphs_map.count;
+    stats->texture_size = xi_font_state->page_count * page_size;
+    stats->cpu_size = xi_font_state->page_count * page_size;
 }
 
 xi_font_char_box_t xi_font_char_box_get ( float* fx, float* fy, xi_font_h font_handle, uint32_t character ) {
     xi_font_t* font = &xi_font_state->fonts_array[font_handle];
+    xi_font_glyph_t* glyph = xi_font_glyph_get ( font, character );
 
-    uint32_t idx = character - font->params.first_char_code;
+    xi_font_char_box_t box;
+    std_mem_zero_m ( &box );
+    box.texture = xg_null_handle_m;
 
-    stbtt_aligned_quad q;
-    stbtt_GetPackedQuad ( font->char_info, xi_font_texture_atlas_width_m, xi_font_texture_atlas_height_m, idx, fx, fy, &q, 0 );
+    if ( !glyph ) {
+        return box;
+    }
 
-    //stbtt_packedchar* char_info = &font->char_info[idx];
+    if ( glyph->page != UINT32_MAX ) {
+        xi_font_atlas_page_t* page = &xi_font_state->pages[glyph->page];
+        page->last_use = xi_font_state->epoch;
+
+        float x0, y0;
+
+        if ( font->sdf ) {
+            x0 = *fx + glyph->offset[0] * font->draw_scale;
+            y0 = *fy + glyph->offset[1] * font->draw_scale;
+            box.texture_mode = font->outline ? xi_draw_texture_sdf_outline_m : xi_draw_texture_sdf_m;
+        } else {
+            // Bitmaps are rasterised at their final size, keep them on the pixel grid
+            x0 = floorf ( *fx + 0.5f ) + glyph->offset[0];
+            y0 = floorf ( *fy + 0.5f ) + glyph->offset[1];
+            box.texture_mode = xi_draw_texture_coverage_m;
+        }
+
+        float inv_width = 1.f / xi_font_texture_atlas_width_m;
+        float inv_height = 1.f / xi_font_texture_atlas_height_m;
+
+        box.uv0[0] = glyph->x * inv_width;
+        box.uv0[1] = glyph->y * inv_height;
+        box.uv1[0] = ( glyph->x + glyph->width ) * inv_width;
+        box.uv1[1] = ( glyph->y + glyph->height ) * inv_height;
+        box.xy0[0] = x0;
+        box.xy0[1] = y0;
+        box.xy1[0] = x0 + glyph->width * font->draw_scale;
+        box.xy1[1] = y0 + glyph->height * font->draw_scale;
+        box.width = box.xy1[0] - box.xy0[0];
+        box.height = box.xy1[1] - box.xy0[1];
+        box.texture = page->texture;
+    }
 
-    //float inv_width = 1.f / xi_font_texture_atlas_width_m;
-    //float inv_height = 1.f / xi_font_texture_atlas_height_m;
+    *fx += glyph->advance * font->draw_scale;
+    return box;
+}
 
-    //uint32_t outline_pad = font->outline ? 1 : 0;
+uint64_t xi_font_get_generation ( void ) {
+    return xi_font_state->generation;
+}
 
-    xi_font_char_box_t box;
-    //box.uv0[0] = ( char_info->x0 - outline_pad ) * inv_width;
-    //box.uv0[1] = ( char_info->y0 - outline_pad ) * inv_height;
-    //box.uv1[0] = ( char_info->x1 + outline_pad ) * inv_width;
-    //box.uv1[1] = ( char_info->y1 + outline_pad ) * inv_height;
-    //uint32_t xy0[2];
-    //uint32_t xy1[2];
-    //xy0[0] = char_info->x0 - outline_pad;
-    //xy0[1] = char_info->y0 - outline_pad;
-    //xy1[0] = char_info->x1 + outline_pad;
-    //xy1[1] = char_info->y1 + outline_pad;
-    //box.width = xy1[0] - xy0[0];
-    //box.width = char_info->xadvance;
-    //box.height = xy1[1] - xy0[1];
-
-    box.uv0[0] = q.s0;
-    box.uv0[1] = q.t0;
-    box.uv1[0] = q.s1;
-    box.uv1[1] = q.t1;
-    box.xy0[0] = q.x0;
-    box.xy0[1] = q.y0;
-    box.xy1[0] = q.x1;
-    box.xy1[1] = q.y1;
-    return box;
+void xi_font_atlas_touch ( xg_texture_h texture ) {
+    for ( uint32_t i = 0; i < xi_font_state->page_count; ++i ) {
+        if ( xi_font_state->pages[i].texture == texture ) {
+            xi_font_state->pages[i].last_use = xi_font_state->epoch;
+            return;
+        }
+    }
 }
 
-xg_texture_h xi_font_atlas_get ( xi_font_h font_handle ) {
-    xi_font_t* font = &xi_font_state->fonts_array[font_handle];
-    return font->atlas_texture;
+void xi_font_flush ( xg_cmd_buffer_h cmd_buffer, xg_resource_cmd_buffer_h resource_cmd_buffer, uint64_t key ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
+
+    uint64_t staging_size = 0;
+    uint32_t dirty_count = 0;
+
+    for ( uint32_t i = 0; i < xi_font_state->page_count; ++i ) {
+        xi_font_atlas_page_t* page = &xi_font_state->pages[i];
+
+        if ( page->dirty_x0 < page->dirty_x1 ) {
+            staging_size += ( page->dirty_x1 - page->dirty_x0 ) * ( page->dirty_y1 - page->dirty_y0 );
+            ++dirty_count;
+        }
+    }
+
+    ++xi_font_state->epoch;
+
+    if ( dirty_count == 0 ) {
+        return;
+    }
+
+    xg_buffer_h staging_buffer = xg->create_buffer ( &xg_buffer_params_m (
+        .memory_type = xg_memory_type_upload_m,
+        .device = xi_font_state->device,
+        .size = staging_size,
+        .allowed_usage = xg_buffer_usage_bit_copy_source_m,
+        .debug_name = "font_atlas_staging",
+    ) );
+
+    xg_buffer_info_t staging_buffer_info;
+    xg->get_buffer_info ( &staging_buffer_info, staging_buffer );
+    uint8_t* staging = ( uint8_t* ) staging_buffer_info.allocation.mapped_address;
+
+    xg_texture_memory_barrier_t barriers[xi_font_max_atlas_pages_m];
+    uint32_t barriers_count = 0;
+
+    for ( uint32_t i = 0; i < xi_font_state->page_count; ++i ) {
+        xi_font_atlas_page_t* page = &xi_font_state->pages[i];
+
+        if ( page->dirty_x0 < page->dirty_x1 ) {
+            barriers[barriers_count++] = xg_texture_memory_barrier_m (
+                .texture = page->texture,
+                .layout.old = page->uploaded ? xg_texture_layout_shader_read_m : xg_texture_layout_undefined_m,
+                .layout.new = xg_texture_layout_copy_dest_m,
+                .memory.flushes = xg_memory_access_bit_none_m,
+                .memory.invalidations = xg_memory_access_bit_transfer_write_m,
+                .execution.blocker = xg_pipeline_stage_bit_fragment_shader_m,
+                .execution.blocked = xg_pipeline_stage_bit_transfer_m,
+            );
+        }
+    }
+
+    xg_barrier_set_t barrier_set = xg_barrier_set_m();
+    barrier_set.texture_memory_barriers_count = barriers_count;
+    barrier_set.texture_memory_barriers = barriers;
+    xg->cmd_barrier_set ( cmd_buffer, key, &barrier_set );
+
+    uint64_t staging_offset = 0;
+    barriers_count = 0;
+
+    for ( uint32_t i = 0; i < xi_font_state->page_count; ++i ) {
+        xi_font_atlas_page_t* page = &xi_font_state->pages[i];
+
+        if ( page->dirty_x0 >= page->dirty_x1 ) {
+            continue;
+        }
+
+        uint32_t width = page->dirty_x1 - page->dirty_x0;
+        uint32_t height = page->dirty_y1 - page->dirty_y0;
+
+        for ( uint32_t row = 0; row < height; ++row ) {
+            const uint8_t* source = page->pixels + ( page->dirty_y0 + row ) * xi_font_texture_atlas_width_m + page->dirty_x0;
+            std_mem_copy ( staging + staging_offset + row * width, source, width );
+        }
+
+        xg->cmd_copy_buffer_to_texture ( cmd_buffer, key, &xg_buffer_to_texture_copy_params_m (
+            .source = staging_buffer,
+            .source_offset = staging_offset,
+            .destination = page->texture,
+            .x = page->dirty_x0,
+            .y = page->dirty_y0,
+            .width = width,
+            .height = height,
+        ) );
+
+        staging_offset += width * height;
+
+        barriers[barriers_count++] = xg_texture_memory_barrier_m (
+            .texture = page->texture,
+            .layout.old = xg_texture_layout_copy_dest_m,
+            .layout.new = xg_texture_layout_shader_read_m,
+            .memory.flushes = xg_memory_access_bit_transfer_write_m,
+            .memory.invalidations = xg_memory_access_bit_shader_read_m,
+            .execution.blocker = xg_pipeline_stage_bit_transfer_m,
+            .execution.blocked = xg_pipeline_stage_bit_fragment_shader_m,
+        );
+
+        page->uploaded = true;
+        page->dirty_x0 = 0;
+        page->dirty_x1 = 0;
+    }
+
+    barrier_set.texture_memory_barriers_count = barriers_count;
+    xg->cmd_barrier_set ( cmd_buffer, key, &barrier_set );
+
+    xg->cmd_destroy_buffer ( resource_cmd_buffer, staging_buffer, xg_resource_cmd_buffer_time_workload_complete_m );
 }
 
 void xi_font_get_info ( xi_font_info_t* info, xi_font_h font_handle ) {
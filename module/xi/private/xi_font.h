@@ -2,56 +2,92 @@
 
 #include <xi.h>
 #include <xg.h>
-#include <xs.h>
 
+#include <std_hash.h>
+
+#include "xi_workload.h"
+
+#include "stb_rect_pack.h"
 #include "stb_truetype.h"
 
 typedef struct {
     xi_font_params_t params;
-    xg_texture_h atlas_texture;
     stbtt_fontinfo font_info;
-    void* char_info; // stbtt_packedchar*
+    // stbtt keeps pointing into the ttf data to rasterise glyphs on demand, the font owns a copy of it
+    void* ttf_data;
+    // fonts that would rasterise the same bitmaps share their glyphs, see xi_font_glyph_get
+    uint64_t glyph_key;
+    bool sdf;
     bool outline;
     int32_t ascent;
     int32_t descent;
     float scale;
+    // stbtt scale the glyphs are rasterised at, and the scale from there to the font pixel height
+    float raster_scale;
+    float draw_scale;
 } xi_font_t;
 
 typedef struct {
-    float color[3];
-    uint32_t _pad0;
-    float outline_color[3];
-    bool outline;
-    float resolution_f32[2];
-    uint32_t _pad1[2];
-} xi_font_atlas_uniform_data_t;
+    uint64_t key;
+    // UINT32_MAX for glyphs with nothing to draw, e.g. spaces
+    uint32_t page;
+    // atlas rect, in pixels
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t height;
+    // offset from the pen position to the bitmap top left, and pen advance, in raster pixels
+    float offset[2];
+    float advance;
+} xi_font_glyph_t;
+
+// Glyphs of all fonts are packed into a small set of pages. When they're all full, the least recently used one
+// gets cleared and its glyphs are rasterised again the next time they're needed.
+typedef struct {
+    xg_texture_h texture;
+    // the texture content is undefined until the first upload
+    bool uploaded;
+    stbrp_context packer;
+    stbrp_node nodes[xi_font_texture_atlas_width_m];
+    // cpu copy of the page, dirty regions get uploaded from here on flush
+    uint8_t* pixels;
+    // empty if x0 >= x1
+    uint32_t dirty_x0;
+    uint32_t dirty_y0;
+    uint32_t dirty_x1;
+    uint32_t dirty_y1;
+    // flush epoch of the last time one of its glyphs was used
+    uint64_t last_use;
+} xi_font_atlas_page_t;
 
 typedef struct {
     xi_font_t* fonts_array;
     xi_font_t* fonts_freelist;
     uint64_t* fonts_bitset;
 
-    xs_database_pipeline_h font_atlas_pipeline;
-    //xg_buffer_h uniform_buffer; // TODO have a per-device cache instead of creating a new one on font creation
-    xi_font_atlas_uniform_data_t* uniform_data;
-    xg_renderpass_h renderpass;
+    xg_device_h device;
+    xi_font_atlas_page_t pages[xi_font_max_atlas_pages_m];
+    uint32_t page_count;
+
+    xi_font_glyph_t* glyphs_array;
+    xi_font_glyph_t* glyphs_freelist;
+    uint64_t* glyphs_bitset;
+    std_hash_map_t glyphs_map;
+
+    // bumped on every flush, pages used since the last one can't be evicted
+    uint64_t epoch;
+    // bumped whenever previously returned char boxes might not be valid anymore
+    uint64_t generation;
 } xi_font_state_t;
 
 void xi_font_load ( xi_font_state_t* state );
 void xi_font_reload ( xi_font_state_t* state );
 void xi_font_unload ( void );
 
-void xi_font_load_shaders ( xs_i* xs, xs_database_h sdb );
-
 xi_font_h xi_font_create_ttf ( std_buffer_t ttf_data, const xi_font_params_t* params );
 void xi_font_destroy ( xi_font_h font );
 
-xg_texture_h xi_font_atlas_get ( xi_font_h font );
-
-typedef struct {
-    float uv0[2];
-    float uv1[2];
-} xi_font_char_info_t;
+void xi_font_get_atlas_stats ( xi_font_atlas_stats_t* stats );
 
 typedef struct {
     uint32_t pixel_height;
@@ -68,9 +104,21 @@ typedef struct {
     float xy1[2];
     float width;
     float height;
+    // null for glyphs with nothing to draw
+    xg_texture_h texture;
+    xi_draw_texture_mode_e texture_mode;
 } xi_font_char_box_t;
 
-// TODO avoid copying from stbtt, convert at creation and return a const pointer to the relevant data here
+// Rasterises the glyph if it's not in the atlas yet
 xi_font_char_box_t xi_font_char_box_get ( float* x, float* y, xi_font_h font, uint32_t character );
 
+uint64_t xi_font_get_generation ( void );
+// Keeps the atlas page behind the texture from being evicted before the next flush. For char boxes that get reused
+// without going through xi_font_char_box_get again.
+void xi_font_atlas_touch ( xg_texture_h texture );
+
+// Uploads the atlas regions written since the last flush. Needs to be recorded outside of a renderpass, before any draw
+// that uses char boxes returned since then.
+void xi_font_flush ( xg_cmd_buffer_h cmd_buffer, xg_resource_cmd_buffer_h resource_cmd_buffer, uint64_t key );
+
 void xi_font_get_string_size ( float* w, float* h, xi_font_h font, const char* string );
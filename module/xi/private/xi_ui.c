@@ -12,6 +12,7 @@
 
 #include <std_log.h>
 #include <std_platform.h>
+#include <std_hash.h>
 
 static xi_ui_state_t* xi_ui_state;
 
@@ -23,6 +24,10 @@ void xi_ui_load ( xi_ui_state_t* state ) {
 
     std_mem_zero_static_array_m ( xi_ui_state->windows_map_values );
     xi_ui_state->windows_map = std_static_hash_map_m ( xi_ui_state->windows_map_ids, xi_ui_state->windows_map_values );
+
+    xi_ui_state->draw_ops = std_virtual_heap_alloc_array_m ( xi_ui_draw_op_t, xi_ui_max_draw_ops_m );
+    xi_ui_state->draw_text = std_virtual_heap_alloc_array_m ( char, xi_ui_draw_text_size_m );
+    xi_ui_state->draw_scissor = xi_null_scissor_m;
 }
 
 void xi_ui_reload ( xi_ui_state_t* state ) {
@@ -37,6 +42,19 @@ void xi_ui_unload ( void ) {
         xg_geo_util_free_gpu_data ( &xi_ui_state->transform_geo.gpu, workload, xg_resource_cmd_buffer_time_workload_start_m );
         xg->submit_workload ( workload );
     }
+
+    for ( uint32_t i = 0; i < xi_ui_max_cached_windows_m; ++i ) {
+        xi_ui_window_cache_t* cache = &xi_ui_state->window_cache[i];
+
+        if ( cache->rects ) {
+            std_virtual_heap_free ( cache->rects );
+            std_virtual_heap_free ( cache->tris );
+            std_virtual_heap_free ( cache->runs );
+        }
+    }
+
+    std_virtual_heap_free ( xi_ui_state->draw_ops );
+    std_virtual_heap_free ( xi_ui_state->draw_text );
 }
 
 static bool xi_ui_cursor_test ( int64_t x, int64_t y, int64_t width, int64_t height ) {
@@ -373,6 +391,349 @@ static bool xi_ui_release_hovered ( uint64_t id ) {
     return false;
 }
 
+static uint64_t xi_ui_draw_hash ( uint64_t hash, uint64_t value ) {
+    return std_hash_murmur_64 ( hash ^ value );
+}
+
+// The window scissor is recreated every frame, so draws only hash whether they're clipped by it or not
+static uint64_t xi_ui_draw_scissor_tag ( xi_scissor_h scissor ) {
+    if ( scissor == xi_null_scissor_m ) {
+        return 0;
+    }
+
+    return scissor == xi_ui_state->draw_scissor ? 1 : 2 + ( uint64_t ) scissor;
+}
+
+static void xi_ui_draw_capture_begin ( uint64_t id ) {
+    std_assert_m ( !xi_ui_state->draw_capture );
+    xi_ui_state->draw_capture = true;
+    xi_ui_state->draw_capture_overflow = false;
+    xi_ui_state->draw_hash = std_hash_murmur_64 ( id );
+    xi_ui_state->draw_scissor = xi_null_scissor_m;
+    xi_ui_state->draw_op_count = 0;
+    xi_ui_state->draw_text_size = 0;
+}
+
+static void xi_ui_draw_capture_scissor ( xi_scissor_h scissor, int64_t x, int64_t y, int64_t width, int64_t height ) {
+    uint64_t hash = xi_ui_state->draw_hash;
+    hash = xi_ui_draw_hash ( hash, ( uint64_t ) x ^ ( ( uint64_t ) y << 32 ) );
+    hash = xi_ui_draw_hash ( hash, ( uint64_t ) width ^ ( ( uint64_t ) height << 32 ) );
+    xi_ui_state->draw_hash = hash;
+    xi_ui_state->draw_scissor = scissor;
+}
+
+static void xi_ui_draw_string_origin ( float* fx, float* fy, const xi_ui_draw_string_t* string ) {
+    xi_font_info_t font_info;
+    xi_font_get_info ( &font_info, string->font );
+    *fx = string->x;
+    *fy = string->y + font_info.pixel_height + font_info.descent;
+}
+
+static void xi_ui_draw_string_rects ( xi_draw_rect_t* rects, float* fx, float* fy, const xi_ui_draw_string_t* string, const char* text, uint32_t count ) {
+    for ( uint32_t i = 0; i < count; ++i ) {
+        xi_font_char_box_t box = xi_font_char_box_get ( fx, fy, string->font, ( uint8_t ) text[i] );
+
+        rects[i] = xi_draw_rect_m (
+            .x = box.xy0[0],
+            .y = box.xy0[1],
+            .width = box.xy1[0] - box.xy0[0],
+            .height = box.xy1[1] - box.xy0[1],
+            .color = string->color,
+            .texture = box.texture,
+            .texture_mode = box.texture_mode,
+            .linear_sampler_filter = box.texture_mode == xi_draw_texture_sdf_m || box.texture_mode == xi_draw_texture_sdf_outline_m,
+            .uv0[0] = box.uv0[0],
+            .uv0[1] = box.uv0[1],
+            .uv1[0] = box.uv1[0],
+            .uv1[1] = box.uv1[1],
+            .sort_order = string->sort_order,
+            .scissor = string->scissor,
+        );
+    }
+}
+
+static void xi_ui_draw_string_submit ( xi_workload_h workload, const xi_ui_draw_string_t* string, const char* text ) {
+    float fx, fy;
+    xi_ui_draw_string_origin ( &fx, &fy, string );
+
+    xi_draw_rect_t rects[64];
+
+    for ( uint32_t i = 0; i < string->text_len; i += 64 ) {
+        uint32_t count = std_min_u32 ( string->text_len - i, 64 );
+        xi_ui_draw_string_rects ( rects, &fx, &fy, string, text + i, count );
+        xi_workload_cmd_draw ( workload, rects, count );
+    }
+}
+
+static void xi_ui_draw_ops_submit ( xi_workload_h workload ) {
+    for ( uint32_t i = 0; i < xi_ui_state->draw_op_count; ++i ) {
+        const xi_ui_draw_op_t* op = &xi_ui_state->draw_ops[i];
+
+        if ( op->type == xi_ui_draw_op_rect_m ) {
+            xi_workload_cmd_draw ( workload, &op->rect, 1 );
+        } else if ( op->type == xi_ui_draw_op_tri_m ) {
+            xi_workload_cmd_draw_tri ( workload, &op->tri, 1 );
+        } else {
+            xi_ui_draw_string_submit ( workload, &op->string, xi_ui_state->draw_text + op->string.text_offset );
+        }
+    }
+}
+
+// Returns the op to record the draw into, or NULL if the draw should go straight to the workload.
+// If the window runs out of space to record its draws, everything recorded so far is submitted and the window isn't cached this frame.
+static xi_ui_draw_op_t* xi_ui_draw_op_push ( xi_workload_h workload, xi_ui_draw_op_e type, uint32_t text_len ) {
+    if ( !xi_ui_state->draw_capture || xi_ui_state->draw_capture_overflow ) {
+        return NULL;
+    }
+
+    if ( xi_ui_state->draw_op_count == xi_ui_max_draw_ops_m || xi_ui_state->draw_text_size + text_len > xi_ui_draw_text_size_m ) {
+        xi_ui_draw_ops_submit ( workload );
+        xi_ui_state->draw_capture_overflow = true;
+        return NULL;
+    }
+
+    xi_ui_draw_op_t* op = &xi_ui_state->draw_ops[xi_ui_state->draw_op_count++];
+    op->type = type;
+    return op;
+}
+
+static void xi_ui_draw_push_rect ( xi_workload_h workload, const xi_draw_rect_t* rect ) {
+    xi_ui_draw_op_t* op = xi_ui_draw_op_push ( workload, xi_ui_draw_op_rect_m, 0 );
+
+    if ( !op ) {
+        xi_workload_cmd_draw ( workload, rect, 1 );
+        return;
+    }
+
+    float values[8] = { rect->x, rect->y, rect->width, rect->height, rect->uv0[0], rect->uv0[1], rect->uv1[0], rect->uv1[1] };
+    uint64_t hash = xi_ui_state->draw_hash;
+    hash = xi_ui_draw_hash ( hash, xi_ui_draw_op_rect_m );
+    hash = xi_ui_draw_hash ( hash, std_hash_fnv1a_block_64 ( values, sizeof ( values ) ) );
+    hash = xi_ui_draw_hash ( hash, rect->color.u32 | ( ( uint64_t ) rect->linear_sampler_filter << 32 ) | ( ( uint64_t ) rect->texture_mode << 33 ) );
+    hash = xi_ui_draw_hash ( hash, rect->texture );
+    hash = xi_ui_draw_hash ( hash, rect->sort_order );
+    hash = xi_ui_draw_hash ( hash, xi_ui_draw_scissor_tag ( rect->scissor ) );
+    xi_ui_state->draw_hash = hash;
+
+    op->rect = *rect;
+}
+
+static void xi_ui_draw_push_tri ( xi_workload_h workload, const xi_draw_tri_t* tri ) {
+    xi_ui_draw_op_t* op = xi_ui_draw_op_push ( workload, xi_ui_draw_op_tri_m, 0 );
+
+    if ( !op ) {
+        xi_workload_cmd_draw_tri ( workload, tri, 1 );
+        return;
+    }
+
+    float values[12] = { tri->xy0[0], tri->xy0[1], tri->xy1[0], tri->xy1[1], tri->xy2[0], tri->xy2[1], tri->uv0[0], tri->uv0[1], tri->uv1[0], tri->uv1[1], tri->uv2[0], tri->uv2[1] };
+    uint64_t hash = xi_ui_state->draw_hash;
+    hash = xi_ui_draw_hash ( hash, xi_ui_draw_op_tri_m );
+    hash = xi_ui_draw_hash ( hash, std_hash_fnv1a_block_64 ( values, sizeof ( values ) ) );
+    hash = xi_ui_draw_hash ( hash, tri->color.u32 | ( ( uint64_t ) tri->linear_sampler_filter << 32 ) );
+    hash = xi_ui_draw_hash ( hash, tri->texture );
+    hash = xi_ui_draw_hash ( hash, tri->sort_order );
+    hash = xi_ui_draw_hash ( hash, xi_ui_draw_scissor_tag ( tri->scissor ) );
+    xi_ui_state->draw_hash = hash;
+
+    op->tri = *tri;
+}
+
+static void xi_ui_draw_push_string ( xi_workload_h workload, const xi_ui_draw_string_t* string, const char* text ) {
+    xi_ui_draw_op_t* op = xi_ui_draw_op_push ( workload, xi_ui_draw_op_string_m, string->text_len );
+
+    if ( !op ) {
+        xi_ui_draw_string_submit ( workload, string, text );
+        return;
+    }
+
+    uint64_t hash = xi_ui_state->draw_hash;
+    hash = xi_ui_draw_hash ( hash, xi_ui_draw_op_string_m );
+    hash = xi_ui_draw_hash ( hash, std_hash_fnv1a_block_64 ( text, string->text_len ) ^ string->text_len );
+    hash = xi_ui_draw_hash ( hash, string->font );
+    // catches glyphs moving around in the font atlas
+    hash = xi_ui_draw_hash ( hash, xi_font_get_generation() );
+    hash = xi_ui_draw_hash ( hash, string->color.u32 );
+    hash = xi_ui_draw_hash ( hash, string->x | ( ( uint64_t ) string->y << 32 ) );
+    hash = xi_ui_draw_hash ( hash, string->sort_order );
+    hash = xi_ui_draw_hash ( hash, xi_ui_draw_scissor_tag ( string->scissor ) );
+    xi_ui_state->draw_hash = hash;
+
+    op->string = *string;
+    op->string.text_offset = xi_ui_state->draw_text_size;
+    std_mem_copy ( xi_ui_state->draw_text + xi_ui_state->draw_text_size, text, string->text_len );
+    xi_ui_state->draw_text_size += string->text_len;
+}
+
+static xi_ui_window_cache_t* xi_ui_window_cache_get ( uint64_t id ) {
+    xi_ui_window_cache_t* lru = &xi_ui_state->window_cache[0];
+
+    for ( uint32_t i = 0; i < xi_ui_max_cached_windows_m; ++i ) {
+        xi_ui_window_cache_t* cache = &xi_ui_state->window_cache[i];
+
+        if ( cache->last_frame != 0 && cache->id == id ) {
+            return cache;
+        }
+
+        if ( cache->last_frame < lru->last_frame ) {
+            lru = cache;
+        }
+    }
+
+    if ( !lru->rects ) {
+        lru->rects = std_virtual_heap_alloc_array_m ( xi_draw_rect_t, xi_ui_window_cache_max_rects_m );
+        lru->tris = std_virtual_heap_alloc_array_m ( xi_draw_tri_t, xi_ui_window_cache_max_tris_m );
+        lru->runs = std_virtual_heap_alloc_array_m ( xi_ui_draw_run_t, xi_ui_window_cache_max_runs_m );
+    }
+
+    lru->id = id;
+    lru->valid = false;
+    return lru;
+}
+
+static void xi_ui_window_cache_add_glyph_texture ( xi_ui_window_cache_t* cache, xg_texture_h texture ) {
+    if ( texture == xg_null_handle_m ) {
+        return;
+    }
+
+    for ( uint32_t i = 0; i < cache->glyph_texture_count; ++i ) {
+        if ( cache->glyph_textures[i] == texture ) {
+            return;
+        }
+    }
+
+    std_assert_m ( cache->glyph_texture_count < xi_font_max_atlas_pages_m );
+    cache->glyph_textures[cache->glyph_texture_count++] = texture;
+}
+
+// Expands the recorded draws into the cache. Returns false if they don't fit.
+static bool xi_ui_window_cache_build ( xi_ui_window_cache_t* cache ) {
+    cache->rect_count = 0;
+    cache->tri_count = 0;
+    cache->run_count = 0;
+    cache->glyph_texture_count = 0;
+
+    for ( uint32_t i = 0; i < xi_ui_state->draw_op_count; ++i ) {
+        const xi_ui_draw_op_t* op = &xi_ui_state->draw_ops[i];
+
+        xi_ui_draw_op_e type = op->type == xi_ui_draw_op_tri_m ? xi_ui_draw_op_tri_m : xi_ui_draw_op_rect_m;
+        uint32_t count = op->type == xi_ui_draw_op_string_m ? op->string.text_len : 1;
+
+        if ( type == xi_ui_draw_op_rect_m && cache->rect_count + count > xi_ui_window_cache_max_rects_m ) {
+            return false;
+        }
+
+        if ( type == xi_ui_draw_op_tri_m && cache->tri_count + count > xi_ui_window_cache_max_tris_m ) {
+            return false;
+        }
+
+        if ( cache->run_count == 0 || cache->runs[cache->run_count - 1].type != type ) {
+            if ( cache->run_count == xi_ui_window_cache_max_runs_m ) {
+                return false;
+            }
+
+            cache->runs[cache->run_count++] = ( xi_ui_draw_run_t ) {
+                .type = type,
+                .base = type == xi_ui_draw_op_rect_m ? cache->rect_count : cache->tri_count,
+                .count = 0,
+            };
+        }
+
+        cache->runs[cache->run_count - 1].count += count;
+
+        if ( op->type == xi_ui_draw_op_rect_m ) {
+            cache->rects[cache->rect_count++] = op->rect;
+        } else if ( op->type == xi_ui_draw_op_tri_m ) {
+            cache->tris[cache->tri_count++] = op->tri;
+        } else {
+            float fx, fy;
+            xi_ui_draw_string_origin ( &fx, &fy, &op->string );
+            xi_ui_draw_string_rects ( cache->rects + cache->rect_count, &fx, &fy, &op->string, xi_ui_state->draw_text + op->string.text_offset, count );
+
+            for ( uint32_t j = 0; j < count; ++j ) {
+                xi_ui_window_cache_add_glyph_texture ( cache, cache->rects[cache->rect_count + j].texture );
+            }
+
+            cache->rect_count += count;
+        }
+    }
+
+    return true;
+}
+
+static void xi_ui_window_cache_patch_scissor ( xi_ui_window_cache_t* cache, xi_scissor_h scissor ) {
+    for ( uint32_t i = 0; i < cache->rect_count; ++i ) {
+        if ( cache->rects[i].scissor == cache->scissor ) {
+            cache->rects[i].scissor = scissor;
+        }
+    }
+
+    for ( uint32_t i = 0; i < cache->tri_count; ++i ) {
+        if ( cache->tris[i].scissor == cache->scissor ) {
+            cache->tris[i].scissor = scissor;
+        }
+    }
+
+    cache->scissor = scissor;
+}
+
+static void xi_ui_window_cache_submit ( xi_workload_h workload, const xi_ui_window_cache_t* cache ) {
+    for ( uint32_t i = 0; i < cache->glyph_texture_count; ++i ) {
+        xi_font_atlas_touch ( cache->glyph_textures[i] );
+    }
+
+    for ( uint32_t i = 0; i < cache->run_count; ++i ) {
+        const xi_ui_draw_run_t* run = &cache->runs[i];
+
+        if ( run->type == xi_ui_draw_op_rect_m ) {
+            xi_workload_cmd_draw ( workload, cache->rects + run->base, run->count );
+        } else {
+            xi_workload_cmd_draw_tri ( workload, cache->tris + run->base, run->count );
+        }
+    }
+}
+
+// If the window drew the exact same things as the last time it was cached, reuse that geometry instead of
+// expanding the draws again. The hash covers every draw parameter, including the text, so any change in the
+// widgets' state or in how they reacted to input shows up as a different hash.
+static void xi_ui_draw_capture_end ( xi_workload_h workload ) {
+    xi_ui_state->draw_capture = false;
+
+    xi_ui_window_cache_t* cache = xi_ui_window_cache_get ( xi_ui_state->window_id );
+    cache->last_frame = xi_ui_state->frame_idx;
+    ++xi_ui_state->stats.window_count;
+
+    if ( xi_ui_state->draw_capture_overflow ) {
+        cache->valid = false;
+        return;
+    }
+
+    xi_scissor_h scissor = xi_ui_state->draw_scissor;
+    bool hit = cache->valid && cache->hash == xi_ui_state->draw_hash;
+
+    if ( hit && cache->scissor != scissor ) {
+        if ( cache->scissor == xi_null_scissor_m || scissor == xi_null_scissor_m ) {
+            hit = false;
+        } else {
+            xi_ui_window_cache_patch_scissor ( cache, scissor );
+        }
+    }
+
+    if ( hit ) {
+        ++xi_ui_state->stats.window_cache_hits;
+    } else {
+        cache->valid = xi_ui_window_cache_build ( cache );
+        cache->hash = xi_ui_state->draw_hash;
+        cache->scissor = scissor;
+    }
+
+    if ( cache->valid ) {
+        xi_ui_window_cache_submit ( workload, cache );
+    } else {
+        xi_ui_draw_ops_submit ( workload );
+    }
+}
+
 static void xi_ui_draw_rect_textured ( xi_workload_h workload, xi_color_t color, int32_t x, int32_t y, uint32_t width, uint32_t height, uint64_t sort_order, xg_texture_h texture ) {
     xi_draw_rect_t rect = xi_draw_rect_m (
         .x = x,
@@ -388,7 +749,7 @@ static void xi_ui_draw_rect_textured ( xi_workload_h workload, xi_color_t color,
         .uv1[0] = 1,
         .uv1[1] = 1,
     );
-    xi_workload_cmd_draw ( workload, &rect, 1 );
+    xi_ui_draw_push_rect ( workload, &rect );
 }
 
 static void xi_ui_draw_rect ( xi_workload_h workload, xi_color_t color, int32_t x, int32_t y, uint32_t width, uint32_t height, uint64_t sort_order ) {
@@ -401,7 +762,7 @@ static void xi_ui_draw_rect ( xi_workload_h workload, xi_color_t color, int32_t
         .sort_order = sort_order,
         .scissor = xi_ui_state->active_scissor,
     );
-    xi_workload_cmd_draw ( workload, &rect, 1 );
+    xi_ui_draw_push_rect ( workload, &rect );
 }
 
 static void xi_ui_draw_tri ( xi_workload_h workload, xi_color_t color, int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint64_t sort_order ) {
@@ -415,74 +776,79 @@ static void xi_ui_draw_tri ( xi_workload_h workload, xi_color_t color, int32_t x
     tri.color = color;
     tri.sort_order = sort_order;
     tri.scissor = xi_ui_state->active_scissor;
-    xi_workload_cmd_draw_tri ( workload, &tri, 1 );
+    xi_ui_draw_push_tri ( workload, &tri );
 }
 
-static uint32_t xi_ui_draw_string ( xi_workload_h workload, xi_font_h font, xi_color_t color, const char* text, uint32_t x, uint32_t y, uint64_t sort_order ) {
+static uint32_t xi_ui_string_width_measure ( const char* text, xi_font_h font ) {
     size_t len = std_str_len ( text );
     // TODO assert on len
 
     xi_font_info_t font_info;
     xi_font_get_info ( &font_info, font );
-    float scale = 0.5;//( float ) height / font_info.pixel_height;
+    float scale = 1;//( float ) pixel_height / font_info.pixel_height;
 
-    uint32_t x_offset = 0;
-    float fx = x;
-    float fy = y + font_info.pixel_height + font_info.descent;
+    uint32_t width = 0;
+    float fx = 0;
+    float fy = 0;
 
     for ( uint32_t i = 0; i < len; ++i ) {
-        xi_font_char_box_t box = xi_font_char_box_get ( &fx, &fy, font, text[i] );
-
-        xi_draw_rect_t rect = xi_draw_rect_m();
-        //rect.x = x + x_offset;
-        //rect.y = y + ( font_info.pixel_height - box.height ) * scale;
-        //rect.width = box.width * scale;
-        //rect.height = box.height * scale;
-        rect.x = box.xy0[0];
-        rect.y = box.xy0[1];
-        rect.width = box.xy1[0] - box.xy0[0];
-        rect.height = box.xy1[1] - box.xy0[1];
-        rect.color = color;
-        rect.texture = xi_font_atlas_get ( font );
-        rect.linear_sampler_filter = false;
-        rect.uv0[0] = box.uv0[0];
-        rect.uv0[1] = box.uv0[1];
-        rect.uv1[0] = box.uv1[0];
-        rect.uv1[1] = box.uv1[1];
-        rect.sort_order = sort_order;
-        rect.scissor = xi_ui_state->active_scissor;
-
-        x_offset += box.width * scale;
-
-        xi_workload_cmd_draw ( workload, &rect, 1 ); // TODO batch? change the api to only take 1?
-    }
-
-    uint32_t width = fx - x;
-
-    //xi_ui_draw_rect ( workload, xi_color_red_m, x, y, width, font_info.pixel_height, 0 );
+        xi_font_char_box_t box = xi_font_char_box_get ( &fx, &fy, font, ( uint8_t ) text[i] );
+        width += box.width * scale;
+    }
 
-    return width;
+    return ( uint32_t ) fx;
 }
 
 // TODO return height too
 static uint32_t xi_ui_string_width ( const char* text, xi_font_h font ) {
-    size_t len = std_str_len ( text );
-    // TODO assert on len
+    ++xi_ui_state->stats.text_measure_count;
 
-    xi_font_info_t font_info;
-    xi_font_get_info ( &font_info, font );
-    float scale = 1;//( float ) pixel_height / font_info.pixel_height;
+    if ( xi_ui_state->cache_disabled ) {
+        return xi_ui_string_width_measure ( text, font );
+    }
 
-    uint32_t width = 0;
-    float fx = 0;
-    float fy = 0;
+    uint64_t key = std_hash_fnv1a_string_64 ( text ) ^ std_hash_murmur_64 ( font ^ ( xi_font_get_generation() << 32 ) );
+    xi_ui_text_width_t* set = &xi_ui_state->text_width_cache[( key % xi_ui_text_width_cache_sets_m ) * xi_ui_text_width_cache_ways_m];
+    uint64_t tick = ++xi_ui_state->text_width_tick;
 
-    for ( uint32_t i = 0; i < len; ++i ) {
-        xi_font_char_box_t box = xi_font_char_box_get ( &fx, &fy, font, text[i] );
-        width += box.width * scale;
+    xi_ui_text_width_t* lru = &set[0];
+
+    for ( uint32_t i = 0; i < xi_ui_text_width_cache_ways_m; ++i ) {
+        if ( set[i].last_use != 0 && set[i].key == key ) {
+            set[i].last_use = tick;
+            ++xi_ui_state->stats.text_measure_hits;
+            return set[i].width;
+        }
+
+        if ( set[i].last_use < lru->last_use ) {
+            lru = &set[i];
+        }
     }
 
-    return ( uint32_t ) fx;
+    lru->key = key;
+    lru->last_use = tick;
+    lru->width = xi_ui_string_width_measure ( text, font );
+    return lru->width;
+}
+
+static uint32_t xi_ui_draw_string ( xi_workload_h workload, xi_font_h font, xi_color_t color, const char* text, uint32_t x, uint32_t y, uint64_t sort_order ) {
+    size_t len = std_str_len ( text );
+    // TODO assert on len
+
+    xi_ui_draw_string_t string = {
+        .font = font,
+        .color = color,
+        .x = x,
+        .y = y,
+        .sort_order = sort_order,
+        .scissor = xi_ui_state->active_scissor,
+        .text_len = ( uint32_t ) len,
+    };
+    xi_ui_draw_push_string ( workload, &string, text );
+
+    //xi_ui_draw_rect ( workload, xi_color_red_m, x, y, width, font_info.pixel_height, 0 );
+
+    return xi_ui_string_width ( text, font );
 }
 
 void xi_ui_update_begin ( const wm_window_info_t* window_info, const wm_input_state_t* input_state, const wm_input_buffer_t* input_buffer, const rv_view_info_t* view_info ) {
@@ -494,6 +860,9 @@ void xi_ui_update_begin ( const wm_window_info_t* window_info, const wm_input_st
     std_tick_t now = std_tick_now();
     uint64_t delta = now - xi_ui_state->update.current_tick;
 
+    std_mem_zero_m ( &xi_ui_state->stats );
+    xi_ui_state->stats_tick = now;
+
     xi_ui_state->update.os_window_width = window_info->width;
     xi_ui_state->update.os_window_height = window_info->height;
     xi_ui_state->update.os_window_handle = window_info->os_handle;
@@ -545,6 +914,8 @@ void xi_ui_update_begin ( const wm_window_info_t* window_info, const wm_input_st
     xi_ui_state->focus_stack_count = 0;
 
     xi_ui_state->active_scissor = xi_null_scissor_m;
+
+    ++xi_ui_state->frame_idx;
 }
 
 static uint32_t xi_ui_get_focus_stack_idx ( uint64_t id, uint32_t sub_id ) {
@@ -557,6 +928,9 @@ static uint32_t xi_ui_get_focus_stack_idx ( uint64_t id, uint32_t sub_id ) {
 }
 
 void xi_ui_update_end ( void ) {
+    xi_ui_state->stats.cpu_ms = std_tick_to_milli_f32 ( std_tick_now() - xi_ui_state->stats_tick );
+    xi_ui_state->last_stats = xi_ui_state->stats;
+
     if ( xi_ui_state->update.input_buffer.count > 0 && xi_ui_state->focus_stack_count > 0 ) {
         wm_input_event_t* event = &xi_ui_state->update.input_buffer.events[0];
         if ( event->type == wm_event_key_down_m ) {
@@ -575,6 +949,16 @@ void xi_ui_update_end ( void ) {
     }
 }
 
+void xi_ui_get_stats ( xi_ui_stats_t* stats ) {
+    *stats = xi_ui_state->last_stats;
+}
+
+// Without the cache windows submit their draws as they're issued and strings are measured every time
+void xi_ui_set_cache_enabled ( bool enabled ) {
+    std_assert_m ( !xi_ui_state->draw_capture );
+    xi_ui_state->cache_disabled = !enabled;
+}
+
 xi_style_t xi_ui_inherit_style ( const xi_style_t* style ) {
     if ( xi_ui_state->layer_count == 0 ) {
         return *style;
@@ -597,6 +981,12 @@ xi_style_t xi_ui_inherit_style ( const xi_style_t* style ) {
 }
 
 void xi_ui_window_begin ( xi_workload_h workload, xi_window_state_t* state ) {
+    if ( !xi_ui_state->cache_disabled ) {
+        xi_ui_draw_capture_begin ( state->id );
+    } else {
+        ++xi_ui_state->stats.window_count;
+    }
+
     xi_style_t style = xi_ui_inherit_style ( &state->style );
 
     xi_font_info_t font_info;
@@ -891,10 +1281,13 @@ void xi_ui_window_begin ( xi_workload_h workload, xi_window_state_t* state ) {
 
     xi_scissor_h scissor = xi_workload_scissor ( workload, state->x, state->y + header_height, state->width, state->height - header_height );
     xi_ui_state->active_scissor = scissor;
+    xi_ui_draw_capture_scissor ( scissor, state->x, state->y + header_height, state->width, state->height - header_height );
 }
 
 void xi_ui_window_end ( xi_workload_h workload ) {
-    std_unused_m ( workload );
+    if ( xi_ui_state->draw_capture ) {
+        xi_ui_draw_capture_end ( workload );
+    }
 
     uint64_t* lookup = std_hash_map_lookup_insert ( &xi_ui_state->windows_map, xi_ui_state->window_id, NULL );
     xi_ui_layer_t* layer = &xi_ui_state->layers[0];
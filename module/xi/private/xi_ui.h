@@ -2,6 +2,8 @@
 
 #include <xi.h>
 
+#include "xi_workload.h"
+
 #include <xg_geo_util.h>
 
 #include <std_time.h>
@@ -63,6 +65,66 @@ typedef struct {
     xg_geo_util_geometry_gpu_data_t gpu;
 } xi_ui_geometry_t;
 
+typedef enum {
+    xi_ui_draw_op_rect_m,
+    xi_ui_draw_op_tri_m,
+    xi_ui_draw_op_string_m,
+} xi_ui_draw_op_e;
+
+typedef struct {
+    xi_font_h font;
+    xi_color_t color;
+    uint32_t x;
+    uint32_t y;
+    uint64_t sort_order;
+    xi_scissor_h scissor;
+    // into xi_ui_state_t::draw_text
+    uint32_t text_offset;
+    uint32_t text_len;
+} xi_ui_draw_string_t;
+
+typedef struct {
+    xi_ui_draw_op_e type;
+    union {
+        xi_draw_rect_t rect;
+        xi_draw_tri_t tri;
+        xi_ui_draw_string_t string;
+    };
+} xi_ui_draw_op_t;
+
+// A sequence of consecutive rects or tris, submitted in order to keep the original draw order between the two
+typedef struct {
+    xi_ui_draw_op_e type;
+    uint32_t base;
+    uint32_t count;
+} xi_ui_draw_run_t;
+
+// Geometry produced by a window the last time its draw stream changed. Strings are stored already expanded into glyph rects.
+typedef struct {
+    uint64_t id;
+    uint64_t hash;
+    uint64_t last_frame;
+    bool valid;
+    // the window scissor at the time the geometry was built, patched on reuse if it changed
+    xi_scissor_h scissor;
+    xi_draw_rect_t* rects;
+    xi_draw_tri_t* tris;
+    xi_ui_draw_run_t* runs;
+    uint32_t rect_count;
+    uint32_t tri_count;
+    uint32_t run_count;
+    // font atlas pages the glyph rects sample from, kept alive on reuse
+    xg_texture_h glyph_textures[xi_font_max_atlas_pages_m];
+    uint32_t glyph_texture_count;
+} xi_ui_window_cache_t;
+
+typedef struct {
+    uint64_t key;
+    // 0 if the entry is unused
+    uint64_t last_use;
+    uint32_t width;
+} xi_ui_text_width_t;
+
 typedef struct {
     xi_ui_update_state_t update;
 
@@ -117,6 +179,29 @@ typedef struct {
     bool minimized_window;
     xi_id_t window_id;
 
+    // the draws of the current window are recorded here and hashed, and only submitted at window end, see xi_ui_window_end
+    bool draw_capture;
+    // set when the current window ran out of space to record its draws, in which case they go straight to the workload
+    bool draw_capture_overflow;
+    uint64_t draw_hash;
+    xi_scissor_h draw_scissor;
+    xi_ui_draw_op_t* draw_ops;
+    uint32_t draw_op_count;
+    char* draw_text;
+    uint32_t draw_text_size;
+
+    xi_ui_window_cache_t window_cache[xi_ui_max_cached_windows_m];
+    uint64_t frame_idx;
+
+    // set associative, LRU within each set
+    xi_ui_text_width_t text_width_cache[xi_ui_text_width_cache_sets_m * xi_ui_text_width_cache_ways_m];
+    uint64_t text_width_tick;
+
+    bool cache_disabled;
+    std_tick_t stats_tick;
+    xi_ui_stats_t stats;
+    xi_ui_stats_t last_stats;
+
     // geo
     xg_device_h device;
     xi_ui_geometry_t transform_geo;
@@ -130,6 +215,9 @@ void xi_ui_unload ( void );
 void xi_ui_update_begin ( const wm_window_info_t* window_info, const wm_input_state_t* input_state, const wm_input_buffer_t* input_buffer, const rv_view_info_t* view_info );
 void xi_ui_update_end ( void );
 
+void xi_ui_get_stats ( xi_ui_stats_t* stats );
+void xi_ui_set_cache_enabled ( bool enabled );
+
 void xi_ui_window_begin ( xi_workload_h workload, xi_window_state_t* state );
 void xi_ui_window_end ( xi_workload_h workload );
 
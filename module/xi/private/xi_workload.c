@@ -1,10 +1,13 @@
 #include "xi_workload.h"
+#include "xi_font.h"
 
 #include <xg.h>
 #include <xs.h>
 
 #include <std_queue.h>
 #include <std_list.h>
+#include <std_sort.h>
+#include <std_time.h>
 
 #include <sm_matrix.h>
 
@@ -20,6 +23,12 @@ void xi_workload_load ( xi_workload_state_t* state ) {
     xi_workload_state->ui_renderpass_rgba8.xg_handle = xg_null_handle_m;
     xi_workload_state->ui_renderpass_bgra8.xg_handle = xg_null_handle_m;
     xi_workload_state->ui_renderpass_a2bgr10.xg_handle = xg_null_handle_m;
+
+    for ( uint32_t i = 0; i < xg_max_active_devices_m; ++i ) {
+        xi_workload_state->device_contexts[i].device = xg_null_handle_m;
+    }
+
+    std_mem_zero_m ( &xi_workload_state->flush_stats );
 }
 
 void xi_workload_reload ( xi_workload_state_t* state ) {
@@ -27,6 +36,15 @@ void xi_workload_reload ( xi_workload_state_t* state ) {
 }
 
 void xi_workload_unload ( void ) {
+    for ( uint32_t i = 0; i < xg_max_active_devices_m; ++i ) {
+        xg_device_h device = xi_workload_state->device_contexts[i].device;
+
+        if ( device != xg_null_handle_m ) {
+            xg_i* xg = std_module_get_m ( xg_module_name_m );
+            xi_workload_deactivate_device ( xg, device );
+        }
+    }
+
     std_virtual_heap_free ( xi_workload_state->workloads_array );
 }
 
@@ -40,14 +58,65 @@ void xi_workload_load_shaders ( xs_i* xs, xs_database_h sdb ) {
     xi_workload_state->geo_pipeline_a2bgr10 = xs->get_database_pipeline ( sdb, xs_hash_static_string_m ( "xi_geo_a2b10g10r10" ) );
 }
 
+static xi_workload_device_context_t* xi_workload_device_context_get ( xg_device_h device ) {
+    for ( uint32_t i = 0; i < xg_max_active_devices_m; ++i ) {
+        if ( xi_workload_state->device_contexts[i].device == device ) {
+            return &xi_workload_state->device_contexts[i];
+        }
+    }
+
+    return NULL;
+}
+
 void xi_workload_activate_device ( xg_i* xg, xg_device_h device ) {
-    std_unused_m ( xg );
-    std_unused_m ( device );
+    std_assert_m ( xi_workload_device_context_get ( device ) == NULL );
+    xi_workload_device_context_t* context = xi_workload_device_context_get ( xg_null_handle_m );
+    std_assert_m ( context );
+
+    uint64_t vertex_size = sizeof ( xi_workload_vertex_t ) * xi_workload_segment_vertex_count_m * xi_workload_max_submitted_workloads_m;
+    uint64_t index_size = sizeof ( uint32_t ) * xi_workload_segment_index_count_m * xi_workload_max_submitted_workloads_m;
+
+    xg_buffer_h buffer = xg->create_buffer ( &xg_buffer_params_m (
+        .memory_type = xg_memory_type_gpu_mapped_m,
+        .device = device,
+        .size = vertex_size + index_size,
+        .allowed_usage = xg_buffer_usage_bit_vertex_buffer_m | xg_buffer_usage_bit_index_buffer_m,
+        .debug_name = "xi_geometry_buffer",
+    ) );
+    std_assert_m ( buffer != xg_null_handle_m );
+
+    xg_buffer_info_t buffer_info;
+    xg->get_buffer_info ( &buffer_info, buffer );
+
+    context->device = device;
+    context->buffer = buffer;
+    context->mapped_address = ( char* ) buffer_info.allocation.mapped_address;
+    context->segment_idx = 0;
+    context->segment_vertex_count = 0;
+    context->segment_index_count = 0;
+
+    for ( uint32_t i = 0; i < xi_workload_max_submitted_workloads_m; ++i ) {
+        context->segment_workloads[i] = xg_null_handle_m;
+    }
 }
 
 void xi_workload_deactivate_device ( xg_i* xg, xg_device_h device ) {
-    std_unused_m ( xg );
-    std_unused_m ( device );
+    xi_workload_device_context_t* context = xi_workload_device_context_get ( device );
+
+    if ( !context ) {
+        return;
+    }
+
+    // Workloads that read from the buffer might still be in flight, destroy it from a new one so that it happens
+    // after those are done
+    xg_workload_h workload = xg->create_workload ( device );
+    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+    xg->cmd_destroy_buffer ( resource_cmd_buffer, context->buffer, xg_resource_cmd_buffer_time_workload_complete_m );
+    xg->submit_workload ( workload );
+
+    context->device = xg_null_handle_m;
+    context->buffer = xg_null_handle_m;
+    context->mapped_address = NULL;
 }
 
 xi_workload_h xi_workload_create ( void ) {
@@ -56,7 +125,7 @@ xi_workload_h xi_workload_create ( void ) {
     workload->rect_count = 0;
     workload->tri_count = 0;
     workload->mesh_count = 0;
-    workload->vertex_buffer = xg_null_handle_m;
+    workload->cmd_count = 0;
     workload->xg_workload = xg_null_handle_m;
     workload->scissor_count = 0;
 
@@ -75,7 +144,7 @@ xi_scissor_h xi_workload_scissor ( xi_workload_h workload_handle, uint32_t x, ui
     scissor->y = y;
     scissor->width = width;
     scissor->height = height;
-    return workload->scissor_array - scissor;
+    return ( xi_scissor_h ) ( scissor - workload->scissor_array );
 }
 
 void xi_workload_cmd_draw ( xi_workload_h workload_handle, const xi_draw_rect_t* rects, uint64_t rect_count ) {
@@ -84,6 +153,11 @@ void xi_workload_cmd_draw ( xi_workload_h workload_handle, const xi_draw_rect_t*
 
     for ( uint64_t i = 0; i < rect_count; ++i ) {
         workload->rect_array[workload->rect_count + i] = rects[i];
+        workload->cmd_array[workload->cmd_count++] = ( xi_workload_cmd_t ) {
+            .sort_order = rects[i].sort_order,
+            .type = xi_workload_cmd_rect_m,
+            .idx = ( uint32_t ) ( workload->rect_count + i ),
+        };
     }
 
     workload->rect_count += rect_count;
@@ -95,6 +169,11 @@ void xi_workload_cmd_draw_tri ( xi_workload_h workload_handle, const xi_draw_tri
 
     for ( uint64_t i = 0; i < tri_count; ++i ) {
         workload->tri_array[workload->tri_count + i] = tris[i];
+        workload->cmd_array[workload->cmd_count++] = ( xi_workload_cmd_t ) {
+            .sort_order = tris[i].sort_order,
+            .type = xi_workload_cmd_tri_m,
+            .idx = ( uint32_t ) ( workload->tri_count + i ),
+        };
     }
 
     workload->tri_count += tri_count;
@@ -103,6 +182,11 @@ void xi_workload_cmd_draw_tri ( xi_workload_h workload_handle, const xi_draw_tri
 void xi_workload_cmd_draw_mesh ( xi_workload_h workload_handle, const xi_draw_mesh_t* mesh ) {
     xi_workload_t* workload = &xi_workload_state->workloads_array[workload_handle];
     std_assert_m ( workload->mesh_count < xi_workload_max_meshes_m );
+    workload->cmd_array[workload->cmd_count++] = ( xi_workload_cmd_t ) {
+        .sort_order = mesh->sort_order,
+        .type = xi_workload_cmd_mesh_m,
+        .idx = workload->mesh_count,
+    };
     workload->mesh_array[workload->mesh_count++] = *mesh;
 }
 
@@ -116,8 +200,146 @@ void xi_workload_set_view_info ( xi_workload_h workload_handle, const rv_view_in
     *proj_from_world = sm_matrix_4x4f_mul ( *proj, *view );
 }
 
+typedef struct {
+    xg_i* xg;
+    const xi_flush_params_t* params;
+    xi_workload_t* workload;
+    xg_graphics_pipeline_state_h pipeline;
+    xg_sampler_h point_sampler;
+    xg_sampler_h linear_sampler;
+    xg_texture_h null_texture;
+    xg_buffer_h buffer;
+    uint32_t base_vertex;
+    uint32_t base_index;
+    // Scissor last set on the cmd buffer, mesh draws reset it
+    xi_scissor_h active_scissor;
+    bool is_scissor_set;
+    // Textures bound to the draw slots, the bindings are created again only once the set changes
+    xg_texture_h textures[xi_workload_max_draw_textures_m];
+    uint32_t texture_count;
+    xg_resource_bindings_h bindings;
+    // Pending draw, covers the indices in [index_begin, index_end)
+    xi_scissor_h scissor;
+    uint64_t sort_order;
+    uint32_t index_begin;
+    uint32_t index_end;
+    xi_flush_stats_t* stats;
+} xi_workload_flush_context_t;
+
+static int xi_workload_cmd_sort ( const void* a, const void* b, const void* arg ) {
+    std_unused_m ( arg );
+    std_auto_m c1 = ( const xi_workload_cmd_t* ) a;
+    std_auto_m c2 = ( const xi_workload_cmd_t* ) b;
+    return c1->sort_order < c2->sort_order ? -1 : c1->sort_order > c2->sort_order ? 1 : 0;
+}
+
+static void xi_workload_flush_draw ( xi_workload_flush_context_t* context ) {
+    if ( context->index_end == context->index_begin ) {
+        return;
+    }
+
+    xg_i* xg = context->xg;
+    const xi_flush_params_t* params = context->params;
+    uint64_t key = params->key + context->sort_order;
+
+    if ( !context->is_scissor_set || context->scissor != context->active_scissor ) {
+        xg_scissor_state_t scissor_state = xg_scissor_state_m();
+
+        if ( context->scissor != xi_null_scissor_m ) {
+            xi_scissor_t* scissor = &context->workload->scissor_array[context->scissor];
+            scissor_state.x = scissor->x;
+            scissor_state.y = scissor->y;
+            scissor_state.width = scissor->width;
+            scissor_state.height = scissor->height;
+        }
+
+        xg->cmd_set_dynamic_scissor ( params->cmd_buffer, key, &scissor_state );
+        context->active_scissor = context->scissor;
+        context->is_scissor_set = true;
+    }
+
+    if ( context->bindings == xg_null_handle_m ) {
+        xg_pipeline_resource_bindings_t bindings = xg_pipeline_resource_bindings_m (
+            .texture_count = xi_workload_max_draw_textures_m,
+            .sampler_count = 2,
+            .samplers = {
+                xg_sampler_resource_binding_m (
+                    .shader_register = xi_workload_max_draw_textures_m,
+                    .sampler = context->point_sampler,
+                ),
+                xg_sampler_resource_binding_m (
+                    .shader_register = xi_workload_max_draw_textures_m + 1,
+                    .sampler = context->linear_sampler,
+                ),
+            },
+        );
+
+        // Unused slots still need a valid texture
+        for ( uint32_t i = 0; i < xi_workload_max_draw_textures_m; ++i ) {
+            bindings.textures[i] = xg_texture_resource_binding_m (
+                .shader_register = i,
+                .layout = xg_texture_layout_shader_read_m,
+                .texture = i < context->texture_count ? context->textures[i] : context->null_texture,
+            );
+        }
+
+        context->bindings = xg->cmd_create_workload_bindings ( params->resource_cmd_buffer, &xg_resource_bindings_params_m (
+            .layout = xg->get_pipeline_resource_layout ( context->pipeline, xg_shader_binding_set_dispatch_m ),
+            .bindings = bindings,
+        ) );
+        ++context->stats->bindings_count;
+    }
+
+    xg->cmd_draw ( params->cmd_buffer, key, &xg_cmd_draw_params_m (
+        .pipeline = context->pipeline,
+        .bindings[xg_shader_binding_set_dispatch_m] = context->bindings,
+        .primitive_count = ( context->index_end - context->index_begin ) / 3,
+        .vertex_buffers_count = 1,
+        .vertex_buffers = { context->buffer },
+        .vertex_offset = context->base_vertex,
+        .index_buffer = context->buffer,
+        .index_offset = context->base_index + context->index_begin,
+    ) );
+    ++context->stats->draw_count;
+
+    context->index_begin = context->index_end;
+}
+
+// Returns the slot the texture is bound to in the pending draw. Draws get merged for as long as their textures fit in
+// the slots, once they're full the pending draw is flushed and the slots start over.
+static uint32_t xi_workload_flush_bind_texture ( xi_workload_flush_context_t* context, xg_texture_h texture, xi_scissor_h scissor ) {
+    uint32_t slot = UINT32_MAX;
+
+    for ( uint32_t i = 0; i < context->texture_count; ++i ) {
+        if ( context->textures[i] == texture ) {
+            slot = i;
+            break;
+        }
+    }
+
+    bool is_full = slot == UINT32_MAX && context->texture_count == xi_workload_max_draw_textures_m;
+
+    if ( is_full || scissor != context->scissor ) {
+        xi_workload_flush_draw ( context );
+        context->scissor = scissor;
+    }
+
+    if ( is_full ) {
+        context->texture_count = 0;
+    }
+
+    if ( slot == UINT32_MAX ) {
+        slot = context->texture_count++;
+        context->textures[slot] = texture;
+        context->bindings = xg_null_handle_m;
+    }
+
+    return slot;
+}
+
 uint64_t xi_workload_flush ( xi_workload_h workload_handle, const xi_flush_params_t* flush_params ) {
     xg_i* xg = std_module_get_m ( xg_module_name_m );
+    std_tick_t start_tick = std_tick_now();
     
     uint64_t key = flush_params->key;
     float viewport_w = ( float ) flush_params->viewport.width;
@@ -131,6 +353,10 @@ uint64_t xi_workload_flush ( xi_workload_h workload_handle, const xi_flush_param
     xi_workload_t* workload = &xi_workload_state->workloads_array[workload_handle];
     workload->xg_workload = flush_params->workload;
 
+    xi_flush_stats_t* stats = &xi_workload_state->flush_stats;
+    std_mem_zero_m ( stats );
+    stats->cmd_count = workload->cmd_count;
+
     // renderpass
     xi_workload_renderpass_t* renderpass;
     if ( flush_params->render_target_format == xg_format_r8g8b8a8_unorm_m ) {
@@ -169,36 +395,111 @@ uint64_t xi_workload_flush ( xi_workload_h workload_handle, const xi_flush_param
         renderpass->resolution_y = viewport_h;
     }
 
+    // glyphs rasterised since the last flush
+    xi_font_flush ( flush_params->cmd_buffer, flush_params->resource_cmd_buffer, key );
+
     xg->cmd_begin_renderpass ( flush_params->cmd_buffer, key, &xg_cmd_renderpass_params_m (
         .renderpass = renderpass->xg_handle,
         .render_targets_count = 1,
         .render_targets = { flush_params->render_target_binding }
     ) );
 
-    // TODO instead of storing separate lists for quads/tris/meshes store generic draw lists, to avoid
-    // imposing the arbitrary order of meshes -> quads -> tris for equal sort order items
-
-    // draw meshes
-    uint32_t max_sort_order = 0;
-    {
-
-        xs_i* xs = std_module_get_m ( xs_module_name_m );
-        xg_graphics_pipeline_state_h pipeline_state;
-        if ( flush_params->render_target_format == xg_format_r8g8b8a8_unorm_m ) {
-            pipeline_state = xs->get_pipeline_state ( xi_workload_state->geo_pipeline_rgba8 );
-        } else if ( flush_params->render_target_format == xg_format_b8g8r8a8_unorm_m ) {
-            pipeline_state = xs->get_pipeline_state ( xi_workload_state->geo_pipeline_bgra8 );
-        } else if ( flush_params->render_target_format == xg_format_a2b10g10r10_unorm_pack32_m ) {
-            pipeline_state = xs->get_pipeline_state ( xi_workload_state->geo_pipeline_a2bgr10 );
-        } else {
-            pipeline_state = xg_null_handle_m;
-            std_not_implemented_m();
+    // pipelines
+    xs_i* xs = std_module_get_m ( xs_module_name_m );
+    xg_graphics_pipeline_state_h ui_pipeline_state;
+    xg_graphics_pipeline_state_h geo_pipeline_state;
+    if ( flush_params->render_target_format == xg_format_r8g8b8a8_unorm_m ) {
+        ui_pipeline_state = xs->get_pipeline_state ( xi_workload_state->ui_pipeline_rgba8 );
+        geo_pipeline_state = xs->get_pipeline_state ( xi_workload_state->geo_pipeline_rgba8 );
+    } else if ( flush_params->render_target_format == xg_format_b8g8r8a8_unorm_m ) {
+        ui_pipeline_state = xs->get_pipeline_state ( xi_workload_state->ui_pipeline_bgra8 );
+        geo_pipeline_state = xs->get_pipeline_state ( xi_workload_state->geo_pipeline_bgra8 );
+    } else if ( flush_params->render_target_format == xg_format_a2b10g10r10_unorm_pack32_m ) {
+        ui_pipeline_state = xs->get_pipeline_state ( xi_workload_state->ui_pipeline_a2bgr10 );
+        geo_pipeline_state = xs->get_pipeline_state ( xi_workload_state->geo_pipeline_a2bgr10 );
+    } else {
+        ui_pipeline_state = xg_null_handle_m;
+        geo_pipeline_state = xg_null_handle_m;
+        std_not_implemented_m();
+    }
+
+    // pick where to write the ui geometry
+    xi_workload_device_context_t* device_context = xi_workload_device_context_get ( flush_params->device );
+    if ( !device_context ) {
+        xi_workload_activate_device ( xg, flush_params->device );
+        device_context = xi_workload_device_context_get ( flush_params->device );
+    }
+
+    uint32_t vertex_count = ( uint32_t ) ( workload->rect_count * 4 + workload->tri_count * 3 );
+    uint32_t index_count = ( uint32_t ) ( workload->rect_count * 6 + workload->tri_count * 3 );
+
+    if ( device_context->segment_workloads[device_context->segment_idx] != flush_params->workload
+        || device_context->segment_vertex_count + vertex_count > xi_workload_segment_vertex_count_m
+        || device_context->segment_index_count + index_count > xi_workload_segment_index_count_m ) {
+        device_context->segment_idx = ( device_context->segment_idx + 1 ) % xi_workload_max_submitted_workloads_m;
+        xg_workload_h segment_workload = device_context->segment_workloads[device_context->segment_idx];
+
+        // Only stalls when more than xi_workload_max_submitted_workloads_m workloads are in flight
+        if ( segment_workload != xg_null_handle_m && !xg->is_workload_complete ( segment_workload ) ) {
+            xg->wait_for_workload ( segment_workload );
         }
 
-        for ( uint32_t i = 0; i < workload->mesh_count; ++i ) {
-            const xi_draw_mesh_t* mesh = &workload->mesh_array[i];
+        device_context->segment_workloads[device_context->segment_idx] = flush_params->workload;
+        device_context->segment_vertex_count = 0;
+        device_context->segment_index_count = 0;
+    }
 
-            max_sort_order = std_max ( max_sort_order, mesh->sort_order );
+    uint32_t base_vertex = device_context->segment_idx * xi_workload_segment_vertex_count_m + device_context->segment_vertex_count;
+    uint32_t index_region_base = xi_workload_max_submitted_workloads_m * xi_workload_segment_vertex_count_m * sizeof ( xi_workload_vertex_t ) / sizeof ( uint32_t );
+    uint32_t base_index = index_region_base + device_context->segment_idx * xi_workload_segment_index_count_m + device_context->segment_index_count;
+    device_context->segment_vertex_count += vertex_count;
+    device_context->segment_index_count += index_count;
+
+    xi_workload_vertex_t* vertices = ( xi_workload_vertex_t* ) device_context->mapped_address + base_vertex;
+    uint32_t* indices = ( uint32_t* ) device_context->mapped_address + base_index;
+
+    // Keep equal sort order items in the order they were recorded in, the sort is stable and the list is usually
+    // close to sorted already
+    xi_workload_cmd_t sort_tmp;
+    std_sort_insertion ( workload->cmd_array, sizeof ( xi_workload_cmd_t ), workload->cmd_count, xi_workload_cmd_sort, NULL, &sort_tmp );
+
+    xi_workload_flush_context_t context = {
+        .xg = xg,
+        .params = flush_params,
+        .workload = workload,
+        .pipeline = ui_pipeline_state,
+        .point_sampler = point_sampler,
+        .linear_sampler = linear_sampler,
+        .null_texture = null_texture,
+        .buffer = device_context->buffer,
+        .base_vertex = base_vertex,
+        .base_index = base_index,
+        .active_scissor = xi_null_scissor_m,
+        .is_scissor_set = false,
+        .texture_count = 0,
+        .bindings = xg_null_handle_m,
+        .scissor = xi_null_scissor_m,
+        .sort_order = 0,
+        .index_begin = 0,
+        .index_end = 0,
+        .stats = stats,
+    };
+
+    // the following code remaps position values from <[0, viewport_w], [0, viewport_h]> into <[-1, 1], [-1, 1]>
+    // and flips position y axis direction from bottom up to top down
+    float scale_x = 2.f / viewport_w;
+    float scale_y = -2.f / viewport_h;
+    uint32_t vertex_idx = 0;
+    uint64_t max_sort_order = 0;
+
+    for ( uint32_t i = 0; i < workload->cmd_count; ++i ) {
+        const xi_workload_cmd_t* cmd = &workload->cmd_array[i];
+        max_sort_order = std_max ( max_sort_order, cmd->sort_order );
+
+        if ( cmd->type == xi_workload_cmd_mesh_m ) {
+            xi_workload_flush_draw ( &context );
+
+            const xi_draw_mesh_t* mesh = &workload->mesh_array[cmd->idx];
 
             sm_vec_3f_t up = { 0, 1, 0 }; // TODO
             sm_vec_3f_t dir = { 0, 0, 1 }; // TODO
@@ -224,7 +525,7 @@ uint64_t xi_workload_flush ( xi_workload_h workload_handle, const xi_flush_param
                 .color = { mesh->color[0], mesh->color[1], mesh->color[2], mesh->color[3] },
             };
 
-            xg_resource_bindings_layout_h layout = xg->get_pipeline_resource_layout ( pipeline_state, xg_shader_binding_set_dispatch_m );
+            xg_resource_bindings_layout_h layout = xg->get_pipeline_resource_layout ( geo_pipeline_state, xg_shader_binding_set_dispatch_m );
 
             xg_resource_bindings_h group = xg->cmd_create_workload_bindings ( flush_params->resource_cmd_buffer, &xg_resource_bindings_params_m (
                 .layout = layout,
@@ -240,9 +541,10 @@ uint64_t xi_workload_flush ( xi_workload_h workload_handle, const xi_flush_param
             ) );
 
             xg->cmd_set_dynamic_scissor ( flush_params->cmd_buffer, key + mesh->sort_order, &xg_scissor_state_m() );
+            context.is_scissor_set = false;
 
             xg->cmd_draw ( flush_params->cmd_buffer, key + mesh->sort_order, &xg_cmd_draw_params_m (
-                .pipeline = pipeline_state,
+                .pipeline = geo_pipeline_state,
                 .bindings[xg_shader_binding_set_dispatch_m] = group,
                 .primitive_count = mesh->idx_count / 3,
                 .vertex_buffers_count = 1,
@@ -250,262 +552,80 @@ uint64_t xi_workload_flush ( xi_workload_h workload_handle, const xi_flush_param
                 .index_buffer = mesh->idx_buffer
             ) );
 
-            //xg->cmd_draw_indexed ( flush_params->cmd_buffer, mesh->idx_buffer, mesh->idx_count, 0, key + mesh->sort_order );
-        }
-    }
+            ++stats->bindings_count;
+            ++stats->draw_count;
+        } else if ( cmd->type == xi_workload_cmd_rect_m ) {
+            const xi_draw_rect_t* rect = &workload->rect_array[cmd->idx];
 
-    // draw ui
-    xi_scissor_h active_scissor = xi_null_scissor_m;
-    {
-        // translate rects and tris into vertex data
-        for ( uint64_t i = 0; i < workload->rect_count; ++i ) {
-            const xi_draw_rect_t* rect = &workload->rect_array[i];
-            xi_workload_vertex_t* vertex;
-
-            max_sort_order = std_max ( max_sort_order, rect->sort_order );
-
-            // the following code remaps position values from <[0, viewport_w], [0, viewport_h]> into <[-1, 1], [-1, 1]>
-            // and flips position y axis direction from bottom up to top down
-            //
-            // top left
-            vertex = &workload->vertex_buffer_data[i * 6 + 0];
-            vertex->pos[0] = ( rect->x / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - ( rect->y / viewport_h ) )  * 2 - 1;
-            vertex->uv[0] = rect->uv0[0];
-            vertex->uv[1] = rect->uv0[1];
-            vertex->color[0] = rect->color.r / 255.f;
-            vertex->color[1] = rect->color.g / 255.f;
-            vertex->color[2] = rect->color.b / 255.f;
-            vertex->color[3] = rect->color.a / 255.f;
-            // top right
-            vertex = &workload->vertex_buffer_data[i * 6 + 1];
-            vertex->pos[0] = ( ( rect->x + rect->width ) / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - ( rect->y / viewport_h ) ) * 2 - 1;
-            vertex->uv[0] = rect->uv1[0];
-            vertex->uv[1] = rect->uv0[1];
-            vertex->color[0] = rect->color.r / 255.f;
-            vertex->color[1] = rect->color.g / 255.f;
-            vertex->color[2] = rect->color.b / 255.f;
-            vertex->color[3] = rect->color.a / 255.f;
-            // bottom right
-            vertex = &workload->vertex_buffer_data[i * 6 + 2];
-            vertex->pos[0] = ( ( rect->x + rect->width ) / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - ( ( rect->y + rect->height ) / viewport_h ) ) * 2 - 1;
-            vertex->uv[0] = rect->uv1[0];
-            vertex->uv[1] = rect->uv1[1];
-            vertex->color[0] = rect->color.r / 255.f;
-            vertex->color[1] = rect->color.g / 255.f;
-            vertex->color[2] = rect->color.b / 255.f;
-            vertex->color[3] = rect->color.a / 255.f;
-            // bottom right
-            vertex = &workload->vertex_buffer_data[i * 6 + 3];
-            *vertex = workload->vertex_buffer_data[i * 6 + 2];
-            // bottom left
-            vertex = &workload->vertex_buffer_data[i * 6 + 4];
-            vertex->pos[0] = ( rect->x / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - ( ( rect->y + rect->height ) / viewport_h ) ) * 2 - 1;
-            vertex->uv[0] = rect->uv0[0];
-            vertex->uv[1] = rect->uv1[1];
-            vertex->color[0] = rect->color.r / 255.f;
-            vertex->color[1] = rect->color.g / 255.f;
-            vertex->color[2] = rect->color.b / 255.f;
-            vertex->color[3] = rect->color.a / 255.f;
-            // top left
-            vertex = &workload->vertex_buffer_data[i * 6 + 5];
-            *vertex = workload->vertex_buffer_data[i * 6 + 0];
-        }
+            uint32_t tex = xi_workload_flush_bind_texture ( &context, rect->texture != xg_null_handle_m ? rect->texture : null_texture, rect->scissor );
+            tex |= rect->linear_sampler_filter ? xi_workload_vertex_linear_filter_bit_m : 0;
+            tex |= ( uint32_t ) rect->texture_mode << xi_workload_vertex_texture_mode_shift_m;
 
-        uint64_t tri_base = workload->rect_count * 6;
-
-        for ( uint64_t i = 0; i < workload->tri_count; ++i ) {
-            const xi_draw_tri_t* tri = &workload->tri_array[i];
-            xi_workload_vertex_t* vertex;
-
-            max_sort_order = std_max ( max_sort_order, tri->sort_order );
-
-            vertex = &workload->vertex_buffer_data[tri_base + i * 3 + 0];
-            vertex->pos[0] = ( tri->xy0[0] / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - tri->xy0[1] / viewport_h ) * 2 - 1;
-            vertex->uv[0] = tri->uv0[0];
-            vertex->uv[1] = tri->uv0[1];
-            vertex->color[0] = tri->color.r / 255.f;
-            vertex->color[1] = tri->color.g / 255.f;
-            vertex->color[2] = tri->color.b / 255.f;
-            vertex->color[3] = tri->color.a / 255.f;
-
-            vertex = &workload->vertex_buffer_data[tri_base + i * 3 + 1];
-            vertex->pos[0] = ( tri->xy1[0] / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - tri->xy1[1] / viewport_h ) * 2 - 1;
-            vertex->uv[0] = tri->uv1[0];
-            vertex->uv[1] = tri->uv1[1];
-            vertex->color[0] = tri->color.r / 255.f;
-            vertex->color[1] = tri->color.g / 255.f;
-            vertex->color[2] = tri->color.b / 255.f;
-            vertex->color[3] = tri->color.a / 255.f;
-
-            vertex = &workload->vertex_buffer_data[tri_base + i * 3 + 2];
-            vertex->pos[0] = ( tri->xy2[0] / viewport_w ) * 2 - 1;
-            vertex->pos[1] = ( 1 - tri->xy2[1] / viewport_h ) * 2 - 1;
-            vertex->uv[0] = tri->uv2[0];
-            vertex->uv[1] = tri->uv2[1];
-            vertex->color[0] = tri->color.r / 255.f;
-            vertex->color[1] = tri->color.g / 255.f;
-            vertex->color[2] = tri->color.b / 255.f;
-            vertex->color[3] = tri->color.a / 255.f;
-        }
+            if ( context.index_begin == context.index_end ) {
+                context.sort_order = cmd->sort_order;
+            }
 
-        // create vertex buffer
-        xg_buffer_params_t vertex_buffer_params = xg_buffer_params_m (
-            .memory_type = xg_memory_type_gpu_mapped_m,
-            .device = flush_params->device,
-            .size = sizeof ( xi_workload_vertex_t ) * ( workload->rect_count * 6 + workload->tri_count * 3 ),
-            .allowed_usage = xg_buffer_usage_bit_vertex_buffer_m,
-            .debug_name = "xi_vertex_buffer",
-        );
-        xg_buffer_h vertex_buffer_handle = xg->create_buffer ( &vertex_buffer_params );
-        std_assert_m ( vertex_buffer_handle != xg_null_handle_m );
-        workload->vertex_buffer = vertex_buffer_handle;
-
-        // fill vertex buffer
-        xg_buffer_info_t vertex_buffer_info;
-        xg->get_buffer_info ( &vertex_buffer_info, vertex_buffer_handle );
-        char* vertex_buffer_data = ( char* ) vertex_buffer_info.allocation.mapped_address;
-        std_mem_copy ( vertex_buffer_data, workload->vertex_buffer_data, vertex_buffer_params.size );
-
-        // bind pipeline
-        xs_i* xs = std_module_get_m ( xs_module_name_m );
-        xg_graphics_pipeline_state_h pipeline_state;
-        if ( flush_params->render_target_format == xg_format_r8g8b8a8_unorm_m ) {
-            pipeline_state = xs->get_pipeline_state ( xi_workload_state->ui_pipeline_rgba8 );
-        } else if ( flush_params->render_target_format == xg_format_b8g8r8a8_unorm_m ) {
-            pipeline_state = xs->get_pipeline_state ( xi_workload_state->ui_pipeline_bgra8 );
-        } else if ( flush_params->render_target_format == xg_format_a2b10g10r10_unorm_pack32_m ) {
-            pipeline_state = xs->get_pipeline_state ( xi_workload_state->ui_pipeline_a2bgr10 );
+            float x0 = rect->x * scale_x - 1;
+            float x1 = ( rect->x + rect->width ) * scale_x - 1;
+            float y0 = rect->y * scale_y + 1;
+            float y1 = ( rect->y + rect->height ) * scale_y + 1;
+
+            // top left, top right, bottom right, bottom left
+            vertices[vertex_idx + 0] = ( xi_workload_vertex_t ) { { x0, y0 }, { rect->uv0[0], rect->uv0[1] }, rect->color, tex };
+            vertices[vertex_idx + 1] = ( xi_workload_vertex_t ) { { x1, y0 }, { rect->uv1[0], rect->uv0[1] }, rect->color, tex };
+            vertices[vertex_idx + 2] = ( xi_workload_vertex_t ) { { x1, y1 }, { rect->uv1[0], rect->uv1[1] }, rect->color, tex };
+            vertices[vertex_idx + 3] = ( xi_workload_vertex_t ) { { x0, y1 }, { rect->uv0[0], rect->uv1[1] }, rect->color, tex };
+
+            uint32_t* rect_indices = &indices[context.index_end];
+            rect_indices[0] = vertex_idx + 0;
+            rect_indices[1] = vertex_idx + 1;
+            rect_indices[2] = vertex_idx + 2;
+            rect_indices[3] = vertex_idx + 2;
+            rect_indices[4] = vertex_idx + 3;
+            rect_indices[5] = vertex_idx + 0;
+
+            vertex_idx += 4;
+            context.index_end += 6;
         } else {
-            pipeline_state = xg_null_handle_m;
-            std_not_implemented_m();
-        }
+            const xi_draw_tri_t* tri = &workload->tri_array[cmd->idx];
 
-        // TODO single draw call?
-        // draw rects
-        for ( uint32_t i = 0; i < workload->rect_count; ++i ) {
-            const xi_draw_rect_t* rect = &workload->rect_array[i];
+            uint32_t tex = xi_workload_flush_bind_texture ( &context, tri->texture != xg_null_handle_m ? tri->texture : null_texture, tri->scissor );
+            tex |= tri->linear_sampler_filter ? xi_workload_vertex_linear_filter_bit_m : 0;
 
-            xi_scissor_h scissor_handle = rect->scissor;
-            //if ( scissor_handle != active_scissor ) 
-            {
-                xg_scissor_state_t scissor_state = xg_scissor_state_m();
-    
-                if ( scissor_handle != xi_null_scissor_m ) {
-                    xi_scissor_t* scissor = &workload->scissor_array[scissor_handle];
-                    scissor_state.x = scissor->x;
-                    scissor_state.y = scissor->y;
-                    scissor_state.width = scissor->width;
-                    scissor_state.height = scissor->height;
-                }
-
-                xg->cmd_set_dynamic_scissor ( flush_params->cmd_buffer, key + rect->sort_order, &scissor_state );
-                active_scissor = scissor_handle;
+            if ( context.index_begin == context.index_end ) {
+                context.sort_order = cmd->sort_order;
             }
 
-            xg_resource_bindings_layout_h layout = xg->get_pipeline_resource_layout ( pipeline_state, xg_shader_binding_set_dispatch_m );
+            vertices[vertex_idx + 0] = ( xi_workload_vertex_t ) { { tri->xy0[0] * scale_x - 1, tri->xy0[1] * scale_y + 1 }, { tri->uv0[0], tri->uv0[1] }, tri->color, tex };
+            vertices[vertex_idx + 1] = ( xi_workload_vertex_t ) { { tri->xy1[0] * scale_x - 1, tri->xy1[1] * scale_y + 1 }, { tri->uv1[0], tri->uv1[1] }, tri->color, tex };
+            vertices[vertex_idx + 2] = ( xi_workload_vertex_t ) { { tri->xy2[0] * scale_x - 1, tri->xy2[1] * scale_y + 1 }, { tri->uv2[0], tri->uv2[1] }, tri->color, tex };
 
-            xg_resource_bindings_h group = xg->cmd_create_workload_bindings ( flush_params->resource_cmd_buffer, &xg_resource_bindings_params_m (
-                .layout = layout,
-                .bindings = xg_pipeline_resource_bindings_m (
-                    .texture_count = 1,
-                    .textures = {
-                        xg_texture_resource_binding_m (
-                            .shader_register = 0,
-                            .layout = xg_texture_layout_shader_read_m,
-                            .texture = rect->texture != xg_null_handle_m ? rect->texture : null_texture,
-                        ),
-                    },
-                    .sampler_count = 1,
-                    .samplers = {
-                        xg_sampler_resource_binding_m (
-                            .shader_register = 1,
-                            .sampler = rect->linear_sampler_filter ? linear_sampler : point_sampler,
-                        )
-                    },
-                ),
-            ) );
+            uint32_t* tri_indices = &indices[context.index_end];
+            tri_indices[0] = vertex_idx + 0;
+            tri_indices[1] = vertex_idx + 1;
+            tri_indices[2] = vertex_idx + 2;
 
-            xg->cmd_draw ( flush_params->cmd_buffer, key + rect->sort_order, &xg_cmd_draw_params_m ( 
-                .pipeline = pipeline_state,
-                .bindings[xg_shader_binding_set_dispatch_m] = group,
-                .primitive_count = 2,
-                .vertex_buffers_count = 1,
-                .vertex_buffers = { workload->vertex_buffer },
-                .vertex_offset = i * 6,
-            ) );
+            vertex_idx += 3;
+            context.index_end += 3;
         }
+    }
 
-        // draw tris
-        for ( uint32_t i = 0; i < workload->tri_count; ++i ) {
-            const xi_draw_tri_t* tri = &workload->tri_array[i];
-
-            // TODO
-            xi_scissor_h scissor_handle = tri->scissor;
-            //if ( scissor_handle != active_scissor ) 
-            {
-                xg_scissor_state_t scissor = xg_scissor_state_m();
-
-                if ( scissor_handle != xi_null_scissor_m ) {
-                    xi_scissor_t* xi_scissor = &workload->scissor_array[scissor_handle];
-                    scissor.x = xi_scissor->x;
-                    scissor.y = xi_scissor->y;
-                    scissor.width = xi_scissor->width;
-                    scissor.height = xi_scissor->height;
-                }
-
-                xg->cmd_set_dynamic_scissor ( flush_params->cmd_buffer, key + tri->sort_order, &scissor );
-                active_scissor = scissor_handle;
-            }
-
-            xg_resource_bindings_layout_h layout = xg->get_pipeline_resource_layout ( pipeline_state, xg_shader_binding_set_dispatch_m );
-
-            xg_resource_bindings_h group = xg->cmd_create_workload_bindings ( flush_params->resource_cmd_buffer, &xg_resource_bindings_params_m (
-                .layout = layout,
-                .bindings = xg_pipeline_resource_bindings_m (
-                    .texture_count = 1,
-                    .textures = { 
-                        xg_texture_resource_binding_m (
-                            .shader_register = 0,
-                            .layout = xg_texture_layout_shader_read_m,
-                            .texture = tri->texture != xg_null_handle_m ? tri->texture : null_texture,
-                        ),
-                    },
-                    .sampler_count = 1,
-                    .samplers = {
-                        xg_sampler_resource_binding_m (
-                            .shader_register = 1,
-                            .sampler = tri->linear_sampler_filter ? linear_sampler : point_sampler,
-                        ),
-                    },
-                ),
-            ) );
-
-            xg->cmd_draw ( flush_params->cmd_buffer, key + tri->sort_order, &xg_cmd_draw_params_m ( 
-                .pipeline = pipeline_state,
-                .bindings[xg_shader_binding_set_dispatch_m] = group,
-                .primitive_count = 1,
-                .vertex_buffers_count = 1,
-                .vertex_buffers = { workload->vertex_buffer },
-                .vertex_offset = tri_base + i * 3,
-            ) );
-
-        }
+    xi_workload_flush_draw ( &context );
 
-        // delete buffer
-        xg->cmd_destroy_buffer ( flush_params->resource_cmd_buffer, vertex_buffer_handle, xg_resource_cmd_buffer_time_workload_complete_m );
-    }
+    stats->vertex_count = vertex_idx;
+    stats->index_count = context.index_end;
 
     // queue up the workload
     xg->cmd_end_renderpass ( flush_params->cmd_buffer, key + max_sort_order );
 
-    std_mem_zero_m ( workload );
+    // Counts are reset on create, no need to clear the whole thing
     std_list_push ( &xi_workload_state->workloads_freelist, workload );
 
+    stats->cpu_ms = std_tick_to_milli_f32 ( std_tick_now() - start_tick );
+
     return key + max_sort_order;
 }
+
+void xi_workload_get_flush_stats ( xi_flush_stats_t* stats ) {
+    *stats = xi_workload_state->flush_stats;
+}
@@ -12,6 +12,18 @@ typedef struct {
     uint32_t height;
 } xi_scissor_t;
 
+// How the texture of a rect is combined with its color
+typedef enum {
+    // sampled as is and multiplied by the color
+    xi_draw_texture_color_m,
+    // single channel coverage, multiplies the color alpha
+    xi_draw_texture_coverage_m,
+    // single channel signed distance, 0.5 on the edge. Meant to be sampled with the linear filter.
+    xi_draw_texture_sdf_m,
+    // same as sdf, with a black outline around the edge
+    xi_draw_texture_sdf_outline_m,
+} xi_draw_texture_mode_e;
+
 typedef struct {
     float x;
     float y;
@@ -19,6 +31,7 @@ typedef struct {
     float height;
     xi_color_t color;
     xg_texture_h texture;
+    xi_draw_texture_mode_e texture_mode;
     bool linear_sampler_filter;
     float uv0[2]; // top left
     float uv1[2]; // bottom right
@@ -33,6 +46,7 @@ typedef struct {
     .height = 0, \
     .color = xi_color_black_m, \
     .texture = xg_null_handle_m, \
+    .texture_mode = xi_draw_texture_color_m, \
     .linear_sampler_filter = false, \
     .uv0 = { 0, 0 }, \
     .uv1 = { 0, 0 }, \
@@ -68,12 +82,19 @@ typedef struct {
     .sort_order = 0, \
 }
 
+// Indexed, 4 vertices and 6 indices per rect
 typedef struct {
     float pos[2];
     float uv[2];
-    float color[4];
+    xi_color_t color;
+    // Texture slot in the draw bindings in the low byte, set xi_workload_vertex_linear_filter_bit_m to use the linear
+    // sampler instead of the point one. The xi_draw_texture_mode_e goes in the bits above.
+    uint32_t tex;
 } xi_workload_vertex_t;
 
+#define xi_workload_vertex_linear_filter_bit_m ( 1 << 8 )
+#define xi_workload_vertex_texture_mode_shift_m 9
+
 typedef struct {
     xg_buffer_h pos_buffer;
     xg_buffer_h nor_buffer;
@@ -105,19 +126,32 @@ typedef struct {
     ##__VA_ARGS__ \
 }
 
+typedef enum {
+    xi_workload_cmd_rect_m,
+    xi_workload_cmd_tri_m,
+    xi_workload_cmd_mesh_m,
+} xi_workload_cmd_e;
+
+// All draws go through a single list, flush sorts it by sort order. Items with equal sort order are drawn in the
+// order they were recorded in.
+typedef struct {
+    uint64_t sort_order;
+    xi_workload_cmd_e type;
+    uint32_t idx;
+} xi_workload_cmd_t;
+
 typedef struct {
     xi_draw_rect_t rect_array[xi_workload_max_rects_m];
     uint64_t rect_count;
     xi_draw_tri_t tri_array[xi_workload_max_tris_m];
     uint64_t tri_count;
 
-    xi_workload_vertex_t vertex_buffer_data[xi_workload_max_rects_m * 6 + xi_workload_max_tris_m * 3];
-    xg_buffer_h vertex_buffer;
-    // TODO index buffer
-
     xi_draw_mesh_t mesh_array[xi_workload_max_meshes_m];
     uint32_t mesh_count;
 
+    xi_workload_cmd_t cmd_array[xi_workload_max_rects_m + xi_workload_max_tris_m + xi_workload_max_meshes_m];
+    uint32_t cmd_count;
+
     float proj_from_world[16];
 
     xi_scissor_t scissor_array[xi_workload_max_scissors_m];
@@ -126,10 +160,22 @@ typedef struct {
     xg_workload_h xg_workload;
 } xi_workload_t;
 
+#define xi_workload_segment_vertex_count_m ( xi_workload_max_rects_m * 4 + xi_workload_max_tris_m * 3 )
+#define xi_workload_segment_index_count_m ( xi_workload_max_rects_m * 6 + xi_workload_max_tris_m * 3 )
+
+// UI geometry is written straight into a mapped buffer that stays alive for as long as the device does. The buffer
+// is split into xi_workload_max_submitted_workloads_m segments, each one big enough for a full xi workload, and the
+// segments are used in a ring. Flushes into the same xg workload share a segment as long as there's room left.
+// Vertices for all segments come first, indices after.
 typedef struct {
-    xg_buffer_h vertex_buffer;
+    xg_device_h device;
+    xg_buffer_h buffer;
+    char* mapped_address;
+    xg_workload_h segment_workloads[xi_workload_max_submitted_workloads_m];
+    uint32_t segment_idx;
+    uint32_t segment_vertex_count;
+    uint32_t segment_index_count;
 } xi_workload_device_context_t;
-
 typedef struct {
     xg_renderpass_h xg_handle;
     uint32_t resolution_x;
@@ -157,6 +203,8 @@ typedef struct {
     xi_workload_renderpass_t ui_renderpass_rgba8;
     xi_workload_renderpass_t ui_renderpass_bgra8;
     xi_workload_renderpass_t ui_renderpass_a2bgr10;
+
+    xi_flush_stats_t flush_stats;
 } xi_workload_state_t;
 
 void xi_workload_load ( xi_workload_state_t* state );
@@ -170,6 +218,7 @@ void xi_workload_cmd_draw ( xi_workload_h workload, const xi_draw_rect_t* rects,
 void xi_workload_cmd_draw_tri ( xi_workload_h workload, const xi_draw_tri_t* tris, uint64_t tri_count );
 void xi_workload_cmd_draw_mesh ( xi_workload_h workload, const xi_draw_mesh_t* mesh );
 uint64_t xi_workload_flush ( xi_workload_h workload, const xi_flush_params_t* params );
+void xi_workload_get_flush_stats ( xi_flush_stats_t* stats );
 
 xi_scissor_h xi_workload_scissor ( xi_workload_h workload, uint32_t x, uint32_t y, uint32_t width, uint32_t height );
 
@@ -444,14 +444,25 @@ typedef struct {
 
 // Font
 
+typedef enum {
+    // Glyphs are rasterised at the font pixel height
+    xi_font_render_mode_bitmap_m,
+    // Glyphs are rasterised once as signed distance fields and scaled to the font pixel height. Fonts created from the
+    // same ttf data share them, whatever their pixel height.
+    xi_font_render_mode_sdf_m,
+} xi_font_render_mode_e;
+
 typedef struct {
     xg_device_h xg_device;
     // TODO support dynamic viewport in xg, then use these
     //uint64_t atlas_width;
     //uint64_t atlas_height;
     uint64_t pixel_height;
+    // Glyphs are rasterised into the shared atlas on first use, the ones in this range are rasterised upfront
     uint32_t first_char_code;
     uint32_t char_count;
+    xi_font_render_mode_e render_mode;
+    // Outlines are drawn from the distance field, setting this implies xi_font_render_mode_sdf_m
     bool outline;
     char debug_name[xi_debug_name_size_m];
 } xi_font_params_t;
@@ -463,12 +474,21 @@ typedef struct {
     .xg_device = xg_null_handle_m, \
     .pixel_height = 0, \
     .first_char_code = xi_font_char_ascii_base_m, \
-    .char_count = xi_font_char_ascii_count_m, \
+    .char_count = 0, \
+    .render_mode = xi_font_render_mode_bitmap_m, \
     .outline = false, \
     .debug_name = "", \
     ##__VA_ARGS__ \
 }
 
+typedef struct {
+    uint32_t page_count;
+    uint32_t glyph_count;
+    // every page has a gpu texture and a cpu copy of the same size
+    uint64_t texture_size;
+    uint64_t cpu_size;
+} xi_font_atlas_stats_t;
+
 // Update
 
 typedef struct {
@@ -505,6 +525,27 @@ typedef struct {
     xg_render_target_binding_t render_target_binding;
 } xi_flush_params_t;
 
+// Filled by each flush, get_flush_stats returns the ones from the last one
+typedef struct {
+    uint32_t cmd_count;
+    uint32_t draw_count;
+    uint32_t bindings_count;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    float cpu_ms;
+} xi_flush_stats_t;
+
+// Counted from begin_update to end_update, get_ui_stats returns the ones from the last update
+typedef struct {
+    uint32_t window_count;
+    // windows that reused their cached geometry
+    uint32_t window_cache_hits;
+    uint32_t text_measure_count;
+    uint32_t text_measure_hits;
+    // time spent between begin_update and end_update
+    float cpu_ms;
+} xi_ui_stats_t;
+
 typedef struct {
     xg_texture_h handle;
     uint32_t x;
@@ -531,18 +572,26 @@ typedef struct {
     uint64_t ( *get_active_element_id ) ( void );
     uint64_t ( *get_hovered_element_id ) ( void );
 
+    // Fonts are main thread only, like the ui calls that rasterise their glyphs on demand
     xi_font_h ( *create_font ) ( std_buffer_t ttf_data, const xi_font_params_t* params );
     void ( *destroy_font ) ( xi_font_h font );
+    void ( *get_font_atlas_stats ) ( xi_font_atlas_stats_t* stats );
 
     void ( *set_workload_view_info ) ( xg_workload_h workload, const rv_view_info_t* view_info ); // TODO remove!
 
     xi_workload_h ( *create_workload ) ( void );
     uint64_t ( *flush_workload ) ( xi_workload_h workload, const xi_flush_params_t* params );
+    void ( *get_flush_stats ) ( xi_flush_stats_t* stats );
     // Add api to get oldest non-flushed workload? can avoid having to keep track of created workloads on client side
     // Auto flush all pending workloads on end_frame/end_update?
 
     void ( *end_update ) ( void );
 
+    void ( *get_ui_stats ) ( xi_ui_stats_t* stats );
+    // Window geometry and text measure caching are on by default. Turning them off is meant for profiling, only
+    // between updates.
+    void ( *set_ui_cache_enabled ) ( bool enabled );
+
     void ( *newline ) ( void );
 
     void ( *set_style )     ( xi_style_t* style );
@@ -4,10 +4,20 @@
 
 layout ( location = 0 ) in vec4 in_color;
 layout ( location = 1 ) in vec2 in_uv;
+layout ( location = 2 ) flat in uint in_tex;
 
-layout ( set = xs_shader_binding_set_dispatch_m, binding = 0 ) uniform texture2D tex_color;
+// Keep in sync with xi_workload_max_draw_textures_m
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 0 ) uniform texture2D tex_0;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 1 ) uniform texture2D tex_1;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 2 ) uniform texture2D tex_2;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 3 ) uniform texture2D tex_3;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 4 ) uniform texture2D tex_4;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 5 ) uniform texture2D tex_5;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 6 ) uniform texture2D tex_6;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 7 ) uniform texture2D tex_7;
 
-layout ( set = xs_shader_binding_set_dispatch_m, binding = 1 ) uniform sampler tex_sampler;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 8 ) uniform sampler point_sampler;
+layout ( set = xs_shader_binding_set_dispatch_m, binding = 9 ) uniform sampler linear_sampler;
 
 layout ( location = 0 ) out vec4 out_color;
 
@@ -15,9 +25,56 @@ vec3 linear_to_srgb ( vec3 color ) {
     return pow ( color, vec3 ( 1.0 / 2.2 ) );
 }
 
+// in_tex is constant over a primitive but not over a pixel quad, gradients are taken outside of the branches
+vec4 sample_tex ( texture2D tex, vec2 uv_dx, vec2 uv_dy ) {
+    if ( ( in_tex & 0x100u ) != 0u ) {
+        return textureGrad ( sampler2D ( tex, linear_sampler ), in_uv, uv_dx, uv_dy );
+    } else {
+        return textureGrad ( sampler2D ( tex, point_sampler ), in_uv, uv_dx, uv_dy );
+    }
+}
+
 void main() {
-    vec4 tex = texture ( sampler2D ( tex_color, tex_sampler ), in_uv ).xyzw;
-    vec4 color = in_color * tex;
+    vec2 uv_dx = dFdx ( in_uv );
+    vec2 uv_dy = dFdy ( in_uv );
+
+    vec4 tex;
+    switch ( int ( in_tex & 0xffu ) ) {
+        case 0: tex = sample_tex ( tex_0, uv_dx, uv_dy ); break;
+        case 1: tex = sample_tex ( tex_1, uv_dx, uv_dy ); break;
+        case 2: tex = sample_tex ( tex_2, uv_dx, uv_dy ); break;
+        case 3: tex = sample_tex ( tex_3, uv_dx, uv_dy ); break;
+        case 4: tex = sample_tex ( tex_4, uv_dx, uv_dy ); break;
+        case 5: tex = sample_tex ( tex_5, uv_dx, uv_dy ); break;
+        case 6: tex = sample_tex ( tex_6, uv_dx, uv_dy ); break;
+        default: tex = sample_tex ( tex_7, uv_dx, uv_dy ); break;
+    }
+
+    // Glyphs, see xi_draw_texture_mode_e. The distance derivative is taken here, before branching on the mode.
+    float dist = tex.r;
+    float dist_aa = max ( fwidth ( dist ) * 0.7, 1e-4 );
+
+    vec4 color;
+    switch ( int ( ( in_tex >> 9u ) & 0x3u ) ) {
+        case 1:
+            color = vec4 ( in_color.rgb, in_color.a * tex.r );
+            break;
+        case 2:
+            color = vec4 ( in_color.rgb, in_color.a * smoothstep ( 0.5 - dist_aa, 0.5 + dist_aa, dist ) );
+            break;
+        case 3: {
+            // 1.5 pixels at the glyph raster size, keep in sync with xi_font_sdf_padding_m
+            const float outline = 0.19;
+            float fill = smoothstep ( 0.5 - dist_aa, 0.5 + dist_aa, dist );
+            float edge = smoothstep ( 0.5 - outline - dist_aa, 0.5 - outline + dist_aa, dist );
+            color = vec4 ( in_color.rgb * fill, in_color.a * edge );
+            break;
+        }
+        default:
+            color = in_color * tex;
+            break;
+    }
+
     // TODO do this in a final full screen pass, otherwise alpha blended UI is broken
     color.rgb = linear_to_srgb ( color.rgb );
     out_color = color;
@@ -8,9 +8,11 @@ static void xs_api_init ( xs_i* xs ) {
     xs->destroy_database = xs_database_destroy;
     xs->add_database_folder = xs_database_add_folder;
     xs->set_output_folder = xs_database_set_output_folder;
+    xs->set_cache_folder = xs_database_set_cache_folder;
     xs->set_build_params = xs_database_set_build_params;
     xs->clear_database = xs_database_clear;
     xs->build_database = xs_database_build;
+    xs->build_database_async = xs_database_build_async;
     xs->rebuild_databases = xs_database_rebuild_all;
     xs->get_database_pipeline = xs_database_pipeline_get;
     xs->get_pipeline_state = xs_database_pipeline_state_get;
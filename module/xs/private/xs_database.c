@@ -10,6 +10,9 @@
 #include <std_string.h>
 #include <std_log.h>
 #include <std_file.h>
+#include <std_hash.h>
+#include <std_platform.h>
+#include <std_atomic.h>
 
 static xs_database_state_t* xs_database_state;
 
@@ -60,6 +63,48 @@ void xs_database_unload ( void ) {
     std_virtual_heap_free ( xs_database_state->database_array );
 }
 
+/*
+    Background builds
+
+    build_async runs the whole build on a separate thread, which spawns a few more to create the pipeline states in
+    parallel. Built pipelines are stored as pending on each pipeline state and rendering keeps using the current ones.
+    update_pipelines publishes all pending pipelines of a database at once as soon as its build is done and the
+    pipelines replaced by the previous publish have been retired. Since update_pipelines is called once per frame,
+    after the frame workload submit, each frame sees either the full old set or the full new set.
+    Anything that edits the database waits for the build thread first.
+*/
+
+static void xs_database_wait_build ( xs_database_t* db ) {
+    if ( db->build_thread != std_thread_null_handle_m ) {
+        std_thread_join ( db->build_thread );
+        db->build_thread = std_thread_null_handle_m;
+    }
+}
+
+static void xs_database_destroy_pipeline ( xg_pipeline_e type, xg_pipeline_state_h pipeline_handle, const xg_resource_bindings_layout_h* resource_layouts ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
+
+    if ( pipeline_handle != xg_null_handle_m ) {
+        switch ( type ) {
+        case xg_pipeline_graphics_m:
+            xg->destroy_graphics_pipeline ( pipeline_handle );
+            break;
+        case xg_pipeline_compute_m:
+            xg->destroy_compute_pipeline ( pipeline_handle );
+            break;
+        case xg_pipeline_raytrace_m:
+            xg->destroy_raytrace_pipeline ( pipeline_handle );
+            break;
+        }
+    }
+
+    for ( uint32_t i = 0; i < xg_shader_binding_set_count_m; ++i ) {
+        if ( resource_layouts[i] != xg_null_handle_m ) {
+            xg->destroy_resource_layout ( resource_layouts[i] );
+        }
+    }
+}
+
 static char* xs_database_alloc_string ( xs_database_t* db, size_t size ) {
 #if 0
     xs_database_memory_page_t* memory_page = NULL;
@@ -104,7 +149,6 @@ static void xs_database_folder_iterator ( const char* name, std_path_flags_t fla
     xs_database_folder_iterator_params_t* params = ( xs_database_folder_iterator_params_t* ) arg;
 
     size_t path_len = std_path_append ( params->base, std_path_size_m, name );
-    bool is_header = false;
     xg_pipeline_e type;
     {
         size_t extension_base = std_str_find_reverse ( params->base, path_len, "." );
@@ -123,8 +167,6 @@ static void xs_database_folder_iterator ( const char* name, std_path_flags_t fla
         } else if ( std_str_cmp ( params->base + extension_base, ".xsr" ) == 0 ) {
             type = xg_pipeline_raytrace_m;
 #endif
-        } else if ( std_str_cmp ( params->base + extension_base, ".glsl" ) == 0 ) {
-            is_header = true;
         } else {
             std_path_pop ( params->base );
             return;
@@ -134,36 +176,41 @@ static void xs_database_folder_iterator ( const char* name, std_path_flags_t fla
     char* dest = xs_database_alloc_string ( params->db, path_len + 1 );
     std_str_copy ( dest, path_len + 1, params->base );
 
-    if ( is_header ) {
-        xs_database_pipeline_state_header_t* header = &params->db->pipeline_state_headers_array[params->db->pipeline_state_headers_count++];
-        header->path = dest;
-    } else {
-        xs_database_pipeline_state_t* pipeline_state = &params->db->pipeline_states[params->db->pipeline_states_count++];
-        pipeline_state->path = dest;
-        pipeline_state->name = std_path_name_ptr ( dest ); // TODO alloc separate string and remove .xss ext?
-        pipeline_state->type = type;
-        pipeline_state->pipeline_handle = xg_null_handle_m;
-        pipeline_state->old_pipeline_handle = xg_null_handle_m;
-        pipeline_state->old_pipeline_workload = xg_null_handle_m;
-        pipeline_state->last_build_timestamp = std_timestamp_zero_m;
+    xs_database_pipeline_state_t* pipeline_state = &params->db->pipeline_states[params->db->pipeline_states_count++];
+    pipeline_state->path = dest;
+    pipeline_state->name = std_path_name_ptr ( dest ); // TODO alloc separate string and remove .xss ext?
+    pipeline_state->type = type;
+    pipeline_state->pipeline_handle = xg_null_handle_m;
+    pipeline_state->has_pending_pipeline = false;
+    pipeline_state->pending_pipeline_handle = xg_null_handle_m;
+    pipeline_state->has_old_pipeline = false;
+    pipeline_state->old_pipeline_handle = xg_null_handle_m;
+    pipeline_state->old_pipeline_workload = xg_null_handle_m;
+    pipeline_state->build_hash = 0;
+
+    for ( uint32_t i = 0; i < xg_shader_binding_set_count_m; ++i ) {
+        pipeline_state->resource_layouts[i] = xg_null_handle_m;
+        pipeline_state->pending_resource_layouts[i] = xg_null_handle_m;
+        pipeline_state->old_resource_layouts[i] = xg_null_handle_m;
+    }
 
-        size_t name_len = std_str_len ( pipeline_state->name );
-        name_len = std_str_find_reverse ( pipeline_state->name, name_len, "." );
-        std_assert_m ( name_len != std_str_find_null_m );
-        xs_string_hash_t hash = xs_hash_string_m ( pipeline_state->name, name_len );
+    size_t name_len = std_str_len ( pipeline_state->name );
+    name_len = std_str_find_reverse ( pipeline_state->name, name_len, "." );
+    std_assert_m ( name_len != std_str_find_null_m );
+    xs_string_hash_t hash = xs_hash_string_m ( pipeline_state->name, name_len );
 
-        pipeline_state->name_hash = hash;
+    pipeline_state->name_hash = hash;
 
-        // TODO insert here when the shader is built
-        bool unique = std_hash_map_insert ( &params->db->pipeline_name_hash_to_state_map, hash, ( uint64_t ) pipeline_state );
-        std_assert_m ( unique );
-    }
+    // TODO insert here when the shader is built
+    bool unique = std_hash_map_insert ( &params->db->pipeline_name_hash_to_state_map, hash, ( uint64_t ) pipeline_state );
+    std_assert_m ( unique );
 
     std_path_pop ( params->base );
 }
 
 bool xs_database_add_folder ( xs_database_h db_handle, const char* input_path ) {
     xs_database_t* db = &xs_database_state->database_array[db_handle];
+    xs_database_wait_build ( db );
 
     char path[std_path_size_m] = { 0 };
     size_t path_len = std_path_absolute ( path, std_path_size_m, input_path );
@@ -184,6 +231,7 @@ bool xs_database_add_folder ( xs_database_h db_handle, const char* input_path )
 
 bool xs_database_set_output_folder ( xs_database_h db_handle, const char* input_path ) {
     xs_database_t* db = &xs_database_state->database_array[db_handle];
+    xs_database_wait_build ( db );
 
     std_path_info_t info;
     bool result = std_path_info ( &info, input_path );
@@ -201,6 +249,26 @@ bool xs_database_set_output_folder ( xs_database_h db_handle, const char* input_
     return result;
 }
 
+bool xs_database_set_cache_folder ( xs_database_h db_handle, const char* input_path ) {
+    xs_database_t* db = &xs_database_state->database_array[db_handle];
+    xs_database_wait_build ( db );
+
+    std_path_info_t info;
+    bool result = std_path_info ( &info, input_path );
+    result &= info.flags & std_path_is_directory_m;
+
+    if ( !result ) {
+        result = std_directory_create ( input_path );
+    }
+
+    char path[std_path_size_m] = { 0 };
+    std_path_absolute ( path, std_path_size_m, input_path );
+
+    std_str_copy ( db->cache_path, std_path_size_m, path );
+
+    return result;
+}
+
 void xs_database_clear ( xs_database_h db_handle ) {
 #if 0
     for ( size_t i = 0; i < xs_database_max_memory_pages_m; ++i ) {
@@ -217,7 +285,8 @@ void xs_database_clear ( xs_database_h db_handle ) {
 #endif
     // TODO is this ever used? missing some stuff?
     xs_database_t* db = &xs_database_state->database_array[db_handle];
-    
+    xs_database_wait_build ( db );
+
     std_virtual_stack_clear ( &db->stack );
 
     db->folders_count = 0;
@@ -226,6 +295,7 @@ void xs_database_clear ( xs_database_h db_handle ) {
 
 void xs_database_set_build_params ( xs_database_h db_handle, const xs_database_build_params_t* params ) {
     xs_database_t* db = &xs_database_state->database_array[db_handle];
+    xs_database_wait_build ( db );
 
     if ( params->base_graphics_state ) {
         db->base_graphics_state = *params->base_graphics_state;
@@ -251,7 +321,7 @@ void xs_database_rebuild_all ( void ) {
     uint64_t db_idx = 0;
     while ( std_bitset_scan ( &db_idx, xs_database_state->database_bitset, db_idx, xs_database_bitset_u64_count_m ) ) {
         xs_database_h db_handle = db_idx;
-        xs_database_build ( db_handle );
+        xs_database_build_async ( db_handle );
         ++db_idx;
     }
 }
@@ -268,115 +338,525 @@ static void xs_database_set_pipeline_state_shader ( xg_pipeline_state_shader_t*
     shader->buffer = bytecode->buffer;
 }
 
-xs_database_build_result_t xs_database_build ( xs_database_h db_handle ) {
-    xs_database_t* db = &xs_database_state->database_array[db_handle];
+/*
+    Shader cache
 
-    xs_database_build_result_t result = xs_database_build_result_m();
+    Compiled shaders are stored in the cache folder (the output folder unless set otherwise) under a key made of the
+    shader stage, the compiler options hash (compiler version, target env, optimization level, definitions) and the
+    content of the shader source and of every file it transitively #includes. File timestamps and paths are never part
+    of the key, so branch switches, fresh checkouts and copies of the tree keep hitting the cache as long as the content
+    is the same, and multiple databases can share a cache folder. Entries are never evicted.
 
-    xg_i* xg = std_module_get_m ( xg_module_name_m );
+    Every compiled shader also gets a .dep file written next to its cache entry, listing the shader source followed by
+    every file it transitively includes, one absolute path per line.
+*/
+
+static void xs_database_shader_dependencies_path ( char* dep_path, size_t cap, const char* binary_path ) {
+    std_str_copy ( dep_path, cap, binary_path );
+    size_t len = std_str_len ( dep_path );
+    size_t ext = std_str_find_reverse ( dep_path, len, "." );
+
+    if ( ext != std_str_find_null_m ) {
+        dep_path[ext] = '\0';
+    }
+
+    std_stack_t stack = std_stack ( dep_path, cap );
+    stack.top = stack.begin + std_str_len ( dep_path ) + 1;
+    std_stack_string_append ( &stack, ".dep" );
+}
+
+static bool xs_database_resolve_include ( char* dest, const char* includer_path, const char* name, bool is_system ) {
+    char path[std_path_size_m];
+    std_file_info_t info;
+
+    // "" includes are first looked up relative to the including file, then fall back to the include path like <> includes
+    if ( !is_system ) {
+        std_str_copy ( path, std_path_size_m, includer_path );
+        std_path_pop ( path );
+        std_path_append ( path, std_path_size_m, name );
+
+        if ( std_file_path_info ( &info, path ) ) {
+            std_path_absolute ( dest, std_path_size_m, path );
+            return true;
+        }
+    }
+
+    std_str_copy ( path, std_path_size_m, xs_shader_compiler_include_path_m );
+    std_path_append ( path, std_path_size_m, name );
+
+    if ( std_file_path_info ( &info, path ) ) {
+        std_path_absolute ( dest, std_path_size_m, path );
+        return true;
+    }
+
+    return false;
+}
+
+// Fills deps with the newline separated list of the shader source path and all of its transitive includes.
+// The list itself is used as the work queue: each line is scanned in order and new includes get appended to it.
+// Returns a hash of the content of all the files in the list.
+static uint64_t xs_database_scan_shader_dependencies ( std_virtual_stack_t* deps, const char* shader_path ) {
+    uint64_t hashes[xs_database_max_shader_dependencies_m];
+    uint64_t content_hashes[xs_database_max_shader_dependencies_m];
+    uint32_t count = 0;
+    uint32_t content_count = 0;
+
+    char path[std_path_size_m];
+    char include_path[std_path_size_m];
+
+    std_path_absolute ( path, std_path_size_m, shader_path );
+    std_virtual_stack_clear ( deps );
+    std_virtual_stack_string_copy ( deps, path );
+    hashes[count++] = std_hash_string_64_m ( path );
+
+    size_t cursor = 0;
+
+    // -1 to skip the string terminator
+    while ( cursor < std_virtual_stack_used_size ( deps ) - 1 ) {
+        const char* list = ( const char* ) deps->begin;
+        size_t line_len = 0;
+
+        while ( list[cursor + line_len] != '\n' && list[cursor + line_len] != '\0' ) {
+            ++line_len;
+        }
+
+        std_mem_copy ( path, list + cursor, line_len );
+        path[line_len] = '\0';
+        cursor += line_len + 1;
+
+        std_buffer_t source = std_file_read_to_virtual_heap ( path );
+
+        if ( source.base == NULL ) {
+            content_hashes[content_count++] = 0;
+            continue;
+        }
+
+        content_hashes[content_count++] = std_hash_block_64_m ( source.base, source.size );
+
+        const char* text = ( const char* ) source.base;
+        size_t size = source.size;
+        size_t i = 0;
+
+        while ( i < size ) {
+            while ( i < size && ( text[i] == ' ' || text[i] == '\t' ) ) {
+                ++i;
+            }
+
+            bool is_include = false;
+
+            if ( i < size && text[i] == '#' ) {
+                ++i;
+
+                while ( i < size && ( text[i] == ' ' || text[i] == '\t' ) ) {
+                    ++i;
+                }
+
+                is_include = i + 7 <= size && std_mem_cmp ( text + i, "include", 7 );
+            }
+
+            if ( is_include ) {
+                i += 7;
+
+                while ( i < size && ( text[i] == ' ' || text[i] == '\t' ) ) {
+                    ++i;
+                }
+
+                char close = '\0';
+
+                if ( i < size && text[i] == '"' ) {
+                    close = '"';
+                } else if ( i < size && text[i] == '<' ) {
+                    close = '>';
+                }
 
+                if ( close != '\0' ) {
+                    size_t name_begin = ++i;
+
+                    while ( i < size && text[i] != close && text[i] != '\n' ) {
+                        ++i;
+                    }
+
+                    size_t name_len = i - name_begin;
+
+                    if ( i < size && text[i] == close && name_len > 0 && name_len < std_path_size_m ) {
+                        char name[std_path_size_m];
+                        std_mem_copy ( name, text + name_begin, name_len );
+                        name[name_len] = '\0';
+
+                        if ( xs_database_resolve_include ( include_path, path, name, close == '>' ) ) {
+                            uint64_t hash = std_hash_string_64_m ( include_path );
+                            bool found = false;
+
+                            for ( uint32_t j = 0; j < count && !found; ++j ) {
+                                found = hashes[j] == hash;
+                            }
+
+                            if ( !found && count < xs_database_max_shader_dependencies_m ) {
+                                hashes[count++] = hash;
+                                std_virtual_stack_string_append ( deps, "\n" );
+                                std_virtual_stack_string_append ( deps, include_path );
+                            } else if ( !found ) {
+                                std_log_warn_m ( "Too many dependencies for shader " std_fmt_str_m ", " std_fmt_str_m " will not be tracked", shader_path, include_path );
+                            }
+                        }
+                    }
+                }
+            }
+
+            while ( i < size && text[i] != '\n' ) {
+                ++i;
+            }
+
+            ++i;
+        }
+
+        std_virtual_heap_free ( source.base );
+    }
+
+    return std_hash_block_64_m ( content_hashes, sizeof ( uint64_t ) * content_count );
+}
+
+static void xs_database_write_shader_dependencies ( const std_virtual_stack_t* deps, const char* binary_path ) {
+    char dep_path[std_path_size_m];
+    xs_database_shader_dependencies_path ( dep_path, std_path_size_m, binary_path );
+
+    std_file_h file = std_file_create ( dep_path, std_file_write_m, std_path_already_existing_overwrite_m );
+
+    if ( file == std_file_null_handle_m ) {
+        std_log_warn_m ( "Failed to write shader dependencies file " std_fmt_str_m, dep_path );
+        return;
+    }
+
+    std_file_write ( file, deps->begin, std_virtual_stack_used_size ( deps ) - 1 );
+    std_file_close ( file );
+}
+
+static void xs_database_pipeline_paths ( char* input_path, char* output_path, const xs_database_t* db, const xs_database_pipeline_state_t* pipeline_state ) {
+    std_str_copy ( input_path, std_path_size_m, pipeline_state->path );
+    std_path_pop ( input_path );
+
+    if ( db->cache_path[0] ) {
+        std_str_copy ( output_path, std_path_size_m, db->cache_path );
+    } else if ( db->output_path[0] ) {
+        std_str_copy ( output_path, std_path_size_m, db->output_path );
+    } else {
+        std_str_copy ( output_path, std_path_size_m, input_path );
+    }
+}
+
+static void xs_database_shader_paths ( char* shader_path, char* binary_path, const char* input_path, const char* output_path, const xs_parser_shader_reference_t* shader, uint64_t key ) {
+    // prepare shader code input path
+    std_str_copy ( shader_path, std_path_size_m, input_path );
+    std_path_append ( shader_path, std_path_size_m, shader->name );
+
+    // prepare shader bytecode output path
+    std_str_copy ( binary_path, std_path_size_m, output_path );
+    std_path_append ( binary_path, std_path_size_m, shader->name );
+    size_t len = std_str_len ( binary_path );
+    size_t len2 = std_str_find_reverse ( binary_path, len, "." );
+
+    if ( len2 != std_str_find_null_m ) {
+        len = len2;
+    }
+
+    std_stack_t stack = std_stack ( binary_path, std_path_size_m );
+    stack.top = stack.begin + len + 1;
+
+    const char* stage_tag = "";
+
+    xg_shading_stage_e stage = shader->stage;
+    if ( stage == xg_shading_stage_vertex_m ) {
+        stage_tag = "vs";
+    } else if ( stage == xg_shading_stage_fragment_m ) {
+        stage_tag = "fs";
+    } else if ( stage == xg_shading_stage_compute_m ) {
+        stage_tag = "cs";
+    } else if ( stage == xg_shading_stage_ray_gen_m ) {
+        stage_tag = "rg";
+    } else if ( stage == xg_shading_stage_ray_miss_m ) {
+        stage_tag = "rm";
+    } else if ( stage == xg_shading_stage_ray_hit_closest_m ) {
+        stage_tag = "rhc";
+    }
+
+    std_stack_string_append ( &stack, "-" );
+    std_stack_string_append ( &stack, stage_tag );
+    std_stack_string_append_format ( &stack, "-%016" PRIx64 ".spv", key );
+}
+
+static uint64_t xs_database_shader_key ( uint64_t options_hash, uint64_t content_hash, xg_shading_stage_e stage ) {
+    uint64_t key[3] = { options_hash, content_hash, ( uint64_t ) stage };
+    return std_hash_block_64_m ( key, sizeof ( key ) );
+}
+
+typedef union {
+    xs_parser_graphics_pipeline_state_t graphics;
+    xs_parser_compute_pipeline_state_t compute;
+    xs_parser_raytrace_pipeline_state_t raytrace;
+} xs_database_parsed_pipeline_state_t;
+
+typedef struct {
+    xs_database_pipeline_state_t* pipeline_state;
+    xs_database_parsed_pipeline_state_t parsed;
+    xs_parser_shader_references_t* shader_references;
+    xs_parser_shader_definitions_t* shader_definitions;
+    xg_resource_bindings_layout_params_t* resource_layouts;
+    uint64_t shader_keys[xs_shader_parser_max_shader_references_m];
+    uint64_t build_hash;
+    bool needs_to_build;
+    uint32_t compile_count;
+    uint32_t failed_count;
+    // pipeline creation output
+    bool is_built;
+    xg_pipeline_state_h pipeline_handle;
+    xg_resource_bindings_layout_h resource_layout_handles[xg_shader_binding_set_count_m];
+} xs_database_build_pipeline_t;
+
+typedef struct {
+    xs_database_build_pipeline_t* pipeline;
+    uint32_t shader_idx;
+    uint64_t key;
+} xs_database_build_compile_t;
+
+static void xs_database_create_pipeline ( xs_database_t* db, xs_database_build_pipeline_t* pipeline ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
     const bool verbose = false;
+
+    xs_database_pipeline_state_t* pipeline_state = pipeline->pipeline_state;
+    xs_parser_shader_references_t* shader_references = pipeline->shader_references;
+    xg_resource_bindings_layout_params_t* resource_layouts = pipeline->resource_layouts;
+
+    char input_path[std_path_size_m];
+    char output_path[std_path_size_m];
+    char shader_path[std_path_size_m];
+    char binary_path[std_path_size_m];
+
+    xs_parser_graphics_pipeline_state_t* graphics_state = &pipeline->parsed.graphics;
+    xs_parser_compute_pipeline_state_t* compute_state = &pipeline->parsed.compute;
+    xs_parser_raytrace_pipeline_state_t* raytrace_state = &pipeline->parsed.raytrace;
+
+    xs_database_pipeline_paths ( input_path, output_path, db, pipeline_state );
+
+    // read generated shader bytecode
+    shader_bytecode_t shader_bytecode[xs_shader_parser_max_shader_references_m];
+    bool shader_missing = false;
+
+    for ( uint32_t i = 0; i < shader_references->count; ++i ) {
+        xs_parser_shader_reference_t* shader = &shader_references->array[i];
+        xs_database_shader_paths ( shader_path, binary_path, input_path, output_path, shader, pipeline->shader_keys[i] );
+
+        if ( verbose ) {
+            std_log_info_m ( "Loading shader binary " std_fmt_str_m " from disk", shader_path, binary_path );
+        }
+        shader_bytecode[i].stage = shader->stage;
+        shader_bytecode[i].buffer = std_file_read_to_virtual_heap ( binary_path );
+        shader_missing |= shader_bytecode[i].buffer.base == NULL;
+    }
+
+    if ( shader_missing ) {
+        for ( uint32_t i = 0; i < shader_references->count; ++i ) {
+            if ( shader_bytecode[i].buffer.base != NULL ) {
+                std_virtual_heap_free ( shader_bytecode[i].buffer.base );
+            }
+        }
+
+        return;
+    }
+
+    xg_pipeline_state_h pipeline_handle = xg_null_handle_m;
+
+    for ( uint32_t i = 0; i < shader_references->count; ++i ) {
+        shader_bytecode_t* shader = &shader_bytecode[i];
+        std_assert_m ( shader->buffer.size > 0 );
+
+        switch ( shader->stage ) {
+        case xg_shading_stage_vertex_m:
+            std_assert_m ( pipeline_state->type == xg_pipeline_graphics_m );
+            xs_database_set_pipeline_state_shader ( &graphics_state->params.state.vertex_shader, shader );
+            break;
+        case xg_shading_stage_fragment_m:
+            std_assert_m ( pipeline_state->type == xg_pipeline_graphics_m );
+            xs_database_set_pipeline_state_shader ( &graphics_state->params.state.fragment_shader, shader );
+            break;
+        case xg_shading_stage_compute_m:
+            std_assert_m ( pipeline_state->type == xg_pipeline_compute_m );
+            xs_database_set_pipeline_state_shader ( &compute_state->params.state.compute_shader, shader );
+            break;
+        case xg_shading_stage_ray_gen_m:
+        case xg_shading_stage_ray_hit_closest_m:
+        case xg_shading_stage_ray_miss_m:
+            std_assert_m ( pipeline_state->type == xg_pipeline_raytrace_m );
+            xg_pipeline_state_shader_t* pipeline_shader = &raytrace_state->params.state.shader_state.shaders[raytrace_state->params.state.shader_state.shader_count++];
+            xs_database_set_pipeline_state_shader ( pipeline_shader, shader );
+            break;
+        default:
+            std_assert_m ( false );
+            break;
+        }
+    }
+
+    for ( uint32_t i = 0; i < xg_shader_binding_set_count_m; ++i ) {
+        xg_resource_bindings_layout_params_t* layout_params = &resource_layouts[i];
+        std_stack_t stack = std_static_stack_m ( layout_params->debug_name );
+        std_stack_string_append ( &stack, pipeline_state->name );
+        std_stack_string_append ( &stack, "-" );
+        std_stack_string_append ( &stack, xg_shader_binding_set_str ( i ) );
+        xg_resource_bindings_layout_h resource_layout = xg->create_resource_layout ( layout_params );
+        pipeline->resource_layout_handles[i] = resource_layout;
+
+        switch ( pipeline_state->type ) {
+        case xg_pipeline_graphics_m:
+            graphics_state->params.resource_layouts[i] = resource_layout;
+            break;
+        case xg_pipeline_compute_m:
+            compute_state->params.resource_layouts[i] = resource_layout;
+            break;
+        case xg_pipeline_raytrace_m:
+            raytrace_state->params.resource_layouts[i] = resource_layout;
+            break;
+        }
+    }
+
     if ( verbose ) {
-        std_log_info_m ( "Starting build for database " std_fmt_str_m, db->debug_name );
+        std_log_info_m ( "Creating pipeline state " std_fmt_str_m, pipeline_state->name );
+    }
+    switch ( pipeline_state->type ) {
+        case xg_pipeline_graphics_m:
+            pipeline_handle = xg->create_graphics_pipeline ( db->device, &graphics_state->params );
+            break;
+        case xg_pipeline_compute_m:
+            pipeline_handle = xg->create_compute_pipeline ( db->device, &compute_state->params );
+            break;
+        case xg_pipeline_raytrace_m:
+            pipeline_handle = xg->create_raytrace_pipeline ( db->device, &raytrace_state->params );
+            break;
     }
 
-    // check headers, froce rebuild all shaders if one changed
-    // TODO try to take dependencies into account and avoid rebuilding everything?
-    // TODO account for xs.glsl changes
-    bool dirty_headers = false;
-    std_timestamp_t most_recent_header_edit = std_timestamp_zero_m;
+    if ( pipeline_handle == xg_null_handle_m ) {
+        std_log_warn_m ( "Pipeline state " std_fmt_str_m " creation failed", pipeline_state->name );
+    }
 
-    for ( size_t header_it = 0; header_it < db->pipeline_state_headers_count && !dirty_headers; ++header_it ) {
-        xs_database_pipeline_state_header_t* header = &db->pipeline_state_headers_array[header_it];
+    for ( size_t i = 0; i < shader_references->count; ++i ) {
+        std_virtual_heap_free ( shader_bytecode[i].buffer.base );
+    }
 
-        std_file_info_t info;
-        std_verify_m ( std_file_path_info ( &info, header->path ) );
+    pipeline->pipeline_handle = pipeline_handle;
+    pipeline->is_built = true;
+}
 
-        bool dirty = db->pipeline_state_headers_last_build_timestamp.count < info.last_write_time.count;
-        dirty_headers |= dirty;
+typedef struct {
+    xs_database_t* db;
+    xs_database_build_pipeline_t* pipelines;
+    uint32_t pipeline_count;
+    uint32_t next_pipeline; // atomic
+} xs_database_build_create_context_t;
+
+static void xs_database_create_pipelines_routine ( void* arg ) {
+    xs_database_build_create_context_t* context = ( xs_database_build_create_context_t* ) arg;
+
+    for ( ;; ) {
+        uint32_t idx = std_atomic_fetch_add_u32 ( &context->next_pipeline, 1 );
 
-        if ( verbose && dirty ) {
-            std_log_info_m ( "Header " std_fmt_str_m " found dirty: " std_fmt_u64_m " " std_fmt_u64_m, header->path, db->pipeline_state_headers_last_build_timestamp.count, info.last_write_time.count );
+        if ( idx >= context->pipeline_count ) {
+            break;
         }
-    
-        if ( info.last_write_time.count > most_recent_header_edit.count ) {
-            most_recent_header_edit = info.last_write_time;
+
+        xs_database_build_pipeline_t* pipeline = &context->pipelines[idx];
+
+        if ( pipeline->needs_to_build && pipeline->failed_count == 0 ) {
+            xs_database_create_pipeline ( context->db, pipeline );
         }
     }
+}
 
-    if ( dirty_headers ) {
-        db->pipeline_state_headers_last_build_timestamp = std_timestamp_now_utc();
+static xs_database_build_result_t xs_database_build_pipelines ( xs_database_t* db ) {
+    xs_database_build_result_t result = xs_database_build_result_m();
+
+    const bool verbose = false;
+    if ( verbose ) {
+        std_log_info_m ( "Starting build for database " std_fmt_str_m, db->debug_name );
     }
 
-    // check pipeline states
+    std_tick_t build_begin_tick = std_tick_now();
+
+    char input_path[std_path_size_m];
+    char output_path[std_path_size_m];
+    char shader_path[std_path_size_m];
+    char binary_path[std_path_size_m];
+
+    xs_database_build_pipeline_t* pipelines = std_virtual_heap_alloc_array_m ( xs_database_build_pipeline_t, db->pipeline_states_count );
+    xs_database_build_compile_t* compiles = std_virtual_heap_alloc_array_m ( xs_database_build_compile_t, db->pipeline_states_count * xs_shader_parser_max_shader_references_m );
+    uint32_t compile_count = 0;
+
+    std_virtual_stack_t deps = std_virtual_stack_create ( xs_database_max_shader_dependencies_m * std_path_size_m );
+
+    // parse pipeline states and gather the shaders that need to be (re)compiled
     for ( size_t state_it = 0; state_it < db->pipeline_states_count; ++state_it ) {
         xs_database_pipeline_state_t* pipeline_state = &db->pipeline_states[state_it];
+        xs_database_build_pipeline_t* pipeline = &pipelines[state_it];
+        pipeline->pipeline_state = pipeline_state;
+        pipeline->needs_to_build = false;
+        pipeline->compile_count = 0;
+        pipeline->failed_count = 0;
+        pipeline->is_built = false;
+        pipeline->pipeline_handle = xg_null_handle_m;
 
         if ( verbose ) {
             std_log_info_m ( "Parsing pipeline metadata " std_fmt_str_m, pipeline_state->path );
         }
 
-        std_file_h pipeline_state_file = std_file_open ( pipeline_state->path, std_file_read_m );
-        std_assert_m ( pipeline_state_file != std_file_null_handle_m );
-
-        std_file_info_t pipeline_state_file_info;
-        std_verify_m ( std_file_info ( &pipeline_state_file_info, pipeline_state_file ) );
-
-        std_file_close ( pipeline_state_file );
+        uint64_t pipeline_state_file_hash;
+        {
+            std_buffer_t pipeline_state_file = std_file_read_to_virtual_heap ( pipeline_state->path );
+            std_assert_m ( pipeline_state_file.base != NULL );
+            pipeline_state_file_hash = std_hash_block_64_m ( pipeline_state_file.base, pipeline_state_file.size );
+            std_virtual_heap_free ( pipeline_state_file.base );
+        }
 
         bool state_parse_result = false;
 
-        typedef union {
-            xs_parser_graphics_pipeline_state_t graphics;
-            xs_parser_compute_pipeline_state_t compute;
-            xs_parser_raytrace_pipeline_state_t raytrace;
-        } xs_parsed_pipeline_state_t;
+        xs_database_parsed_pipeline_state_t* parsed_pipeline_state = &pipeline->parsed;
+        std_mem_zero_m ( parsed_pipeline_state );
 
-        xs_parsed_pipeline_state_t parsed_pipeline_state = {};
-
-        xs_parser_shader_references_t* shader_references;
-        xs_parser_shader_definitions_t* shader_definitions;
-        xg_resource_bindings_layout_params_t* resource_layouts;
-
-        // TODO move the parsing down to after checking for last build timestamp etc?
+        // TODO move the parsing down to after checking the pipeline state file hash?
         switch ( pipeline_state->type ) {
             case xg_pipeline_graphics_m:
-                parsed_pipeline_state.graphics.params = xg_graphics_pipeline_params_m (
+                parsed_pipeline_state->graphics.params = xg_graphics_pipeline_params_m (
                     .state = db->base_graphics_state
                 );
-                std_str_copy_static_m ( parsed_pipeline_state.graphics.params.debug_name, pipeline_state->name );
+                std_str_copy_static_m ( parsed_pipeline_state->graphics.params.debug_name, pipeline_state->name );
 
-                state_parse_result = xs_parser_parse_graphics_pipeline_state_from_path ( &parsed_pipeline_state.graphics, pipeline_state->path );
+                state_parse_result = xs_parser_parse_graphics_pipeline_state_from_path ( &parsed_pipeline_state->graphics, pipeline_state->path );
 
-                shader_references = &parsed_pipeline_state.graphics.shader_references;
-                shader_definitions = &parsed_pipeline_state.graphics.shader_definitions;
-                resource_layouts = parsed_pipeline_state.graphics.resource_layouts;
+                pipeline->shader_references = &parsed_pipeline_state->graphics.shader_references;
+                pipeline->shader_definitions = &parsed_pipeline_state->graphics.shader_definitions;
+                pipeline->resource_layouts = parsed_pipeline_state->graphics.resource_layouts;
                 break;
 
             case xg_pipeline_compute_m:
-                parsed_pipeline_state.compute.params = xg_compute_pipeline_params_m (
+                parsed_pipeline_state->compute.params = xg_compute_pipeline_params_m (
                     .state = db->base_compute_state
                 );
-                std_str_copy_static_m ( parsed_pipeline_state.compute.params.debug_name, pipeline_state->name );
+                std_str_copy_static_m ( parsed_pipeline_state->compute.params.debug_name, pipeline_state->name );
 
-                state_parse_result = xs_parser_parse_compute_pipeline_state_from_path ( &parsed_pipeline_state.compute, pipeline_state->path );
+                state_parse_result = xs_parser_parse_compute_pipeline_state_from_path ( &parsed_pipeline_state->compute, pipeline_state->path );
 
-                shader_references = &parsed_pipeline_state.compute.shader_references;
-                shader_definitions = &parsed_pipeline_state.compute.shader_definitions;
-                resource_layouts = parsed_pipeline_state.compute.resource_layouts;
+                pipeline->shader_references = &parsed_pipeline_state->compute.shader_references;
+                pipeline->shader_definitions = &parsed_pipeline_state->compute.shader_definitions;
+                pipeline->resource_layouts = parsed_pipeline_state->compute.resource_layouts;
                 break;
 
             case xg_pipeline_raytrace_m:
-                parsed_pipeline_state.raytrace.params = xg_raytrace_pipeline_params_m (
+                parsed_pipeline_state->raytrace.params = xg_raytrace_pipeline_params_m (
                     .state = db->base_raytrace_state
                 );
-                std_str_copy_static_m ( parsed_pipeline_state.raytrace.params.debug_name, pipeline_state->name );
+                std_str_copy_static_m ( parsed_pipeline_state->raytrace.params.debug_name, pipeline_state->name );
 
-                state_parse_result = xs_parser_parse_raytrace_pipeline_state_from_path ( &parsed_pipeline_state.raytrace, pipeline_state->path );
+                state_parse_result = xs_parser_parse_raytrace_pipeline_state_from_path ( &parsed_pipeline_state->raytrace, pipeline_state->path );
 
-                shader_references = &parsed_pipeline_state.raytrace.shader_references;
-                shader_definitions = &parsed_pipeline_state.raytrace.shader_definitions;
-                resource_layouts = parsed_pipeline_state.raytrace.resource_layouts;
+                pipeline->shader_references = &parsed_pipeline_state->raytrace.shader_references;
+                pipeline->shader_definitions = &parsed_pipeline_state->raytrace.shader_definitions;
+                pipeline->resource_layouts = parsed_pipeline_state->raytrace.resource_layouts;
                 break;
         }
 
@@ -388,310 +868,227 @@ xs_database_build_result_t xs_database_build ( xs_database_h db_handle ) {
             continue;
         }
 
-        char input_path[std_path_size_m];
-        std_str_copy ( input_path, std_path_size_m, pipeline_state->path );
-        std_path_pop ( input_path );
-
-        char output_path[std_path_size_m];
-
-        if ( db->output_path[0] ) {
-            std_str_copy ( output_path, std_path_size_m, db->output_path );
-        } else {
-            std_str_copy ( output_path, std_path_size_m, input_path );
-        }
-
+        xs_database_pipeline_paths ( input_path, output_path, db, pipeline_state );
         std_directory_create ( output_path );
 
-        shader_bytecode_t shader_bytecode[xs_shader_parser_max_shader_references_m];
-        char shader_path[std_path_size_m];
-        char binary_path[std_path_size_m];
-
-        // check if the pipeline state needs to be (re)built
-        bool needs_to_build = dirty_headers || pipeline_state->last_build_timestamp.count < pipeline_state_file_info.last_write_time.count || db->dirty_build_params;
+        xs_shader_compiler_params_t compiler_params;
+        compiler_params.binary_path = "";
+        compiler_params.shader_path = "";
+        compiler_params.global_definitions = db->global_definitions;
+        compiler_params.global_definition_count = db->global_definition_count;
+        compiler_params.shader_definitions = pipeline->shader_definitions->array;
+        compiler_params.shader_definition_count = pipeline->shader_definitions->count;
+        uint64_t options_hash = xs_shader_compiler_options_hash ( &compiler_params );
+
+        uint64_t build_hashes[xs_shader_parser_max_shader_references_m + 1];
+        build_hashes[0] = pipeline_state_file_hash;
+
+        for ( uint32_t i = 0; i < pipeline->shader_references->count; ++i ) {
+            xs_parser_shader_reference_t* shader = &pipeline->shader_references->array[i];
+            std_str_copy ( shader_path, std_path_size_m, input_path );
+            std_path_append ( shader_path, std_path_size_m, shader->name );
+
+            uint64_t content_hash = xs_database_scan_shader_dependencies ( &deps, shader_path );
+            uint64_t key = xs_database_shader_key ( options_hash, content_hash, shader->stage );
+            pipeline->shader_keys[i] = key;
+            build_hashes[i + 1] = key;
+
+            // check if shader needs to be compiled or can be served from the cache
+            xs_database_shader_paths ( shader_path, binary_path, input_path, output_path, shader, key );
+            std_file_info_t binary_info;
+            bool cached = std_file_path_info ( &binary_info, binary_path ) && binary_info.size > 0;
+
+            // the same shader can be referenced by multiple pipeline states, only compile it once
+            for ( uint32_t j = 0; j < compile_count && !cached; ++j ) {
+                cached = compiles[j].key == key;
+            }
 
-        if ( !needs_to_build ) {
-            #if 0
-            for ( xg_shading_stage_e stage = 0; stage < xg_shading_stage_count_m; ++stage ) {
-                if ( shader_references->referenced_stages & xg_shading_stage_enum_to_bit_m ( stage ) ) {
-                    std_str_copy ( shader_path, fs_path_size_m, input_path );
-                    fs->append_path ( shader_path, fs_path_size_m, shader_references->shaders[stage] );
-
-                    // check shader source edit time
-                    fs_file_info_t shader_source_info;
-                    std_verify_m ( fs->get_file_path_info ( &shader_source_info, shader_path ) );
-
-                    if ( pipeline_state->last_build_timestamp.count < shader_source_info.last_write_time.count ) {
-                        needs_to_build = true;
-                        break;
-                    }
-                }
+            if ( !cached ) {
+                xs_database_build_compile_t* compile = &compiles[compile_count++];
+                compile->pipeline = pipeline;
+                compile->shader_idx = i;
+                compile->key = key;
+                ++pipeline->compile_count;
             }
-            #else
-            for ( uint32_t i = 0; i < shader_references->count; ++i ) {
-                xs_parser_shader_reference_t* shader = &shader_references->array[i];
-                std_str_copy ( shader_path, std_path_size_m, input_path );
-                std_path_append ( shader_path, std_path_size_m, shader->name );
-
-                // check shader source edit time
-                std_file_info_t shader_source_info;
-                std_verify_m ( std_file_path_info ( &shader_source_info, shader_path ) );
-
-                if ( pipeline_state->last_build_timestamp.count < shader_source_info.last_write_time.count ) {
-                    needs_to_build = true;
-                    break;
+
+            if ( verbose ) {
+                if ( cached ) {
+                    std_log_info_m ( "Skipping shader " std_fmt_str_m ", found in cache", shader_path );
+                } else {
+                    std_log_info_m ( "Building shader " std_fmt_str_m " to " std_fmt_str_m, shader_path, binary_path );
                 }
             }
-            #endif
         }
 
+        // check if the pipeline state needs to be (re)built
+        pipeline->build_hash = std_hash_block_64_m ( build_hashes, sizeof ( uint64_t ) * ( pipeline->shader_references->count + 1 ) );
+        bool needs_to_build = pipeline->build_hash != pipeline_state->build_hash || db->dirty_build_params;
+        pipeline->needs_to_build = needs_to_build;
+
         if ( !needs_to_build ) {
             if ( verbose ) {
                 std_log_info_m ( "Skipping pipeline " std_fmt_str_m, pipeline_state->path );
             }
-            result.skipped_shaders += shader_references->count;
+            result.skipped_shaders += pipeline->shader_references->count;
             result.skipped_pipeline_states += 1;
-            continue;
         }
+    }
 
-        {
-            xs_parser_graphics_pipeline_state_t* graphics_state = &parsed_pipeline_state.graphics;
-            xs_parser_compute_pipeline_state_t* compute_state = &parsed_pipeline_state.compute;
-            xs_parser_raytrace_pipeline_state_t* raytrace_state = &parsed_pipeline_state.raytrace;
-
-            size_t shader_success = 0;
-            size_t shader_fail = 0;
-            size_t shader_skip = 0;
-
-            //for ( xg_shading_stage_e stage = 0; stage < xg_shading_stage_count_m; ++stage ) {
-            //    if ( shader_references->referenced_stages & xg_shading_stage_enum_to_bit_m ( stage ) ) {
-            for ( uint32_t i = 0; i < shader_references->count; ++i ) {
-                xs_parser_shader_reference_t* shader = &shader_references->array[i];
-
-                shader_bytecode_t* bytecode = &shader_bytecode[i];
+    // invoke compiler processes, keeping up to one in flight per logical core
+    // processes are waited on in launch order, a new one is launched every time one completes
+    std_tick_t compile_begin_tick = std_tick_now();
+
+    if ( compile_count > 0 ) {
+        uint32_t max_parallel_compiles = ( uint32_t ) std_platform_logical_cores_info ( NULL, 0 );
+        max_parallel_compiles = std_max_u32 ( 1, std_min_u32 ( max_parallel_compiles, xs_database_max_parallel_compiles_m ) );
+
+        std_process_h processes[xs_database_max_parallel_compiles_m];
+        char temp_path[std_path_size_m];
+
+        uint32_t launched_count = 0;
+        uint32_t completed_count = 0;
+
+        while ( completed_count < compile_count ) {
+            while ( launched_count < compile_count && launched_count - completed_count < max_parallel_compiles ) {
+                xs_database_build_compile_t* compile = &compiles[launched_count];
+                xs_database_build_pipeline_t* pipeline = compile->pipeline;
+                xs_database_pipeline_paths ( input_path, output_path, db, pipeline->pipeline_state );
+                xs_database_shader_paths ( shader_path, binary_path, input_path, output_path, &pipeline->shader_references->array[compile->shader_idx], pipeline->shader_keys[compile->shader_idx] );
+
+                // compile to a temp file first, a cache entry should never be visible unless complete
+                std_str_copy ( temp_path, std_path_size_m, binary_path );
+                std_stack_t temp_stack = std_stack ( temp_path, std_path_size_m );
+                temp_stack.top = temp_stack.begin + std_str_len ( temp_path ) + 1;
+                std_stack_string_append ( &temp_stack, ".tmp" );
+
+                xs_shader_compiler_params_t params;
+                params.binary_path = temp_path;
+                params.shader_path = shader_path;
+                params.global_definitions = db->global_definitions;
+                params.global_definition_count = db->global_definition_count;
+                params.shader_definitions = pipeline->shader_definitions->array;
+                params.shader_definition_count = pipeline->shader_definitions->count;
+
+                processes[launched_count % max_parallel_compiles] = xs_shader_compiler_launch ( &params );
+                ++launched_count;
+            }
 
-                // prepare shader code input path
-                std_str_copy ( shader_path, std_path_size_m, input_path );
-                std_path_append ( shader_path, std_path_size_m, shader->name );
+            xs_database_build_compile_t* compile = &compiles[completed_count];
+            xs_database_build_pipeline_t* pipeline = compile->pipeline;
+            xs_database_pipeline_paths ( input_path, output_path, db, pipeline->pipeline_state );
+            xs_database_shader_paths ( shader_path, binary_path, input_path, output_path, &pipeline->shader_references->array[compile->shader_idx], pipeline->shader_keys[compile->shader_idx] );
+            std_str_copy ( temp_path, std_path_size_m, binary_path );
+            std_stack_t temp_stack = std_stack ( temp_path, std_path_size_m );
+            temp_stack.top = temp_stack.begin + std_str_len ( temp_path ) + 1;
+            std_stack_string_append ( &temp_stack, ".tmp" );
 
-                // prepare shader bytecode output path
-                std_str_copy ( binary_path, std_path_size_m, output_path );
-                std_path_append ( binary_path, std_path_size_m, shader->name );
-                size_t len = std_str_len ( binary_path );
-                size_t len2 = std_str_find_reverse ( binary_path, len, "." );
+            bool compile_result = xs_shader_compiler_wait ( processes[completed_count % max_parallel_compiles] );
+            ++completed_count;
 
-                if ( len2 != std_str_find_null_m ) {
-                    len = len2;
-                }
+            if ( compile_result ) {
+                compile_result = std_file_path_move ( temp_path, binary_path, std_path_already_existing_overwrite_m );
+            }
 
-                std_stack_t stack = std_static_stack_m ( binary_path );
-                stack.top = stack.begin + len + 1;
-
-                const char* stage_tag = "";
-
-                xg_shading_stage_e stage = shader->stage;
-                if ( stage == xg_shading_stage_vertex_m ) {
-                    stage_tag = "vs";
-                } else if ( stage == xg_shading_stage_fragment_m ) {
-                    stage_tag = "fs";
-                } else if ( stage == xg_shading_stage_compute_m ) {
-                    stage_tag = "cs";
-                } else if ( stage == xg_shading_stage_ray_gen_m ) {
-                    stage_tag = "rg";
-                } else if ( stage == xg_shading_stage_ray_miss_m ) {
-                    stage_tag = "rm";
-                } else if ( stage == xg_shading_stage_ray_hit_closest_m ) {
-                    stage_tag = "rhc";
+            if ( !compile_result ) {
+                if ( verbose ) {
+                    std_log_info_m ( "Shader " std_fmt_str_m " failed to build", shader_path );
                 }
+                ++pipeline->failed_count;
+                continue;
+            }
 
-                //std_str_append ( binary_path, &array, "-" );
-                //std_str_append ( binary_path, &array, stage_tag );
-                //std_str_append ( binary_path, &array, ".spv" );
-
-                std_stack_string_append ( &stack, "-" );
-                std_stack_string_append ( &stack, stage_tag );
-                std_stack_string_append ( &stack, ".spv" );
-
-                // check if shader needs to be (re)compiled
-                bool skip_compile = false;
-                std_file_info_t shader_source_info;
-                std_verify_m ( std_file_path_info ( &shader_source_info, shader_path ) );
-                std_file_info_t shader_output_info;
-                if ( std_file_path_info ( &shader_output_info, binary_path ) ) {
-                    if ( shader_output_info.last_write_time.count > shader_source_info.last_write_time.count
-                        && shader_output_info.last_write_time.count > most_recent_header_edit.count     // if any header got updated after the shader was compiled, need to recompile
-                    ) {
-                        skip_compile = true;
-                        ++shader_skip;
-                    }
-                }
+            // the dependency scan runs while the other compilers are still busy
+            xs_database_scan_shader_dependencies ( &deps, shader_path );
+            xs_database_write_shader_dependencies ( &deps, binary_path );
+        }
+    }
 
-                if ( verbose ) {
-                    if ( skip_compile ) {
-                        std_log_info_m ( "Skipping shader " std_fmt_str_m, shader_path );
-                    } else {
-                        std_log_info_m ( "Building shader " std_fmt_str_m " to " std_fmt_str_m, shader_path, binary_path );
-                    }
-                }
+    std_virtual_stack_destroy ( &deps );
 
-                // invoke compiler process
-                if ( !skip_compile ) {
-                    xs_shader_compiler_params_t params;
-                    params.binary_path = binary_path;
-                    params.shader_path = shader_path;
-                    params.global_definitions = db->global_definitions;
-                    params.global_definition_count = db->global_definition_count;
-                    params.shader_definitions = shader_definitions->array;
-                    params.shader_definition_count = shader_definitions->count;
-
-                    bool compile_result = xs_shader_compiler_compile ( &params );
-
-                    if ( !compile_result ) {
-                        if ( verbose ) {
-                            std_log_info_m ( "Shader " std_fmt_str_m " failed to build", shader_path );
-                        }
-                        ++shader_fail;
-                        bytecode->buffer = std_buffer_m();
-                        continue;
-                    } else {
-                        ++shader_success;
-                    }
-                }
+    std_tick_t compile_end_tick = std_tick_now();
 
-                // read generated shader bytecode
-                #if 0
-                fs_file_h bytecode_file = fs->open_file ( binary_path, fs_file_read_m );
-                std_assert_m ( bytecode_file != fs_null_handle_m );
-
-                fs_file_info_t bytecode_file_info;
-                std_verify_m ( fs->get_file_info ( &bytecode_file_info, bytecode_file ) );
-
-                {
-                    size_t size = bytecode_file_info.size;
-                    void* alloc = std_virtual_heap_alloc ( size, 16 );
-                    shader_bytecode[stage].size = bytecode_file_info.size;
-                    std_verify_m ( fs->read_file ( alloc, size, bytecode_file ) );
-                    shader_bytecode[stage].base = alloc;
-                    shader_bytecode[stage].size = size;
-                }
-                fs->close_file ( bytecode_file );
-                #else
-                if ( verbose ) {
-                    std_log_info_m ( "Loading shader binary " std_fmt_str_m " from disk", shader_path, binary_path );
-                }
-                bytecode->stage = stage;
-                bytecode->buffer = std_file_read_to_virtual_heap ( binary_path );
-                #endif
-                //}
-            }
+    // create the pipeline states, spread across threads since each one can take a while in the driver
+    uint32_t create_count = 0;
+    for ( size_t state_it = 0; state_it < db->pipeline_states_count; ++state_it ) {
+        xs_database_build_pipeline_t* pipeline = &pipelines[state_it];
+        create_count += pipeline->needs_to_build && pipeline->failed_count == 0 ? 1 : 0;
+    }
 
-            // TODO does this leak when there are multiple permutations?
-            if ( shader_fail > 0 ) {
-                ++result.failed_pipeline_states;
-                result.failed_shaders += shader_fail;
+    if ( create_count > 0 ) {
+        xs_database_build_create_context_t create_context;
+        create_context.db = db;
+        create_context.pipelines = pipelines;
+        create_context.pipeline_count = ( uint32_t ) db->pipeline_states_count;
+        create_context.next_pipeline = 0;
 
-                for ( size_t i = 0; i < shader_references->count; ++i ) {
-                    std_virtual_heap_free ( shader_bytecode[i].buffer.base );
-                }
+        uint32_t thread_count = ( uint32_t ) std_platform_logical_cores_info ( NULL, 0 );
+        thread_count = std_max_u32 ( 1, std_min_u32 ( std_min_u32 ( thread_count, create_count ), xs_database_max_pipeline_create_threads_m ) );
 
-                continue;
-            }
+        // the calling thread takes part too
+        std_thread_h threads[xs_database_max_pipeline_create_threads_m];
+        for ( uint32_t i = 1; i < thread_count; ++i ) {
+            threads[i] = std_thread ( xs_database_create_pipelines_routine, &create_context, "xs_pipelines", std_thread_core_mask_any_m );
+        }
 
-            pipeline_state->last_build_timestamp = std_timestamp_now_utc();
-
-            xg_pipeline_state_h pipeline_handle = xg_null_handle_m;
-
-            for ( uint32_t i = 0; i < shader_references->count; ++i ) {
-                shader_bytecode_t* shader = &shader_bytecode[i];
-                std_assert_m ( shader->buffer.size > 0 );
-
-                switch ( shader->stage ) {
-                case xg_shading_stage_vertex_m:
-                    std_assert_m ( pipeline_state->type == xg_pipeline_graphics_m );
-                    xs_database_set_pipeline_state_shader ( &graphics_state->params.state.vertex_shader, shader );
-                    break;
-                case xg_shading_stage_fragment_m:
-                    std_assert_m ( pipeline_state->type == xg_pipeline_graphics_m );
-                    xs_database_set_pipeline_state_shader ( &graphics_state->params.state.fragment_shader, shader );
-                    break;
-                case xg_shading_stage_compute_m:
-                    std_assert_m ( pipeline_state->type == xg_pipeline_compute_m );
-                    xs_database_set_pipeline_state_shader ( &compute_state->params.state.compute_shader, shader );
-                    break;
-                case xg_shading_stage_ray_gen_m:
-                case xg_shading_stage_ray_hit_closest_m:
-                case xg_shading_stage_ray_miss_m:
-                    std_assert_m ( pipeline_state->type == xg_pipeline_raytrace_m );
-                    xg_pipeline_state_shader_t* pipeline_shader = &raytrace_state->params.state.shader_state.shaders[raytrace_state->params.state.shader_state.shader_count++];
-                    xs_database_set_pipeline_state_shader ( pipeline_shader, shader );
-                    break;
-                default:
-                    std_assert_m ( false );
-                    break;
-                }
-            }
+        xs_database_create_pipelines_routine ( &create_context );
 
-            for ( uint32_t i = 0; i < xg_shader_binding_set_count_m; ++i ) {
-                xg_resource_bindings_layout_params_t* layout_params = &resource_layouts[i];
-                std_stack_t stack = std_static_stack_m ( layout_params->debug_name );
-                std_stack_string_append ( &stack, pipeline_state->name );
-                std_stack_string_append ( &stack, "-" );
-                std_stack_string_append ( &stack, xg_shader_binding_set_str ( i ) );
-                xg_resource_bindings_layout_h resource_layout = xg->create_resource_layout ( layout_params );
-                pipeline_state->resource_layouts[i] = resource_layout;
-
-                switch ( pipeline_state->type ) {
-                case xg_pipeline_graphics_m:
-                    graphics_state->params.resource_layouts[i] = resource_layout;
-                    break;
-                case xg_pipeline_compute_m:
-                    compute_state->params.resource_layouts[i] = resource_layout;
-                    break;
-                case xg_pipeline_raytrace_m:
-                    raytrace_state->params.resource_layouts[i] = resource_layout;
-                    break;
-                }
-            }
+        for ( uint32_t i = 1; i < thread_count; ++i ) {
+            std_thread_join ( threads[i] );
+        }
+    }
 
-            if ( verbose ) {
-                std_log_info_m ( "Creating pipeline state " std_fmt_str_m, pipeline_state->name );
-            }
-            switch ( pipeline_state->type ) {
-                case xg_pipeline_graphics_m:
-                    pipeline_handle = xg->create_graphics_pipeline ( db->device, &graphics_state->params );
-                    break;
-                case xg_pipeline_compute_m:
-                    pipeline_handle = xg->create_compute_pipeline ( db->device, &compute_state->params );
-                    break;
-                case xg_pipeline_raytrace_m:
-                    pipeline_handle = xg->create_raytrace_pipeline ( db->device, &raytrace_state->params );
-                    break;
-            }
+    // store the new pipelines as pending, they become visible once published
+    for ( size_t state_it = 0; state_it < db->pipeline_states_count; ++state_it ) {
+        xs_database_build_pipeline_t* pipeline = &pipelines[state_it];
+        xs_database_pipeline_state_t* pipeline_state = pipeline->pipeline_state;
 
-            if ( pipeline_handle == xg_null_handle_m ) {
-                std_log_warn_m ( "Pipeline state " std_fmt_str_m " creation failed", pipeline_state->name );
-            }
+        if ( !pipeline->needs_to_build ) {
+            continue;
+        }
 
-            // TODO add these pipelines to a separate list, to avoid having to iterate all pipelines in update_pipelines
-            // Also, right now the case where it creates a new pipeline and there's already a new pipeline pending is broken!
-            // The already pending pipeline is never deleted and leaked!
-            pipeline_state->old_pipeline_handle = pipeline_state->pipeline_handle;
-            pipeline_state->pipeline_handle = pipeline_handle;
+        if ( pipeline->failed_count > 0 ) {
+            ++result.failed_pipeline_states;
+            result.failed_shaders += pipeline->failed_count;
+            continue;
+        }
 
-            for ( size_t i = 0; i < shader_references->count; ++i ) {
-                std_virtual_heap_free ( shader_bytecode[i].buffer.base );
-            }
+        // can happen when the compile of a shader shared with another pipeline state failed
+        if ( !pipeline->is_built ) {
+            ++result.failed_pipeline_states;
+            continue;
+        }
 
-            ++result.successful_pipeline_states;
-            result.successful_shaders += shader_success;
-            result.skipped_shaders += shader_skip;
+        // a pending pipeline that never got published was never used and can go right away
+        if ( pipeline_state->has_pending_pipeline ) {
+            xs_database_destroy_pipeline ( pipeline_state->type, pipeline_state->pending_pipeline_handle, pipeline_state->pending_resource_layouts );
         }
+
+        pipeline_state->has_pending_pipeline = true;
+        pipeline_state->pending_pipeline_handle = pipeline->pipeline_handle;
+        std_mem_copy_static_array_m ( pipeline_state->pending_resource_layouts, pipeline->resource_layout_handles );
+        pipeline_state->build_hash = pipeline->build_hash;
+
+        ++result.successful_pipeline_states;
+        result.successful_shaders += pipeline->compile_count;
+        result.skipped_shaders += pipeline->shader_references->count - pipeline->compile_count;
     }
 
+    std_virtual_heap_free ( compiles );
+    std_virtual_heap_free ( pipelines );
+
+    db->dirty_build_params = false;
+
+    std_tick_t build_end_tick = std_tick_now();
+    result.compile_time_ms = std_tick_to_milli_f32 ( compile_end_tick - compile_begin_tick );
+    result.total_time_ms = std_tick_to_milli_f32 ( build_end_tick - build_begin_tick );
+
     std_log_info_m ( "Shader database build " std_fmt_str_m std_fmt_newline_m 
         "Pipeline states: " std_fmt_tab_m std_fmt_u32_pad_m(3) " failed " std_fmt_tab_m std_fmt_u32_pad_m(3) " built " std_fmt_tab_m std_fmt_u32_pad_m(3) " cached" std_fmt_newline_m 
-        "Shaders: " std_fmt_tab_m std_fmt_tab_m std_fmt_u32_pad_m(3) " failed " std_fmt_tab_m std_fmt_u32_pad_m(3) " built " std_fmt_tab_m std_fmt_u32_pad_m(3) " cached", db->debug_name,
+        "Shaders: " std_fmt_tab_m std_fmt_tab_m std_fmt_u32_pad_m(3) " failed " std_fmt_tab_m std_fmt_u32_pad_m(3) " built " std_fmt_tab_m std_fmt_u32_pad_m(3) " cached" std_fmt_newline_m
+        "Time: " std_fmt_tab_m std_fmt_tab_m std_fmt_f32_dec_m(2) "ms total " std_fmt_tab_m std_fmt_f32_dec_m(2) "ms compiling", db->debug_name,
         result.failed_pipeline_states, result.successful_pipeline_states, result.skipped_pipeline_states,
-        result.failed_shaders, result.successful_shaders, result.skipped_shaders );
+        result.failed_shaders, result.successful_shaders, result.skipped_shaders,
+        result.total_time_ms, result.compile_time_ms );
 
     if ( result.failed_shaders || result.failed_pipeline_states ) {
         std_log_warn_m ( "Shader database build: " std_fmt_size_m " states, " std_fmt_size_m " shaders failed", result.failed_pipeline_states, result.failed_shaders );
@@ -700,6 +1097,77 @@ xs_database_build_result_t xs_database_build ( xs_database_h db_handle ) {
     return result;
 }
 
+static bool xs_database_can_publish ( const xs_database_t* db ) {
+    for ( size_t state_it = 0; state_it < db->pipeline_states_count; ++state_it ) {
+        if ( db->pipeline_states[state_it].has_old_pipeline ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void xs_database_publish_pipelines ( xs_database_t* db, xg_workload_h last_workload ) {
+    for ( size_t state_it = 0; state_it < db->pipeline_states_count; ++state_it ) {
+        xs_database_pipeline_state_t* pipeline_state = &db->pipeline_states[state_it];
+
+        if ( !pipeline_state->has_pending_pipeline ) {
+            continue;
+        }
+
+        std_assert_m ( !pipeline_state->has_old_pipeline );
+        pipeline_state->has_old_pipeline = true;
+        pipeline_state->old_pipeline_handle = pipeline_state->pipeline_handle;
+        pipeline_state->old_pipeline_workload = last_workload;
+        std_mem_copy_static_array_m ( pipeline_state->old_resource_layouts, pipeline_state->resource_layouts );
+
+        pipeline_state->has_pending_pipeline = false;
+        pipeline_state->pipeline_handle = pipeline_state->pending_pipeline_handle;
+        std_mem_copy_static_array_m ( pipeline_state->resource_layouts, pipeline_state->pending_resource_layouts );
+    }
+}
+
+static void xs_database_build_routine ( void* arg ) {
+    xs_database_t* db = ( xs_database_t* ) arg;
+    xs_database_build_pipelines ( db );
+    std_atomic_exchange_u32 ( &db->build_state, xs_database_build_state_done_m );
+}
+
+xs_database_build_result_t xs_database_build ( xs_database_h db_handle ) {
+    xs_database_t* db = &xs_database_state->database_array[db_handle];
+
+    // whatever a background build in flight produces is either replaced by this build or published along with it
+    xs_database_wait_build ( db );
+    db->rebuild_requested = false;
+
+    xs_database_build_result_t result = xs_database_build_pipelines ( db );
+
+    // publish right away, unless the pipelines replaced by the previous publish could still be in use.
+    // In that case update_pipelines publishes them as soon as those are retired
+    if ( xs_database_can_publish ( db ) ) {
+        xs_database_publish_pipelines ( db, xg_null_handle_m );
+        db->build_state = xs_database_build_state_idle_m;
+    } else {
+        db->build_state = xs_database_build_state_done_m;
+    }
+
+    return result;
+}
+
+void xs_database_build_async ( xs_database_h db_handle ) {
+    xs_database_t* db = &xs_database_state->database_array[db_handle];
+
+    // only the build thread writes build_state from here on, and only from running to done
+    if ( db->build_state != xs_database_build_state_idle_m ) {
+        // build another time once the current one is published, it could be missing the latest changes
+        db->rebuild_requested = true;
+        return;
+    }
+
+    db->build_state = xs_database_build_state_running_m;
+    db->build_thread = std_thread ( xs_database_build_routine, db, "xs_build", std_thread_core_mask_any_m );
+}
+
 xs_database_pipeline_h xs_database_pipeline_get ( xs_database_h db_handle, xs_string_hash_t hash ) {
     xs_database_t* db = &xs_database_state->database_array[db_handle];
     uint64_t* lookup = std_hash_map_lookup ( &db->pipeline_name_hash_to_state_map, hash );
@@ -730,12 +1198,11 @@ void xs_database_update_pipelines ( xg_workload_h last_workload ) {
     while ( std_bitset_scan ( &db_idx, xs_database_state->database_bitset, db_idx, xs_database_bitset_u64_count_m ) ) {
         xs_database_t* db = &xs_database_state->database_array[db_idx];
 
+        // TODO keep the replaced pipelines in a separate list, to avoid having to iterate all pipelines
         for ( size_t state_it = 0; state_it < db->pipeline_states_count; ++state_it ) {
             xs_database_pipeline_state_t* pipeline_state = &db->pipeline_states[state_it];
 
-            xg_graphics_pipeline_state_h old_pipeline_handle = pipeline_state->old_pipeline_handle;
-
-            if ( old_pipeline_handle != xg_null_handle_m ) {
+            if ( pipeline_state->has_old_pipeline ) {
                 xg_workload_h workload = pipeline_state->old_pipeline_workload;
 
                 if ( workload == xg_null_handle_m ) {
@@ -744,20 +1211,30 @@ void xs_database_update_pipelines ( xg_workload_h last_workload ) {
                 }
 
                 if ( xg->is_workload_complete ( workload ) ) {
-                    switch ( pipeline_state->type ) {
-                    case xg_pipeline_graphics_m:
-                        xg->destroy_graphics_pipeline ( pipeline_state->old_pipeline_handle );
-                        break;
-                    case xg_pipeline_compute_m:
-                        xg->destroy_compute_pipeline ( pipeline_state->old_pipeline_handle );
-                        break;
-                    case xg_pipeline_raytrace_m:
-                        xg->destroy_raytrace_pipeline ( pipeline_state->old_pipeline_handle );
-                        break;
-                    }
+                    xs_database_destroy_pipeline ( pipeline_state->type, pipeline_state->old_pipeline_handle, pipeline_state->old_resource_layouts );
 
+                    pipeline_state->has_old_pipeline = false;
                     pipeline_state->old_pipeline_handle = xg_null_handle_m;
                     pipeline_state->old_pipeline_workload = xg_null_handle_m;
+
+                    for ( uint32_t i = 0; i < xg_shader_binding_set_count_m; ++i ) {
+                        pipeline_state->old_resource_layouts[i] = xg_null_handle_m;
+                    }
+                }
+            }
+        }
+
+        // publish the output of a finished build, all pipelines at once
+        if ( xs_database_can_publish ( db ) ) {
+            uint32_t expected_state = xs_database_build_state_done_m;
+
+            if ( std_compare_and_swap_u32 ( &db->build_state, &expected_state, xs_database_build_state_idle_m ) ) {
+                xs_database_wait_build ( db );
+                xs_database_publish_pipelines ( db, last_workload );
+
+                if ( db->rebuild_requested ) {
+                    db->rebuild_requested = false;
+                    xs_database_build_async ( db_idx );
                 }
             }
         }
@@ -773,7 +1250,6 @@ xs_database_h xs_database_create ( const xs_database_params_t* params ) {
     db->device = params->device;
     db->stack = std_virtual_stack_create ( xs_database_memory_pool_max_size_m );
     db->pipeline_name_hash_to_state_map = std_hash_map_create ( xs_database_max_pipeline_states_m * 2 );
-    db->pipeline_state_headers_array = std_virtual_heap_alloc_array_m ( xs_database_pipeline_state_header_t, xs_database_max_pipeline_state_headers_m );
     std_str_copy_static_m ( db->debug_name, params->debug_name );
 
     db->base_graphics_state = xg_graphics_pipeline_state_m();
@@ -783,6 +1259,10 @@ xs_database_h xs_database_create ( const xs_database_params_t* params ) {
     db->global_definition_count = 0;
     db->dirty_build_params = false;
 
+    db->build_thread = std_thread_null_handle_m;
+    db->build_state = xs_database_build_state_idle_m;
+    db->rebuild_requested = false;
+
     uint64_t db_idx = db - xs_database_state->database_array;
     std_bitset_set ( xs_database_state->database_bitset, db_idx );
 
@@ -792,33 +1272,23 @@ xs_database_h xs_database_create ( const xs_database_params_t* params ) {
 }
 
 void xs_database_destroy ( xs_database_h db_handle ) {
-    xg_i* xg = std_module_get_m ( xg_module_name_m );
-    
     xs_database_t* db = &xs_database_state->database_array[db_handle];
+    xs_database_wait_build ( db );
 
     for ( uint32_t i = 0; i < db->pipeline_states_count; ++i ) {
         xs_database_pipeline_state_t* state = &db->pipeline_states[i];
 
-        if ( state->pipeline_handle != xg_null_handle_m ) {
-            switch ( state->type ) {
-            case xg_pipeline_graphics_m:
-                xg->destroy_graphics_pipeline ( state->pipeline_handle );
-                break;
-            case xg_pipeline_compute_m:
-                xg->destroy_compute_pipeline ( state->pipeline_handle );
-                break;
-            case xg_pipeline_raytrace_m:
-                xg->destroy_raytrace_pipeline ( state->pipeline_handle );
-                break;
-            }
+        xs_database_destroy_pipeline ( state->type, state->pipeline_handle, state->resource_layouts );
+
+        if ( state->has_pending_pipeline ) {
+            xs_database_destroy_pipeline ( state->type, state->pending_pipeline_handle, state->pending_resource_layouts );
         }
 
-        for ( uint32_t i = 0; i < xg_shader_binding_set_count_m; ++i ) {
-            xg->destroy_resource_layout ( state->resource_layouts[i] );
+        if ( state->has_old_pipeline ) {
+            xs_database_destroy_pipeline ( state->type, state->old_pipeline_handle, state->old_resource_layouts );
         }
     }
 
-    std_virtual_heap_free ( db->pipeline_state_headers_array );
     std_hash_map_destroy ( &db->pipeline_name_hash_to_state_map );
     std_virtual_stack_destroy ( &db->stack );
 
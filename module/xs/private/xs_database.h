@@ -4,6 +4,7 @@
 #include <xg.h>
 
 #include <std_time.h>
+#include <std_thread.h>
 
 //typedef struct {
 //    std_alloc_t alloc;
@@ -22,17 +23,26 @@ typedef struct {
     uint64_t name_hash;
     xg_pipeline_e type;
     xg_pipeline_state_h pipeline_handle;
+    xg_resource_bindings_layout_h resource_layouts[xg_shader_binding_set_count_m];
+    // Output of the last build, not visible to the user until published by update_pipelines
+    bool has_pending_pipeline;
+    xg_pipeline_state_h pending_pipeline_handle;
+    xg_resource_bindings_layout_h pending_resource_layouts[xg_shader_binding_set_count_m];
+    // Replaced by the last publish, destroyed once the last workload that could be using it is complete
+    bool has_old_pipeline;
     xg_pipeline_state_h old_pipeline_handle;
+    xg_resource_bindings_layout_h old_resource_layouts[xg_shader_binding_set_count_m];
     xg_workload_h old_pipeline_workload;
-    std_timestamp_t last_build_timestamp;
+    uint64_t build_hash; // pipeline state file and shader cache keys the last built pipeline was built from
     //uint32_t permutation_id;
     //uint32_t reference_count;
-    xg_resource_bindings_layout_h resource_layouts[xg_shader_binding_set_count_m];
 } xs_database_pipeline_state_t;
 
-typedef struct {
-    const char* path;
-} xs_database_pipeline_state_header_t;
+typedef enum {
+    xs_database_build_state_idle_m,
+    xs_database_build_state_running_m,  // build thread is running
+    xs_database_build_state_done_m,     // build thread is done, waiting for its pipelines to get published
+} xs_database_build_state_e;
 
 typedef struct {
     xg_device_h device;
@@ -54,11 +64,13 @@ typedef struct {
 
     std_hash_map_t pipeline_name_hash_to_state_map; // u64 hash -> xs_database_pipeline_state_t
 
-    xs_database_pipeline_state_header_t* pipeline_state_headers_array;//[];
-    size_t pipeline_state_headers_count;
-    std_timestamp_t pipeline_state_headers_last_build_timestamp;
+    // Background build
+    std_thread_h build_thread;
+    uint32_t build_state; // xs_database_build_state_e, atomic
+    bool rebuild_requested;
 
     char output_path[std_path_size_m];
+    char cache_path[std_path_size_m];
     char debug_name[32];
 } xs_database_t;
 
@@ -79,10 +91,12 @@ void xs_database_destroy ( xs_database_h database );
 
 bool xs_database_add_folder ( xs_database_h database, const char* path );
 bool xs_database_set_output_folder ( xs_database_h database, const char* path );
+bool xs_database_set_cache_folder ( xs_database_h database, const char* path );
 void xs_database_clear ( xs_database_h database );
 
 void xs_database_set_build_params ( xs_database_h database, const xs_database_build_params_t* params );
 xs_database_build_result_t xs_database_build ( xs_database_h database );
+void xs_database_build_async ( xs_database_h database );
 void xs_database_rebuild_all ( void );
 xs_database_pipeline_h xs_database_pipeline_get ( xs_database_h database, xs_string_hash_t name_hash );
 xg_graphics_pipeline_state_h xs_database_pipeline_state_get ( xs_database_pipeline_h state );
@@ -258,11 +258,15 @@ static xg_format_e xs_parser_format_to_enum ( const char* format ) {
         return xg_format_r16_unorm_m;
     } else if ( std_str_cmp ( format, "R32_FLOAT" ) == 0 ) {
         return xg_format_r32_sfloat_m;
+    } else if ( std_str_cmp ( format, "R32_UINT" ) == 0 ) {
+        return xg_format_r32_uint_m;
 
     } else if ( std_str_cmp ( format, "R16G16_FLOAT" ) == 0 ) {
         return xg_format_r16g16_sfloat_m;
     } else if ( std_str_cmp ( format, "R16G16_UNORM" ) == 0 ) {
         return xg_format_r16g16_unorm_m;
+    } else if ( std_str_cmp ( format, "R16G16_SNORM" ) == 0 ) {
+        return xg_format_r16g16_snorm_m;
     } else if ( std_str_cmp ( format, "R32G32_FLOAT" ) == 0 ) {
         return xg_format_r32g32_sfloat_m;
 
@@ -277,6 +281,8 @@ static xg_format_e xs_parser_format_to_enum ( const char* format ) {
         return xg_format_r16g16b16a16_sfloat_m;
     } else if ( std_str_cmp ( format, "R16G16B16A16_UNORM" ) == 0 ) {
         return xg_format_r16g16b16a16_unorm_m;
+    } else if ( std_str_cmp ( format, "R16G16B16A16_SNORM" ) == 0 ) {
+        return xg_format_r16g16b16a16_snorm_m;
     } else if ( std_str_cmp ( format, "R32G32B32A32_FLOAT" ) == 0 ) {
         return xg_format_r32g32b32a32_sfloat_m;
 
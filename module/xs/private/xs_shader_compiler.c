@@ -3,11 +3,9 @@
 #include <std_process.h>
 #include <std_log.h>
 #include <std_string.h>
+#include <std_hash.h>
 
-bool xs_shader_compiler_compile ( const xs_shader_compiler_params_t* params ) {
-    char executable[std_process_path_max_len_m];
-    std_str_copy ( executable, std_process_path_max_len_m, std_pp_eval_string_m ( std_binding_shader_compiler_m ) );
-
+static size_t xs_shader_compiler_args ( const char** args, std_stack_t* stack, const xs_shader_compiler_params_t* params ) {
 #if 0
     const char* entry_point = "main";
     const char* stage_name = "";
@@ -29,102 +27,112 @@ bool xs_shader_compiler_compile ( const xs_shader_compiler_params_t* params ) {
 
 #endif
 
-    const char* args[std_process_max_args_m];
     size_t argc = 0;
-    char args_buffer[std_process_args_max_len_m] = {0};
-    //char cmdline[std_process_cmdline_max_len_m];
-    {
-        std_stack_t stack = std_static_stack_m ( args_buffer );
 
-        args[argc++] = stack.top;
-        std_stack_string_copy ( &stack, "--target-env=vulkan1.2" );
+    args[argc++] = stack->top;
+    std_stack_string_copy ( stack, "--target-env=vulkan1.2" );
 
-        args[argc++] = stack.top;
-        std_stack_string_copy ( &stack, params->shader_path );
+    args[argc++] = stack->top;
+    std_stack_string_copy ( stack, params->shader_path );
 
-        args[argc++] = stack.top;
-        std_stack_string_copy ( &stack, "-g" );
+    args[argc++] = stack->top;
+    std_stack_string_copy ( stack, "-g" );
 
-        args[argc++] = stack.top;
+    args[argc++] = stack->top;
 #if std_build_debug_m
-        std_stack_string_copy ( &stack, "-O0" );
+    std_stack_string_copy ( stack, "-O0" );
 #else
-        std_stack_string_copy ( &stack, "-O" );
+    std_stack_string_copy ( stack, "-O" );
 #endif
 
-        args[argc++] = stack.top;
-        std_stack_string_copy ( &stack, "-o" );
-
-        /*char binary_name[xs_shader_name_max_len_m];
-        {
-            char* dest2 = binary_name;
-            size_t cap2 = xs_shader_name_max_len_m;
-            std_str_append_m ( dest2, cap2, output_path );
-            //std_str_copy ( binary_name, xs_shader_name_max_len_m, shader_path );
-
-            size_t len = std_str_len ( binary_name );
-            len = std_str_find_reverse ( binary_name, len, "." );
-            dest2 = binary_name + len;
-            cap2 = xs_shader_name_max_len_m - len;
-            std_str_append_m ( dest2, cap2, ".spv" );
-        }*/
-        args[argc++] = stack.top;
-        std_stack_string_copy ( &stack, params->binary_path );
+    args[argc++] = stack->top;
+    std_stack_string_copy ( stack, "-o" );
+
+    /*char binary_name[xs_shader_name_max_len_m];
+    {
+        char* dest2 = binary_name;
+        size_t cap2 = xs_shader_name_max_len_m;
+        std_str_append_m ( dest2, cap2, output_path );
+        //std_str_copy ( binary_name, xs_shader_name_max_len_m, shader_path );
+
+        size_t len = std_str_len ( binary_name );
+        len = std_str_find_reverse ( binary_name, len, "." );
+        dest2 = binary_name + len;
+        cap2 = xs_shader_name_max_len_m - len;
+        std_str_append_m ( dest2, cap2, ".spv" );
+    }*/
+    args[argc++] = stack->top;
+    std_stack_string_copy ( stack, params->binary_path );
 
 #if 0
-        args[argc++] = ++dest;
-        std_str_append_m ( dest, cap, "-fshader-stage=" );
-        std_str_append_m ( dest, cap, stage_name );
-
-        args[argc++] = ++dest;
-        std_str_append_m ( dest, cap, "-D" );
-        std_str_append_m ( dest, cap, entry_point );
-        std_str_append_m ( dest, cap, "=main" );
+    args[argc++] = ++dest;
+    std_str_append_m ( dest, cap, "-fshader-stage=" );
+    std_str_append_m ( dest, cap, stage_name );
+
+    args[argc++] = ++dest;
+    std_str_append_m ( dest, cap, "-D" );
+    std_str_append_m ( dest, cap, entry_point );
+    std_str_append_m ( dest, cap, "=main" );
 #endif
 
-        args[argc++] = stack.top;
-        // TODO find a better way to do this... this depends on the working dir (the app workspace root when running from neo)
-        {
-            char include_path[256];
-            std_stack_t include_path_string = std_static_stack_m ( include_path );
-            std_stack_string_append ( &include_path_string, "-I" );
-            std_stack_string_append ( &include_path_string, std_module_path_m );
-            std_stack_string_append ( &include_path_string, "public/shader/" );
-            std_stack_string_copy ( &stack, include_path );
-        }
+    args[argc++] = stack->top;
+    // TODO find a better way to do this... this depends on the working dir (the app workspace root when running from neo)
+    {
+        char include_path[256];
+        std_stack_t include_path_string = std_static_stack_m ( include_path );
+        std_stack_string_append ( &include_path_string, "-I" );
+        std_stack_string_append ( &include_path_string, xs_shader_compiler_include_path_m );
+        std_stack_string_copy ( stack, include_path );
+    }
 
-        //if ( binary_name_out ) {
-        //    std_str_copy ( binary_name_out, out_cap, binary_name );
-        //}
-
-        if ( params->global_definitions != NULL && params->global_definition_count > 0 ) {
-            char u32_buffer[32];
-
-            for ( size_t i = 0; i < params->global_definition_count; ++i ) {
-                //std_array_push ( &array, 1 );
-                args[argc++] = stack.top;
-                std_stack_string_copy ( &stack, "-D" );
-                std_stack_string_append ( &stack, params->global_definitions[i].name );
-                std_stack_string_append ( &stack, "=" );
-                size_t len = std_u32_to_str ( u32_buffer, 32, params->global_definitions[i].value, 0 );
-                std_assert_m ( len > 0 && len < 32 );
-                std_stack_string_append ( &stack, u32_buffer );
-            }
-
-            for ( size_t i = 0; i < params->shader_definition_count; ++i ) {
-                args[argc++] = stack.top;
-                std_stack_string_copy ( &stack, "-D" );
-                std_stack_string_append ( &stack, params->global_definitions[i].name );
-                std_stack_string_append ( &stack, "=" );
-                size_t len = std_u32_to_str ( u32_buffer, 32, params->global_definitions[i].value, 0 );
-                std_assert_m ( len > 0 && len < 32 );
-                std_stack_string_append ( &stack, u32_buffer );
-            }
-        }
+    //if ( binary_name_out ) {
+    //    std_str_copy ( binary_name_out, out_cap, binary_name );
+    //}
+
+    char u32_buffer[32];
+
+    for ( size_t i = 0; i < params->global_definition_count; ++i ) {
+        //std_array_push ( &array, 1 );
+        args[argc++] = stack->top;
+        std_stack_string_copy ( stack, "-D" );
+        std_stack_string_append ( stack, params->global_definitions[i].name );
+        std_stack_string_append ( stack, "=" );
+        size_t len = std_u32_to_str ( u32_buffer, 32, params->global_definitions[i].value, 0 );
+        std_assert_m ( len > 0 && len < 32 );
+        std_stack_string_append ( stack, u32_buffer );
+    }
+
+    for ( size_t i = 0; i < params->shader_definition_count; ++i ) {
+        args[argc++] = stack->top;
+        std_stack_string_copy ( stack, "-D" );
+        std_stack_string_append ( stack, params->shader_definitions[i].name );
+        std_stack_string_append ( stack, "=" );
+        size_t len = std_u32_to_str ( u32_buffer, 32, params->shader_definitions[i].value, 0 );
+        std_assert_m ( len > 0 && len < 32 );
+        std_stack_string_append ( stack, u32_buffer );
+    }
+
+    return argc;
+}
+
+std_process_h xs_shader_compiler_launch ( const xs_shader_compiler_params_t* params ) {
+    char executable[std_process_path_max_len_m];
+    std_str_copy ( executable, std_process_path_max_len_m, std_pp_eval_string_m ( std_binding_shader_compiler_m ) );
+
+    const char* args[std_process_max_args_m];
+    char args_buffer[std_process_args_max_len_m] = {0};
+    std_stack_t stack = std_static_stack_m ( args_buffer );
+    size_t argc = xs_shader_compiler_args ( args, &stack, params );
+
+    return std_process ( executable, "xs-glslc", args, argc, std_process_type_default_m, std_process_io_capture_m );
+}
+
+bool xs_shader_compiler_wait ( std_process_h compiler ) {
+    if ( compiler == std_process_null_handle_m ) {
+        return false;
     }
 
     bool result = true;
-    std_process_h compiler = std_process ( executable, "xs-glslc", args, argc, std_process_type_default_m, std_process_io_capture_m );
     std_process_io_t compiler_io = std_process_get_io ( compiler );
     {
         bool wait_result = std_process_wait_for ( compiler );
@@ -159,3 +167,65 @@ bool xs_shader_compiler_compile ( const xs_shader_compiler_params_t* params ) {
 
     return result;
 }
+
+bool xs_shader_compiler_compile ( const xs_shader_compiler_params_t* params ) {
+    std_process_h compiler = xs_shader_compiler_launch ( params );
+    return xs_shader_compiler_wait ( compiler );
+}
+
+// The version is queried once and then kept around, the compiler executable is not expected to change while running
+static uint64_t xs_shader_compiler_version_hash = 0;
+
+static uint64_t xs_shader_compiler_version ( void ) {
+    if ( xs_shader_compiler_version_hash != 0 ) {
+        return xs_shader_compiler_version_hash;
+    }
+
+    char executable[std_process_path_max_len_m];
+    std_str_copy ( executable, std_process_path_max_len_m, std_pp_eval_string_m ( std_binding_shader_compiler_m ) );
+
+    const char* args[1] = { "--version" };
+    std_process_h compiler = std_process ( executable, "xs-glslc", args, 1, std_process_type_default_m, std_process_io_capture_m );
+
+    char output[std_process_cmdline_max_len_m] = { 0 };
+    size_t read_size = 0;
+
+    if ( compiler != std_process_null_handle_m && std_process_wait_for ( compiler ) ) {
+        std_process_io_t compiler_io = std_process_get_io ( compiler );
+        std_process_io_read ( output, &read_size, std_process_cmdline_max_len_m, compiler_io.stdout_handle );
+    }
+
+    if ( read_size > 0 ) {
+        xs_shader_compiler_version_hash = std_hash_block_64_m ( output, read_size );
+    } else {
+        std_log_warn_m ( "Failed to query the shader compiler version, falling back to the executable path" );
+        xs_shader_compiler_version_hash = std_hash_string_64_m ( executable );
+    }
+
+    return xs_shader_compiler_version_hash;
+}
+
+uint64_t xs_shader_compiler_options_hash ( const xs_shader_compiler_params_t* params ) {
+    // Leave the paths out, they would make the hash depend on where the tree is located. The content of the included files
+    // is expected to be hashed separately by the caller.
+    xs_shader_compiler_params_t options = *params;
+    options.shader_path = "";
+    options.binary_path = "";
+
+    const char* args[std_process_max_args_m];
+    char args_buffer[std_process_args_max_len_m] = {0};
+    std_stack_t stack = std_static_stack_m ( args_buffer );
+    size_t argc = xs_shader_compiler_args ( args, &stack, &options );
+
+    uint64_t hashes[std_process_max_args_m + 1];
+    uint32_t hash_count = 0;
+    hashes[hash_count++] = xs_shader_compiler_version();
+
+    for ( size_t i = 0; i < argc; ++i ) {
+        if ( !std_str_starts_with ( args[i], "-I" ) ) {
+            hashes[hash_count++] = std_hash_string_64_m ( args[i] );
+        }
+    }
+
+    return std_hash_block_64_m ( hashes, sizeof ( uint64_t ) * hash_count );
+}
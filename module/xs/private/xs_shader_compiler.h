@@ -2,6 +2,10 @@
 
 #include <xs.h>
 
+#include <std_process.h>
+
+#define xs_shader_compiler_include_path_m std_module_path_m "public/shader/"
+
 typedef struct {
     const char* binary_path;
     const char* shader_path;
@@ -11,4 +15,12 @@ typedef struct {
     uint32_t shader_definition_count;
 } xs_shader_compiler_params_t;
 
-bool xs_shader_compiler_compile ( const xs_shader_compiler_params_t* params  );
+// Launch spawns the compiler process and returns without waiting on it, multiple compilers can be in flight at once.
+// Wait blocks until the process exits and returns false if the compiler failed or output any warning or error.
+std_process_h xs_shader_compiler_launch ( const xs_shader_compiler_params_t* params );
+bool xs_shader_compiler_wait ( std_process_h compiler );
+bool xs_shader_compiler_compile ( const xs_shader_compiler_params_t* params );
+
+// Hash of everything other than the source that affects the compiler output: compiler version, target env, optimization
+// level and definitions. Shader and binary paths are ignored.
+uint64_t xs_shader_compiler_options_hash ( const xs_shader_compiler_params_t* params );
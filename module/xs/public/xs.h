@@ -181,6 +181,8 @@ typedef struct {
     uint32_t successful_pipeline_states;
     uint32_t failed_pipeline_states;
     uint32_t skipped_pipeline_states;
+    float compile_time_ms;  // Time spent waiting on the shader compiler processes
+    float total_time_ms;
 } xs_database_build_result_t;
 
 #define xs_database_build_result_m( ... ) ( xs_database_build_result_t ) { \
@@ -190,6 +192,8 @@ typedef struct {
     .successful_pipeline_states = 0, \
     .failed_pipeline_states = 0, \
     .skipped_pipeline_states = 0, \
+    .compile_time_ms = 0, \
+    .total_time_ms = 0, \
 }
 
 typedef struct {
@@ -327,9 +331,18 @@ typedef struct {
 
     bool ( *add_database_folder ) ( xs_database_h database, const char* path );
     bool ( *set_output_folder ) ( xs_database_h database, const char* path );
+    // Compiled shaders are cached by content hash. The cache defaults to the output folder and can be shared by multiple
+    // databases and apps, e.g. by pointing them all to the same local folder.
+    bool ( *set_cache_folder ) ( xs_database_h database, const char* path );
     void ( *clear_database ) ( xs_database_h database );
     void ( *set_build_params ) ( xs_database_h database, const xs_database_build_params_t* params );
+    // Builds on the calling thread. The new pipelines are visible on return, unless the ones replaced by the previous
+    // build are still in flight. In that case they get published by a later update_pipeline_states call.
     xs_database_build_result_t ( *build_database ) ( xs_database_h database );
+    // Builds on a background thread. Rendering keeps using the current pipelines, the new ones are published all at once
+    // by the first update_pipeline_states call after the build is done.
+    void ( *build_database_async ) ( xs_database_h database );
+    // Calls build_database_async on all databases
     void ( *rebuild_databases ) ( void );
 
     // TODO go hash->fx and fx->technique(pipeline state) instead of hash->pipeline state
@@ -337,6 +350,8 @@ typedef struct {
     xg_graphics_pipeline_state_h ( *get_pipeline_state ) ( xs_database_pipeline_h xs_state );
     //void ( *release_pipeline_state ) ( xg_graphics_pipeline_state_h pipeline );
 
+    // Call once per frame, after submitting the frame workload. Destroys replaced pipelines once the GPU is done with
+    // them and publishes the output of finished background builds.
     void ( *update_pipeline_states ) ( xg_workload_h workload );
 } xs_i;
 
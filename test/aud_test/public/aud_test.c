@@ -2,8 +2,15 @@
 
 #include <std_thread.h>
 #include <std_time.h>
+#include <std_allocator.h>
+#include <std_byte.h>
+#include <std_process.h>
+#include <std_string.h>
+
+#include <math.h>
 
 #include <aud.h>
+#include <fs.h>
 
 // http://countercomplex.blogspot.com/2011/10/algorithmic-symphonies-from-one-line-of.html
 static void write_source_wave ( char* buffer, size_t size, uint32_t id ) {
@@ -28,13 +35,434 @@ static void write_source_wave ( char* buffer, size_t size, uint32_t id ) {
     }
 }
 
+#define test_mixer_frequency_m 48000
+#define test_mixer_frame_count_m 4800
+// Edges are off by design, the filter starts and ends on silence outside the source data
+#define test_mixer_edge_frames_m 64
+#define test_mixer_pi_m 3.14159265358979323846
+
+typedef struct {
+    uint64_t sample_frequency;
+    uint64_t bits_per_sample;
+    double tone_frequency;
+    double amplitude;
+    float volume;
+} test_mixer_tone_t;
+
+static void test_mixer_write_tone ( char* buffer, uint64_t frame_count, const test_mixer_tone_t* tone ) {
+    for ( uint64_t i = 0; i < frame_count; ++i ) {
+        double value = tone->amplitude * sin ( 2 * test_mixer_pi_m * tone->tone_frequency * i / tone->sample_frequency );
+
+        switch ( tone->bits_per_sample ) {
+            case 8:
+                buffer[i] = ( char ) ( uint8_t ) ( lrint ( value * 127 ) + 128 );
+                break;
+
+            case 16:
+                ( ( int16_t* ) buffer ) [i] = ( int16_t ) lrint ( value * 32767 );
+                break;
+
+            case 24: {
+                int32_t sample = ( int32_t ) lrint ( value * 8388607 );
+                buffer[i * 3] = ( char ) sample;
+                buffer[i * 3 + 1] = ( char ) ( sample >> 8 );
+                buffer[i * 3 + 2] = ( char ) ( sample >> 16 );
+            } break;
+
+            case 32:
+                ( ( int32_t* ) buffer ) [i] = ( int32_t ) lrint ( value * 2147483647.0 );
+                break;
+        }
+    }
+}
+
+static aud_source_h test_mixer_create_tone_source ( const test_mixer_tone_t* tone, uint64_t duration_ms ) {
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
+
+    aud_source_params_t params;
+    params.sample_frequency = tone->sample_frequency;
+    params.bits_per_sample = tone->bits_per_sample;
+    params.capacity_ms = duration_ms;
+    aud_source_h source = aud->create_source ( &params );
+
+    uint64_t frame_count = duration_ms * tone->sample_frequency / 1000;
+    char* buffer = std_virtual_heap_alloc_array_m ( char, frame_count * tone->bits_per_sample / 8 );
+    test_mixer_write_tone ( buffer, frame_count, tone );
+    aud->feed_source ( source, buffer, frame_count * tone->bits_per_sample / 8 );
+    aud->set_source_volume ( source, tone->volume );
+    std_virtual_heap_free ( buffer );
+
+    return source;
+}
+
+// Sine tones in every source format, resampled from lower and higher rates, mixed offline and compared against the
+// same tones computed directly at the output rate
+static void test_mixer_reference ( void ) {
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
+
+    test_mixer_tone_t tones[] = {
+        { .sample_frequency = 44100, .bits_per_sample = 16, .tone_frequency = 440, .amplitude = 0.5, .volume = 0.5f },
+        { .sample_frequency = 22050, .bits_per_sample = 8, .tone_frequency = 1000, .amplitude = 0.8, .volume = 0.3f },
+        { .sample_frequency = 48000, .bits_per_sample = 24, .tone_frequency = 3000, .amplitude = 0.5, .volume = 0.4f },
+        { .sample_frequency = 96000, .bits_per_sample = 32, .tone_frequency = 5000, .amplitude = 0.5, .volume = 0.25f },
+    };
+    const uint32_t tone_count = std_static_array_capacity_m ( tones );
+
+    aud_source_h sources[std_static_array_capacity_m ( tones )];
+
+    for ( uint32_t i = 0; i < tone_count; ++i ) {
+        sources[i] = test_mixer_create_tone_source ( &tones[i], 1000 );
+    }
+
+    aud_device_params_t format;
+    format.channels = 2;
+    format.sample_frequency = test_mixer_frequency_m;
+    format.bits_per_sample = 16;
+
+    int16_t* output = std_virtual_heap_alloc_array_m ( int16_t, test_mixer_frame_count_m * 2 );
+    // In two calls, the second picks up where the first left the sources
+    aud->mix_sources ( output, &format, test_mixer_frame_count_m / 3, sources, tone_count );
+    aud->mix_sources ( output + test_mixer_frame_count_m / 3 * 2, &format, test_mixer_frame_count_m - test_mixer_frame_count_m / 3, sources, tone_count );
+
+    double max_error = 0;
+    double error_power = 0;
+    double signal_power = 0;
+
+    for ( uint64_t i = test_mixer_edge_frames_m; i < test_mixer_frame_count_m - test_mixer_edge_frames_m; ++i ) {
+        double reference = 0;
+
+        for ( uint32_t j = 0; j < tone_count; ++j ) {
+            reference += tones[j].volume * tones[j].amplitude * sin ( 2 * test_mixer_pi_m * tones[j].tone_frequency * i / test_mixer_frequency_m );
+        }
+
+        std_assert_m ( output[i * 2] == output[i * 2 + 1] );
+        double error = output[i * 2] / 32767.0 - reference;
+        max_error = std_max_f64 ( max_error, fabs ( error ) );
+        error_power += error * error;
+        signal_power += reference * reference;
+    }
+
+    double snr = 10 * log10 ( signal_power / error_power );
+    std_log_info_m ( "Mixer reference: max error " std_fmt_f32_dec_m ( 5 ) ", SNR " std_fmt_f32_dec_m ( 1 ) "dB", ( float ) max_error, ( float ) snr );
+    std_assert_m ( max_error < 0.01 );
+    std_assert_m ( snr > 40 );
+
+    // Too loud, has to clip instead of wrapping around
+    aud->reset_source ( sources[0] );
+    aud->set_source_volume ( sources[0], 4 );
+    aud->mix_sources ( output, &format, test_mixer_frame_count_m, sources, 1 );
+
+    for ( uint64_t i = test_mixer_edge_frames_m; i < test_mixer_frame_count_m - test_mixer_edge_frames_m; ++i ) {
+        double reference = sin ( 2 * test_mixer_pi_m * tones[0].tone_frequency * i / test_mixer_frequency_m );
+
+        // Full scale give or take the dither step, with the sign of the reference
+        if ( reference > 0.6 ) {
+            std_assert_m ( output[i * 2] >= 32766 );
+        } else if ( reference < -0.6 ) {
+            std_assert_m ( output[i * 2] <= -32766 );
+        }
+    }
+
+    for ( uint32_t i = 0; i < tone_count; ++i ) {
+        aud->destroy_source ( sources[i] );
+    }
+
+    std_virtual_heap_free ( output );
+}
+
+#define test_mixer_benchmark_voice_count_m 64
+#define test_mixer_benchmark_duration_ms_m 10000
+#define test_mixer_benchmark_block_ms_m 10
+
+static void test_mixer_benchmark ( void ) {
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
+
+    aud_source_h sources[test_mixer_benchmark_voice_count_m];
+
+    for ( uint32_t i = 0; i < test_mixer_benchmark_voice_count_m; ++i ) {
+        test_mixer_tone_t tone = { .sample_frequency = 44100, .bits_per_sample = 16, .tone_frequency = 100 + i * 50, .amplitude = 0.5, .volume = 1.f / test_mixer_benchmark_voice_count_m };
+        sources[i] = test_mixer_create_tone_source ( &tone, test_mixer_benchmark_duration_ms_m );
+    }
+
+    aud_device_params_t format;
+    format.channels = 2;
+    format.sample_frequency = test_mixer_frequency_m;
+    format.bits_per_sample = 16;
+
+    uint64_t block_frame_count = test_mixer_benchmark_block_ms_m * test_mixer_frequency_m / 1000;
+    int16_t* output = std_virtual_heap_alloc_array_m ( int16_t, block_frame_count * 2 );
+
+    std_tick_t start = std_tick_now();
+
+    for ( uint32_t i = 0; i < test_mixer_benchmark_duration_ms_m / test_mixer_benchmark_block_ms_m; ++i ) {
+        aud->mix_sources ( output, &format, block_frame_count, sources, test_mixer_benchmark_voice_count_m );
+    }
+
+    float elapsed_ms = std_tick_to_milli_f32 ( std_tick_now() - start );
+    // How many milliseconds of a single voice get mixed per millisecond of CPU time, or how many voices one core
+    // could keep mixing in real time
+    float voices_per_ms = test_mixer_benchmark_voice_count_m * ( float ) test_mixer_benchmark_duration_ms_m / elapsed_ms;
+    std_log_info_m ( "Mixer benchmark: " std_fmt_u32_m " voices 44.1kHz to 48kHz, " std_fmt_u32_m "ms mixed in " std_fmt_f32_dec_m ( 2 ) "ms, " std_fmt_f32_dec_m ( 0 ) " voices/ms",
+        test_mixer_benchmark_voice_count_m, test_mixer_benchmark_duration_ms_m, elapsed_ms, voices_per_ms );
+
+    for ( uint32_t i = 0; i < test_mixer_benchmark_voice_count_m; ++i ) {
+        aud->destroy_source ( sources[i] );
+    }
+
+    std_virtual_heap_free ( output );
+}
+
+// Same tables as the decoder, the test encodes its own files
+static const int16_t test_stream_ima_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107,
+    118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894,
+    6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t test_stream_ima_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+#define test_stream_block_align_m 512
+#define test_stream_block_frames_m ( 1 + ( test_stream_block_align_m - 4 ) * 2 )
+#define test_stream_frequency_m 44100
+
+static void test_stream_write_u16 ( uint8_t* dest, uint32_t value ) {
+    dest[0] = ( uint8_t ) value;
+    dest[1] = ( uint8_t ) ( value >> 8 );
+}
+
+static void test_stream_write_u32 ( uint8_t* dest, uint32_t value ) {
+    test_stream_write_u16 ( dest, value );
+    test_stream_write_u16 ( dest + 2, value >> 16 );
+}
+
+static void test_stream_encode_ima_block ( uint8_t* block, const int16_t* samples, int32_t* index ) {
+    int32_t predictor = samples[0];
+    test_stream_write_u16 ( block, ( uint16_t ) samples[0] );
+    block[2] = ( uint8_t ) *index;
+    block[3] = 0;
+
+    for ( uint32_t i = 1; i < test_stream_block_frames_m; ++i ) {
+        int32_t step = test_stream_ima_step_table[*index];
+        int32_t diff = samples[i] - predictor;
+        uint32_t nibble = diff < 0 ? 8 : 0;
+        diff = diff < 0 ? -diff : diff;
+
+        for ( uint32_t bit = 4; bit > 0; bit >>= 1 ) {
+            if ( diff >= step ) {
+                nibble |= bit;
+                diff -= step;
+            }
+
+            step >>= 1;
+        }
+
+        // Step the predictor the same way the decoder will
+        step = test_stream_ima_step_table[*index];
+        int32_t delta = ( step >> 3 ) + ( nibble & 4 ? step : 0 ) + ( nibble & 2 ? step >> 1 : 0 ) + ( nibble & 1 ? step >> 2 : 0 );
+        predictor += nibble & 8 ? -delta : delta;
+        predictor = std_min_i32 ( std_max_i32 ( predictor, -32768 ), 32767 );
+        *index = std_min_i32 ( std_max_i32 ( *index + test_stream_ima_index_table[nibble], 0 ), 88 );
+
+        uint8_t* byte = &block[4 + ( i - 1 ) / 2];
+        *byte = ( i - 1 ) % 2 == 0 ? ( uint8_t ) nibble : ( uint8_t ) ( *byte | nibble << 4 );
+    }
+}
+
+// Mono IMA ADPCM WAV of a sine tone, a whole number of blocks long
+static void test_stream_write_wav ( const char* path, double tone_frequency, double amplitude, uint64_t block_count ) {
+    fs_i* fs = std_module_get_m ( fs_module_name_m );
+
+    uint64_t data_size = block_count * test_stream_block_align_m;
+    uint8_t* file_data = std_virtual_heap_alloc_array_m ( uint8_t, 48 + data_size );
+
+    std_mem_copy ( file_data, "RIFF", 4 );
+    test_stream_write_u32 ( file_data + 4, ( uint32_t ) ( 40 + data_size ) );
+    std_mem_copy ( file_data + 8, "WAVEfmt ", 8 );
+    test_stream_write_u32 ( file_data + 16, 20 );
+    test_stream_write_u16 ( file_data + 20, 0x11 );
+    test_stream_write_u16 ( file_data + 22, 1 );
+    test_stream_write_u32 ( file_data + 24, test_stream_frequency_m );
+    test_stream_write_u32 ( file_data + 28, test_stream_frequency_m * test_stream_block_align_m / test_stream_block_frames_m );
+    test_stream_write_u16 ( file_data + 32, test_stream_block_align_m );
+    test_stream_write_u16 ( file_data + 34, 4 );
+    test_stream_write_u16 ( file_data + 36, 2 );
+    test_stream_write_u16 ( file_data + 38, test_stream_block_frames_m );
+    std_mem_copy ( file_data + 40, "data", 4 );
+    test_stream_write_u32 ( file_data + 44, ( uint32_t ) data_size );
+
+    int16_t samples[test_stream_block_frames_m];
+    int32_t index = 0;
+
+    for ( uint64_t block = 0; block < block_count; ++block ) {
+        for ( uint64_t i = 0; i < test_stream_block_frames_m; ++i ) {
+            uint64_t t = block * test_stream_block_frames_m + i;
+            samples[i] = ( int16_t ) lrint ( amplitude * 32767 * sin ( 2 * test_mixer_pi_m * tone_frequency * t / test_stream_frequency_m ) );
+        }
+
+        test_stream_encode_ima_block ( file_data + 48 + block * test_stream_block_align_m, samples, &index );
+    }
+
+    fs_file_h file = fs->create_file ( path, fs_file_write_m, fs_already_existing_overwrite_m );
+    std_verify_m ( file != fs_null_handle_m );
+    fs->write_file ( file, file_data, 48 + data_size );
+    fs->close_file ( file );
+
+    std_virtual_heap_free ( file_data );
+}
+
+#define test_stream_count_m 32
+#define test_stream_block_ms_m 10
+#define test_stream_duration_ms_m 2000
+
+// Past the play position, covers what the resampler reads ahead of it
+#define test_stream_decode_margin_frames_m 64
+// A hiccup of the worker starves every stream at once, a couple are tolerated when pacing in real time
+#define test_stream_max_starved_m ( 2 * test_stream_count_m )
+#define test_stream_decode_timeout_ms_m 5000
+
+typedef enum {
+    // Each block waits for the worker to have decoded what it's going to mix, nothing ever starves
+    test_stream_pace_decoder_m,
+    // Blocks are mixed at the pace they'd play on a device, the worker has to keep up in real time
+    test_stream_pace_realtime_m,
+} test_stream_pace_e;
+
+static void test_stream_wait_decoded ( const aud_source_h* sources, uint64_t count, uint64_t frame_count ) {
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
+    std_tick_t start = std_tick_now();
+
+    for ( uint64_t i = 0; i < count; ++i ) {
+        for ( ;; ) {
+            aud_stream_info_t info;
+            aud->get_stream_info ( &info, sources[i] );
+
+            if ( info.decoded_frames >= frame_count ) {
+                break;
+            }
+
+            std_assert_m ( std_tick_to_milli_f32 ( std_tick_now() - start ) < test_stream_decode_timeout_ms_m );
+            std_thread_this_sleep ( 1 );
+        }
+    }
+}
+
+static void test_stream_play ( int16_t* output, const aud_source_h* sources, uint64_t count, test_stream_pace_e pace ) {
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
+
+    aud_device_params_t format;
+    format.channels = 1;
+    format.sample_frequency = test_mixer_frequency_m;
+    format.bits_per_sample = 16;
+
+    uint64_t block_frame_count = test_stream_block_ms_m * test_mixer_frequency_m / 1000;
+    std_tick_t start = std_tick_now();
+
+    for ( uint64_t i = 0; i < test_stream_duration_ms_m / test_stream_block_ms_m; ++i ) {
+        if ( pace == test_stream_pace_decoder_m ) {
+            uint64_t source_frame_count = ( i + 1 ) * test_stream_block_ms_m * test_stream_frequency_m / 1000;
+            test_stream_wait_decoded ( sources, count, source_frame_count + test_stream_decode_margin_frames_m );
+        }
+
+        aud->mix_sources ( output + i * block_frame_count, &format, block_frame_count, sources, count );
+
+        float elapsed_ms = std_tick_to_milli_f32 ( std_tick_now() - start );
+        float next_ms = ( float ) ( ( i + 1 ) * test_stream_block_ms_m );
+
+        if ( pace == test_stream_pace_realtime_m && elapsed_ms < next_ms ) {
+            std_thread_this_sleep ( ( size_t ) ( next_ms - elapsed_ms ) );
+        }
+    }
+}
+
+static void test_stream ( void ) {
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
+    fs_i* fs = std_module_load_m ( fs_module_name_m );
+
+    std_process_info_t process_info;
+    std_process_info ( &process_info, std_process_this() );
+    char path[1024];
+    std_str_copy ( path, 1024, process_info.working_path );
+    fs->append_path ( path, 1024, "aud_stream_test.wav" );
+
+    // Longer than the duration, the track is never over during the test
+    uint64_t block_count = ( test_stream_duration_ms_m + 500 ) * test_stream_frequency_m / 1000 / test_stream_block_frames_m;
+    test_stream_write_wav ( path, 440, 0.5, block_count );
+
+    uint64_t output_frame_count = test_stream_duration_ms_m * test_mixer_frequency_m / 1000;
+    int16_t* output = std_virtual_heap_alloc_array_m ( int16_t, output_frame_count );
+
+    // One stream against the tone it was encoded from
+    {
+        aud_source_h source = aud->create_stream_source ( &( aud_stream_params_t ) { .path = path, .loop = false } );
+        std_assert_m ( source != aud_null_handle_m );
+        test_stream_play ( output, &source, 1, test_stream_pace_decoder_m );
+
+        double max_error = 0;
+
+        for ( uint64_t i = test_mixer_edge_frames_m; i < output_frame_count; ++i ) {
+            double reference = 0.5 * sin ( 2 * test_mixer_pi_m * 440 * i / test_mixer_frequency_m );
+            max_error = std_max_f64 ( max_error, fabs ( output[i] / 32767.0 - reference ) );
+        }
+
+        aud_stream_info_t info;
+        aud->get_stream_info ( &info, source );
+        std_log_info_m ( "Stream: max error " std_fmt_f32_dec_m ( 4 ) ", " std_fmt_u64_m " bytes, starved " std_fmt_u64_m " times", ( float ) max_error, info.memory_size, info.starved_count );
+        std_assert_m ( max_error < 0.02 );
+        std_assert_m ( info.starved_count == 0 );
+        std_assert_m ( info.memory_size < 64 * 1024 );
+
+        aud->destroy_source ( source );
+    }
+
+    // Many at once, looping
+    {
+        aud_source_h sources[test_stream_count_m];
+
+        for ( uint32_t i = 0; i < test_stream_count_m; ++i ) {
+            sources[i] = aud->create_stream_source ( &( aud_stream_params_t ) { .path = path, .loop = true } );
+            std_assert_m ( sources[i] != aud_null_handle_m );
+            aud->set_source_volume ( sources[i], 1.f / test_stream_count_m );
+        }
+
+        test_stream_play ( output, sources, test_stream_count_m, test_stream_pace_realtime_m );
+
+        double decode_ms = 0;
+        uint64_t starved_count = 0;
+
+        for ( uint32_t i = 0; i < test_stream_count_m; ++i ) {
+            aud_stream_info_t info;
+            aud->get_stream_info ( &info, sources[i] );
+            decode_ms += info.decode_ms;
+            starved_count += info.starved_count;
+            aud->destroy_source ( sources[i] );
+        }
+
+        // Decode time over audio time, for a single stream
+        double cpu = decode_ms / test_stream_count_m / test_stream_duration_ms_m * 100;
+        std_log_info_m ( "Streams: " std_fmt_u32_m " IMA ADPCM streams, " std_fmt_f32_dec_m ( 4 ) "%% CPU per stream, starved " std_fmt_u64_m " times",
+            test_stream_count_m, ( float ) cpu, starved_count );
+        std_assert_m ( starved_count <= test_stream_max_starved_m );
+    }
+
+    std_virtual_heap_free ( output );
+    fs->delete_file_path ( path );
+}
+
 static void run_aud_test ( void ) {
-    aud_i* aud = std_module_load_m ( aud_module_name_m );
-    std_assert_m ( aud );
+    aud_i* aud = std_module_get_m ( aud_module_name_m );
 
     size_t device_count = aud->get_devices_count();
     std_log_info_m ( "Device count: " std_fmt_size_m, device_count );
 
+    if ( device_count == 0 ) {
+        return;
+    }
+
     aud_device_h devices[aud_device_max_devices_m];
     aud->get_devices ( devices, aud_device_max_devices_m );
 
@@ -101,20 +529,16 @@ static void run_aud_test ( void ) {
     aud->play_source ( source1 );
     aud->set_source_volume ( source1, 0.2f );
 
-    const std_ring_t* device_ring = aud->get_device_ring ( device );
-    uint64_t ring_capacity = std_ring_capacity ( device_ring );
-
     aud_source_info_t source_info;
     aud->get_source_info ( &source_info, source0 );
 
     bool first_print = true;
     uint64_t step_ms = 50;
 
-    while ( true ) {
+    // The device thread does the mixing, all that's left here is watching
+    while ( source_info.time_played < 60 ) {
         aud->get_source_info ( &source_info, source0 );
-
-        aud->update_device_ring ( device );
-        uint64_t ring_count = std_ring_count ( device_ring );
+        aud->get_device_info ( &info, device );
 
         {
             char bar[100];
@@ -143,22 +567,26 @@ static void run_aud_test ( void ) {
 
             first_print = false;
 
-            std_log_m ( 0, std_fmt_str_m std_fmt_prevline_m std_fmt_str_m " " std_fmt_u64_pad_m ( 2 ) "/" std_fmt_u64_m, prefix, bar, ring_count, ring_capacity );
+            std_log_m ( 0, std_fmt_str_m std_fmt_prevline_m std_fmt_str_m " underruns: " std_fmt_u64_m, prefix, bar, info.underrun_count );
         }
 
-        if ( source_info.time_played < 60 ) {
-            if ( ring_count < ring_capacity ) {
-                aud->output_to_device ( device, step_ms );
-            }
-        } else if ( ring_count == 0 ) {
-            break;
-        }
-
-        std_thread_this_sleep ( step_ms / 2 );
+        std_thread_this_sleep ( step_ms );
     }
+
+    aud->destroy_source ( source0 );
+    aud->destroy_source ( source1 );
+
+    bool result = aud->deactivate_device ( device );
+    std_assert_m ( result );
 }
 
 void std_main ( void ) {
+    aud_i* aud = std_module_load_m ( aud_module_name_m );
+    std_assert_m ( aud );
+
+    test_mixer_reference();
+    test_mixer_benchmark();
+    test_stream();
     run_aud_test();
     std_log_info_m ( "aud_test_m COMPLETE!" );
 }
@@ -2,9 +2,29 @@
 
 #include <std_process.h>
 #include <std_log.h>
+#include <std_hash.h>
+#include <std_time.h>
 
 #include <fs.h>
 
+#if defined(std_platform_linux_m)
+    #include <fcntl.h>
+#endif
+
+#define fs_test_io_small_file_count_m 4096
+#define fs_test_io_small_file_size_m ( 16 * 1024 )
+// Creating multi GB files takes a while and the disk space, flip this on to also benchmark large reads
+#define fs_test_io_large_files_m 0
+#define fs_test_io_large_file_count_m 2
+#define fs_test_io_large_file_size_m ( 2ull << 30 )
+#define fs_test_io_chunk_size_m ( 1024 * 1024 )
+// Keeping too many chunks of a large file in flight defeats the kernel readahead
+#define fs_test_io_large_in_flight_m 32
+#define fs_test_io_queue_capacity_m 256
+
+#define fs_test_virtual_file_size_m ( 1024ull << 20 )
+#define fs_test_virtual_file_step_size_m ( 1024 * 1024 + 24 )
+
 static void fs_test_run ( void ) {
     fs_i* fs = std_module_load_m ( fs_module_name_m );
     {
@@ -159,7 +179,380 @@ static void fs_test_run ( void ) {
     std_module_unload_m ( fs_module_name_m );
 }
 
+static uint64_t fs_test_io_checksum ( const void* data, uint64_t size ) {
+    const uint64_t* words = ( const uint64_t* ) data;
+    uint64_t sum = 0;
+
+    for ( uint64_t i = 0; i < size / 8; ++i ) {
+        sum += words[i] * ( 2 * i + 1 );
+    }
+
+    return sum;
+}
+
+static void fs_test_io_fill ( void* data, uint64_t size, uint64_t seed ) {
+    uint64_t* words = ( uint64_t* ) data;
+
+    for ( uint64_t i = 0; i < size / 8; ++i ) {
+        words[i] = std_hash_64_m ( seed + i );
+    }
+}
+
+// Writes back and drops the file from the page cache, otherwise both paths would just read from memory
+static void fs_test_io_evict ( const char* path ) {
+#if defined(std_platform_linux_m)
+    int fd = open ( path, O_RDWR );
+    fsync ( fd );
+    posix_fadvise ( fd, 0, 0, POSIX_FADV_DONTNEED );
+    close ( fd );
+#else
+    std_unused_m ( path );
+#endif
+}
+
+static void fs_test_io_file_path ( char* path, size_t cap, const char* dir, const char* prefix, uint64_t idx ) {
+    std_str_format ( path, cap, std_fmt_str_m "/" std_fmt_str_m std_fmt_u64_m, dir, prefix, idx );
+}
+
+static void fs_test_io_log ( const char* name, uint64_t size, std_tick_t start, uint64_t checksum ) {
+    double ms = std_tick_to_milli_f64 ( std_tick_now() - start );
+    double mb = ( double ) size / ( 1024 * 1024 );
+    std_log_info_m ( std_fmt_tab_m std_fmt_str_m ": " std_fmt_f64_m " ms, " std_fmt_f64_m " MB/s, checksum " std_fmt_u64_m, name, ms, mb / ( ms / 1000 ), checksum );
+}
+
+static void fs_test_io_small_files ( fs_i* fs, const char* dir, fs_io_queue_h queue ) {
+    char path[1024];
+    uint64_t total_size = fs_test_io_small_file_count_m * fs_test_io_small_file_size_m;
+    void* data = std_virtual_heap_alloc_m ( total_size, 16 );
+
+    for ( uint64_t i = 0; i < fs_test_io_small_file_count_m; ++i ) {
+        void* file_data = data + i * fs_test_io_small_file_size_m;
+        fs_test_io_fill ( file_data, fs_test_io_small_file_size_m, i * fs_test_io_small_file_size_m );
+        fs_test_io_file_path ( path, 1024, dir, "small_", i );
+        fs_file_h file = fs->create_file ( path, fs_file_write_m, fs_already_existing_overwrite_m );
+        std_verify_m ( file != fs_null_handle_m );
+        fs->write_file ( file, file_data, fs_test_io_small_file_size_m );
+        fs->close_file ( file );
+    }
+
+    uint64_t expected_checksum = fs_test_io_checksum ( data, total_size );
+    std_log_info_m ( "Reading " std_fmt_u64_m " files of " std_fmt_u64_m " bytes", ( uint64_t ) fs_test_io_small_file_count_m, ( uint64_t ) fs_test_io_small_file_size_m );
+
+    // sync
+    for ( uint64_t i = 0; i < fs_test_io_small_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "small_", i );
+        fs_test_io_evict ( path );
+    }
+
+    std_mem_zero ( data, total_size );
+    std_tick_t start = std_tick_now();
+
+    for ( uint64_t i = 0; i < fs_test_io_small_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "small_", i );
+        fs_file_h file = fs->open_file ( path, fs_file_read_m );
+        uint64_t read_size = fs->read_file ( data + i * fs_test_io_small_file_size_m, fs_test_io_small_file_size_m, file );
+        std_verify_m ( read_size == fs_test_io_small_file_size_m );
+        fs->close_file ( file );
+    }
+
+    uint64_t checksum = fs_test_io_checksum ( data, total_size );
+    fs_test_io_log ( "sync", total_size, start, checksum );
+    std_verify_m ( checksum == expected_checksum );
+
+    // async, files are kept open only while their read is in flight
+    for ( uint64_t i = 0; i < fs_test_io_small_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "small_", i );
+        fs_test_io_evict ( path );
+    }
+
+    std_mem_zero ( data, total_size );
+    start = std_tick_now();
+    uint64_t submit_count = 0;
+    uint64_t complete_count = 0;
+    fs_file_h* files = std_virtual_heap_alloc_array_m ( fs_file_h, fs_test_io_small_file_count_m );
+
+    while ( complete_count < fs_test_io_small_file_count_m ) {
+        fs_io_read_t reads[64];
+        size_t read_count = 0;
+
+        while ( read_count < 64 && submit_count + read_count < fs_test_io_small_file_count_m && submit_count + read_count - complete_count < fs_test_io_queue_capacity_m ) {
+            uint64_t idx = submit_count + read_count;
+            fs_test_io_file_path ( path, 1024, dir, "small_", idx );
+            files[idx] = fs->open_file ( path, fs_file_read_m );
+            reads[read_count++] = ( fs_io_read_t ) {
+                .file = files[idx],
+                .offset = 0,
+                .size = fs_test_io_small_file_size_m,
+                .dest = data + idx * fs_test_io_small_file_size_m,
+                .user_data = ( void* ) idx,
+            };
+        }
+
+        submit_count += fs->submit_reads ( queue, NULL, reads, read_count );
+
+        fs_io_completion_t completions[64];
+        size_t count = fs->wait_io_queue ( queue, completions, 64, 1 );
+
+        for ( size_t i = 0; i < count; ++i ) {
+            std_verify_m ( completions[i].read_size == fs_test_io_small_file_size_m );
+            fs->close_file ( files[( uint64_t ) completions[i].user_data] );
+        }
+
+        complete_count += count;
+    }
+
+    checksum = fs_test_io_checksum ( data, total_size );
+    fs_test_io_log ( "async", total_size, start, checksum );
+    std_verify_m ( checksum == expected_checksum );
+
+    for ( uint64_t i = 0; i < fs_test_io_small_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "small_", i );
+        fs->delete_file_path ( path );
+    }
+
+    std_virtual_heap_free ( files );
+    std_virtual_heap_free ( data );
+}
+
+static void fs_test_io_large_files ( fs_i* fs, const char* dir, fs_io_queue_h queue ) {
+    char path[1024];
+    uint64_t chunk_count = fs_test_io_large_file_size_m / fs_test_io_chunk_size_m;
+    uint64_t total_size = fs_test_io_large_file_count_m * fs_test_io_large_file_size_m;
+    uint64_t expected_checksum = 0;
+    void* chunks = std_virtual_heap_alloc_m ( fs_test_io_large_in_flight_m * fs_test_io_chunk_size_m, 16 );
+
+    for ( uint64_t i = 0; i < fs_test_io_large_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "large_", i );
+        fs_file_h file = fs->create_file ( path, fs_file_write_m, fs_already_existing_overwrite_m );
+        std_verify_m ( file != fs_null_handle_m );
+
+        for ( uint64_t j = 0; j < chunk_count; ++j ) {
+            fs_test_io_fill ( chunks, fs_test_io_chunk_size_m, ( i * chunk_count + j ) * fs_test_io_chunk_size_m );
+            expected_checksum += fs_test_io_checksum ( chunks, fs_test_io_chunk_size_m );
+            fs->write_file ( file, chunks, fs_test_io_chunk_size_m );
+        }
+
+        fs->close_file ( file );
+    }
+
+    std_log_info_m ( "Reading " std_fmt_u64_m " files of " std_fmt_u64_m " bytes", ( uint64_t ) fs_test_io_large_file_count_m, ( uint64_t ) fs_test_io_large_file_size_m );
+
+    // sync
+    for ( uint64_t i = 0; i < fs_test_io_large_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "large_", i );
+        fs_test_io_evict ( path );
+    }
+
+    std_tick_t start = std_tick_now();
+    uint64_t checksum = 0;
+
+    for ( uint64_t i = 0; i < fs_test_io_large_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "large_", i );
+        fs_file_h file = fs->open_file ( path, fs_file_read_m );
+
+        for ( uint64_t j = 0; j < chunk_count; ++j ) {
+            uint64_t read_size = fs->read_file ( chunks, fs_test_io_chunk_size_m, file );
+            std_verify_m ( read_size == fs_test_io_chunk_size_m );
+            checksum += fs_test_io_checksum ( chunks, fs_test_io_chunk_size_m );
+        }
+
+        fs->close_file ( file );
+    }
+
+    fs_test_io_log ( "sync", total_size, start, checksum );
+    std_verify_m ( checksum == expected_checksum );
+
+    // async, chunks of all files are in flight at the same time, each one owns a slot of the chunks buffer
+    for ( uint64_t i = 0; i < fs_test_io_large_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "large_", i );
+        fs_test_io_evict ( path );
+    }
+
+    fs_file_h files[fs_test_io_large_file_count_m];
+
+    for ( uint64_t i = 0; i < fs_test_io_large_file_count_m; ++i ) {
+        fs_test_io_file_path ( path, 1024, dir, "large_", i );
+        files[i] = fs->open_file ( path, fs_file_read_m );
+    }
+
+    uint64_t free_slots[fs_test_io_large_in_flight_m];
+    uint64_t free_slot_count = fs_test_io_large_in_flight_m;
+
+    for ( uint64_t i = 0; i < fs_test_io_large_in_flight_m; ++i ) {
+        free_slots[i] = i;
+    }
+
+    start = std_tick_now();
+    checksum = 0;
+    uint64_t total_chunk_count = fs_test_io_large_file_count_m * chunk_count;
+    uint64_t submit_count = 0;
+    uint64_t complete_count = 0;
+
+    while ( complete_count < total_chunk_count ) {
+        while ( free_slot_count > 0 && submit_count < total_chunk_count ) {
+            uint64_t slot = free_slots[--free_slot_count];
+            uint64_t file_idx = submit_count % fs_test_io_large_file_count_m;
+            uint64_t chunk_idx = submit_count / fs_test_io_large_file_count_m;
+            fs_io_request_h request = fs->submit_read ( queue, files[file_idx], chunk_idx * fs_test_io_chunk_size_m, fs_test_io_chunk_size_m, chunks + slot * fs_test_io_chunk_size_m, ( void* ) slot );
+            std_verify_m ( request != fs_io_null_request_m );
+            ++submit_count;
+        }
+
+        fs_io_completion_t completions[64];
+        size_t count = fs->wait_io_queue ( queue, completions, 64, 1 );
+
+        for ( size_t i = 0; i < count; ++i ) {
+            uint64_t slot = ( uint64_t ) completions[i].user_data;
+            std_verify_m ( completions[i].read_size == fs_test_io_chunk_size_m );
+            checksum += fs_test_io_checksum ( chunks + slot * fs_test_io_chunk_size_m, fs_test_io_chunk_size_m );
+            free_slots[free_slot_count++] = slot;
+        }
+
+        complete_count += count;
+    }
+
+    fs_test_io_log ( "async", total_size, start, checksum );
+    std_verify_m ( checksum == expected_checksum );
+
+    for ( uint64_t i = 0; i < fs_test_io_large_file_count_m; ++i ) {
+        fs->close_file ( files[i] );
+        fs_test_io_file_path ( path, 1024, dir, "large_", i );
+        fs->delete_file_path ( path );
+    }
+
+    std_virtual_heap_free ( chunks );
+}
+
+static void fs_test_positional_io ( fs_i* fs, const char* dir ) {
+    char path[1024];
+    fs_test_io_file_path ( path, 1024, dir, "positional_", 0 );
+    fs_file_h file = fs->create_file ( path, fs_file_read_m | fs_file_write_m, fs_already_existing_overwrite_m );
+    std_verify_m ( file != fs_null_handle_m );
+
+    uint64_t a[64];
+    uint64_t b[3];
+    uint64_t c[1000];
+    fs_test_io_fill ( a, sizeof ( a ), 0 );
+    fs_test_io_fill ( b, sizeof ( b ), 1000 );
+    fs_test_io_fill ( c, sizeof ( c ), 2000 );
+
+    std_buffer_t gather[] = {
+        std_buffer_m ( .base = a, .size = sizeof ( a ) ),
+        std_buffer_m ( .base = NULL, .size = 0 ),
+        std_buffer_m ( .base = b, .size = sizeof ( b ) ),
+        std_buffer_m ( .base = c, .size = sizeof ( c ) ),
+    };
+    std_verify_m ( fs->write_file_gather ( file, gather, std_static_array_capacity_m ( gather ), 8 ) );
+    std_verify_m ( fs->write_file_at ( file, b, sizeof ( uint64_t ), 0 ) );
+
+    // Split differently from how it was written, and past EOF
+    uint64_t d[3 + 64 + 3];
+    uint64_t e[1000 + 16];
+    std_buffer_t scatter[] = {
+        std_buffer_m ( .base = d, .size = sizeof ( d ) ),
+        std_buffer_m ( .base = e, .size = sizeof ( e ) ),
+    };
+    uint64_t read_size = fs->read_file_scatter ( scatter, std_static_array_capacity_m ( scatter ), file, 0 );
+    std_verify_m ( read_size == 8 + sizeof ( a ) + sizeof ( b ) + sizeof ( c ) );
+    std_verify_m ( std_mem_cmp ( d, b, sizeof ( uint64_t ) ) );
+    std_verify_m ( std_mem_cmp ( d + 1, a, sizeof ( a ) ) );
+    std_verify_m ( std_mem_cmp ( d + 65, b, sizeof ( b ) ) );
+    std_verify_m ( std_mem_cmp ( d + 68, c, sizeof ( uint64_t ) * 2 ) );
+    std_verify_m ( std_mem_cmp ( e, c + 2, sizeof ( c ) - sizeof ( uint64_t ) * 2 ) );
+
+    read_size = fs->read_file_at ( e, sizeof ( c ), file, 8 + sizeof ( a ) + sizeof ( b ) );
+    std_verify_m ( read_size == sizeof ( c ) && std_mem_cmp ( e, c, sizeof ( c ) ) );
+    std_verify_m ( fs->read_file_at ( e, 16, file, 1024 * 1024 ) == 0 );
+
+    fs->close_file ( file );
+    fs->delete_file_path ( path );
+}
+
+// Streams a file much larger than the pending limit, the writer reserves the whole size but only a bounded part of it
+// is ever mapped
+static void fs_test_virtual_file ( fs_i* fs, const char* dir ) {
+    char path[1024];
+    fs_test_io_file_path ( path, 1024, dir, "virtual_", 0 );
+    fs_virtual_file_h file = fs->create_virtual_file ( path, fs_test_virtual_file_size_m );
+    std_verify_m ( file != fs_null_handle_m );
+    std_virtual_stack_t* writer = fs->get_virtual_file_writer ( file );
+
+    std_tick_t start = std_tick_now();
+    uint64_t checksum = 0;
+    uint64_t step_count = 0;
+
+    while ( std_virtual_stack_used_size ( writer ) + fs_test_virtual_file_step_size_m <= fs_test_virtual_file_size_m ) {
+        void* step = std_virtual_stack_alloc ( writer, fs_test_virtual_file_step_size_m );
+        fs_test_io_fill ( step, fs_test_virtual_file_step_size_m, step_count * fs_test_virtual_file_step_size_m );
+        checksum += fs_test_io_checksum ( step, fs_test_virtual_file_step_size_m );
+        std_verify_m ( fs->stream_virtual_file ( file, std_virtual_stack_used_size ( writer ) ) );
+        ++step_count;
+    }
+
+    uint64_t size = std_virtual_stack_used_size ( writer );
+    std_verify_m ( fs->flush_virtual_file ( file ) );
+    fs->close_virtual_file ( file );
+    fs_test_io_log ( "virtual file stream", size, start, checksum );
+
+    fs_file_info_t info;
+    std_verify_m ( fs->get_file_path_info ( &info, path ) );
+    std_verify_m ( info.size == size );
+
+    fs_file_h os_file = fs->open_file ( path, fs_file_read_m );
+    void* step = std_virtual_heap_alloc_m ( fs_test_virtual_file_step_size_m, 16 );
+    uint64_t read_checksum = 0;
+
+    for ( uint64_t i = 0; i < step_count; ++i ) {
+        std_verify_m ( fs->read_file ( step, fs_test_virtual_file_step_size_m, os_file ) == fs_test_virtual_file_step_size_m );
+        read_checksum += fs_test_io_checksum ( step, fs_test_virtual_file_step_size_m );
+    }
+
+    std_verify_m ( read_checksum == checksum );
+    std_virtual_heap_free ( step );
+    fs->close_file ( os_file );
+    fs->delete_file_path ( path );
+}
+
+static void fs_test_io ( void ) {
+    fs_i* fs = std_module_load_m ( fs_module_name_m );
+
+    std_process_info_t process_info;
+    std_process_info ( &process_info, std_process_this() );
+    char dir[1024];
+    std_str_copy ( dir, 1024, process_info.working_path );
+    fs->append_path ( dir, 1024, "fs_io_test" );
+    fs->create_dir ( dir );
+
+    fs_test_positional_io ( fs, dir );
+    fs_test_virtual_file ( fs, dir );
+
+    const char* backend_names[] = { "auto", "io_uring", "thread pool" };
+    fs_io_backend_e backends[] = { fs_io_backend_uring_m, fs_io_backend_thread_pool_m };
+
+    for ( size_t i = 0; i < std_static_array_capacity_m ( backends ); ++i ) {
+        fs_io_queue_h queue = fs->create_io_queue ( &fs_io_queue_params_m ( .capacity = fs_test_io_queue_capacity_m, .backend = backends[i] ) );
+
+        if ( queue == fs_null_handle_m ) {
+            std_log_info_m ( "IO backend " std_fmt_str_m " not available", backend_names[backends[i]] );
+            continue;
+        }
+
+        std_log_info_m ( "IO backend " std_fmt_str_m, backend_names[fs->get_io_queue_backend ( queue )] );
+        fs_test_io_small_files ( fs, dir, queue );
+
+        if ( fs_test_io_large_files_m ) {
+            fs_test_io_large_files ( fs, dir, queue );
+        }
+
+        fs->destroy_io_queue ( queue );
+    }
+
+    fs->delete_dir ( dir );
+    std_module_unload_m ( fs_module_name_m );
+}
+
 void std_main ( void ) {
     fs_test_run();
+    fs_test_io();
     std_log_info_m ( "FS_TEST COMPLETE!" );
 }
@@ -1,12 +1,21 @@
 #include <std_main.h>
 
 #include <net.h>
+#include <tk.h>
 
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <std_log.h>
 #include <std_string.h>
+#include <std_time.h>
+#include <std_allocator.h>
+#include <std_sort.h>
+#include <std_thread.h>
+
+#if defined(std_platform_linux_m)
+    #include <sys/resource.h>
+#endif
 
 std_warnings_ignore_m ( "-Wunused-variable" )
 std_warnings_ignore_m ( "-Wunused-function" )
@@ -60,6 +69,118 @@ static void test_udp_msg ( void ) {
     }
 }
 
+#define test_udp_batch_datagram_count_m 256000
+#define test_udp_batch_datagram_size_m 1200
+#define test_udp_batch_size_m 64
+
+static float test_udp_batch_cpu_time ( void ) {
+#if defined(std_platform_linux_m)
+    struct rusage usage;
+    getrusage ( RUSAGE_SELF, &usage );
+    return ( usage.ru_utime.tv_sec + usage.ru_stime.tv_sec ) * 1000.f + ( usage.ru_utime.tv_usec + usage.ru_stime.tv_usec ) / 1000.f;
+#else
+    return 0;
+#endif
+}
+
+// Loopback throughput, one datagram per call against batched calls. Datagrams are drained after every batch, nothing
+// should get dropped.
+static void test_udp_batch_run ( bool batched ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+
+    net_socket_params_t socket_params;
+    socket_params.family = net_address_family_ip4_m;
+    socket_params.protocol = net_ip_protocol_udp_m;
+    socket_params.is_blocking = false;
+
+    net_socket_address_t sender_address;
+    net->ip_string_to_bytes ( &sender_address.ip, "127.0.0.1", net_address_family_ip4_m );
+    sender_address.port = 777;
+    net_socket_h sender = net->create_socket ( &socket_params );
+    net->bind_socket ( sender, &sender_address );
+
+    net_socket_address_t receiver_address = sender_address;
+    receiver_address.port = 778;
+    net_socket_h receiver = net->create_socket ( &socket_params );
+    net->bind_socket ( receiver, &receiver_address );
+
+    char* buffers = std_virtual_heap_alloc_array_m ( char, test_udp_batch_size_m * test_udp_batch_datagram_size_m * 2 );
+    char* write_buffers = buffers;
+    char* read_buffers = buffers + test_udp_batch_size_m * test_udp_batch_datagram_size_m;
+    std_mem_set ( write_buffers, test_udp_batch_size_m * test_udp_batch_datagram_size_m, 0xab );
+
+    net_datagram_t write_datagrams[test_udp_batch_size_m];
+    net_datagram_t read_datagrams[test_udp_batch_size_m];
+
+    for ( size_t i = 0; i < test_udp_batch_size_m; ++i ) {
+        write_datagrams[i].address = receiver_address;
+        write_datagrams[i].data = write_buffers + i * test_udp_batch_datagram_size_m;
+        write_datagrams[i].size = test_udp_batch_datagram_size_m;
+        read_datagrams[i].data = read_buffers + i * test_udp_batch_datagram_size_m;
+        read_datagrams[i].size = test_udp_batch_datagram_size_m;
+    }
+
+    size_t sent_count = 0;
+    size_t received_count = 0;
+
+    std_tick_t start_tick = std_tick_now();
+    float start_cpu_time = test_udp_batch_cpu_time();
+
+    while ( sent_count < test_udp_batch_datagram_count_m ) {
+        if ( batched ) {
+            size_t result = net->write_socket_batch ( sender, write_datagrams, test_udp_batch_size_m );
+            std_assert_m ( result == test_udp_batch_size_m );
+        } else {
+            for ( size_t i = 0; i < test_udp_batch_size_m; ++i ) {
+                size_t result = net->write_socket ( sender, &receiver_address, write_datagrams[i].data, write_datagrams[i].size );
+                std_assert_m ( result == test_udp_batch_datagram_size_m );
+            }
+        }
+
+        sent_count += test_udp_batch_size_m;
+
+        for ( ;; ) {
+            size_t result;
+
+            if ( batched ) {
+                result = net->read_socket_batch ( read_datagrams, test_udp_batch_size_m, receiver );
+
+                for ( size_t i = 0; i < result && result != net_would_block_m; ++i ) {
+                    std_assert_m ( read_datagrams[i].result_size == test_udp_batch_datagram_size_m );
+                }
+            } else {
+                net_socket_address_t address;
+                result = net->read_socket ( &address, read_datagrams[0].data, read_datagrams[0].size, receiver );
+                std_assert_m ( result == net_would_block_m || result == test_udp_batch_datagram_size_m );
+                result = result == net_would_block_m ? result : 1;
+            }
+
+            if ( result == net_would_block_m ) {
+                break;
+            }
+
+            received_count += result;
+        }
+    }
+
+    float cpu_time = test_udp_batch_cpu_time() - start_cpu_time;
+    float time = std_tick_to_milli_f32 ( std_tick_now() - start_tick );
+    std_assert_m ( received_count == sent_count );
+
+    std_log_info_m ( "UDP " std_fmt_str_m ": " std_fmt_size_m " datagrams in " std_fmt_f32_dec_m ( 2 ) "ms, " std_fmt_f32_dec_m ( 0 )
+        " datagrams/s, " std_fmt_f32_dec_m ( 3 ) "us CPU per datagram", batched ? "batched" : "single", received_count, time,
+        received_count / ( time / 1000.f ), cpu_time * 1000.f / received_count );
+
+    net->destroy_socket ( sender );
+    net->destroy_socket ( receiver );
+    std_virtual_heap_free ( buffers );
+}
+
+static void test_udp_batch ( void ) {
+    test_udp_batch_run ( false );
+    test_udp_batch_run ( true );
+}
+
 typedef struct {
     net_socket_h socket;
 } test_tcp_msg_t1_args_t;
@@ -70,8 +191,6 @@ static void test_tcp_msg_t1 ( void* _args ) {
     test_tcp_msg_t1_args_t* args = ( test_tcp_msg_t1_args_t* ) _args;
     net_socket_h server_socket = args->socket;
 
-    net->listen_for_connections ( server_socket );
-
     net_socket_address_t client_address;
     net_socket_h client_socket = net->accept_pending_connection ( &client_address, server_socket );
     char buffer[32];
@@ -115,6 +234,9 @@ static void test_tcp_msg ( void ) {
             net->bind_socket ( s2, &s2_address );
         }
 
+        // Listen before starting the server thread, otherwise the connect below can race it and get refused
+        net->listen_for_connections ( s1 );
+
         test_tcp_msg_t1_args_t thread_args;
         thread_args.socket = s1;
         std_thread_h thread = std_thread ( test_tcp_msg_t1, &thread_args, "server", std_thread_core_mask_any_m );
@@ -131,6 +253,568 @@ static void test_tcp_msg ( void ) {
     }
 }
 
+#define test_tcp_buffers_header_size_m 16
+#define test_tcp_buffers_payload_size_m ( 64 * 1024 - test_tcp_buffers_header_size_m )
+#define test_tcp_buffers_message_count_m 4096
+
+typedef enum {
+    test_tcp_buffers_mode_staged_m,
+    test_tcp_buffers_mode_gather_m,
+    test_tcp_buffers_mode_buffers_m,
+} test_tcp_buffers_mode_e;
+
+typedef struct {
+    net_socket_h listener;
+    uint64_t expected_size;
+} test_tcp_buffers_receiver_args_t;
+
+static void test_tcp_buffers_receiver ( void* _args ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+    test_tcp_buffers_receiver_args_t* args = ( test_tcp_buffers_receiver_args_t* ) _args;
+
+    net_socket_address_t address;
+    net_socket_h connection = net->accept_pending_connection ( &address, args->listener );
+    std_assert_m ( connection != net_null_handle_m );
+
+    char* buffer = std_virtual_heap_alloc_array_m ( char, 256 * 1024 );
+    uint64_t received_size = 0;
+
+    while ( received_size < args->expected_size ) {
+        size_t read_size = net->read_connected_socket ( buffer, 256 * 1024, connection );
+        std_assert_m ( read_size != 0 );
+        received_size += read_size;
+    }
+
+    net->destroy_socket ( connection );
+    std_virtual_heap_free ( buffer );
+}
+
+static void test_tcp_buffers_write_all ( net_socket_h socket, std_buffer_t* buffers, size_t count ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+
+    while ( count > 0 ) {
+        size_t write_size = net->write_connected_socket_gather ( socket, buffers, count );
+        std_assert_m ( write_size != 0 && write_size != net_would_block_m );
+
+        while ( count > 0 && write_size >= buffers->size ) {
+            write_size -= buffers->size;
+            ++buffers;
+            --count;
+        }
+
+        if ( count > 0 ) {
+            buffers->base = ( char* ) buffers->base + write_size;
+            buffers->size -= write_size;
+        }
+    }
+}
+
+// Sends header plus payload messages over loopback. The payload is produced right before each send, staged copies
+// header and payload into one buffer, gather sends them from where they are and buffers produces them in place.
+static void test_tcp_buffers_run ( test_tcp_buffers_mode_e mode ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+
+    net_socket_params_t socket_params;
+    socket_params.family = net_address_family_ip4_m;
+    socket_params.protocol = net_ip_protocol_tcp_m;
+    socket_params.is_blocking = true;
+
+    net_socket_address_t server_address;
+    net->ip_string_to_bytes ( &server_address.ip, "127.0.0.1", net_address_family_ip4_m );
+    server_address.port = 779;
+
+    test_tcp_buffers_receiver_args_t receiver_args;
+    receiver_args.listener = net->create_socket ( &socket_params );
+    receiver_args.expected_size = ( uint64_t ) test_tcp_buffers_message_count_m * ( test_tcp_buffers_header_size_m + test_tcp_buffers_payload_size_m );
+    net->bind_socket ( receiver_args.listener, &server_address );
+    net->listen_for_connections ( receiver_args.listener );
+    std_thread_h receiver_thread = std_thread ( test_tcp_buffers_receiver, &receiver_args, "receiver", std_thread_core_mask_any_m );
+
+    net_socket_address_t client_address = server_address;
+    client_address.port = 0;
+    net_socket_h client = net->create_socket ( &socket_params );
+    net->bind_socket ( client, &client_address );
+    bool connect_result = net->connect_socket ( client, &server_address );
+    std_assert_m ( connect_result );
+
+    char header[test_tcp_buffers_header_size_m];
+    char* payload = std_virtual_heap_alloc_array_m ( char, test_tcp_buffers_payload_size_m );
+    char* staging = std_virtual_heap_alloc_array_m ( char, test_tcp_buffers_header_size_m + test_tcp_buffers_payload_size_m );
+    uint64_t copied_size = 0;
+
+    std_tick_t start_tick = std_tick_now();
+
+    for ( uint32_t i = 0; i < test_tcp_buffers_message_count_m; ++i ) {
+        switch ( mode ) {
+            case test_tcp_buffers_mode_staged_m: {
+                std_mem_set ( header, sizeof ( header ), ( char ) i );
+                std_mem_set ( payload, test_tcp_buffers_payload_size_m, ( char ) i );
+                std_mem_copy ( staging, header, sizeof ( header ) );
+                std_mem_copy ( staging + sizeof ( header ), payload, test_tcp_buffers_payload_size_m );
+                copied_size += sizeof ( header ) + test_tcp_buffers_payload_size_m;
+                std_buffer_t buffer = { staging, sizeof ( header ) + test_tcp_buffers_payload_size_m };
+                test_tcp_buffers_write_all ( client, &buffer, 1 );
+            }
+            break;
+
+            case test_tcp_buffers_mode_gather_m: {
+                std_mem_set ( header, sizeof ( header ), ( char ) i );
+                std_mem_set ( payload, test_tcp_buffers_payload_size_m, ( char ) i );
+                std_buffer_t buffers[2] = { { header, sizeof ( header ) }, { payload, test_tcp_buffers_payload_size_m } };
+                test_tcp_buffers_write_all ( client, buffers, 2 );
+            }
+            break;
+
+            case test_tcp_buffers_mode_buffers_m: {
+                net_buffer_t buffer = net->acquire_buffer();
+                std_assert_m ( buffer.handle != net_null_handle_m );
+                std_mem_set ( buffer.base, test_tcp_buffers_header_size_m, ( char ) i );
+                std_mem_set ( ( char* ) buffer.base + test_tcp_buffers_header_size_m, test_tcp_buffers_payload_size_m, ( char ) i );
+                bool write_result = net->write_connected_socket_buffer ( client, buffer.handle, test_tcp_buffers_header_size_m + test_tcp_buffers_payload_size_m );
+                std_assert_m ( write_result );
+            }
+            break;
+        }
+    }
+
+    std_assert_m ( net->flush_connected_socket ( client ) == 0 );
+    std_assert_m ( std_thread_join ( receiver_thread ) );
+    float time = std_tick_to_milli_f32 ( std_tick_now() - start_tick );
+
+    const char* mode_names[] = { "staged", "gather", "buffers" };
+    std_log_info_m ( "TCP " std_fmt_str_m ": " std_fmt_u64_m "MB in " std_fmt_f32_dec_m ( 2 ) "ms, " std_fmt_f32_dec_m ( 0 ) "MB/s, "
+        std_fmt_f32_dec_m ( 2 ) " bytes copied per byte sent", mode_names[mode], receiver_args.expected_size / ( 1024 * 1024 ), time,
+        receiver_args.expected_size / ( 1024.f * 1024.f ) / ( time / 1000.f ), ( float ) copied_size / receiver_args.expected_size );
+
+    net->destroy_socket ( client );
+    net->destroy_socket ( receiver_args.listener );
+    std_virtual_heap_free ( payload );
+    std_virtual_heap_free ( staging );
+}
+
+static void test_tcp_buffers ( void ) {
+    test_tcp_buffers_run ( test_tcp_buffers_mode_staged_m );
+    test_tcp_buffers_run ( test_tcp_buffers_mode_gather_m );
+    test_tcp_buffers_run ( test_tcp_buffers_mode_buffers_m );
+}
+
+#define test_tcp_poller_max_connections_m 10000
+#define test_tcp_poller_connect_batch_m 256
+#define test_tcp_poller_round_count_m 16
+#define test_tcp_poller_events_cap_m 256
+
+typedef struct {
+    net_socket_h socket;
+    bool closed;
+} test_tcp_poller_echo_args_t;
+
+typedef struct {
+    net_socket_h listener;
+    uint32_t connection_count;
+} test_tcp_poller_server_args_t;
+
+// Runs on tk, echoes back everything that's ready on a connection. The poller is edge triggered on Linux, so the
+// socket needs to be drained before it can be reported again.
+static void test_tcp_poller_echo_task ( void* _args ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+    test_tcp_poller_echo_args_t* args = ( test_tcp_poller_echo_args_t* ) _args;
+
+    char buffer[256];
+
+    for ( ;; ) {
+        size_t read_size = net->read_connected_socket ( buffer, sizeof ( buffer ), args->socket );
+
+        if ( read_size == net_would_block_m ) {
+            break;
+        }
+
+        if ( read_size == 0 ) {
+            net->destroy_socket ( args->socket );
+            args->closed = true;
+            break;
+        }
+
+        size_t write_size = net->write_connected_socket ( args->socket, buffer, read_size );
+        std_assert_m ( write_size == read_size );
+    }
+}
+
+static void test_tcp_poller_server ( void* _args ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+    tk_i* tk = std_module_get_m ( tk_module_name_m );
+    test_tcp_poller_server_args_t* args = ( test_tcp_poller_server_args_t* ) _args;
+
+    net_poller_h poller = net->create_poller();
+    net->add_poller_socket ( poller, args->listener, net_poll_read_m, NULL );
+
+    net_poll_event_t events[test_tcp_poller_events_cap_m];
+    tk_task_t tasks[test_tcp_poller_events_cap_m];
+    test_tcp_poller_echo_args_t tasks_args[test_tcp_poller_events_cap_m];
+    uint32_t closed_count = 0;
+
+    while ( closed_count < args->connection_count ) {
+        size_t event_count = net->wait_poller ( events, test_tcp_poller_events_cap_m, poller, net_poller_wait_infinite_m );
+        size_t task_count = 0;
+
+        for ( size_t i = 0; i < event_count; ++i ) {
+            net_socket_h socket = events[i].socket;
+
+            if ( socket == args->listener ) {
+                net_socket_address_t address;
+                net_socket_h connection;
+
+                while ( ( connection = net->accept_pending_connection ( &address, args->listener ) ) != net_null_handle_m ) {
+                    net->add_poller_socket ( poller, connection, net_poll_read_m, NULL );
+                }
+
+                continue;
+            }
+
+            tasks_args[task_count].socket = socket;
+            tasks_args[task_count].closed = false;
+            tasks[task_count].routine = test_tcp_poller_echo_task;
+            tasks[task_count].arg = &tasks_args[task_count];
+            ++task_count;
+        }
+
+        if ( task_count > 0 ) {
+            tk_workload_h workload = tk->schedule_work ( tasks, task_count );
+            tk->wait_for_workload_idle ( workload );
+        }
+
+        for ( size_t i = 0; i < task_count; ++i ) {
+            closed_count += tasks_args[i].closed ? 1 : 0;
+        }
+    }
+
+    net->destroy_poller ( poller );
+}
+
+// Loopback echo, one server thread waits on all connections and hands the ready ones to tk
+static void test_tcp_poller ( void ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+
+    uint32_t connection_count = test_tcp_poller_max_connections_m;
+#if defined(std_platform_linux_m)
+    {
+        // Both ends of every connection live in this process
+        struct rlimit limit;
+        getrlimit ( RLIMIT_NOFILE, &limit );
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit ( RLIMIT_NOFILE, &limit );
+        getrlimit ( RLIMIT_NOFILE, &limit );
+        connection_count = ( uint32_t ) std_min_u64 ( connection_count, ( limit.rlim_cur - 64 ) / 2 );
+    }
+#endif
+
+    net_socket_params_t socket_params;
+    socket_params.family = net_address_family_ip4_m;
+    socket_params.protocol = net_ip_protocol_tcp_m;
+    socket_params.is_blocking = false;
+
+    net_socket_address_t server_address;
+    net->ip_string_to_bytes ( &server_address.ip, "127.0.0.1", net_address_family_ip4_m );
+    server_address.port = 888;
+
+    test_tcp_poller_server_args_t server_args;
+    server_args.listener = net->create_socket ( &socket_params );
+    server_args.connection_count = connection_count;
+    bool bind_result = net->bind_socket ( server_args.listener, &server_address );
+    std_assert_m ( bind_result );
+    net->listen_for_connections ( server_args.listener );
+    std_thread_h server_thread = std_thread ( test_tcp_poller_server, &server_args, "server", std_thread_core_mask_any_m );
+
+    net_socket_h* sockets = std_virtual_heap_alloc_array_m ( net_socket_h, connection_count );
+    net_poller_h poller = net->create_poller();
+    net_poll_event_t events[test_tcp_poller_events_cap_m];
+
+    // Port 0 lets the OS pick a free one for each client
+    net_socket_address_t client_address = server_address;
+    client_address.port = 0;
+
+    // Connect in batches, waiting for each connection to become writable, to not overflow the listen backlog
+    std_tick_t connect_start = std_tick_now();
+    uint32_t connected_count = 0;
+
+    for ( uint32_t batch_start = 0; batch_start < connection_count; batch_start += test_tcp_poller_connect_batch_m ) {
+        uint32_t batch_end = ( uint32_t ) std_min_u64 ( batch_start + test_tcp_poller_connect_batch_m, connection_count );
+
+        for ( uint32_t i = batch_start; i < batch_end; ++i ) {
+            sockets[i] = net->create_socket ( &socket_params );
+            std_assert_m ( sockets[i] != net_null_handle_m );
+            net->bind_socket ( sockets[i], &client_address );
+            bool connect_result = net->connect_socket ( sockets[i], &server_address );
+            std_assert_m ( connect_result );
+            net->add_poller_socket ( poller, sockets[i], net_poll_read_m | net_poll_write_m, ( void* ) ( uintptr_t ) i );
+        }
+
+        while ( connected_count < batch_end ) {
+            size_t event_count = net->wait_poller ( events, test_tcp_poller_events_cap_m, poller, net_poller_wait_infinite_m );
+
+            for ( size_t i = 0; i < event_count; ++i ) {
+                std_assert_m ( !( events[i].events & net_poll_error_m ) );
+
+                if ( events[i].events & net_poll_write_m ) {
+                    // Only reads are of interest from now on
+                    net->modify_poller_socket ( poller, events[i].socket, net_poll_read_m, events[i].user_data );
+                    ++connected_count;
+                }
+            }
+        }
+    }
+
+    float connect_time = std_tick_to_milli_f32 ( std_tick_now() - connect_start );
+    std_log_info_m ( "Connected " std_fmt_u32_m " sockets in " std_fmt_f32_dec_m ( 2 ) "ms", connection_count, connect_time );
+
+    const char* msg = "hello echo";
+    size_t msg_size = std_str_len ( msg ) + 1;
+
+    std_tick_t echo_start = std_tick_now();
+
+    for ( uint32_t round = 0; round < test_tcp_poller_round_count_m; ++round ) {
+        for ( uint32_t i = 0; i < connection_count; ++i ) {
+            size_t write_size = net->write_connected_socket ( sockets[i], msg, msg_size );
+            std_assert_m ( write_size == msg_size );
+        }
+
+        size_t expected_size = connection_count * msg_size;
+        size_t received_size = 0;
+
+        while ( received_size < expected_size ) {
+            size_t event_count = net->wait_poller ( events, test_tcp_poller_events_cap_m, poller, net_poller_wait_infinite_m );
+
+            for ( size_t i = 0; i < event_count; ++i ) {
+                std_assert_m ( !( events[i].events & ( net_poll_error_m | net_poll_hangup_m ) ) );
+                char buffer[256];
+                size_t read_size;
+
+                while ( ( read_size = net->read_connected_socket ( buffer, sizeof ( buffer ), events[i].socket ) ) != net_would_block_m ) {
+                    std_assert_m ( read_size > 0 );
+                    received_size += read_size;
+                }
+            }
+        }
+
+        std_assert_m ( received_size == expected_size );
+    }
+
+    float echo_time = std_tick_to_milli_f32 ( std_tick_now() - echo_start );
+    uint64_t round_trips = ( uint64_t ) connection_count * test_tcp_poller_round_count_m;
+    std_log_info_m ( "Echoed " std_fmt_u64_m " messages in " std_fmt_f32_dec_m ( 2 ) "ms, " std_fmt_f32_dec_m ( 0 ) " round trips/s",
+        round_trips, echo_time, round_trips / ( echo_time / 1000.f ) );
+
+    for ( uint32_t i = 0; i < connection_count; ++i ) {
+        net->destroy_socket ( sockets[i] );
+    }
+
+    std_assert_m ( std_thread_join ( server_thread ) );
+
+    net->destroy_poller ( poller );
+    net->destroy_socket ( server_args.listener );
+    std_virtual_heap_free ( sockets );
+}
+
+#define test_transport_message_count_m 2000
+#define test_transport_messages_per_update_m 4
+// Messages the client lets go without their echo, this keeps the server's reliable window from filling up
+#define test_transport_max_in_flight_m 64
+// Every so often a message that doesn't fit in one packet, to go through fragmentation
+#define test_transport_large_message_interval_m 50
+#define test_transport_large_message_size_m 5000
+#define test_transport_events_cap_m 64
+#define test_transport_timeout_ms_m 30000
+
+typedef struct {
+    uint64_t idx;
+    std_tick_t send_tick;
+} test_transport_msg_t;
+
+static int test_transport_compare_f64 ( const void* a, const void* b, const void* arg ) {
+    double x = * ( const double* ) a;
+    double y = * ( const double* ) b;
+    return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Client and server transports on loopback, updated from the same thread. The client sends timestamped messages on a
+// reliable channel, the server echoes them back, and the client times the round trips. In parallel the client streams
+// a counter on an unreliable channel, the server checks it never goes back.
+static void test_transport_run ( float loss, float latency_ms, float jitter_ms ) {
+    net_i* net = std_module_get_m ( net_module_name_m );
+
+    net_transport_params_t params;
+    std_mem_zero_m ( &params );
+    params.family = net_address_family_ip4_m;
+    params.channels[0] = net_transport_channel_reliable_ordered_m;
+    params.channels[1] = net_transport_channel_unreliable_sequenced_m;
+    params.channel_count = 2;
+    params.simulator_loss = loss;
+    params.simulator_latency_ms = latency_ms;
+    params.simulator_jitter_ms = jitter_ms;
+
+    net_socket_address_t server_address;
+    net->ip_string_to_bytes ( &server_address.ip, "127.0.0.1", net_address_family_ip4_m );
+    server_address.port = 780;
+
+    params.address = server_address;
+    params.listen = true;
+    net_transport_h server = net->create_transport ( &params );
+    std_assert_m ( server != net_null_handle_m );
+
+    params.address.port = 0;
+    params.listen = false;
+    net_transport_h client = net->create_transport ( &params );
+    std_assert_m ( client != net_null_handle_m );
+
+    net_transport_connection_h connection = net->connect_transport ( client, &server_address );
+    std_assert_m ( connection != net_null_handle_m );
+
+    char* payload = std_virtual_heap_alloc_array_m ( char, test_transport_large_message_size_m );
+    double* samples = std_virtual_heap_alloc_array_m ( double, test_transport_message_count_m );
+    net_transport_event_t events[test_transport_events_cap_m];
+
+    bool client_connected = false;
+    net_transport_connection_h server_connection = net_null_handle_m;
+    uint64_t sent_count = 0;
+    uint64_t received_count = 0;
+    uint64_t large_count = 0;
+    uint64_t state_counter = 0;
+    uint64_t state_received_count = 0;
+    uint64_t state_last = 0;
+    uint32_t update_count = 0;
+    std_tick_t start_tick = std_tick_now();
+
+    while ( received_count < test_transport_message_count_m ) {
+        std_assert_m ( std_tick_to_milli_f32 ( std_tick_now() - start_tick ) < test_transport_timeout_ms_m );
+
+        if ( client_connected ) {
+            for ( uint32_t i = 0; i < test_transport_messages_per_update_m && sent_count < test_transport_message_count_m; ++i ) {
+                if ( sent_count - received_count == test_transport_max_in_flight_m ) {
+                    break;
+                }
+
+                test_transport_msg_t msg;
+                msg.idx = sent_count;
+                msg.send_tick = std_tick_now();
+                bool large = sent_count % test_transport_large_message_interval_m == 0;
+                size_t size = sizeof ( msg );
+
+                if ( large ) {
+                    for ( size_t j = 0; j < test_transport_large_message_size_m; ++j ) {
+                        payload[j] = ( char ) ( sent_count + j );
+                    }
+
+                    std_mem_copy ( payload, &msg, sizeof ( msg ) );
+                    size = test_transport_large_message_size_m;
+                }
+
+                // The reliable window can be full while lost packets are waiting to be resent, try again later
+                if ( !net->send_transport_message ( client, connection, 0, large ? ( void* ) payload : ( void* ) &msg, size ) ) {
+                    break;
+                }
+
+                ++sent_count;
+            }
+
+            ++state_counter;
+            net->send_transport_message ( client, connection, 1, &state_counter, sizeof ( state_counter ) );
+        }
+
+        size_t event_count = net->update_transport ( events, test_transport_events_cap_m, server );
+
+        for ( size_t i = 0; i < event_count; ++i ) {
+            net_transport_event_t* event = &events[i];
+
+            if ( event->type == net_transport_event_connected_m ) {
+                server_connection = event->connection;
+            } else if ( event->type == net_transport_event_message_m ) {
+                if ( event->channel == 0 ) {
+                    // Echo it back as is
+                    bool echo_result = net->send_transport_message ( server, event->connection, 0, event->data, event->size );
+                    std_assert_m ( echo_result );
+                } else {
+                    uint64_t counter = * ( const uint64_t* ) event->data;
+                    std_assert_m ( counter > state_last );
+                    state_last = counter;
+                    ++state_received_count;
+                }
+            }
+        }
+
+        event_count = net->update_transport ( events, test_transport_events_cap_m, client );
+
+        for ( size_t i = 0; i < event_count; ++i ) {
+            net_transport_event_t* event = &events[i];
+
+            if ( event->type == net_transport_event_connected_m ) {
+                client_connected = true;
+            } else if ( event->type == net_transport_event_message_m ) {
+                test_transport_msg_t msg;
+                std_mem_copy ( &msg, event->data, sizeof ( msg ) );
+                std_assert_m ( msg.idx == received_count );
+
+                if ( msg.idx % test_transport_large_message_interval_m == 0 ) {
+                    std_assert_m ( event->size == test_transport_large_message_size_m );
+                    const char* data = ( const char* ) event->data;
+
+                    for ( size_t j = sizeof ( msg ); j < test_transport_large_message_size_m; ++j ) {
+                        std_assert_m ( data[j] == ( char ) ( msg.idx + j ) );
+                    }
+
+                    ++large_count;
+                } else {
+                    std_assert_m ( event->size == sizeof ( msg ) );
+                }
+
+                samples[received_count++] = std_tick_to_milli_f64 ( std_tick_now() - msg.send_tick );
+            }
+
+            std_assert_m ( event->type != net_transport_event_disconnected_m );
+        }
+
+        ++update_count;
+        std_thread_this_sleep ( 1 );
+    }
+
+    net_transport_connection_info_t info;
+    net->get_transport_connection_info ( &info, client, connection );
+
+    double tmp;
+    std_sort_quick ( samples, sizeof ( double ), test_transport_message_count_m, test_transport_compare_f64, NULL, &tmp );
+    std_log_info_m ( "Transport, " std_fmt_f32_dec_m ( 0 ) "%% loss, " std_fmt_f32_dec_m ( 0 ) "ms latency, " std_fmt_f32_dec_m ( 0 ) "ms jitter: "
+        std_fmt_u64_m " messages (" std_fmt_u64_m " fragmented) round trip p50 " std_fmt_f32_dec_m ( 2 ) "ms, p90 " std_fmt_f32_dec_m ( 2 ) "ms, p99 "
+        std_fmt_f32_dec_m ( 2 ) "ms, max " std_fmt_f32_dec_m ( 2 ) "ms",
+        loss * 100, latency_ms, jitter_ms, received_count, large_count,
+        samples[test_transport_message_count_m * 50 / 100], samples[test_transport_message_count_m * 90 / 100],
+        samples[test_transport_message_count_m * 99 / 100], samples[test_transport_message_count_m - 1] );
+    std_log_info_m ( "Client sent " std_fmt_u64_m " packets, resent " std_fmt_u64_m " fragments, smoothed rtt " std_fmt_f32_dec_m ( 2 )
+        "ms, " std_fmt_u64_m "/" std_fmt_u64_m " unreliable updates received",
+        info.sent_packets, info.resent_fragments, info.rtt_ms, state_received_count, state_counter );
+
+    // The disconnect can be lost too, in that case the server finds out through the timeout
+    net->disconnect_transport ( client, connection );
+    bool server_disconnected = false;
+
+    while ( !server_disconnected ) {
+        size_t event_count = net->update_transport ( events, test_transport_events_cap_m, server );
+
+        for ( size_t i = 0; i < event_count; ++i ) {
+            server_disconnected |= events[i].type == net_transport_event_disconnected_m && events[i].connection == server_connection;
+        }
+
+        std_thread_this_sleep ( 1 );
+    }
+
+    net->destroy_transport ( client );
+    net->destroy_transport ( server );
+    std_virtual_heap_free ( payload );
+    std_virtual_heap_free ( samples );
+}
+
+static void test_transport ( void ) {
+    test_transport_run ( 0, 0, 0 );
+    test_transport_run ( 0.05f, 10, 5 );
+}
+
 #if 0
 void test_http_server ( void ) {
     net_i* net = std_module_get_m ( net_module_name_m );
@@ -146,11 +830,23 @@ void test_http_server ( void ) {
 
 void std_main ( void ) {
     std_module_load_m ( net_module_name_m );
+    tk_i* tk = std_module_load_m ( tk_module_name_m );
+
+    tk_thread_pool_params_t pool;
+    pool.thread_count = ( uint32_t ) std_max_u64 ( std_platform_logical_cores_info ( NULL, 0 ) - 1, 1 );
+    pool.core_lock = false;
+    tk->init_thread_pool ( &pool );
 #if 1
     test_udp_msg();
+    test_udp_batch();
     test_tcp_msg();
+    test_tcp_buffers();
+    test_tcp_poller();
+    test_transport();
 #else
     test_http_server();
 #endif
+    tk->stop();
+    std_module_unload_m ( tk_module_name_m );
     std_log_info_m ( "NET_TEST COMPLETE!" );
 }
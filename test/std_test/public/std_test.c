@@ -1324,6 +1324,65 @@ static void test_byte ( void ) {
     std_log_info_m ( "std_byte test complete." );
 }
 
+static int test_sort_u64_compare ( const void* a, const void* b, const void* arg ) {
+    std_unused_m ( arg );
+    uint64_t i = * ( const uint64_t* ) a;
+    uint64_t j = * ( const uint64_t* ) b;
+    return i < j ? -1 : i > j ? 1 : 0;
+}
+
+static void test_sort ( void ) {
+    std_log_info_m ( "testing std_sort..." );
+
+    size_t n = 1024 * 256;
+    uint64_t* items = std_virtual_heap_alloc_array_m ( uint64_t, n );
+    std_xorshift64_state_t rng = std_xorshift64_state();
+    uint64_t tmp;
+
+    // sorted, reverse sorted, all equal, few distinct keys, shuffled
+    for ( uint32_t pattern = 0; pattern < 5; ++pattern ) {
+        uint64_t sum = 0;
+
+        for ( size_t i = 0; i < n; ++i ) {
+            switch ( pattern ) {
+                case 0: items[i] = i; break;
+                case 1: items[i] = n - i; break;
+                case 2: items[i] = 7; break;
+                case 3: items[i] = std_xorshift64 ( &rng ) % 4; break;
+                case 4: items[i] = std_xorshift64 ( &rng ); break;
+            }
+            sum += items[i];
+        }
+
+        std_tick_t start_tick = std_tick_now();
+        std_sort_quick ( items, sizeof ( uint64_t ), n, test_sort_u64_compare, NULL, &tmp );
+        float time_ms = std_tick_to_milli_f32 ( std_tick_now() - start_tick );
+
+        for ( size_t i = 1; i < n; ++i ) {
+            std_assert_m ( items[i - 1] <= items[i] );
+            sum -= items[i];
+        }
+        sum -= items[0];
+        std_assert_m ( sum == 0 );
+
+        std_log_info_m ( "pattern " std_fmt_u32_m ": " std_fmt_size_m " items sorted in " std_fmt_f32_dec_m ( 3 ) "ms", pattern, n, time_ms );
+    }
+
+    // short inputs
+    for ( size_t count = 0; count < 8; ++count ) {
+        for ( size_t i = 0; i < count; ++i ) {
+            items[i] = count - i;
+        }
+        std_sort_quick ( items, sizeof ( uint64_t ), count, test_sort_u64_compare, NULL, &tmp );
+        for ( size_t i = 0; i < count; ++i ) {
+            std_assert_m ( items[i] == i + 1 );
+        }
+    }
+
+    std_virtual_heap_free ( items );
+    std_log_info_m ( "std_sort test complete." );
+}
+
 static void test_file ( void ) {
     std_log_info_m ( "testing std_file..." );
 
@@ -1353,6 +1412,15 @@ static void test_file ( void ) {
         len = std_path_normalize ( path2, 256, path );
         std_log_info_m ( std_fmt_str_m, path2 );
     }
+    {
+        // Appending without a trailing / on the path inserts one
+        char path[256];
+        std_mem_set ( path, 256, 'x' );
+        std_str_copy ( path, 256, "folder" );
+        size_t len = std_path_append ( path, 256, "file" );
+        std_assert_m ( len == std_str_len ( path ) );
+        std_assert_m ( std_str_cmp ( path, "folder/file" ) == 0 );
+    }
     {
         char path[256];
         {
@@ -1424,11 +1492,189 @@ static void test_file ( void ) {
                 std_log_info_m ( std_fmt_tab_m std_fmt_str_m, files[i] );
             }
         }
+
+        {
+            std_directory_entry_t entries[32];
+            size_t n = std_directory_scan ( entries, 32, path );
+            // The total count is returned even when it doesn't fit
+            std_assert_m ( std_directory_scan ( entries, 1, path ) == n );
+
+            for ( size_t i = 0; i < n && i < 32; ++i ) {
+                const char* suffix = entries[i].flags & std_path_is_directory_m ? "/" : "";
+                std_log_info_m ( std_fmt_tab_m std_fmt_str_m std_fmt_str_m " " std_fmt_u64_m, entries[i].name, suffix, entries[i].size );
+            }
+        }
     }
 
     std_log_info_m ( "std_file test complete" );
 }
 
+#define test_directory_walk_max_folders_m 64
+#define test_directory_walk_max_entries_m 1024
+
+typedef struct {
+    char path[std_path_size_m];
+    uint64_t file_count;
+    uint64_t file_size;
+} test_directory_walk_t;
+
+// What startup folder scans used to do, one path info call per file on top of the listing
+static void test_directory_walk_iterate_callback ( const char* name, std_path_flags_t flags, void* arg ) {
+    test_directory_walk_t* walk = ( test_directory_walk_t* ) arg;
+
+    if ( std_str_cmp ( name, "." ) == 0 || std_str_cmp ( name, ".." ) == 0 ) {
+        return;
+    }
+
+    std_path_append ( walk->path, std_path_size_m, name );
+
+    if ( flags & std_path_is_directory_m ) {
+        std_directory_iterate ( walk->path, test_directory_walk_iterate_callback, walk );
+    } else {
+        std_file_info_t info;
+        std_verify_m ( std_file_path_info ( &info, walk->path ) );
+        walk->file_count += 1;
+        walk->file_size += info.size;
+    }
+
+    std_path_pop ( walk->path );
+}
+
+static void test_directory_walk_scan ( test_directory_walk_t* walk ) {
+    std_directory_entry_t* entries = std_virtual_heap_alloc_array_m ( std_directory_entry_t, test_directory_walk_max_entries_m );
+    size_t count = std_directory_scan ( entries, test_directory_walk_max_entries_m, walk->path );
+    std_assert_m ( count <= test_directory_walk_max_entries_m );
+
+    for ( size_t i = 0; i < count; ++i ) {
+        std_path_append ( walk->path, std_path_size_m, entries[i].name );
+
+        if ( entries[i].flags & std_path_is_directory_m ) {
+            test_directory_walk_scan ( walk );
+        } else {
+            walk->file_count += 1;
+            walk->file_size += entries[i].size;
+        }
+
+        std_path_pop ( walk->path );
+    }
+
+    std_virtual_heap_free ( entries );
+}
+
+// Drops the clean page, dentry and inode caches, so that the next walk starts cold. Needs root on Linux.
+static bool test_directory_drop_caches ( void ) {
+#if defined(std_platform_linux_m)
+    std_file_h file = std_file_open ( "/proc/sys/vm/drop_caches", std_file_write_m );
+
+    if ( file == std_file_null_handle_m ) {
+        return false;
+    }
+
+    bool result = std_file_write ( file, "3", 1 );
+    std_file_close ( file );
+    return result;
+#else
+    return false;
+#endif
+}
+
+static bool test_directory_has_folder ( char* path, const char* name ) {
+    std_path_append ( path, std_path_size_m, name );
+    std_path_info_t info;
+    bool result = std_path_info ( &info, path ) && ( info.flags & std_path_is_directory_m );
+    std_path_pop ( path );
+    return result;
+}
+
+static float test_directory_walk_time ( test_directory_walk_t* walk, char folders[][std_path_size_m], size_t folder_count, bool scan ) {
+    walk->file_count = 0;
+    walk->file_size = 0;
+    std_tick_t start = std_tick_now();
+
+    for ( size_t i = 0; i < folder_count; ++i ) {
+        std_str_copy ( walk->path, std_path_size_m, folders[i] );
+
+        if ( scan ) {
+            test_directory_walk_scan ( walk );
+        } else {
+            std_directory_iterate ( walk->path, test_directory_walk_iterate_callback, walk );
+        }
+    }
+
+    return std_tick_to_milli_f32 ( std_tick_now() - start );
+}
+
+// Walks the shader and asset folders of the workspace the test was built in, the same folders the apps scan on
+// startup, once listing and querying every file and once with std_directory_scan
+static void test_directory_walk ( void ) {
+    std_log_info_m ( "testing std_directory_scan against std_directory_iterate..." );
+
+    std_process_info_t process_info;
+    std_process_info ( &process_info, std_process_this() );
+
+    // Up from the executable to the first folder that has both module and app in it
+    char* root = std_virtual_heap_alloc_array_m ( char, std_path_size_m );
+    std_path_normalize ( root, std_path_size_m, process_info.executable_path );
+    bool root_found = false;
+
+    while ( !root_found && std_path_pop ( root ) > 1 ) {
+        root_found = test_directory_has_folder ( root, "module" ) && test_directory_has_folder ( root, "app" );
+    }
+
+    if ( !root_found ) {
+        std_log_info_m ( "Workspace not found next to the executable, skipping" );
+        std_virtual_heap_free ( root );
+        return;
+    }
+
+    char ( *folders )[std_path_size_m] = std_virtual_heap_alloc_m ( test_directory_walk_max_folders_m * std_path_size_m, 16 );
+    size_t folder_count = 0;
+    const char* parents[] = { "module", "app" };
+    const char* children[] = { "shader", "assets" };
+    std_directory_entry_t* entries = std_virtual_heap_alloc_array_m ( std_directory_entry_t, test_directory_walk_max_entries_m );
+
+    for ( size_t i = 0; i < std_static_array_capacity_m ( parents ); ++i ) {
+        std_path_append ( root, std_path_size_m, parents[i] );
+        size_t count = std_min ( std_directory_scan ( entries, test_directory_walk_max_entries_m, root ), test_directory_walk_max_entries_m );
+
+        for ( size_t j = 0; j < count; ++j ) {
+            for ( size_t k = 0; k < std_static_array_capacity_m ( children ) && folder_count < test_directory_walk_max_folders_m; ++k ) {
+                char* folder = folders[folder_count];
+                std_str_copy ( folder, std_path_size_m, root );
+                std_path_append ( folder, std_path_size_m, entries[j].name );
+
+                if ( test_directory_has_folder ( folder, children[k] ) ) {
+                    std_path_append ( folder, std_path_size_m, children[k] );
+                    ++folder_count;
+                }
+            }
+        }
+
+        std_path_pop ( root );
+    }
+
+    test_directory_walk_t* walk = std_virtual_heap_alloc_m ( sizeof ( test_directory_walk_t ), 16 );
+    bool cold = test_directory_drop_caches();
+    float cold_iterate_ms = test_directory_walk_time ( walk, folders, folder_count, false );
+    uint64_t file_count = walk->file_count;
+    uint64_t file_size = walk->file_size;
+    cold = cold && test_directory_drop_caches();
+    float cold_scan_ms = test_directory_walk_time ( walk, folders, folder_count, true );
+    std_assert_m ( walk->file_count == file_count && walk->file_size == file_size );
+    float warm_iterate_ms = test_directory_walk_time ( walk, folders, folder_count, false );
+    float warm_scan_ms = test_directory_walk_time ( walk, folders, folder_count, true );
+
+    std_log_info_m ( "Directory walk, " std_fmt_u64_m " files in " std_fmt_size_m " shader and asset folders", file_count, folder_count );
+    std_log_info_m ( std_fmt_tab_m std_fmt_str_m " cache: iterate + path info " std_fmt_f32_dec_m ( 3 ) "ms, scan " std_fmt_f32_dec_m ( 3 ) "ms",
+        cold ? "cold" : "warm (can't drop caches)", cold_iterate_ms, cold_scan_ms );
+    std_log_info_m ( std_fmt_tab_m "warm cache: iterate + path info " std_fmt_f32_dec_m ( 3 ) "ms, scan " std_fmt_f32_dec_m ( 3 ) "ms", warm_iterate_ms, warm_scan_ms );
+
+    std_virtual_heap_free ( walk );
+    std_virtual_heap_free ( entries );
+    std_virtual_heap_free ( folders );
+    std_virtual_heap_free ( root );
+}
+
 #if 0 && defined ( std_compiler_gcc_m )
 static void test_array_fun ( std_array_type_m ( int )* int_array ) {
     int_array->data[int_array->count++] = 2;
@@ -1538,10 +1784,14 @@ void std_main ( void ) {
     std_log_info_m ( separator );
     test_byte();
     std_log_info_m ( separator );
+    test_sort();
+    std_log_info_m ( separator );
     test_array();
     std_log_info_m ( separator );
     test_file();
     std_log_info_m ( separator );
+    test_directory_walk();
+    std_log_info_m ( separator );
     test_queue();
 #else
     bench_virtual_heap();
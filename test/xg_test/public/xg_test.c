@@ -1,6 +1,7 @@
 #include <std_main.h>
 #include <std_time.h>
 #include <std_log.h>
+#include <std_allocator.h>
 
 #include <xg.h>
 
@@ -82,6 +83,199 @@ static void xg_test_frame ( xg_device_h device, xg_swapchain_h swapchain, bool c
     xg->present_swapchain ( swapchain, workload );
 }
 
+static void xg_test_upload ( xg_device_h device ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
+
+    const uint32_t texture_count = 32;
+    const uint32_t texture_size = 1024;
+    const uint64_t texture_bytes = texture_size * texture_size * 4;
+
+    uint32_t* data = std_virtual_heap_alloc_array_m ( uint32_t, texture_size * texture_size );
+    for ( uint32_t i = 0; i < texture_size * texture_size; ++i ) {
+        data[i] = i;
+    }
+
+    xg_texture_h textures[texture_count];
+    xg_upload_h uploads[texture_count];
+
+    std_tick_t start_tick = std_tick_now();
+
+    for ( uint32_t i = 0; i < texture_count; ++i ) {
+        textures[i] = xg->create_texture ( &xg_texture_params_m (
+            .device = device,
+            .width = texture_size,
+            .height = texture_size,
+            .format = xg_format_r8g8b8a8_unorm_m,
+            .allowed_usage = xg_texture_usage_bit_sampled_m | xg_texture_usage_bit_copy_dest_m,
+            .debug_name = "upload_test_texture",
+        ) );
+
+        uploads[i] = xg->upload_texture ( &xg_upload_texture_params_m (
+            .texture = textures[i],
+            .data = data,
+        ) );
+    }
+
+    // Uploads complete in order, polling the last one is enough
+    uint32_t update_count = 0;
+    while ( xg->get_upload_status ( uploads[texture_count - 1] ) != xg_upload_status_complete_m ) {
+        xg->update_uploads ( device );
+        ++update_count;
+    }
+
+    std_tick_t end_tick = std_tick_now();
+    float time_ms = std_tick_to_milli_f32 ( end_tick - start_tick );
+
+    for ( uint32_t i = 0; i < texture_count; ++i ) {
+        std_assert_m ( xg->get_upload_status ( uploads[i] ) == xg_upload_status_complete_m );
+    }
+
+    xg_upload_info_t info;
+    xg->get_upload_info ( &info, device );
+    float total_mb = ( float ) ( texture_bytes * texture_count ) / ( 1024 * 1024 );
+    std_log_info_m ( "Uploaded " std_fmt_f32_dec_m(1) "MB in " std_fmt_f32_dec_m(3) "ms over " std_fmt_u32_m " updates (" std_fmt_f32_dec_m(1) "MB/s, " std_fmt_u64_m "MB per update budget, dedicated copy queue: " std_fmt_str_m ")",
+        total_mb, time_ms, update_count, total_mb / ( time_ms / 1000.f ), info.budget / ( 1024 * 1024 ), info.dedicated_copy_queue ? "yes" : "no" );
+
+    xg_workload_h workload = xg->create_workload ( device );
+    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+    for ( uint32_t i = 0; i < texture_count; ++i ) {
+        xg->cmd_destroy_texture ( resource_cmd_buffer, textures[i], xg_resource_cmd_buffer_time_workload_complete_m );
+    }
+    xg->submit_workload ( workload );
+
+    std_virtual_heap_free ( data );
+}
+
+// Measures the load time of a texture set that gets its mips generated on upload, and the GPU cost of minifying
+// one of those textures by reading from the top mip vs. reading from the mip that matches the destination size
+static void xg_test_mips ( xg_device_h device ) {
+    xg_i* xg = std_module_get_m ( xg_module_name_m );
+
+    const uint32_t texture_count = 16;
+    const uint32_t texture_size = 2048;
+    const uint32_t mip_levels = 12;
+    const uint32_t dest_size = 256;
+    const uint32_t dest_mip = 3;
+
+    uint32_t* data = std_virtual_heap_alloc_array_m ( uint32_t, texture_size * texture_size );
+    for ( uint32_t i = 0; i < texture_size * texture_size; ++i ) {
+        data[i] = i;
+    }
+
+    xg_texture_h textures[texture_count];
+
+    std_tick_t start_tick = std_tick_now();
+
+    xg_workload_h workload = xg->create_workload ( device );
+    xg_resource_cmd_buffer_h resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+
+    for ( uint32_t i = 0; i < texture_count; ++i ) {
+        textures[i] = xg->cmd_create_texture ( resource_cmd_buffer, &xg_texture_params_m (
+            .device = device,
+            .width = texture_size,
+            .height = texture_size,
+            .mip_levels = mip_levels,
+            .format = xg_format_r8g8b8a8_unorm_m,
+            .allowed_usage = xg_texture_usage_bit_sampled_m | xg_texture_usage_bit_copy_dest_m | xg_texture_usage_bit_copy_source_m,
+            .debug_name = "mip_test_texture",
+        ), &xg_texture_init_m (
+            .mode = xg_texture_init_mode_upload_m,
+            .upload_data = data,
+            .final_layout = xg_texture_layout_copy_source_m,
+            .generate_mips = true,
+        ) );
+    }
+
+    xg_texture_h dest = xg->cmd_create_texture ( resource_cmd_buffer, &xg_texture_params_m (
+        .device = device,
+        .width = dest_size,
+        .height = dest_size,
+        .format = xg_format_r8g8b8a8_unorm_m,
+        .allowed_usage = xg_texture_usage_bit_copy_dest_m,
+        .debug_name = "mip_test_dest",
+    ), NULL );
+
+    xg->submit_workload ( workload );
+    xg->wait_for_workload ( workload );
+
+    std_tick_t end_tick = std_tick_now();
+    float load_ms = std_tick_to_milli_f32 ( end_tick - start_tick );
+    float total_mb = ( float ) ( texture_size * texture_size * 4 * texture_count ) / ( 1024 * 1024 );
+    std_log_info_m ( "Loaded " std_fmt_u32_m " " std_fmt_u32_m "x" std_fmt_u32_m " textures (" std_fmt_f32_dec_m(1) "MB) with GPU mip generation in " std_fmt_f32_dec_m(3) "ms",
+        texture_count, texture_size, texture_size, total_mb, load_ms );
+
+    workload = xg->create_workload ( device );
+    xg_cmd_buffer_h cmd_buffer = xg->create_cmd_buffer ( workload );
+    resource_cmd_buffer = xg->create_resource_cmd_buffer ( workload );
+
+    xg_query_pool_h query_pool = xg->create_query_pool ( &xg_query_pool_params_m (
+        .device = device,
+        .type = xg_query_pool_type_timestamp_m,
+        .capacity = 4,
+        .debug_name = "mip_test_timestamps",
+    ) );
+
+    uint64_t key = 0;
+    xg->cmd_reset_query_pool ( cmd_buffer, key++, query_pool );
+
+    xg->cmd_barrier_set ( cmd_buffer, key++, &xg_barrier_set_m (
+        .texture_memory_barriers_count = 1,
+        .texture_memory_barriers = &xg_texture_memory_barrier_m (
+            .texture = dest,
+            .layout.old = xg_texture_layout_undefined_m,
+            .layout.new = xg_texture_layout_copy_dest_m,
+            .memory.flushes = xg_memory_access_bit_none_m,
+            .memory.invalidations = xg_memory_access_bit_transfer_write_m,
+            .execution.blocker = xg_pipeline_stage_bit_transfer_m,
+            .execution.blocked = xg_pipeline_stage_bit_transfer_m,
+        ),
+    ) );
+
+    // Minify every texture into the destination, first reading from mip 0 and then from the mip matching the destination size
+    for ( uint32_t pass = 0; pass < 2; ++pass ) {
+        xg->cmd_query_timestamp ( cmd_buffer, key++, &xg_cmd_query_timestamp_params_m (
+            .pool = query_pool,
+            .idx = pass * 2 + 0,
+            .stage = xg_pipeline_stage_bit_top_of_pipe_m,
+        ) );
+
+        for ( uint32_t i = 0; i < texture_count; ++i ) {
+            xg->cmd_copy_texture ( cmd_buffer, key++, &xg_texture_copy_params_m (
+                .source = xg_texture_copy_resource_m ( .texture = textures[i], .mip_base = pass == 0 ? 0 : dest_mip ),
+                .destination = xg_texture_copy_resource_m ( .texture = dest ),
+                .mip_count = 1,
+                .filter = xg_sampler_filter_linear_m,
+            ) );
+        }
+
+        xg->cmd_query_timestamp ( cmd_buffer, key++, &xg_cmd_query_timestamp_params_m (
+            .pool = query_pool,
+            .idx = pass * 2 + 1,
+            .stage = xg_pipeline_stage_bit_bottom_of_pipe_m,
+        ) );
+    }
+
+    for ( uint32_t i = 0; i < texture_count; ++i ) {
+        xg->cmd_destroy_texture ( resource_cmd_buffer, textures[i], xg_resource_cmd_buffer_time_workload_complete_m );
+    }
+    xg->cmd_destroy_texture ( resource_cmd_buffer, dest, xg_resource_cmd_buffer_time_workload_complete_m );
+
+    xg->submit_workload ( workload );
+    xg->wait_for_workload ( workload );
+
+    uint64_t timestamps[4];
+    xg->read_query_pool ( std_buffer_static_array_m ( timestamps ), query_pool );
+    xg->destroy_query_pool ( query_pool );
+
+    float ns_per_tick = xg->timestamp_to_ns ( device );
+    float top_mip_ms = ns_per_tick * ( timestamps[1] - timestamps[0] ) / 1000000.f;
+    float matching_mip_ms = ns_per_tick * ( timestamps[3] - timestamps[2] ) / 1000000.f;
+    std_log_info_m ( "Minifying " std_fmt_u32_m " textures to " std_fmt_u32_m "x" std_fmt_u32_m ": " std_fmt_f32_dec_m(3) "ms from mip 0, " std_fmt_f32_dec_m(3) "ms from mip " std_fmt_u32_m,
+        texture_count, dest_size, dest_size, top_mip_ms, matching_mip_ms, dest_mip );
+
+    std_virtual_heap_free ( data );
+}
+
 static void xg_test_run ( void ) {
     wm_i* wm = std_module_load_m ( wm_module_name_m );
     wm_window_h window = wm->create_window ( &wm_window_params_m (
@@ -101,6 +295,9 @@ static void xg_test_run ( void ) {
     xg->get_device_info ( &device_info, device );
     std_log_info_m ( "Picking device 0 (" std_fmt_str_m ") as default device", device_info.name );
 
+    xg_test_upload ( device );
+    xg_test_mips ( device );
+
     xg_swapchain_h swapchain = xg->create_window_swapchain ( &xg_swapchain_window_params_m (
         .window = window,
         .device = device,
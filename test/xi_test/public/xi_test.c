@@ -147,8 +147,15 @@ static void xi_test ( void ) {
             .outline = false,
             .debug_name = "proggy_clean"
         );
+        std_tick_t font_tick = std_tick_now();
         font = xi->create_font ( std_buffer_m ( .base = font_data_alloc, .size = font_file_info.size ), &font_params );
+        float font_ms = std_tick_to_milli_f32 ( std_tick_now() - font_tick );
         std_virtual_heap_free ( font_data_alloc );
+
+        xi_font_atlas_stats_t atlas_stats;
+        xi->get_font_atlas_stats ( &atlas_stats );
+        std_log_info_m ( "Font created in " std_fmt_f32_dec_m(3) "ms, " std_fmt_u32_m " glyphs in " std_fmt_u32_m " atlas pages, " std_fmt_u64_m " bytes of textures and " std_fmt_u64_m " bytes of cpu copies",
+            font_ms, atlas_stats.glyph_count, atlas_stats.page_count, atlas_stats.texture_size, atlas_stats.cpu_size );
     }
 
     // create ui entities
@@ -352,6 +359,14 @@ static void xi_test ( void ) {
     float target_frame_period = target_fps > 0.f ? 1.f / target_fps * 1000.f : 0.f;
     std_tick_t frame_tick = std_tick_now();
 
+    uint32_t stats_frame_count = 0;
+    uint32_t stats_draw_count = 0;
+    uint32_t stats_cmd_count = 0;
+    float stats_cpu_ms = 0;
+    // the ui caches are switched on and off every 100 frames, to compare the cost of building the ui with and without them
+    bool stats_ui_cache = true;
+    xi_ui_stats_t stats_ui = { 0 };
+
     while ( true ) {
         std_tick_t new_tick = std_tick_now();
         float delta_ms = std_tick_to_milli_f32 ( new_tick - frame_tick );
@@ -408,6 +423,7 @@ static void xi_test ( void ) {
             // TODO remove
             xi->set_workload_view_info ( xi_workload, &view_info );
 
+            xi->set_ui_cache_enabled ( stats_ui_cache );
             xi->begin_update ( &xi_update_params_m (  
                 .window_info = &new_window_info, 
                 .input_state = &input_state, 
@@ -454,6 +470,36 @@ static void xi_test ( void ) {
         }
 
         xf->execute_graph ( graph, workload, 0 );
+
+        {
+            xi_flush_stats_t flush_stats;
+            xi->get_flush_stats ( &flush_stats );
+            stats_draw_count += flush_stats.draw_count;
+            stats_cmd_count += flush_stats.cmd_count;
+            stats_cpu_ms += flush_stats.cpu_ms;
+
+            xi_ui_stats_t ui_stats;
+            xi->get_ui_stats ( &ui_stats );
+            stats_ui.window_count += ui_stats.window_count;
+            stats_ui.window_cache_hits += ui_stats.window_cache_hits;
+            stats_ui.text_measure_count += ui_stats.text_measure_count;
+            stats_ui.text_measure_hits += ui_stats.text_measure_hits;
+            stats_ui.cpu_ms += ui_stats.cpu_ms;
+
+            if ( ++stats_frame_count == 100 ) {
+                std_log_info_m ( "xi flush: " std_fmt_u32_m " draws for " std_fmt_u32_m " elements, " std_fmt_f32_dec_m(3) "ms CPU per frame",
+                    stats_draw_count / stats_frame_count, stats_cmd_count / stats_frame_count, stats_cpu_ms / stats_frame_count );
+                std_log_info_m ( "xi ui, cache " std_fmt_str_m ": " std_fmt_u32_m "/" std_fmt_u32_m " window cache hits, " std_fmt_u32_m "/" std_fmt_u32_m " text measure cache hits, " std_fmt_f32_dec_m(3) "ms CPU per frame",
+                    stats_ui_cache ? "on" : "off", stats_ui.window_cache_hits, stats_ui.window_count, stats_ui.text_measure_hits, stats_ui.text_measure_count, stats_ui.cpu_ms / stats_frame_count );
+                stats_frame_count = 0;
+                stats_draw_count = 0;
+                stats_cmd_count = 0;
+                stats_cpu_ms = 0;
+                stats_ui_cache = !stats_ui_cache;
+                std_mem_zero_m ( &stats_ui );
+            }
+        }
+
         xg->submit_workload ( workload );
         xg->present_swapchain ( swapchain, workload );
 
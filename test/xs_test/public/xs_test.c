@@ -429,7 +429,13 @@ static void xs_test ( void ) {
             .viewport_state.height = 400,
         ),
     ) );
-    xs->build_database ( sdb );
+    xs_database_build_result_t build_result = xs->build_database ( sdb );
+    std_assert_m ( build_result.failed_pipeline_states == 0 );
+
+    // nothing changed on disk, a rebuild should not invoke the compiler nor recreate any pipeline
+    xs_database_build_result_t rebuild_result = xs->build_database ( sdb );
+    std_assert_m ( rebuild_result.successful_shaders == 0 && rebuild_result.successful_pipeline_states == 0 );
+    std_log_info_m ( "Shader database build: " std_fmt_f32_dec_m(2) "ms, rebuild: " std_fmt_f32_dec_m(2) "ms", build_result.total_time_ms, rebuild_result.total_time_ms );
 
     xs_database_pipeline_h graphics_database_pipeline = xs->get_database_pipeline ( sdb, xs_hash_static_string_m ( "triangle" ) );
     xs_database_pipeline_h compute_database_pipeline = xs->get_database_pipeline ( sdb, xs_hash_static_string_m ( "clear" ) );
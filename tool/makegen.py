@@ -313,7 +313,7 @@ def parse_makedef_bindings(path):
 #   deps = std
 #   code = public, private
 #   libs = $external_dependency_lib
-#   includes = $external_dependency_include
+#   includes = $external_dependency_include, ../../external/some_header_only_dependency
 #
 def parse_makedef(path, bindings):
     log.verbose('Parsing makedef (' + path + '):')
@@ -1269,7 +1269,8 @@ class Generator:
         elif 'ignores' in makedef:
             project.project_ignores = makedef['ignores']
         if 'includes' in makedef:
-            project.external_paths = makedef['includes']
+            # Relative include paths are relative to the makedef folder, bindings are expected to be absolute
+            project.external_paths = [x if os.path.isabs(x) else normpath(path + '/' + x) for x in makedef['includes']]
         if 'libs' in makedef:
             project.external_libs = makedef['libs']
         if 'dlls' in makedef: